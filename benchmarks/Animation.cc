@@ -0,0 +1,88 @@
+/***************************************************
+* Benchmark - Skeletal animation                   *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Animation.h"
+#include "Animator.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "types.h"
+
+static const uint32_t kJoints = 40;
+static const uint32_t kFrames = 301;  // 10 seconds at 30 fps
+static const uint32_t kCharacters = 500;
+static const int kUpdates = 200;
+
+static void axisAngle(float x, float y, float z, float angle, float q[4]) {
+    float s = sinf(angle * 0.5f);
+    q[0] = x * s;
+    q[1] = y * s;
+    q[2] = z * s;
+    q[3] = cosf(angle * 0.5f);
+}
+
+// A humanoid-sized chain: every joint swings at its own rate, a few slide,
+// and the fingers (the last 10 joints) barely move
+static lys3d::RawAnimation makeClip(float phase) {
+    lys3d::RawAnimation raw;
+    raw.jointCount = kJoints;
+    raw.frames.resize(kFrames * kJoints);
+    for (uint32_t f = 0; f < kFrames; ++f) {
+        float t = f / raw.sampleRate;
+        for (uint32_t j = 0; j < kJoints; ++j) {
+            lys3d::JointPose &pose = raw.frames[f * kJoints + j];
+            float amount = j < kJoints - 10 ? 0.6f : 0.0f;
+            axisAngle(j % 3 == 0, j % 3 == 1, j % 3 == 2, amount * sinf(t * (1.0f + j * 0.1f) + phase), pose.rotation);
+            pose.translation[1] = 0.2f;
+            if (j == 0)
+                pose.translation[2] = 0.05f * sinf(t * 4.0f + phase);
+        }
+    }
+    return raw;
+}
+
+int main(void) {
+    lys3d::Skeleton skeleton;
+    lys3d::JointPose bind;
+    bind.translation[1] = 0.2f;
+    for (uint32_t j = 0; j < kJoints; ++j)
+        skeleton.add(static_cast<int32_t>(j) - 1, bind);
+
+    lys3d::AnimationClip walk, run;
+    lys3d::RawAnimation raw = makeClip(0.0f);
+    walk.compress(raw);
+    run.compress(makeClip(1.0f));
+    size_t raw_bytes = raw.frames.size() * sizeof(lys3d::JointPose);
+    printf("%u joints, %u frames: %zu bytes raw, %zu bytes compressed (%.1fx), %zu of %u keys kept\n", kJoints,
+           kFrames, raw_bytes, walk.memoryUsage(), raw_bytes / static_cast<double>(walk.memoryUsage()),
+           walk.keyCount(), kFrames * kJoints * 3);
+
+    printf("%u characters, %d updates, half of them blending two clips:\n", kCharacters, kUpdates);
+    for (uint32_t workers = 0; workers <= 3; ++workers) {
+        lys3d::Animator animator(workers);
+        for (uint32_t i = 0; i < kCharacters; ++i) {
+            animator.add(&skeleton);
+            lys3d::AnimationState &state = animator.state(i);
+            state.clip = &walk;
+            state.blendClip = i % 2 ? &run : nullptr;
+            state.blendWeight = 0.5f;
+            state.time = i * 0.013f;
+        }
+        double update_ms = 0.0;
+        for (int update = 0; update < kUpdates; ++update) {
+            animator.update(1.0f / 60.0f);
+            update_ms += animator.stats().updateMs;
+        }
+        printf("  %u workers: %6.3f ms/update, %7.1f characters/ms\n", workers, update_ms / kUpdates,
+               kCharacters * kUpdates / update_ms);
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+/***************************************************
+* Benchmark - Broadphase pair finding              *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Broadphase.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "types.h"
+
+static const int kFrames = 60;
+
+static uint32_t seed = 1;
+
+static float uniform(float low, float high) {
+    seed = seed * 1664525u + 1013904223u;
+    return low + (high - low) * ((seed >> 8) / 16777216.0f);
+}
+
+static lys3d::Point3Df randomPoint(float world) {
+    return lys3d::Point3Df(uniform(-world, world), uniform(-world, world), uniform(-world, world));
+}
+
+// Runs kFrames updates, moving the given share of proxies by their
+// velocities each frame, and prints the averages
+static void run(const char *name, uint32_t workers, uint32_t static_count, uint32_t dynamic_count,
+                float moving_static) {
+    lys3d::BroadphaseSettings settings;
+    settings.workers = workers;
+    lys3d::Broadphase broadphase(settings);
+    lys3d::Vector<uint32_t> proxies;
+    lys3d::Vector<lys3d::Point3Df> velocities;
+    for (uint32_t i = 0; i < static_count; ++i) {
+        // Asteroids and station parts, 1 to 8 units across
+        lys3d::Point3Df half(uniform(0.5f, 4.0f), uniform(0.5f, 4.0f), uniform(0.5f, 4.0f));
+        proxies.push_back(broadphase.add(lys3d::Box3Df::fromCenter(randomPoint(400.0f), half),
+                                         lys3d::ProxyMotion::kStatic));
+        velocities.push_back(lys3d::Point3Df(0.0f, uniform(-0.1f, 0.1f), 0.0f));
+    }
+    for (uint32_t i = 0; i < dynamic_count; ++i) {
+        // Projectiles and debris, a third to two units across, moving fast
+        float half = i % 10 == 0 ? 1.0f : 0.15f;
+        proxies.push_back(broadphase.add(lys3d::Box3Df::fromCenter(randomPoint(400.0f),
+                                         lys3d::Point3Df(half, half, half)), lys3d::ProxyMotion::kDynamic));
+        velocities.push_back(randomPoint(2.0f));
+    }
+    broadphase.update();
+
+    double total_ms = 0.0, worst_ms = 0.0, churn = 0.0;
+    uint32_t moving = static_cast<uint32_t>(static_count * moving_static);
+    for (int frame = 0; frame < kFrames; ++frame) {
+        for (size_t i = 0; i < proxies.size(); ++i) {
+            if (i < static_count && i % static_count >= moving)
+                continue;
+            const lys3d::Box3Df &box = broadphase.bounds(proxies[i]);
+            broadphase.move(proxies[i], lys3d::Box3Df(box.min() + velocities[i], box.max() + velocities[i]));
+        }
+        broadphase.update();
+        const lys3d::BroadphaseStats &stats = broadphase.stats();
+        total_ms += stats.updateMs;
+        worst_ms = std::max(worst_ms, static_cast<double>(stats.updateMs));
+        churn += stats.added + stats.removed;
+    }
+    printf("  %-34s %u workers: %7.3f ms/update (worst %7.3f), %6u pairs, %7.1f pairs churned per update\n", name,
+           workers, total_ms / kFrames, worst_ms, broadphase.stats().pairs, churn / kFrames);
+}
+
+int main(void) {
+    uint32_t workers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    printf("Broadphase, %d updates each:\n", kFrames);
+    run("Static, 100k (1% moving)", workers, 100000, 0, 0.01f);
+    run("Projectiles, 100k dynamic", 0, 0, 100000, 0.0f);
+    run("Projectiles, 100k dynamic", workers, 0, 100000, 0.0f);
+    run("Battle, 20k static + 100k dynamic", workers, 20000, 100000, 0.0f);
+    return 0;
+}
@@ -0,0 +1,197 @@
+/***************************************************
+* Benchmark - Per-mesh buffers vs a geometry pool  *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "GeometryPool.h"
+#include "ShaderProgram.h"
+#include "WindowGLES2.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "GLES2/gl2.h"
+#include <SDL2/SDL.h>
+#include "types.h"
+
+static const char* kVertex =
+    "attribute vec3 a_position;\n"
+    "attribute vec3 a_normal;\n"
+    "varying vec3 v_color;\n"
+    "void main() {\n"
+    "    v_color = a_normal * 0.5 + 0.5;\n"
+    "    gl_Position = vec4(a_position, 1.0);\n"
+    "}\n";
+
+static const char* kFragment =
+    "varying vec3 v_color;\n"
+    "void main() {\n"
+    "    gl_FragColor = vec4(v_color, 1.0);\n"
+    "}\n";
+
+// A small grid patch somewhere on screen
+static void makePatch(int index, int size, lys3d::Vector<lys3d::MeshVertex> *vertices,
+                      lys3d::Vector<uint16_t> *indices) {
+    float x0 = (index % 32) / 16.0f - 1.0f, y0 = (index / 32 % 32) / 16.0f - 1.0f;
+    vertices->clear();
+    indices->clear();
+    for (int y = 0; y <= size; ++y) {
+        for (int x = 0; x <= size; ++x) {
+            lys3d::MeshVertex v = {};
+            v.position[0] = x0 + x / (16.0f * size);
+            v.position[1] = y0 + y / (16.0f * size);
+            v.normal[2] = 1.0f;
+            vertices->push_back(v);
+        }
+    }
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            uint16_t a = static_cast<uint16_t>(y * (size + 1) + x);
+            uint16_t b = static_cast<uint16_t>(a + size + 1);
+            indices->insert(indices->end(), {a, b, static_cast<uint16_t>(a + 1),
+                                             static_cast<uint16_t>(a + 1), b, static_cast<uint16_t>(b + 1)});
+        }
+    }
+}
+
+// Streams meshes in and out like a level would, with and without
+// incremental defragmentation, and reports how scattered the free space gets
+static void churn(bool defragment) {
+    const int kFrames = 20000, kReport = 4000;
+    lys3d::GeometryPool pool(lys3d::VertexLayout::full(), 512 * 1024, 3 * 512 * 1024);
+    lys3d::Vector<uint32_t> live;
+    lys3d::Vector<lys3d::MeshVertex> vertices;
+    lys3d::Vector<uint16_t> indices;
+    uint32_t failures = 0;
+    uint64_t moved = 0;
+    srand(42);
+
+    printf("Churn, %s defragmentation:\n", defragment ? "with" : "without");
+    for (int frame = 1; frame <= kFrames; ++frame) {
+        // Keep the pool around 70% full
+        for (int i = 0; i < 4; ++i) {
+            bool full = pool.stats().vertexBytes > 512 * 1024 * sizeof(lys3d::MeshVertex) * 7 / 10;
+            if (!live.empty() && (full || rand() % 2 == 0)) {
+                size_t index = static_cast<size_t>(rand()) % live.size();
+                pool.remove(live[index]);
+                live[index] = live.back();
+                live.pop_back();
+            } else {
+                makePatch(rand(), 2 + rand() % 40, &vertices, &indices);
+                uint32_t id = pool.add(vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(),
+                                       static_cast<uint32_t>(indices.size()));
+                if (id != 0)
+                    live.push_back(id);
+                else
+                    ++failures;
+            }
+        }
+        if (defragment) {
+            pool.defragment(64 * 1024);
+            moved += pool.stats().movedBytes;
+        }
+
+        if (frame % kReport == 0) {
+            lys3d::GeometryPoolStats stats = pool.stats();
+            printf("  frame %5d: %4u meshes, %6u KB used, fragmentation %.3f (vertices) %.3f (indices), "
+                   "%u failed adds, %.1f KB/frame moved\n", frame, stats.meshCount,
+                   static_cast<unsigned>((stats.vertexBytes + stats.indexBytes) / 1024), stats.vertexFragmentation,
+                   stats.indexFragmentation, failures, moved / 1024.0 / frame);
+        }
+    }
+}
+
+int main(void) {
+    churn(false);
+    churn(true);
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        printf("SDL_Init failed, skipping the draw benchmark\n");
+        return 0;
+    }
+    lys3d::WindowGLES2 window;
+    window.useFullscreen(false, false);
+    window.size(lys3d::Dimension2Di32(1280, 720));
+    if (!window.open()) {
+        printf("Could not open a GL window, skipping the draw benchmark\n");
+        SDL_Quit();
+        return 0;
+    }
+    window.useVSync(false);
+
+    const int kMeshes = 1000, kFrames = 100;
+    lys3d::VertexLayout layout = lys3d::VertexLayout::full();
+    lys3d::GeometryPool pool(layout);
+    lys3d::Vector<GLuint> buffers(kMeshes * 2);
+    lys3d::Vector<uint32_t> ids(kMeshes), counts(kMeshes);
+    lys3d::Vector<lys3d::MeshVertex> vertices;
+    lys3d::Vector<uint16_t> indices;
+    glGenBuffers(kMeshes * 2, buffers.data());
+    for (int i = 0; i < kMeshes; ++i) {
+        makePatch(i, 4, &vertices, &indices);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[i * 2]);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(lys3d::MeshVertex), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[i * 2 + 1]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+        ids[i] = pool.add(vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(),
+                          static_cast<uint32_t>(indices.size()));
+        counts[i] = static_cast<uint32_t>(indices.size());
+    }
+    pool.create();
+
+    lys3d::ShaderProgram program;
+    if (!program.build(kVertex, kFragment)) {
+        printf("Shader build failed:\n%s\n", program.log().c_str());
+        return 1;
+    }
+    program.use();
+
+    printf("%d meshes per frame:\n", kMeshes);
+    const char *names[2] = {"per-mesh buffers", "geometry pool"};
+    for (int method = 0; method < 2; ++method) {
+        double total_ms = 0.0;
+        uint32_t binds = 0;
+        for (int frame = -5; frame < kFrames; ++frame) {
+            binds = 0;
+            glFinish();
+            auto start = std::chrono::steady_clock::now();
+            glClear(GL_COLOR_BUFFER_BIT);
+            if (method == 0) {
+                for (int i = 0; i < kMeshes; ++i) {
+                    glBindBuffer(GL_ARRAY_BUFFER, buffers[i * 2]);
+                    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[i * 2 + 1]);
+                    layout.apply();
+                    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(counts[i]), GL_UNSIGNED_SHORT, nullptr);
+                    binds += 2;
+                }
+                layout.disable();
+            } else {
+                pool.bind();
+                binds += 2;
+                for (int i = 0; i < kMeshes; ++i)
+                    pool.draw(ids[i]);
+                pool.unbind();
+            }
+            glFinish();
+            auto end = std::chrono::steady_clock::now();
+            if (frame >= 0)
+                total_ms += std::chrono::duration<double, std::milli>(end - start).count();
+            window.update();
+        }
+        printf("%-18s %5u buffer binds/frame, %7.3f ms/frame\n", names[method], binds, total_ms / kFrames);
+    }
+
+    glDeleteBuffers(kMeshes * 2, buffers.data());
+    program.destroy();
+    pool.destroy();
+    window.close();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,100 @@
+/***************************************************
+* Benchmark - LOD selection over an asteroid field *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "LodSelector.h"
+#include "Mesh.h"
+#include "MeshSimplifier.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "types.h"
+
+// Lumpy UV sphere, standing in for an asteroid
+static void makeAsteroid(lys3d::Mesh *mesh, int rings, int segments) {
+    for (int r = 0; r <= rings; ++r) {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s <= segments; ++s) {
+            float phi = 6.28318531f * s / segments;
+            float bump = 1.0f + 0.15f * sinf(theta * 5.0f) * cosf(phi * 3.0f);
+            lys3d::MeshVertex v;
+            v.normal[0] = sinf(theta) * cosf(phi);
+            v.normal[1] = cosf(theta);
+            v.normal[2] = sinf(theta) * sinf(phi);
+            for (int k = 0; k < 3; ++k)
+                v.position[k] = v.normal[k] * bump;
+            v.uv[0] = static_cast<float>(s) / segments;
+            v.uv[1] = static_cast<float>(r) / rings;
+            mesh->vertices().push_back(v);
+        }
+    }
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            uint16_t a = static_cast<uint16_t>(r * (segments + 1) + s);
+            uint16_t b = static_cast<uint16_t>(a + segments + 1);
+            mesh->indices().insert(mesh->indices().end(),
+                                   {a, b, static_cast<uint16_t>(a + 1),
+                                    static_cast<uint16_t>(a + 1), b, static_cast<uint16_t>(b + 1)});
+        }
+    }
+    mesh->resetLods();
+}
+
+int main(void) {
+    const int kInstances = 20000;
+    const int kFrames = 600;
+
+    lys3d::Mesh asteroid;
+    makeAsteroid(&asteroid, 64, 128);
+    lys3d::MeshSimplifier simplifier;
+    simplifier.maxLods(5);
+    simplifier.generate(&asteroid);
+    printf("Asteroid mesh:\n");
+    for (size_t i = 0; i < asteroid.lods().size(); ++i)
+        printf("  LOD %u: %6u triangles, error %.4f\n", static_cast<unsigned>(i),
+               asteroid.triangleCount(i), asteroid.lods()[i].error);
+
+    // Asteroids of 1-20 units scattered through a 4 km cube
+    srand(1234);
+    lys3d::LodVisibleList list;
+    for (int i = 0; i < kInstances; ++i) {
+        float scale = 1.0f + 19.0f * rand() / RAND_MAX;
+        lys3d::Point3Df center(4000.0f * rand() / RAND_MAX - 2000.0f,
+                               4000.0f * rand() / RAND_MAX - 2000.0f,
+                               4000.0f * rand() / RAND_MAX - 2000.0f);
+        list.add(center, asteroid.boundsRadius() * scale, &asteroid);
+    }
+
+    lys3d::LodSelector selector;
+    selector.projection(lys3d::Dimension2Di32(1920, 1080), 1.0471976f);
+
+    uint64_t full = 0, selected = 0;
+    double total_ms = 0.0;
+    for (int frame = 0; frame < kFrames; ++frame) {
+        // Fly straight through the middle of the field
+        lys3d::Point3Df camera(0.0f, 0.0f, -2000.0f + 4000.0f * frame / kFrames);
+        auto start = std::chrono::steady_clock::now();
+        selector.select(camera, &list);
+        auto end = std::chrono::steady_clock::now();
+        total_ms += std::chrono::duration<double, std::milli>(end - start).count();
+        full += selector.stats().fullDetailTriangles;
+        selected += selector.stats().selectedTriangles;
+    }
+
+    printf("%d instances, %d frames\n", kInstances, kFrames);
+    printf("Triangles per frame without LOD: %llu\n", static_cast<unsigned long long>(full / kFrames));
+    printf("Triangles per frame with LOD:    %llu (%.1f%%)\n",
+           static_cast<unsigned long long>(selected / kFrames), 100.0 * selected / full);
+    printf("Selection time per frame:        %.3f ms\n", total_ms / kFrames);
+
+    return 0;
+}
@@ -0,0 +1,234 @@
+/***************************************************
+* Benchmark - Material uniform uploads             *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Material.h"
+#include "VertexLayout.h"
+#include "WindowGLES2.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+
+#include "GLES2/gl2.h"
+#include <SDL2/SDL.h>
+#include "types.h"
+
+using lys3d::Material;
+using lys3d::Vector;
+
+static const int kFrames = 120;
+static const uint32_t kMaterials = 400, kDraws = 4000;
+// Materials whose values change every frame, e.g. pulsing emission
+static const uint32_t kAnimated = kMaterials / 10;
+
+static const char* kVertex =
+    "attribute vec3 a_position;\n"
+    "#ifdef MATERIAL_SKINNING\n"
+    "attribute vec4 a_weights;\n"
+    "#endif\n"
+    "void main() {\n"
+    "    vec3 p = a_position;\n"
+    "#ifdef MATERIAL_SKINNING\n"
+    "    p += a_weights.xyz * 0.001;\n"
+    "#endif\n"
+    "    gl_PointSize = 1.0;\n"
+    "    gl_Position = vec4(p, 1.0);\n"
+    "}\n";
+
+// Reads every slot the permutation has, so none of them is optimized out
+static const char* kFragment =
+    "uniform vec4 u_material[MATERIAL_SLOTS];\n"
+    "void main() {\n"
+    "    vec4 color = u_material[MATERIAL_BASE_COLOR];\n"
+    "    vec4 surface = u_material[MATERIAL_SURFACE];\n"
+    "    color.rgb *= 1.0 - surface.x * 0.5 + surface.y * 0.1;\n"
+    "#ifdef MATERIAL_NORMAL_MAP\n"
+    "    color.rgb *= surface.z;\n"
+    "#endif\n"
+    "#ifdef MATERIAL_EMISSIVE\n"
+    "    color.rgb += u_material[MATERIAL_EMISSIVE_COLOR].rgb * u_material[MATERIAL_EMISSIVE_COLOR].a;\n"
+    "#endif\n"
+    "#ifdef MATERIAL_FOG\n"
+    "    color.rgb = mix(color.rgb, u_material[MATERIAL_FOG_COLOR].rgb, u_material[MATERIAL_FOG_COLOR].a);\n"
+    "#endif\n"
+    "    if (color.a < surface.w)\n"
+    "        discard;\n"
+    "    gl_FragColor = color;\n"
+    "}\n";
+
+static uint32_t seed = 1;
+
+static float uniform(float low, float high) {
+    seed = seed * 1664525u + 1013904223u;
+    return low + (high - low) * ((seed >> 8) / 16777216.0f);
+}
+
+static double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct FrameCounts {
+    uint64_t programChanges = 0;
+    uint64_t uniformCalls = 0;
+    uint64_t uploadedSlots = 0;
+    double ms = 0.0;
+};
+
+static void report(const char *name, const FrameCounts &counts) {
+    printf("%-36s %7.1f program changes, %7.1f glUniform calls, %7.1f vec4s, %.3f ms/frame\n", name,
+           counts.programChanges / static_cast<double>(kFrames), counts.uniformCalls / static_cast<double>(kFrames),
+           counts.uploadedSlots / static_cast<double>(kFrames), counts.ms / kFrames);
+}
+
+static void animate(const Vector<Material*> &materials, int frame) {
+    for (uint32_t i = 0; i < kAnimated; ++i) {
+        Material *material = materials[(i * 7 + frame) % kMaterials];
+        float pulse = 0.5f + 0.5f * static_cast<float>(frame % 30) / 30.0f;
+        if (!material->set(lys3d::kMaterialEmissiveColor, 1.0f, 0.5f, 0.2f, pulse))
+            material->set(lys3d::kMaterialBaseColor, pulse, pulse, pulse, 1.0f);
+    }
+}
+
+int main(void) {
+    // The render queue: draws in submission order, over materials spread
+    // across every permutation
+    lys3d::MaterialShader shader;
+    Vector<Material*> materials;
+    for (uint32_t i = 0; i < kMaterials; ++i) {
+        Material *material = new Material(&shader, i % lys3d::kMaterialPermutationCount);
+        material->set(lys3d::kMaterialBaseColor, uniform(0.0f, 1.0f), uniform(0.0f, 1.0f), uniform(0.0f, 1.0f), 1.0f);
+        material->set(lys3d::kMaterialSurface, uniform(0.0f, 1.0f), uniform(0.0f, 1.0f), 1.0f, 0.0f);
+        material->set(lys3d::kMaterialEmissiveColor, 1.0f, 0.5f, 0.2f, uniform(0.0f, 1.0f));
+        material->set(lys3d::kMaterialFogColor, 0.5f, 0.6f, 0.7f, uniform(0.0f, 0.5f));
+        materials.push_back(material);
+    }
+    Vector<const Material*> queue;
+    for (uint32_t i = 0; i < kDraws; ++i)
+        queue.push_back(materials[static_cast<uint32_t>(uniform(0.0f, kMaterials - 0.01f))]);
+
+    auto start = std::chrono::steady_clock::now();
+    Vector<const Material*> sorted;
+    for (int frame = 0; frame < kFrames; ++frame) {
+        sorted = queue;
+        std::sort(sorted.begin(), sorted.end(), [](const Material *a, const Material *b) {
+            return a->sortKey() < b->sortKey();
+        });
+    }
+    printf("Sorting %u draws by material key: %.3f ms/frame\n", kDraws, since(start) / kFrames);
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        printf("SDL_Init failed, skipping the GPU benchmark\n");
+        return 0;
+    }
+    lys3d::WindowGLES2 window;
+    window.useFullscreen(false, false);
+    window.size(lys3d::Dimension2Di32(640, 360));
+    if (!window.open()) {
+        printf("Could not open a GL window, skipping the GPU benchmark\n");
+        SDL_Quit();
+        return 0;
+    }
+    window.useVSync(false);
+
+    start = std::chrono::steady_clock::now();
+    if (!shader.build(kVertex, kFragment)) {
+        printf("Could not build the material shader:\n%s\n", shader.log().c_str());
+        window.close();
+        SDL_Quit();
+        return 1;
+    }
+    printf("Building %u permutations: %.1f ms\n", shader.programCount(), since(start));
+
+    // One point per draw, so the driver has to validate what was set
+    const float point[3] = {0.0f, 0.0f, 0.0f};
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(point), point, GL_STATIC_DRAW);
+    glVertexAttribPointer(lys3d::kAttribPosition, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(lys3d::kAttribPosition);
+
+    // The baseline sets every parameter with its own call, as shaders with
+    // one uniform per parameter do
+    int32_t locations[lys3d::kMaterialPermutationCount][lys3d::kMaterialMaxSlots];
+    for (uint32_t features = 0; features < lys3d::kMaterialPermutationCount; ++features) {
+        for (uint32_t slot = 0; slot < lys3d::materialSlotCount(features); ++slot) {
+            char name[32];
+            snprintf(name, sizeof(name), "u_material[%u]", slot);
+            locations[features][slot] = shader.program(features)->uniformLocation(name);
+        }
+    }
+
+    const char *names[3] = {"Per-parameter uniforms, unsorted:", "Uniform blocks, unsorted:",
+                            "Uniform blocks, sorted by key:"};
+    for (int mode = 0; mode < 3; ++mode) {
+        FrameCounts counts;
+        lys3d::MaterialBinder binder;
+        for (int frame = -5; frame < kFrames; ++frame) {
+            animate(materials, frame + 5);
+            glClear(GL_COLOR_BUFFER_BIT);
+            glFinish();
+            binder.reset();
+            binder.resetStats();
+            uint64_t program_changes = 0, uniform_calls = 0, uploaded = 0;
+            start = std::chrono::steady_clock::now();
+            if (mode == 0) {
+                const lys3d::ShaderProgram *current = nullptr;
+                for (const Material *material : queue) {
+                    const lys3d::ShaderProgram *program = shader.program(material->features());
+                    if (program != current) {
+                        program->use();
+                        current = program;
+                        ++program_changes;
+                    }
+                    for (uint32_t slot = 0; slot < material->slotCount(); ++slot)
+                        glUniform4fv(locations[material->features()][slot], 1, &material->block()[slot * 4]);
+                    uniform_calls += material->slotCount();
+                    uploaded += material->slotCount();
+                    glDrawArrays(GL_POINTS, 0, 1);
+                }
+            } else {
+                const Vector<const Material*> *draws = &queue;
+                if (mode == 2) {
+                    sorted = queue;
+                    std::sort(sorted.begin(), sorted.end(), [](const Material *a, const Material *b) {
+                        return a->sortKey() < b->sortKey();
+                    });
+                    draws = &sorted;
+                }
+                for (const Material *material : *draws) {
+                    binder.bind(*material);
+                    glDrawArrays(GL_POINTS, 0, 1);
+                }
+                program_changes = binder.stats().programChanges;
+                uniform_calls = binder.stats().uniformCalls;
+                uploaded = binder.stats().uploadedSlots;
+            }
+            glFinish();
+            if (frame >= 0) {
+                counts.ms += since(start);
+                counts.programChanges += program_changes;
+                counts.uniformCalls += uniform_calls;
+                counts.uploadedSlots += uploaded;
+            }
+            window.update();
+        }
+        report(names[mode], counts);
+    }
+
+    glDisableVertexAttribArray(lys3d::kAttribPosition);
+    glDeleteBuffers(1, &buffer);
+    shader.destroy();
+    for (Material *material : materials)
+        delete material;
+    window.close();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,85 @@
+/***************************************************
+* Benchmark - Barnes-Hut gravity steps             *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "NBodySystem.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "types.h"
+
+static const int kSteps = 3;
+static const uint32_t kCounts[] = {1000, 4000, 16000, 64000, 250000, 1000000};
+
+// A star with an asteroid belt on roughly circular orbits, in units where
+// G = 1 and the star's mass is 1
+static void addBelt(lys3d::NBodySystem *system, uint32_t count) {
+    system->add(lys3d::Point3Dd(), lys3d::Point3Dd(), 1.0);
+    uint32_t seed = 7;
+    for (uint32_t i = 1; i < count; ++i) {
+        double p[3];
+        for (int k = 0; k < 3; ++k) {
+            seed = seed * 1664525u + 1013904223u;
+            p[k] = (seed >> 8) / 16777216.0;
+        }
+        double r = 2.0 + p[0], angle = p[1] * 6.283185307179586, speed = sqrt(1.0 / r);
+        double c = cos(angle), s = sin(angle);
+        system->add(lys3d::Point3Dd(r * c, r * s, (p[2] - 0.5) * 0.1), lys3d::Point3Dd(-speed * s, speed * c, 0.0),
+                    1.0e-9);
+    }
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(void) {
+    lys3d::NBodySettings settings;
+    settings.gravity = 1.0;
+    settings.softening = 1.0e-4;
+    settings.workers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    printf("Asteroid belt, %d steps each, theta %.2f, %u workers:\n", kSteps, settings.theta, settings.workers);
+    for (uint32_t count : kCounts) {
+        lys3d::NBodySystem system(settings);
+        addBelt(&system, count);
+        system.computeAccelerations();
+        double build_ms = 0.0, force_ms = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kSteps; ++i) {
+            system.step(0.01);
+            build_ms += system.stats().buildMs;
+            force_ms += system.stats().forceMs;
+        }
+        double step_ms = elapsedMs(start) / kSteps;
+        printf("  %7u bodies: %9.2f ms/step (tree %8.2f, forces %9.2f), %5.0f interactions per body",
+               count, step_ms, build_ms / kSteps, force_ms / kSteps,
+               static_cast<double>(system.stats().interactions) / count);
+
+        // Brute force, while it still finishes
+        if (count <= 16000) {
+            lys3d::Vector<lys3d::Point3Dd> exact(count);
+            start = std::chrono::steady_clock::now();
+            system.directAccelerations(exact.data());
+            double direct_ms = elapsedMs(start);
+            double sum = 0.0;
+            for (uint32_t i = 0; i < count; ++i) {
+                double error = (system.acceleration(i) - exact[i]).length() / exact[i].length();
+                sum += error * error;
+            }
+            printf(", direct %9.2f ms, %.1e RMS error", direct_ms, sqrt(sum / count));
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,76 @@
+/***************************************************
+* Benchmark - CPU occlusion culling                *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "OcclusionCuller.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+
+static const int kFrames = 200;
+static const int kObjects = 20000;
+static const int kOccluders = 24;
+
+static float frand(float lo, float hi) {
+    return lo + (hi - lo) * (rand() / static_cast<float>(RAND_MAX));
+}
+
+// A camera at the origin looking down -Z
+static void perspective(float fov_y, float aspect, float z_near, float z_far, float out[16]) {
+    float f = 1.0f / tanf(fov_y * 0.5f);
+    memset(out, 0, 16 * sizeof(float));
+    out[0] = f / aspect;
+    out[5] = f;
+    out[10] = (z_far + z_near) / (z_near - z_far);
+    out[11] = -1.0f;
+    out[14] = 2.0f * z_far * z_near / (z_near - z_far);
+}
+
+int main(void) {
+    // A station interior: bulkheads and large rocks in front of a dense field
+    srand(7);
+    lys3d::Vector<lys3d::Box3Df> occluders, objects;
+    for (int i = 0; i < kOccluders; ++i) {
+        lys3d::Point3Df center(frand(-60.0f, 60.0f), frand(-30.0f, 30.0f), frand(-60.0f, -20.0f));
+        lys3d::Point3Df half(frand(5.0f, 15.0f), frand(5.0f, 15.0f), frand(1.0f, 5.0f));
+        occluders.push_back(lys3d::Box3Df::fromCenter(center, half));
+    }
+    for (int i = 0; i < kObjects; ++i) {
+        lys3d::Point3Df center(frand(-150.0f, 150.0f), frand(-80.0f, 80.0f), frand(-300.0f, -60.0f));
+        float size = frand(0.5f, 3.0f);
+        objects.push_back(lys3d::Box3Df::fromCenter(center, lys3d::Point3Df(size, size, size)));
+    }
+    float projection[16];
+    perspective(1.0f, 16.0f / 9.0f, 0.5f, 1000.0f, projection);
+    lys3d::Vector<uint8_t> visible(kObjects);
+
+    printf("%d occluders, %d objects, %d frames:\n", kOccluders, kObjects, kFrames);
+    for (uint32_t workers = 0; workers <= 3; ++workers) {
+        lys3d::OcclusionCuller culler(lys3d::Dimension2Di32(320, 192), workers);
+        double raster_ms = 0.0, test_ms = 0.0;
+        float culled = 0.0f;
+        for (int frame = 0; frame < kFrames; ++frame) {
+            culler.beginFrame(projection);
+            for (const lys3d::Box3Df &box : occluders)
+                culler.addOccluder(box);
+            culler.rasterize();
+            culler.cull(objects.data(), objects.size(), visible.data());
+            raster_ms += culler.stats().rasterMs;
+            test_ms += culler.stats().testMs;
+            culled = culler.stats().culledPercent();
+        }
+        printf("  %u workers: %6.3f ms/frame rasterizing, %6.3f ms/frame testing, %4.1f%% culled\n", workers,
+               raster_ms / kFrames, test_ms / kFrames, culled);
+    }
+    return 0;
+}
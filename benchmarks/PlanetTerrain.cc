@@ -0,0 +1,76 @@
+/***************************************************
+* Benchmark - Planet terrain descent               *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "PlanetTerrain.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "types.h"
+
+static const int kFrames = 600;  // 10 seconds at 60 fps
+
+// A GL-style projection for a camera looking down -Z
+static void perspective(float fov_y, float aspect, float z_near, float z_far, float out[16]) {
+    float f = 1.0f / tanf(fov_y * 0.5f);
+    memset(out, 0, 16 * sizeof(float));
+    out[0] = f / aspect;
+    out[5] = f;
+    out[10] = (z_far + z_near) / (z_near - z_far);
+    out[11] = -1.0f;
+    out[14] = 2.0f * z_far * z_near / (z_near - z_far);
+}
+
+int main(void) {
+    // Looking straight down at the planet from above +Z, tilted forward a
+    // little so the horizon comes into view near the ground
+    float view_projection[16], tilt = 0.5f;
+    perspective(1.0471976f, 16.0f / 9.0f, 1.0f, 1.0e8f, view_projection);
+    float c = cosf(tilt), s = sinf(tilt);
+    for (int row = 0; row < 4; ++row) {
+        float y = view_projection[4 + row], z = view_projection[8 + row];
+        view_projection[4 + row] = c * y + s * z;
+        view_projection[8 + row] = -s * y + c * z;
+    }
+
+    lys3d::PlanetSettings settings;
+    printf("Descent from 20000 km to 100 m over %d frames, radius %.0f km, %u-vertex chunks:\n", kFrames,
+           settings.radius / 1000.0, settings.chunkSize);
+    for (uint32_t workers = 1; workers <= 3; ++workers) {
+        settings.workers = workers;
+        lys3d::PlanetTerrain terrain(settings);
+        double total_ms = 0.0, worst_ms = 0.0;
+        uint32_t uploads = 0, lagging = 0, chunks = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < kFrames; ++frame) {
+            // Exponential descent: the same share of the altitude each frame
+            double altitude = 2.0e7 * pow(100.0 / 2.0e7, frame / (kFrames - 1.0));
+            terrain.plan(lys3d::Point3Dd(0.0, 0.0, settings.radius + settings.maxHeight + altitude), view_projection);
+            const lys3d::PlanetStats &stats = terrain.stats();
+            total_ms += stats.planMs;
+            worst_ms = std::max(worst_ms, static_cast<double>(stats.planMs));
+            uploads += stats.uploads;
+            lagging += stats.pending > 0 ? 1 : 0;
+            chunks = stats.chunksDrawn;
+
+            // Pace the loop like a 60 fps frame, giving the workers time
+            std::this_thread::sleep_until(start + std::chrono::microseconds(16667 * (frame + 1)));
+        }
+        printf("  %u workers: %6.3f ms/frame planning (worst %6.3f), %u meshes taken, %u frames with work "
+               "pending, %u chunks drawn at the end\n", workers, total_ms / kFrames, worst_ms, uploads, lagging,
+               chunks);
+    }
+    return 0;
+}
@@ -0,0 +1,252 @@
+/***************************************************
+* Benchmark - Naive vs fused half-res post chain   *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "FrameGraph.h"
+#include "PostProcess.h"
+#include "ShaderProgram.h"
+#include "VertexLayout.h"
+#include "WindowGLES2.h"
+
+#include <stdio.h>
+#include <chrono>
+
+#include "GLES2/gl2.h"
+#include <SDL2/SDL.h>
+#include "types.h"
+
+static const int32_t kWidth = 1280, kHeight = 720;
+static const int kFrames = 60;
+
+static const char* kVertex =
+    "attribute vec2 a_position;\n"
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "    v_texcoord = a_position * 0.5 + 0.5;\n"
+    "    gl_Position = vec4(a_position, 0.0, 1.0);\n"
+    "}\n";
+
+// A dark gradient with bright "thrusters" and "stars", stored at 1/4 range
+static const char* kSceneFS =
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "    vec2 p = v_texcoord * vec2(16.0, 9.0);\n"
+    "    float star = step(0.97, fract(sin(dot(floor(p * 8.0), vec2(12.9898, 78.233))) * 43758.5453));\n"
+    "    float thruster = 4.0 * max(0.0, 1.0 - 4.0 * length(fract(p) - 0.5));\n"
+    "    vec3 c = vec3(0.05, 0.07, 0.12) * v_texcoord.y + vec3(1.0, 0.6, 0.3) * thruster + star;\n"
+    "    gl_FragColor = vec4(c * 0.25, 1.0);\n"
+    "}\n";
+
+// The textbook chain: one full-resolution pass per effect
+static const char* kNaiveFS[7] = {
+    // Bright pass
+    "uniform sampler2D u_a;\n"
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "    vec3 c = texture2D(u_a, v_texcoord).rgb * 4.0;\n"
+    "    gl_FragColor = vec4(max(c - 0.8, 0.0) * 0.25, 1.0);\n"
+    "}\n",
+    // Horizontal and vertical 9-tap blur
+    "uniform sampler2D u_a;\n"
+    "uniform vec2 u_texel;\n"
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "    vec3 c = vec3(0.0);\n"
+    "    for (int i = -4; i <= 4; ++i)\n"
+    "        c += texture2D(u_a, v_texcoord + vec2(float(i) * u_texel.x, 0.0)).rgb;\n"
+    "    gl_FragColor = vec4(c / 9.0, 1.0);\n"
+    "}\n",
+    "uniform sampler2D u_a;\n"
+    "uniform vec2 u_texel;\n"
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "    vec3 c = vec3(0.0);\n"
+    "    for (int i = -4; i <= 4; ++i)\n"
+    "        c += texture2D(u_a, v_texcoord + vec2(0.0, float(i) * u_texel.y)).rgb;\n"
+    "    gl_FragColor = vec4(c / 9.0, 1.0);\n"
+    "}\n",
+    // Bloom composite
+    "uniform sampler2D u_a;\n"
+    "uniform sampler2D u_b;\n"
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "    gl_FragColor = texture2D(u_a, v_texcoord) + 0.6 * texture2D(u_b, v_texcoord);\n"
+    "}\n",
+    // Tonemap
+    "uniform sampler2D u_a;\n"
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "    vec3 c = texture2D(u_a, v_texcoord).rgb * 4.0;\n"
+    "    gl_FragColor = vec4((c * (2.51 * c + 0.03)) / (c * (2.43 * c + 0.59) + 0.14), 1.0);\n"
+    "}\n",
+    // Color grade
+    "uniform sampler2D u_a;\n"
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "    vec3 c = texture2D(u_a, v_texcoord).rgb;\n"
+    "    c = mix(vec3(dot(c, vec3(0.2126, 0.7152, 0.0722))), c, 1.1);\n"
+    "    gl_FragColor = vec4((c - 0.5) * 1.05 + 0.5, 1.0);\n"
+    "}\n",
+    // Vignette
+    "uniform sampler2D u_a;\n"
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "    float d = length((v_texcoord - 0.5) * vec2(1.78, 1.0));\n"
+    "    gl_FragColor = texture2D(u_a, v_texcoord) * (1.0 - 0.35 * smoothstep(0.5, 1.0, d));\n"
+    "}\n"
+};
+
+static const char* kNaiveNames[7] = {
+    "Bright pass", "Blur X", "Blur Y", "Bloom composite", "Tonemap", "Color grade", "Vignette"
+};
+
+struct Fullscreen {
+    lys3d::ShaderProgram program;
+    lys3d::FrameResource a;
+    lys3d::FrameResource b;
+    GLuint buffer;
+    lys3d::VertexLayout *layout;
+};
+
+static void drawFullscreen(const lys3d::FrameGraph &graph, void *user_data) {
+    Fullscreen *pass = static_cast<Fullscreen*>(user_data);
+    pass->program.use();
+    if (pass->b != 0) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, graph.texture(pass->b));
+        glActiveTexture(GL_TEXTURE0);
+    }
+    if (pass->a != 0) {
+        glBindTexture(GL_TEXTURE_2D, graph.texture(pass->a));
+        lys3d::Dimension2Di32 size = graph.size(pass->a);
+        glUniform2f(pass->program.uniformLocation("u_texel"), 1.0f / size.width(), 1.0f / size.height());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, pass->buffer);
+    pass->layout->apply();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    pass->layout->disable();
+}
+
+// Bytes sampled and written per frame, counting each input texel once
+static void printEstimate() {
+    uint64_t full = static_cast<uint64_t>(kWidth) * kHeight * 4, half = full / 4, quarter = full / 16;
+    uint64_t naive = 7 * full       // Writes
+                   + 7 * full       // Reads: bright, 2 blurs, composite scene, tonemap, grade, vignette
+                   + full;          // Composite bloom
+    uint64_t fused = (half + full)              // Threshold + downsample
+                   + (quarter + half)           // Downsample
+                   + (2 * half + quarter)       // Upsample, blended onto half
+                   + (full + full + half);      // Composite
+    printf("Estimated traffic at %dx%d: naive %.1f MB/frame in 7 full-res passes, "
+           "fused %.1f MB/frame in 1 full-res + 3 reduced passes\n", kWidth, kHeight,
+           naive / 1048576.0, fused / 1048576.0);
+}
+
+int main(void) {
+    printEstimate();
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        printf("SDL_Init failed, skipping the GPU benchmark\n");
+        return 0;
+    }
+    lys3d::WindowGLES2 window;
+    window.useFullscreen(false, false);
+    window.size(lys3d::Dimension2Di32(kWidth, kHeight));
+    if (!window.open()) {
+        printf("Could not open a GL window, skipping the GPU benchmark\n");
+        SDL_Quit();
+        return 0;
+    }
+    window.useVSync(false);
+
+    lys3d::VertexLayout layout;
+    layout.add(lys3d::kAttribPosition, 2, lys3d::VertexFormat::kFloat);
+    const float triangle[6] = {-1.0f, -1.0f, 3.0f, -1.0f, -1.0f, 3.0f};
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(triangle), triangle, GL_STATIC_DRAW);
+
+    Fullscreen scene, naive[7];
+    bool built = scene.program.build(kVertex, kSceneFS);
+    for (int i = 0; i < 7 && built; ++i) {
+        built = naive[i].program.build(kVertex, kNaiveFS[i]);
+        naive[i].program.use();
+        glUniform1i(naive[i].program.uniformLocation("u_a"), 0);
+        glUniform1i(naive[i].program.uniformLocation("u_b"), 1);
+    }
+    lys3d::PostSettings settings;
+    settings.effects = lys3d::kPostAllEffects;
+    settings.sceneRange = 4.0f;
+    lys3d::PostProcess post(settings);
+    if (!built || !post.prepare()) {
+        printf("Shader build failed:\n%s\n", post.log().c_str());
+        return 1;
+    }
+    scene.a = scene.b = 0;
+    scene.buffer = buffer;
+    scene.layout = &layout;
+    for (Fullscreen &pass : naive) {
+        pass.buffer = buffer;
+        pass.layout = &layout;
+    }
+    glDisable(GL_DEPTH_TEST);
+
+    lys3d::FrameGraph graph;
+    lys3d::Dimension2Di32 size = window.sizeInPixels();
+    const char *names[2] = {"naive", "fused"};
+    for (int method = 0; method < 2; ++method) {
+        double total_ms = 0.0;
+        uint32_t passes = 0;
+        for (int frame = -5; frame < kFrames; ++frame) {
+            graph.reset(size);
+            lys3d::FrameTargetDesc desc;
+            lys3d::FrameResource color = graph.create(desc);
+            uint32_t pass = graph.addPass("Scene", drawFullscreen, &scene);
+            graph.write(pass, color);
+            if (method == 0) {
+                lys3d::FrameResource t[6];
+                for (lys3d::FrameResource &target : t)
+                    target = graph.create(desc);
+                const lys3d::FrameResource inputs[7] = {color, t[0], t[1], color, t[3], t[4], t[5]};
+                for (int i = 0; i < 7; ++i) {
+                    naive[i].a = inputs[i];
+                    naive[i].b = (i == 3) ? t[2] : 0;
+                    pass = graph.addPass(kNaiveNames[i], drawFullscreen, &naive[i]);
+                    graph.read(pass, naive[i].a);
+                    if (naive[i].b != 0)
+                        graph.read(pass, naive[i].b);
+                    graph.write(pass, i < 6 ? t[i] : graph.backbuffer());
+                }
+            } else {
+                post.addPasses(graph, color, graph.backbuffer());
+            }
+            graph.compile();
+            glFinish();
+            auto start = std::chrono::steady_clock::now();
+            graph.execute();
+            glFinish();
+            auto end = std::chrono::steady_clock::now();
+            if (frame >= 0)
+                total_ms += std::chrono::duration<double, std::milli>(end - start).count();
+            passes = graph.stats().passes - 1;
+            window.update();
+        }
+        double frame_ms = total_ms / kFrames;
+        printf("%s: %u post passes/frame, %7.3f ms/frame (scene included), %6.3f ms/pass\n", names[method],
+               passes, frame_ms, frame_ms / (passes + 1));
+    }
+
+    glDeleteBuffers(1, &buffer);
+    post.destroy();
+    graph.destroy();
+    window.close();
+    SDL_Quit();
+    return 0;
+}
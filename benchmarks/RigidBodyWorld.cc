@@ -0,0 +1,118 @@
+/***************************************************
+* Benchmark - Rigid-body steps                     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "RigidBodyWorld.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "types.h"
+
+static const int kSteps = 300;
+static const float kStep = 1.0f / 60.0f;
+
+static uint32_t seed = 1;
+
+static float uniform(float low, float high) {
+    seed = seed * 1664525u + 1013904223u;
+    return low + (high - low) * ((seed >> 8) / 16777216.0f);
+}
+
+static void addGround(lys3d::RigidBodyWorld *world) {
+    lys3d::RigidBodyDesc ground;
+    ground.halfExtents = lys3d::Point3Df(200.0f, 0.5f, 200.0f);
+    ground.position = lys3d::Point3Df(0.0f, -0.5f, 0.0f);
+    ground.mass = 0.0f;
+    world->add(ground);
+}
+
+// 20 stacks of 10 crates, in a row
+static void addStacks(lys3d::RigidBodyWorld *world) {
+    for (int stack = 0; stack < 20; ++stack) {
+        for (int i = 0; i < 10; ++i) {
+            lys3d::RigidBodyDesc crate;
+            crate.position = lys3d::Point3Df(stack * 3.0f, 0.5f + i * 1.01f, 0.0f);
+            world->add(crate);
+        }
+    }
+}
+
+// 10k chunks of a ship blown apart above the ground, starting on a lattice
+// so they don't overlap, flying out faster the farther out they are
+static void addExplosion(lys3d::RigidBodyWorld *world) {
+    const float spacing = 0.7f;
+    const lys3d::Point3Df center(0.0f, 16.0f, 0.0f);
+    int count = 0;
+    for (int x = -12; x <= 12 && count < 10000; ++x) {
+        for (int y = -12; y <= 12 && count < 10000; ++y) {
+            for (int z = -12; z <= 12 && count < 10000; ++z) {
+                lys3d::Point3Df offset(x * spacing, y * spacing, z * spacing);
+                if (offset.length() > 9.5f)
+                    continue;
+                lys3d::RigidBodyDesc debris;
+                debris.shape = count++ % 4 ? lys3d::BodyShape::kBox : lys3d::BodyShape::kSphere;
+                debris.halfExtents = lys3d::Point3Df(uniform(0.05f, 0.3f), uniform(0.05f, 0.3f), uniform(0.05f, 0.3f));
+                debris.position = center + offset;
+                debris.velocity = offset * uniform(0.5f, 1.5f);
+                debris.angularVelocity = lys3d::Point3Df(uniform(-10.0f, 10.0f), uniform(-10.0f, 10.0f),
+                                                         uniform(-10.0f, 10.0f));
+                debris.mass = debris.halfExtents.x() * debris.halfExtents.y() * debris.halfExtents.z() * 8000.0f;
+                world->add(debris);
+            }
+        }
+    }
+}
+
+// Runs kSteps steps and prints the averages
+static void run(const char *name, uint32_t workers, void (*scene)(lys3d::RigidBodyWorld *)) {
+    lys3d::RigidBodySettings settings;
+    settings.workers = workers;
+    settings.cellSize = 0.5f;
+    lys3d::RigidBodyWorld world(settings);
+    seed = 1;
+    addGround(&world);
+    scene(&world);
+
+    double total_ms = 0.0, worst_ms = 0.0, broadphase_ms = 0.0, narrowphase_ms = 0.0, solver_ms = 0.0;
+    uint32_t most_contacts = 0, most_islands = 0, most_colors = 0, most_batches = 0;
+    for (int i = 0; i < kSteps; ++i) {
+        world.step(kStep);
+        const lys3d::RigidBodyStats &stats = world.stats();
+        total_ms += stats.stepMs;
+        worst_ms = std::max(worst_ms, static_cast<double>(stats.stepMs));
+        broadphase_ms += stats.broadphaseMs;
+        narrowphase_ms += stats.narrowphaseMs;
+        solver_ms += stats.solverMs;
+        most_contacts = std::max(most_contacts, stats.contacts);
+        most_islands = std::max(most_islands, stats.islands);
+        most_colors = std::max(most_colors, stats.colors);
+        most_batches = std::max(most_batches, stats.batches);
+    }
+    const lys3d::RigidBodyStats &stats = world.stats();
+    printf("  %-24s %u workers: %7.3f ms/step (worst %8.3f; pairs %6.3f, contacts %6.3f, solver %6.3f)\n", name,
+           workers, total_ms / kSteps, worst_ms, broadphase_ms / kSteps, narrowphase_ms / kSteps,
+           solver_ms / kSteps);
+    printf("  %-24s %u iterations, at most %u contacts, %u islands, %u colors, %u batches; %u of %u awake at "
+           "the end\n", "", stats.iterations, most_contacts, most_islands, most_colors, most_batches,
+           stats.awakeBodies, stats.bodies);
+}
+
+int main(void) {
+    uint32_t workers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    printf("Rigid bodies, %d steps of %.1f ms each:\n", kSteps, kStep * 1000.0f);
+    run("Crate stacks, 20 x 10", workers, addStacks);
+    run("Debris explosion, 10k", 0, addExplosion);
+    if (workers > 0)
+        run("Debris explosion, 10k", workers, addExplosion);
+    return 0;
+}
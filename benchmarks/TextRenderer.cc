@@ -0,0 +1,271 @@
+/***************************************************
+* Benchmark - SDF glyphs & batched text            *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Font.h"
+#include "TextRenderer.h"
+#include "WindowGLES2.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+
+#include "GLES2/gl2.h"
+#include <SDL2/SDL.h>
+#include "types.h"
+
+using lys3d::Vector;
+
+static const int32_t kWidth = 1280, kHeight = 720;
+static const float kTextSize = 16.0f;
+static const int kFrames = 60;
+// Glyphs for printable ASCII, then as many ideographs from U+4E00
+static const uint32_t kAscii = 95, kIdeographs = 3000;
+
+static uint32_t seed = 1;
+
+static float uniform(float low, float high) {
+    seed = seed * 1664525u + 1013904223u;
+    return low + (high - low) * ((seed >> 8) / 16777216.0f);
+}
+
+static void put16(Vector<uint8_t> *out, uint32_t value) {
+    out->push_back(static_cast<uint8_t>(value >> 8));
+    out->push_back(static_cast<uint8_t>(value));
+}
+
+static void put32(Vector<uint8_t> *out, uint32_t value) {
+    put16(out, value >> 16);
+    put16(out, value & 0xFFFF);
+}
+
+// A font of random blobs with holes, each an outer and an inner ring of
+// alternating on- and off-curve points; about as much outline as a letter
+static Vector<uint8_t> buildFont() {
+    const uint32_t glyphs = 1 + kAscii + kIdeographs, ring = 12;
+    Vector<uint8_t> glyf, loca, hmtx;
+    for (uint32_t g = 0; g < glyphs; ++g) {
+        put32(&loca, static_cast<uint32_t>(glyf.size()));
+        put16(&hmtx, 600);
+        put16(&hmtx, 0);
+        if (g == 0 || g == 1)
+            continue;  // .notdef and space
+        put16(&glyf, 2);
+        for (int i = 0; i < 4; ++i)
+            put16(&glyf, 0);
+        put16(&glyf, ring - 1);
+        put16(&glyf, ring * 2 - 1);
+        put16(&glyf, 0);
+        for (uint32_t i = 0; i < ring * 2; ++i)
+            glyf.push_back(i % 2 == 0 ? 1 : 0);
+        int16_t xs[ring * 2], ys[ring * 2];
+        for (uint32_t i = 0; i < ring * 2; ++i) {
+            bool outer = i < ring;
+            float angle = (outer ? 1.0f : -1.0f) * 6.2831853f * (i % ring) / ring;
+            float radius = outer ? uniform(220.0f, 300.0f) : uniform(80.0f, 120.0f);
+            xs[i] = static_cast<int16_t>(300.0f + radius * cosf(angle));
+            ys[i] = static_cast<int16_t>(350.0f + radius * sinf(angle));
+        }
+        for (const int16_t *values : {xs, ys}) {
+            int16_t last = 0;
+            for (uint32_t i = 0; i < ring * 2; ++i) {
+                put16(&glyf, static_cast<uint16_t>(values[i] - last));
+                last = values[i];
+            }
+        }
+    }
+    put32(&loca, static_cast<uint32_t>(glyf.size()));
+
+    Vector<uint8_t> head(54, 0), hhea(36, 0), maxp, cmap;
+    head[18] = 1000 >> 8;
+    head[19] = 1000 & 0xFF;
+    head[51] = 1;
+    hhea[4] = 800 >> 8;
+    hhea[5] = 800 & 0xFF;
+    hhea[6] = 0xFF;
+    hhea[7] = 0x38;
+    hhea[34] = static_cast<uint8_t>(glyphs >> 8);
+    hhea[35] = static_cast<uint8_t>(glyphs);
+    put32(&maxp, 0x00005000);
+    put16(&maxp, glyphs);
+    put16(&cmap, 0);
+    put16(&cmap, 1);
+    put16(&cmap, 3);
+    put16(&cmap, 10);
+    put32(&cmap, 12);
+    put16(&cmap, 12);
+    put16(&cmap, 0);
+    put32(&cmap, 16 + 2 * 12);
+    put32(&cmap, 0);
+    put32(&cmap, 2);
+    put32(&cmap, 0x20);
+    put32(&cmap, 0x20 + kAscii - 1);
+    put32(&cmap, 1);
+    put32(&cmap, 0x4E00);
+    put32(&cmap, 0x4E00 + kIdeographs - 1);
+    put32(&cmap, 1 + kAscii);
+
+    struct Table {
+        const char *tag;
+        const Vector<uint8_t> *data;
+    } tables[] = {{"cmap", &cmap}, {"glyf", &glyf}, {"head", &head}, {"hhea", &hhea},
+                  {"hmtx", &hmtx}, {"loca", &loca}, {"maxp", &maxp}};
+    const uint32_t count = sizeof(tables) / sizeof(tables[0]);
+    Vector<uint8_t> file;
+    put32(&file, 0x00010000);
+    put16(&file, count);
+    put16(&file, 0);
+    put16(&file, 0);
+    put16(&file, 0);
+    uint32_t offset = 12 + count * 16;
+    for (const Table &table : tables) {
+        file.insert(file.end(), table.tag, table.tag + 4);
+        put32(&file, 0);
+        put32(&file, offset);
+        put32(&file, static_cast<uint32_t>(table.data->size()));
+        offset += static_cast<uint32_t>((table.data->size() + 3) & ~3u);
+    }
+    for (const Table &table : tables) {
+        file.insert(file.end(), table.data->begin(), table.data->end());
+        while (file.size() % 4)
+            file.push_back(0);
+    }
+    return file;
+}
+
+// A screen of lines, in printable ASCII or random ideographs
+static Vector<lys3d::String> screen(bool ideographs) {
+    const uint32_t lines = static_cast<uint32_t>(kHeight / kTextSize), columns = ideographs ? 75 : 150;
+    Vector<lys3d::String> text(lines);
+    for (lys3d::String &line : text) {
+        for (uint32_t i = 0; i < columns; ++i) {
+            if (!ideographs) {
+                line += static_cast<char>(0x20 + static_cast<uint32_t>(uniform(0.0f, kAscii - 0.01f)));
+                continue;
+            }
+            uint32_t c = 0x4E00 + static_cast<uint32_t>(uniform(0.0f, kIdeographs - 0.01f));
+            line += static_cast<char>(0xE0 | c >> 12);
+            line += static_cast<char>(0x80 | (c >> 6 & 0x3F));
+            line += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+    return text;
+}
+
+static double since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Lays out lines, starting a batch every batch_lines
+static void layout(lys3d::TextRenderer *text, const Vector<lys3d::String> &lines, size_t batch_lines,
+                   uint64_t *glyphs, uint64_t *generated, uint64_t *evicted) {
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (i % batch_lines == 0)
+            text->begin(lys3d::Dimension2Di32(kWidth, kHeight));
+        text->text(0, lines[i].c_str(), 0.0f, i * kTextSize, kTextSize, 0xFFFFFFFF);
+        if ((i + 1) % batch_lines == 0 || i + 1 == lines.size()) {
+            *glyphs += text->stats().glyphs;
+            *generated += text->stats().generated;
+            *evicted += text->stats().evicted;
+        }
+    }
+}
+
+int main(void) {
+    Vector<uint8_t> file = buildFont();
+    lys3d::Font font;
+    if (!font.loadFromMemory(file.data(), file.size())) {
+        printf("Could not load the generated font\n");
+        return 1;
+    }
+
+    // Distance field generation, the cost of every atlas miss
+    lys3d::TextSettings settings;
+    Vector<uint8_t> pixels;
+    lys3d::GlyphBitmap bitmap;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t glyph = 2; glyph < font.glyphCount(); ++glyph)
+        font.renderSDF(glyph, settings.glyphSize, settings.spread, &pixels, &bitmap);
+    double ms = since(start);
+    printf("SDF generation: %u glyphs at %.0f px, %.1f us/glyph\n", font.glyphCount() - 2, settings.glyphSize,
+           ms * 1000.0 / (font.glyphCount() - 2));
+
+    // Layout alone: ASCII stays cached, while ideographs churn through an
+    // atlas holding a fifth of them. Without a GL context to draw with
+    // mid-batch, ideographs go a line per batch
+    const char *names[2] = {"ASCII", "ideographs"};
+    for (int ideographs = 0; ideographs < 2; ++ideographs) {
+        // A different screen each frame, so the cache misses
+        Vector<Vector<lys3d::String> > screens(ideographs ? kFrames : 1);
+        for (Vector<lys3d::String> &lines : screens)
+            lines = screen(ideographs != 0);
+        lys3d::TextRenderer text(settings);
+        text.addFont(&font);
+        uint64_t glyphs = 0, generated = 0, evicted = 0;
+        start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < kFrames; ++frame) {
+            const Vector<lys3d::String> &lines = screens[frame % screens.size()];
+            layout(&text, lines, ideographs ? 1 : lines.size(), &glyphs, &generated, &evicted);
+        }
+        ms = since(start);
+        printf("Layout, %s: %u glyphs/screen, %.0f glyphs/ms (%.1f generated, %.1f evicted per frame, "
+               "atlas of %u)\n", names[ideographs], static_cast<uint32_t>(glyphs / kFrames), glyphs / ms,
+               generated / static_cast<double>(kFrames), evicted / static_cast<double>(kFrames),
+               text.stats().capacity);
+    }
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        printf("SDL_Init failed, skipping the GPU benchmark\n");
+        return 0;
+    }
+    lys3d::WindowGLES2 window;
+    window.useFullscreen(false, false);
+    window.size(lys3d::Dimension2Di32(kWidth, kHeight));
+    if (!window.open()) {
+        printf("Could not open a GL window, skipping the GPU benchmark\n");
+        SDL_Quit();
+        return 0;
+    }
+    window.useVSync(false);
+
+    // Lay out and draw a full screen a frame. Ideographs overflow the atlas,
+    // so they're drawn whenever it fills
+    for (int ideographs = 0; ideographs < 2; ++ideographs) {
+        Vector<Vector<lys3d::String> > screens(ideographs ? kFrames : 1);
+        for (Vector<lys3d::String> &lines : screens)
+            lines = screen(ideographs != 0);
+        lys3d::TextRenderer text(settings);
+        text.addFont(&font);
+        uint64_t glyphs = 0, generated = 0, evicted = 0, draws = 0;
+        double total_ms = 0.0;
+        for (int frame = -5; frame < kFrames; ++frame) {
+            glClear(GL_COLOR_BUFFER_BIT);
+            glFinish();
+            uint64_t count = 0;
+            start = std::chrono::steady_clock::now();
+            const Vector<lys3d::String> &lines = screens[(frame + kFrames) % screens.size()];
+            layout(&text, lines, lines.size(), &count, &generated, &evicted);
+            text.end();
+            glFinish();
+            if (frame >= 0) {
+                total_ms += since(start);
+                glyphs += count;
+                draws += text.stats().drawCalls;
+            }
+            window.update();
+        }
+        printf("Layout + draw, %s: %u glyphs in %.1f draw call(s), %.3f ms/frame, %.0f glyphs/ms\n",
+               names[ideographs], static_cast<uint32_t>(glyphs / kFrames), draws / static_cast<double>(kFrames),
+               total_ms / kFrames, glyphs / total_ms);
+    }
+
+    window.close();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,165 @@
+/***************************************************
+* Benchmark - KTX/ETC1 vs PNG texture loading      *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Texture.h"
+#include "ResourceRegistry.h"
+#include "WindowGLES2.h"
+
+#include <stdio.h>
+#include <chrono>
+
+#include "GLES2/gl2.h"
+#include <SDL2/SDL.h>
+#include <SDL_image.h>
+#include "types.h"
+
+static const uint32_t kSize = 1024;
+static const int kIterations = 10;
+static const char* kKtxPath = "bench_texture.ktx";
+static const char* kPngPath = "bench_texture.png";
+
+// Smooth-ish differential-mode ETC1 blocks, so the PNG doesn't compress
+// unrealistically well or badly.
+static void makeBlocks(uint32_t width, uint32_t height, lys3d::Vector<uint8_t> *out) {
+    uint32_t seed = 12345;
+    for (uint32_t by = 0; by < (height + 3) / 4; ++by) {
+        for (uint32_t bx = 0; bx < (width + 3) / 4; ++bx) {
+            seed = seed * 1664525u + 1013904223u;
+            uint32_t r = (bx * 31 / ((width + 3) / 4)) & 0x1F;
+            uint32_t g = (by * 31 / ((height + 3) / 4)) & 0x1F;
+            uint32_t b = (seed >> 28) + 8;
+            uint32_t hi = (r << 27) | (g << 19) | (b << 11) | (((seed >> 8) & 0x3) << 5)
+                        | (((seed >> 10) & 0x3) << 2) | 0x2;
+            uint32_t lo = seed & 0xFFFF00FF;
+            for (int i = 3; i >= 0; --i)
+                out->push_back(static_cast<uint8_t>(hi >> (i * 8)));
+            for (int i = 3; i >= 0; --i)
+                out->push_back(static_cast<uint8_t>(lo >> (i * 8)));
+        }
+    }
+}
+
+static void pushU32(lys3d::Vector<uint8_t> *out, uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        out->push_back(static_cast<uint8_t>(value >> (i * 8)));
+}
+
+static bool writeFile(const char *path, const lys3d::Vector<uint8_t> &data) {
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr)
+        return false;
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return written;
+}
+
+static bool readFile(const char *path, lys3d::Vector<uint8_t> *data) {
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data->resize(length > 0 ? static_cast<size_t>(length) : 0);
+    bool read = fread(data->data(), 1, data->size(), file) == data->size();
+    fclose(file);
+    return read;
+}
+
+int main(void) {
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        printf("SDL_Init failed, skipping benchmark\n");
+        return 0;
+    }
+    lys3d::WindowGLES2 window;
+    window.useFullscreen(false, false);
+    window.size(lys3d::Dimension2Di32(640, 480));
+    if (!window.open()) {
+        printf("Could not open a GL window, skipping benchmark\n");
+        SDL_Quit();
+        return 0;
+    }
+
+    // ETC1 KTX with a full mip chain, and the same top level as a PNG
+    lys3d::Vector<uint8_t> ktx = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+    uint32_t levels = 0;
+    for (uint32_t size = kSize; size > 0; size >>= 1)
+        ++levels;
+    uint32_t header[13] = {0x04030201, 0, 1, 0, 0x8D64, GL_RGB, kSize, kSize, 0, 0, 1, levels, 0};
+    for (uint32_t value : header)
+        pushU32(&ktx, value);
+    lys3d::Vector<uint8_t> top;
+    for (uint32_t size = kSize; size > 0; size >>= 1) {
+        lys3d::Vector<uint8_t> blocks;
+        makeBlocks(size, size, &blocks);
+        if (size == kSize)
+            top = blocks;
+        pushU32(&ktx, static_cast<uint32_t>(blocks.size()));
+        ktx.insert(ktx.end(), blocks.begin(), blocks.end());
+    }
+
+    lys3d::Vector<uint8_t> rgb(kSize * kSize * 3);
+    lys3d::decodeETC1(top.data(), kSize, kSize, rgb.data());
+    SDL_Surface *surface = SDL_CreateRGBSurfaceFrom(rgb.data(), kSize, kSize, 24, kSize * 3,
+                                                    0x0000FF, 0x00FF00, 0xFF0000, 0);
+    bool saved = surface != nullptr && IMG_SavePNG(surface, kPngPath) == 0;
+    SDL_FreeSurface(surface);
+    if (!saved || !writeFile(kKtxPath, ktx)) {
+        printf("Could not write the test textures\n");
+        return 1;
+    }
+    lys3d::Vector<uint8_t> png_file;
+    readFile(kPngPath, &png_file);
+
+    printf("%ux%u texture; PNG %u KB, KTX (ETC1, %u levels) %u KB\n", kSize, kSize,
+           static_cast<unsigned>(png_file.size() / 1024), levels, static_cast<unsigned>(ktx.size() / 1024));
+
+    const char *names[4] = {"PNG (RGBA8)", "KTX (ETC1)", "KTX (decode 565)", "KTX (decode RGBA8)"};
+    for (int method = 0; method < 4; ++method) {
+        lys3d::Texture texture;
+        texture.forceDecode(method >= 2);
+        texture.decodeFormat(method == 3 ? lys3d::TextureDecodeFormat::kRGBA8
+                                         : lys3d::TextureDecodeFormat::kRGB565);
+        double total_ms = 0.0;
+        bool loaded = true;
+        for (int i = 0; i < kIterations && loaded; ++i) {
+            // Replaced textures are only queued for deletion; don't let them pile up
+            lys3d::ResourceRegistry::global().collect(true);
+            glFinish();
+            auto start = std::chrono::steady_clock::now();
+            if (method == 0) {
+                lys3d::Vector<uint8_t> data;
+                loaded = readFile(kPngPath, &data) && texture.loadImageFromMemory(data.data(), data.size());
+            } else {
+                loaded = texture.loadKTXFile(kKtxPath);
+            }
+            glFinish();
+            auto end = std::chrono::steady_clock::now();
+            total_ms += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+
+        if (!loaded) {
+            printf("%-20s unsupported\n", names[method]);
+            continue;
+        }
+        if (method == 1 && !texture.isCompressed()) {
+            printf("%-20s no ETC1 support, decoded on the CPU\n", names[method]);
+            continue;
+        }
+        printf("%-20s %8.2f ms/load, %2u levels, %8u KB VRAM\n", names[method], total_ms / kIterations,
+               texture.levels(), static_cast<unsigned>(texture.byteSize() / 1024));
+    }
+
+    remove(kKtxPath);
+    remove(kPngPath);
+    window.close();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,158 @@
+/***************************************************
+* Benchmark - Float vs compressed vertex layouts   *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "ShaderProgram.h"
+#include "VertexLayout.h"
+#include "WindowGLES2.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+
+#include "GLES2/gl2.h"
+#include <SDL2/SDL.h>
+#include "types.h"
+
+static const char* kFloatVertex =
+    "attribute vec3 a_position;\n"
+    "attribute vec3 a_normal;\n"
+    "attribute vec2 a_texcoord;\n"
+    "varying vec3 v_color;\n"
+    "void main() {\n"
+    "    v_color = a_normal * 0.5 + 0.5 + vec3(a_texcoord, 0.0) * 0.01;\n"
+    "    gl_Position = vec4(a_position * 0.9, 1.0);\n"
+    "}\n";
+
+static const char* kCompressedVertex =
+    "attribute vec4 a_position;\n"
+    "attribute vec2 a_normal;\n"
+    "attribute vec2 a_texcoord;\n"
+    "uniform vec3 u_posScale;\n"
+    "uniform vec3 u_posBias;\n"
+    "varying vec3 v_color;\n"
+    "void main() {\n"
+    "    v_color = lysDecodeNormal(a_normal) * 0.5 + 0.5 + vec3(a_texcoord, 0.0) * 0.01;\n"
+    "    gl_Position = vec4(lysDecodePosition(a_position.xyz, u_posScale, u_posBias) * 0.9, 1.0);\n"
+    "}\n";
+
+static const char* kFragment =
+    "varying vec3 v_color;\n"
+    "void main() {\n"
+    "    gl_FragColor = vec4(v_color, 1.0);\n"
+    "}\n";
+
+int main(void) {
+    const int kRings = 254, kSegments = 254, kDrawsPerFrame = 50, kFrames = 60;
+
+    // Unit sphere with 255 * 255 vertices
+    lys3d::Vector<lys3d::MeshVertex> vertices;
+    lys3d::Vector<uint16_t> indices;
+    for (int r = 0; r <= kRings; ++r) {
+        for (int s = 0; s <= kSegments; ++s) {
+            float theta = 3.14159265f * r / kRings, phi = 6.28318531f * s / kSegments;
+            lys3d::MeshVertex v;
+            v.normal[0] = sinf(theta) * cosf(phi);
+            v.normal[1] = cosf(theta);
+            v.normal[2] = sinf(theta) * sinf(phi);
+            for (int k = 0; k < 3; ++k)
+                v.position[k] = v.normal[k];
+            v.uv[0] = static_cast<float>(s) / kSegments;
+            v.uv[1] = static_cast<float>(r) / kRings;
+            vertices.push_back(v);
+        }
+    }
+    for (int r = 0; r < kRings; ++r) {
+        for (int s = 0; s < kSegments; ++s) {
+            uint16_t a = static_cast<uint16_t>(r * (kSegments + 1) + s);
+            uint16_t b = static_cast<uint16_t>(a + kSegments + 1);
+            indices.insert(indices.end(), {a, b, static_cast<uint16_t>(a + 1),
+                                           static_cast<uint16_t>(a + 1), b, static_cast<uint16_t>(b + 1)});
+        }
+    }
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        printf("SDL_Init failed, skipping benchmark\n");
+        return 0;
+    }
+    lys3d::WindowGLES2 window;
+    window.useFullscreen(false, false);
+    window.size(lys3d::Dimension2Di32(1280, 720));
+    if (!window.open()) {
+        printf("Could not open a GL window, skipping benchmark\n");
+        SDL_Quit();
+        return 0;
+    }
+    window.useVSync(false);
+
+    lys3d::QuantizedVertices quantized;
+    lys3d::VertexQuantizer quantizer;
+    quantizer.quantize(vertices, &quantized);
+
+    GLuint buffers[3];
+    glGenBuffers(3, buffers);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(lys3d::MeshVertex), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ARRAY_BUFFER, quantized.data.size(), quantized.data.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[2]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+
+    lys3d::ShaderProgram programs[2];
+    bool built = programs[0].build(kFloatVertex, kFragment)
+              && programs[1].build(lys3d::String(lys3d::kVertexDecodeGLSL) + kCompressedVertex, kFragment);
+    if (!built) {
+        printf("Shader build failed:\n%s%s\n", programs[0].log().c_str(), programs[1].log().c_str());
+        return 1;
+    }
+
+    const char *names[2] = {"float", "compressed"};
+    lys3d::VertexLayout layouts[2] = {lys3d::VertexLayout::full(), quantized.layout};
+    size_t vbo_bytes[2] = {vertices.size() * sizeof(lys3d::MeshVertex), quantized.data.size()};
+    glEnable(GL_DEPTH_TEST);
+
+    printf("%u vertices, %u triangles, %d draws per frame\n", static_cast<unsigned>(vertices.size()),
+           static_cast<unsigned>(indices.size() / 3), kDrawsPerFrame);
+    for (int i = 0; i < 2; ++i) {
+        programs[i].use();
+        if (i == 1) {
+            glUniform3fv(programs[i].uniformLocation("u_posScale"), 1, quantized.positionScale);
+            glUniform3fv(programs[i].uniformLocation("u_posBias"), 1, quantized.positionBias);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+        layouts[i].apply();
+
+        double total_ms = 0.0;
+        for (int frame = -5; frame < kFrames; ++frame) {
+            glFinish();
+            auto start = std::chrono::steady_clock::now();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            for (int d = 0; d < kDrawsPerFrame; ++d)
+                glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_SHORT, nullptr);
+            glFinish();
+            auto end = std::chrono::steady_clock::now();
+            if (frame >= 0)
+                total_ms += std::chrono::duration<double, std::milli>(end - start).count();
+            window.update();
+        }
+        layouts[i].disable();
+
+        double ms = total_ms / kFrames;
+        printf("%-10s stride %2u B, VBO %8u B, %7.3f ms/frame, %7.1f Mverts/s\n", names[i],
+               layouts[i].stride(), static_cast<unsigned>(vbo_bytes[i]), ms,
+               indices.size() * static_cast<double>(kDrawsPerFrame) / (ms * 1000.0));
+    }
+
+    glDeleteBuffers(3, buffers);
+    programs[0].destroy();
+    programs[1].destroy();
+    window.close();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,273 @@
+/***************************************************
+* Animation.h: Skeletons and compressed clips      *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_ANIMATION_H_
+#define LYS3D_ANIMATION_H_
+
+#include <stddef.h>
+
+#include "types.h"
+
+namespace lys3d {
+
+/** A joint's transform relative to its parent. */
+struct JointPose {
+    /** Unit quaternion (x, y, z, w). */
+    float rotation[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    float translation[3] = {0.0f, 0.0f, 0.0f};
+    /** Uniform scale. */
+    float scale = 1.0f;
+};
+
+/** The local transforms of every joint of a skeleton.
+ * Stored as separate arrays, padded to a multiple of 4 joints, so sampling \
+ * and blending work on four joints at a time.
+ */
+class LYS_API SkeletonPose {
+  public:
+    /** Rotation x, y, z and w, translation x, y and z, and scale. */
+    static const uint32_t kStreams = 8;
+
+    /** Default constructor. Creates a pose with no joints. */
+    SkeletonPose() = default;
+    ~SkeletonPose() = default;
+
+    /** Set the number of joints. New joints get the identity transform.
+     * \param joint_count The joint count.
+     */
+    void resize(uint32_t joint_count);
+
+    /** Get the number of joints.
+     * \returns The joint count.
+     */
+    uint32_t jointCount() const {
+        return jointCount_;
+    }
+
+    /** Get the number of joints including padding.
+     * \returns The joint count rounded up to a multiple of 4.
+     */
+    uint32_t paddedCount() const {
+        return paddedCount_;
+    }
+
+    /** Get one component array.
+     * \param index 0-3 for the rotation, 4-6 for the translation, 7 for the \
+     * scale.
+     * \returns paddedCount() values.
+     */
+    float* stream(uint32_t index) {
+        return &data_[static_cast<size_t>(index) * paddedCount_];
+    }
+    const float* stream(uint32_t index) const {
+        return &data_[static_cast<size_t>(index) * paddedCount_];
+    }
+
+    /** Get a joint's transform.
+     * \param joint The joint index.
+     * \returns The transform.
+     */
+    JointPose joint(uint32_t joint) const;
+
+    /** Set a joint's transform.
+     * \param joint The joint index.
+     * \param pose The transform.
+     */
+    void joint(uint32_t joint, const JointPose &pose);
+
+    /** Blend two poses of the same skeleton, normalizing the interpolated \
+     * rotations (nlerp) along the shortest path.
+     * \param a The pose at weight 0.
+     * \param b The pose at weight 1.
+     * \param weight How much of b to take, from 0 to 1.
+     * \param out Receives the blend; may be a or b.
+     */
+    static void blend(const SkeletonPose &a, const SkeletonPose &b, float weight, SkeletonPose *out);
+
+  private:
+    uint32_t jointCount_ = 0;
+    uint32_t paddedCount_ = 0;
+    Vector<float> data_;
+};
+
+/** A joint hierarchy and its bind pose.
+ * Joints are stored parents first. Skinning matrices come out in 4x3 form: \
+ * three rows of (rotation/scale, translation) per joint, 12 floats, \
+ * uploaded as three vec4 uniforms.
+ */
+class LYS_API Skeleton {
+  public:
+    /** Default constructor. Creates a skeleton with no joints. */
+    Skeleton() = default;
+    ~Skeleton() = default;
+
+    /** Append a joint.
+     * \param parent The parent's index (it must already exist), or -1 for \
+     * a root.
+     * \param bind_pose The joint's transform relative to its parent in the \
+     * bind pose, which the mesh was skinned in.
+     * \returns The joint index.
+     */
+    uint32_t add(int32_t parent, const JointPose &bind_pose);
+
+    /** Get the number of joints.
+     * \returns The joint count.
+     */
+    uint32_t jointCount() const {
+        return static_cast<uint32_t>(parents_.size());
+    }
+
+    /** Get a joint's parent.
+     * \param joint The joint index.
+     * \returns The parent's index, or -1 for a root.
+     */
+    int32_t parent(uint32_t joint) const {
+        return parents_[joint];
+    }
+
+    /** Get the bind pose.
+     * \returns The local transforms the mesh was skinned in.
+     */
+    const SkeletonPose& bindPose() const {
+        return bindPose_;
+    }
+
+    /** Compute the skinning matrices for a pose: each joint's model \
+     * transform times its inverse bind transform.
+     * \param pose Local transforms, e.g. from AnimationClip::sample().
+     * \param palette Receives 12 floats (3 rows of 4) per joint.
+     */
+    void palette(const SkeletonPose &pose, float *palette) const;
+
+  private:
+    Vector<int32_t> parents_;
+    SkeletonPose bindPose_;
+    Vector<float> inverseBind_;
+};
+
+/** An uncompressed animation: every joint's transform at a fixed rate. */
+struct RawAnimation {
+    /** Samples per second. */
+    float sampleRate = 30.0f;
+    /** Number of joints in each frame. */
+    uint32_t jointCount = 0;
+    /** frameCount() * jointCount transforms, frame by frame. */
+    Vector<JointPose> frames;
+
+    /** Get the number of frames.
+     * \returns The frame count.
+     */
+    uint32_t frameCount() const {
+        return jointCount > 0 ? static_cast<uint32_t>(frames.size() / jointCount) : 0;
+    }
+};
+
+/** How far compression may stray from the raw animation. */
+struct AnimationTolerance {
+    /** Largest rotation error, in radians. */
+    float rotation = 0.002f;
+    /** Largest translation error, in model units. */
+    float translation = 0.001f;
+    /** Largest scale error. */
+    float scale = 0.001f;
+};
+
+/** A compressed animation clip.
+ * Rotations are stored as the three smallest quaternion components at 15 \
+ * bits each (6 bytes a key); translations and scales as 16-bit values \
+ * within each track's range. Each track keeps only the keys that linear \
+ * interpolation between its neighbours can't reproduce within the \
+ * tolerance, so constant tracks shrink to one key and smooth motion to a \
+ * few.
+ */
+class LYS_API AnimationClip {
+  public:
+    /** Default constructor. Creates an empty clip. */
+    AnimationClip() = default;
+    ~AnimationClip() = default;
+
+    /** Compress an animation, replacing the clip's contents.
+     * \param raw The animation, at least one frame.
+     * \param tolerance The largest errors allowed per joint.
+     * \returns False if the animation is empty or too long (65536 frames \
+     * at most).
+     */
+    bool compress(const RawAnimation &raw, const AnimationTolerance &tolerance = AnimationTolerance());
+
+    /** Get the number of joints.
+     * \returns The joint count.
+     */
+    uint32_t jointCount() const {
+        return static_cast<uint32_t>(rotationTracks_.size());
+    }
+
+    /** Get the clip length.
+     * \returns The duration in seconds.
+     */
+    float duration() const {
+        return duration_;
+    }
+
+    /** Get the memory used by the compressed data.
+     * \returns The size in bytes.
+     */
+    size_t memoryUsage() const;
+
+    /** Get the number of keys kept.
+     * \returns Rotation, translation and scale keys of all tracks.
+     */
+    size_t keyCount() const {
+        return rotationFrames_.size() + translationFrames_.size() + scaleFrames_.size();
+    }
+
+    /** Sample the clip.
+     * \param time The time in seconds.
+     * \param loop True to wrap around at the end, false to hold the last \
+     * frame.
+     * \param pose Receives the local transforms; resized to jointCount().
+     */
+    void sample(float time, bool loop, SkeletonPose *pose) const;
+
+  private:
+    struct Track {
+        uint32_t first;
+        uint32_t count;
+        float min[3];
+        float extent[3];
+    };
+
+    float duration_ = 0.0f;
+    float sampleRate_ = 30.0f;
+    uint32_t lastFrame_ = 0;
+    Vector<Track> rotationTracks_;
+    Vector<Track> translationTracks_;
+    Vector<Track> scaleTracks_;
+    Vector<uint16_t> rotationFrames_;
+    Vector<uint16_t> rotationKeys_;
+    Vector<uint16_t> translationFrames_;
+    Vector<uint16_t> translationKeys_;
+    Vector<uint16_t> scaleFrames_;
+    Vector<uint16_t> scaleKeys_;
+};
+
+/** Pack a unit quaternion into 48 bits: the three smallest components at \
+ * 15 bits each, plus the index of the largest.
+ * \param q The quaternion (x, y, z, w).
+ * \param packed Receives three 16-bit words.
+ */
+LYS_API void packQuaternion(const float q[4], uint16_t packed[3]);
+
+/** Unpack a quaternion written by packQuaternion().
+ * \param packed The three 16-bit words.
+ * \param q Receives the unit quaternion (x, y, z, w).
+ */
+LYS_API void unpackQuaternion(const uint16_t packed[3], float q[4]);
+}
+#endif // LYS3D_ANIMATION_H_
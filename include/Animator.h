@@ -0,0 +1,135 @@
+/***************************************************
+* Animator.h: Animated characters and skinning     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_ANIMATOR_H_
+#define LYS3D_ANIMATOR_H_
+
+#include "types.h"
+#include "Animation.h"
+
+namespace lys3d {
+
+/** Most joints a skinned draw can use. GLES2 only guarantees 128 vertex \
+ * uniform vectors; 40 joints take 120 of them in 4x3 form, leaving 8 for \
+ * the view-projection matrix and the rest.
+ */
+const uint32_t kMaxSkinJoints = 40;
+
+/** What one animated character is playing. */
+struct AnimationState {
+    /** The main clip; the character holds its bind pose without one. */
+    const AnimationClip *clip = nullptr;
+    /** A second clip blended over the first (e.g. a run under a walk, or \
+     * the next clip of a crossfade), or nullptr.
+     */
+    const AnimationClip *blendClip = nullptr;
+    /** Playback positions, in seconds. */
+    float time = 0.0f;
+    float blendTime = 0.0f;
+    /** How much of blendClip to take, from 0 to 1. */
+    float blendWeight = 0.0f;
+    /** Playback speed; 1 is normal. */
+    float speed = 1.0f;
+    /** True to wrap around at the end of the clips. */
+    bool loop = true;
+};
+
+/** Counters from the last Animator::update(). */
+struct AnimatorStats {
+    /** Characters updated. */
+    uint32_t characters = 0;
+    /** Clips sampled (one or two per character). */
+    uint32_t samples = 0;
+    /** Time update() took, in milliseconds. */
+    float updateMs = 0.0f;
+};
+
+/** Plays animations on many characters, sampling, blending and building \
+ * skinning matrices on worker threads.
+ * Each update() advances every character's clips, samples them (four \
+ * joints at a time with SSE2), blends them and writes the character's \
+ * palette. Characters are handed out to the workers in small batches; \
+ * the calling thread takes batches too. Draw with the palette uploaded by \
+ * uploadPalette() and a vertex shader using kSkinningGLSL.
+ */
+class LYS_API Animator {
+  public:
+    /** Constructor.
+     * \param workers Worker threads to start; 0 updates everything on the \
+     * calling thread.
+     */
+    explicit Animator(uint32_t workers = 2);
+
+    /** Destructor. Stops the worker threads. */
+    ~Animator();
+
+    Animator(const Animator& other) = delete;
+    Animator& operator=(const Animator& other) = delete;
+
+    /** Add a character.
+     * \param skeleton Its skeleton; must outlive the animator.
+     * \returns The character index.
+     */
+    uint32_t add(const Skeleton *skeleton);
+
+    /** Remove every character. */
+    void clear();
+
+    /** Get the number of characters.
+     * \returns The character count.
+     */
+    uint32_t count() const;
+
+    /** Get what a character is playing; change it freely between updates.
+     * \param character The character index.
+     * \returns The animation state.
+     */
+    AnimationState& state(uint32_t character);
+    const AnimationState& state(uint32_t character) const;
+
+    /** Advance and pose every character.
+     * \param seconds Time since the last update.
+     */
+    void update(float seconds);
+
+    /** Get a character's skinning matrices from the last update().
+     * \param character The character index.
+     * \returns 12 floats (three rows of four) per joint of its skeleton.
+     */
+    const float* palette(uint32_t character) const;
+
+    /** Get the counters from the last update().
+     * \returns The statistics.
+     */
+    const AnimatorStats& stats() const;
+
+    /** Upload a palette to a vec4 array uniform, as three vectors per joint.
+     * \param location The location of the uniform (e.g. "u_joints").
+     * \param palette Skinning matrices, from palette().
+     * \param joint_count Number of joints; at most kMaxSkinJoints.
+     */
+    static void uploadPalette(int32_t location, const float *palette, uint32_t joint_count);
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+
+/** GLSL for skinning with uploadPalette() matrices.
+ * Declares uniform vec4 u_joints[LYS_SKIN_JOINTS * 3] (LYS_SKIN_JOINTS \
+ * defaults to kMaxSkinJoints; define it lower to save uniforms) and \
+ * mat4 lysSkinMatrix(vec4 joints, vec4 weights), which is transposed: \
+ * apply it as vec4(a_position, 1.0) * m. a_joints holds joint indices as \
+ * normalized unsigned bytes (kAttribJoints) and a_weights the weights \
+ * (kAttribWeights).
+ */
+extern LYS_API const char* kSkinningGLSL;
+}
+#endif // LYS3D_ANIMATOR_H_
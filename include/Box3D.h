@@ -0,0 +1,139 @@
+/***************************************************
+* Box3D.h: Axis-aligned 3D bounding box templates  *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_BOX3D_H_
+#define LYS3D_BOX3D_H_
+
+#include "types.h"
+#include "Point3D.h"
+
+namespace lys3d {
+
+/** Expresses an axis-aligned 3-dimensional box. */
+template <typename T>
+class Box3D {
+  public:
+    /** Default constructor.
+     * Initializes both corners to the origin.
+     */
+    Box3D() = default;
+
+    /** Parameterized constructor that sets the corners to the given values.
+     * \param min The corner with the smallest coordinates.
+     * \param max The corner with the largest coordinates.
+     */
+    Box3D(const Point3D<T> &min, const Point3D<T> &max) {
+      min_ = min;
+      max_ = max;
+    }
+
+    ~Box3D() = default;
+
+    /** Build a box from a center point and half-extents.
+     * \param center The center of the box.
+     * \param half_extents Half of the box size on each axis.
+     * \returns The new box.
+     */
+    static Box3D fromCenter(const Point3D<T> &center, const Point3D<T> &half_extents) {
+      return Box3D(center - half_extents, center + half_extents);
+    }
+
+    /** Get the minimum corner.
+     * \returns The corner with the smallest coordinates.
+     */
+    const Point3D<T>& min() const {
+      return min_;
+    }
+
+    /** Set the minimum corner.
+     * \param new_min The new minimum corner.
+     */
+    void min(const Point3D<T> &new_min) {
+      min_ = new_min;
+    }
+
+    /** Get the maximum corner.
+     * \returns The corner with the largest coordinates.
+     */
+    const Point3D<T>& max() const {
+      return max_;
+    }
+
+    /** Set the maximum corner.
+     * \param new_max The new maximum corner.
+     */
+    void max(const Point3D<T> &new_max) {
+      max_ = new_max;
+    }
+
+    /** Get the center of the box.
+     * \returns The midpoint between both corners.
+     */
+    Point3D<T> center() const {
+      return (min_ + max_) * static_cast<T>(0.5);
+    }
+
+    /** Get the half-size of the box on each axis.
+     * \returns Half of (max - min).
+     */
+    Point3D<T> halfExtents() const {
+      return (max_ - min_) * static_cast<T>(0.5);
+    }
+
+    /** Grow the box so that it contains a point.
+     * \param point The point to include.
+     */
+    void expand(const Point3D<T> &point) {
+      min_ = Point3D<T>(point.x() < min_.x() ? point.x() : min_.x(),
+                        point.y() < min_.y() ? point.y() : min_.y(),
+                        point.z() < min_.z() ? point.z() : min_.z());
+      max_ = Point3D<T>(point.x() > max_.x() ? point.x() : max_.x(),
+                        point.y() > max_.y() ? point.y() : max_.y(),
+                        point.z() > max_.z() ? point.z() : max_.z());
+    }
+
+    /** Check whether this box overlaps another one.
+     * Touching boxes count as overlapping.
+     * \param other The box to test against.
+     * \returns True if the boxes share any volume (or a face), false otherwise.
+     */
+    bool intersects(const Box3D &other) const {
+      return min_.x() <= other.max_.x() && max_.x() >= other.min_.x()
+          && min_.y() <= other.max_.y() && max_.y() >= other.min_.y()
+          && min_.z() <= other.max_.z() && max_.z() >= other.min_.z();
+    }
+
+    /** Check whether a point lies inside the box (inclusive).
+     * \param point The point to test.
+     * \returns True if the point is inside or on the surface of the box.
+     */
+    bool contains(const Point3D<T> &point) const {
+      return point.x() >= min_.x() && point.x() <= max_.x()
+          && point.y() >= min_.y() && point.y() <= max_.y()
+          && point.z() >= min_.z() && point.z() <= max_.z();
+    }
+
+    bool operator==(const Box3D &other) const {
+      return min_ == other.min_ && max_ == other.max_;
+    }
+
+    bool operator!=(const Box3D &other) const {
+      return !(*this == other);
+    }
+
+  private:
+    Point3D<T> min_, max_;
+};
+
+using Box3Di = Box3D<int>;
+using Box3Df = Box3D<float>;
+using Box3Dd = Box3D<double>;
+}
+#endif // LYS3D_BOX3D_H_
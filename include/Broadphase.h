@@ -0,0 +1,182 @@
+/***************************************************
+* Broadphase.h: Collision pair finding             *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_BROADPHASE_H_
+#define LYS3D_BROADPHASE_H_
+
+#include "types.h"
+#include "Box3D.h"
+
+namespace lys3d {
+
+/** How a Broadphase proxy is expected to move, which picks the structure \
+ * it's kept in.
+ */
+enum class ProxyMotion : uint8_t {
+    kStatic = 0,  ///< Rarely moves: sweep-and-prune, pairs cached
+    kDynamic      ///< Moves most frames: spatial hash, pairs found each update
+};
+
+/** Two overlapping proxies, a < b. */
+struct BroadphasePair {
+    uint32_t a;
+    uint32_t b;
+};
+
+/** Construction-time settings of a Broadphase. */
+struct BroadphaseSettings {
+    /** Size of the finest spatial hash cells. */
+    float cellSize = 1.0f;
+    /** Spatial hash levels, from 1 to 8, each with cells twice the size of \
+     * the last. A proxy goes in the finest level whose cells are at least \
+     * as large as it is. Static proxies larger than the coarsest cells are \
+     * kept in a list of their own.
+     */
+    uint32_t levels = 6;
+    /** Worker threads; the calling thread works too. */
+    uint32_t workers = 3;
+};
+
+/** What the last update() did. */
+struct BroadphaseStats {
+    uint32_t staticProxies = 0;
+    uint32_t dynamicProxies = 0;
+    /** Static proxies added, moved or removed, whose pairs were redone. */
+    uint32_t staticChanged = 0;
+    /** Cell entries in the dynamic spatial hash. */
+    uint32_t hashEntries = 0;
+    /** Overlapping pairs, and how many of them appeared or disappeared \
+     * since the last update.
+     */
+    uint32_t pairs = 0;
+    uint32_t added = 0;
+    uint32_t removed = 0;
+    /** Time update() took, in milliseconds. */
+    float updateMs = 0.0f;
+};
+
+/** Finds the pairs of overlapping bounding boxes among many proxies, for a \
+ * narrowphase to test in detail.
+ * Static proxies are kept in a sweep-and-prune list sorted along X, tested \
+ * four boxes at a time with SSE2 when available. Their pairs are cached: \
+ * an update only sorts the proxies that moved back into place (an \
+ * insertion sort, as few move far) and only queries those again, so a \
+ * mostly static scene costs next to nothing. Static proxies larger than \
+ * the coarsest hash cells are kept out of the list, so the sweep never has \
+ * to reach back past one, and are tested on their own.
+ * Dynamic proxies, such as projectiles, go in a multi-level spatial hash \
+ * rebuilt every update: each is entered only in the cells it touches of \
+ * its own level, and the entries are radix sorted by bucket, each level \
+ * having its own buckets. Pairs of the same level are read from shared \
+ * cells; each proxy then looks up the cells it touches in the coarser \
+ * levels in use to find larger ones. Static proxies are found the same \
+ * way in a second hash of them, rebuilt only when they change: dynamic \
+ * proxies look up the static levels at least as coarse as their own, and \
+ * static ones the coarser dynamic levels.
+ * Finding, sorting, merging and diffing the pairs are split across the \
+ * threads; only re-sorting the static list and small per-thread \
+ * bookkeeping run on the calling thread.
+ * Pairs come out as one flat array sorted by proxy, easy to split across \
+ * threads, along with the pairs added and removed since the last update.
+ *
+ * Typical frame:
+ * \code
+ * for (Projectile &p : projectiles)
+ *     broadphase.move(p.proxy, p.bounds());
+ * broadphase.update();
+ * for (const BroadphasePair &pair : broadphase.pairs())
+ *     narrowphase(broadphase.userData(pair.a), broadphase.userData(pair.b));
+ * \endcode
+ */
+class LYS_API Broadphase {
+  public:
+    /** Constructor. Starts the worker threads.
+     * \param settings The hash and thread settings.
+     */
+    explicit Broadphase(const BroadphaseSettings &settings = BroadphaseSettings());
+
+    /** Destructor. Stops the worker threads. */
+    ~Broadphase();
+
+    Broadphase(const Broadphase& other) = delete;
+    Broadphase& operator=(const Broadphase& other) = delete;
+
+    /** Get the settings.
+     * \returns The settings, with levels clamped.
+     */
+    const BroadphaseSettings& settings() const;
+
+    /** Add a proxy. Its pairs are found by the next update().
+     * \param bounds The proxy's bounding box.
+     * \param motion Whether it's static or dynamic.
+     * \param user_data A value to hand back with userData().
+     * \returns The proxy's id; ids of removed proxies are reused.
+     */
+    uint32_t add(const Box3Df &bounds, ProxyMotion motion, uint32_t user_data = 0);
+
+    /** Remove a proxy. Its pairs disappear at the next update().
+     * \param proxy The proxy's id.
+     */
+    void remove(uint32_t proxy);
+
+    /** Move a proxy. Static proxies that don't change their box cost nothing.
+     * \param proxy The proxy's id.
+     * \param bounds The new bounding box.
+     */
+    void move(uint32_t proxy, const Box3Df &bounds);
+
+    /** Get a proxy's bounding box.
+     * \param proxy The proxy's id.
+     * \returns The box last given to add() or move().
+     */
+    const Box3Df& bounds(uint32_t proxy) const;
+
+    /** Get a proxy's user data.
+     * \param proxy The proxy's id.
+     * \returns The value given to add().
+     */
+    uint32_t userData(uint32_t proxy) const;
+
+    /** Get a proxy's motion.
+     * \param proxy The proxy's id.
+     * \returns Whether it's static or dynamic.
+     */
+    ProxyMotion motion(uint32_t proxy) const;
+
+    /** Find the overlapping pairs for the current boxes. */
+    void update();
+
+    /** Get the overlapping pairs found by the last update().
+     * \returns The pairs, sorted by a, then b.
+     */
+    const Vector<BroadphasePair>& pairs() const;
+
+    /** Get the pairs that started overlapping in the last update().
+     * \returns The pairs, sorted.
+     */
+    const Vector<BroadphasePair>& added() const;
+
+    /** Get the pairs that stopped overlapping (or lost a proxy) in the last \
+     * update().
+     * \returns The pairs, sorted.
+     */
+    const Vector<BroadphasePair>& removed() const;
+
+    /** Get the last update's statistics.
+     * \returns The statistics.
+     */
+    const BroadphaseStats& stats() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_BROADPHASE_H_
@@ -0,0 +1,189 @@
+/***************************************************
+* DebugDraw.h: Immediate-mode debug shapes         *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_DEBUGDRAW_H_
+#define LYS3D_DEBUGDRAW_H_
+
+#include "types.h"
+#include "Box3D.h"
+#include "Point3D.h"
+
+namespace lys3d {
+
+/** Whether a debug shape is hidden by the scene in front of it. */
+enum class DebugDepth : uint8_t {
+    kTested,   ///< Depth tested against the scene, like normal geometry
+    kOverlay   ///< Drawn over everything
+};
+
+/** The four batches shapes are sorted into, in drawing order: lines go \
+ * over the (often translucent) triangles, and overlays over both.
+ */
+enum DebugBatch : uint32_t {
+    kDebugTriangles = 0,
+    kDebugLines,
+    kDebugTrianglesOverlay,
+    kDebugLinesOverlay,
+    kDebugBatchCount
+};
+
+/** A debug vertex: a world-space position and a color. */
+struct DebugVertex {
+    float x, y, z;
+    uint8_t color[4];
+};
+
+/** What the last collect() gathered. */
+struct DebugDrawStats {
+    /** Vertices of lines and of triangles, both depth modes together. */
+    uint32_t lineVertices = 0;
+    uint32_t triangleVertices = 0;
+    /** Threads that have drawn at least once. */
+    uint32_t threads = 0;
+    /** Draw calls made by the last draw(). */
+    uint32_t drawCalls = 0;
+};
+
+/** Collects lines, boxes, spheres, frusta and the like from anywhere in \
+ * the engine, for drawing over a frame.
+ * Any thread can add shapes at any time without taking a lock: each \
+ * thread appends to its own buffer, and collect() switches the threads \
+ * over to a second set of buffers while it gathers the first. Everything \
+ * is drawn from one streamed vertex buffer, in at most four draw calls: \
+ * lines and triangles, each depth tested and as an overlay.
+ * Colors are 0xRRGGBBAA; translucent ones blend. Matrices are \
+ * column-major.
+ *
+ * Normally used through LYS_DEBUG_DRAW(), which compiles away (arguments \
+ * and all) in LYS_NDEBUG builds:
+ * \code
+ * LYS_DEBUG_DRAW(box(body_bounds, 0x00FF00FF));
+ * LYS_DEBUG_DRAW(frustum(shadow_view_projection, 0xFFFF00FF, lys3d::DebugDepth::kOverlay));
+ * ...
+ * LYS_DEBUG_DRAW(flush(camera_view_projection));
+ * \endcode
+ */
+class LYS_API DebugDraw {
+  public:
+    /** Default constructor. GL objects are made on the first draw(). */
+    DebugDraw();
+
+    /** Destructor. Deletes the GL objects; the context they were made in \
+     * must be current.
+     */
+    ~DebugDraw();
+
+    DebugDraw(const DebugDraw& other) = delete;
+    DebugDraw& operator=(const DebugDraw& other) = delete;
+
+    /** Get the instance LYS_DEBUG_DRAW() draws with.
+     * \returns The global debug drawer.
+     */
+    static DebugDraw& global();
+
+    /** Add a line.
+     * \param a One end.
+     * \param b The other end.
+     * \param rgba The color.
+     * \param depth Whether the scene can hide it.
+     */
+    void line(const Point3Df &a, const Point3Df &b, uint32_t rgba, DebugDepth depth = DebugDepth::kTested);
+
+    /** Add a filled triangle, visible from both sides.
+     * \param a The first corner.
+     * \param b The second corner.
+     * \param c The third corner.
+     * \param rgba The color.
+     * \param depth Whether the scene can hide it.
+     */
+    void triangle(const Point3Df &a, const Point3Df &b, const Point3Df &c, uint32_t rgba,
+                  DebugDepth depth = DebugDepth::kTested);
+
+    /** Add the edges of a box.
+     * \param box The box.
+     * \param rgba The color.
+     * \param depth Whether the scene can hide it.
+     */
+    void box(const Box3Df &box, uint32_t rgba, DebugDepth depth = DebugDepth::kTested);
+
+    /** Add a filled box; usually translucent.
+     * \param box The box.
+     * \param rgba The color.
+     * \param depth Whether the scene can hide it.
+     */
+    void solidBox(const Box3Df &box, uint32_t rgba, DebugDepth depth = DebugDepth::kTested);
+
+    /** Add a sphere, as three circles around its axes.
+     * \param center The center.
+     * \param radius The radius.
+     * \param rgba The color.
+     * \param depth Whether the scene can hide it.
+     */
+    void sphere(const Point3Df &center, float radius, uint32_t rgba, DebugDepth depth = DebugDepth::kTested);
+
+    /** Add the edges of a view frustum, e.g. a shadow or culling camera's.
+     * \param view_projection The camera's view-projection matrix.
+     * \param rgba The color.
+     * \param depth Whether the scene can hide it.
+     */
+    void frustum(const float view_projection[16], uint32_t rgba, DebugDepth depth = DebugDepth::kTested);
+
+    /** Add a transform's axes: x red, y green, z blue.
+     * \param transform The transform matrix.
+     * \param size Length of the axes, in the transform's units.
+     * \param depth Whether the scene can hide it.
+     */
+    void axes(const float transform[16], float size, DebugDepth depth = DebugDepth::kTested);
+
+    /** Gather what every thread has added since the last collect(), into \
+     * vertices(). Shapes added while it runs go to the next frame.
+     */
+    void collect();
+
+    /** Get a batch gathered by the last collect().
+     * \param batch The batch.
+     * \returns Its vertices: pairs for lines, triples for triangles.
+     */
+    const Vector<DebugVertex>& vertices(DebugBatch batch) const;
+
+    /** Draw what the last collect() gathered over the bound framebuffer, \
+     * blended and without writing depth. Needs a current GL context; \
+     * restores blending, depth testing, depth writes and face culling, \
+     * but leaves the program and array buffer bound. Under a WindowGLES2 \
+     * the state to restore is known without asking GL for it.
+     * \param view_projection The camera's view-projection matrix.
+     */
+    void draw(const float view_projection[16]);
+
+    /** collect() then draw(): the usual end of a frame.
+     * \param view_projection The camera's view-projection matrix.
+     */
+    void flush(const float view_projection[16]);
+
+    /** Get the statistics of the last collect() and draw().
+     * \returns The statistics.
+     */
+    const DebugDrawStats& stats() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+
+/** Call a method of the global DebugDraw, or nothing in LYS_NDEBUG builds.
+ * \param call The call without the object, e.g. line(a, b, 0xFF0000FF).
+ */
+#ifdef LYS_NDEBUG
+#define LYS_DEBUG_DRAW(call) ((void)0)
+#else
+#define LYS_DEBUG_DRAW(call) lys3d::DebugDraw::global().call
+#endif
+#endif // LYS3D_DEBUGDRAW_H_
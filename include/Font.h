@@ -0,0 +1,154 @@
+/***************************************************
+* Font.h: TrueType outlines & SDF glyphs           *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_FONT_H_
+#define LYS3D_FONT_H_
+
+#include "types.h"
+
+namespace lys3d {
+
+/** Where a glyph's bitmap goes, in pixels at the size it was rendered. */
+struct GlyphBitmap {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    /** From the pen position to the bitmap's left edge. */
+    int32_t left = 0;
+    /** From the baseline up to the bitmap's top edge. */
+    int32_t top = 0;
+};
+
+/** A TrueType font (glyf outlines, as in most .ttf files; not CFF/.otf), \
+ * turned into signed distance field glyphs for TextRenderer.
+ * The file is kept in memory and glyphs are read from it on demand, so \
+ * large character sets cost nothing until used. Metrics are in ems, i.e. \
+ * multiples of the font size. Kerning comes from the 'kern' table where \
+ * there is one.
+ */
+class LYS_API Font {
+  public:
+    /** Default constructor. Creates an empty font. */
+    Font();
+
+    ~Font() = default;
+
+    Font(const Font& other) = delete;
+    Font& operator=(const Font& other) = delete;
+
+    /** Load a font file through PhysFS.
+     * \param path The PhysFS path of the file.
+     * \returns True on success; false on failure, leaving the font empty.
+     */
+    bool load(const String &path);
+
+    /** Load a font from memory. The data is copied.
+     * \param data The file contents.
+     * \param size The size of the file, in bytes.
+     * \returns True on success; false if it isn't a TrueType font.
+     */
+    bool loadFromMemory(const void *data, size_t size);
+
+    /** Check whether a font is loaded.
+     * \returns True if the font is usable.
+     */
+    bool isLoaded() const {
+        return !data_.empty();
+    }
+
+    /** Get the number of glyphs in the font.
+     * \returns The glyph count.
+     */
+    uint32_t glyphCount() const {
+        return glyphCount_;
+    }
+
+    /** Look up a character's glyph.
+     * \param codepoint The Unicode code point.
+     * \returns The glyph index, or 0 (the missing glyph) if there is none.
+     */
+    uint32_t glyphIndex(uint32_t codepoint) const;
+
+    /** Get the distance from the baseline to the top of the tallest glyphs.
+     * \returns The ascent, in ems.
+     */
+    float ascent() const {
+        return ascent_;
+    }
+
+    /** Get the distance from the baseline to the bottom of the lowest glyphs.
+     * \returns The descent, in ems (negative, below the baseline).
+     */
+    float descent() const {
+        return descent_;
+    }
+
+    /** Get the distance from one baseline to the next.
+     * \returns The line height, in ems.
+     */
+    float lineHeight() const {
+        return ascent_ - descent_ + lineGap_;
+    }
+
+    /** Get how far the pen moves after a glyph.
+     * \param glyph The glyph index.
+     * \returns The advance, in ems.
+     */
+    float advance(uint32_t glyph) const;
+
+    /** Get the adjustment between two glyphs, e.g. to tuck "AV" together.
+     * \param left The glyph index on the left.
+     * \param right The glyph index on the right.
+     * \returns The extra advance, in ems (usually negative).
+     */
+    float kerning(uint32_t left, uint32_t right) const;
+
+    /** Render a glyph as a signed distance field: 128 on the outline, \
+     * rising to 255 at spread pixels inside and falling to 0 at spread \
+     * pixels outside. The bitmap is padded so the field fades out fully.
+     * Glyphs without an outline (e.g. spaces) give an empty bitmap.
+     * \param glyph The glyph index.
+     * \param pixel_size The size of an em, in pixels.
+     * \param spread Distance covered on either side of the outline, in \
+     * pixels.
+     * \param pixels Receives width * height bytes, row by row from the top.
+     * \param bitmap Receives the bitmap's size and placement.
+     * \returns False if the glyph's data is damaged.
+     */
+    bool renderSDF(uint32_t glyph, float pixel_size, float spread, Vector<uint8_t> *pixels,
+                   GlyphBitmap *bitmap) const;
+
+  private:
+    struct Point {
+        float x, y;
+    };
+
+    uint32_t glyphOffset(uint32_t glyph, uint32_t *length) const;
+    bool outline(uint32_t glyph, const float *transform, uint32_t depth, Vector<Point> *points,
+                 Vector<uint8_t> *on_curve, Vector<uint32_t> *contour_ends) const;
+
+    Vector<uint8_t> data_;
+    uint32_t glyphCount_;
+    uint32_t unitsPerEm_;
+    bool longOffsets_;
+    uint32_t loca_;
+    uint32_t glyf_;
+    uint32_t glyfLength_;
+    uint32_t hmtx_;
+    uint32_t metricCount_;
+    uint32_t cmap_;
+    uint32_t cmapFormat_;
+    uint32_t kernPairs_;
+    uint32_t kernCount_;
+    float ascent_;
+    float descent_;
+    float lineGap_;
+};
+}
+#endif // LYS3D_FONT_H_
@@ -0,0 +1,169 @@
+/***************************************************
+* FrameCapture.h: Screenshots & video recording    *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_FRAMECAPTURE_H_
+#define LYS3D_FRAMECAPTURE_H_
+
+#include "types.h"
+#include "Dimension2D.h"
+
+namespace lys3d {
+
+/** What a FrameCapture has done since its recording started (or since it \
+ * was created, for screenshots).
+ */
+struct FrameCaptureStats {
+    /** Frames read back and handed to the encoder. */
+    uint32_t captured = 0;
+    /** Frames skipped because every readback slot was busy, the memory \
+     * limit was reached or the window changed size mid-recording.
+     */
+    uint32_t dropped = 0;
+    /** Frames written out. */
+    uint32_t encoded = 0;
+    /** Frames that couldn't be written (e.g. the disk filled up). */
+    uint32_t failed = 0;
+    /** Pixel memory held for frames waiting to be read back or encoded, \
+     * in bytes.
+     */
+    uint64_t heldBytes = 0;
+    /** CPU time capture() added to the last frame, in milliseconds. */
+    float lastMs = 0.0f;
+    /** Mean CPU time capture() added per frame, in milliseconds. */
+    float averageMs = 0.0f;
+    /** Longest CPU time capture() added to a frame, in milliseconds. */
+    float maxMs = 0.0f;
+};
+
+/** Saves screenshots and records video without stalling the frame.
+ * capture() starts a copy of the finished frame into one of kSlots \
+ * offscreen slots and reads back the one started kLatency frames earlier, \
+ * which the GPU has long finished by then. With GL_NV_pixel_buffer_object \
+ * (or GL_ARB_pixel_buffer_object) and a way to map buffers for reading, \
+ * the slots are pixel buffers that glReadPixels() fills asynchronously; \
+ * otherwise they are textures the back buffer is copied into on the GPU, \
+ * read back through a framebuffer.
+ * The pixels then go to a worker thread that writes screenshots as PNG \
+ * (through SDL2_image) and recordings as a raw YUV4MPEG2 (.y4m) stream, \
+ * which most video tools read. When the slots are all busy or the pixels \
+ * waiting for the encoder would exceed memoryLimit(), frames are dropped \
+ * rather than waited for.
+ * WindowGLES2::update() calls capture() before the profiler overlay is \
+ * drawn, so the overlay never shows up in captures; its cost shows up as \
+ * the "Frame capture" zone.
+ */
+class LYS_API FrameCapture {
+  public:
+    /** Number of frames a readback trails the frame it captures. */
+    static const uint32_t kLatency = 2;
+
+    /** Number of offscreen slots frames are copied into. */
+    static const uint32_t kSlots = kLatency + 1;
+
+    /** Constructor. Doesn't touch GL.
+     * \param memory_limit Pixel memory allowed for frames waiting to be \
+     * read back or encoded, in bytes.
+     */
+    explicit FrameCapture(uint64_t memory_limit = 256 * 1024 * 1024);
+
+    /** Destructor. Stops recording, waits for the encoder and deletes the \
+     * slots; the GL context they were made in must be current.
+     */
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture& other) = delete;
+    FrameCapture& operator=(const FrameCapture& other) = delete;
+
+    /** Get the pixel memory limit.
+     * \returns The limit, in bytes.
+     */
+    uint64_t memoryLimit() const;
+
+    /** Set the pixel memory limit. Memory already held isn't given back \
+     * until it is used again.
+     * \param bytes The limit, in bytes.
+     */
+    void memoryLimit(uint64_t bytes);
+
+    /** Save the next captured frame as a PNG file.
+     * \param path The file to write, on the native filesystem.
+     * \returns True if requested; false if another screenshot is still \
+     * waiting for its frame.
+     */
+    bool screenshot(const String &path);
+
+    /** Start recording every captured frame into a YUV4MPEG2 file. The \
+     * video takes the size of its first frame; frames of another size are \
+     * dropped.
+     * \param path The file to write, on the native filesystem.
+     * \param fps The frame rate to mark the video with.
+     * \returns True on success; false if already recording or the file \
+     * can't be created.
+     */
+    bool startRecording(const String &path, uint32_t fps = 60);
+
+    /** Stop recording. Frames still being read back are read back now, \
+     * which needs the GL context capture() was called with; the file is \
+     * closed once the encoder is done with them.
+     * \returns True if a recording was stopped.
+     */
+    bool stopRecording();
+
+    /** Check whether frames are being recorded.
+     * \returns True between startRecording() and stopRecording().
+     */
+    bool isRecording() const;
+
+    /** Check whether capture() has anything to do.
+     * \returns True while recording, waiting for a screenshot or reading \
+     * back frames.
+     */
+    bool isCapturing() const;
+
+    /** Capture the frame in the default framebuffer, which must be bound. \
+     * Call once per frame, before the buffer swap; does nothing unless \
+     * isCapturing(). Needs a current GL context; the texture bound to \
+     * the active unit is kept, and under a WindowGLES2 known without \
+     * asking GL for it.
+     * \param size The size of the default framebuffer, in pixels.
+     */
+    void capture(const Dimension2Di32 &size);
+
+    /** Hand a frame already in memory to the encoder, as capture() does \
+     * once a readback completes. Doesn't touch GL, so frames can come from \
+     * elsewhere (or tests).
+     * \param pixels RGBA8 pixels, bottom row first, as glReadPixels() \
+     * returns them.
+     * \param size The frame size, in pixels.
+     * \returns True if the frame was taken; false if nothing wanted it or \
+     * it was dropped.
+     */
+    bool submit(const void *pixels, const Dimension2Di32 &size);
+
+    /** Wait until the encoder has written every frame handed to it. */
+    void finish();
+
+    /** Check whether readbacks go through pixel buffers.
+     * \returns True if the asynchronous path is in use; known after the \
+     * first capture().
+     */
+    bool usesPixelBuffers() const;
+
+    /** Get the statistics.
+     * \returns A snapshot of them.
+     */
+    FrameCaptureStats stats() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_FRAMECAPTURE_H_
@@ -0,0 +1,237 @@
+/***************************************************
+* FrameGraph.h: Render passes with pooled targets  *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_FRAMEGRAPH_H_
+#define LYS3D_FRAMEGRAPH_H_
+
+#include "types.h"
+#include "Dimension2D.h"
+
+namespace lys3d {
+
+class FrameGraph;
+
+/** A frame graph resource handle; only valid for the frame it was \
+ * declared in.
+ */
+typedef uint32_t FrameResource;
+
+/** Storage formats for transient render targets. */
+enum class FrameTargetFormat {
+    kRGBA8,         ///< Color texture, 8 bits per channel
+    kRGB565,        ///< Color texture, 16 bits per pixel
+    kDepth16,       ///< Depth renderbuffer; can be rendered into but not read
+    kDepthTexture   ///< Depth texture (needs GL_OES_depth_texture)
+};
+
+/** Describes a transient render target. */
+struct FrameTargetDesc {
+    FrameTargetFormat format = FrameTargetFormat::kRGBA8;
+    /** Size in pixels; leave at 0x0 to use scale instead. */
+    Dimension2Di32 size;
+    /** Size relative to the backbuffer, when size is 0x0. */
+    float scale = 1.0f;
+    /** Color the first pass writing the target clears it to. */
+    float clearColor[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+/** Attachment bits, as returned by FrameGraph::clearMask() and \
+ * FrameGraph::discardMask().
+ */
+enum FrameAttachment : uint32_t {
+    kFrameColor = 1,
+    kFrameDepth = 2
+};
+
+/** Per-frame frame graph counters, refreshed by compile() and execute(). */
+struct FrameGraphStats {
+    /** Passes declared this frame. */
+    uint32_t passes = 0;
+    /** Passes dropped because nothing used their output. */
+    uint32_t culledPasses = 0;
+    /** Transient resources declared this frame. */
+    uint32_t resources = 0;
+    /** Pooled render targets backing them (fewer when lifetimes allow aliasing). */
+    uint32_t targets = 0;
+    /** GPU memory held by the pool, in bytes. */
+    uint64_t targetBytes = 0;
+    /** glClear calls issued by execute(). */
+    uint32_t clears = 0;
+    /** Attachments discarded by execute() (0 without GL_EXT_discard_framebuffer). */
+    uint32_t discards = 0;
+};
+
+/** Called by FrameGraph::execute() with the pass's target bound and the \
+ * viewport set to its size.
+ */
+typedef void (*FramePassCallback)(const FrameGraph &graph, void *user_data);
+
+/** Builds the render passes of one frame from what each pass reads and \
+ * writes, then runs them with render targets taken from a pool.
+ * Transient targets only exist for the frame. Targets with the same format \
+ * and size whose lifetimes don't overlap share one pooled texture, and the \
+ * pool keeps them (and the framebuffer objects combining them) across \
+ * frames, so a steady frame creates no GL objects at all. Passes whose \
+ * outputs never reach the backbuffer are culled, unless marked with keep().
+ * A target is cleared by the first pass that writes it, and later writers \
+ * keep its contents. Attachments that are dead after a pass are discarded \
+ * with glDiscardFramebufferEXT where available, so tile-based GPUs neither \
+ * load nor store memory they don't need to.
+ *
+ * Typical frame:
+ * \code
+ * graph.reset(window.sizeInPixels());
+ * uint32_t scene = graph.addPass("Scene", drawScene, &world);
+ * FrameResource color = graph.create(color_desc), depth = graph.create(depth_desc);
+ * graph.write(scene, color);
+ * graph.write(scene, depth);
+ * uint32_t post = graph.addPass("Post", drawPost, &post_state);
+ * graph.read(post, color);
+ * graph.write(post, graph.backbuffer());
+ * graph.compile();
+ * graph.execute();
+ * window.update();
+ * \endcode
+ */
+class LYS_API FrameGraph {
+  public:
+    /** Constructor. Creates no GL objects until execute(). */
+    FrameGraph();
+
+    /** Destructor. Releases the pooled GL objects. */
+    ~FrameGraph();
+
+    FrameGraph(const FrameGraph& other) = delete;
+    FrameGraph& operator=(const FrameGraph& other) = delete;
+
+    /** Start declaring a new frame, dropping the previous frame's passes \
+     * and resources. The pool is kept.
+     * \param backbuffer_size Size of the default framebuffer, in pixels.
+     */
+    void reset(const Dimension2Di32 &backbuffer_size);
+
+    /** Add a pass. Passes run in the order they're added.
+     * \param name The pass name, also its profiler zone. Must outlive the \
+     * graph (e.g. a literal).
+     * \param callback Issues the pass's draw calls.
+     * \param user_data Passed to the callback.
+     * \returns The pass index.
+     */
+    uint32_t addPass(const char *name, FramePassCallback callback, void *user_data = nullptr);
+
+    /** Declare a transient render target.
+     * \param desc Format, size and clear color.
+     * \returns The resource handle.
+     */
+    FrameResource create(const FrameTargetDesc &desc);
+
+    /** Get the handle of the default framebuffer. Passes writing it render \
+     * to the window; it can't be read.
+     * \returns The backbuffer handle.
+     */
+    FrameResource backbuffer() const;
+
+    /** Get whether the first pass writing the backbuffer clears it.
+     * \returns True if it does. Defaults to false, since \
+     * WindowGLES2::update() already clears depth and stencil.
+     */
+    bool clearsBackbuffer() const;
+
+    /** Set whether the first pass writing the backbuffer clears its color, \
+     * depth and stencil.
+     * \param clear True to clear.
+     */
+    void clearsBackbuffer(bool clear);
+
+    /** Declare that a pass renders into a resource. A pass can write one \
+     * color and one depth target, or the backbuffer.
+     * \param pass The pass index.
+     * \param resource The target.
+     */
+    void write(uint32_t pass, FrameResource resource);
+
+    /** Declare that a pass samples a resource as a texture.
+     * \param pass The pass index.
+     * \param resource A color or kDepthTexture target.
+     */
+    void read(uint32_t pass, FrameResource resource);
+
+    /** Never cull a pass (e.g. one that updates something outside the graph).
+     * \param pass The pass index.
+     */
+    void keep(uint32_t pass);
+
+    /** Cull unused passes, work out lifetimes, assign pooled targets and \
+     * plan clears and discards. Doesn't touch GL.
+     * \returns False if the declarations are invalid (e.g. a pass reading \
+     * and writing the same target, or reading the backbuffer).
+     */
+    bool compile();
+
+    /** Run the passes that survived compile(), creating pooled targets as \
+     * needed, and leave the backbuffer bound with its full viewport.
+     * \returns False if a target couldn't be created; the passes using it \
+     * are skipped.
+     */
+    bool execute();
+
+    /** Release every pooled GL object. The next execute() recreates them. */
+    void destroy();
+
+    /** Check whether compile() culled a pass.
+     * \param pass The pass index.
+     * \returns True if the pass won't run.
+     */
+    bool isCulled(uint32_t pass) const;
+
+    /** Get the attachments a pass clears before running.
+     * \param pass The pass index.
+     * \returns A combination of FrameAttachment bits.
+     */
+    uint32_t clearMask(uint32_t pass) const;
+
+    /** Get the attachments discarded after a pass, because nothing uses \
+     * them afterwards.
+     * \param pass The pass index.
+     * \returns A combination of FrameAttachment bits.
+     */
+    uint32_t discardMask(uint32_t pass) const;
+
+    /** Get the pooled target backing a resource after compile(). Resources \
+     * sharing a slot are aliased.
+     * \param resource A transient resource.
+     * \returns The pool slot.
+     */
+    uint32_t slot(FrameResource resource) const;
+
+    /** Get the size of a resource.
+     * \param resource The resource.
+     * \returns Its size in pixels.
+     */
+    Dimension2Di32 size(FrameResource resource) const;
+
+    /** Get the GL texture to sample a resource from; only valid in pass \
+     * callbacks.
+     * \param resource A resource the running pass reads.
+     * \returns The texture name, or 0 for renderbuffers and the backbuffer.
+     */
+    uint32_t texture(FrameResource resource) const;
+
+    /** Get the counters for the current frame.
+     * \returns The statistics.
+     */
+    const FrameGraphStats& stats() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_FRAMEGRAPH_H_
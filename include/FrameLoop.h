@@ -0,0 +1,217 @@
+/***************************************************
+* FrameLoop.h: Fixed-timestep main loop driver     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_FRAMELOOP_H_
+#define LYS3D_FRAMELOOP_H_
+
+#include "types.h"
+#include "Point3D.h"
+
+namespace lys3d {
+
+/** Reads input and window events at the start of a frame.
+ * \param user_data The callbacks' userData.
+ * \returns False to stop the loop.
+ */
+typedef bool (*FrameInputCallback)(void *user_data);
+
+/** Advances the simulation by one fixed step.
+ * \param seconds The step length, FrameLoopSettings::stepSeconds.
+ * \param user_data The callbacks' userData.
+ */
+typedef void (*FrameStepCallback)(double seconds, void *user_data);
+
+/** Copies what the renderer needs out of the simulation, while no step is \
+ * running.
+ * \param user_data The callbacks' userData.
+ */
+typedef void (*FrameSyncCallback)(void *user_data);
+
+/** Draws a frame.
+ * \param alpha How far the frame is between the previous and the latest \
+ * step, from 0 to 1, for InterpolatedTransform::matrix().
+ * \param user_data The callbacks' userData.
+ */
+typedef void (*FrameRenderCallback)(float alpha, void *user_data);
+
+/** Shows the frame, e.g. with WindowGLES2::update().
+ * \param user_data The callbacks' userData.
+ * \returns False to stop the loop.
+ */
+typedef bool (*FramePresentCallback)(void *user_data);
+
+/** What FrameLoop calls each frame; any may be nullptr. */
+struct FrameLoopCallbacks {
+    FrameInputCallback input = nullptr;
+    FrameStepCallback step = nullptr;
+    FrameSyncCallback sync = nullptr;
+    FrameRenderCallback render = nullptr;
+    FramePresentCallback present = nullptr;
+    void *userData = nullptr;
+};
+
+/** Construction-time settings of a FrameLoop. */
+struct FrameLoopSettings {
+    /** Simulated time per step, in seconds. */
+    double stepSeconds = 1.0 / 60.0;
+    /** Most steps run in one frame. Time past that is dropped, so a slow \
+     * frame slows the game down rather than making every later frame run \
+     * more steps (and take longer still).
+     */
+    uint32_t maxSteps = 4;
+    /** Run the steps on a thread of their own while the previous frame's \
+     * state renders, rather than before rendering.
+     */
+    bool threaded = false;
+};
+
+/** What the last frame did. */
+struct FrameLoopStats {
+    /** Steps run (or started, when threaded) this frame. */
+    uint32_t steps = 0;
+    /** Steps dropped to stay within maxSteps. */
+    uint32_t droppedSteps = 0;
+    /** The alpha passed to render. */
+    float alpha = 0.0f;
+    /** Time spent in each callback and in the whole frame, in \
+     * milliseconds. When threaded, stepMs is the previous frame's steps, \
+     * and waitMs the time spent waiting for them to finish.
+     */
+    float inputMs = 0.0f;
+    float stepMs = 0.0f;
+    float waitMs = 0.0f;
+    float syncMs = 0.0f;
+    float renderMs = 0.0f;
+    float presentMs = 0.0f;
+    float frameMs = 0.0f;
+};
+
+/** A body's position and orientation at the previous and the latest \
+ * simulation step, so frames can be drawn between the two.
+ */
+class LYS_API InterpolatedTransform {
+  public:
+    /** Default constructor. Starts at the origin, unrotated. */
+    InterpolatedTransform();
+
+    /** Record the latest step's state, keeping the one before.
+     * \param position The position.
+     * \param orientation A unit quaternion (x, y, z, w).
+     */
+    void update(const Point3Df &position, const float *orientation);
+
+    /** Move without interpolating, e.g. when spawning or teleporting.
+     * \param position The position.
+     * \param orientation A unit quaternion (x, y, z, w).
+     */
+    void reset(const Point3Df &position, const float *orientation);
+
+    /** Get the position between the two steps.
+     * \param alpha 0 for the previous step, 1 for the latest.
+     * \returns The position.
+     */
+    Point3Df position(float alpha) const;
+
+    /** Get the transform between the two steps. The orientation takes the \
+     * shorter way round.
+     * \param alpha 0 for the previous step, 1 for the latest.
+     * \param matrix Receives a column-major 4x4 matrix.
+     */
+    void matrix(float alpha, float *matrix) const;
+
+  private:
+    Point3Df previousPosition_;
+    Point3Df position_;
+    float previousOrientation_[4];
+    float orientation_[4];
+};
+
+/** Drives the main loop: each frame reads input, runs as many fixed \
+ * simulation steps as the elapsed time calls for, then renders and \
+ * presents. Time left over is carried to the next frame, and rendering is \
+ * told how far between steps it is, so motion stays smooth whatever the \
+ * frame rate and the simulation behaves the same with or without VSync.
+ * When threaded, frame N's steps run on the loop's thread while frame N-1 \
+ * renders. The sync callback is then the only place both sides may touch \
+ * the simulation: it runs once the steps are done and before the next ones \
+ * start, and should copy out what rendering needs.
+ * Each phase is timed in stats() and in zones of the global Profiler, and \
+ * the steps run per frame are its "Simulation steps" counter.
+ *
+ * Typical use:
+ * \code
+ * FrameLoopCallbacks callbacks;
+ * callbacks.step = stepWorld;
+ * callbacks.render = drawWorld;
+ * callbacks.present = presentWindow;
+ * callbacks.userData = &game;
+ * FrameLoop loop;
+ * loop.run(callbacks);
+ * \endcode
+ */
+class LYS_API FrameLoop {
+  public:
+    /** Constructor. Starts the simulation thread when threaded.
+     * \param settings The loop settings.
+     */
+    explicit FrameLoop(const FrameLoopSettings &settings = FrameLoopSettings());
+
+    /** Destructor. Waits for running steps and stops the thread. */
+    ~FrameLoop();
+
+    FrameLoop(const FrameLoop& other) = delete;
+    FrameLoop& operator=(const FrameLoop& other) = delete;
+
+    /** Get the settings.
+     * \returns The settings.
+     */
+    const FrameLoopSettings& settings() const;
+
+    /** Run one frame, timed by the clock since the last frame (no time \
+     * passes before the first).
+     * \param callbacks What to call.
+     * \returns False once input or present asked to stop.
+     */
+    bool frame(const FrameLoopCallbacks &callbacks);
+
+    /** Run one frame that took a given time.
+     * \param callbacks What to call.
+     * \param seconds The time since the last frame.
+     * \returns False once input or present asked to stop.
+     */
+    bool frame(const FrameLoopCallbacks &callbacks, double seconds);
+
+    /** Run frames until input or present asks to stop, then wait for the \
+     * last steps.
+     * \param callbacks What to call.
+     */
+    void run(const FrameLoopCallbacks &callbacks);
+
+    /** Wait for any running steps, then forget the time carried over, e.g. \
+     * after a loading screen.
+     */
+    void reset();
+
+    /** Get the number of steps run (or started) so far.
+     * \returns The step count.
+     */
+    uint64_t stepCount() const;
+
+    /** Get the last frame's statistics.
+     * \returns The statistics.
+     */
+    const FrameLoopStats& stats() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_FRAMELOOP_H_
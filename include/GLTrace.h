@@ -0,0 +1,181 @@
+/***************************************************
+* GLTrace.h: GL call-stream capture & replay       *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_GLTRACE_H_
+#define LYS3D_GLTRACE_H_
+
+#include <stddef.h>
+
+#include "types.h"
+#include "Dimension2D.h"
+
+namespace lys3d {
+
+/** Records every GL call the engine makes, with the buffer, texture, \
+ * shader and uniform data it passes, into a trace file that GLReplay (and \
+ * the lys3d-glreplay tool) can play back without the game or its assets.
+ * Capturing wraps the GL function pointers, like Profiler::countGL(), and \
+ * stacks with it. Only one capture can run at a time.
+ * The replay recreates objects from their creation calls, so start \
+ * capturing before anything is uploaded, e.g. right after opening the \
+ * window. WindowGLES2::open() does so when the LYS3D_GL_CAPTURE \
+ * environment variable names a file; update() marks the frames and \
+ * close() ends the capture.
+ * Vertex attributes and indices must come from buffer objects: \
+ * client-side arrays are recorded as offsets, so their data is missing \
+ * from the trace.
+ */
+class LYS_API GLCapture {
+  public:
+    /** Default constructor. Doesn't capture until start(). */
+    GLCapture();
+
+    /** Destructor. Stops capturing. */
+    ~GLCapture();
+
+    GLCapture(const GLCapture& other) = delete;
+    GLCapture& operator=(const GLCapture& other) = delete;
+
+    /** Get the instance WindowGLES2 captures with.
+     * \returns The global capture.
+     */
+    static GLCapture& global();
+
+    /** Start capturing into a file. Needs a current GL context.
+     * \param path The trace file to write, on the native filesystem.
+     * \param framebuffer_size Size of the default framebuffer, in pixels; \
+     * the replay renders at the same size.
+     * \returns True on success; false if the file can't be created or \
+     * another capture is running.
+     */
+    bool start(const String &path, const Dimension2Di32 &framebuffer_size);
+
+    /** Stop capturing and close the trace.
+     * \returns True if the whole trace was written; false if a write \
+     * failed (e.g. the disk filled up) or nothing was being captured.
+     */
+    bool stop();
+
+    /** Check whether this capture is running.
+     * \returns True between start() and stop().
+     */
+    bool isCapturing() const;
+
+    /** Mark the end of a frame, e.g. at the buffer swap. Does nothing \
+     * unless capturing.
+     */
+    void frame();
+
+    /** Get the number of frames marked since start().
+     * \returns The frame count.
+     */
+    uint32_t frames() const;
+
+    /** Get the size of the trace so far.
+     * \returns Bytes written since start(), including buffered ones.
+     */
+    uint64_t bytes() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+
+
+/** What one replayed frame cost. */
+struct GLReplayStats {
+    /** GL calls made. */
+    uint32_t calls = 0;
+    /** glDrawArrays/glDrawElements calls. */
+    uint32_t drawCalls = 0;
+    /** Bytes of buffer, texture and uniform data passed to GL. */
+    uint64_t uploadedBytes = 0;
+    /** CPU time spent issuing the calls, in milliseconds: the \
+     * application-side plus driver cost of the frame.
+     */
+    float cpuMs = 0.0f;
+    /** Time glFinish() then waited for the GPU, in milliseconds; 0 \
+     * unless requested.
+     */
+    float finishMs = 0.0f;
+};
+
+/** Plays back a trace recorded by GLCapture, a frame at a time, into the \
+ * current GL context. Objects the trace creates get whatever names the \
+ * driver hands out; buffer, texture, framebuffer, renderbuffer, program \
+ * and shader names, and uniform locations, are translated on the way. \
+ * Attribute locations are used as captured, so programs should bind them \
+ * (as ShaderProgram does) rather than query them.
+ */
+class LYS_API GLReplay {
+  public:
+    /** Default constructor. Holds no trace until load(). */
+    GLReplay();
+
+    /** Destructor. Objects the replay created are left to the context. */
+    ~GLReplay();
+
+    GLReplay(const GLReplay& other) = delete;
+    GLReplay& operator=(const GLReplay& other) = delete;
+
+    /** Load a trace file and check that it is complete and well-formed: \
+     * every data block holds at least what its call's size arguments say \
+     * GL will read, and every call's generated names are in the trace.
+     * \param path The trace file, on the native filesystem.
+     * \returns True on success; false on failure, leaving no trace loaded.
+     */
+    bool load(const String &path);
+
+    /** Load a trace from memory. The data is copied.
+     * \param data The trace.
+     * \param size The size of the trace, in bytes.
+     * \returns True on success; false on failure, leaving no trace loaded.
+     */
+    bool loadFromMemory(const void *data, size_t size);
+
+    /** Get the number of frames in the trace. Calls after the last frame \
+     * mark (e.g. from a crashed run) count as one more frame.
+     * \returns The frame count.
+     */
+    uint32_t frameCount() const;
+
+    /** Get the size of the default framebuffer during the capture.
+     * \returns The size, in pixels.
+     */
+    Dimension2Di32 framebufferSize() const;
+
+    /** Get the frame replayFrame() plays next.
+     * \returns The index of the next frame; frameCount() after the last.
+     */
+    uint32_t frame() const;
+
+    /** Make the next frame's GL calls. Needs a current GL context.
+     * \param finish True to glFinish() afterwards and time the wait.
+     * \returns True if a frame was played; false after the last one.
+     */
+    bool replayFrame(bool finish = false);
+
+    /** Delete every object the replay created and start again from the \
+     * first frame. Other GL state is left as the last frame set it. Needs \
+     * the context the frames were played into.
+     */
+    void rewind();
+
+    /** Get the cost of the last replayed frame.
+     * \returns The statistics.
+     */
+    const GLReplayStats& stats() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_GLTRACE_H_
@@ -0,0 +1,158 @@
+/***************************************************
+* GeometryPool.h: Shared static vertex/index data  *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_GEOMETRYPOOL_H_
+#define LYS3D_GEOMETRYPOOL_H_
+
+#include "types.h"
+#include "Mesh.h"
+#include "VertexLayout.h"
+
+namespace lys3d {
+
+/** Occupancy of a GeometryPool. */
+struct GeometryPoolStats {
+    /** Meshes in the pool. */
+    uint32_t meshCount;
+    /** Vertex buffer bytes in use. */
+    uint64_t vertexBytes;
+    /** Index buffer bytes in use. */
+    uint64_t indexBytes;
+    /** Free space fragmentation of each buffer (see OffsetAllocator). */
+    float vertexFragmentation;
+    float indexFragmentation;
+    /** Vertex and index ranges moved by the last defragment(). */
+    uint32_t moves;
+    /** Bytes re-uploaded by the last defragment(). */
+    uint64_t movedBytes;
+};
+
+/** Keeps many static meshes in one GL_ARRAY_BUFFER and one \
+ * GL_ELEMENT_ARRAY_BUFFER, so drawing them only moves the attribute \
+ * pointers instead of binding buffers per mesh.
+ * Every mesh in a pool shares the pool's vertex layout. Ranges come from \
+ * TLSF offset allocators, and indices stay relative to each mesh's first \
+ * vertex, so 16-bit indices still work. GLES2 can't copy between buffer \
+ * ranges on the GPU, so the pool keeps a CPU copy of both buffers; \
+ * defragment() uses it to move meshes towards the start a few at a time.
+ * Meshes can be added before create() (or after destroy()); their data is \
+ * uploaded when the buffers are created.
+ */
+class LYS_API GeometryPool {
+  public:
+    /** Constructor.
+     * \param layout The vertex layout of every mesh in the pool.
+     * \param vertex_capacity Vertex buffer size, in vertices.
+     * \param index_capacity Index buffer size, in 16-bit indices.
+     */
+    explicit GeometryPool(const VertexLayout &layout, uint32_t vertex_capacity = 256 * 1024,
+                          uint32_t index_capacity = 768 * 1024);
+
+    /** Destructor. Deletes the buffers if they were created. */
+    ~GeometryPool();
+
+    GeometryPool(const GeometryPool& other) = delete;
+    GeometryPool& operator=(const GeometryPool& other) = delete;
+
+    /** Create the GL buffers and upload every mesh added so far.
+     * Needs a current GL context.
+     * \returns True on success.
+     */
+    bool create();
+
+    /** Delete the GL buffers. Meshes stay in the pool. */
+    void destroy();
+
+    /** Check whether the GL buffers exist.
+     * \returns True after a successful create().
+     */
+    bool isCreated() const;
+
+    /** Get the vertex layout shared by the pool's meshes.
+     * \returns The layout.
+     */
+    const VertexLayout& layout() const;
+
+    /** Add a mesh.
+     * \param vertices Vertex data in the pool's layout.
+     * \param vertex_count Number of vertices.
+     * \param indices Triangle list indices, relative to the first vertex.
+     * \param index_count Number of indices.
+     * \returns The mesh id, or 0 if the pool has no room for it.
+     */
+    uint32_t add(const void *vertices, uint32_t vertex_count, const uint16_t *indices, uint32_t index_count);
+
+    /** Add a Mesh (all of its LODs). The pool's layout must be \
+     * VertexLayout::full().
+     * \param mesh The mesh.
+     * \returns The mesh id, or 0 if it doesn't fit or the layout differs.
+     */
+    uint32_t add(const Mesh &mesh);
+
+    /** Remove a mesh and free its ranges.
+     * \param id The mesh id.
+     */
+    void remove(uint32_t id);
+
+    /** Bind both buffers and enable the layout's attributes. Call once \
+     * before a run of draw() calls.
+     */
+    void bind();
+
+    /** Disable the layout's attributes. */
+    void unbind() const;
+
+    /** Draw a mesh (or part of its indices) as triangles; bind() first.
+     * Only the attribute pointers change between meshes.
+     * \param id The mesh id.
+     * \param first_index First index to draw, relative to the mesh.
+     * \param index_count Number of indices; clamped to the mesh's.
+     */
+    void draw(uint32_t id, uint32_t first_index = 0, uint32_t index_count = 0xFFFFFFFF);
+
+    /** Draw one LOD of a mesh added with add(const Mesh&); bind() first.
+     * \param id The mesh id.
+     * \param lod The level, from the same Mesh.
+     */
+    void draw(uint32_t id, const MeshLod &lod) {
+        draw(id, lod.indexOffset, lod.indexCount);
+    }
+
+    /** Slide meshes towards the start of the buffers, filling holes left \
+     * by removed ones. Call once a frame to spread the work out.
+     * \param max_bytes The most bytes to re-upload, across both buffers. \
+     * A range larger than this still moves if it is the first one.
+     * \returns The number of ranges moved.
+     */
+    uint32_t defragment(uint64_t max_bytes = 256 * 1024);
+
+    /** Get where a mesh's vertices start.
+     * \param id The mesh id.
+     * \returns The first vertex, in vertices from the buffer start.
+     */
+    uint32_t vertexOffset(uint32_t id) const;
+
+    /** Get where a mesh's indices start.
+     * \param id The mesh id.
+     * \returns The first index, in indices from the buffer start.
+     */
+    uint32_t indexOffset(uint32_t id) const;
+
+    /** Get the pool's occupancy.
+     * \returns The statistics.
+     */
+    GeometryPoolStats stats() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_GEOMETRYPOOL_H_
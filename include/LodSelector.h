@@ -0,0 +1,152 @@
+/***************************************************
+* LodSelector.h: Screen-space-error LOD selection  *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_LODSELECTOR_H_
+#define LYS3D_LODSELECTOR_H_
+
+#include "types.h"
+#include "Dimension2D.h"
+#include "IWindow.h"
+#include "Mesh.h"
+#include "Point3D.h"
+
+namespace lys3d {
+
+/** The renderer's visible list, as seen by LOD selection.
+ * Stored as separate arrays so distances can be computed several instances \
+ * at a time. levels persists between frames (one entry per instance) and is \
+ * updated in place, which is what makes the hysteresis work.
+ */
+struct LodVisibleList {
+    Vector<float> centerX, centerY, centerZ, radius;
+    Vector<const Mesh*> meshes;
+    Vector<uint8_t> levels;
+
+    /** Remove all instances. */
+    void clear() {
+        centerX.clear();
+        centerY.clear();
+        centerZ.clear();
+        radius.clear();
+        meshes.clear();
+        levels.clear();
+    }
+
+    /** Append an instance.
+     * \param center World-space center of the instance's bounding sphere.
+     * \param bounds_radius World-space radius of the bounding sphere. Also \
+     * scales the chain's errors, relative to the mesh's own boundsRadius().
+     * \param mesh The mesh (and LOD chain) being drawn.
+     * \param level The level the instance was drawn with last frame.
+     */
+    void add(const Point3Df &center, float bounds_radius, const Mesh *mesh, uint8_t level = 0) {
+        centerX.push_back(center.x());
+        centerY.push_back(center.y());
+        centerZ.push_back(center.z());
+        radius.push_back(bounds_radius);
+        meshes.push_back(mesh);
+        levels.push_back(level);
+    }
+
+    /** Get the number of instances.
+     * \returns The instance count.
+     */
+    size_t size() const {
+        return meshes.size();
+    }
+};
+
+/** Counters from the last LodSelector::select() call. */
+struct LodStats {
+    /** Instances processed. */
+    uint32_t instances = 0;
+    /** Triangles that would have been drawn with level 0 everywhere. */
+    uint64_t fullDetailTriangles = 0;
+    /** Triangles in the selected levels. */
+    uint64_t selectedTriangles = 0;
+};
+
+/** Picks the coarsest level whose geometric error stays under a pixel \
+ * threshold once projected to the screen.
+ */
+class LYS_API LodSelector {
+  public:
+    /** Default constructor.
+     * Assumes a 60 degree vertical FOV on a 1080-pixel-high viewport, a 1 \
+     * pixel error threshold and 25% hysteresis.
+     */
+    LodSelector();
+    ~LodSelector() = default;
+
+    /** Set up the projection scale from a window.
+     * Uses sizeInPixels(), so call again whenever the drawable size changes.
+     * \param window The window being rendered to.
+     * \param fov_y Vertical field of view, in radians.
+     */
+    void projection(const IWindow &window, float fov_y);
+
+    /** Set up the projection scale from a viewport size.
+     * \param viewport Viewport size, in pixels.
+     * \param fov_y Vertical field of view, in radians.
+     */
+    void projection(const Dimension2Di32 &viewport, float fov_y);
+
+    /** Get the pixel error threshold.
+     * \returns The largest allowed projected error, in pixels.
+     */
+    float threshold() const {
+        return threshold_;
+    }
+
+    /** Set the pixel error threshold.
+     * \param pixels The largest allowed projected error, in pixels.
+     */
+    void threshold(float pixels) {
+        threshold_ = pixels;
+    }
+
+    /** Get the hysteresis.
+     * \returns How far (as a fraction of the threshold) the error must drop \
+     * below the threshold before switching to a coarser level.
+     */
+    float hysteresis() const {
+        return hysteresis_;
+    }
+
+    /** Set the hysteresis.
+     * \param fraction How far (0-1, as a fraction of the threshold) the error \
+     * must drop below the threshold before switching to a coarser level.
+     */
+    void hysteresis(float fraction) {
+        hysteresis_ = fraction;
+    }
+
+    /** Select levels for every instance in a visible list.
+     * \param camera World-space camera position.
+     * \param list The visible instances; levels is updated in place.
+     */
+    void select(const Point3Df &camera, LodVisibleList *list);
+
+    /** Get the counters from the last select() call.
+     * \returns Triangle counts with and without LOD.
+     */
+    const LodStats& stats() const {
+        return stats_;
+    }
+
+  private:
+    float projScale_;
+    float threshold_;
+    float hysteresis_;
+    LodStats stats_;
+    Vector<float> pixelsPerUnit_;
+};
+}
+#endif // LYS3D_LODSELECTOR_H_
@@ -0,0 +1,349 @@
+/***************************************************
+* Material.h: Materials & shader permutations     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_MATERIAL_H_
+#define LYS3D_MATERIAL_H_
+
+#include "types.h"
+#include "ShaderProgram.h"
+
+namespace lys3d {
+
+/** Shader features a material can turn on. Every combination is a \
+ * separate program, compiled with a MATERIAL_* define per feature, so \
+ * shaders select code with #ifdef rather than branch at runtime.
+ */
+enum MaterialFeature : uint32_t {
+    kMaterialNormalMap = 1 << 0,  ///< MATERIAL_NORMAL_MAP: tangent-space normal map
+    kMaterialEmissive = 1 << 1,   ///< MATERIAL_EMISSIVE: self-lit color
+    kMaterialSkinning = 1 << 2,   ///< MATERIAL_SKINNING: vertices follow a_joints/a_weights
+    kMaterialFog = 1 << 3,        ///< MATERIAL_FOG: distance fog
+    kMaterialPermutationCount = 1 << 4
+};
+
+/** Per-material parameters, each a vec4 in the material's uniform block.
+ * Shaders declare the block as `uniform vec4 u_material[MATERIAL_SLOTS];` \
+ * and index it with the MATERIAL_* slot defines.
+ */
+enum MaterialParam : uint32_t {
+    kMaterialBaseColor = 0,  ///< MATERIAL_BASE_COLOR: RGBA
+    kMaterialSurface,        ///< MATERIAL_SURFACE: roughness, metalness, normal scale, alpha cutoff
+    kMaterialEmissiveColor,  ///< MATERIAL_EMISSIVE_COLOR: RGB, intensity (with kMaterialEmissive)
+    kMaterialFogColor,       ///< MATERIAL_FOG_COLOR: RGB, density (with kMaterialFog)
+    kMaterialParamCount
+};
+
+/** Get where a parameter lives in a permutation's uniform block. Optional \
+ * parameters follow the ones every material has, in MaterialParam order, \
+ * so the block holds only what the permutation uses.
+ * \param features The permutation's MaterialFeature flags.
+ * \param param The parameter.
+ * \returns The vec4 index, or -1 if the permutation has no such parameter.
+ */
+constexpr int32_t materialSlot(uint32_t features, MaterialParam param) {
+    return param == kMaterialBaseColor ? 0
+         : param == kMaterialSurface ? 1
+         : param == kMaterialEmissiveColor ? ((features & kMaterialEmissive) ? 2 : -1)
+         : param == kMaterialFogColor ? ((features & kMaterialFog) ? 2 + ((features & kMaterialEmissive) ? 1 : 0) : -1)
+         : -1;
+}
+
+/** Get the size of a permutation's uniform block.
+ * \param features The permutation's MaterialFeature flags.
+ * \returns The number of vec4s.
+ */
+constexpr uint32_t materialSlotCount(uint32_t features) {
+    return 2 + ((features & kMaterialEmissive) ? 1 : 0) + ((features & kMaterialFog) ? 1 : 0);
+}
+
+/** The largest uniform block, in vec4s. */
+static const uint32_t kMaterialMaxSlots = materialSlotCount(kMaterialPermutationCount - 1);
+
+/** A permutation's layout as compile-time constants, for code that knows \
+ * its features when it is built.
+ */
+template <uint32_t Features>
+struct MaterialPermutation {
+    static_assert(Features < kMaterialPermutationCount, "Unknown material feature");
+
+    /** The MaterialFeature flags. */
+    static const uint32_t kFeatures = Features;
+
+    /** The uniform block size, in vec4s. */
+    static const uint32_t kSlots = materialSlotCount(Features);
+
+    /** Where a parameter lives; using one the permutation lacks fails to \
+     * compile.
+     */
+    template <MaterialParam Param>
+    struct Slot {
+        static_assert(materialSlot(Features, Param) >= 0, "The permutation has no such parameter");
+        static const uint32_t kIndex = static_cast<uint32_t>(materialSlot(Features, Param));
+    };
+};
+
+
+/** A set of permutations of one material shader, compiled up front (at \
+ * load time) so drawing never waits on the compiler.
+ */
+class LYS_API MaterialShader {
+  public:
+    /** Default constructor. Builds nothing. */
+    MaterialShader();
+
+    /** Destructor. Deletes the programs. */
+    ~MaterialShader();
+
+    MaterialShader(const MaterialShader& other) = delete;
+    MaterialShader& operator=(const MaterialShader& other) = delete;
+
+    /** Get the defines a permutation is compiled with.
+     * \param features The MaterialFeature flags.
+     * \returns The feature defines, MATERIAL_SLOTS and the slot of every \
+     * parameter the permutation has.
+     */
+    static String defines(uint32_t features);
+
+    /** Compile and link permutations in the current GL context, replacing \
+     * any built before. Their uniform blocks start out unknown, so the \
+     * first bind uploads them whole.
+     * \param vertex_source Vertex shader source.
+     * \param fragment_source Fragment shader source.
+     * \param feature_sets The permutations to build, as MaterialFeature \
+     * flags; empty for all of them.
+     * \returns True if all were built; false if any failed (see log()), \
+     * though the rest are still usable.
+     */
+    bool build(const String &vertex_source, const String &fragment_source,
+               const Vector<uint32_t> &feature_sets = Vector<uint32_t>());
+
+    /** Delete every permutation. */
+    void destroy();
+
+    /** Get a built permutation.
+     * \param features The MaterialFeature flags.
+     * \returns The program, or nullptr if it wasn't built.
+     */
+    const ShaderProgram* program(uint32_t features) const;
+
+    /** Get the number of built permutations.
+     * \returns The count.
+     */
+    uint32_t programCount() const;
+
+    /** Get the compile/link log of the last build().
+     * \returns The messages of the permutations that failed, each after \
+     * its defines.
+     */
+    const String& log() const;
+
+    /** Get the index that leads the sort keys of this shader's materials.
+     * \returns A number from 0 to 255, handed out in construction order.
+     */
+    uint32_t index() const;
+
+  private:
+    friend class MaterialBinder;
+    struct Impl;
+    Impl *pimpl_;
+};
+
+
+/** One material: a shader permutation plus the values of its uniform \
+ * block. Setting a value only changes memory; MaterialBinder uploads \
+ * what changed when the material is next bound.
+ */
+class LYS_API Material {
+  public:
+    /** Constructor. Starts with white, half-rough, non-metallic values, no \
+     * emission and fog of zero density.
+     * \param shader The shader it draws with. Must outlive the material.
+     * \param features The permutation, as MaterialFeature flags.
+     */
+    Material(const MaterialShader *shader, uint32_t features);
+
+    Material(const Material& other) = delete;
+    Material& operator=(const Material& other) = delete;
+
+    /** Get the shader.
+     * \returns The shader it draws with.
+     */
+    const MaterialShader* shader() const {
+        return shader_;
+    }
+
+    /** Get the permutation.
+     * \returns The MaterialFeature flags.
+     */
+    uint32_t features() const {
+        return features_;
+    }
+
+    /** Get the material's id, unique among the last 2^20 materials made.
+     * \returns The id.
+     */
+    uint32_t id() const {
+        return id_;
+    }
+
+    /** Get the key to sort a render queue by: shader index in the top 8 \
+     * bits, features in the next 4 and id in the low 20, so draws group by \
+     * program first and by material within it.
+     * \returns The key.
+     */
+    uint32_t sortKey() const {
+        return sortKey_;
+    }
+
+    /** Set a parameter.
+     * \param param The parameter.
+     * \param x, y, z, w The values (see MaterialParam).
+     * \returns False if the permutation has no such parameter.
+     */
+    bool set(MaterialParam param, float x, float y, float z, float w);
+
+    /** Get a parameter.
+     * \param param The parameter.
+     * \param values Receives the four values.
+     * \returns False if the permutation has no such parameter.
+     */
+    bool get(MaterialParam param, float values[4]) const;
+
+    /** Get the uniform block.
+     * \returns slotCount() vec4s.
+     */
+    const float* block() const {
+        return block_;
+    }
+
+    /** Get the uniform block size.
+     * \returns The number of vec4s.
+     */
+    uint32_t slotCount() const {
+        return materialSlotCount(features_);
+    }
+
+    /** Get a stamp that changes with every set(); no two materials share \
+     * one, so equal stamps mean equal blocks.
+     * \returns The stamp.
+     */
+    uint64_t stamp() const {
+        return stamp_;
+    }
+
+  protected:
+    /** Set a slot of the uniform block.
+     * \param slot The vec4 index.
+     * \param x, y, z, w The values.
+     */
+    void setSlot(uint32_t slot, float x, float y, float z, float w);
+
+  private:
+    const MaterialShader *shader_;
+    uint32_t features_;
+    uint32_t id_;
+    uint32_t sortKey_;
+    uint64_t stamp_;
+    float block_[kMaterialMaxSlots * 4];
+};
+
+
+/** A material whose permutation is known at compile time, so parameters \
+ * go straight to their slot and setting one the permutation lacks fails \
+ * to compile.
+ */
+template <uint32_t Features>
+class StaticMaterial : public Material {
+  public:
+    /** Constructor.
+     * \param shader The shader it draws with. Must outlive the material.
+     */
+    explicit StaticMaterial(const MaterialShader *shader) : Material(shader, Features) {}
+
+    /** Set a parameter.
+     * \param x, y, z, w The values (see MaterialParam).
+     */
+    template <MaterialParam Param>
+    void set(float x, float y, float z, float w) {
+        setSlot(MaterialPermutation<Features>::template Slot<Param>::kIndex, x, y, z, w);
+    }
+};
+
+
+/** Work out which part of a uniform block a program needs uploaded: the \
+ * range from the first to the last vec4 that differs from what it holds.
+ * \param stamp The material's Material::stamp().
+ * \param resident_stamp The stamp of the block the program holds; 0 if \
+ * it holds nothing known yet.
+ * \param block The material's block.
+ * \param resident The block the program holds.
+ * \param slots The number of vec4s to compare.
+ * \param first Receives the first vec4 to upload.
+ * \returns The number of vec4s to upload: 0 if the stamps match or \
+ * nothing differs, every slot if the resident block is unknown.
+ */
+LYS_API uint32_t materialUploadRange(uint64_t stamp, uint64_t resident_stamp, const float *block,
+                                     const float *resident, uint32_t slots, uint32_t *first);
+
+
+/** What a MaterialBinder did since its stats were last reset. */
+struct MaterialBindStats {
+    /** Materials bound. */
+    uint32_t binds = 0;
+    /** glUseProgram calls. */
+    uint32_t programChanges = 0;
+    /** glUniform4fv calls. */
+    uint32_t uniformCalls = 0;
+    /** vec4s uploaded. */
+    uint32_t uploadedSlots = 0;
+};
+
+/** Makes materials current with as few GL calls as it can.
+ * Each program keeps the uniform block it was last given, so binding a \
+ * material compares its block with that copy and uploads only the range \
+ * between the first and last vec4 that differ, in one glUniform4fv() call \
+ * (none if the program last saw the same stamp). Draws sorted by \
+ * Material::sortKey() also switch programs least.
+ */
+class LYS_API MaterialBinder {
+  public:
+    /** Default constructor. Assumes no program is current. */
+    MaterialBinder();
+
+    /** Make a material current: switch to its program if needed and upload \
+     * what changed in its uniform block. Needs a current GL context.
+     * \param material The material.
+     * \returns False if its permutation wasn't built.
+     */
+    bool bind(const Material &material);
+
+    /** Forget which program is current, e.g. after other code called \
+     * glUseProgram(). Rebuilding or destroying any MaterialShader does \
+     * this too, as program names may be reused.
+     */
+    void reset();
+
+    /** Get the statistics.
+     * \returns The counts since the last resetStats().
+     */
+    const MaterialBindStats& stats() const {
+        return stats_;
+    }
+
+    /** Reset the statistics, e.g. at the start of a frame. */
+    void resetStats();
+
+  private:
+    uint32_t current_;
+    uint32_t generation_;
+    MaterialBindStats stats_;
+};
+}
+#endif // LYS3D_MATERIAL_H_
@@ -0,0 +1,144 @@
+/***************************************************
+* Mesh.h: Indexed triangle mesh with LOD chain     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_MESH_H_
+#define LYS3D_MESH_H_
+
+#include <stddef.h>
+
+#include "types.h"
+#include "Point3D.h"
+
+namespace lys3d {
+
+/** Full-precision vertex, as stored in mesh assets. */
+struct MeshVertex {
+    float position[3];
+    float normal[3];
+    float uv[2];
+};
+
+/** One level of detail: a range of the mesh's index buffer. */
+struct MeshLod {
+    /** First index of the level in the mesh's index buffer. */
+    uint32_t indexOffset;
+    /** Number of indices (3 per triangle) in the level. */
+    uint32_t indexCount;
+    /** Maximum distance between the level's surface and the full-detail \
+     * surface, in model units. 0 for the full-detail level.
+     */
+    float error;
+};
+
+/** An indexed triangle list with an optional chain of simplified levels.
+ * All levels share one vertex array and one index array, with level 0 being \
+ * full detail. Indices are 16-bit since that is all GLES2 guarantees.
+ *
+ * The asset format ("LYSM", little-endian) is:
+ * - header: magic, version, vertex count, index count, LOD count, \
+ *   bounding sphere (center xyz, radius), all 32-bit
+ * - LOD table: MeshLod entries, coarsest last
+ * - vertices: MeshVertex entries
+ * - indices: 16-bit, padded to a multiple of 4 bytes
+ */
+class LYS_API Mesh {
+  public:
+    /** Default constructor. Creates an empty mesh. */
+    Mesh() = default;
+    ~Mesh() = default;
+
+    /** Get the vertex array.
+     * \returns The shared vertices of all levels.
+     */
+    Vector<MeshVertex>& vertices() {
+        return vertices_;
+    }
+    const Vector<MeshVertex>& vertices() const {
+        return vertices_;
+    }
+
+    /** Get the index array.
+     * \returns The indices of all levels, back-to-back.
+     */
+    Vector<uint16_t>& indices() {
+        return indices_;
+    }
+    const Vector<uint16_t>& indices() const {
+        return indices_;
+    }
+
+    /** Get the LOD chain.
+     * \returns The levels of detail, finest (level 0) first.
+     */
+    Vector<MeshLod>& lods() {
+        return lods_;
+    }
+    const Vector<MeshLod>& lods() const {
+        return lods_;
+    }
+
+    /** Reset the LOD chain to a single full-detail level spanning all indices.
+     * Call after filling in the index array by hand.
+     */
+    void resetLods();
+
+    /** Get the number of triangles in a level.
+     * \param lod The level index.
+     * \returns The triangle count, or 0 if the level doesn't exist.
+     */
+    uint32_t triangleCount(size_t lod = 0) const;
+
+    /** Recompute the bounding sphere from the vertex positions. */
+    void computeBounds();
+
+    /** Get the center of the bounding sphere.
+     * \returns The sphere center, in model space.
+     */
+    const Point3Df& boundsCenter() const {
+        return boundsCenter_;
+    }
+
+    /** Get the radius of the bounding sphere.
+     * \returns The sphere radius, in model units.
+     */
+    float boundsRadius() const {
+        return boundsRadius_;
+    }
+
+    /** Load a mesh asset through PhysFS.
+     * \param path The PhysFS path of the asset.
+     * \returns True on success; false on failure, leaving the mesh empty.
+     */
+    bool load(const String &path);
+
+    /** Load a mesh asset from memory.
+     * \param data The asset contents.
+     * \param size The size of the asset, in bytes.
+     * \returns True on success; false on failure, leaving the mesh empty.
+     */
+    bool loadFromMemory(const void *data, size_t size);
+
+    /** Serialize the mesh into the asset format.
+     * \param out Receives the asset contents (replacing anything in it).
+     */
+    void saveToMemory(Vector<uint8_t> *out) const;
+
+    /** Remove all data from the mesh. */
+    void clear();
+
+  private:
+    Vector<MeshVertex> vertices_;
+    Vector<uint16_t> indices_;
+    Vector<MeshLod> lods_;
+    Point3Df boundsCenter_;
+    float boundsRadius_ = 0.0f;
+};
+}
+#endif // LYS3D_MESH_H_
@@ -0,0 +1,125 @@
+/***************************************************
+* MeshOptimizer.h: Index & vertex order tuning     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_MESHOPTIMIZER_H_
+#define LYS3D_MESHOPTIMIZER_H_
+
+#include <stddef.h>
+
+#include "types.h"
+#include "Mesh.h"
+
+namespace lys3d {
+
+/** Post-transform vertex cache efficiency of an index buffer, measured by \
+ * simulating a FIFO cache.
+ */
+struct VertexCacheStats {
+    /** Cache misses (vertex shader invocations). */
+    uint32_t misses = 0;
+    /** Triangles in the index buffer. */
+    uint32_t triangles = 0;
+    /** Distinct vertices referenced by the index buffer. */
+    uint32_t vertices = 0;
+    /** Average cache miss ratio: misses per triangle (0.5 is ideal, 3 worst). */
+    float acmr = 0.0f;
+    /** Average transformed vertex ratio: misses per vertex (1.0 is ideal). */
+    float atvr = 0.0f;
+};
+
+/** Reorders mesh data for GPUs with small post-transform caches.
+ * - Triangles are reordered with Forsyth's linear-speed vertex cache \
+ *   optimization, which only assumes an LRU-ish cache of some size.
+ * - Optionally, the result is cut into clusters that are sorted outside-in \
+ *   so front-facing geometry tends to be drawn first (less overdraw), \
+ *   only cutting where it doesn't hurt the cache much.
+ * - Vertices are then renumbered in order of first use, for fetch locality.
+ */
+class LYS_API MeshOptimizer {
+  public:
+    /** Default constructor. Models a 16-entry FIFO, with overdraw sorting on. */
+    MeshOptimizer() = default;
+    ~MeshOptimizer() = default;
+
+    /** Get the cache size used for optimization and analysis.
+     * \returns The number of cache entries.
+     */
+    uint32_t cacheSize() const {
+        return cacheSize_;
+    }
+
+    /** Set the cache size used for optimization and analysis.
+     * \param entries The number of cache entries (at most 32).
+     */
+    void cacheSize(uint32_t entries) {
+        cacheSize_ = entries < 3 ? 3 : (entries > 32 ? 32 : entries);
+    }
+
+    /** Check whether optimize() reorders clusters for overdraw.
+     * \returns True if overdraw optimization is enabled.
+     */
+    bool isOverdrawEnabled() const {
+        return overdraw_;
+    }
+
+    /** Enable or disable overdraw optimization in optimize().
+     * \param enable True to sort clusters, false for pure cache ordering.
+     * \param threshold How much worse than the fully cache-optimized order \
+     * (as an ACMR ratio) a cluster may be before it can be cut off.
+     */
+    void useOverdraw(bool enable, float threshold = 1.05f) {
+        overdraw_ = enable;
+        overdrawThreshold_ = threshold;
+    }
+
+    /** Run all optimizations on every level of a mesh.
+     * Each LOD's triangles are reordered in place, except where a level \
+     * shares indices with an earlier one; then the shared vertex array is \
+     * renumbered in order of first use across the chain.
+     * \param mesh The mesh to optimize.
+     */
+    void optimize(Mesh *mesh) const;
+
+    /** Reorder triangles for the vertex cache.
+     * \param indices The triangle list to reorder in place.
+     * \param count Number of indices.
+     * \param vertex_count One more than the largest index.
+     */
+    void optimizeVertexCache(uint16_t *indices, size_t count, size_t vertex_count) const;
+
+    /** Reorder cache-optimized triangles in clusters to reduce overdraw.
+     * \param indices The triangle list, already cache-optimized.
+     * \param count Number of indices.
+     * \param vertices The vertices the indices refer to.
+     */
+    void optimizeOverdraw(uint16_t *indices, size_t count, const Vector<MeshVertex> &vertices) const;
+
+    /** Renumber a mesh's vertices in order of first use (across all levels) \
+     * and drop unused ones. Indices shared by several levels are renumbered \
+     * once.
+     * \param mesh The mesh to reorder.
+     */
+    void optimizeVertexFetch(Mesh *mesh) const;
+
+    /** Measure the vertex cache efficiency of a triangle list.
+     * \param indices The triangle list.
+     * \param count Number of indices.
+     * \param vertex_count One more than the largest index.
+     * \returns The miss counts and ratios for a FIFO of cacheSize() entries.
+     */
+    VertexCacheStats analyze(const uint16_t *indices, size_t count, size_t vertex_count) const;
+
+  private:
+    uint32_t cacheSize_ = 16;
+    bool overdraw_ = true;
+    float overdrawThreshold_ = 1.05f;
+};
+}
+#endif // LYS3D_MESHOPTIMIZER_H_
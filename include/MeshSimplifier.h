@@ -0,0 +1,76 @@
+/***************************************************
+* MeshSimplifier.h: LOD chain generation           *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_MESHSIMPLIFIER_H_
+#define LYS3D_MESHSIMPLIFIER_H_
+
+#include "types.h"
+#include "Mesh.h"
+
+namespace lys3d {
+
+/** Builds a mesh's LOD chain by quadric-weighted vertex clustering.
+ * Each level snaps vertices onto a grid twice as coarse as the last useful \
+ * one, places every cell's vertex at the point minimizing the squared \
+ * distance to the planes it replaced, and drops collapsed triangles. The \
+ * error stored in each MeshLod is the largest distance any original vertex \
+ * moved. Meant for offline use (see tools/meshlod.cc), but is fast enough \
+ * to run at load time for small meshes.
+ */
+class LYS_API MeshSimplifier {
+  public:
+    /** Default constructor. Allows up to 4 levels (including full detail). */
+    MeshSimplifier() = default;
+    ~MeshSimplifier() = default;
+
+    /** Get the maximum number of levels to generate.
+     * \returns The maximum chain length, including level 0.
+     */
+    uint32_t maxLods() const {
+        return maxLods_;
+    }
+
+    /** Set the maximum number of levels to generate.
+     * \param max_lods The maximum chain length, including level 0.
+     */
+    void maxLods(uint32_t max_lods) {
+        maxLods_ = max_lods;
+    }
+
+    /** Get the minimum triangle reduction between consecutive levels.
+     * \returns The fraction of triangles a level must remove to be kept.
+     */
+    float minReduction() const {
+        return minReduction_;
+    }
+
+    /** Set the minimum triangle reduction between consecutive levels.
+     * \param fraction The fraction (0-1) of triangles a level must remove \
+     * relative to the previous one to be kept.
+     */
+    void minReduction(float fraction) {
+        minReduction_ = fraction;
+    }
+
+    /** Replace a mesh's LOD chain with newly generated levels.
+     * Level 0 is kept as-is (unused vertices are dropped); new levels get \
+     * their own vertices appended to the mesh. Stops early if the 16-bit \
+     * index range would overflow.
+     * \param mesh The mesh to simplify.
+     * \returns The number of levels in the resulting chain.
+     */
+    uint32_t generate(Mesh *mesh) const;
+
+  private:
+    uint32_t maxLods_ = 4;
+    float minReduction_ = 0.4f;
+};
+}
+#endif // LYS3D_MESHSIMPLIFIER_H_
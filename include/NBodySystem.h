@@ -0,0 +1,180 @@
+/***************************************************
+* NBodySystem.h: Barnes-Hut gravity simulation     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_NBODYSYSTEM_H_
+#define LYS3D_NBODYSYSTEM_H_
+
+#include "types.h"
+#include "Point3D.h"
+
+namespace lys3d {
+
+/** Construction-time settings of an NBodySystem. */
+struct NBodySettings {
+    /** Gravitational constant; the default is SI. */
+    double gravity = 6.674e-11;
+    /** Barnes-Hut opening angle: a cell is used as a single mass when its \
+     * size is below this times its distance. 0 sums every pair exactly.
+     */
+    double theta = 0.5;
+    /** Plummer softening length, keeping close encounters finite. */
+    double softening = 0.0;
+    /** Most bodies in an octree leaf, from 1 to 64. Leaves are also the \
+     * groups that share a tree walk.
+     */
+    uint32_t leafSize = 16;
+    /** Worker threads; the calling thread works too. */
+    uint32_t workers = 2;
+};
+
+/** What the last step (or computeAccelerations()) did. */
+struct NBodyStats {
+    /** Bodies simulated. */
+    uint32_t bodies = 0;
+    /** Octree nodes, and the leaves among them. */
+    uint32_t nodes = 0;
+    uint32_t leaves = 0;
+    /** Body-body and body-cell interactions summed. */
+    uint64_t interactions = 0;
+    /** Time spent drifting bodies and building the octree, in \
+     * milliseconds.
+     */
+    float buildMs = 0.0f;
+    /** Time spent walking the octree and summing forces, in milliseconds. */
+    float forceMs = 0.0f;
+};
+
+/** Simulates many gravitating bodies, such as asteroid belts and debris \
+ * clouds.
+ * Each step is a kick-drift-kick leapfrog, which is symplectic: energy \
+ * errors stay bounded instead of growing, so orbits don't spiral in or out \
+ * over long runs. Velocities are in sync with positions between steps.
+ * Accelerations come from a Barnes-Hut octree, rebuilt every step: bodies \
+ * are sorted along a Morton curve and split into 512 cells, which are \
+ * sorted and turned into subtrees in parallel. Each leaf then walks the \
+ * tree once for all its bodies, gathering the cells far enough away and \
+ * the bodies of the leaves that aren't, and the forces from that list are \
+ * summed in double precision, two or four pairs at a time with SSE2 or \
+ * AVX. Cost grows as n log n, against n^2 for directAccelerations().
+ * Bodies keep the index add() returned.
+ */
+class LYS_API NBodySystem {
+  public:
+    /** Constructor. Starts the worker threads.
+     * \param settings The simulation settings.
+     */
+    explicit NBodySystem(const NBodySettings &settings = NBodySettings());
+
+    /** Destructor. Stops the worker threads. */
+    ~NBodySystem();
+
+    NBodySystem(const NBodySystem& other) = delete;
+    NBodySystem& operator=(const NBodySystem& other) = delete;
+
+    /** Get the settings.
+     * \returns The settings, with leafSize clamped.
+     */
+    const NBodySettings& settings() const;
+
+    /** Add a body.
+     * \param position The body's position.
+     * \param velocity The body's velocity.
+     * \param mass The body's mass; 0 makes a test particle that feels \
+     * gravity without pulling on anything.
+     * \returns The body's index.
+     */
+    uint32_t add(const Point3Dd &position, const Point3Dd &velocity, double mass);
+
+    /** Remove every body. */
+    void clear();
+
+    /** Get the number of bodies.
+     * \returns The number of bodies.
+     */
+    uint32_t size() const;
+
+    /** Get a body's position.
+     * \param body The body's index.
+     * \returns The position.
+     */
+    Point3Dd position(uint32_t body) const;
+
+    /** Move a body.
+     * \param body The body's index.
+     * \param position The new position.
+     */
+    void position(uint32_t body, const Point3Dd &position);
+
+    /** Get a body's velocity.
+     * \param body The body's index.
+     * \returns The velocity.
+     */
+    Point3Dd velocity(uint32_t body) const;
+
+    /** Set a body's velocity.
+     * \param body The body's index.
+     * \param velocity The new velocity.
+     */
+    void velocity(uint32_t body, const Point3Dd &velocity);
+
+    /** Get a body's mass.
+     * \param body The body's index.
+     * \returns The mass.
+     */
+    double mass(uint32_t body) const;
+
+    /** Set a body's mass.
+     * \param body The body's index.
+     * \param mass The new mass.
+     */
+    void mass(uint32_t body, double mass);
+
+    /** Get a body's acceleration, as of the last step or \
+     * computeAccelerations().
+     * \param body The body's index.
+     * \returns The acceleration.
+     */
+    Point3Dd acceleration(uint32_t body) const;
+
+    /** Advance the simulation. Accelerations are computed first if bodies \
+     * were added or changed since the last step.
+     * \param seconds The time step; keep it constant for the leapfrog's \
+     * long-term stability.
+     */
+    void step(double seconds);
+
+    /** Build the octree and compute every body's acceleration, without \
+     * moving anything.
+     */
+    void computeAccelerations();
+
+    /** Sum every pair exactly, as a reference for the octree. Takes n^2 \
+     * time, on all threads.
+     * \param out Receives size() accelerations.
+     */
+    void directAccelerations(Point3Dd *out);
+
+    /** Get the total energy, kinetic plus (softened) potential. Sums every \
+     * pair, so it's meant for checking the integration, not for each frame.
+     * \returns The energy.
+     */
+    double energy();
+
+    /** Get the last step's statistics.
+     * \returns The statistics.
+     */
+    const NBodyStats& stats() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_NBODYSYSTEM_H_
@@ -0,0 +1,163 @@
+/***************************************************
+* OcclusionCuller.h: CPU depth-buffer culling      *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_OCCLUSIONCULLER_H_
+#define LYS3D_OCCLUSIONCULLER_H_
+
+#include "types.h"
+#include "Box3D.h"
+#include "Dimension2D.h"
+
+namespace lys3d {
+
+/** Counters from the current frame of an OcclusionCuller. */
+struct OcclusionStats {
+    /** Occluders added since beginFrame(). */
+    uint32_t occluders = 0;
+    /** Occluder triangles left after near-plane clipping and backface \
+     * culling.
+     */
+    uint32_t triangles = 0;
+    /** Boxes tested. */
+    uint32_t tested = 0;
+    /** Boxes found hidden or outside the view. */
+    uint32_t culled = 0;
+    /** Time spent transforming, binning and rasterizing occluders, in \
+     * milliseconds.
+     */
+    float rasterMs = 0.0f;
+    /** Time spent testing boxes, in milliseconds. */
+    float testMs = 0.0f;
+
+    /** Get the share of tested boxes that were culled.
+     * \returns The percentage, from 0 to 100.
+     */
+    float culledPercent() const {
+        return tested > 0 ? 100.0f * culled / tested : 0.0f;
+    }
+};
+
+/** Hides objects behind large occluders before they're submitted, for GL \
+ * implementations without occlusion queries.
+ * A few low-poly occluders are rasterized into a small depth buffer on the \
+ * CPU, several pixels at a time with SSE2 or AVX when available. The buffer \
+ * is split into tiles, which worker threads rasterize in parallel, and \
+ * every 8x8 block also keeps its farthest depth. Bounding boxes are then \
+ * projected and tested against the blocks first, and against single pixels \
+ * only where a block is inconclusive.
+ * Occluder coverage is sampled at pixel centers, so occluders should be \
+ * slightly smaller than the geometry they stand in for. Matrices are 4x4, \
+ * column-major, as passed to glUniformMatrix4fv.
+ *
+ * Typical frame:
+ * \code
+ * culler.beginFrame(view_projection);
+ * for (const Occluder &o : occluders)
+ *     culler.addOccluder(o.positions, o.vertexCount, o.indices, o.indexCount, o.model);
+ * culler.rasterize();
+ * for (Object &object : objects)
+ *     object.visible = culler.isVisible(object.bounds);
+ * \endcode
+ */
+class LYS_API OcclusionCuller {
+  public:
+    /** Width and height of the tiles handed to worker threads, in pixels. */
+    static const int32_t kTileWidth = 64;
+    static const int32_t kTileHeight = 32;
+    /** Size of the blocks that keep a farthest depth, in pixels. */
+    static const int32_t kBlockSize = 8;
+
+    /** Constructor.
+     * \param resolution Size of the depth buffer; rounded up to multiples \
+     * of kBlockSize.
+     * \param workers Worker threads to start. The calling thread rasterizes \
+     * tiles too, so 0 keeps everything on it.
+     */
+    explicit OcclusionCuller(const Dimension2Di32 &resolution = Dimension2Di32(256, 128), uint32_t workers = 2);
+
+    /** Destructor. Stops the worker threads. */
+    ~OcclusionCuller();
+
+    OcclusionCuller(const OcclusionCuller& other) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller& other) = delete;
+
+    /** Check whether culling is enabled.
+     * \returns True if enabled (the default).
+     */
+    bool isEnabled() const;
+
+    /** Turn culling on or off. While disabled, occluders are ignored and \
+     * every box is visible, at the cost of a branch.
+     * \param enable True to cull.
+     */
+    void enable(bool enable = true);
+
+    /** Get the depth buffer size.
+     * \returns The size in pixels.
+     */
+    const Dimension2Di32& resolution() const;
+
+    /** Start a frame: clear the depth buffer and the counters.
+     * \param view_projection The camera's view-projection matrix.
+     */
+    void beginFrame(const float view_projection[16]);
+
+    /** Add an occluder mesh. Its front faces are counter-clockwise.
+     * \param positions Vertex positions, three floats each.
+     * \param vertex_count Number of vertices.
+     * \param indices Triangle list.
+     * \param index_count Number of indices.
+     * \param model Model matrix, or nullptr if positions are in world space.
+     * \param stride Bytes from one position to the next; 0 if tightly packed.
+     */
+    void addOccluder(const float *positions, uint32_t vertex_count, const uint16_t *indices,
+                     uint32_t index_count, const float model[16] = nullptr, uint32_t stride = 0);
+
+    /** Add a solid box as an occluder (e.g. a wall or a hull section).
+     * \param box The world-space box.
+     */
+    void addOccluder(const Box3Df &box);
+
+    /** Rasterize the occluders added since beginFrame(), sharing the tiles \
+     * among the worker threads. Call before testing.
+     */
+    void rasterize();
+
+    /** Test a box against the depth buffer.
+     * \param box The world-space bounding box.
+     * \returns False if the box is hidden by occluders or outside the view.
+     */
+    bool isVisible(const Box3Df &box);
+
+    /** Test many boxes.
+     * \param boxes The world-space bounding boxes.
+     * \param count Number of boxes.
+     * \param visible Receives 1 for each visible box and 0 for culled ones.
+     * \returns The number of visible boxes.
+     */
+    uint32_t cull(const Box3Df *boxes, size_t count, uint8_t *visible);
+
+    /** Get the depth buffer, for debugging. Rows start at the bottom; \
+     * values are window depths from 0 (near) to 1 (far or empty).
+     * \returns resolution().width() * resolution().height() depths.
+     */
+    const float* depth() const;
+
+    /** Get the counters for the current frame.
+     * \returns The statistics.
+     */
+    const OcclusionStats& stats() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_OCCLUSIONCULLER_H_
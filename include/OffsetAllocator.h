@@ -0,0 +1,136 @@
+/***************************************************
+* OffsetAllocator.h: TLSF range sub-allocation     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_OFFSETALLOCATOR_H_
+#define LYS3D_OFFSETALLOCATOR_H_
+
+#include "types.h"
+
+namespace lys3d {
+
+/** A range handed out by OffsetAllocator. */
+struct OffsetAllocation {
+    /** Marks a failed allocation. */
+    static const uint32_t kNoSpace = 0xFFFFFFFF;
+
+    uint32_t offset;
+    uint32_t size;
+    /** Internal node index; kNoSpace if the allocation failed. */
+    uint32_t node;
+
+    bool isValid() const {
+        return node != kNoSpace;
+    }
+};
+
+/** Hands out ranges of a fixed-size space (e.g. a GL buffer) in O(1).
+ * Free ranges are kept in two-level segregated fit (TLSF) bins: the size \
+ * classes are small floats with a 5-bit exponent and a 3-bit mantissa, so \
+ * a request never gets a range more than 12.5% larger than needed from \
+ * the bin it's served from. Two bitmasks find the first non-empty bin with \
+ * bit scans, and freed ranges merge with free neighbours straight away.
+ * The allocator only does bookkeeping; it never touches the space itself.
+ */
+class LYS_API OffsetAllocator {
+  public:
+    /** Constructor.
+     * \param size The size of the space, in whatever units the caller uses.
+     * \param max_allocations Maximum number of live allocations.
+     */
+    explicit OffsetAllocator(uint32_t size, uint32_t max_allocations = 64 * 1024);
+    ~OffsetAllocator() = default;
+
+    /** Forget all allocations, leaving the whole space free. */
+    void reset();
+
+    /** Allocate a range.
+     * \param size The size of the range (at least 1).
+     * \returns The range; check isValid() for failure.
+     */
+    OffsetAllocation allocate(uint32_t size);
+
+    /** Return a range to the allocator.
+     * \param allocation A valid allocation from this allocator.
+     */
+    void free(const OffsetAllocation &allocation);
+
+    /** Move an allocation down into the free range right before it, if \
+     * there is one. The free space ends up after the allocation (merged \
+     * with whatever was free there), which is what compaction needs.
+     * \param allocation A valid allocation from this allocator.
+     * \returns The allocation at its new offset (the same node), or \
+     * unchanged if the range before it is in use.
+     */
+    OffsetAllocation slideDown(const OffsetAllocation &allocation);
+
+    /** Get the size of the space.
+     * \returns The size.
+     */
+    uint32_t size() const {
+        return size_;
+    }
+
+    /** Get the total free space.
+     * \returns The free size.
+     */
+    uint32_t freeSize() const {
+        return freeSize_;
+    }
+
+    /** Get the largest range that can currently be allocated.
+     * \returns The size of the largest free range.
+     */
+    uint32_t largestFree() const;
+
+    /** Get the number of live allocations.
+     * \returns The allocation count.
+     */
+    uint32_t allocationCount() const {
+        return allocationCount_;
+    }
+
+    /** Get how scattered the free space is: 0 when it is one range, \
+     * approaching 1 as it splits into many small ones.
+     * \returns 1 - largestFree() / freeSize(), or 0 if nothing is free.
+     */
+    float fragmentation() const;
+
+  private:
+    static const uint32_t kTopBins = 32;
+    static const uint32_t kLeafBins = 8;
+    static const uint32_t kBinCount = kTopBins * kLeafBins;
+    static const uint32_t kUnused = 0xFFFFFFFF;
+
+    struct Node {
+        uint32_t offset;
+        uint32_t size;
+        uint32_t binPrev;
+        uint32_t binNext;
+        uint32_t neighborPrev;
+        uint32_t neighborNext;
+        bool used;
+    };
+
+    // Returns the node; there is always one spare (see reset())
+    uint32_t insertFree(uint32_t offset, uint32_t size);
+    void removeFree(uint32_t node);
+
+    uint32_t size_;
+    uint32_t maxAllocations_;
+    uint32_t freeSize_;
+    uint32_t allocationCount_;
+    uint32_t topMask_;
+    uint8_t leafMasks_[kTopBins];
+    uint32_t binHeads_[kBinCount];
+    Vector<Node> nodes_;
+    Vector<uint32_t> freeNodes_;
+};
+}
+#endif // LYS3D_OFFSETALLOCATOR_H_
@@ -0,0 +1,238 @@
+/***************************************************
+* PlanetTerrain.h: Cube-sphere quadtree terrain    *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_PLANETTERRAIN_H_
+#define LYS3D_PLANETTERRAIN_H_
+
+#include "types.h"
+#include "Dimension2D.h"
+#include "IWindow.h"
+#include "Point3D.h"
+#include "VertexLayout.h"
+
+namespace lys3d {
+
+/** Gives the terrain height at a point of a planet.
+ * Called from the terrain's worker threads, so it must be thread-safe; it \
+ * may block, e.g. to read heightmap tiles from disk.
+ * \param user_data The pointer passed to PlanetTerrain::heightSource().
+ * \param direction Unit vector from the planet's center.
+ * \returns Height above the planet's radius, within +-maxHeight.
+ */
+typedef double (*PlanetHeightFunc)(void *user_data, const double direction[3]);
+
+/** Fractal noise parameters for PlanetTerrain::noiseHeight(). */
+struct PlanetNoise {
+    /** Largest height of the first octave; the sum stays below 2x this. */
+    double amplitude = 4000.0;
+    /** Features across the planet's radius at the first octave. */
+    double frequency = 2.0;
+    /** Octaves summed, each at twice the frequency and half the amplitude. */
+    uint32_t octaves = 16;
+    uint32_t seed = 1;
+};
+
+/** Construction-time settings of a PlanetTerrain. */
+struct PlanetSettings {
+    /** Radius at height 0. */
+    double radius = 6.0e6;
+    /** Bound on the heights returned by the height source, used for \
+     * bounding volumes and horizon culling.
+     */
+    double maxHeight = 8000.0;
+    /** Expected height change between neighbouring vertices, per unit of \
+     * vertex spacing; chunk errors are this times their spacing.
+     */
+    double roughness = 0.1;
+    /** Vertices along a chunk's edge, from 3 to 129. */
+    uint32_t chunkSize = 33;
+    /** Deepest quadtree level; level 18 gives about 1 unit spacing on the \
+     * default radius.
+     */
+    uint32_t maxLevel = 18;
+    /** Chunk meshes kept resident, each in its own vertex buffer. The \
+     * default fits a 90 degree view near the ground; when the chunks drawn \
+     * and their ancestors need more, detail stops increasing.
+     */
+    uint32_t cacheSize = 512;
+    /** Worker threads building chunk meshes; 0 builds them in plan(). */
+    uint32_t workers = 2;
+    /** Chunk meshes moved into the cache (and uploaded) per frame. */
+    uint32_t uploadsPerFrame = 8;
+    /** Chunk meshes queued or being built at once. */
+    uint32_t maxPending = 32;
+};
+
+/** What the terrain did in the last frame. */
+struct PlanetStats {
+    /** Chunks in the visible list. */
+    uint32_t chunksDrawn = 0;
+    /** Quadtree nodes allocated. */
+    uint32_t nodes = 0;
+    /** Cache slots holding a chunk mesh. */
+    uint32_t resident = 0;
+    /** Chunk meshes queued, being built or waiting for a cache slot. */
+    uint32_t pending = 0;
+    /** Chunk meshes moved into the cache this frame. */
+    uint32_t uploads = 0;
+    /** Meshes wanted but not built, or dropped once built, because every \
+     * cache slot was in use.
+     */
+    uint32_t cacheMisses = 0;
+    /** Deepest level drawn. */
+    uint32_t deepestLevel = 0;
+    /** Time plan() and upload() took, in milliseconds. */
+    float planMs = 0.0f;
+    float uploadMs = 0.0f;
+};
+
+/** A chunk in the visible list. */
+struct PlanetChunk {
+    /** The chunk's origin relative to the camera. */
+    float offset[3];
+    /** Cube face (+X, -X, +Y, -Y, +Z, -Z) and quadtree level. */
+    uint8_t face;
+    uint8_t level;
+    /** The cache slot holding its mesh. */
+    uint16_t slot;
+};
+
+/** Renders a planet as six quadtrees of terrain chunks, one per face of a \
+ * cube projected onto a sphere.
+ * Each frame, plan() splits the quadtrees down to the chunks whose \
+ * geometric error projects to less than threshold() pixels, skipping those \
+ * below the horizon or outside the view. A chunk is only replaced by its \
+ * children once all four have meshes, so detail streams in without holes. \
+ * Missing meshes are built on worker threads, most visible error first, \
+ * and at most uploadsPerFrame finished ones are taken per frame, which \
+ * keeps frame times steady while the camera drops from orbit to the \
+ * ground. Meshes live in a fixed number of cache slots whose vertex \
+ * buffers are reused, the least recently drawn first.
+ * Chunk origins are kept in double precision and vertices are stored \
+ * relative to them, so there's no jitter at planet scale: draw with a \
+ * camera-relative view (rotation only) and add each chunk's offset in the \
+ * vertex shader (see draw()). Edges between levels are hidden by skirts, \
+ * strips hanging down from each chunk's border.
+ *
+ * Typical frame:
+ * \code
+ * terrain.update(camera_position, camera_relative_view_projection);
+ * program.use();
+ * terrain.draw(program.uniformLocation("u_chunkOffset"));
+ * \endcode
+ */
+class LYS_API PlanetTerrain {
+  public:
+    /** Constructor. Starts the worker threads.
+     * \param settings The planet and cache settings.
+     */
+    explicit PlanetTerrain(const PlanetSettings &settings = PlanetSettings());
+
+    /** Destructor. Stops the worker threads and deletes the vertex buffers.
+     */
+    ~PlanetTerrain();
+
+    PlanetTerrain(const PlanetTerrain& other) = delete;
+    PlanetTerrain& operator=(const PlanetTerrain& other) = delete;
+
+    /** Get the settings.
+     * \returns The settings, with chunkSize clamped.
+     */
+    const PlanetSettings& settings() const;
+
+    /** Set where heights come from. Defaults to noiseHeight() with \
+     * PlanetNoise's defaults. Meshes already built are kept.
+     * \param func The height function.
+     * \param user_data Passed to func; must outlive the terrain.
+     */
+    void heightSource(PlanetHeightFunc func, void *user_data);
+
+    /** Get the pixel error threshold.
+     * \returns The largest allowed projected error, in pixels (2 by default).
+     */
+    float threshold() const;
+
+    /** Set the pixel error threshold.
+     * \param pixels The largest allowed projected error, in pixels.
+     */
+    void threshold(float pixels);
+
+    /** Set up the projection scale from a window.
+     * \param window The window being rendered to.
+     * \param fov_y Vertical field of view, in radians.
+     */
+    void projection(const IWindow &window, float fov_y);
+
+    /** Set up the projection scale from a viewport size.
+     * \param viewport Viewport size, in pixels.
+     * \param fov_y Vertical field of view, in radians.
+     */
+    void projection(const Dimension2Di32 &viewport, float fov_y);
+
+    /** Take finished meshes into the cache, select the chunks to draw and \
+     * queue the meshes they need. Doesn't touch GL.
+     * \param camera The camera position, relative to the planet's center.
+     * \param view_projection Column-major camera-relative view-projection \
+     * matrix to cull chunks outside the view, or nullptr.
+     */
+    void plan(const Point3Dd &camera, const float view_projection[16] = nullptr);
+
+    /** Upload the meshes taken into the cache by plan(). Needs a current \
+     * GL context.
+     */
+    void upload();
+
+    /** Run plan() then upload(); call once per frame. */
+    void update(const Point3Dd &camera, const float view_projection[16] = nullptr);
+
+    /** Wait until every queued mesh has been built (not taken). */
+    void finish();
+
+    /** Get the chunks selected by the last plan().
+     * \returns The visible list.
+     */
+    const Vector<PlanetChunk>& visible() const;
+
+    /** Get the vertex layout of chunk meshes: float positions relative to \
+     * the chunk origin (kAttribPosition) and normalized short normals \
+     * (kAttribNormal).
+     * \returns The layout.
+     */
+    const VertexLayout& layout() const;
+
+    /** Draw the visible list as triangles with the current program.
+     * \param offset_location Location of a vec3 uniform receiving each \
+     * chunk's offset, to be added to a_position.
+     */
+    void draw(int32_t offset_location);
+
+    /** Delete the vertex buffers and empty the cache. Meshes are rebuilt \
+     * as needed by the following frames.
+     */
+    void destroy();
+
+    /** Get the last frame's statistics.
+     * \returns The statistics.
+     */
+    const PlanetStats& stats() const;
+
+    /** A procedural height source: fractal value noise over the sphere.
+     * \param user_data A PlanetNoise.
+     * \param direction Unit vector from the planet's center.
+     * \returns The height.
+     */
+    static double noiseHeight(void *user_data, const double direction[3]);
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_PLANETTERRAIN_H_
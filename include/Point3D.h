@@ -0,0 +1,163 @@
+/***************************************************
+* Point3D.h: 3-dimensional point templates         *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_POINT3D_H_
+#define LYS3D_POINT3D_H_
+
+#include <math.h>
+
+#include "types.h"
+
+namespace lys3d {
+
+/** Expresses a 3-dimensional point (or vector). */
+template <typename T>
+class Point3D {
+  public:
+    /** Default constructor.
+     * Initializes x, y and z to 0.
+     */
+    Point3D() {
+        x_ = y_ = z_ = 0;
+    }
+
+    /** Parameterized constructor that sets x, y and z to the given values.
+     * \param x The initial x coordinate.
+     * \param y The initial y coordinate.
+     * \param z The initial z coordinate.
+     */
+    Point3D(const T &x, const T &y, const T &z) {
+      x_ = x;
+      y_ = y;
+      z_ = z;
+    }
+
+    ~Point3D() = default;
+
+    /** Get the x coordinate.
+     * \returns The current x coordinate value.
+     */
+    T x() const {
+      return x_;
+    }
+
+    /** Set the x coordinate.
+     * \param x The new x coordinate value.
+     */
+    void x(const T &new_x) {
+      x_ = new_x;
+    }
+
+    /** Get the y coordinate.
+     * \returns The current y coordinate value.
+     */
+    T y() const {
+      return y_;
+    }
+
+    /** Set the y coordinate.
+     * \param y The new y coordinate value.
+     */
+    void y(const T &new_y) {
+      y_ = new_y;
+    }
+
+    /** Get the z coordinate.
+     * \returns The current z coordinate value.
+     */
+    T z() const {
+      return z_;
+    }
+
+    /** Set the z coordinate.
+     * \param z The new z coordinate value.
+     */
+    void z(const T &new_z) {
+      z_ = new_z;
+    }
+
+    Point3D operator+(const Point3D &other) const {
+      return Point3D(x_ + other.x_, y_ + other.y_, z_ + other.z_);
+    }
+
+    Point3D operator-(const Point3D &other) const {
+      return Point3D(x_ - other.x_, y_ - other.y_, z_ - other.z_);
+    }
+
+    Point3D operator*(const T &scale) const {
+      return Point3D(x_ * scale, y_ * scale, z_ * scale);
+    }
+
+    Point3D& operator+=(const Point3D &other) {
+      x_ += other.x_;
+      y_ += other.y_;
+      z_ += other.z_;
+      return *this;
+    }
+
+    Point3D& operator-=(const Point3D &other) {
+      x_ -= other.x_;
+      y_ -= other.y_;
+      z_ -= other.z_;
+      return *this;
+    }
+
+    bool operator==(const Point3D &other) const {
+      return x_ == other.x_ && y_ == other.y_ && z_ == other.z_;
+    }
+
+    bool operator!=(const Point3D &other) const {
+      return !(*this == other);
+    }
+
+    /** Get the dot product with another point (treated as a vector).
+     * \param other The other vector.
+     * \returns x*x' + y*y' + z*z'.
+     */
+    T dot(const Point3D &other) const {
+      return x_ * other.x_ + y_ * other.y_ + z_ * other.z_;
+    }
+
+    /** Get the cross product with another point (treated as a vector).
+     * \param other The right-hand vector.
+     * \returns this x other.
+     */
+    Point3D cross(const Point3D &other) const {
+      return Point3D(y_ * other.z_ - z_ * other.y_,
+                     z_ * other.x_ - x_ * other.z_,
+                     x_ * other.y_ - y_ * other.x_);
+    }
+
+    /** Get the squared distance from the origin.
+     * \returns The squared length of the vector.
+     */
+    T lengthSquared() const {
+      return dot(*this);
+    }
+
+    /** Get the distance from the origin.
+     * \returns The length of the vector.
+     */
+    T length() const {
+      return static_cast<T>(sqrt(static_cast<double>(lengthSquared())));
+    }
+
+  private:
+    T x_, y_, z_;
+};
+
+using Point3Di = Point3D<int>;
+using Point3Di32 = Point3D<int32_t>;
+using Point3Du = Point3D<unsigned int>;
+using Point3Du32 = Point3D<uint32_t>;
+using Point3Df = Point3D<float>;
+using Point3Dd = Point3D<double>;
+}
+#endif // LYS3D_POINT3D_H_
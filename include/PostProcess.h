@@ -0,0 +1,140 @@
+/***************************************************
+* PostProcess.h: Bloom, tonemapping and grading    *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_POSTPROCESS_H_
+#define LYS3D_POSTPROCESS_H_
+
+#include "types.h"
+#include "FrameGraph.h"
+
+namespace lys3d {
+
+/** Post-processing effect bits, for PostSettings::effects. */
+enum PostEffect : uint32_t {
+    kPostBloom = 1,
+    kPostTonemap = 2,
+    kPostColorGrade = 4,
+    kPostVignette = 8,
+    kPostAllEffects = 15
+};
+
+/** Post-processing parameters. */
+struct PostSettings {
+    /** The enabled effects, a combination of PostEffect bits. */
+    uint32_t effects = kPostBloom | kPostTonemap | kPostVignette;
+    /** The scene stores color divided by this, so values above 1 survive \
+     * in an 8-bit target; bloom and tonemapping scale it back up.
+     */
+    float sceneRange = 1.0f;
+    /** Multiplier applied before tonemapping. */
+    float exposure = 1.0f;
+    /** Brightness above which pixels bloom (after sceneRange). */
+    float bloomThreshold = 0.8f;
+    /** Width of the soft transition below the threshold. */
+    float bloomKnee = 0.4f;
+    /** Strength of the bloom added to the scene. */
+    float bloomIntensity = 0.6f;
+    /** Color grading: 0 is grayscale, 1 unchanged. */
+    float saturation = 1.0f;
+    /** Color grading: contrast around mid-gray. */
+    float contrast = 1.0f;
+    /** Color grading: added to the shadows, per channel. */
+    float lift[3] = {0.0f, 0.0f, 0.0f};
+    /** Color grading: gamma applied to the midtones, per channel. */
+    float gamma[3] = {1.0f, 1.0f, 1.0f};
+    /** Color grading: multiplier for the highlights, per channel. */
+    float gain[3] = {1.0f, 1.0f, 1.0f};
+    /** How dark the corners get, from 0 to 1. */
+    float vignetteIntensity = 0.35f;
+    /** Distance from the center (in screen heights) where darkening starts. */
+    float vignetteRadius = 0.5f;
+    /** Distance over which the vignette fades in. */
+    float vignetteSoftness = 0.5f;
+};
+
+/** A post-processing chain built to stay within the bandwidth of mobile \
+ * GPUs, declared as FrameGraph passes.
+ * Bloom thresholds and downsamples the scene to half resolution, then to \
+ * quarter resolution, and upsamples back to half resolution additively; \
+ * each step is a 4-tap bilinear filter, so no pass runs at full resolution. \
+ * Tonemapping (ACES fitted), color grading and vignette are fused with the \
+ * bloom composite into one final fullscreen pass, so the scene is read once.
+ * Each combination of effects compiles to its own shader permutation, \
+ * picked when addPasses() runs: disabled effects cost no instructions and \
+ * no uniforms, and without bloom the chain is that single pass.
+ * The passes leave blending, depth testing, face culling and the scissor \
+ * test disabled.
+ */
+class LYS_API PostProcess {
+  public:
+    /** Constructor. Creates no GL objects until the passes run.
+     * \param settings The effects and their parameters.
+     */
+    explicit PostProcess(const PostSettings &settings = PostSettings());
+
+    /** Destructor. Deletes the programs and buffer. */
+    ~PostProcess();
+
+    PostProcess(const PostProcess& other) = delete;
+    PostProcess& operator=(const PostProcess& other) = delete;
+
+    /** Get the effects and their parameters.
+     * \returns The settings.
+     */
+    const PostSettings& settings() const;
+
+    /** Set the effects and their parameters; takes effect from the next \
+     * addPasses().
+     * \param settings The settings.
+     */
+    void settings(const PostSettings &settings);
+
+    /** Declare the chain's passes and half/quarter resolution targets for \
+     * this frame.
+     * \param graph The frame graph, after reset().
+     * \param scene A color target holding the rendered scene.
+     * \param output Where the final image goes, e.g. graph.backbuffer().
+     * \returns The index of the final pass.
+     */
+    uint32_t addPasses(FrameGraph &graph, FrameResource scene, FrameResource output);
+
+    /** Build the programs the current effects need, so the first frame \
+     * using them doesn't stall on shader compilation. Needs a current GL \
+     * context; otherwise the passes build them on first use.
+     * \returns False if a program failed to build (see log()).
+     */
+    bool prepare();
+
+    /** Delete the GL objects; they are recreated on next use. */
+    void destroy();
+
+    /** Get the messages of the last failed program build.
+     * \returns The compile/link log.
+     */
+    const String& log() const;
+
+    /** Get the preprocessor definitions selecting a composite permutation.
+     * \param effects A combination of PostEffect bits.
+     * \returns The "#define ..." lines for ShaderProgram::build().
+     */
+    static String defines(uint32_t effects);
+
+    /** Get the number of fullscreen passes the chain runs.
+     * \param effects A combination of PostEffect bits.
+     * \returns 4 with bloom, otherwise 1.
+     */
+    static uint32_t passCount(uint32_t effects);
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_POSTPROCESS_H_
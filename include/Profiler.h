@@ -0,0 +1,231 @@
+/***************************************************
+* Profiler.h: Hierarchical CPU zones & counters    *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_PROFILER_H_
+#define LYS3D_PROFILER_H_
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "types.h"
+
+namespace lys3d {
+
+/** Counters every profiler starts with. Further ones can be added with \
+ * Profiler::counter().
+ */
+enum ProfilerCounter : uint32_t {
+    kCounterDrawCalls = 0,  ///< glDrawArrays/glDrawElements calls
+    kCounterStateChanges,   ///< Binds, enables, blend/depth state, viewport...
+    kCounterUploadedBytes,  ///< Bytes passed to buffer and texture uploads
+    kCounterAllocations,    ///< Heap allocations (see LYS_PROFILER_COUNT_ALLOCATIONS)
+    kCounterBuiltinCount
+};
+
+/** Timing of one zone (at one place in the hierarchy) during a frame. */
+struct ProfilerZoneStats {
+    /** The name the zone was registered with. */
+    const char *name;
+    /** Nesting depth; 0 for zones opened outside any other zone. */
+    uint32_t depth;
+    /** Times the zone was entered. */
+    uint32_t calls;
+    /** Time spent in the zone, including nested zones, in milliseconds. */
+    float totalMs;
+    /** Time spent in the zone, excluding nested zones, in milliseconds. */
+    float selfMs;
+};
+
+/** Collects nested CPU timing zones and per-frame counters.
+ * Zones are usually opened with LYS_PROFILE_ZONE(). They may be opened on \
+ * any thread; each thread builds its own branch of the hierarchy. The \
+ * results of the last complete frame stay available until the next \
+ * endFrame().
+ * WindowGLES2 calls beginFrame() and endFrame() in update() while its \
+ * profiler overlay is shown.
+ */
+class LYS_API Profiler {
+  public:
+    /** Number of frames kept in the frame time history. */
+    static const uint32_t kHistoryLength = 128;
+
+    /** Default constructor. Starts disabled. */
+    Profiler();
+    ~Profiler();
+
+    Profiler(const Profiler& other) = delete;
+    Profiler& operator=(const Profiler& other) = delete;
+
+    /** Get the engine-wide profiler that LYS_PROFILE_ZONE() reports to.
+     * \returns The global profiler.
+     */
+    static Profiler& global();
+
+    /** Check whether zones and counters are being recorded.
+     * \returns True if enabled.
+     */
+    bool isEnabled() const;
+
+    /** Start or stop recording. Disabled zones cost one branch.
+     * \param enable True to record, false to ignore zones and counters.
+     */
+    void enable(bool enable = true);
+
+    /** Start a frame: resets the per-frame counters and zone times. */
+    void beginFrame();
+
+    /** Finish a frame, making its results available to the getters. */
+    void endFrame();
+
+    /** Register a zone name (or look up an existing one).
+     * \param name The zone's name. Must outlive the profiler (e.g. a literal).
+     * \returns The zone id, for ProfileScope.
+     */
+    uint32_t zone(const char *name);
+
+    /** Register a counter name (or look up an existing one).
+     * \param name The counter's name. Must outlive the profiler.
+     * \param per_frame True for counts that reset every frame, false for \
+     * gauges that keep the last set() value (e.g. resident bytes).
+     * \returns The counter id.
+     */
+    uint32_t counter(const char *name, bool per_frame = true);
+
+    /** Add to a counter. Safe to call from any thread.
+     * \param id The counter id (a ProfilerCounter or from counter()).
+     * \param amount The amount to add.
+     */
+    void count(uint32_t id, int64_t amount = 1);
+
+    /** Set a counter's value. Safe to call from any thread.
+     * \param id The counter id.
+     * \param value The new value.
+     */
+    void set(uint32_t id, int64_t value);
+
+    /** Count heap allocations for the global profiler.
+     * Cheap enough to call from a replacement operator new; see \
+     * LYS_PROFILER_COUNT_ALLOCATIONS.
+     */
+    static void countAllocation();
+
+    /** Check whether GL calls are being counted.
+     * \returns True if draw calls, state changes and uploads are counted.
+     */
+    bool isCountingGL() const;
+
+    /** Count draw calls, state changes and uploaded bytes by wrapping the \
+     * GL function pointers. Only one profiler can count GL calls at a time. \
+     * Enabling needs a current GL context; the wrappers are reinstalled \
+     * whenever the window is activated.
+     * \param enable True to install the wrappers, false to remove them.
+     * \returns True on success, false if another profiler is counting.
+     */
+    bool countGL(bool enable = true);
+
+    /** Get the duration of the last complete frame (beginFrame() to \
+     * beginFrame()).
+     * \returns The frame time, in milliseconds.
+     */
+    float frameTime() const;
+
+    /** Get the recent frame times.
+     * \param times Receives up to kHistoryLength frame times in milliseconds, \
+     * oldest first.
+     */
+    void frameTimes(Vector<float> *times) const;
+
+    /** Get the most expensive zones of the last complete frame.
+     * \param count The maximum number of zones.
+     * \param zones Receives the zones, sorted by total time.
+     */
+    void topZones(size_t count, Vector<ProfilerZoneStats> *zones) const;
+
+    /** Get the number of counters, including the built-in ones.
+     * \returns The counter count.
+     */
+    uint32_t counterCount() const;
+
+    /** Get a counter's name.
+     * \param id The counter id.
+     * \returns The name, or nullptr for an invalid id.
+     */
+    const char* counterName(uint32_t id) const;
+
+    /** Get a counter's value at the end of the last complete frame.
+     * \param id The counter id.
+     * \returns The value (0 for an invalid id).
+     */
+    int64_t counterValue(uint32_t id) const;
+
+  private:
+    friend class ProfileScope;
+    int32_t enter(uint32_t zone, int32_t *parent);
+    void leave(int32_t node, int32_t parent, int64_t nanoseconds);
+
+    struct Impl;
+    Impl *pimpl_;
+};
+
+/** Times a zone of the global profiler for as long as it is in scope. */
+class LYS_API ProfileScope {
+  public:
+    /** Enter a zone.
+     * \param zone The zone id, from Profiler::zone().
+     */
+    explicit ProfileScope(uint32_t zone);
+
+    /** Leave the zone. */
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope& other) = delete;
+    ProfileScope& operator=(const ProfileScope& other) = delete;
+
+  private:
+    int32_t node_;
+    int32_t parent_;
+    int64_t start_;
+};
+}
+
+#define LYS_PROFILE_CONCAT_(a, b) a ## b
+#define LYS_PROFILE_CONCAT(a, b) LYS_PROFILE_CONCAT_(a, b)
+
+/** Time the rest of the enclosing scope as a zone of the global profiler.
+ * \param name A string literal naming the zone.
+ */
+#define LYS_PROFILE_ZONE(name) \
+    static const uint32_t LYS_PROFILE_CONCAT(lysProfileZone, __LINE__) = \
+        lys3d::Profiler::global().zone(name); \
+    lys3d::ProfileScope LYS_PROFILE_CONCAT(lysProfileScope, __LINE__)(LYS_PROFILE_CONCAT(lysProfileZone, __LINE__))
+
+/** Replace the global operator new/delete with versions that count \
+ * allocations for the global profiler. Use once, at namespace scope, in one \
+ * source file of the application (replacement operators must live in the \
+ * executable to see every allocation).
+ */
+#define LYS_PROFILER_COUNT_ALLOCATIONS() \
+    void* operator new(size_t size) { \
+        lys3d::Profiler::countAllocation(); \
+        void *ptr = malloc(size ? size : 1); \
+        if (ptr == nullptr) \
+            abort(); \
+        return ptr; \
+    } \
+    void* operator new[](size_t size) { \
+        return operator new(size); \
+    } \
+    void operator delete(void *ptr) noexcept { \
+        free(ptr); \
+    } \
+    void operator delete[](void *ptr) noexcept { \
+        free(ptr); \
+    }
+#endif // LYS3D_PROFILER_H_
@@ -0,0 +1,97 @@
+/***************************************************
+* ResolutionController.h: Dynamic resolution scale *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_RESOLUTIONCONTROLLER_H_
+#define LYS3D_RESOLUTIONCONTROLLER_H_
+
+#include "types.h"
+
+namespace lys3d {
+
+/** Tuning for ResolutionController. */
+struct DynamicResolutionSettings {
+    /** Frame time to stay under, in milliseconds. */
+    float targetFrameMs = 1000.0f / 60.0f;
+    /** Fraction of the target to aim for, leaving room for spikes. */
+    float headroom = 0.9f;
+    /** Smallest scale (per axis) the scene is rendered at. */
+    float minScale = 0.5f;
+    /** Largest scale (per axis); above 1 supersamples. */
+    float maxScale = 1.0f;
+    /** Weight of each new frame time in the smoothed one. */
+    float smoothing = 0.1f;
+    /** Frames in a row comfortably under budget before the scale grows. */
+    uint32_t growDelay = 30;
+    /** Largest increase of the scale at a time. */
+    float maxGrowStep = 0.05f;
+};
+
+/** Picks a render scale from measured frame times.
+ * Pixel cost is taken to grow with the square of the scale. Frames over \
+ * the target shrink the scale right away; it only grows back after \
+ * growDelay frames under budget, a step at a time, so it doesn't \
+ * oscillate around the target. After each change the smoothed frame time \
+ * is adjusted to what the new scale should cost, so one slow stretch isn't \
+ * acted on twice.
+ */
+class LYS_API ResolutionController {
+  public:
+    /** Constructor. Starts at the largest scale.
+     * \param settings The tuning.
+     */
+    explicit ResolutionController(const DynamicResolutionSettings &settings = DynamicResolutionSettings());
+
+    /** Get the tuning.
+     * \returns The settings.
+     */
+    const DynamicResolutionSettings& settings() const {
+        return settings_;
+    }
+
+    /** Set the tuning. The current scale is clamped to the new limits.
+     * \param settings The settings.
+     */
+    void settings(const DynamicResolutionSettings &settings);
+
+    /** Feed the time one frame took.
+     * \param frame_ms The frame time (the larger of CPU and GPU time if \
+     * both are known), in milliseconds.
+     * \returns The scale to render the next frame at.
+     */
+    float update(float frame_ms);
+
+    /** Get the current scale.
+     * \returns The scale, per axis.
+     */
+    float scale() const {
+        return scale_;
+    }
+
+    /** Get the smoothed frame time.
+     * \returns The frame time the controller is working from, in \
+     * milliseconds (0 before the first update()).
+     */
+    float smoothedFrameMs() const {
+        return smoothedMs_;
+    }
+
+    /** Forget the frame time history and go back to the largest scale. */
+    void reset();
+
+  private:
+    void rescale(float wanted);
+
+    DynamicResolutionSettings settings_;
+    float scale_;
+    float smoothedMs_;
+    uint32_t framesUnder_;
+};
+}
+#endif // LYS3D_RESOLUTIONCONTROLLER_H_
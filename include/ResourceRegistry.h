@@ -0,0 +1,154 @@
+/***************************************************
+* ResourceRegistry.h: GL object accounting         *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_RESOURCEREGISTRY_H_
+#define LYS3D_RESOURCEREGISTRY_H_
+
+#include "types.h"
+
+namespace lys3d {
+
+/** Kinds of GL objects the registry knows how to account for and delete. */
+enum class GpuResourceType : uint8_t {
+    kTexture = 0,
+    kBuffer,
+    kRenderbuffer,
+    kProgram,
+    kFramebuffer,  ///< Deleted late like the rest, but has no memory of its own
+    kCount
+};
+
+/** Memory use of one kind of GL object. */
+struct GpuResourceStats {
+    /** Live (tracked) objects. */
+    uint32_t count;
+    /** Their estimated video memory, in bytes. */
+    uint64_t bytes;
+    /** The budget, in bytes; 0 for none. */
+    uint64_t budget;
+    /** Objects evicted by the last endFrame(). */
+    uint32_t evictions;
+    /** Released objects still waiting for their glDelete* call. */
+    uint32_t pendingDeletes;
+};
+
+/** Called to evict a reloadable object. The owner should free it (through \
+ * release()) and reload it on its next use.
+ * \param user_data The pointer given to reloadable().
+ * \param type The object's kind.
+ * \param name The GL object name.
+ */
+typedef void (*GpuEvictCallback)(void *user_data, GpuResourceType type, uint32_t name);
+
+/** Keeps track of every GL object the engine creates, with its estimated size.
+ * Objects are identified by kind and GL name, which assumes one GL context \
+ * (or a share group) at a time. Releasing an object doesn't delete it right \
+ * away: the glDelete* call is queued and made a few frames later, after a \
+ * buffer swap, since deleting objects the GPU may still be reading from \
+ * makes some drivers stall. WindowGLES2 calls endFrame() in update().
+ * Budgets are enforced by evicting the least recently used objects whose \
+ * owners marked them reloadable. Objects used in the current frame are \
+ * never evicted.
+ */
+class LYS_API ResourceRegistry {
+  public:
+    /** Default constructor. No budgets, 2 frame delete delay. */
+    ResourceRegistry();
+    ~ResourceRegistry();
+
+    ResourceRegistry(const ResourceRegistry& other) = delete;
+    ResourceRegistry& operator=(const ResourceRegistry& other) = delete;
+
+    /** Get the registry the engine's GL objects are tracked in.
+     * \returns The global registry.
+     */
+    static ResourceRegistry& global();
+
+    /** Start tracking an object, or update its size if it's tracked already.
+     * \param type The object's kind.
+     * \param name The GL object name (0 is ignored).
+     * \param bytes Its estimated video memory, in bytes.
+     */
+    void track(GpuResourceType type, uint32_t name, uint64_t bytes);
+
+    /** Let the registry evict an object when its budget is exceeded.
+     * \param type The object's kind.
+     * \param name The GL object name.
+     * \param callback Called to evict it; nullptr makes it permanent again.
+     * \param user_data Passed to the callback.
+     */
+    void reloadable(GpuResourceType type, uint32_t name, GpuEvictCallback callback, void *user_data);
+
+    /** Mark an object as used in the current frame (for LRU eviction).
+     * \param type The object's kind.
+     * \param name The GL object name.
+     */
+    void touch(GpuResourceType type, uint32_t name);
+
+    /** Stop tracking an object and queue its deletion.
+     * Needs the object's GL context to be current, although nothing is \
+     * called on it yet.
+     * \param type The object's kind.
+     * \param name The GL object name (0 is ignored).
+     */
+    void release(GpuResourceType type, uint32_t name);
+
+    /** Get the budget for one kind of object.
+     * \param type The object kind.
+     * \returns The budget, in bytes; 0 for none.
+     */
+    uint64_t budget(GpuResourceType type) const;
+
+    /** Set the budget for one kind of object. Takes effect at the next endFrame().
+     * \param type The object kind.
+     * \param bytes The budget, in bytes; 0 for none.
+     */
+    void budget(GpuResourceType type, uint64_t bytes);
+
+    /** Get the number of frames released objects wait before deletion.
+     * \returns The delay, in frames.
+     */
+    uint32_t deleteDelay() const;
+
+    /** Set the number of frames released objects wait before deletion.
+     * \param frames The delay, in frames.
+     */
+    void deleteDelay(uint32_t frames);
+
+    /** Evict least recently used reloadable objects until every kind fits \
+     * its budget (or nothing evictable is left). Doesn't touch GL itself.
+     * \returns The number of objects evicted.
+     */
+    uint32_t enforce();
+
+    /** Make the queued glDelete* calls that are due. Needs a current GL \
+     * context; deletions queued in other contexts stay queued, and ones \
+     * queued with no context at all are dropped.
+     * \param all True to delete everything queued in this context now.
+     */
+    void collect(bool all = false);
+
+    /** Finish a frame: enforce the budgets, make the due deletions and \
+     * report to the global profiler. Call after the buffer swap.
+     */
+    void endFrame();
+
+    /** Get the memory use of one kind of object.
+     * \param type The object kind.
+     * \returns The statistics.
+     */
+    GpuResourceStats stats(GpuResourceType type) const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_RESOURCEREGISTRY_H_
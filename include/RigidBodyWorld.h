@@ -0,0 +1,237 @@
+/***************************************************
+* RigidBodyWorld.h: Rigid-body dynamics            *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_RIGIDBODYWORLD_H_
+#define LYS3D_RIGIDBODYWORLD_H_
+
+#include "types.h"
+#include "Point3D.h"
+
+namespace lys3d {
+
+/** The collision shape of a rigid body. */
+enum class BodyShape : uint8_t {
+    kSphere = 0,  ///< halfExtents.x() is the radius
+    kBox          ///< Centered on the body's position
+};
+
+/** How to create a rigid body. */
+struct RigidBodyDesc {
+    BodyShape shape = BodyShape::kBox;
+    /** Half the box's size along each local axis, or the sphere's radius \
+     * in x.
+     */
+    Point3Df halfExtents = Point3Df(0.5f, 0.5f, 0.5f);
+    Point3Df position;
+    /** Unit quaternion (x, y, z, w). */
+    float orientation[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    Point3Df velocity;
+    /** Angular velocity, in radians per second around each world axis. */
+    Point3Df angularVelocity;
+    /** Mass; 0 makes a static body, which never moves. */
+    float mass = 1.0f;
+    /** Coulomb friction; a contact uses the larger of its two bodies'. */
+    float friction = 0.6f;
+    /** Bounciness, from 0 to 1; a contact uses the larger of its two \
+     * bodies'.
+     */
+    float restitution = 0.0f;
+};
+
+/** Construction-time settings of a RigidBodyWorld. */
+struct RigidBodySettings {
+    Point3Df gravity = Point3Df(0.0f, -9.81f, 0.0f);
+    /** Solver iterations per step. */
+    uint32_t iterations = 8;
+    /** Contacts are kept for bodies up to this far apart, so they settle \
+     * without jitter and fast ones stop at the surface.
+     */
+    float contactMargin = 0.02f;
+    /** Overlap left alone, keeping resting contacts steady. */
+    float allowedPenetration = 0.005f;
+    /** Share of the remaining overlap corrected each step. */
+    float correction = 0.2f;
+    /** An island falls asleep once all its bodies have moved and turned \
+     * slower than sleepSpeed for sleepTime seconds.
+     */
+    float sleepSpeed = 0.05f;
+    float sleepTime = 0.5f;
+    /** Size of the finest broadphase cells; about the size of the smaller \
+     * bodies.
+     */
+    float cellSize = 1.0f;
+    /** Worker threads; the calling thread works too. */
+    uint32_t workers = 3;
+};
+
+/** What the last step did. */
+struct RigidBodyStats {
+    uint32_t bodies = 0;
+    uint32_t awakeBodies = 0;
+    /** Touching (or nearly touching) body pairs, and their contact points. */
+    uint32_t manifolds = 0;
+    uint32_t contacts = 0;
+    /** Islands of awake bodies solved, and how many fell asleep. */
+    uint32_t islands = 0;
+    uint32_t sleptIslands = 0;
+    /** Most colors any island's contacts needed, and the SIMD batches \
+     * solved per iteration across all islands.
+     */
+    uint32_t colors = 0;
+    uint32_t batches = 0;
+    /** Solver iterations run on each island. */
+    uint32_t iterations = 0;
+    /** Time spent finding pairs, generating contacts and solving, and in \
+     * the whole step, in milliseconds.
+     */
+    float broadphaseMs = 0.0f;
+    float narrowphaseMs = 0.0f;
+    float solverMs = 0.0f;
+    float stepMs = 0.0f;
+};
+
+/** Simulates boxes and spheres colliding, stacking and tumbling, such as \
+ * ships and debris.
+ * Each step moves the bodies' proxies in a Broadphase, builds a contact \
+ * manifold of up to 4 points for each touching pair on all threads, and \
+ * splits the awake bodies into islands joined by contacts. Islands are \
+ * solved in parallel, each on one thread, with sequential impulses warm \
+ * started from the last step. Within an island the contact points are \
+ * graph colored so no body appears twice in a color, and each color is \
+ * solved in batches of 4 (SSE2) or 8 (AVX) points at once.
+ * Islands whose bodies have all been still for a while fall asleep: their \
+ * proxies turn static, which the Broadphase caches, and they cost nothing \
+ * until something moving touches them or they're changed.
+ * Bodies keep the id add() returned until they're removed.
+ *
+ * Typical frame:
+ * \code
+ * world.step(1.0f / 60.0f);
+ * for (Crate &crate : crates)
+ *     world.transform(crate.body, crate.matrix);
+ * \endcode
+ */
+class LYS_API RigidBodyWorld {
+  public:
+    /** Constructor. Starts the worker threads.
+     * \param settings The simulation settings.
+     */
+    explicit RigidBodyWorld(const RigidBodySettings &settings = RigidBodySettings());
+
+    /** Destructor. Stops the worker threads. */
+    ~RigidBodyWorld();
+
+    RigidBodyWorld(const RigidBodyWorld& other) = delete;
+    RigidBodyWorld& operator=(const RigidBodyWorld& other) = delete;
+
+    /** Get the settings.
+     * \returns The settings.
+     */
+    const RigidBodySettings& settings() const;
+
+    /** Add a body, awake unless it's static.
+     * \param desc The body's shape, state and material.
+     * \returns The body's id; ids of removed bodies are reused.
+     */
+    uint32_t add(const RigidBodyDesc &desc);
+
+    /** Remove a body, waking whatever it was resting on or under.
+     * \param body The body's id.
+     */
+    void remove(uint32_t body);
+
+    /** Get a body's position.
+     * \param body The body's id.
+     * \returns The position of its center.
+     */
+    Point3Df position(uint32_t body) const;
+
+    /** Move a body, waking it.
+     * \param body The body's id.
+     * \param position The new position of its center.
+     */
+    void position(uint32_t body, const Point3Df &position);
+
+    /** Get a body's orientation.
+     * \param body The body's id.
+     * \returns A unit quaternion (x, y, z, w), valid until the next step.
+     */
+    const float* orientation(uint32_t body) const;
+
+    /** Turn a body, waking it.
+     * \param body The body's id.
+     * \param orientation A unit quaternion (x, y, z, w).
+     */
+    void orientation(uint32_t body, const float *orientation);
+
+    /** Get a body's velocity.
+     * \param body The body's id.
+     * \returns The velocity.
+     */
+    Point3Df velocity(uint32_t body) const;
+
+    /** Set a body's velocity, waking it.
+     * \param body The body's id.
+     * \param velocity The new velocity.
+     */
+    void velocity(uint32_t body, const Point3Df &velocity);
+
+    /** Get a body's angular velocity.
+     * \param body The body's id.
+     * \returns The angular velocity, in radians per second.
+     */
+    Point3Df angularVelocity(uint32_t body) const;
+
+    /** Set a body's angular velocity, waking it.
+     * \param body The body's id.
+     * \param angular_velocity The new angular velocity.
+     */
+    void angularVelocity(uint32_t body, const Point3Df &angular_velocity);
+
+    /** Push a body, waking it. Static bodies ignore this.
+     * \param body The body's id.
+     * \param impulse The impulse (mass times velocity change).
+     * \param point Where it's applied, in world space.
+     */
+    void applyImpulse(uint32_t body, const Point3Df &impulse, const Point3Df &point);
+
+    /** Check whether a body is awake. Static bodies never are.
+     * \param body The body's id.
+     * \returns True if it's being simulated.
+     */
+    bool awake(uint32_t body) const;
+
+    /** Wake a body, along with the island it fell asleep in.
+     * \param body The body's id.
+     */
+    void wake(uint32_t body);
+
+    /** Get a body's transform, for drawing it.
+     * \param body The body's id.
+     * \param matrix Receives a column-major 4x4 matrix.
+     */
+    void transform(uint32_t body, float *matrix) const;
+
+    /** Advance the simulation.
+     * \param seconds The time step; keep it fixed for steady stacking.
+     */
+    void step(float seconds);
+
+    /** Get the last step's statistics.
+     * \returns The statistics.
+     */
+    const RigidBodyStats& stats() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_RIGIDBODYWORLD_H_
@@ -0,0 +1,84 @@
+/***************************************************
+* ShaderProgram.h: GLSL program compilation        *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_SHADERPROGRAM_H_
+#define LYS3D_SHADERPROGRAM_H_
+
+#include "types.h"
+
+namespace lys3d {
+
+/** Owns a linked GLSL program object.
+ * Sources are written in GLSL ES 1.00 and also compile as desktop GLSL 1.10 \
+ * for the OpenGL 2.0 fallback: a default float precision is declared for \
+ * fragment shaders under GL_ES, and the engine's standard attribute names \
+ * (see VertexAttribLocation) are bound before linking.
+ */
+class LYS_API ShaderProgram {
+  public:
+    /** Default constructor. Creates an empty (unbuilt) program. */
+    ShaderProgram();
+
+    /** Destructor. Deletes the program object if one was built. */
+    ~ShaderProgram();
+
+    ShaderProgram(const ShaderProgram& other) = delete;
+    ShaderProgram& operator=(const ShaderProgram& other) = delete;
+
+    /** Compile and link a program in the current GL context.
+     * Replaces any previously built program.
+     * \param vertex_source Vertex shader source.
+     * \param fragment_source Fragment shader source.
+     * \param defines Text inserted at the top of both shaders, e.g. \
+     * "#define USE_FOG 1\n".
+     * \returns True on success; false on failure (see log()).
+     */
+    bool build(const String &vertex_source, const String &fragment_source,
+               const String &defines = String());
+
+    /** Delete the program object. */
+    void destroy();
+
+    /** Check whether build() succeeded.
+     * \returns True if the program is linked and usable.
+     */
+    bool isBuilt() const {
+        return program_ != 0;
+    }
+
+    /** Get the GL program name.
+     * \returns The program object, or 0 if not built.
+     */
+    uint32_t program() const {
+        return program_;
+    }
+
+    /** Make the program current (glUseProgram). */
+    void use() const;
+
+    /** Look up a uniform.
+     * \param name The uniform name.
+     * \returns The uniform location, or -1 if it doesn't exist.
+     */
+    int32_t uniformLocation(const char *name) const;
+
+    /** Get the compile/link log of the last build().
+     * \returns The driver's messages, if any.
+     */
+    const String& log() const {
+        return log_;
+    }
+
+  private:
+    uint32_t program_;
+    String log_;
+};
+}
+#endif // LYS3D_SHADERPROGRAM_H_
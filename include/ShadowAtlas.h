@@ -0,0 +1,209 @@
+/***************************************************
+* ShadowAtlas.h: Cached shadow-map tile atlas      *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_SHADOWATLAS_H_
+#define LYS3D_SHADOWATLAS_H_
+
+#include "types.h"
+#include "Box3D.h"
+#include "Point2D.h"
+#include "Point3D.h"
+
+namespace lys3d {
+
+/** Describes a shadow-casting light, as far as the atlas is concerned. */
+struct ShadowLight {
+    /** World-space position of the light. */
+    Point3Df position;
+    /** Direction the light is facing (ignored for omni lights, but still \
+     * compared to detect changes).
+     */
+    Point3Df direction;
+    /** Maximum distance the light reaches; used for caster intersection. */
+    float range = 0.0f;
+    /** Screen importance, as the fraction of the screen height covered by \
+     * the light's area of influence. 1.0 requests the largest tile size.
+     */
+    float importance = 0.0f;
+};
+
+/** A square region of the atlas assigned to a light. */
+struct ShadowTile {
+    /** ID of the light that owns the tile. */
+    uint32_t lightId = 0;
+    /** Bottom-left corner of the tile, in atlas texels. */
+    Point2Di32 origin;
+    /** Width and height of the tile, in atlas texels. */
+    int32_t size = 0;
+};
+
+/** Per-frame shadow atlas counters, refreshed by plan(). */
+struct ShadowAtlasStats {
+    /** Lights whose tile was reused as-is this frame. */
+    uint32_t cachedTiles = 0;
+    /** Tiles returned by plan() for re-rendering this frame. */
+    uint32_t refreshedTiles = 0;
+    /** Tiles that needed a refresh but were pushed back by the budget. */
+    uint32_t deferredTiles = 0;
+    /** Lights that could not get any tile because the atlas is full. */
+    uint32_t unallocatedLights = 0;
+    /** Texels of the atlas currently assigned to lights. */
+    uint64_t allocatedTexels = 0;
+};
+
+/** Manages a single shadow-map texture shared by all shadowed lights.
+ * Each light gets a power-of-two tile sized by its screen importance. Tiles
+ * are only re-rendered when the light or a caster within its range moved,
+ * and no more than budget() tiles are refreshed per frame.
+ *
+ * Typical frame:
+ * \code
+ * atlas.light(id, params);            // for each visible light
+ * atlas.caster(id, bounds);           // for each caster that (may have) moved
+ * for (const ShadowTile &tile : atlas.plan()) {
+ *     atlas.bindTile(tile);
+ *     // render casters from the light's point of view
+ * }
+ * atlas.finishTiles();
+ * \endcode
+ */
+class LYS_API ShadowAtlas {
+  public:
+    /** Constructor.
+     * Only sets up the tile allocator; call create() for the GL resources.
+     * \param atlas_size Width and height of the atlas texture, in texels. \
+     * Should be a power of two.
+     * \param min_tile_size Smallest tile handed out, in texels.
+     */
+    explicit ShadowAtlas(int32_t atlas_size = 2048, int32_t min_tile_size = 64);
+
+    /** Destructor.
+     * Releases the GL resources if they are still allocated.
+     */
+    ~ShadowAtlas();
+
+    ShadowAtlas(const ShadowAtlas& other) = delete;
+    ShadowAtlas& operator=(const ShadowAtlas& other) = delete;
+
+    /** Create the atlas texture and framebuffer in the current GL context.
+     * Uses a depth texture if GL_OES_depth_texture is advertised, otherwise \
+     * an RGBA8 texture that shaders must write packed depth into (see \
+     * kShadowPackGLSL).
+     * \returns True if the framebuffer is complete, false otherwise.
+     */
+    bool create();
+
+    /** Release the GL resources. Tile assignments are kept. */
+    void destroy();
+
+    /** Check whether create() succeeded.
+     * \returns True if the GL resources are allocated.
+     */
+    bool isCreated() const;
+
+    /** Check which storage format is in use.
+     * \returns True for a real depth texture, false for the RGBA fallback.
+     */
+    bool usesDepthTexture() const;
+
+    /** Get the GL texture name to sample shadows from.
+     * \returns The atlas texture, or 0 if not created.
+     */
+    uint32_t texture() const;
+
+    /** Get the atlas size.
+     * \returns Width (and height) of the atlas, in texels.
+     */
+    int32_t atlasSize() const;
+
+    /** Get the per-frame refresh budget.
+     * \returns The maximum number of tiles plan() returns per frame.
+     */
+    uint32_t budget() const;
+
+    /** Set the per-frame refresh budget.
+     * \param max_tiles The maximum number of tiles plan() returns per frame.
+     */
+    void budget(uint32_t max_tiles);
+
+    /** Add or update a light.
+     * The light's tile is invalidated if its position, direction or range \
+     * changed since the last call.
+     * \param id Caller-defined unique ID of the light.
+     * \param light The current light parameters.
+     */
+    void light(uint32_t id, const ShadowLight &light);
+
+    /** Remove a light and free its tile.
+     * \param id The ID previously passed to light().
+     */
+    void removeLight(uint32_t id);
+
+    /** Add or update a shadow caster.
+     * If the bounds changed (or the caster is new), every light whose range \
+     * overlaps the old or new bounds is invalidated.
+     * \param id Caller-defined unique ID of the caster.
+     * \param bounds World-space bounds of the caster.
+     */
+    void caster(uint32_t id, const Box3Df &bounds);
+
+    /** Remove a caster, invalidating the lights it was inside of.
+     * \param id The ID previously passed to caster().
+     */
+    void removeCaster(uint32_t id);
+
+    /** Assign tiles and pick the ones to re-render this frame.
+     * Call once per frame after all light() / caster() updates.
+     * \returns The tiles that must be rendered this frame, most important first.
+     */
+    const Vector<ShadowTile>& plan();
+
+    /** Get the tile currently assigned to a light.
+     * \param id The light ID.
+     * \param tile Receives the tile, if any.
+     * \returns True if the light has a tile with valid contents, false otherwise.
+     */
+    bool tile(uint32_t id, ShadowTile *tile) const;
+
+    /** Get the texture-coordinate transform for sampling a tile.
+     * \param tile A tile returned by plan() or tile().
+     * \param scale_offset Receives (scale x, scale y, offset x, offset y).
+     */
+    void uvTransform(const ShadowTile &tile, float scale_offset[4]) const;
+
+    /** Bind the atlas framebuffer and restrict rendering to a tile.
+     * Clears only the tile's region. The viewport is left set to the tile.
+     * \param tile A tile returned by plan().
+     * \returns True if the tile is ready to be rendered into.
+     */
+    bool bindTile(const ShadowTile &tile);
+
+    /** Restore default framebuffer state after rendering tiles.
+     * The caller is responsible for resetting its own viewport afterwards.
+     */
+    void finishTiles();
+
+    /** Get the counters from the last plan() call.
+     * \returns The current frame's statistics.
+     */
+    const ShadowAtlasStats& stats() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+
+/** GLSL helpers for the RGBA fallback atlas.
+ * Declares vec4 lysPackDepth(float) for caster shaders and \
+ * float lysUnpackDepth(vec4) for receivers.
+ */
+extern LYS_API const char* kShadowPackGLSL;
+}
+#endif // LYS3D_SHADOWATLAS_H_
@@ -0,0 +1,139 @@
+/***************************************************
+* TextRenderer.h: Batched SDF text                 *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_TEXTRENDERER_H_
+#define LYS3D_TEXTRENDERER_H_
+
+#include "types.h"
+#include "Dimension2D.h"
+#include "Font.h"
+
+namespace lys3d {
+
+/** Construction-time settings of a TextRenderer. */
+struct TextSettings {
+    /** Width and height of the glyph atlas texture, in pixels. */
+    uint32_t atlasSize = 1024;
+    /** Size of an em in the atlas, in pixels. Text stays sharp when drawn \
+     * at several times this size.
+     */
+    float glyphSize = 32.0f;
+    /** How far the distance field reaches past the outlines, in atlas \
+     * pixels; more allows smaller text without the edges breaking up.
+     */
+    float spread = 4.0f;
+};
+
+/** What the renderer did since the last begin(). */
+struct TextStats {
+    /** Glyph quads laid out, and draw calls made for them. */
+    uint32_t glyphs = 0;
+    uint32_t drawCalls = 0;
+    /** Glyphs rendered into the atlas, and older ones evicted for them. */
+    uint32_t generated = 0;
+    uint32_t evicted = 0;
+    /** Glyphs in the atlas, and how many it can hold. */
+    uint32_t cached = 0;
+    uint32_t capacity = 0;
+    /** Atlas bytes sent to the GPU. */
+    uint32_t uploadedBytes = 0;
+};
+
+/** Draws text from signed distance field glyphs, so one atlas serves every \
+ * size and text scales without blurring.
+ * Glyphs are rendered from their Font outlines the first time they're \
+ * used, into equal cells of one luminance atlas texture. The atlas is a \
+ * least-recently-used cache: when it's full, the glyph unused for longest \
+ * makes room, so large character sets (CJK, say) work with a small atlas.
+ * text() only lays out quads into a vertex buffer; end() uploads the \
+ * atlas rows that changed and draws everything in one call. Should one \
+ * batch need more glyphs than the atlas holds, it's drawn in several.
+ *
+ * Typical frame:
+ * \code
+ * text.begin(window.sizeInPixels());
+ * text.text(mono, "FPS 60", 8.0f, 8.0f, 16.0f, 0xFFFFFFFF);
+ * text.text(sans, chat_line, 8.0f, 400.0f, 20.0f, 0xFFE080FF);
+ * text.end();
+ * \endcode
+ */
+class LYS_API TextRenderer {
+  public:
+    /** Constructor. GL objects are made on the first end().
+     * \param settings The atlas settings.
+     */
+    explicit TextRenderer(const TextSettings &settings = TextSettings());
+
+    /** Destructor. Deletes the GL objects; the context they were made in \
+     * must be current.
+     */
+    ~TextRenderer();
+
+    TextRenderer(const TextRenderer& other) = delete;
+    TextRenderer& operator=(const TextRenderer& other) = delete;
+
+    /** Get the settings.
+     * \returns The settings.
+     */
+    const TextSettings& settings() const;
+
+    /** Register a font to draw with.
+     * \param font The font; must stay loaded for the renderer's lifetime.
+     * \returns The font id, for text().
+     */
+    uint32_t addFont(const Font *font);
+
+    /** Start a batch, dropping any text not yet drawn and resetting stats().
+     * \param viewport Size of the framebuffer drawn to, in pixels.
+     */
+    void begin(const Dimension2Di32 &viewport);
+
+    /** Lay out a string. Lines break at '\n'.
+     * Needs a current GL context only if the atlas fills up mid-batch.
+     * \param font The font id, from addFont().
+     * \param utf8 The text, in UTF-8; invalid bytes show as U+FFFD.
+     * \param x Left edge, in pixels from the left of the viewport.
+     * \param y Top of the first line, in pixels from the top.
+     * \param size The font size (an em), in pixels.
+     * \param rgba The color, 0xRRGGBBAA.
+     * \returns The size of the laid out text, in pixels.
+     */
+    Dimension2Df text(uint32_t font, const char *utf8, float x, float y, float size, uint32_t rgba);
+
+    /** Measure a string without laying it out.
+     * \param font The font id, from addFont().
+     * \param utf8 The text, in UTF-8.
+     * \param size The font size, in pixels.
+     * \returns The size it would take, in pixels.
+     */
+    Dimension2Df measure(uint32_t font, const char *utf8, float size) const;
+
+    /** Draw the batch over the bound framebuffer, with blending on and \
+     * depth testing off. Needs a current GL context; leaves the renderer's \
+     * program, texture and array buffer bound.
+     */
+    void end();
+
+    /** Get the statistics since the last begin().
+     * \returns The statistics.
+     */
+    const TextStats& stats() const;
+
+    /** Get the atlas texture.
+     * \returns The GL texture name, or 0 before the first end().
+     */
+    uint32_t texture() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_TEXTRENDERER_H_
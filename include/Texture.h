@@ -0,0 +1,226 @@
+/***************************************************
+* Texture.h: 2D textures, KTX & image loading      *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_TEXTURE_H_
+#define LYS3D_TEXTURE_H_
+
+#include <stddef.h>
+
+#include "types.h"
+#include "Dimension2D.h"
+
+namespace lys3d {
+
+/** One mip level of a KTX image. Points into the container's memory. */
+struct KtxLevel {
+    const uint8_t *data;
+    uint32_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+/** A parsed KTX (version 1) container. Only 2D textures are supported.
+ * The levels point into the memory that was parsed, so it must outlive \
+ * the KtxImage.
+ */
+struct KtxImage {
+    /** 0 for compressed formats. */
+    uint32_t glType;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t width;
+    uint32_t height;
+    /** Mip levels, largest first. */
+    Vector<KtxLevel> levels;
+};
+
+/** Parse just the 64-byte header of a KTX 1.1 container.
+ * Fills in everything but the level data: each level gets its size in \
+ * pixels, with a null data pointer and a zero byte size.
+ * \param data The start of the container (at least 64 bytes).
+ * \param size The number of bytes available.
+ * \param image Receives the header fields and level dimensions.
+ * \param first_level Receives the offset of the first level's size field.
+ * \param swapped Receives whether the file's byte order is swapped.
+ * \returns True on success; false if the header is not a valid 2D KTX file.
+ */
+LYS_API bool parseKTXHeader(const void *data, size_t size, KtxImage *image, size_t *first_level, bool *swapped);
+
+/** Parse a KTX 1.1 container without copying its image data.
+ * Both byte orders are accepted for compressed data and single-byte types.
+ * \param data The container contents.
+ * \param size The size of the container, in bytes.
+ * \param image Receives the header fields and level pointers.
+ * \returns True on success; false if the data is not a valid 2D KTX file.
+ */
+LYS_API bool parseKTX(const void *data, size_t size, KtxImage *image);
+
+/** Decode ETC1 blocks to 8-bit RGB.
+ * \param blocks The compressed data: 8 bytes per 4x4 block, row by row.
+ * \param width Image width in pixels (need not be a multiple of 4).
+ * \param height Image height in pixels.
+ * \param rgb Receives width * height * 3 bytes.
+ */
+LYS_API void decodeETC1(const uint8_t *blocks, uint32_t width, uint32_t height, uint8_t *rgb);
+
+/** Pixel formats used when compressed data has to be decoded on the CPU. */
+enum class TextureDecodeFormat : uint8_t {
+    kRGB565,  ///< Half the memory of RGBA8; good enough for most ETC1 content
+    kRGBA8,   ///< Full precision
+};
+
+/** Owns a GL 2D texture loaded from a KTX container or a regular image.
+ * KTX data in a compressed format the driver advertises (e.g. ETC1 through \
+ * GL_OES_compressed_ETC1_RGB8_texture) is handed to glCompressedTexImage2D \
+ * straight from the container, every mip level included. ETC1 without driver \
+ * support is decoded on the CPU instead.
+ */
+class LYS_API Texture {
+  public:
+    /** Default constructor. Creates an empty texture. */
+    Texture();
+
+    /** Destructor. Deletes the texture object if one was loaded. */
+    ~Texture();
+
+    Texture(const Texture& other) = delete;
+    Texture& operator=(const Texture& other) = delete;
+
+    /** Get the format used when ETC1 has to be decoded on the CPU.
+     * \returns The decode format (RGB565 by default).
+     */
+    TextureDecodeFormat decodeFormat() const {
+        return decodeFormat_;
+    }
+
+    /** Set the format used when ETC1 has to be decoded on the CPU.
+     * \param format The decode format.
+     */
+    void decodeFormat(TextureDecodeFormat format) {
+        decodeFormat_ = format;
+    }
+
+    /** Always decode ETC1 on the CPU, even if the driver supports it. \
+     * Mostly useful for testing the fallback.
+     * \param force True to skip the compressed upload path.
+     */
+    void forceDecode(bool force) {
+        forceDecode_ = force;
+    }
+
+    /** Load a KTX file through PhysFS.
+     * Needs a current GL context.
+     * \param path The PhysFS path of the file.
+     * \returns True on success; false on failure, leaving the texture empty.
+     */
+    bool loadKTX(const String &path);
+
+    /** Load a KTX file from the native filesystem, mapping it into memory \
+     * where the platform allows (falling back to a plain read).
+     * Needs a current GL context.
+     * \param native_path The path of the file.
+     * \returns True on success; false on failure, leaving the texture empty.
+     */
+    bool loadKTXFile(const String &native_path);
+
+    /** Load a KTX container from memory.
+     * Needs a current GL context.
+     * \param data The container contents.
+     * \param size The size of the container, in bytes.
+     * \returns True on success; false on failure, leaving the texture empty.
+     */
+    bool loadKTXFromMemory(const void *data, size_t size);
+
+    /** Load already-parsed KTX levels, e.g. a range of a file's mips.
+     * Needs a current GL context.
+     * \param image The header fields and level pointers.
+     * \returns True on success; false on failure (including levels smaller \
+     * than their dimensions need), leaving the texture empty.
+     */
+    bool load(const KtxImage &image);
+
+    /** Load an image (PNG, etc.) through PhysFS and SDL2_image, as RGBA8 \
+     * with generated mipmaps.
+     * Needs a current GL context.
+     * \param path The PhysFS path of the file.
+     * \returns True on success; false on failure, leaving the texture empty.
+     */
+    bool loadImage(const String &path);
+
+    /** Load an image (PNG, etc.) from memory, as RGBA8 with generated mipmaps.
+     * Needs a current GL context.
+     * \param data The file contents.
+     * \param size The size of the file, in bytes.
+     * \returns True on success; false on failure, leaving the texture empty.
+     */
+    bool loadImageFromMemory(const void *data, size_t size);
+
+    /** Delete the texture object. */
+    void destroy();
+
+    /** Check whether a texture is loaded.
+     * \returns True if the texture is usable.
+     */
+    bool isLoaded() const {
+        return texture_ != 0;
+    }
+
+    /** Get the GL texture name.
+     * \returns The texture object, or 0 if not loaded.
+     */
+    uint32_t texture() const {
+        return texture_;
+    }
+
+    /** Get the size of the top mip level.
+     * \returns The size, in pixels.
+     */
+    const Dimension2Di32& size() const {
+        return size_;
+    }
+
+    /** Get the number of mip levels uploaded (or generated).
+     * \returns The level count.
+     */
+    uint32_t levels() const {
+        return levels_;
+    }
+
+    /** Get the (estimated) video memory used by all levels.
+     * \returns The size, in bytes.
+     */
+    uint64_t byteSize() const {
+        return byteSize_;
+    }
+
+    /** Check whether the texture is stored compressed on the GPU.
+     * \returns True if the compressed upload path was used.
+     */
+    bool isCompressed() const {
+        return compressed_;
+    }
+
+    /** Bind the texture to a texture unit.
+     * \param unit The texture unit index (0 for GL_TEXTURE0).
+     */
+    void bind(uint32_t unit = 0) const;
+
+  private:
+    uint32_t texture_;
+    Dimension2Di32 size_;
+    uint32_t levels_;
+    uint64_t byteSize_;
+    bool compressed_;
+    bool forceDecode_;
+    TextureDecodeFormat decodeFormat_;
+};
+}
+#endif // LYS3D_TEXTURE_H_
@@ -0,0 +1,189 @@
+/***************************************************
+* TextureStreamer.h: Mip streaming within a budget *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_TEXTURESTREAMER_H_
+#define LYS3D_TEXTURESTREAMER_H_
+
+#include "types.h"
+#include "Dimension2D.h"
+#include "IWindow.h"
+#include "Point3D.h"
+
+namespace lys3d {
+
+/** What the streamer did in the last frame. */
+struct TextureStreamStats {
+    /** Video memory held by streamed textures after this frame's uploads. */
+    uint64_t residentBytes;
+    /** Reads queued, in flight or waiting to be uploaded. */
+    uint32_t pendingRequests;
+    /** Textures that were drawn this frame but held back by the budget. */
+    uint32_t budgetMisses;
+    /** Textures re-uploaded this frame. */
+    uint32_t uploads;
+    /** Bytes handed to GL this frame. */
+    uint64_t uploadedBytes;
+};
+
+/** Keeps only the mip levels that are needed on screen resident.
+ * Streamed textures are KTX files read through PhysFS. Each one starts with \
+ * just its mip tail (levels no larger than minResidentSize()); every frame \
+ * the renderer reports how many screen pixels each visible texture covers, \
+ * and the streamer works out which level that calls for, reads the missing \
+ * levels on a background thread and uploads them. When the wanted levels \
+ * don't fit the budget, the least recently needed textures drop back to \
+ * coarser levels first.
+ * GLES2 has no GL_TEXTURE_BASE_LEVEL, so a residency change replaces the \
+ * texture object with a new one holding levels [top, tail]; the GL name \
+ * returned by texture() changes whenever that happens.
+ */
+class LYS_API TextureStreamer {
+  public:
+    /** Constructor.
+     * \param budget Video memory allowed for streamed textures, in bytes.
+     */
+    explicit TextureStreamer(uint64_t budget = 64 * 1024 * 1024);
+
+    /** Destructor. Stops the loader thread and deletes all textures; the \
+     * GL context they were made in must be current.
+     */
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer& other) = delete;
+    TextureStreamer& operator=(const TextureStreamer& other) = delete;
+
+    /** Get the video memory budget.
+     * \returns The budget, in bytes.
+     */
+    uint64_t budget() const;
+
+    /** Set the video memory budget. Takes effect at the next plan().
+     * \param bytes The budget, in bytes.
+     */
+    void budget(uint64_t bytes);
+
+    /** Get the size below which levels are always resident.
+     * \returns The size in pixels (64 by default).
+     */
+    uint32_t minResidentSize() const;
+
+    /** Set the size below which levels are always resident. Only affects \
+     * textures added afterwards.
+     * \param pixels The size in pixels.
+     */
+    void minResidentSize(uint32_t pixels);
+
+    /** Get the number of bytes uploaded per frame before the rest waits for \
+     * the next one. At least one texture is always uploaded.
+     * \returns The limit, in bytes (4 MiB by default).
+     */
+    uint64_t uploadLimit() const;
+
+    /** Set the per-frame upload limit.
+     * \param bytes The limit, in bytes.
+     */
+    void uploadLimit(uint64_t bytes);
+
+    /** Set up the projection used by request(camera, ...) from a window.
+     * \param window The window being rendered to.
+     * \param fov_y Vertical field of view, in radians.
+     */
+    void projection(const IWindow &window, float fov_y);
+
+    /** Set up the projection used by request(camera, ...).
+     * \param viewport Viewport size, in pixels.
+     * \param fov_y Vertical field of view, in radians.
+     */
+    void projection(const Dimension2Di32 &viewport, float fov_y);
+
+    /** Add a streamed texture. Only the header is read here; the mip tail \
+     * is loaded by the next update().
+     * \param path The PhysFS path of a KTX file.
+     * \returns An id for the texture, or 0 if the file isn't a usable KTX file.
+     */
+    uint32_t add(const String &path);
+
+    /** Remove a streamed texture and free its video memory at the next upload().
+     * \param id The texture id.
+     */
+    void remove(uint32_t id);
+
+    /** Report that a texture is drawn this frame.
+     * Call once per visible use; the largest coverage of the frame counts.
+     * \param id The texture id.
+     * \param pixels How many screen pixels the texture's full width spans.
+     */
+    void request(uint32_t id, float pixels);
+
+    /** Report that a texture is drawn this frame on an object's bounding sphere.
+     * \param id The texture id.
+     * \param camera The camera position.
+     * \param center The bounding sphere center.
+     * \param radius The bounding sphere radius.
+     * \param repeat How many times the texture repeats across the sphere's \
+     * diameter.
+     */
+    void request(uint32_t id, const Point3Df &camera, const Point3Df &center, float radius,
+                 float repeat = 1.0f);
+
+    /** Pick target levels from this frame's requests, enforce the budget and \
+     * queue reads for textures that need a different level range. Doesn't \
+     * touch GL, so it can be tested (and run) without a context.
+     */
+    void plan();
+
+    /** Upload levels that finished loading, replacing the textures they belong \
+     * to. Needs a current GL context.
+     */
+    void upload();
+
+    /** Run plan() then upload(); call once per frame after the visible list \
+     * is built.
+     */
+    void update();
+
+    /** Wait until all queued reads have finished loading (not uploading). */
+    void finish();
+
+    /** Get the GL texture for a streamed texture.
+     * \param id The texture id.
+     * \returns The texture object, or 0 until the mip tail is uploaded.
+     */
+    uint32_t texture(uint32_t id) const;
+
+    /** Get the level a texture is being streamed towards.
+     * \param id The texture id.
+     * \returns The top level index (0 is full resolution).
+     */
+    uint32_t targetLevel(uint32_t id) const;
+
+    /** Get the top level currently uploaded.
+     * \param id The texture id.
+     * \returns The top level index, or the level count if nothing is resident.
+     */
+    uint32_t residentLevel(uint32_t id) const;
+
+    /** Get the levels stored in a texture's file.
+     * \param id The texture id.
+     * \returns The level count, or 0 for an unknown id.
+     */
+    uint32_t levelCount(uint32_t id) const;
+
+    /** Get the last frame's statistics (from the last plan() and upload()).
+     * \returns The statistics.
+     */
+    const TextureStreamStats& stats() const;
+
+  private:
+    struct Impl;
+    Impl *pimpl_;
+};
+}
+#endif // LYS3D_TEXTURESTREAMER_H_
@@ -0,0 +1,176 @@
+/***************************************************
+* VertexLayout.h: Vertex formats & quantization    *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_VERTEXLAYOUT_H_
+#define LYS3D_VERTEXLAYOUT_H_
+
+#include <stddef.h>
+
+#include "types.h"
+#include "Mesh.h"
+
+namespace lys3d {
+
+/** Attribute locations shared by all engine shaders.
+ * ShaderProgram binds these names to these locations before linking.
+ */
+enum VertexAttribLocation : uint32_t {
+    kAttribPosition = 0,  ///< "a_position"
+    kAttribNormal = 1,    ///< "a_normal"
+    kAttribTexCoord = 2,  ///< "a_texcoord"
+    kAttribColor = 3,     ///< "a_color"
+    kAttribJoints = 4,    ///< "a_joints"
+    kAttribWeights = 5,   ///< "a_weights"
+    kAttribCount
+};
+
+/** Storage formats for a vertex attribute component. */
+enum class VertexFormat : uint8_t {
+    kFloat,      ///< 32-bit float
+    kHalfFloat,  ///< 16-bit float (needs GL_OES_vertex_half_float)
+    kShortNorm,  ///< Signed 16-bit, normalized to [-1, 1]
+    kUShortNorm, ///< Unsigned 16-bit, normalized to [0, 1]
+    kByteNorm,   ///< Signed 8-bit, normalized to [-1, 1]
+    kUByteNorm,  ///< Unsigned 8-bit, normalized to [0, 1]
+};
+
+/** One attribute of an interleaved vertex. */
+struct VertexAttribute {
+    uint32_t location;
+    uint8_t components;
+    VertexFormat format;
+    uint16_t offset;
+};
+
+/** Describes an interleaved vertex and binds it with glVertexAttribPointer. */
+class LYS_API VertexLayout {
+  public:
+    /** Default constructor. Creates a layout with no attributes. */
+    VertexLayout() = default;
+    ~VertexLayout() = default;
+
+    /** Append an attribute after the previous ones.
+     * Offsets are padded to 4 bytes, as some GLES2 drivers fall off the fast \
+     * path (or break) with unaligned attributes.
+     * \param location The attribute location (see VertexAttribLocation).
+     * \param components Number of components (1-4).
+     * \param format Storage format of each component.
+     * \returns This layout, for chaining.
+     */
+    VertexLayout& add(uint32_t location, uint8_t components, VertexFormat format);
+
+    /** Get the attributes.
+     * \returns The attributes, in the order they were added.
+     */
+    const Vector<VertexAttribute>& attributes() const {
+        return attributes_;
+    }
+
+    /** Get the size of one vertex.
+     * \returns The stride, in bytes.
+     */
+    uint32_t stride() const {
+        return stride_;
+    }
+
+    /** Point the attributes at the currently bound GL_ARRAY_BUFFER and enable \
+     * them.
+     * \param base_offset Byte offset of the first vertex in the buffer.
+     */
+    void apply(size_t base_offset = 0) const;
+
+    /** Move the attribute pointers to another base offset without enabling \
+     * anything, e.g. to draw the next mesh out of a shared buffer.
+     * \param base_offset Byte offset of the first vertex in the buffer.
+     */
+    void rebase(size_t base_offset) const;
+
+    /** Disable the attributes enabled by apply(). */
+    void disable() const;
+
+    /** Get the layout matching MeshVertex (32 bytes). */
+    static VertexLayout full();
+
+    /** Get the compressed layout written by VertexQuantizer (16 bytes).
+     * \param half_float_uvs True for half-float UVs, false for normalized \
+     * unsigned shorts (when GL_OES_vertex_half_float is unavailable).
+     */
+    static VertexLayout compressed(bool half_float_uvs);
+
+  private:
+    Vector<VertexAttribute> attributes_;
+    uint32_t stride_ = 0;
+};
+
+/** A mesh's vertices in compressed form, plus what shaders need to decode \
+ * them (see kVertexDecodeGLSL).
+ */
+struct QuantizedVertices {
+    VertexLayout layout;
+    Vector<uint8_t> data;
+    /** Decode with position = quantized * positionScale + positionBias */
+    float positionScale[3];
+    float positionBias[3];
+    /** Decode with uv = quantized * uvScale + uvBias (identity for half floats) */
+    float uvScale[2];
+    float uvBias[2];
+};
+
+/** Compresses MeshVertex data: positions to 16-bit normalized integers \
+ * relative to the mesh bounds, normals to 8-bit octahedral coordinates and \
+ * UVs to half floats (or 16-bit normalized integers).
+ */
+class LYS_API VertexQuantizer {
+  public:
+    /** Default constructor. Uses half-float UVs if available at quantize() \
+     * time.
+     */
+    VertexQuantizer() = default;
+    ~VertexQuantizer() = default;
+
+    /** Force a UV format instead of checking for GL_OES_vertex_half_float.
+     * \param half_float_uvs True for half floats, false for 16-bit integers.
+     */
+    void useHalfFloatUVs(bool half_float_uvs) {
+        forceUVFormat_ = true;
+        halfFloatUVs_ = half_float_uvs;
+    }
+
+    /** Compress all of a mesh's vertices.
+     * Needs a current GL context unless useHalfFloatUVs() was called.
+     * \param vertices The vertices to compress.
+     * \param out Receives the compressed vertices and decode parameters.
+     */
+    void quantize(const Vector<MeshVertex> &vertices, QuantizedVertices *out) const;
+
+  private:
+    bool forceUVFormat_ = false;
+    bool halfFloatUVs_ = true;
+};
+
+/** Convert a float to IEEE half precision (round to nearest even).
+ * \param value The value to convert.
+ * \returns The half-float bit pattern.
+ */
+LYS_API uint16_t floatToHalf(float value);
+
+/** Convert an IEEE half-precision value to float.
+ * \param half The half-float bit pattern.
+ * \returns The converted value.
+ */
+LYS_API float halfToFloat(uint16_t half);
+
+/** GLSL helpers for VertexQuantizer output.
+ * Declares vec3 lysDecodePosition(vec3 q, vec3 scale, vec3 bias) and \
+ * vec3 lysDecodeNormal(vec2 oct).
+ */
+extern LYS_API const char* kVertexDecodeGLSL;
+}
+#endif // LYS3D_VERTEXLAYOUT_H_
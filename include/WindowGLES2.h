@@ -11,7 +11,9 @@
 #ifndef LYS3D_WINDOW_H_
 #define LYS3D_WINDOW_H_
 
+#include "FrameCapture.h"
 #include "IWindow.h"
+#include "ResolutionController.h"
 
 namespace lys3d {
 /** Encapsulates an OpenGL-accelerated graphical window. */
@@ -47,6 +49,97 @@ class LYS_API WindowGLES2 : public IWindow {
     bool isVSyncEnabled() const;
     bool useVSync(bool enable = true);
 
+    /** Check whether the profiler overlay is shown.
+     * \returns True if update() draws the overlay.
+     */
+    bool isProfilerShown() const;
+
+    /** Show or hide the profiler overlay.
+     * While shown, the global Profiler is enabled and counts GL calls, and \
+     * update() ends its frame, draws it over the back buffer in a single \
+     * draw call and starts the next frame after the swap.
+     * Can be called any time (before or after open() or close()).
+     * \param show True to show the overlay, false to hide it.
+     */
+    void showProfiler(bool show = true);
+
+    /** Check whether GL calls are checked for errors and slow paths.
+     * \returns True if the checks are on; always false in release builds.
+     */
+    bool isGLCheckingEnabled() const;
+
+    /** Turn the GL checks on or off. They start on in debug builds and \
+     * don't exist in release builds, where this does nothing.
+     * While on, every GL call is followed by glGetError(), and errors are \
+     * logged with the call, its arguments and the file and line it was \
+     * made from. Queries that wait on the driver, binds of what is already \
+     * bound and glEnable()/glDisable() of what is already set are counted \
+     * into the "GL queries", "GL redundant binds" and "GL redundant state" \
+     * profiler counters, and a call site that makes them frame after frame \
+     * is logged once.
+     * Can be called any time (before or after open() or close()).
+     * \param enable True to turn the checks on.
+     */
+    void useGLChecking(bool enable = true);
+
+    /** Check whether the scene is rendered at a dynamic resolution.
+     * \returns True if dynamic resolution is on.
+     */
+    bool isDynamicResolutionEnabled() const;
+
+    /** Turn dynamic resolution on or off (it starts off).
+     * While on, beginScene() binds an offscreen target sized to \
+     * sizeInPixels() times resolutionScale(), and endScene() upscales it to \
+     * the window with a bilinear filter, so whatever is drawn afterwards \
+     * (e.g. the UI) stays at native resolution. update() feeds the frame \
+     * time to a ResolutionController, which picks the next frame's scale: \
+     * the GPU time from GL_EXT_disjoint_timer_query where available, \
+     * otherwise the CPU time, plus the time between swaps when VSync is off \
+     * or a frame was dropped.
+     * \param enable True to turn it on.
+     */
+    void useDynamicResolution(bool enable = true);
+
+    /** Get the scale the scene is rendered at.
+     * \returns The scale per axis, or 1 while dynamic resolution is off.
+     */
+    float resolutionScale() const;
+
+    /** Get the dynamic resolution tuning.
+     * \returns The controller's settings.
+     */
+    const DynamicResolutionSettings& dynamicResolution() const;
+
+    /** Set the dynamic resolution tuning, e.g. the target frame time.
+     * \param settings The controller's settings.
+     */
+    void dynamicResolution(const DynamicResolutionSettings &settings);
+
+    /** Get the size the scene renders at, as set up by beginScene().
+     * \returns The scene viewport size, in pixels.
+     */
+    Dimension2Di32 sceneSize() const;
+
+    /** Start drawing the 3D scene. Binds the (scaled) scene target, or the \
+     * default framebuffer with dynamic resolution off, and sets the \
+     * viewport to sceneSize(). The scene target starts out cleared.
+     * \returns False if the scene target couldn't be created; the scene \
+     * then renders at native resolution.
+     */
+    bool beginScene();
+
+    /** Finish the 3D scene, upscaling it to the window if needed. The \
+     * default framebuffer is left bound with its full viewport.
+     */
+    void endScene();
+
+    /** Get the capture that takes screenshots and records video of this \
+     * window. update() captures each finished frame with it, before the \
+     * profiler overlay is drawn; close() stops it.
+     * \returns The window's frame capture.
+     */
+    FrameCapture& frameCapture();
+
   private:
     struct Impl;
     Impl *pimpl_;
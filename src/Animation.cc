@@ -0,0 +1,540 @@
+/***************************************************
+* Animation.cc: Skeletons and compressed clips     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Animation.h"
+
+#include <math.h>
+#include <algorithm>
+
+#include "config.h"
+#include "types.h"
+#include "Simd.h"
+
+namespace lys3d {
+namespace {
+// Smallest-three components lie within +-1/sqrt(2)
+const float kQuatRange = 0.70710678f;
+const float kQuatSteps = 32767.0f;
+
+// Stream indices in SkeletonPose
+enum PoseStream : uint32_t {
+    kRotX, kRotY, kRotZ, kRotW, kPosX, kPosY, kPosZ, kScale
+};
+
+// out = normalize(lerp(a, b, t)), flipping b onto a's hemisphere first, for
+// four joints; each argument points at four x, y, z and w values
+void nlerp4(const float *const a[4], const float *const b[4], const float *t, float *const out[4]) {
+#ifdef LYS_SIMD_SSE2
+    __m128 ax = _mm_loadu_ps(a[0]), ay = _mm_loadu_ps(a[1]), az = _mm_loadu_ps(a[2]), aw = _mm_loadu_ps(a[3]);
+    __m128 bx = _mm_loadu_ps(b[0]), by = _mm_loadu_ps(b[1]), bz = _mm_loadu_ps(b[2]), bw = _mm_loadu_ps(b[3]);
+    __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+                            _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+    __m128 sign = _mm_and_ps(dot, _mm_set1_ps(-0.0f));
+    __m128 w = _mm_loadu_ps(t);
+    __m128 x = _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(bx, sign), ax), w));
+    __m128 y = _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(by, sign), ay), w));
+    __m128 z = _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(bz, sign), az), w));
+    __m128 r = _mm_add_ps(aw, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(bw, sign), aw), w));
+    __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                                           _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(r, r))));
+    __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(length, _mm_set1_ps(1e-12f)));
+    _mm_storeu_ps(out[0], _mm_mul_ps(x, inv));
+    _mm_storeu_ps(out[1], _mm_mul_ps(y, inv));
+    _mm_storeu_ps(out[2], _mm_mul_ps(z, inv));
+    _mm_storeu_ps(out[3], _mm_mul_ps(r, inv));
+#else
+    for (int i = 0; i < 4; ++i) {
+        float dot = a[0][i] * b[0][i] + a[1][i] * b[1][i] + a[2][i] * b[2][i] + a[3][i] * b[3][i];
+        float flip = dot < 0.0f ? -1.0f : 1.0f;
+        float q[4], length = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            q[c] = a[c][i] + (b[c][i] * flip - a[c][i]) * t[i];
+            length += q[c] * q[c];
+        }
+        float inv = 1.0f / std::max(sqrtf(length), 1e-12f);
+        for (int c = 0; c < 4; ++c)
+            out[c][i] = q[c] * inv;
+    }
+#endif
+}
+
+// The same for one quaternion, as compression checks single joints
+void nlerp(const float a[4], const float b[4], float t, float out[4]) {
+    float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    float flip = dot < 0.0f ? -1.0f : 1.0f;
+    float length = 0.0f;
+    for (int c = 0; c < 4; ++c) {
+        out[c] = a[c] + (b[c] * flip - a[c]) * t;
+        length += out[c] * out[c];
+    }
+    float inv = 1.0f / std::max(sqrtf(length), 1e-12f);
+    for (int c = 0; c < 4; ++c)
+        out[c] *= inv;
+}
+
+// out = lerp(a, b, t) for four values
+void lerp4(const float *a, const float *b, const float *t, float *out) {
+#ifdef LYS_SIMD_SSE2
+    __m128 va = _mm_loadu_ps(a);
+    _mm_storeu_ps(out, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(b), va), _mm_loadu_ps(t))));
+#else
+    for (int i = 0; i < 4; ++i)
+        out[i] = a[i] + (b[i] - a[i]) * t[i];
+#endif
+}
+
+// Affine 3x4 matrices, row-major: out = a * b; out may alias a or b
+void multiply34(const float *a, const float *b, float *out) {
+#ifdef LYS_SIMD_SSE2
+    const __m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + 4), b2 = _mm_loadu_ps(b + 8);
+    const __m128 unit_w = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+    __m128 rows[3];
+    for (int r = 0; r < 3; ++r) {
+        const float *row = a + r * 4;
+        rows[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(row[0]), b0), _mm_mul_ps(_mm_set1_ps(row[1]), b1)),
+                             _mm_add_ps(_mm_mul_ps(_mm_set1_ps(row[2]), b2), _mm_mul_ps(_mm_set1_ps(row[3]), unit_w)));
+    }
+    for (int r = 0; r < 3; ++r)
+        _mm_storeu_ps(out + r * 4, rows[r]);
+#else
+    float result[12];
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            result[r * 4 + c] = a[r * 4] * b[c] + a[r * 4 + 1] * b[4 + c] + a[r * 4 + 2] * b[8 + c]
+                              + (c == 3 ? a[r * 4 + 3] : 0.0f);
+        }
+    }
+    std::copy(result, result + 12, out);
+#endif
+}
+
+void poseMatrix(const float q[4], const float t[3], float s, float *out) {
+    float x = q[0], y = q[1], z = q[2], w = q[3];
+    out[0] = (1.0f - 2.0f * (y * y + z * z)) * s;
+    out[1] = 2.0f * (x * y - w * z) * s;
+    out[2] = 2.0f * (x * z + w * y) * s;
+    out[3] = t[0];
+    out[4] = 2.0f * (x * y + w * z) * s;
+    out[5] = (1.0f - 2.0f * (x * x + z * z)) * s;
+    out[6] = 2.0f * (y * z - w * x) * s;
+    out[7] = t[1];
+    out[8] = 2.0f * (x * z - w * y) * s;
+    out[9] = 2.0f * (y * z + w * x) * s;
+    out[10] = (1.0f - 2.0f * (x * x + y * y)) * s;
+    out[11] = t[2];
+}
+
+void invert34(const float *m, float *out) {
+    float c00 = m[5] * m[10] - m[6] * m[9], c01 = m[2] * m[9] - m[1] * m[10], c02 = m[1] * m[6] - m[2] * m[5];
+    float c10 = m[6] * m[8] - m[4] * m[10], c11 = m[0] * m[10] - m[2] * m[8], c12 = m[2] * m[4] - m[0] * m[6];
+    float c20 = m[4] * m[9] - m[5] * m[8], c21 = m[1] * m[8] - m[0] * m[9], c22 = m[0] * m[5] - m[1] * m[4];
+    float det = m[0] * c00 + m[1] * c10 + m[2] * c20;
+    float inv = fabsf(det) > 1e-20f ? 1.0f / det : 0.0f;
+    float r[9] = {c00 * inv, c01 * inv, c02 * inv, c10 * inv, c11 * inv, c12 * inv, c20 * inv, c21 * inv, c22 * inv};
+    for (int row = 0; row < 3; ++row) {
+        out[row * 4] = r[row * 3];
+        out[row * 4 + 1] = r[row * 3 + 1];
+        out[row * 4 + 2] = r[row * 3 + 2];
+        out[row * 4 + 3] = -(r[row * 3] * m[3] + r[row * 3 + 1] * m[7] + r[row * 3 + 2] * m[11]);
+    }
+}
+
+// Angle between two rotations; from the chord rather than acos(dot), which
+// can't resolve small angles in single precision
+float rotationError(const float a[4], const float b[4]) {
+    float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    float flip = dot < 0.0f ? -1.0f : 1.0f, chord = 0.0f;
+    for (int c = 0; c < 4; ++c)
+        chord += (a[c] - b[c] * flip) * (a[c] - b[c] * flip);
+    return 4.0f * asinf(std::min(sqrtf(chord) * 0.5f, 1.0f));
+}
+
+uint16_t quantize(float value, float min, float extent) {
+    if (extent <= 0.0f)
+        return 0;
+    float u = (value - min) / extent * 65535.0f + 0.5f;
+    return static_cast<uint16_t>(std::max(0.0f, std::min(u, 65535.0f)));
+}
+
+float dequantize(uint16_t value, float min, float extent) {
+    return min + value * (extent / 65535.0f);
+}
+
+// Keep the fewest frames such that interpolating between consecutive kept
+// frames stays within tolerance everywhere. fits(from, to) checks every
+// frame in between.
+template <typename Fits>
+void reduceKeys(uint32_t last_frame, Fits fits, Vector<uint16_t> *kept) {
+    kept->push_back(0);
+    if (last_frame == 0 || fits(0, last_frame, true))
+        return;
+    uint32_t start = 0;
+    while (start < last_frame) {
+        uint32_t end = start + 1;
+        while (end < last_frame && fits(start, end + 1, false))
+            ++end;
+        kept->push_back(static_cast<uint16_t>(end));
+        start = end;
+    }
+}
+
+// Find the keys around a frame in a track's sorted key frames
+void bracket(const uint16_t *frames, uint32_t count, float frame, uint32_t *k0, uint32_t *k1, float *alpha) {
+    const uint16_t *end = frames + count;
+    const uint16_t *next = std::upper_bound(frames, end, static_cast<uint16_t>(frame));
+    if (next == frames)
+        next = frames + 1;
+    if (next >= end) {
+        *k0 = *k1 = count - 1;
+        *alpha = 0.0f;
+        return;
+    }
+    *k1 = static_cast<uint32_t>(next - frames);
+    *k0 = *k1 - 1;
+    *alpha = std::min(1.0f, std::max(0.0f, (frame - frames[*k0]) / static_cast<float>(frames[*k1] - frames[*k0])));
+}
+}
+
+
+LYS_API void packQuaternion(const float q[4], uint16_t packed[3]) {
+    uint32_t largest = 0;
+    for (uint32_t i = 1; i < 4; ++i) {
+        if (fabsf(q[i]) > fabsf(q[largest]))
+            largest = i;
+    }
+    // q and -q are the same rotation, so the largest is stored positive
+    float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+    uint16_t values[3];
+    for (uint32_t i = 0, n = 0; i < 4; ++i) {
+        if (i == largest)
+            continue;
+        float v = q[i] * sign / kQuatRange * 0.5f + 0.5f;
+        values[n++] = static_cast<uint16_t>(std::max(0.0f, std::min(v, 1.0f)) * kQuatSteps + 0.5f);
+    }
+    packed[0] = static_cast<uint16_t>(values[0] | ((largest & 1) << 15));
+    packed[1] = static_cast<uint16_t>(values[1] | ((largest >> 1) << 15));
+    packed[2] = values[2];
+}
+
+
+LYS_API void unpackQuaternion(const uint16_t packed[3], float q[4]) {
+    uint32_t largest = (packed[0] >> 15) | ((packed[1] >> 15) << 1);
+    float sum = 0.0f;
+    for (uint32_t i = 0, n = 0; i < 4; ++i) {
+        if (i == largest)
+            continue;
+        float v = ((packed[n++] & 0x7FFF) / kQuatSteps * 2.0f - 1.0f) * kQuatRange;
+        q[i] = v;
+        sum += v * v;
+    }
+    q[largest] = sqrtf(std::max(0.0f, 1.0f - sum));
+}
+
+
+LYS_API void SkeletonPose::resize(uint32_t joint_count) {
+    uint32_t old_count = jointCount_;
+    Vector<float> old_data;
+    old_data.swap(data_);
+    uint32_t old_padded = paddedCount_;
+    jointCount_ = joint_count;
+    paddedCount_ = (joint_count + 3) & ~3u;
+    data_.assign(static_cast<size_t>(paddedCount_) * kStreams, 0.0f);
+    for (uint32_t s = 0; s < kStreams; ++s) {
+        float *out = stream(s);
+        if (s == kRotW || s == kScale)
+            std::fill(out, out + paddedCount_, 1.0f);
+        uint32_t keep = std::min(old_count, joint_count);
+        if (keep > 0)
+            std::copy(&old_data[static_cast<size_t>(s) * old_padded], &old_data[static_cast<size_t>(s) * old_padded] + keep, out);
+    }
+}
+
+
+LYS_API JointPose SkeletonPose::joint(uint32_t joint) const {
+    JointPose pose;
+    for (uint32_t c = 0; c < 4; ++c)
+        pose.rotation[c] = stream(kRotX + c)[joint];
+    for (uint32_t c = 0; c < 3; ++c)
+        pose.translation[c] = stream(kPosX + c)[joint];
+    pose.scale = stream(kScale)[joint];
+    return pose;
+}
+
+
+LYS_API void SkeletonPose::joint(uint32_t joint, const JointPose &pose) {
+    for (uint32_t c = 0; c < 4; ++c)
+        stream(kRotX + c)[joint] = pose.rotation[c];
+    for (uint32_t c = 0; c < 3; ++c)
+        stream(kPosX + c)[joint] = pose.translation[c];
+    stream(kScale)[joint] = pose.scale;
+}
+
+
+LYS_API void SkeletonPose::blend(const SkeletonPose &a, const SkeletonPose &b, float weight, SkeletonPose *out) {
+    uint32_t count = std::min(a.jointCount(), b.jointCount());
+    if (out->jointCount() != count)
+        out->resize(count);
+    const float weights[4] = {weight, weight, weight, weight};
+    for (uint32_t j = 0; j < out->paddedCount(); j += 4) {
+        const float *qa[4] = {a.stream(kRotX) + j, a.stream(kRotY) + j, a.stream(kRotZ) + j, a.stream(kRotW) + j};
+        const float *qb[4] = {b.stream(kRotX) + j, b.stream(kRotY) + j, b.stream(kRotZ) + j, b.stream(kRotW) + j};
+        float *qo[4] = {out->stream(kRotX) + j, out->stream(kRotY) + j, out->stream(kRotZ) + j,
+                        out->stream(kRotW) + j};
+        nlerp4(qa, qb, weights, qo);
+        for (uint32_t s = kPosX; s <= kScale; ++s)
+            lerp4(a.stream(s) + j, b.stream(s) + j, weights, out->stream(s) + j);
+    }
+}
+
+
+LYS_API uint32_t Skeleton::add(int32_t parent, const JointPose &bind_pose) {
+    uint32_t joint = jointCount();
+    if (parent >= static_cast<int32_t>(joint))
+        parent = -1;
+    parents_.push_back(parent);
+    bindPose_.resize(joint + 1);
+    bindPose_.joint(joint, bind_pose);
+
+    // Bind-pose model transforms live in inverseBind_ until inverted; the
+    // parent's has to be recomputed since only its inverse is kept
+    float model[12], parent_model[12], inverse[12];
+    poseMatrix(bind_pose.rotation, bind_pose.translation, bind_pose.scale, model);
+    if (parent >= 0) {
+        invert34(&inverseBind_[static_cast<size_t>(parent) * 12], parent_model);
+        multiply34(parent_model, model, model);
+    }
+    invert34(model, inverse);
+    inverseBind_.insert(inverseBind_.end(), inverse, inverse + 12);
+    return joint;
+}
+
+
+LYS_API void Skeleton::palette(const SkeletonPose &pose, float *palette) const {
+    uint32_t count = std::min(jointCount(), pose.jointCount());
+    const float *rx = pose.stream(kRotX), *ry = pose.stream(kRotY), *rz = pose.stream(kRotZ);
+    const float *rw = pose.stream(kRotW), *px = pose.stream(kPosX), *py = pose.stream(kPosY);
+    const float *pz = pose.stream(kPosZ), *scale = pose.stream(kScale);
+
+    // Model transforms first, parents before children...
+    for (uint32_t j = 0; j < count; ++j) {
+        const float q[4] = {rx[j], ry[j], rz[j], rw[j]};
+        const float t[3] = {px[j], py[j], pz[j]};
+        float *out = palette + static_cast<size_t>(j) * 12;
+        poseMatrix(q, t, scale[j], out);
+        if (parents_[j] >= 0)
+            multiply34(palette + static_cast<size_t>(parents_[j]) * 12, out, out);
+    }
+    // ...then relative to the bind pose
+    for (uint32_t j = 0; j < count; ++j) {
+        float *out = palette + static_cast<size_t>(j) * 12;
+        multiply34(out, &inverseBind_[static_cast<size_t>(j) * 12], out);
+    }
+}
+
+
+LYS_API bool AnimationClip::compress(const RawAnimation &raw, const AnimationTolerance &tolerance) {
+    uint32_t joints = raw.jointCount, frames = raw.frameCount();
+    if (frames == 0 || frames > 65536 || raw.sampleRate <= 0.0f)
+        return false;
+    lastFrame_ = frames - 1;
+    sampleRate_ = raw.sampleRate;
+    duration_ = lastFrame_ / sampleRate_;
+    rotationTracks_.assign(joints, Track());
+    translationTracks_.assign(joints, Track());
+    scaleTracks_.assign(joints, Track());
+    rotationFrames_.clear();
+    rotationKeys_.clear();
+    translationFrames_.clear();
+    translationKeys_.clear();
+    scaleFrames_.clear();
+    scaleKeys_.clear();
+
+    Vector<uint16_t> kept;
+    Vector<uint16_t> packed(static_cast<size_t>(frames) * 3);
+    Vector<float> decoded(static_cast<size_t>(frames) * 4);
+    for (uint32_t j = 0; j < joints; ++j) {
+        auto source = [&](uint32_t frame) -> const JointPose& {
+            return raw.frames[static_cast<size_t>(frame) * joints + j];
+        };
+
+        // Rotations: errors are measured after quantization
+        for (uint32_t f = 0; f < frames; ++f) {
+            packQuaternion(source(f).rotation, &packed[f * 3]);
+            unpackQuaternion(&packed[f * 3], &decoded[f * 4]);
+        }
+        auto rotation_fits = [&](uint32_t from, uint32_t to, bool constant) {
+            for (uint32_t f = from + (constant ? 0 : 1); f < to + (constant ? 1 : 0); ++f) {
+                float t = constant ? 0.0f : static_cast<float>(f - from) / (to - from);
+                float q[4];
+                nlerp(&decoded[from * 4], &decoded[to * 4], t, q);
+                if (rotationError(q, source(f).rotation) > tolerance.rotation)
+                    return false;
+            }
+            return true;
+        };
+        kept.clear();
+        reduceKeys(lastFrame_, rotation_fits, &kept);
+        Track &rotation = rotationTracks_[j];
+        rotation.first = static_cast<uint32_t>(rotationFrames_.size());
+        rotation.count = static_cast<uint32_t>(kept.size());
+        for (uint16_t f : kept) {
+            rotationFrames_.push_back(f);
+            rotationKeys_.insert(rotationKeys_.end(), &packed[f * 3], &packed[f * 3] + 3);
+        }
+
+        // Translations and scales: 16 bits within the track's range
+        Track &translation = translationTracks_[j];
+        Track &scale = scaleTracks_[j];
+        for (int c = 0; c < 3; ++c) {
+            float lo = source(0).translation[c], hi = lo;
+            for (uint32_t f = 1; f < frames; ++f) {
+                lo = std::min(lo, source(f).translation[c]);
+                hi = std::max(hi, source(f).translation[c]);
+            }
+            translation.min[c] = lo;
+            translation.extent[c] = hi - lo;
+            scale.min[c] = 0.0f;
+            scale.extent[c] = 0.0f;
+        }
+        float lo = source(0).scale, hi = lo;
+        for (uint32_t f = 1; f < frames; ++f) {
+            lo = std::min(lo, source(f).scale);
+            hi = std::max(hi, source(f).scale);
+        }
+        scale.min[0] = lo;
+        scale.extent[0] = hi - lo;
+
+        auto translation_at = [&](uint32_t frame, int c) {
+            return dequantize(quantize(source(frame).translation[c], translation.min[c], translation.extent[c]),
+                              translation.min[c], translation.extent[c]);
+        };
+        auto translation_fits = [&](uint32_t from, uint32_t to, bool constant) {
+            for (uint32_t f = from + (constant ? 0 : 1); f < to + (constant ? 1 : 0); ++f) {
+                float t = constant ? 0.0f : static_cast<float>(f - from) / (to - from);
+                float error = 0.0f;
+                for (int c = 0; c < 3; ++c) {
+                    float v = translation_at(from, c) + (translation_at(to, c) - translation_at(from, c)) * t;
+                    error += (v - source(f).translation[c]) * (v - source(f).translation[c]);
+                }
+                if (error > tolerance.translation * tolerance.translation)
+                    return false;
+            }
+            return true;
+        };
+        kept.clear();
+        reduceKeys(lastFrame_, translation_fits, &kept);
+        translation.first = static_cast<uint32_t>(translationFrames_.size());
+        translation.count = static_cast<uint32_t>(kept.size());
+        for (uint16_t f : kept) {
+            translationFrames_.push_back(f);
+            for (int c = 0; c < 3; ++c)
+                translationKeys_.push_back(quantize(source(f).translation[c], translation.min[c], translation.extent[c]));
+        }
+
+        auto scale_at = [&](uint32_t frame) {
+            return dequantize(quantize(source(frame).scale, scale.min[0], scale.extent[0]), scale.min[0],
+                              scale.extent[0]);
+        };
+        auto scale_fits = [&](uint32_t from, uint32_t to, bool constant) {
+            for (uint32_t f = from + (constant ? 0 : 1); f < to + (constant ? 1 : 0); ++f) {
+                float t = constant ? 0.0f : static_cast<float>(f - from) / (to - from);
+                float v = scale_at(from) + (scale_at(to) - scale_at(from)) * t;
+                if (fabsf(v - source(f).scale) > tolerance.scale)
+                    return false;
+            }
+            return true;
+        };
+        kept.clear();
+        reduceKeys(lastFrame_, scale_fits, &kept);
+        scale.first = static_cast<uint32_t>(scaleFrames_.size());
+        scale.count = static_cast<uint32_t>(kept.size());
+        for (uint16_t f : kept) {
+            scaleFrames_.push_back(f);
+            scaleKeys_.push_back(quantize(source(f).scale, scale.min[0], scale.extent[0]));
+        }
+    }
+    return true;
+}
+
+
+LYS_API size_t AnimationClip::memoryUsage() const {
+    return (rotationTracks_.size() + translationTracks_.size() + scaleTracks_.size()) * sizeof(Track)
+         + (rotationFrames_.size() + rotationKeys_.size() + translationFrames_.size() + translationKeys_.size()
+            + scaleFrames_.size() + scaleKeys_.size()) * sizeof(uint16_t);
+}
+
+
+LYS_API void AnimationClip::sample(float time, bool loop, SkeletonPose *pose) const {
+    uint32_t joints = jointCount();
+    if (pose->jointCount() != joints)
+        pose->resize(joints);
+    if (joints == 0)
+        return;
+    if (loop && duration_ > 0.0f) {
+        time = fmodf(time, duration_);
+        if (time < 0.0f)
+            time += duration_;
+    }
+    float frame = std::max(0.0f, std::min(time * sampleRate_, static_cast<float>(lastFrame_)));
+
+    // Decode the keys around the frame four joints at a time, then
+    // interpolate the four together; padding joints stay at the identity
+    for (uint32_t base = 0; base < pose->paddedCount(); base += 4) {
+        float q0[4][4], q1[4][4], p0[4][4], p1[4][4], rotation_t[4], position_t[4];
+        for (int c = 0; c < 4; ++c) {
+            for (int l = 0; l < 4; ++l) {
+                q0[c][l] = q1[c][l] = (c == 3) ? 1.0f : 0.0f;
+                p0[c][l] = p1[c][l] = (c == 3) ? 1.0f : 0.0f;
+            }
+        }
+        float scale_t[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (uint32_t l = 0; l < 4; ++l) {
+            rotation_t[l] = position_t[l] = 0.0f;
+            uint32_t j = base + l;
+            if (j >= joints)
+                continue;
+            uint32_t k0, k1;
+            float q[4];
+            const Track &rotation = rotationTracks_[j];
+            bracket(&rotationFrames_[rotation.first], rotation.count, frame, &k0, &k1, &rotation_t[l]);
+            unpackQuaternion(&rotationKeys_[(rotation.first + k0) * 3], q);
+            for (int c = 0; c < 4; ++c)
+                q0[c][l] = q[c];
+            unpackQuaternion(&rotationKeys_[(rotation.first + k1) * 3], q);
+            for (int c = 0; c < 4; ++c)
+                q1[c][l] = q[c];
+
+            const Track &translation = translationTracks_[j];
+            bracket(&translationFrames_[translation.first], translation.count, frame, &k0, &k1, &position_t[l]);
+            for (int c = 0; c < 3; ++c) {
+                p0[c][l] = dequantize(translationKeys_[(translation.first + k0) * 3 + c], translation.min[c],
+                                      translation.extent[c]);
+                p1[c][l] = dequantize(translationKeys_[(translation.first + k1) * 3 + c], translation.min[c],
+                                      translation.extent[c]);
+            }
+
+            // The scale rides in the fourth position lane
+            const Track &scale = scaleTracks_[j];
+            bracket(&scaleFrames_[scale.first], scale.count, frame, &k0, &k1, &scale_t[l]);
+            p0[3][l] = dequantize(scaleKeys_[scale.first + k0], scale.min[0], scale.extent[0]);
+            p1[3][l] = dequantize(scaleKeys_[scale.first + k1], scale.min[0], scale.extent[0]);
+        }
+
+        const float *a[4] = {q0[0], q0[1], q0[2], q0[3]};
+        const float *b[4] = {q1[0], q1[1], q1[2], q1[3]};
+        float *out[4] = {pose->stream(kRotX) + base, pose->stream(kRotY) + base, pose->stream(kRotZ) + base,
+                         pose->stream(kRotW) + base};
+        nlerp4(a, b, rotation_t, out);
+        for (int c = 0; c < 3; ++c)
+            lerp4(p0[c], p1[c], position_t, pose->stream(kPosX + c) + base);
+        lerp4(p0[3], p1[3], scale_t, pose->stream(kScale) + base);
+    }
+}
+}
@@ -0,0 +1,244 @@
+/***************************************************
+* Animator.cc: Animated characters and skinning    *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Animator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "GLES2/gl2.h"
+#include "config.h"
+#include "types.h"
+#include "Profiler.h"
+
+namespace lys3d {
+namespace {
+// Characters handed out at a time; small enough to balance, large enough
+// that the shared counter stays cold
+const uint32_t kBatchSize = 16;
+
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+float advance(float time, float step, float duration, bool loop) {
+    time += step;
+    if (!loop)
+        return std::max(0.0f, std::min(time, duration));
+    return time;
+}
+
+struct Character {
+    const Skeleton *skeleton;
+    AnimationState state;
+    Vector<float> palette;
+};
+
+// Poses reused by one thread from update to update
+struct Scratch {
+    SkeletonPose pose;
+    SkeletonPose blendPose;
+};
+}
+
+
+struct Animator::Impl {
+    explicit Impl(uint32_t workers) {
+        generation = 0;
+        busy = 0;
+        quit = false;
+        nextBatch = 0;
+        samples = 0;
+        scratch.resize(workers + 1);
+        for (uint32_t i = 0; i < workers; ++i)
+            threads.push_back(std::thread(&Impl::workerMain, this, i + 1));
+    }
+
+    ~Impl() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    void workerMain(uint32_t index) {
+        uint32_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen = generation;
+            lock.unlock();
+            runBatches(index);
+            lock.lock();
+            if (--busy == 0)
+                done.notify_all();
+        }
+    }
+
+    void runBatches(uint32_t index) {
+        Scratch &mine = scratch[index];
+        uint32_t count = static_cast<uint32_t>(characters.size());
+        uint32_t sampled = 0;
+        for (uint32_t first = nextBatch.fetch_add(kBatchSize); first < count;
+             first = nextBatch.fetch_add(kBatchSize)) {
+            uint32_t last = std::min(count, first + kBatchSize);
+            for (uint32_t i = first; i < last; ++i)
+                sampled += pose(characters[i], mine);
+        }
+        samples += sampled;
+    }
+
+    uint32_t pose(Character &character, Scratch &mine) {
+        const AnimationState &state = character.state;
+        const Skeleton &skeleton = *character.skeleton;
+        if (!state.clip) {
+            skeleton.palette(skeleton.bindPose(), character.palette.data());
+            return 0;
+        }
+        state.clip->sample(state.time, state.loop, &mine.pose);
+        if (!state.blendClip || state.blendWeight <= 0.0f) {
+            skeleton.palette(mine.pose, character.palette.data());
+            return 1;
+        }
+        state.blendClip->sample(state.blendTime, state.loop, &mine.blendPose);
+        SkeletonPose::blend(mine.pose, mine.blendPose, std::min(state.blendWeight, 1.0f), &mine.pose);
+        skeleton.palette(mine.pose, character.palette.data());
+        return 2;
+    }
+
+    Vector<Character> characters;
+    AnimatorStats stats;
+
+    // Shared with the worker threads; scratch[0] is the calling thread's
+    Vector<Scratch> scratch;
+    Vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint32_t generation;
+    uint32_t busy;
+    bool quit;
+    std::atomic<uint32_t> nextBatch;
+    std::atomic<uint32_t> samples;
+};
+
+
+LYS_API Animator::Animator(uint32_t workers) {
+    pimpl_ = new Impl(workers);
+}
+
+
+LYS_API Animator::~Animator() {
+    delete pimpl_;
+}
+
+
+LYS_API uint32_t Animator::add(const Skeleton *skeleton) {
+    Character character;
+    character.skeleton = skeleton;
+    character.palette.assign(static_cast<size_t>(skeleton->jointCount()) * 12, 0.0f);
+    pimpl_->characters.push_back(character);
+    return static_cast<uint32_t>(pimpl_->characters.size() - 1);
+}
+
+
+LYS_API void Animator::clear() {
+    pimpl_->characters.clear();
+}
+
+
+LYS_API uint32_t Animator::count() const {
+    return static_cast<uint32_t>(pimpl_->characters.size());
+}
+
+
+LYS_API AnimationState& Animator::state(uint32_t character) {
+    return pimpl_->characters[character].state;
+}
+
+
+LYS_API const AnimationState& Animator::state(uint32_t character) const {
+    return pimpl_->characters[character].state;
+}
+
+
+LYS_API void Animator::update(float seconds) {
+    Impl &impl = *pimpl_;
+    LYS_PROFILE_ZONE("Animation update");
+    int64_t start = now();
+    for (Character &character : impl.characters) {
+        AnimationState &state = character.state;
+        float step = seconds * state.speed;
+        if (state.clip)
+            state.time = advance(state.time, step, state.clip->duration(), state.loop);
+        if (state.blendClip)
+            state.blendTime = advance(state.blendTime, step, state.blendClip->duration(), state.loop);
+    }
+
+    impl.nextBatch = 0;
+    impl.samples = 0;
+    if (!impl.threads.empty()) {
+        std::lock_guard<std::mutex> lock(impl.mutex);
+        impl.busy = static_cast<uint32_t>(impl.threads.size());
+        ++impl.generation;
+    }
+    impl.wake.notify_all();
+    impl.runBatches(0);
+    if (!impl.threads.empty()) {
+        std::unique_lock<std::mutex> lock(impl.mutex);
+        impl.done.wait(lock, [&] { return impl.busy == 0; });
+    }
+
+    impl.stats.characters = static_cast<uint32_t>(impl.characters.size());
+    impl.stats.samples = impl.samples;
+    impl.stats.updateMs = (now() - start) / 1.0e6f;
+}
+
+
+LYS_API const float* Animator::palette(uint32_t character) const {
+    return pimpl_->characters[character].palette.data();
+}
+
+
+LYS_API const AnimatorStats& Animator::stats() const {
+    return pimpl_->stats;
+}
+
+
+LYS_API void Animator::uploadPalette(int32_t location, const float *palette, uint32_t joint_count) {
+    joint_count = std::min(joint_count, kMaxSkinJoints);
+    glUniform4fv(location, static_cast<GLsizei>(joint_count * 3), palette);
+}
+
+
+LYS_API const char* kSkinningGLSL =
+    "#ifndef LYS_SKIN_JOINTS\n"
+    "#define LYS_SKIN_JOINTS 40\n"
+    "#endif\n"
+    "uniform vec4 u_joints[LYS_SKIN_JOINTS * 3];\n"
+    "mat4 lysJointMatrix(float joint) {\n"
+    "    int i = int(joint * 255.0 + 0.5) * 3;\n"
+    "    return mat4(u_joints[i], u_joints[i + 1], u_joints[i + 2], vec4(0.0, 0.0, 0.0, 1.0));\n"
+    "}\n"
+    "mat4 lysSkinMatrix(vec4 joints, vec4 weights) {\n"
+    "    return lysJointMatrix(joints.x) * weights.x + lysJointMatrix(joints.y) * weights.y\n"
+    "         + lysJointMatrix(joints.z) * weights.z + lysJointMatrix(joints.w) * weights.w;\n"
+    "}\n";
+}
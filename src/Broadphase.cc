@@ -0,0 +1,1187 @@
+/***************************************************
+* Broadphase.cc: Collision pair finding            *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Broadphase.h"
+
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "config.h"
+#include "types.h"
+#include "Profiler.h"
+#include "Simd.h"
+
+namespace lys3d {
+namespace {
+const uint32_t kNone = 0xFFFFFFFF;
+const uint32_t kBatchSize = 256;
+
+// Radix sort digits, in bits, and the keys each thread sorts, merges or
+// copies at a time
+const uint32_t kDigitBits = 11;
+const uint32_t kDigitMask = (1 << kDigitBits) - 1;
+const uint32_t kChunk = 1 << 16;
+
+// What update() runs on all threads, and what each phase is split over
+enum Phase {
+    kPhaseStatic,       // Changed static proxies
+    kPhasePrepare,      // Proxies of the hash being built
+    kPhaseWrite,
+    kPhaseHistogram,    // Chunks of the keys being sorted
+    kPhaseScatter,
+    kPhaseBuckets,      // Chunks of the cells of the hash being built
+    kPhaseFilter,       // Words of its filter
+    kPhaseCells,        // Batches of the cells of the dynamic hash
+    kPhaseQuery,        // Dynamic proxies
+    kPhaseStaticQuery,  // Proxies of the static hash
+    kPhaseKeepCount,    // Chunks of the cached static pairs
+    kPhaseKeep,
+    kPhaseGather,       // Threads' scratch
+    kPhaseMerge,        // Parts of two key arrays
+    kPhaseChurn,
+    kPhaseConvert       // Chunks of the pairs
+};
+
+struct Proxy {
+    Box3Df bounds;
+    uint32_t userData;
+    // Index in the sweep-and-prune list, the wide list or the dynamic list
+    uint32_t slot;
+    ProxyMotion motion;
+    bool alive;
+    // Static, and larger than the coarsest hash cells
+    bool wide;
+};
+
+// The finest level a proxy fits in and how many cells it touches there,
+// then where its cells go
+struct Span {
+    uint32_t level;
+    uint32_t first;
+};
+
+// Found by one thread, and where it goes among all threads' pairs
+struct Scratch {
+    Vector<uint64_t> pairs;
+    Vector<uint32_t> hits;
+    size_t offset;
+};
+
+// The pairs that appeared and disappeared in one part of the pair keys
+struct Churn {
+    Vector<BroadphasePair> added;
+    Vector<BroadphasePair> removed;
+};
+
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t pairKey(uint32_t a, uint32_t b) {
+    return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+// Cell coordinates wrap at 2^20, which only makes far cells share entries
+uint64_t cellKey(uint32_t level, int32_t x, int32_t y, int32_t z) {
+    return (static_cast<uint64_t>(level) << 60) | (static_cast<uint64_t>(x & 0xFFFFF) << 40)
+         | (static_cast<uint64_t>(y & 0xFFFFF) << 20) | static_cast<uint64_t>(z & 0xFFFFF);
+}
+
+uint32_t chunksOf(size_t count) {
+    return static_cast<uint32_t>((count + kChunk - 1) / kChunk);
+}
+
+// floorf() is a library call without SSE4.1, and this runs several times
+// per proxy
+int32_t cellOf(float coordinate, float inverse_size) {
+    float scaled = coordinate * inverse_size;
+    int32_t truncated = static_cast<int32_t>(scaled);
+    return truncated - (scaled < truncated ? 1 : 0);
+}
+
+// Proxies entered in the cells they touch of their own level, as records
+// of bucket << 32 | tag | item stably sorted by bucket, so an item's cells
+// sharing a bucket are side by side. Each level has its own buckets, and only the levels
+// other proxies look cells up in get a table of where buckets start.
+struct CellHash {
+    CellHash() : levelMask(0), bucketCount(0), bucketBits(1), tableBase(0), tagMask(0) {}
+
+    // A cell's record without the item: its bucket in the high word, and
+    // the next bits of its hash above the item, so cells sharing a bucket
+    // are mostly told apart without reading bounds
+    uint64_t recordOf(uint64_t key) const {
+        uint32_t level = static_cast<uint32_t>(key >> 60), bits = levelBits[level];
+        uint64_t hashed = key * 0x9E3779B97F4A7C15ull;
+        uint32_t bucket = levelBase[level] + static_cast<uint32_t>(hashed >> (64 - bits));
+        return static_cast<uint64_t>(bucket) << 32 | (static_cast<uint32_t>(hashed >> (32 - bits)) & tagMask);
+    }
+
+    uint32_t itemOf(uint64_t record) const {
+        return static_cast<uint32_t>(record) & ~tagMask;
+    }
+
+    // The bit of a record in the filter: one of its bucket's eight, picked
+    // by the top bits of the tag
+    uint32_t filterBit(uint64_t record) const {
+        return (static_cast<uint32_t>(record >> 32) - tableBase) << 3 | (static_cast<uint32_t>(record) & tagMask) >> 29;
+    }
+
+    // Whether a record repeats one before it, as when two cells of an item
+    // share a bucket and tag. An item's records in a bucket are together.
+    bool repeats(size_t index) const {
+        uint64_t record = cells[index], same = ~static_cast<uint64_t>(tagMask);
+        for (size_t i = index; i-- > 0 && ((cells[i] ^ record) & same) == 0;) {
+            if (cells[i] == record)
+                return true;
+        }
+        return false;
+    }
+
+    // Each item's proxy and bounds, copied so lookups stay in one array
+    Vector<uint32_t> proxies;
+    Vector<Box3Df> bounds;
+    Vector<Span> spans;
+    Vector<uint64_t> cells;
+    // Where each bucket from tableBase on starts in cells, and one past
+    // the last
+    Vector<uint32_t> bucketStart;
+    // Set bits for the cells in the tables. Most lookups from small proxies
+    // into larger levels find nothing, and this is small enough to be in
+    // cache when bucketStart isn't.
+    Vector<uint64_t> filter;
+    uint32_t levelCells[8], levelBase[8], levelBits[8];
+    uint32_t levelMask;
+    uint32_t bucketCount, bucketBits, tableBase;
+    // The bits of a record's low word above the item
+    uint32_t tagMask;
+};
+}
+
+
+struct Broadphase::Impl {
+    explicit Impl(const BroadphaseSettings &new_settings) {
+        settings = new_settings;
+        settings.levels = std::max(1u, std::min(settings.levels, 8u));
+        settings.cellSize = std::max(settings.cellSize, 1e-6f);
+        wideSize = settings.cellSize * (1u << (settings.levels - 1));
+        for (uint32_t level = 0; level < 8; ++level)
+            inverseSize[level] = 1.0f / (settings.cellSize * (1u << level));
+        maxWidth = 0.0f;
+        sweepHoles = 0;
+        staticHashStale = true;
+        building = nullptr;
+        source = nullptr;
+        chunks = 0;
+        radixShift = 0;
+        sorting = nullptr;
+        mergeA = mergeB = nullptr;
+        mergeOut = nullptr;
+        phase = kPhaseStatic;
+        scratch.resize(settings.workers + 1);
+        generation = 0;
+        busy = 0;
+        quit = false;
+        next = 0;
+        pairCounter = Profiler::global().counter("Broadphase pairs", false);
+        for (uint32_t i = 0; i < settings.workers; ++i)
+            threads.push_back(std::thread(&Impl::workerMain, this, i + 1));
+    }
+
+    ~Impl() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    void workerMain(uint32_t index) {
+        uint32_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen = generation;
+            lock.unlock();
+            work(index);
+            lock.lock();
+            if (--busy == 0)
+                done.notify_all();
+        }
+    }
+
+    // Runs the given phase on every thread, returning when it's done
+    void run(Phase new_phase) {
+        phase = new_phase;
+        next = 0;
+        if (!threads.empty()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = static_cast<uint32_t>(threads.size());
+            ++generation;
+        }
+        wake.notify_all();
+        work(0);
+        if (!threads.empty()) {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&] { return busy == 0; });
+        }
+    }
+
+    void work(uint32_t thread) {
+        Scratch &mine = scratch[thread];
+        uint32_t count = chunks, batch = 1;
+        switch (phase) {
+        case kPhaseStatic:
+            count = static_cast<uint32_t>(changedStatic.size());
+            batch = kBatchSize;
+            break;
+        case kPhasePrepare:
+        case kPhaseWrite:
+            count = static_cast<uint32_t>(building->spans.size());
+            batch = kBatchSize;
+            break;
+        case kPhaseFilter:
+            count = static_cast<uint32_t>(building->filter.size());
+            batch = kBatchSize;
+            break;
+        case kPhaseCells:
+            count = static_cast<uint32_t>((dynamicHash.cells.size() + kBatchSize - 1) / kBatchSize);
+            break;
+        case kPhaseQuery:
+            count = static_cast<uint32_t>(dynamics.size());
+            batch = kBatchSize;
+            break;
+        case kPhaseStaticQuery:
+            count = static_cast<uint32_t>(staticHash.spans.size());
+            batch = kBatchSize;
+            break;
+        case kPhaseGather:
+            count = static_cast<uint32_t>(scratch.size());
+            break;
+        default:
+            break;
+        }
+        for (uint32_t first = next.fetch_add(batch); first < count; first = next.fetch_add(batch)) {
+            uint32_t last = std::min(count, first + batch);
+            for (uint32_t i = first; i < last; ++i) {
+                switch (phase) {
+                case kPhaseStatic:
+                    queryStatic(changedStatic[i], mine);
+                    break;
+                case kPhasePrepare:
+                    prepareItem(i);
+                    break;
+                case kPhaseWrite:
+                    writeCells(i);
+                    break;
+                case kPhaseHistogram:
+                    histogram(i);
+                    break;
+                case kPhaseScatter:
+                    scatter(i);
+                    break;
+                case kPhaseBuckets:
+                    findBuckets(i);
+                    break;
+                case kPhaseFilter:
+                    fillFilter(i);
+                    break;
+                case kPhaseCells:
+                    cellPairs(i, mine);
+                    break;
+                case kPhaseQuery:
+                    queryDynamic(i, mine);
+                    break;
+                case kPhaseStaticQuery:
+                    queryHashedStatic(i, mine);
+                    break;
+                case kPhaseKeepCount:
+                    keepStatic(i, false);
+                    break;
+                case kPhaseKeep:
+                    keepStatic(i, true);
+                    break;
+                case kPhaseGather:
+                    gatherPairs(i);
+                    break;
+                case kPhaseMerge:
+                    mergePart(i);
+                    break;
+                case kPhaseChurn:
+                    churnPart(i);
+                    break;
+                case kPhaseConvert:
+                    convertPairs(i);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Collects the static proxies overlapping a box into hits
+    void sweep(const Box3Df &box, Vector<uint32_t> *hits) const {
+        hits->clear();
+        const float *begin_x = minX.data(), *end_x = minX.data() + minX.size();
+        uint32_t begin = static_cast<uint32_t>(std::lower_bound(begin_x, end_x, box.min().x() - maxWidth) - begin_x);
+        uint32_t end = static_cast<uint32_t>(std::upper_bound(begin_x, end_x, box.max().x()) - begin_x);
+        uint32_t i = begin;
+#if defined(LYS_SIMD_SSE2)
+        __m128 q_min_x = _mm_set1_ps(box.min().x());
+        __m128 q_min_y = _mm_set1_ps(box.min().y()), q_max_y = _mm_set1_ps(box.max().y());
+        __m128 q_min_z = _mm_set1_ps(box.min().z()), q_max_z = _mm_set1_ps(box.max().z());
+        for (; i + 4 <= end; i += 4) {
+            __m128 hit = _mm_cmpge_ps(_mm_loadu_ps(&maxX[i]), q_min_x);
+            hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_loadu_ps(&minY[i]), q_max_y));
+            hit = _mm_and_ps(hit, _mm_cmpge_ps(_mm_loadu_ps(&maxY[i]), q_min_y));
+            hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_loadu_ps(&minZ[i]), q_max_z));
+            hit = _mm_and_ps(hit, _mm_cmpge_ps(_mm_loadu_ps(&maxZ[i]), q_min_z));
+            int mask = _mm_movemask_ps(hit);
+            while (mask) {
+                int lane = __builtin_ctz(mask);
+                hits->push_back(sweepProxy[i + lane]);
+                mask &= mask - 1;
+            }
+        }
+#endif
+        for (; i < end; ++i) {
+            if (maxX[i] >= box.min().x() && minY[i] <= box.max().y() && maxY[i] >= box.min().y()
+                    && minZ[i] <= box.max().z() && maxZ[i] >= box.min().z())
+                hits->push_back(sweepProxy[i]);
+        }
+    }
+
+    // Pairs of a static proxy that was added or moved with other static
+    // proxies; pairs of two changed proxies are found by the lower id
+    void queryStatic(uint32_t proxy, Scratch &mine) {
+        if (!proxies[proxy].alive || proxies[proxy].motion != ProxyMotion::kStatic)
+            return;
+        const Box3Df &box = proxies[proxy].bounds;
+        sweep(box, &mine.hits);
+        for (uint32_t other : mine.hits) {
+            if (other != proxy && (!changed[other] || proxy < other))
+                mine.pairs.push_back(pairKey(proxy, other));
+        }
+        for (uint32_t other : wide) {
+            if (other != proxy && (!changed[other] || proxy < other) && box.intersects(proxies[other].bounds))
+                mine.pairs.push_back(pairKey(proxy, other));
+        }
+    }
+
+    // The finest level whose cells are at least as large as a box
+    uint32_t levelOf(const Box3Df &box) const {
+        Point3Df size = box.max() - box.min();
+        float largest = std::max(size.x(), std::max(size.y(), size.z()));
+        uint32_t level = 0;
+        while (level + 1 < settings.levels && settings.cellSize * (1u << level) < largest)
+            ++level;
+        return level;
+    }
+
+    bool isWide(const Box3Df &box) const {
+        Point3Df size = box.max() - box.min();
+        return std::max(size.x(), std::max(size.y(), size.z())) > wideSize;
+    }
+
+    // The first and last cells a box touches in a level
+    void cellRange(const Box3Df &box, uint32_t level, int32_t lo[3], int32_t hi[3]) const {
+        float inverse = inverseSize[level];
+        lo[0] = cellOf(box.min().x(), inverse);
+        lo[1] = cellOf(box.min().y(), inverse);
+        lo[2] = cellOf(box.min().z(), inverse);
+        hi[0] = cellOf(box.max().x(), inverse);
+        hi[1] = cellOf(box.max().y(), inverse);
+        hi[2] = cellOf(box.max().z(), inverse);
+    }
+
+    // Calls visit(key) for the cells a box touches in a level
+    template <typename Visit>
+    void forEachCell(const Box3Df &box, uint32_t level, Visit visit) const {
+        int32_t lo[3], hi[3];
+        cellRange(box, level, lo, hi);
+        for (int32_t x = lo[0]; x <= hi[0]; ++x) {
+            for (int32_t y = lo[1]; y <= hi[1]; ++y) {
+                for (int32_t z = lo[2]; z <= hi[2]; ++z)
+                    visit(cellKey(level, x, y, z));
+            }
+        }
+    }
+
+    // The cell of a level the low corner of two boxes' overlap is in. Pairs
+    // touching several cells together are only taken in that one.
+    uint64_t overlapCell(const Box3Df &a, const Box3Df &b, uint32_t level) const {
+        float inverse = inverseSize[level];
+        return cellKey(level, cellOf(std::max(a.min().x(), b.min().x()), inverse),
+                       cellOf(std::max(a.min().y(), b.min().y()), inverse),
+                       cellOf(std::max(a.min().z(), b.min().z()), inverse));
+    }
+
+    void prepareItem(uint32_t item) {
+        CellHash &hash = *building;
+        uint32_t proxy = (*source)[item];
+        const Box3Df &box = proxies[proxy].bounds;
+        uint32_t level = levelOf(box);
+        int32_t lo[3], hi[3];
+        cellRange(box, level, lo, hi);
+        hash.proxies[item] = proxy;
+        hash.bounds[item] = box;
+        hash.spans[item].level = level;
+        hash.spans[item].first = static_cast<uint32_t>((hi[0] - lo[0] + 1) * (hi[1] - lo[1] + 1) * (hi[2] - lo[2] + 1));
+    }
+
+    void writeCells(uint32_t item) {
+        CellHash &hash = *building;
+        uint64_t *out = hash.cells.data() + hash.spans[item].first;
+        forEachCell(hash.bounds[item], hash.spans[item].level, [&](uint64_t key) {
+            *out++ = hash.recordOf(key) | item;
+        });
+    }
+
+    // One chunk's share of a radix sort pass over the keys being sorted
+    void histogram(uint32_t chunk) {
+        const Vector<uint64_t> &keys = *sorting;
+        uint32_t *counts = &histograms[chunk << kDigitBits];
+        std::fill(counts, counts + (1 << kDigitBits), 0u);
+        size_t end = std::min(keys.size(), static_cast<size_t>(chunk + 1) * kChunk);
+        for (size_t i = static_cast<size_t>(chunk) * kChunk; i < end; ++i)
+            ++counts[(keys[i] >> radixShift) & kDigitMask];
+    }
+
+    void scatter(uint32_t chunk) {
+        const Vector<uint64_t> &keys = *sorting;
+        uint32_t *offsets = &histograms[chunk << kDigitBits];
+        size_t end = std::min(keys.size(), static_cast<size_t>(chunk + 1) * kChunk);
+        for (size_t i = static_cast<size_t>(chunk) * kChunk; i < end; ++i)
+            temp[offsets[(keys[i] >> radixShift) & kDigitMask]++] = keys[i];
+    }
+
+    // Radix sorts keys by their bits from first to last, least significant
+    // digit first, in chunks on all threads
+    void sortKeys(Vector<uint64_t> *keys, uint32_t first, uint32_t last) {
+        sorting = keys;
+        chunks = chunksOf(keys->size());
+        histograms.resize(static_cast<size_t>(chunks) << kDigitBits);
+        temp.resize(keys->size());
+        for (radixShift = first; radixShift < last; radixShift += kDigitBits) {
+            run(kPhaseHistogram);
+            uint32_t sum = 0;
+            for (uint32_t digit = 0; digit <= kDigitMask; ++digit) {
+                for (uint32_t chunk = 0; chunk < chunks; ++chunk) {
+                    uint32_t &count = histograms[(chunk << kDigitBits) + digit];
+                    uint32_t start = sum;
+                    sum += count;
+                    count = start;
+                }
+            }
+            run(kPhaseScatter);
+            keys->swap(temp);
+        }
+    }
+
+    // Sorts pair keys whose ids fit in id_bits: b's digits, then a's
+    void sortPairs(Vector<uint64_t> *keys, uint32_t id_bits) {
+        sortKeys(keys, 0, id_bits);
+        sortKeys(keys, 32, 32 + id_bits);
+    }
+
+    // Where each bucket of the tables starts in the cells. Each start is
+    // written by the cell it starts at, or the last one for those after.
+    void findBuckets(uint32_t chunk) {
+        CellHash &hash = *building;
+        const Vector<uint64_t> &cells = hash.cells;
+        uint32_t total = static_cast<uint32_t>(cells.size()), base = hash.tableBase;
+        uint32_t end = std::min(total, (chunk + 1) * kChunk);
+        for (uint32_t i = chunk * kChunk; i < end; ++i) {
+            uint32_t bucket = static_cast<uint32_t>(cells[i] >> 32);
+            uint32_t first = i == 0 ? 0 : static_cast<uint32_t>(cells[i - 1] >> 32) + 1;
+            for (uint32_t b = std::max(first, base); b <= bucket; ++b)
+                hash.bucketStart[b - base] = i;
+        }
+        if (end == total) {
+            uint32_t first = static_cast<uint32_t>(cells[total - 1] >> 32) + 1;
+            for (uint32_t b = std::max(first, base); b <= hash.bucketCount; ++b)
+                hash.bucketStart[b - base] = total;
+        }
+    }
+
+    // A word of the filter, from the cells of its eight buckets
+    void fillFilter(uint32_t word) {
+        CellHash &hash = *building;
+        uint32_t tabled = hash.bucketCount - hash.tableBase;
+        uint32_t begin = hash.bucketStart[word << 3];
+        uint32_t end = hash.bucketStart[std::min(tabled, (word + 1) << 3)];
+        uint64_t bits = 0;
+        for (uint32_t i = begin; i < end; ++i)
+            bits |= 1ull << (hash.filterBit(hash.cells[i]) & 63);
+        hash.filter[word] = bits;
+    }
+
+    // Pairs of dynamic proxies of the same level sharing a bucket and tag
+    // in a batch of cells, each taken in the cell its overlap starts in.
+    // Most cells are alone in their bucket, so this walks a batch in one
+    // loop rather than a call each.
+    void cellPairs(uint32_t batch, Scratch &mine) {
+        const CellHash &hash = dynamicHash;
+        const Vector<uint64_t> &cells = hash.cells;
+        size_t total = cells.size(), end = std::min(total, static_cast<size_t>(batch + 1) * kBatchSize);
+        for (size_t index = static_cast<size_t>(batch) * kBatchSize; index < end; ++index) {
+            uint64_t cell = cells[index];
+            if (index + 1 == total || (cells[index + 1] >> 32) != (cell >> 32) || hash.repeats(index))
+                continue;
+            uint32_t item = hash.itemOf(cell);
+            uint64_t record = cell ^ item;
+            for (size_t i = index + 1; i < total && (cells[i] >> 32) == (cell >> 32); ++i) {
+                if (((cells[i] ^ cell) & hash.tagMask) != 0 || hash.repeats(i))
+                    continue;
+                uint32_t other = hash.itemOf(cells[i]);
+                const Box3Df &box = hash.bounds[item], &other_box = hash.bounds[other];
+                if (box.intersects(other_box)
+                        && hash.recordOf(overlapCell(box, other_box, hash.spans[item].level)) == record)
+                    mine.pairs.push_back(pairKey(hash.proxies[item], hash.proxies[other]));
+            }
+        }
+    }
+
+    // Pairs of a box with the proxies of a hash in the cells it touches of
+    // one of the hash's levels
+    void queryLevel(const CellHash &hash, uint32_t level, const Box3Df &box, uint32_t proxy,
+                    Scratch &mine) const {
+        forEachCell(box, level, [&](uint64_t key) {
+            uint64_t record = hash.recordOf(key);
+            uint32_t bit = hash.filterBit(record);
+            if ((hash.filter[bit >> 6] & (1ull << (bit & 63))) == 0)
+                return;
+            uint32_t bucket = static_cast<uint32_t>(record >> 32) - hash.tableBase;
+            uint32_t begin = hash.bucketStart[bucket], end = hash.bucketStart[bucket + 1];
+            for (uint32_t i = begin; i < end; ++i) {
+                if (((hash.cells[i] ^ record) & hash.tagMask) != 0 || hash.repeats(i))
+                    continue;
+                uint32_t other = hash.itemOf(hash.cells[i]);
+                const Box3Df &other_box = hash.bounds[other];
+                if (box.intersects(other_box) && overlapCell(box, other_box, level) == key)
+                    mine.pairs.push_back(pairKey(proxy, hash.proxies[other]));
+            }
+        });
+    }
+
+    // Pairs of a dynamic proxy with larger dynamic proxies, with static
+    // proxies at least as large, and with wide ones. Smaller static proxies
+    // find it themselves.
+    void queryDynamic(uint32_t slot, Scratch &mine) {
+        const CellHash &hash = dynamicHash;
+        uint32_t proxy = hash.proxies[slot], level = hash.spans[slot].level;
+        const Box3Df &box = hash.bounds[slot];
+        for (uint32_t other_level = level; other_level < settings.levels; ++other_level) {
+            if (other_level > level && (hash.levelMask & (1u << other_level)))
+                queryLevel(hash, other_level, box, proxy, mine);
+            if (staticHash.levelMask & (1u << other_level))
+                queryLevel(staticHash, other_level, box, proxy, mine);
+        }
+        for (uint32_t other : wide) {
+            if (box.intersects(proxies[other].bounds))
+                mine.pairs.push_back(pairKey(proxy, other));
+        }
+    }
+
+    // Pairs of a static proxy in the hash with larger dynamic proxies
+    void queryHashedStatic(uint32_t item, Scratch &mine) {
+        uint32_t level = staticHash.spans[item].level;
+        for (uint32_t other_level = level + 1; other_level < settings.levels; ++other_level) {
+            if (dynamicHash.levelMask & (1u << other_level))
+                queryLevel(dynamicHash, other_level, staticHash.bounds[item], staticHash.proxies[item], mine);
+        }
+    }
+
+    // Counts, or copies to temp, the cached static pairs of a chunk whose
+    // proxies are both unchanged
+    void keepStatic(uint32_t chunk, bool copy) {
+        size_t end = std::min(staticPairs.size(), static_cast<size_t>(chunk + 1) * kChunk);
+        uint32_t kept = 0;
+        uint32_t out = keptCounts[chunk];
+        for (size_t i = static_cast<size_t>(chunk) * kChunk; i < end; ++i) {
+            uint64_t key = staticPairs[i];
+            if (changed[key >> 32] || changed[key & 0xFFFFFFFF])
+                continue;
+            if (copy)
+                temp[out + kept] = key;
+            ++kept;
+        }
+        if (!copy)
+            keptCounts[chunk] = kept;
+    }
+
+    // Collects every thread's pairs into fresh
+    void gather() {
+        size_t total = 0;
+        for (Scratch &s : scratch) {
+            s.offset = total;
+            total += s.pairs.size();
+        }
+        fresh.resize(total);
+        run(kPhaseGather);
+    }
+
+    void gatherPairs(uint32_t thread) {
+        Scratch &from = scratch[thread];
+        std::copy(from.pairs.begin(), from.pairs.end(), fresh.begin() + from.offset);
+        from.pairs.clear();
+    }
+
+    // Cuts two sorted arrays of distinct keys into about kChunk keys' worth
+    // of parts, at the same key in both
+    void split(const Vector<uint64_t> &a, const Vector<uint64_t> &b) {
+        bool a_longer = a.size() >= b.size();
+        const Vector<uint64_t> &longer = a_longer ? a : b, &shorter = a_longer ? b : a;
+        chunks = std::max(1u, chunksOf(a.size() + b.size()));
+        splitA.resize(chunks + 1);
+        splitB.resize(chunks + 1);
+        for (uint32_t k = 0; k <= chunks; ++k) {
+            size_t at = longer.size() * k / chunks, other = k == 0 ? 0 : shorter.size();
+            if (k > 0 && at < longer.size())
+                other = std::lower_bound(shorter.begin(), shorter.end(), longer[at]) - shorter.begin();
+            splitA[k] = a_longer ? at : other;
+            splitB[k] = a_longer ? other : at;
+        }
+    }
+
+    // Merges two sorted arrays of distinct keys into out
+    void mergeKeys(const Vector<uint64_t> &a, const Vector<uint64_t> &b, Vector<uint64_t> *out) {
+        out->resize(a.size() + b.size());
+        mergeA = &a;
+        mergeB = &b;
+        mergeOut = out;
+        split(a, b);
+        run(kPhaseMerge);
+    }
+
+    void mergePart(uint32_t part) {
+        const uint64_t *a = mergeA->data(), *b = mergeB->data();
+        std::merge(a + splitA[part], a + splitA[part + 1], b + splitB[part], b + splitB[part + 1],
+                   mergeOut->begin() + static_cast<ptrdiff_t>(splitA[part] + splitB[part]));
+    }
+
+    // The pairs in the current keys (mergeB) and not the last update's
+    // (mergeA), and the other way around, for one part
+    void churnPart(uint32_t part) {
+        const Vector<uint64_t> &last = *mergeA, &current = *mergeB;
+        Churn &out = churn[part];
+        out.added.clear();
+        out.removed.clear();
+        size_t i = splitA[part], j = splitB[part];
+        size_t i_end = splitA[part + 1], j_end = splitB[part + 1];
+        while (i < i_end || j < j_end) {
+            if (j == j_end || (i < i_end && last[i] < current[j])) {
+                out.removed.push_back(BroadphasePair {static_cast<uint32_t>(last[i] >> 32),
+                                                      static_cast<uint32_t>(last[i])});
+                ++i;
+            } else if (i == i_end || current[j] < last[i]) {
+                out.added.push_back(BroadphasePair {static_cast<uint32_t>(current[j] >> 32),
+                                                    static_cast<uint32_t>(current[j])});
+                ++j;
+            } else {
+                ++i;
+                ++j;
+            }
+        }
+    }
+
+    void convertPairs(uint32_t chunk) {
+        size_t end = std::min(keys.size(), static_cast<size_t>(chunk + 1) * kChunk);
+        for (size_t k = static_cast<size_t>(chunk) * kChunk; k < end; ++k)
+            pairs[k] = BroadphasePair {static_cast<uint32_t>(keys[k] >> 32), static_cast<uint32_t>(keys[k])};
+    }
+
+    // Brings the sweep-and-prune list up to date with the static changes
+    void sortSweep() {
+        if (sweepHoles > 0) {
+            uint32_t kept = 0;
+            for (uint32_t i = 0; i < sweepProxy.size(); ++i) {
+                if (sweepProxy[i] == kNone)
+                    continue;
+                minX[kept] = minX[i];
+                maxX[kept] = maxX[i];
+                minY[kept] = minY[i];
+                maxY[kept] = maxY[i];
+                minZ[kept] = minZ[i];
+                maxZ[kept] = maxZ[i];
+                sweepProxy[kept] = sweepProxy[i];
+                ++kept;
+            }
+            Vector<float> *arrays[] = {&minX, &maxX, &minY, &maxY, &minZ, &maxZ};
+            for (Vector<float> *array : arrays)
+                array->resize(kept);
+            sweepProxy.resize(kept);
+            sweepHoles = 0;
+        }
+
+        uint32_t count = static_cast<uint32_t>(sweepProxy.size());
+        if (changedStatic.size() > 32 + count / 32) {
+            // Too much moved for an insertion sort
+            Vector<std::pair<float, uint32_t>> order(count);
+            for (uint32_t i = 0; i < count; ++i)
+                order[i] = std::make_pair(minX[i], sweepProxy[i]);
+            std::sort(order.begin(), order.end());
+            maxWidth = 0.0f;
+            for (uint32_t i = 0; i < count; ++i) {
+                const Box3Df &box = proxies[order[i].second].bounds;
+                minX[i] = box.min().x();
+                maxX[i] = box.max().x();
+                minY[i] = box.min().y();
+                maxY[i] = box.max().y();
+                minZ[i] = box.min().z();
+                maxZ[i] = box.max().z();
+                sweepProxy[i] = order[i].second;
+                maxWidth = std::max(maxWidth, maxX[i] - minX[i]);
+            }
+        } else {
+            for (uint32_t i = 1; i < count; ++i) {
+                float key = minX[i];
+                if (minX[i - 1] <= key)
+                    continue;
+                float max_x = maxX[i], min_y = minY[i], max_y = maxY[i], min_z = minZ[i], max_z = maxZ[i];
+                uint32_t proxy = sweepProxy[i], j = i;
+                for (; j > 0 && minX[j - 1] > key; --j) {
+                    minX[j] = minX[j - 1];
+                    maxX[j] = maxX[j - 1];
+                    minY[j] = minY[j - 1];
+                    maxY[j] = maxY[j - 1];
+                    minZ[j] = minZ[j - 1];
+                    maxZ[j] = maxZ[j - 1];
+                    sweepProxy[j] = sweepProxy[j - 1];
+                }
+                minX[j] = key;
+                maxX[j] = max_x;
+                minY[j] = min_y;
+                maxY[j] = max_y;
+                minZ[j] = min_z;
+                maxZ[j] = max_z;
+                sweepProxy[j] = proxy;
+            }
+        }
+        for (uint32_t i = 0; i < count; ++i)
+            proxies[sweepProxy[i]].slot = i;
+    }
+
+    uint32_t lowestLevel(uint32_t mask) const {
+        uint32_t level = 0;
+        while (level < settings.levels && !(mask & (1u << level)))
+            ++level;
+        return level;
+    }
+
+    // Finds the level and cell count of each of the given proxies, and
+    // where its cells go
+    void prepareHash(CellHash *hash, const Vector<uint32_t> &ids) {
+        building = hash;
+        source = &ids;
+        hash->proxies.resize(ids.size());
+        hash->bounds.resize(ids.size());
+        hash->spans.resize(ids.size());
+        uint32_t item_bits = 1;
+        while (item_bits < 32 && (1ull << item_bits) < ids.size())
+            ++item_bits;
+        hash->tagMask = item_bits < 32 ? ~0u << item_bits : 0;
+        run(kPhasePrepare);
+        uint32_t total = 0;
+        std::fill(hash->levelCells, hash->levelCells + 8, 0u);
+        hash->levelMask = 0;
+        for (Span &span : hash->spans) {
+            uint32_t cells = span.first;
+            span.first = total;
+            total += cells;
+            hash->levelCells[span.level] += cells;
+            hash->levelMask |= 1u << span.level;
+        }
+        hash->cells.resize(total);
+    }
+
+    // Enters the proxies in their cells, sorts them and makes the tables of
+    // the levels from first_queried on
+    void fillHash(CellHash *hash, uint32_t first_queried) {
+        building = hash;
+        hash->bucketCount = 0;
+        hash->tableBase = kNone;
+        for (uint32_t level = 0; level < settings.levels; ++level) {
+            // Levels without a table only cost sort bits, so they get more
+            // buckets and fewer cells share one in cellPairs()
+            uint64_t wanted = hash->levelCells[level] * (level < first_queried ? 4ull : 1ull);
+            uint32_t &bits = hash->levelBits[level];
+            bits = 1;
+            while ((1ull << bits) < wanted && bits < 30)
+                ++bits;
+            hash->levelBase[level] = hash->bucketCount;
+            if (level >= first_queried && hash->tableBase == kNone)
+                hash->tableBase = hash->bucketCount;
+            if (hash->levelMask & (1u << level))
+                hash->bucketCount += 1u << bits;
+        }
+        if (hash->tableBase == kNone)
+            hash->tableBase = hash->bucketCount;
+        hash->bucketBits = 1;
+        while ((1ull << hash->bucketBits) < hash->bucketCount)
+            ++hash->bucketBits;
+        run(kPhaseWrite);
+        sortKeys(&hash->cells, 32, 32 + hash->bucketBits);
+        hash->bucketStart.resize(hash->bucketCount - hash->tableBase + 1);
+        chunks = chunksOf(hash->cells.size());
+        run(kPhaseBuckets);
+        hash->filter.resize((hash->bucketCount - hash->tableBase + 7) >> 3);
+        run(kPhaseFilter);
+    }
+
+    void update() {
+        LYS_PROFILE_ZONE("Broadphase update");
+        int64_t start = now();
+        uint32_t id_bits = 1;
+        while (id_bits < 32 && (1ull << id_bits) < proxies.size())
+            ++id_bits;
+        for (Scratch &s : scratch)
+            s.pairs.clear();
+
+        stats = BroadphaseStats();
+        stats.staticChanged = static_cast<uint32_t>(changedStatic.size());
+        if (!changedStatic.empty() || sweepHoles > 0) {
+            // Drop the cached pairs of changed proxies and find them again
+            chunks = chunksOf(staticPairs.size());
+            keptCounts.resize(chunks);
+            run(kPhaseKeepCount);
+            uint32_t kept = 0;
+            for (uint32_t &count : keptCounts) {
+                uint32_t start = kept;
+                kept += count;
+                count = start;
+            }
+            temp.resize(kept);
+            run(kPhaseKeep);
+            staticPairs.swap(temp);
+            sortSweep();
+            run(kPhaseStatic);
+            gather();
+            if (!fresh.empty()) {
+                sortPairs(&fresh, id_bits);
+                mergeKeys(staticPairs, fresh, &merged);
+                staticPairs.swap(merged);
+            }
+            for (uint32_t proxy : changedStatic)
+                changed[proxy] = 0;
+            changedStatic.clear();
+            staticHashStale = true;
+        }
+
+        // Dynamic pairs, found from scratch. The static hash is only redone
+        // when static proxies changed; a level is only looked up by smaller
+        // proxies, so the finest level used gets no table.
+        Vector<uint64_t> *current = &staticPairs;
+        if (!dynamics.empty()) {
+            if (staticHashStale) {
+                prepareHash(&staticHash, sweepProxy);
+                fillHash(&staticHash, 0);
+                staticHashStale = false;
+            }
+            prepareHash(&dynamicHash, dynamics);
+            uint32_t lowest = std::min(lowestLevel(dynamicHash.levelMask), lowestLevel(staticHash.levelMask));
+            fillHash(&dynamicHash, lowest + 1);
+            run(kPhaseCells);
+            run(kPhaseQuery);
+            // Static proxies finer than the coarsest dynamic ones look those up
+            uint32_t coarsest = settings.levels - 1;
+            while (!(dynamicHash.levelMask & (1u << coarsest)))
+                --coarsest;
+            if (staticHash.levelMask & ((1u << coarsest) - 1))
+                run(kPhaseStaticQuery);
+            gather();
+            sortPairs(&fresh, id_bits);
+            mergeKeys(staticPairs, fresh, &merged);
+            current = &merged;
+        }
+
+        // Churn against the last update
+        mergeA = &keys;
+        mergeB = current;
+        split(keys, *current);
+        churn.resize(chunks);
+        run(kPhaseChurn);
+        addedPairs.clear();
+        removedPairs.clear();
+        for (const Churn &part : churn) {
+            addedPairs.insert(addedPairs.end(), part.added.begin(), part.added.end());
+            removedPairs.insert(removedPairs.end(), part.removed.begin(), part.removed.end());
+        }
+        if (current == &merged)
+            keys.swap(merged);
+        else
+            keys.assign(current->begin(), current->end());
+        pairs.resize(keys.size());
+        chunks = chunksOf(keys.size());
+        run(kPhaseConvert);
+
+        // Ids of removed proxies are only reused once their pairs are gone
+        freeIds.insert(freeIds.end(), removedIds.begin(), removedIds.end());
+        removedIds.clear();
+
+        stats.staticProxies = static_cast<uint32_t>(sweepProxy.size() + wide.size());
+        stats.dynamicProxies = static_cast<uint32_t>(dynamics.size());
+        stats.hashEntries = static_cast<uint32_t>(dynamics.empty() ? 0 : dynamicHash.cells.size());
+        stats.pairs = static_cast<uint32_t>(pairs.size());
+        stats.added = static_cast<uint32_t>(addedPairs.size());
+        stats.removed = static_cast<uint32_t>(removedPairs.size());
+        stats.updateMs = (now() - start) / 1.0e6f;
+        Profiler::global().set(pairCounter, stats.pairs);
+    }
+
+    // Flags a static proxy so its cached pairs are found again
+    void changeStatic(uint32_t proxy) {
+        if (!changed[proxy]) {
+            changed[proxy] = 1;
+            changedStatic.push_back(proxy);
+        }
+    }
+
+    // Puts a static proxy in the wide list, or appends it unsorted to the
+    // sweep-and-prune list for update() to move into place
+    void listStatic(uint32_t id) {
+        Proxy &proxy = proxies[id];
+        if (proxy.wide) {
+            proxy.slot = static_cast<uint32_t>(wide.size());
+            wide.push_back(id);
+            return;
+        }
+        proxy.slot = static_cast<uint32_t>(sweepProxy.size());
+        Vector<float> *arrays[] = {&minX, &maxX, &minY, &maxY, &minZ, &maxZ};
+        for (Vector<float> *array : arrays)
+            array->push_back(0.0f);
+        sweepProxy.push_back(id);
+        writeSweep(proxy.slot, proxy.bounds);
+    }
+
+    void unlistStatic(uint32_t id) {
+        Proxy &proxy = proxies[id];
+        if (proxy.wide) {
+            uint32_t last = wide.back();
+            wide[proxy.slot] = last;
+            proxies[last].slot = proxy.slot;
+            wide.pop_back();
+        } else {
+            sweepProxy[proxy.slot] = kNone;
+            ++sweepHoles;
+        }
+    }
+
+    void writeSweep(uint32_t slot, const Box3Df &box) {
+        minX[slot] = box.min().x();
+        maxX[slot] = box.max().x();
+        minY[slot] = box.min().y();
+        maxY[slot] = box.max().y();
+        minZ[slot] = box.min().z();
+        maxZ[slot] = box.max().z();
+        maxWidth = std::max(maxWidth, maxX[slot] - minX[slot]);
+    }
+
+    BroadphaseSettings settings;
+    Vector<Proxy> proxies;
+    Vector<uint32_t> freeIds;
+    Vector<uint32_t> removedIds;
+    BroadphaseStats stats;
+    uint32_t pairCounter;
+
+    // Sweep-and-prune list of static proxies, sorted by minX. Static
+    // proxies larger than the coarsest hash cells are kept in a list of
+    // their own, so that the widest one bounds how far a sweep looks back.
+    Vector<float> minX, maxX, minY, maxY, minZ, maxZ;
+    Vector<uint32_t> sweepProxy;
+    float maxWidth;
+    uint32_t sweepHoles;
+    Vector<uint32_t> wide;
+    float wideSize;
+    Vector<uint8_t> changed;
+    Vector<uint32_t> changedStatic;
+    Vector<uint64_t> staticPairs;
+
+    // Spatial hashes of dynamic proxies, rebuilt every update, and of the
+    // static proxies in the sweep-and-prune list, for the dynamic ones to
+    // look up, rebuilt when those change
+    Vector<uint32_t> dynamics;
+    CellHash dynamicHash;
+    CellHash staticHash;
+    bool staticHashStale;
+    float inverseSize[8];
+    // The hash being built, and the proxies going in it
+    CellHash *building;
+    const Vector<uint32_t> *source;
+
+    // Keys being radix sorted, and the per-chunk digit counts of the pass
+    // under way
+    Vector<uint64_t> *sorting;
+    Vector<uint32_t> histograms;
+    uint32_t radixShift;
+    // Chunks or parts the phase under way is split into
+    uint32_t chunks;
+    // Arrays being merged or compared, and where their parts start
+    const Vector<uint64_t> *mergeA, *mergeB;
+    Vector<uint64_t> *mergeOut;
+    Vector<size_t> splitA, splitB;
+    Vector<Churn> churn;
+    // Cached static pairs kept by each chunk, then where they go
+    Vector<uint32_t> keptCounts;
+
+    // Pairs as a << 32 | b
+    Vector<uint64_t> keys;
+    Vector<uint64_t> fresh;
+    Vector<uint64_t> merged;
+    Vector<uint64_t> temp;
+    Vector<BroadphasePair> pairs;
+    Vector<BroadphasePair> addedPairs;
+    Vector<BroadphasePair> removedPairs;
+
+    // Shared with the worker threads
+    Phase phase;
+    Vector<Scratch> scratch;
+    Vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint32_t generation;
+    uint32_t busy;
+    bool quit;
+    std::atomic<uint32_t> next;
+};
+
+
+LYS_API Broadphase::Broadphase(const BroadphaseSettings &settings) {
+    pimpl_ = new Impl(settings);
+}
+
+
+LYS_API Broadphase::~Broadphase() {
+    delete pimpl_;
+}
+
+
+LYS_API const BroadphaseSettings& Broadphase::settings() const {
+    return pimpl_->settings;
+}
+
+
+LYS_API uint32_t Broadphase::add(const Box3Df &bounds, ProxyMotion motion, uint32_t user_data) {
+    Impl &impl = *pimpl_;
+    uint32_t id;
+    if (impl.freeIds.empty()) {
+        id = static_cast<uint32_t>(impl.proxies.size());
+        impl.proxies.push_back(Proxy());
+        impl.changed.push_back(0);
+    } else {
+        id = impl.freeIds.back();
+        impl.freeIds.pop_back();
+    }
+
+    Proxy &proxy = impl.proxies[id];
+    proxy.bounds = bounds;
+    proxy.userData = user_data;
+    proxy.motion = motion;
+    proxy.alive = true;
+    proxy.wide = false;
+    if (motion == ProxyMotion::kStatic) {
+        proxy.wide = impl.isWide(bounds);
+        impl.listStatic(id);
+        impl.changeStatic(id);
+    } else {
+        proxy.slot = static_cast<uint32_t>(impl.dynamics.size());
+        impl.dynamics.push_back(id);
+    }
+    return id;
+}
+
+
+LYS_API void Broadphase::remove(uint32_t proxy) {
+    Impl &impl = *pimpl_;
+    Proxy &removed = impl.proxies[proxy];
+    if (!removed.alive)
+        return;
+    removed.alive = false;
+    if (removed.motion == ProxyMotion::kStatic) {
+        impl.unlistStatic(proxy);
+        impl.changeStatic(proxy);
+    } else {
+        uint32_t last = impl.dynamics.back();
+        impl.dynamics[removed.slot] = last;
+        impl.proxies[last].slot = removed.slot;
+        impl.dynamics.pop_back();
+    }
+    impl.removedIds.push_back(proxy);
+}
+
+
+LYS_API void Broadphase::move(uint32_t proxy, const Box3Df &bounds) {
+    Impl &impl = *pimpl_;
+    Proxy &moved = impl.proxies[proxy];
+    if (moved.motion == ProxyMotion::kStatic) {
+        if (moved.bounds == bounds)
+            return;
+        if (impl.isWide(bounds) != moved.wide) {
+            impl.unlistStatic(proxy);
+            moved.bounds = bounds;
+            moved.wide = !moved.wide;
+            impl.listStatic(proxy);
+        } else if (!moved.wide) {
+            impl.writeSweep(moved.slot, bounds);
+        }
+        impl.changeStatic(proxy);
+    }
+    moved.bounds = bounds;
+}
+
+
+LYS_API const Box3Df& Broadphase::bounds(uint32_t proxy) const {
+    return pimpl_->proxies[proxy].bounds;
+}
+
+
+LYS_API uint32_t Broadphase::userData(uint32_t proxy) const {
+    return pimpl_->proxies[proxy].userData;
+}
+
+
+LYS_API ProxyMotion Broadphase::motion(uint32_t proxy) const {
+    return pimpl_->proxies[proxy].motion;
+}
+
+
+LYS_API void Broadphase::update() {
+    pimpl_->update();
+}
+
+
+LYS_API const Vector<BroadphasePair>& Broadphase::pairs() const {
+    return pimpl_->pairs;
+}
+
+
+LYS_API const Vector<BroadphasePair>& Broadphase::added() const {
+    return pimpl_->addedPairs;
+}
+
+
+LYS_API const Vector<BroadphasePair>& Broadphase::removed() const {
+    return pimpl_->removedPairs;
+}
+
+
+LYS_API const BroadphaseStats& Broadphase::stats() const {
+    return pimpl_->stats;
+}
+}
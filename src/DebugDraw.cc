@@ -0,0 +1,433 @@
+/***************************************************
+* DebugDraw.cc: Immediate-mode debug shapes        *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "DebugDraw.h"
+
+#include <math.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "GLES2/gl2.h"
+
+#include "config.h"
+#include "types.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "ResourceRegistry.h"
+#include "ShaderProgram.h"
+#include "VertexLayout.h"
+
+namespace lys3d {
+namespace {
+const uint32_t kCircleSegments = 32;
+
+const char* kDebugVS =
+    "attribute vec3 a_position;\n"
+    "attribute vec4 a_color;\n"
+    "uniform mat4 u_view_projection;\n"
+    "varying vec4 v_color;\n"
+    "void main() {\n"
+    "    v_color = a_color;\n"
+    "    gl_Position = u_view_projection * vec4(a_position, 1.0);\n"
+    "}\n";
+
+const char* kDebugFS =
+    "varying vec4 v_color;\n"
+    "void main() {\n"
+    "    gl_FragColor = v_color;\n"
+    "}\n";
+
+// One thread's shapes, for the frame being filled and the one collect() is
+// gathering. Only the owning thread appends, so no lock is needed; writing
+// tells collect() an append to the old set may still be under way
+struct ThreadBuffer {
+    std::thread::id thread;
+    std::atomic<bool> writing;
+    Vector<DebugVertex> vertices[2][kDebugBatchCount];
+};
+
+// Instances get serials rather than being told apart by address, which a
+// later instance could reuse
+std::atomic<uint64_t> gNextSerial(1);
+
+// The buffer this thread last used, and whose it is. One entry suffices:
+// everything normally goes to the global instance
+thread_local uint64_t tBufferOwner = 0;
+thread_local ThreadBuffer *tBuffer = nullptr;
+
+uint32_t batchIndex(bool lines, DebugDepth depth) {
+    return (depth == DebugDepth::kOverlay ? 2 : 0) + (lines ? 1 : 0);
+}
+
+// Inverts a column-major 4x4 matrix; false if it's singular
+bool invert(const float *m, float *out) {
+    float inv[16];
+    inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14]
+           + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14]
+           - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13]
+           + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13]
+            - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14]
+           - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14]
+           + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13]
+           - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13]
+            + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14]
+           + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+    inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14]
+           - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+    inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13]
+            + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+    inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13]
+            - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+    inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10]
+           - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+    inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10]
+           + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+    inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9]
+            - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+    inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9]
+            + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+    float determinant = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+    if (determinant == 0.0f)
+        return false;
+    for (int i = 0; i < 16; ++i)
+        out[i] = inv[i] / determinant;
+    return true;
+}
+
+// Corner i of a box has the max x if bit 0 is set, y bit 1, z bit 2; the
+// edges join corners differing in one bit
+const uint8_t kBoxEdges[12][2] = {
+    {0, 1}, {2, 3}, {4, 5}, {6, 7}, {0, 2}, {1, 3}, {4, 6}, {5, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7}
+};
+const uint8_t kBoxFaces[6][4] = {
+    {0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 4, 6, 2}, {1, 3, 7, 5}
+};
+}
+
+
+struct DebugDraw::Impl {
+    Impl() {
+        serial = gNextSerial.fetch_add(1);
+        frame.store(0);
+        buffer = 0;
+        bufferSize = 0;
+        matrixLocation = -1;
+        failed = false;
+        layout.add(kAttribPosition, 3, VertexFormat::kFloat)
+              .add(kAttribColor, 4, VertexFormat::kUByteNorm);
+    }
+
+    ~Impl() {
+        for (ThreadBuffer *thread_buffer : threads)
+            delete thread_buffer;
+        ResourceRegistry::global().release(GpuResourceType::kBuffer, buffer);
+    }
+
+    ThreadBuffer* local() {
+        if (tBufferOwner == serial)
+            return tBuffer;
+        std::lock_guard<std::mutex> lock(mutex);
+        std::thread::id id = std::this_thread::get_id();
+        ThreadBuffer *found = nullptr;
+        for (ThreadBuffer *thread_buffer : threads) {
+            if (thread_buffer->thread == id)
+                found = thread_buffer;
+        }
+        if (found == nullptr) {
+            found = new ThreadBuffer();
+            found->thread = id;
+            found->writing.store(false);
+            threads.push_back(found);
+        }
+        tBufferOwner = serial;
+        tBuffer = found;
+        return found;
+    }
+
+    // Brackets an append to this thread's buffer. Marking it as writing
+    // before reading the frame means collect(), which switches the frame
+    // before checking the marks, waits for any append to the set it takes
+    class Append {
+      public:
+        explicit Append(Impl *impl) {
+            buffer_ = impl->local();
+            buffer_->writing.store(true);
+            set_ = buffer_->vertices[impl->frame.load() & 1];
+        }
+
+        ~Append() {
+            buffer_->writing.store(false, std::memory_order_release);
+        }
+
+        Vector<DebugVertex>& batch(bool lines, DebugDepth depth) {
+            return set_[batchIndex(lines, depth)];
+        }
+
+      private:
+        ThreadBuffer *buffer_;
+        Vector<DebugVertex> *set_;
+    };
+
+    static DebugVertex vertex(const Point3Df &p, uint32_t rgba) {
+        DebugVertex v = {p.x(), p.y(), p.z(), {static_cast<uint8_t>(rgba >> 24), static_cast<uint8_t>(rgba >> 16),
+                                               static_cast<uint8_t>(rgba >> 8), static_cast<uint8_t>(rgba)}};
+        return v;
+    }
+
+    static void boxCorners(const Box3Df &box, Point3Df *corners) {
+        const Point3Df &lo = box.min(), &hi = box.max();
+        for (int i = 0; i < 8; ++i)
+            corners[i] = Point3Df(i & 1 ? hi.x() : lo.x(), i & 2 ? hi.y() : lo.y(), i & 4 ? hi.z() : lo.z());
+    }
+
+    void edges(const Point3Df *corners, uint32_t rgba, DebugDepth depth) {
+        Append append(this);
+        Vector<DebugVertex> &out = append.batch(true, depth);
+        for (const uint8_t *edge : kBoxEdges) {
+            out.push_back(vertex(corners[edge[0]], rgba));
+            out.push_back(vertex(corners[edge[1]], rgba));
+        }
+    }
+
+    bool create() {
+        if (!program.build(kDebugVS, kDebugFS))
+            return false;
+        matrixLocation = program.uniformLocation("u_view_projection");
+        glGenBuffers(1, &buffer);
+        return true;
+    }
+
+    uint64_t serial;
+    std::atomic<uint32_t> frame;
+    std::mutex mutex;
+    Vector<ThreadBuffer*> threads;
+
+    Vector<DebugVertex> batches[kDebugBatchCount];
+    DebugDrawStats stats;
+
+    ShaderProgram program;
+    VertexLayout layout;
+    uint32_t buffer;
+    uint32_t bufferSize;
+    int32_t matrixLocation;
+    bool failed;
+};
+
+
+LYS_API DebugDraw::DebugDraw() {
+    pimpl_ = new Impl();
+}
+
+
+LYS_API DebugDraw::~DebugDraw() {
+    delete pimpl_;
+}
+
+
+LYS_API DebugDraw& DebugDraw::global() {
+    static DebugDraw debug_draw;
+    return debug_draw;
+}
+
+
+LYS_API void DebugDraw::line(const Point3Df &a, const Point3Df &b, uint32_t rgba, DebugDepth depth) {
+    Impl::Append append(pimpl_);
+    Vector<DebugVertex> &out = append.batch(true, depth);
+    out.push_back(Impl::vertex(a, rgba));
+    out.push_back(Impl::vertex(b, rgba));
+}
+
+
+LYS_API void DebugDraw::triangle(const Point3Df &a, const Point3Df &b, const Point3Df &c, uint32_t rgba,
+                                 DebugDepth depth) {
+    Impl::Append append(pimpl_);
+    Vector<DebugVertex> &out = append.batch(false, depth);
+    out.push_back(Impl::vertex(a, rgba));
+    out.push_back(Impl::vertex(b, rgba));
+    out.push_back(Impl::vertex(c, rgba));
+}
+
+
+LYS_API void DebugDraw::box(const Box3Df &box, uint32_t rgba, DebugDepth depth) {
+    Point3Df corners[8];
+    Impl::boxCorners(box, corners);
+    pimpl_->edges(corners, rgba, depth);
+}
+
+
+LYS_API void DebugDraw::solidBox(const Box3Df &box, uint32_t rgba, DebugDepth depth) {
+    Point3Df corners[8];
+    Impl::boxCorners(box, corners);
+    Impl::Append append(pimpl_);
+    Vector<DebugVertex> &out = append.batch(false, depth);
+    for (const uint8_t *face : kBoxFaces) {
+        const uint8_t order[6] = {face[0], face[1], face[2], face[0], face[2], face[3]};
+        for (uint8_t corner : order)
+            out.push_back(Impl::vertex(corners[corner], rgba));
+    }
+}
+
+
+LYS_API void DebugDraw::sphere(const Point3Df &center, float radius, uint32_t rgba, DebugDepth depth) {
+    float cosines[kCircleSegments + 1], sines[kCircleSegments + 1];
+    for (uint32_t i = 0; i <= kCircleSegments; ++i) {
+        float angle = 6.2831853f * (i % kCircleSegments) / kCircleSegments;
+        cosines[i] = cosf(angle) * radius;
+        sines[i] = sinf(angle) * radius;
+    }
+    Impl::Append append(pimpl_);
+    Vector<DebugVertex> &out = append.batch(true, depth);
+    for (int axis = 0; axis < 3; ++axis) {
+        for (uint32_t i = 0; i < kCircleSegments; ++i) {
+            for (uint32_t j = i; j <= i + 1; ++j) {
+                float a = cosines[j], b = sines[j];
+                Point3Df offset = axis == 0 ? Point3Df(0.0f, a, b) : (axis == 1 ? Point3Df(a, 0.0f, b)
+                                                                                 : Point3Df(a, b, 0.0f));
+                out.push_back(Impl::vertex(center + offset, rgba));
+            }
+        }
+    }
+}
+
+
+LYS_API void DebugDraw::frustum(const float view_projection[16], uint32_t rgba, DebugDepth depth) {
+    // The corners of clip space, taken back to the world
+    float inverse[16];
+    if (!invert(view_projection, inverse))
+        return;
+    Point3Df corners[8];
+    for (int i = 0; i < 8; ++i) {
+        float clip[3] = {i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f};
+        float world[4];
+        for (int row = 0; row < 4; ++row)
+            world[row] = inverse[row] * clip[0] + inverse[4 + row] * clip[1] + inverse[8 + row] * clip[2]
+                       + inverse[12 + row];
+        float w = world[3] != 0.0f ? 1.0f / world[3] : 0.0f;
+        corners[i] = Point3Df(world[0] * w, world[1] * w, world[2] * w);
+    }
+    pimpl_->edges(corners, rgba, depth);
+}
+
+
+LYS_API void DebugDraw::axes(const float transform[16], float size, DebugDepth depth) {
+    const uint32_t colors[3] = {0xFF0000FF, 0x00FF00FF, 0x0000FFFF};
+    Point3Df origin(transform[12], transform[13], transform[14]);
+    Impl::Append append(pimpl_);
+    Vector<DebugVertex> &out = append.batch(true, depth);
+    for (int axis = 0; axis < 3; ++axis) {
+        const float *column = transform + axis * 4;
+        out.push_back(Impl::vertex(origin, colors[axis]));
+        out.push_back(Impl::vertex(origin + Point3Df(column[0], column[1], column[2]) * size, colors[axis]));
+    }
+}
+
+
+LYS_API void DebugDraw::collect() {
+    Impl &impl = *pimpl_;
+    for (Vector<DebugVertex> &batch : impl.batches)
+        batch.clear();
+    uint32_t old = impl.frame.fetch_add(1) & 1;
+    std::lock_guard<std::mutex> lock(impl.mutex);
+    for (ThreadBuffer *thread_buffer : impl.threads) {
+        while (thread_buffer->writing.load())
+            std::this_thread::yield();
+        for (uint32_t i = 0; i < kDebugBatchCount; ++i) {
+            Vector<DebugVertex> &from = thread_buffer->vertices[old][i];
+            impl.batches[i].insert(impl.batches[i].end(), from.begin(), from.end());
+            from.clear();
+        }
+    }
+    impl.stats = DebugDrawStats();
+    impl.stats.lineVertices = static_cast<uint32_t>(impl.batches[kDebugLines].size()
+                                                    + impl.batches[kDebugLinesOverlay].size());
+    impl.stats.triangleVertices = static_cast<uint32_t>(impl.batches[kDebugTriangles].size()
+                                                        + impl.batches[kDebugTrianglesOverlay].size());
+    impl.stats.threads = static_cast<uint32_t>(impl.threads.size());
+}
+
+
+LYS_API const Vector<DebugVertex>& DebugDraw::vertices(DebugBatch batch) const {
+    return pimpl_->batches[batch < kDebugBatchCount ? batch : kDebugTriangles];
+}
+
+
+LYS_API void DebugDraw::draw(const float view_projection[16]) {
+    Impl &impl = *pimpl_;
+    impl.stats.drawCalls = 0;
+    uint32_t total = impl.stats.lineVertices + impl.stats.triangleVertices;
+    if (total == 0)
+        return;
+    LYS_PROFILE_ZONE("Debug draw");
+    if (!impl.failed && impl.buffer == 0 && !impl.create())
+        impl.failed = true;
+    if (impl.failed)
+        return;
+
+    // Every batch goes into one freshly orphaned buffer
+    glBindBuffer(GL_ARRAY_BUFFER, impl.buffer);
+    uint32_t size = static_cast<uint32_t>(total * sizeof(DebugVertex));
+    glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    if (size != impl.bufferSize) {
+        impl.bufferSize = size;
+        ResourceRegistry::global().track(GpuResourceType::kBuffer, impl.buffer, impl.bufferSize);
+    }
+    uint32_t first = 0;
+    for (const Vector<DebugVertex> &batch : impl.batches) {
+        if (!batch.empty())
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(DebugVertex), batch.size() * sizeof(DebugVertex),
+                            batch.data());
+        first += static_cast<uint32_t>(batch.size());
+    }
+
+    // Save the state we change, so whatever draws next is unaffected
+    GLStateSnapshot saved;
+    saveGLState(kGLStateCapabilities | kGLStateBlendFunc | kGLStateDepthMask, &saved);
+
+    impl.program.use();
+    glUniformMatrix4fv(impl.matrixLocation, 1, GL_FALSE, view_projection);
+    setGLCapability(GL_BLEND, true);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    setGLCapability(GL_CULL_FACE, false);
+    glDepthMask(GL_FALSE);
+    impl.layout.apply();
+    first = 0;
+    for (uint32_t i = 0; i < kDebugBatchCount; ++i) {
+        GLsizei count = static_cast<GLsizei>(impl.batches[i].size());
+        if (count == 0)
+            continue;
+        setGLCapability(GL_DEPTH_TEST, i == kDebugTriangles || i == kDebugLines);
+        glDrawArrays(i == kDebugLines || i == kDebugLinesOverlay ? GL_LINES : GL_TRIANGLES, first, count);
+        first += count;
+        ++impl.stats.drawCalls;
+    }
+    impl.layout.disable();
+    restoreGLState(saved);
+}
+
+
+LYS_API void DebugDraw::flush(const float view_projection[16]) {
+    collect();
+    draw(view_projection);
+}
+
+
+LYS_API const DebugDrawStats& DebugDraw::stats() const {
+    return pimpl_->stats;
+}
+}
@@ -0,0 +1,588 @@
+/***************************************************
+* Font.cc: TrueType outlines & SDF glyphs          *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Font.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include <physfs.h>
+
+#include "config.h"
+#include "types.h"
+
+namespace lys3d {
+namespace {
+// Composite glyph flags
+const uint16_t kArgsAreWords = 0x0001;
+const uint16_t kArgsAreOffsets = 0x0002;
+const uint16_t kHaveScale = 0x0008;
+const uint16_t kMoreComponents = 0x0020;
+const uint16_t kHaveXYScale = 0x0040;
+const uint16_t kHaveTwoByTwo = 0x0080;
+
+// Simple glyph point flags
+const uint8_t kOnCurve = 0x01;
+const uint8_t kXShort = 0x02;
+const uint8_t kYShort = 0x04;
+const uint8_t kRepeat = 0x08;
+const uint8_t kXSameOrPositive = 0x10;
+const uint8_t kYSameOrPositive = 0x20;
+
+// Composites nest rarely more than twice; deeper ones are most likely loops
+const uint32_t kMaxDepth = 8;
+
+// Largest bitmap side renderSDF() will make
+const float kMaxBitmapSide = 4096.0f;
+
+// Curves are split into lines until they stray less than this many pixels
+const float kFlatness = 0.05f;
+
+uint32_t tag(const char *name) {
+    return static_cast<uint32_t>(name[0]) << 24 | static_cast<uint32_t>(name[1]) << 16
+           | static_cast<uint32_t>(name[2]) << 8 | static_cast<uint32_t>(name[3]);
+}
+
+// Big-endian reads; callers check the bounds first
+uint16_t read16(const Vector<uint8_t> &data, size_t offset) {
+    return static_cast<uint16_t>(data[offset] << 8 | data[offset + 1]);
+}
+
+int16_t readS16(const Vector<uint8_t> &data, size_t offset) {
+    return static_cast<int16_t>(read16(data, offset));
+}
+
+uint32_t read32(const Vector<uint8_t> &data, size_t offset) {
+    return static_cast<uint32_t>(read16(data, offset)) << 16 | read16(data, offset + 2);
+}
+
+bool fits(const Vector<uint8_t> &data, size_t offset, size_t length) {
+    return offset <= data.size() && length <= data.size() - offset;
+}
+
+struct Segment {
+    float x0, y0, x1, y1;
+};
+
+void addQuad(float x0, float y0, float cx, float cy, float x1, float y1, Vector<Segment> *segments) {
+    float dx = x0 - 2.0f * cx + x1, dy = y0 - 2.0f * cy + y1;
+    float deviation = sqrtf(dx * dx + dy * dy) / 8.0f;
+    int steps = std::max(1, std::min(32, static_cast<int>(ceilf(sqrtf(deviation / kFlatness)))));
+    float px = x0, py = y0;
+    for (int i = 1; i <= steps; ++i) {
+        float t = static_cast<float>(i) / steps, s = 1.0f - t;
+        float x = s * s * x0 + 2.0f * s * t * cx + t * t * x1;
+        float y = s * s * y0 + 2.0f * s * t * cy + t * t * y1;
+        Segment segment = {px, py, x, y};
+        segments->push_back(segment);
+        px = x;
+        py = y;
+    }
+}
+}
+
+
+LYS_API Font::Font() {
+    glyphCount_ = 0;
+    unitsPerEm_ = 1;
+    longOffsets_ = false;
+    loca_ = glyf_ = glyfLength_ = hmtx_ = metricCount_ = 0;
+    cmap_ = cmapFormat_ = 0;
+    kernPairs_ = kernCount_ = 0;
+    ascent_ = descent_ = lineGap_ = 0.0f;
+}
+
+
+LYS_API bool Font::load(const String &path) {
+    data_.clear();
+    PHYSFS_File *file = PHYSFS_openRead(path.c_str());
+    if (file == nullptr)
+        return false;
+
+    PHYSFS_sint64 length = PHYSFS_fileLength(file);
+    if (length <= 0) {
+        PHYSFS_close(file);
+        return false;
+    }
+    Vector<uint8_t> data(static_cast<size_t>(length));
+    PHYSFS_sint64 read = PHYSFS_readBytes(file, data.data(), data.size());
+    PHYSFS_close(file);
+    if (read != length)
+        return false;
+
+    return loadFromMemory(data.data(), data.size());
+}
+
+
+LYS_API bool Font::loadFromMemory(const void *data, size_t size) {
+    data_.clear();
+    if (data == nullptr || size < 12)
+        return false;
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    Vector<uint8_t> file(bytes, bytes + size);
+    uint32_t version = read32(file, 0);
+    if (version != 0x00010000 && version != tag("true"))
+        return false;
+
+    // Table directory
+    uint32_t table_count = read16(file, 4);
+    if (!fits(file, 12, table_count * 16))
+        return false;
+    uint32_t head = 0, hhea = 0, maxp = 0, hmtx = 0, loca = 0, glyf = 0, cmap = 0, kern = 0;
+    uint32_t hmtx_length = 0, loca_length = 0, glyf_length = 0, cmap_length = 0, kern_length = 0;
+    uint32_t head_length = 0, hhea_length = 0, maxp_length = 0;
+    for (uint32_t i = 0; i < table_count; ++i) {
+        size_t record = 12 + i * 16;
+        uint32_t name = read32(file, record), offset = read32(file, record + 8), length = read32(file, record + 12);
+        if (!fits(file, offset, length))
+            return false;
+        struct Wanted {
+            const char *name;
+            uint32_t *offset, *length;
+        } wanted[] = {{"head", &head, &head_length}, {"hhea", &hhea, &hhea_length}, {"maxp", &maxp, &maxp_length},
+                      {"hmtx", &hmtx, &hmtx_length}, {"loca", &loca, &loca_length}, {"glyf", &glyf, &glyf_length},
+                      {"cmap", &cmap, &cmap_length}, {"kern", &kern, &kern_length}};
+        for (const Wanted &table : wanted) {
+            if (name == tag(table.name)) {
+                *table.offset = offset;
+                *table.length = length;
+            }
+        }
+    }
+    if (head_length < 54 || hhea_length < 36 || maxp_length < 6 || hmtx_length < 4 || loca_length == 0
+        || cmap_length < 4)
+        return false;
+
+    unitsPerEm_ = read16(file, head + 18);
+    longOffsets_ = readS16(file, head + 50) != 0;
+    glyphCount_ = read16(file, maxp + 4);
+    metricCount_ = read16(file, hhea + 34);
+    if (unitsPerEm_ == 0 || glyphCount_ == 0 || metricCount_ == 0 || metricCount_ > glyphCount_
+        || hmtx_length < metricCount_ * 4 + (glyphCount_ - metricCount_) * 2
+        || loca_length < (glyphCount_ + 1) * (longOffsets_ ? 4u : 2u))
+        return false;
+    float em = static_cast<float>(unitsPerEm_);
+    ascent_ = readS16(file, hhea + 4) / em;
+    descent_ = readS16(file, hhea + 6) / em;
+    lineGap_ = readS16(file, hhea + 8) / em;
+    loca_ = loca;
+    glyf_ = glyf;
+    glyfLength_ = glyf_length;
+    hmtx_ = hmtx;
+
+    // The best Unicode character map: full-range (format 12) before BMP-only
+    // (format 4)
+    cmap_ = 0;
+    cmapFormat_ = 0;
+    uint32_t map_count = read16(file, cmap + 2);
+    if (cmap_length < 4 + map_count * 8)
+        return false;
+    int best = 0;
+    for (uint32_t i = 0; i < map_count; ++i) {
+        size_t record = cmap + 4 + i * 8;
+        uint32_t platform = read16(file, record), encoding = read16(file, record + 2);
+        uint32_t offset = cmap + read32(file, record + 4);
+        bool unicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+        if (!unicode || !fits(file, offset, 4))
+            continue;
+        uint32_t format = read16(file, offset);
+        int rank = 0;
+        if (format == 12 && fits(file, offset, 16) && fits(file, offset + 16, read32(file, offset + 12) * 12ull))
+            rank = 2;
+        else if (format == 4 && fits(file, offset, 14) && fits(file, offset, read16(file, offset + 2)))
+            rank = 1;
+        if (rank > best) {
+            best = rank;
+            cmap_ = offset;
+            cmapFormat_ = format;
+        }
+    }
+    if (best == 0)
+        return false;
+    if (cmapFormat_ == 4) {
+        uint32_t segments = read16(file, cmap_ + 6) / 2;
+        if (!fits(file, cmap_ + 16, segments * 8ull))
+            return false;
+    }
+
+    // Horizontal pairs from the first 'kern' subtable, if it's format 0
+    kernPairs_ = kernCount_ = 0;
+    if (kern_length >= 18 && read16(file, kern) == 0 && read16(file, kern + 2) > 0) {
+        uint32_t coverage = read16(file, kern + 8);
+        uint32_t pairs = read16(file, kern + 10);
+        if ((coverage & 0xFF07) == 0x0001 && kern_length >= 18 + pairs * 6) {
+            kernPairs_ = kern + 18;
+            kernCount_ = pairs;
+        }
+    }
+
+    data_.swap(file);
+    return true;
+}
+
+
+LYS_API uint32_t Font::glyphIndex(uint32_t codepoint) const {
+    if (data_.empty())
+        return 0;
+    uint32_t glyph = 0;
+    if (cmapFormat_ == 12) {
+        uint32_t lo = 0, hi = read32(data_, cmap_ + 12);
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            size_t group = cmap_ + 16 + mid * 12;
+            if (codepoint < read32(data_, group)) {
+                hi = mid;
+            } else if (codepoint > read32(data_, group + 4)) {
+                lo = mid + 1;
+            } else {
+                glyph = read32(data_, group + 8) + codepoint - read32(data_, group);
+                break;
+            }
+        }
+    } else if (codepoint <= 0xFFFF) {
+        // Segments are sorted by their last code point
+        uint32_t segments = read16(data_, cmap_ + 6) / 2;
+        size_t ends = cmap_ + 14, starts = ends + segments * 2 + 2;
+        size_t deltas = starts + segments * 2, ranges = deltas + segments * 2;
+        uint32_t lo = 0, hi = segments;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (read16(data_, ends + mid * 2) < codepoint)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo < segments && read16(data_, starts + lo * 2) <= codepoint) {
+            uint32_t delta = read16(data_, deltas + lo * 2), range = read16(data_, ranges + lo * 2);
+            if (range == 0) {
+                glyph = (codepoint + delta) & 0xFFFF;
+            } else {
+                size_t address = ranges + lo * 2 + range + (codepoint - read16(data_, starts + lo * 2)) * 2;
+                if (fits(data_, address, 2)) {
+                    glyph = read16(data_, address);
+                    if (glyph != 0)
+                        glyph = (glyph + delta) & 0xFFFF;
+                }
+            }
+        }
+    }
+    return glyph < glyphCount_ ? glyph : 0;
+}
+
+
+LYS_API float Font::advance(uint32_t glyph) const {
+    if (data_.empty() || glyph >= glyphCount_)
+        return 0.0f;
+    uint32_t metric = std::min(glyph, metricCount_ - 1);
+    return read16(data_, hmtx_ + metric * 4) / static_cast<float>(unitsPerEm_);
+}
+
+
+LYS_API float Font::kerning(uint32_t left, uint32_t right) const {
+    uint32_t key = left << 16 | right;
+    uint32_t lo = 0, hi = kernCount_;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        uint32_t pair = read32(data_, kernPairs_ + mid * 6);
+        if (pair < key)
+            lo = mid + 1;
+        else if (pair > key)
+            hi = mid;
+        else
+            return readS16(data_, kernPairs_ + mid * 6 + 4) / static_cast<float>(unitsPerEm_);
+    }
+    return 0.0f;
+}
+
+
+uint32_t Font::glyphOffset(uint32_t glyph, uint32_t *length) const {
+    uint32_t start, end;
+    if (longOffsets_) {
+        start = read32(data_, loca_ + glyph * 4);
+        end = read32(data_, loca_ + glyph * 4 + 4);
+    } else {
+        start = read16(data_, loca_ + glyph * 2) * 2u;
+        end = read16(data_, loca_ + glyph * 2 + 2) * 2u;
+    }
+    *length = end > start && end <= glyfLength_ ? end - start : 0;
+    return glyf_ + start;
+}
+
+
+// Appends a glyph's points, mapped through transform (a, b, c, d, e, f:
+// x' = a x + c y + e, y' = b x + d y + f)
+bool Font::outline(uint32_t glyph, const float *transform, uint32_t depth, Vector<Point> *points,
+                   Vector<uint8_t> *on_curve, Vector<uint32_t> *contour_ends) const {
+    if (glyph >= glyphCount_ || depth > kMaxDepth)
+        return false;
+    uint32_t length = 0;
+    size_t offset = glyphOffset(glyph, &length);
+    if (length == 0)
+        return true;
+    if (length < 10)
+        return false;
+    size_t end = offset + length;
+    int contours = readS16(data_, offset);
+
+    if (contours < 0) {
+        size_t at = offset + 10;
+        uint16_t flags = kMoreComponents;
+        while (flags & kMoreComponents) {
+            if (at + 4 > end)
+                return false;
+            flags = read16(data_, at);
+            uint32_t component = read16(data_, at + 2);
+            at += 4;
+            float dx = 0.0f, dy = 0.0f;
+            if (flags & kArgsAreWords) {
+                if (at + 4 > end)
+                    return false;
+                if (flags & kArgsAreOffsets) {
+                    dx = readS16(data_, at);
+                    dy = readS16(data_, at + 2);
+                }
+                at += 4;
+            } else {
+                if (at + 2 > end)
+                    return false;
+                if (flags & kArgsAreOffsets) {
+                    dx = static_cast<int8_t>(data_[at]);
+                    dy = static_cast<int8_t>(data_[at + 1]);
+                }
+                at += 2;
+            }
+            // Point-matched placement is rare; such components stay put
+            float a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f;
+            size_t scales = flags & kHaveTwoByTwo ? 4 : (flags & kHaveXYScale ? 2 : (flags & kHaveScale ? 1 : 0));
+            if (at + scales * 2 > end)
+                return false;
+            if (scales == 1) {
+                a = d = readS16(data_, at) / 16384.0f;
+            } else if (scales == 2) {
+                a = readS16(data_, at) / 16384.0f;
+                d = readS16(data_, at + 2) / 16384.0f;
+            } else if (scales == 4) {
+                a = readS16(data_, at) / 16384.0f;
+                b = readS16(data_, at + 2) / 16384.0f;
+                c = readS16(data_, at + 4) / 16384.0f;
+                d = readS16(data_, at + 6) / 16384.0f;
+            }
+            at += scales * 2;
+            const float *t = transform;
+            float combined[6] = {t[0] * a + t[2] * b, t[1] * a + t[3] * b, t[0] * c + t[2] * d, t[1] * c + t[3] * d,
+                                 t[0] * dx + t[2] * dy + t[4], t[1] * dx + t[3] * dy + t[5]};
+            if (!outline(component, combined, depth + 1, points, on_curve, contour_ends))
+                return false;
+        }
+        return true;
+    }
+
+    size_t at = offset + 10;
+    if (at + contours * 2 + 2 > end)
+        return false;
+    uint32_t first = static_cast<uint32_t>(points->size());
+    uint32_t count = 0;
+    for (int i = 0; i < contours; ++i) {
+        uint32_t last = read16(data_, at + i * 2) + 1u;
+        if (last < count)
+            return false;
+        count = last;
+        contour_ends->push_back(first + count);
+    }
+    at += contours * 2;
+    at += 2 + read16(data_, at);
+
+    // Flags, then x deltas, then y deltas
+    Vector<uint8_t> flags(count);
+    for (uint32_t i = 0; i < count;) {
+        if (at >= end)
+            return false;
+        uint8_t flag = data_[at++];
+        uint32_t repeat = 1;
+        if (flag & kRepeat) {
+            if (at >= end)
+                return false;
+            repeat += data_[at++];
+        }
+        for (; repeat > 0 && i < count; --repeat)
+            flags[i++] = flag;
+    }
+    Vector<float> xs(count), ys(count);
+    for (int axis = 0; axis < 2; ++axis) {
+        uint8_t short_bit = axis == 0 ? kXShort : kYShort;
+        uint8_t same_bit = axis == 0 ? kXSameOrPositive : kYSameOrPositive;
+        Vector<float> &values = axis == 0 ? xs : ys;
+        int32_t value = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (flags[i] & short_bit) {
+                if (at + 1 > end)
+                    return false;
+                value += flags[i] & same_bit ? data_[at] : -data_[at];
+                at += 1;
+            } else if (!(flags[i] & same_bit)) {
+                if (at + 2 > end)
+                    return false;
+                value += readS16(data_, at);
+                at += 2;
+            }
+            values[i] = static_cast<float>(value);
+        }
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        Point p = {transform[0] * xs[i] + transform[2] * ys[i] + transform[4],
+                   transform[1] * xs[i] + transform[3] * ys[i] + transform[5]};
+        points->push_back(p);
+        on_curve->push_back(flags[i] & kOnCurve);
+    }
+    return true;
+}
+
+
+LYS_API bool Font::renderSDF(uint32_t glyph, float pixel_size, float spread, Vector<uint8_t> *pixels,
+                             GlyphBitmap *bitmap) const {
+    *bitmap = GlyphBitmap();
+    pixels->clear();
+    if (data_.empty() || pixel_size <= 0.0f || spread <= 0.0f)
+        return false;
+    float scale = pixel_size / unitsPerEm_;
+    const float transform[6] = {scale, 0.0f, 0.0f, scale, 0.0f, 0.0f};
+    Vector<Point> points;
+    Vector<uint8_t> on_curve;
+    Vector<uint32_t> contour_ends;
+    if (!outline(glyph, transform, 0, &points, &on_curve, &contour_ends))
+        return false;
+
+    // Contours to lines. Two off-curve points in a row imply an on-curve one
+    // between them
+    Vector<Segment> segments;
+    Vector<Point> ring;
+    Vector<uint8_t> ring_on;
+    uint32_t start = 0;
+    for (uint32_t end : contour_ends) {
+        uint32_t count = end - start;
+        ring.clear();
+        ring_on.clear();
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t a = start + i, b = start + (i + 1) % count;
+            ring.push_back(points[a]);
+            ring_on.push_back(on_curve[a]);
+            if (!on_curve[a] && !on_curve[b]) {
+                Point mid = {(points[a].x + points[b].x) * 0.5f, (points[a].y + points[b].y) * 0.5f};
+                ring.push_back(mid);
+                ring_on.push_back(1);
+            }
+        }
+        start = end;
+        size_t first = std::find(ring_on.begin(), ring_on.end(), 1) - ring_on.begin();
+        if (first == ring.size())
+            continue;
+        Point pen = ring[first], control = pen;
+        bool curved = false;
+        for (size_t k = 1; k <= ring.size(); ++k) {
+            size_t i = (first + k) % ring.size();
+            const Point &p = ring[i];
+            if (!ring_on[i]) {
+                control = p;
+                curved = true;
+                continue;
+            }
+            if (curved) {
+                addQuad(pen.x, pen.y, control.x, control.y, p.x, p.y, &segments);
+            } else if (p.x != pen.x || p.y != pen.y) {
+                Segment segment = {pen.x, pen.y, p.x, p.y};
+                segments.push_back(segment);
+            }
+            pen = p;
+            curved = false;
+        }
+    }
+    if (segments.empty())
+        return true;
+
+    float min_x = segments[0].x0, max_x = min_x, min_y = segments[0].y0, max_y = min_y;
+    for (const Segment &s : segments) {
+        min_x = std::min(min_x, std::min(s.x0, s.x1));
+        max_x = std::max(max_x, std::max(s.x0, s.x1));
+        min_y = std::min(min_y, std::min(s.y0, s.y1));
+        max_y = std::max(max_y, std::max(s.y0, s.y1));
+    }
+    float pad = ceilf(spread) + 1.0f;
+    float left = floorf(min_x) - pad, right = ceilf(max_x) + pad;
+    float bottom = floorf(min_y) - pad, top = ceilf(max_y) + pad;
+    if (right - left > kMaxBitmapSide || top - bottom > kMaxBitmapSide)
+        return false;
+    bitmap->width = static_cast<uint32_t>(right - left);
+    bitmap->height = static_cast<uint32_t>(top - bottom);
+    bitmap->left = static_cast<int32_t>(left);
+    bitmap->top = static_cast<int32_t>(top);
+    pixels->resize(bitmap->width * bitmap->height);
+
+    // Each segment lowers the distance of the pixels within spread of it;
+    // then, row by row, the non-zero winding rule says which are inside
+    float reach = spread * spread;
+    Vector<float> nearest(pixels->size(), reach);
+    for (const Segment &s : segments) {
+        uint32_t row0 = static_cast<uint32_t>(std::max(top - std::max(s.y0, s.y1) - spread, 0.0f));
+        uint32_t row1 = static_cast<uint32_t>(std::min(top - std::min(s.y0, s.y1) + spread, static_cast<float>(bitmap->height - 1)));
+        uint32_t column0 = static_cast<uint32_t>(std::max(std::min(s.x0, s.x1) - spread - left, 0.0f));
+        uint32_t column1 = static_cast<uint32_t>(std::min(std::max(s.x0, s.x1) + spread - left,
+                                                          static_cast<float>(bitmap->width - 1)));
+        // Distance to the closest point, at s.x0 + t dx, s.y0 + t dy
+        float dx = s.x1 - s.x0, dy = s.y1 - s.y0;
+        float length = dx * dx + dy * dy;
+        float inverse = length > 0.0f ? 1.0f / length : 0.0f;
+        for (uint32_t row = row0; row <= row1; ++row) {
+            float ry = top - row - 0.5f - s.y0;
+            float *out = &nearest[row * bitmap->width];
+            for (uint32_t column = column0; column <= column1; ++column) {
+                float rx = left + column + 0.5f - s.x0;
+                float t = std::max(0.0f, std::min((rx * dx + ry * dy) * inverse, 1.0f));
+                float ex = dx * t - rx, ey = dy * t - ry;
+                out[column] = std::min(out[column], ex * ex + ey * ey);
+            }
+        }
+    }
+
+    struct Crossing {
+        float x;
+        int direction;
+        bool operator<(const Crossing &other) const {
+            return x < other.x;
+        }
+    };
+    Vector<Crossing> crossings;
+    for (uint32_t row = 0; row < bitmap->height; ++row) {
+        float y = top - row - 0.5f;
+        crossings.clear();
+        for (const Segment &s : segments) {
+            if ((s.y0 <= y && y < s.y1) || (s.y1 <= y && y < s.y0)) {
+                Crossing crossing = {s.x0 + (y - s.y0) * (s.x1 - s.x0) / (s.y1 - s.y0), s.y1 > s.y0 ? 1 : -1};
+                crossings.push_back(crossing);
+            }
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        size_t passed = 0;
+        int winding = 0;
+        uint8_t *out = &(*pixels)[row * bitmap->width];
+        const float *distances = &nearest[row * bitmap->width];
+        for (uint32_t column = 0; column < bitmap->width; ++column) {
+            float x = left + column + 0.5f;
+            for (; passed < crossings.size() && crossings[passed].x < x; ++passed)
+                winding += crossings[passed].direction;
+            float distance = sqrtf(distances[column]) * (winding != 0 ? 1.0f : -1.0f);
+            float value = 127.5f + distance / spread * 127.5f;
+            out[column] = static_cast<uint8_t>(std::max(0.0f, std::min(value + 0.5f, 255.0f)));
+        }
+    }
+    return true;
+}
+}
@@ -0,0 +1,595 @@
+/***************************************************
+* FrameCapture.cc: Screenshots & video recording   *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "FrameCapture.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "GLES2/gl2.h"
+#include "GLES2/gl2ext.h"
+#include <SDL2/SDL_video.h>
+#include <SDL_image.h>
+
+#include "config.h"
+#include "types.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "ResourceRegistry.h"
+
+namespace lys3d {
+namespace {
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// One frame on its way from GL to the encoder, or the end of a recording
+struct EncodeJob {
+    Vector<uint8_t> pixels;
+    Dimension2Di32 size;
+    String screenshot;
+    FILE *video = nullptr;
+    uint32_t fps = 0;
+    bool close = false;
+};
+
+uint8_t clampByte(int32_t value) {
+    return static_cast<uint8_t>(std::min(255, std::max(0, value)));
+}
+
+// Full-range BT.601 4:2:0, as the C420jpeg tag says, with odd sizes
+// rounding the chroma planes up
+bool writeY4MFrame(FILE *file, const EncodeJob &job, Vector<uint8_t> *planes) {
+    const int32_t width = job.size.width(), height = job.size.height();
+    const int32_t chroma_width = (width + 1) / 2, chroma_height = (height + 1) / 2;
+    const size_t luma_size = static_cast<size_t>(width) * height;
+    const size_t chroma_size = static_cast<size_t>(chroma_width) * chroma_height;
+    planes->resize(luma_size + chroma_size * 2);
+    uint8_t *y_plane = planes->data();
+    uint8_t *u_plane = y_plane + luma_size;
+    uint8_t *v_plane = u_plane + chroma_size;
+
+    // The pixels come bottom row first
+    const uint8_t *rgba = job.pixels.data();
+    const size_t stride = static_cast<size_t>(width) * 4;
+    for (int32_t y = 0; y < height; ++y) {
+        const uint8_t *row = rgba + (height - 1 - y) * stride;
+        for (int32_t x = 0; x < width; ++x, row += 4)
+            y_plane[y * width + x] = static_cast<uint8_t>((77 * row[0] + 150 * row[1] + 29 * row[2] + 128) >> 8);
+    }
+    for (int32_t cy = 0; cy < chroma_height; ++cy) {
+        for (int32_t cx = 0; cx < chroma_width; ++cx) {
+            int32_t r = 0, g = 0, b = 0;
+            for (int32_t dy = 0; dy < 2; ++dy) {
+                int32_t y = std::min(cy * 2 + dy, height - 1);
+                const uint8_t *row = rgba + (height - 1 - y) * stride;
+                for (int32_t dx = 0; dx < 2; ++dx) {
+                    const uint8_t *pixel = row + std::min(cx * 2 + dx, width - 1) * 4;
+                    r += pixel[0];
+                    g += pixel[1];
+                    b += pixel[2];
+                }
+            }
+            r = (r + 2) / 4;
+            g = (g + 2) / 4;
+            b = (b + 2) / 4;
+            u_plane[cy * chroma_width + cx] = clampByte((-43 * r - 85 * g + 128 * b + 32896) >> 8);
+            v_plane[cy * chroma_width + cx] = clampByte((128 * r - 107 * g - 21 * b + 32896) >> 8);
+        }
+    }
+
+    return fputs("FRAME\n", file) >= 0 && fwrite(planes->data(), 1, planes->size(), file) == planes->size();
+}
+
+// Flips the pixels in place, so it has to come after the video frame
+bool writePNG(EncodeJob *job) {
+    const int32_t width = job->size.width(), height = job->size.height();
+    const size_t stride = static_cast<size_t>(width) * 4;
+    Vector<uint8_t> row(stride);
+    for (int32_t y = 0; y < height / 2; ++y) {
+        uint8_t *top = job->pixels.data() + y * stride;
+        uint8_t *bottom = job->pixels.data() + (height - 1 - y) * stride;
+        memcpy(row.data(), top, stride);
+        memcpy(top, bottom, stride);
+        memcpy(bottom, row.data(), stride);
+    }
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormatFrom(job->pixels.data(), width, height, 32,
+                                                              static_cast<int>(stride), SDL_PIXELFORMAT_RGBA32);
+    if (surface == nullptr)
+        return false;
+    bool saved = IMG_SavePNG(surface, job->screenshot.c_str()) == 0;
+    SDL_FreeSurface(surface);
+    return saved;
+}
+}
+
+
+struct FrameCapture::Impl {
+    // An offscreen copy of a frame, waiting to be read back
+    struct Slot {
+        uint32_t buffer = 0;
+        uint32_t texture = 0;
+        uint32_t framebuffer = 0;
+        Dimension2Di32 size;
+        uint64_t frame = 0;
+        EncodeJob job;
+    };
+
+    Impl() {
+        memoryLimit = 0;
+        recording = false;
+        video = nullptr;
+        fps = 0;
+        videoStarted = false;
+        nextSlot = 0;
+        pendingSlots = 0;
+        frame = 0;
+        extensionsChecked = false;
+        pixelBuffers = false;
+        mapRange = nullptr;
+        unmap = nullptr;
+        totalMs = 0.0;
+        timedFrames = 0;
+        droppedCounter = Profiler::global().counter("Captured frames dropped");
+        busy = 0;
+        quit = false;
+    }
+
+    void checkExtensions() {
+        if (extensionsChecked)
+            return;
+        extensionsChecked = true;
+        if (SDL_GL_ExtensionSupported("GL_NV_pixel_buffer_object") != SDL_TRUE
+            && SDL_GL_ExtensionSupported("GL_ARB_pixel_buffer_object") != SDL_TRUE)
+            return;
+        if (SDL_GL_ExtensionSupported("GL_EXT_map_buffer_range") == SDL_TRUE) {
+            mapRange = (PFN_glMapBufferRangeEXT)SDL_GL_GetProcAddress("glMapBufferRangeEXT");
+            unmap = (PFN_glUnmapBufferOES)SDL_GL_GetProcAddress("glUnmapBufferOES");
+        } else if (SDL_GL_ExtensionSupported("GL_ARB_map_buffer_range") == SDL_TRUE) {
+            mapRange = (PFN_glMapBufferRangeEXT)SDL_GL_GetProcAddress("glMapBufferRange");
+            unmap = (PFN_glUnmapBufferOES)SDL_GL_GetProcAddress("glUnmapBuffer");
+        }
+        pixelBuffers = mapRange != nullptr && unmap != nullptr;
+    }
+
+    bool wanted() const {
+        return recording || !screenshot.empty();
+    }
+
+    void drop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.dropped;
+        Profiler::global().count(droppedCounter);
+    }
+
+    // Reuses a buffer the encoder is done with when there is one; a spare
+    // that doesn't fit any more is freed rather than kept
+    bool acquire(Vector<uint8_t> *pixels, size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Vector<uint8_t> buffer;
+        uint64_t held = stats.heldBytes;
+        if (!spare.empty()) {
+            buffer = std::move(spare.back());
+            spare.pop_back();
+            held -= buffer.capacity();
+        }
+        if (held + std::max(bytes, buffer.capacity()) > memoryLimit) {
+            stats.heldBytes = held;
+            return false;
+        }
+        buffer.resize(bytes);
+        stats.heldBytes = held + buffer.capacity();
+        *pixels = std::move(buffer);
+        return true;
+    }
+
+    // Called with the mutex held
+    void recycle(Vector<uint8_t> *pixels) {
+        if (spare.size() < kSlots) {
+            spare.push_back(std::move(*pixels));
+        } else {
+            stats.heldBytes -= pixels->capacity();
+            Vector<uint8_t>().swap(*pixels);
+        }
+    }
+
+    // Decides what the frame is for and reserves memory for it
+    bool prepareJob(EncodeJob *job, const Dimension2Di32 &size) {
+        bool for_video = recording;
+        if (for_video && videoStarted
+            && (size.width() != videoSize.width() || size.height() != videoSize.height())) {
+            for_video = false;
+            drop();
+        }
+        if (!for_video && screenshot.empty())
+            return false;
+        if (!acquire(&job->pixels, static_cast<size_t>(size.width()) * size.height() * 4)) {
+            drop();
+            return false;
+        }
+        job->size = size;
+        job->screenshot.swap(screenshot);
+        if (for_video) {
+            job->video = video;
+            job->fps = fps;
+            videoStarted = true;
+            videoSize = size;
+        }
+        return true;
+    }
+
+    void push(EncodeJob *job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!job->pixels.empty())
+            ++stats.captured;
+        queue.push_back(std::move(*job));
+        *job = EncodeJob();
+        if (!encoder.joinable())
+            encoder = std::thread(&Impl::encoderMain, this);
+        wake.notify_one();
+    }
+
+    void giveBack(EncodeJob *job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        recycle(&job->pixels);
+        *job = EncodeJob();
+    }
+
+    void releaseSlot(Slot *slot) {
+        ResourceRegistry &registry = ResourceRegistry::global();
+        registry.release(GpuResourceType::kBuffer, slot->buffer);
+        registry.release(GpuResourceType::kFramebuffer, slot->framebuffer);
+        registry.release(GpuResourceType::kTexture, slot->texture);
+        slot->buffer = 0;
+        slot->framebuffer = 0;
+        slot->texture = 0;
+        slot->size = Dimension2Di32();
+    }
+
+    // (Re)allocates a slot for frames of the given size
+    bool allocate(Slot *slot, const Dimension2Di32 &size) {
+        if (slot->size.width() == size.width() && slot->size.height() == size.height()
+            && (slot->buffer != 0 || slot->framebuffer != 0))
+            return true;
+        releaseSlot(slot);
+
+        ResourceRegistry &registry = ResourceRegistry::global();
+        const uint64_t bytes = static_cast<uint64_t>(size.width()) * size.height() * 4;
+        if (pixelBuffers) {
+            glGenBuffers(1, &slot->buffer);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, slot->buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER_NV, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, 0);
+            registry.track(GpuResourceType::kBuffer, slot->buffer, bytes);
+            slot->size = size;
+            return true;
+        }
+
+        // RGB, because the default framebuffer may have no alpha to copy
+        GLuint old_texture = boundTexture2D();
+        glGenTextures(1, &slot->texture);
+        glBindTexture(GL_TEXTURE_2D, slot->texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, size.width(), size.height(), 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D, old_texture);
+        registry.track(GpuResourceType::kTexture, slot->texture, bytes);
+
+        glGenFramebuffers(1, &slot->framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, slot->framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, slot->texture, 0);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        registry.track(GpuResourceType::kFramebuffer, slot->framebuffer, 0);
+        slot->size = size;
+        if (!complete)
+            releaseSlot(slot);
+        return complete;
+    }
+
+    // Starts copying the frame into the next slot, unless it's still busy
+    void issue(const Dimension2Di32 &size) {
+        Slot &slot = slots[nextSlot];
+        if (pendingSlots == kSlots) {
+            drop();
+            return;
+        }
+        if (!prepareJob(&slot.job, size))
+            return;
+        if (!allocate(&slot, size)) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++stats.failed;
+            }
+            giveBack(&slot.job);
+            return;
+        }
+
+        if (pixelBuffers) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, slot.buffer);
+            glReadPixels(0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, 0);
+        } else {
+            GLuint old_texture = boundTexture2D();
+            glBindTexture(GL_TEXTURE_2D, slot.texture);
+            glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, size.width(), size.height());
+            glBindTexture(GL_TEXTURE_2D, old_texture);
+        }
+        slot.frame = frame;
+        nextSlot = (nextSlot + 1) % kSlots;
+        ++pendingSlots;
+    }
+
+    bool readBack(Slot *slot) {
+        EncodeJob &job = slot->job;
+        if (pixelBuffers) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, slot->buffer);
+            const void *mapped = mapRange(GL_PIXEL_PACK_BUFFER_NV, 0, static_cast<GLsizeiptr>(job.pixels.size()),
+                                          GL_MAP_READ_BIT_EXT);
+            if (mapped != nullptr)
+                memcpy(job.pixels.data(), mapped, job.pixels.size());
+            // The contents can be lost while mapped, e.g. on a mode switch
+            bool ok = mapped != nullptr && unmap(GL_PIXEL_PACK_BUFFER_NV) == GL_TRUE;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, 0);
+            return ok;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, slot->framebuffer);
+        glReadPixels(0, 0, job.size.width(), job.size.height(), GL_RGBA, GL_UNSIGNED_BYTE, job.pixels.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return true;
+    }
+
+    // Reads back the slots copied at least kLatency frames ago, oldest
+    // first, or all of them
+    void collect(bool all) {
+        while (pendingSlots > 0) {
+            Slot &slot = slots[(nextSlot + kSlots - pendingSlots) % kSlots];
+            if (!all && frame - slot.frame < kLatency)
+                break;
+            --pendingSlots;
+            if (readBack(&slot)) {
+                push(&slot.job);
+            } else {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ++stats.failed;
+                }
+                giveBack(&slot.job);
+            }
+        }
+    }
+
+    void encoderMain() {
+        Vector<uint8_t> planes;
+        FILE *started = nullptr;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return quit || !queue.empty(); });
+            // Whatever was queued still gets written before quitting
+            if (queue.empty())
+                return;
+            EncodeJob job = std::move(queue.front());
+            queue.pop_front();
+            ++busy;
+            lock.unlock();
+
+            bool ok = true;
+            if (job.video != nullptr && !job.pixels.empty()) {
+                if (job.video != started) {
+                    ok = fprintf(job.video, "YUV4MPEG2 W%d H%d F%u:1 Ip A1:1 C420jpeg\n", job.size.width(),
+                                 job.size.height(), job.fps) > 0;
+                    started = job.video;
+                }
+                ok = ok && writeY4MFrame(job.video, job, &planes);
+            }
+            if (!job.screenshot.empty())
+                ok = writePNG(&job) && ok;
+            if (job.close) {
+                ok = fclose(job.video) == 0;
+                started = nullptr;
+            }
+
+            lock.lock();
+            if (!job.pixels.empty()) {
+                if (ok)
+                    ++stats.encoded;
+                else
+                    ++stats.failed;
+                recycle(&job.pixels);
+            } else if (!ok) {
+                ++stats.failed;
+            }
+            --busy;
+            if (queue.empty() && busy == 0)
+                idle.notify_all();
+        }
+    }
+
+    uint64_t memoryLimit;
+    String screenshot;
+    bool recording;
+    FILE *video;
+    uint32_t fps;
+    bool videoStarted;
+    Dimension2Di32 videoSize;
+    Slot slots[kSlots];
+    uint32_t nextSlot;
+    uint32_t pendingSlots;
+    uint64_t frame;
+    bool extensionsChecked;
+    bool pixelBuffers;
+    PFN_glMapBufferRangeEXT mapRange;
+    PFN_glUnmapBufferOES unmap;
+    double totalMs;
+    uint32_t timedFrames;
+    uint32_t droppedCounter;
+
+    // Shared with the encoder thread
+    std::thread encoder;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<EncodeJob> queue;
+    Vector<Vector<uint8_t>> spare;
+    uint32_t busy;
+    bool quit;
+    FrameCaptureStats stats;
+};
+
+
+LYS_API FrameCapture::FrameCapture(uint64_t memory_limit) {
+    pimpl_ = new Impl();
+    pimpl_->memoryLimit = memory_limit;
+}
+
+
+LYS_API FrameCapture::~FrameCapture() {
+    stopRecording();
+    pimpl_->collect(true);
+    for (Impl::Slot &slot : pimpl_->slots)
+        pimpl_->releaseSlot(&slot);
+    if (pimpl_->encoder.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(pimpl_->mutex);
+            pimpl_->quit = true;
+        }
+        pimpl_->wake.notify_all();
+        pimpl_->encoder.join();
+    }
+    delete pimpl_;
+}
+
+
+LYS_API uint64_t FrameCapture::memoryLimit() const {
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    return pimpl_->memoryLimit;
+}
+
+
+LYS_API void FrameCapture::memoryLimit(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    pimpl_->memoryLimit = bytes;
+}
+
+
+LYS_API bool FrameCapture::screenshot(const String &path) {
+    if (!pimpl_->screenshot.empty() || path.empty())
+        return false;
+    pimpl_->screenshot = path;
+    return true;
+}
+
+
+LYS_API bool FrameCapture::startRecording(const String &path, uint32_t fps) {
+    if (pimpl_->recording || fps == 0)
+        return false;
+    pimpl_->video = fopen(path.c_str(), "wb");
+    if (pimpl_->video == nullptr)
+        return false;
+    pimpl_->recording = true;
+    pimpl_->fps = fps;
+    pimpl_->videoStarted = false;
+    pimpl_->totalMs = 0.0;
+    pimpl_->timedFrames = 0;
+
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    uint64_t held = pimpl_->stats.heldBytes;
+    pimpl_->stats = FrameCaptureStats();
+    pimpl_->stats.heldBytes = held;
+    return true;
+}
+
+
+LYS_API bool FrameCapture::stopRecording() {
+    if (!pimpl_->recording)
+        return false;
+    pimpl_->collect(true);
+    EncodeJob end;
+    end.video = pimpl_->video;
+    end.close = true;
+    pimpl_->push(&end);
+    pimpl_->recording = false;
+    pimpl_->video = nullptr;
+    pimpl_->videoStarted = false;
+    return true;
+}
+
+
+LYS_API bool FrameCapture::isRecording() const {
+    return pimpl_->recording;
+}
+
+
+LYS_API bool FrameCapture::isCapturing() const {
+    return pimpl_->wanted() || pimpl_->pendingSlots > 0;
+}
+
+
+LYS_API void FrameCapture::capture(const Dimension2Di32 &size) {
+    if (!isCapturing())
+        return;
+    int64_t start = now();
+    {
+        LYS_PROFILE_ZONE("Frame capture");
+        pimpl_->checkExtensions();
+        ++pimpl_->frame;
+        pimpl_->collect(false);
+        if (pimpl_->wanted() && size.width() > 0 && size.height() > 0)
+            pimpl_->issue(size);
+    }
+
+    float ms = static_cast<float>((now() - start) * 1.0e-6);
+    pimpl_->totalMs += ms;
+    ++pimpl_->timedFrames;
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    FrameCaptureStats &stats = pimpl_->stats;
+    stats.lastMs = ms;
+    stats.averageMs = static_cast<float>(pimpl_->totalMs / pimpl_->timedFrames);
+    stats.maxMs = std::max(stats.maxMs, ms);
+}
+
+
+LYS_API bool FrameCapture::submit(const void *pixels, const Dimension2Di32 &size) {
+    if (pixels == nullptr || size.width() <= 0 || size.height() <= 0)
+        return false;
+    EncodeJob job;
+    if (!pimpl_->prepareJob(&job, size))
+        return false;
+    memcpy(job.pixels.data(), pixels, job.pixels.size());
+    pimpl_->push(&job);
+    return true;
+}
+
+
+LYS_API void FrameCapture::finish() {
+    std::unique_lock<std::mutex> lock(pimpl_->mutex);
+    pimpl_->idle.wait(lock, [this] { return pimpl_->queue.empty() && pimpl_->busy == 0; });
+}
+
+
+LYS_API bool FrameCapture::usesPixelBuffers() const {
+    return pimpl_->pixelBuffers;
+}
+
+
+LYS_API FrameCaptureStats FrameCapture::stats() const {
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    return pimpl_->stats;
+}
+}
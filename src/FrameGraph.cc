@@ -0,0 +1,681 @@
+/***************************************************
+* FrameGraph.cc: Render passes with pooled targets *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "FrameGraph.h"
+
+#include <math.h>
+#include <algorithm>
+#include <unordered_map>
+
+#include "GLES2/gl2.h"
+#include "GLES2/gl2ext.h"
+#include <SDL2/SDL_video.h>
+
+#include "config.h"
+#include "types.h"
+#include "Profiler.h"
+#include "ResourceRegistry.h"
+
+namespace lys3d {
+namespace {
+const uint32_t kNone = 0xFFFFFFFF;
+// Pooled objects unused for this many frames are released
+const uint32_t kIdleFrames = 3;
+
+struct PassEntry {
+    const char *name;
+    // Profiler zone, set by compile()
+    uint32_t zone;
+    FramePassCallback callback;
+    void *userData;
+    Vector<FrameResource> reads;
+    Vector<FrameResource> writes;
+    bool keep;
+    bool culled;
+    uint32_t clearMask;
+    uint32_t discardMask;
+};
+
+struct ResourceEntry {
+    FrameTargetDesc desc;
+    Dimension2Di32 size;
+    uint32_t firstWriter;
+    uint32_t firstUse;
+    uint32_t lastUse;
+    uint32_t slot;
+};
+
+struct PoolSlot {
+    FrameTargetFormat format;
+    Dimension2Di32 size;
+    uint32_t name;
+    uint32_t lastFrame;
+    uint32_t busyUntil;
+};
+
+struct PoolFramebuffer {
+    uint32_t color;
+    uint32_t depth;
+    bool depthTexture;
+    uint32_t name;
+    uint32_t lastFrame;
+    bool complete;
+};
+
+bool isDepth(FrameTargetFormat format) {
+    return format == FrameTargetFormat::kDepth16 || format == FrameTargetFormat::kDepthTexture;
+}
+
+uint64_t bytesPerPixel(FrameTargetFormat format) {
+    return (format == FrameTargetFormat::kRGB565 || format == FrameTargetFormat::kDepth16) ? 2 : 4;
+}
+}
+
+
+struct FrameGraph::Impl {
+    Impl() {
+        frame = 0;
+        bound = 0;
+        clearBackbuffer = false;
+        compiled = false;
+        discardChecked = false;
+        discard = nullptr;
+        Profiler &profiler = Profiler::global();
+        culledCounter = profiler.counter("Frame graph passes culled");
+        bytesCounter = profiler.counter("Frame graph target bytes", false);
+    }
+
+    // Pass names outlive the graph, so their zones are kept by pointer
+    // across frames rather than looked up by string every frame
+    uint32_t zone(const char *name) {
+        auto found = zones.find(name);
+        if (found != zones.end())
+            return found->second;
+        uint32_t id = Profiler::global().zone(name);
+        zones.emplace(name, id);
+        return id;
+    }
+
+    static bool isBackbuffer(FrameResource resource) {
+        return resource == 0;
+    }
+
+    GpuResourceType slotType(const PoolSlot &slot) const {
+        return slot.format == FrameTargetFormat::kDepth16 ? GpuResourceType::kRenderbuffer
+                                                          : GpuResourceType::kTexture;
+    }
+
+    void releaseSlot(PoolSlot *slot) {
+        if (slot->name == 0)
+            return;
+        // Framebuffers using the target go with it
+        bool depth = isDepth(slot->format), depth_texture = (slot->format == FrameTargetFormat::kDepthTexture);
+        size_t kept = 0;
+        for (size_t i = 0; i < framebuffers.size(); ++i) {
+            const PoolFramebuffer &fb = framebuffers[i];
+            bool uses = depth ? (fb.depth == slot->name && fb.depthTexture == depth_texture) : fb.color == slot->name;
+            if (uses)
+                ResourceRegistry::global().release(GpuResourceType::kFramebuffer, fb.name);
+            else
+                framebuffers[kept++] = fb;
+        }
+        framebuffers.resize(kept);
+        ResourceRegistry::global().release(slotType(*slot), slot->name);
+        slot->name = 0;
+    }
+
+    void releaseFramebuffers(uint32_t oldest_frame) {
+        size_t kept = 0;
+        for (size_t i = 0; i < framebuffers.size(); ++i) {
+            if (framebuffers[i].lastFrame < oldest_frame)
+                ResourceRegistry::global().release(GpuResourceType::kFramebuffer, framebuffers[i].name);
+            else
+                framebuffers[kept++] = framebuffers[i];
+        }
+        framebuffers.resize(kept);
+    }
+
+    bool createSlot(PoolSlot *slot) {
+        GLsizei width = slot->size.width(), height = slot->size.height();
+        uint64_t bytes = bytesPerPixel(slot->format) * static_cast<uint64_t>(width) * static_cast<uint64_t>(height);
+        if (slot->format == FrameTargetFormat::kDepth16) {
+            glGenRenderbuffers(1, &slot->name);
+            glBindRenderbuffer(GL_RENDERBUFFER, slot->name);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+            ResourceRegistry::global().track(GpuResourceType::kRenderbuffer, slot->name, bytes);
+            return true;
+        }
+        if (slot->format == FrameTargetFormat::kDepthTexture
+            && SDL_GL_ExtensionSupported("GL_OES_depth_texture") != SDL_TRUE)
+            return false;
+
+        glGenTextures(1, &slot->name);
+        glBindTexture(GL_TEXTURE_2D, slot->name);
+        GLint filter = (slot->format == FrameTargetFormat::kDepthTexture) ? GL_NEAREST : GL_LINEAR;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        switch (slot->format) {
+        case FrameTargetFormat::kRGB565:
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, nullptr);
+            break;
+        case FrameTargetFormat::kDepthTexture:
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT,
+                         GL_UNSIGNED_INT, nullptr);
+            break;
+        default:
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            break;
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        ResourceRegistry::global().track(GpuResourceType::kTexture, slot->name, bytes);
+        return true;
+    }
+
+    // Find or make the framebuffer combining two pooled targets
+    PoolFramebuffer* framebuffer(uint32_t color, uint32_t depth, bool depth_texture) {
+        for (PoolFramebuffer &fb : framebuffers) {
+            if (fb.color == color && fb.depth == depth && fb.depthTexture == depth_texture) {
+                fb.lastFrame = frame;
+                return &fb;
+            }
+        }
+
+        PoolFramebuffer fb;
+        fb.color = color;
+        fb.depth = depth;
+        fb.depthTexture = depth_texture;
+        fb.lastFrame = frame;
+        glGenFramebuffers(1, &fb.name);
+        glBindFramebuffer(GL_FRAMEBUFFER, fb.name);
+        bound = fb.name;
+        if (color != 0)
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+        if (depth != 0 && depth_texture)
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+        else if (depth != 0)
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        fb.complete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+        ResourceRegistry::global().track(GpuResourceType::kFramebuffer, fb.name, 0);
+        framebuffers.push_back(fb);
+        return &framebuffers.back();
+    }
+
+    Dimension2Di32 backbufferSize;
+    Vector<PassEntry> passes;
+    Vector<ResourceEntry> resources;
+    Vector<PoolSlot> slots;
+    Vector<PoolFramebuffer> framebuffers;
+    Vector<uint8_t> needed;
+    std::unordered_map<const char*, uint32_t> zones;
+    FrameGraphStats stats;
+    uint32_t bound;
+    uint32_t frame;
+    bool clearBackbuffer;
+    bool compiled;
+    bool discardChecked;
+    PFN_glDiscardFramebufferEXT discard;
+    uint32_t culledCounter;
+    uint32_t bytesCounter;
+};
+
+
+LYS_API FrameGraph::FrameGraph() {
+    pimpl_ = new Impl();
+    reset(Dimension2Di32(1, 1));
+}
+
+
+LYS_API FrameGraph::~FrameGraph() {
+    this->destroy();
+    delete this->pimpl_;
+}
+
+
+LYS_API void FrameGraph::reset(const Dimension2Di32 &backbuffer_size) {
+    Impl &impl = *pimpl_;
+    ++impl.frame;
+    impl.backbufferSize = backbuffer_size;
+    impl.passes.clear();
+    impl.resources.clear();
+    impl.compiled = false;
+    impl.stats = FrameGraphStats();
+
+    // Resource 0 is the backbuffer
+    ResourceEntry backbuffer;
+    backbuffer.size = backbuffer_size;
+    backbuffer.firstWriter = kNone;
+    backbuffer.firstUse = kNone;
+    backbuffer.lastUse = kNone;
+    backbuffer.slot = kNone;
+    impl.resources.push_back(backbuffer);
+
+    // Drop targets the last few frames didn't need (e.g. after a resize)
+    uint32_t oldest = impl.frame > kIdleFrames ? impl.frame - kIdleFrames : 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < impl.slots.size(); ++i) {
+        if (impl.slots[i].lastFrame < oldest)
+            impl.releaseSlot(&impl.slots[i]);
+        else
+            impl.slots[kept++] = impl.slots[i];
+    }
+    impl.slots.resize(kept);
+    impl.releaseFramebuffers(oldest);
+}
+
+
+LYS_API uint32_t FrameGraph::addPass(const char *name, FramePassCallback callback, void *user_data) {
+    PassEntry pass;
+    pass.name = name;
+    pass.zone = 0;
+    pass.callback = callback;
+    pass.userData = user_data;
+    pass.keep = false;
+    pass.culled = false;
+    pass.clearMask = 0;
+    pass.discardMask = 0;
+    pimpl_->passes.push_back(pass);
+    pimpl_->compiled = false;
+    return static_cast<uint32_t>(pimpl_->passes.size() - 1);
+}
+
+
+LYS_API FrameResource FrameGraph::create(const FrameTargetDesc &desc) {
+    ResourceEntry resource;
+    resource.desc = desc;
+    resource.size = desc.size;
+    if (desc.size.width() <= 0 || desc.size.height() <= 0) {
+        const Dimension2Di32 &back = pimpl_->backbufferSize;
+        resource.size = Dimension2Di32(std::max(1, static_cast<int32_t>(lroundf(back.width() * desc.scale))),
+                                       std::max(1, static_cast<int32_t>(lroundf(back.height() * desc.scale))));
+    }
+    resource.firstWriter = kNone;
+    resource.firstUse = kNone;
+    resource.lastUse = kNone;
+    resource.slot = kNone;
+    pimpl_->resources.push_back(resource);
+    pimpl_->compiled = false;
+    return static_cast<FrameResource>(pimpl_->resources.size() - 1);
+}
+
+
+LYS_API FrameResource FrameGraph::backbuffer() const {
+    return 0;
+}
+
+
+LYS_API bool FrameGraph::clearsBackbuffer() const {
+    return pimpl_->clearBackbuffer;
+}
+
+
+LYS_API void FrameGraph::clearsBackbuffer(bool clear) {
+    pimpl_->clearBackbuffer = clear;
+}
+
+
+LYS_API void FrameGraph::write(uint32_t pass, FrameResource resource) {
+    if (pass >= pimpl_->passes.size() || resource >= pimpl_->resources.size())
+        return;
+    pimpl_->passes[pass].writes.push_back(resource);
+    pimpl_->compiled = false;
+}
+
+
+LYS_API void FrameGraph::read(uint32_t pass, FrameResource resource) {
+    if (pass >= pimpl_->passes.size() || resource >= pimpl_->resources.size())
+        return;
+    pimpl_->passes[pass].reads.push_back(resource);
+    pimpl_->compiled = false;
+}
+
+
+LYS_API void FrameGraph::keep(uint32_t pass) {
+    if (pass < pimpl_->passes.size())
+        pimpl_->passes[pass].keep = true;
+}
+
+
+LYS_API bool FrameGraph::compile() {
+    Impl &impl = *pimpl_;
+    uint32_t pass_count = static_cast<uint32_t>(impl.passes.size());
+    impl.compiled = false;
+
+    // Validate, and note who writes each resource first
+    for (uint32_t p = 0; p < pass_count; ++p) {
+        const PassEntry &pass = impl.passes[p];
+        uint32_t colors = 0, depths = 0;
+        bool backbuffer = false;
+        for (FrameResource r : pass.writes) {
+            if (Impl::isBackbuffer(r))
+                backbuffer = true;
+            else if (isDepth(impl.resources[r].desc.format))
+                ++depths;
+            else
+                ++colors;
+            if (std::find(pass.reads.begin(), pass.reads.end(), r) != pass.reads.end())
+                return false;
+            if (impl.resources[r].firstWriter == kNone)
+                impl.resources[r].firstWriter = p;
+        }
+        if (colors > 1 || depths > 1 || (backbuffer && colors + depths > 0))
+            return false;
+        for (FrameResource r : pass.reads) {
+            if (Impl::isBackbuffer(r) || impl.resources[r].desc.format == FrameTargetFormat::kDepth16)
+                return false;
+        }
+    }
+
+    // Cull from the back: a pass runs if it writes something still needed.
+    // Writing a target keeps what earlier passes wrote into it, so a needed
+    // target stays needed until its first writer.
+    impl.needed.assign(impl.resources.size(), 0);
+    impl.needed[0] = 1;
+    impl.stats.culledPasses = 0;
+    for (uint32_t p = pass_count; p-- > 0;) {
+        PassEntry &pass = impl.passes[p];
+        bool alive = pass.keep;
+        for (FrameResource r : pass.writes)
+            alive = alive || impl.needed[r];
+        pass.culled = !alive;
+        pass.clearMask = 0;
+        pass.discardMask = 0;
+        if (!alive) {
+            ++impl.stats.culledPasses;
+            continue;
+        }
+        for (FrameResource r : pass.writes) {
+            if (impl.resources[r].firstWriter == p)
+                impl.needed[r] = 0;
+        }
+        for (FrameResource r : pass.reads)
+            impl.needed[r] = 1;
+    }
+
+    // Lifetimes over the passes that run
+    uint32_t last_backbuffer_pass = kNone;
+    for (ResourceEntry &resource : impl.resources) {
+        resource.firstUse = kNone;
+        resource.lastUse = kNone;
+        resource.slot = kNone;
+    }
+    for (uint32_t p = 0; p < pass_count; ++p) {
+        PassEntry &pass = impl.passes[p];
+        if (pass.culled)
+            continue;
+        pass.zone = impl.zone(pass.name);
+        for (int access = 0; access < 2; ++access) {
+            for (FrameResource r : access == 0 ? pass.writes : pass.reads) {
+                ResourceEntry &resource = impl.resources[r];
+                if (resource.firstUse == kNone) {
+                    resource.firstUse = p;
+                    // The first writer that runs clears whatever the pool left
+                    if (access == 0 && (!Impl::isBackbuffer(r) || impl.clearBackbuffer)) {
+                        if (Impl::isBackbuffer(r))
+                            pass.clearMask |= kFrameColor | kFrameDepth;
+                        else
+                            pass.clearMask |= isDepth(resource.desc.format) ? kFrameDepth : kFrameColor;
+                    }
+                }
+                resource.lastUse = p;
+            }
+        }
+        for (FrameResource r : pass.writes) {
+            if (Impl::isBackbuffer(r))
+                last_backbuffer_pass = p;
+        }
+    }
+
+    // Dead attachments get discarded; the backbuffer only loses depth and
+    // stencil, after its last pass
+    for (uint32_t p = 0; p < pass_count; ++p) {
+        PassEntry &pass = impl.passes[p];
+        if (pass.culled)
+            continue;
+        for (FrameResource r : pass.writes) {
+            const ResourceEntry &resource = impl.resources[r];
+            if (Impl::isBackbuffer(r)) {
+                if (p == last_backbuffer_pass)
+                    pass.discardMask |= kFrameDepth;
+            } else if (resource.lastUse == p) {
+                pass.discardMask |= isDepth(resource.desc.format) ? kFrameDepth : kFrameColor;
+            }
+        }
+    }
+
+    // Hand out pooled targets in pass order; a slot is free again once the
+    // last pass using its current resource is done
+    for (PoolSlot &slot : impl.slots)
+        slot.busyUntil = kNone;
+    impl.stats.resources = 0;
+    for (uint32_t p = 0; p < pass_count; ++p) {
+        if (impl.passes[p].culled)
+            continue;
+        for (FrameResource r = 1; r < impl.resources.size(); ++r) {
+            ResourceEntry &resource = impl.resources[r];
+            if (resource.firstUse != p)
+                continue;
+            ++impl.stats.resources;
+            uint32_t found = kNone;
+            for (uint32_t s = 0; s < impl.slots.size(); ++s) {
+                const PoolSlot &slot = impl.slots[s];
+                if (slot.format == resource.desc.format && slot.size.width() == resource.size.width()
+                    && slot.size.height() == resource.size.height()
+                    && (slot.busyUntil == kNone || slot.busyUntil < p)) {
+                    found = s;
+                    break;
+                }
+            }
+            if (found == kNone) {
+                PoolSlot slot;
+                slot.format = resource.desc.format;
+                slot.size = resource.size;
+                slot.name = 0;
+                impl.slots.push_back(slot);
+                found = static_cast<uint32_t>(impl.slots.size() - 1);
+            }
+            impl.slots[found].busyUntil = resource.lastUse;
+            impl.slots[found].lastFrame = impl.frame;
+            resource.slot = found;
+        }
+    }
+
+    impl.stats.passes = pass_count;
+    impl.stats.targets = static_cast<uint32_t>(impl.slots.size());
+    impl.stats.targetBytes = 0;
+    for (const PoolSlot &slot : impl.slots) {
+        impl.stats.targetBytes += bytesPerPixel(slot.format) * static_cast<uint64_t>(slot.size.width())
+                                  * static_cast<uint64_t>(slot.size.height());
+    }
+    impl.compiled = true;
+    return true;
+}
+
+
+LYS_API bool FrameGraph::execute() {
+    Impl &impl = *pimpl_;
+    if (!impl.compiled && !compile())
+        return false;
+    if (!impl.discardChecked) {
+        if (SDL_GL_ExtensionSupported("GL_EXT_discard_framebuffer") == SDL_TRUE)
+            impl.discard = (PFN_glDiscardFramebufferEXT)SDL_GL_GetProcAddress("glDiscardFramebufferEXT");
+        impl.discardChecked = true;
+    }
+
+    bool ok = true;
+    for (PoolSlot &slot : impl.slots) {
+        if (slot.name == 0 && slot.lastFrame == impl.frame && !impl.createSlot(&slot))
+            ok = false;
+    }
+
+    Profiler &profiler = Profiler::global();
+    impl.bound = kNone;  // Whatever the caller left bound
+    impl.stats.clears = 0;
+    impl.stats.discards = 0;
+    for (uint32_t p = 0; p < impl.passes.size(); ++p) {
+        const PassEntry &pass = impl.passes[p];
+        if (pass.culled)
+            continue;
+
+        // Work out the pass's framebuffer
+        uint32_t color = 0, depth = 0;
+        bool depth_texture = false, backbuffer = false, missing = false;
+        Dimension2Di32 size = impl.backbufferSize;
+        for (FrameResource r : pass.writes) {
+            if (Impl::isBackbuffer(r)) {
+                backbuffer = true;
+                continue;
+            }
+            const ResourceEntry &resource = impl.resources[r];
+            const PoolSlot &slot = impl.slots[resource.slot];
+            missing = missing || slot.name == 0;
+            size = resource.size;
+            if (isDepth(slot.format)) {
+                depth = slot.name;
+                depth_texture = (slot.format == FrameTargetFormat::kDepthTexture);
+            } else {
+                color = slot.name;
+            }
+        }
+        uint32_t target = 0;
+        if (!backbuffer && !pass.writes.empty()) {
+            PoolFramebuffer *fb = missing ? nullptr : impl.framebuffer(color, depth, depth_texture);
+            if (fb == nullptr || !fb->complete) {
+                ok = false;
+                continue;
+            }
+            target = fb->name;
+        }
+        for (FrameResource r : pass.reads)
+            missing = missing || impl.slots[impl.resources[r].slot].name == 0;
+        if (missing) {
+            ok = false;
+            continue;
+        }
+
+        ProfileScope scope(pass.zone);
+        if (target != impl.bound) {
+            glBindFramebuffer(GL_FRAMEBUFFER, target);
+            impl.bound = target;
+        }
+        glViewport(0, 0, size.width(), size.height());
+
+        if (pass.clearMask != 0) {
+            GLbitfield mask = 0;
+            glDisable(GL_SCISSOR_TEST);
+            if (pass.clearMask & kFrameColor) {
+                const float *clear = nullptr;
+                for (FrameResource r : pass.writes) {
+                    if (!Impl::isBackbuffer(r) && !isDepth(impl.resources[r].desc.format))
+                        clear = impl.resources[r].desc.clearColor;
+                }
+                if (clear != nullptr)
+                    glClearColor(clear[0], clear[1], clear[2], clear[3]);
+                else
+                    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                mask |= GL_COLOR_BUFFER_BIT;
+            }
+            if (pass.clearMask & kFrameDepth) {
+                glDepthMask(GL_TRUE);
+                glClearDepthf(1.0f);
+                mask |= GL_DEPTH_BUFFER_BIT;
+                if (backbuffer)
+                    mask |= GL_STENCIL_BUFFER_BIT;
+            }
+            glClear(mask);
+            ++impl.stats.clears;
+        }
+
+        if (pass.callback != nullptr)
+            pass.callback(*this, pass.userData);
+
+        if (pass.discardMask != 0 && impl.discard != nullptr) {
+            GLenum attachments[2];
+            GLsizei count = 0;
+            if (backbuffer) {
+                attachments[count++] = GL_DEPTH_EXT;
+                attachments[count++] = GL_STENCIL_EXT;
+            } else {
+                if (pass.discardMask & kFrameColor)
+                    attachments[count++] = GL_COLOR_ATTACHMENT0;
+                if (pass.discardMask & kFrameDepth)
+                    attachments[count++] = GL_DEPTH_ATTACHMENT;
+            }
+            impl.discard(GL_FRAMEBUFFER, count, attachments);
+            impl.stats.discards += static_cast<uint32_t>(count);
+        }
+    }
+
+    // Hand the backbuffer back to WindowGLES2::update()
+    if (impl.bound != 0)
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, impl.backbufferSize.width(), impl.backbufferSize.height());
+
+    profiler.count(impl.culledCounter, impl.stats.culledPasses);
+    profiler.set(impl.bytesCounter, static_cast<int64_t>(impl.stats.targetBytes));
+    return ok;
+}
+
+
+LYS_API void FrameGraph::destroy() {
+    for (PoolSlot &slot : pimpl_->slots)
+        pimpl_->releaseSlot(&slot);
+    pimpl_->slots.clear();
+    pimpl_->releaseFramebuffers(0xFFFFFFFF);
+    pimpl_->compiled = false;
+    pimpl_->discardChecked = false;
+    pimpl_->discard = nullptr;
+}
+
+
+LYS_API bool FrameGraph::isCulled(uint32_t pass) const {
+    return pass >= pimpl_->passes.size() || pimpl_->passes[pass].culled;
+}
+
+
+LYS_API uint32_t FrameGraph::clearMask(uint32_t pass) const {
+    return pass < pimpl_->passes.size() ? pimpl_->passes[pass].clearMask : 0;
+}
+
+
+LYS_API uint32_t FrameGraph::discardMask(uint32_t pass) const {
+    return pass < pimpl_->passes.size() ? pimpl_->passes[pass].discardMask : 0;
+}
+
+
+LYS_API uint32_t FrameGraph::slot(FrameResource resource) const {
+    return resource < pimpl_->resources.size() ? pimpl_->resources[resource].slot : kNone;
+}
+
+
+LYS_API Dimension2Di32 FrameGraph::size(FrameResource resource) const {
+    if (resource >= pimpl_->resources.size())
+        return Dimension2Di32();
+    return pimpl_->resources[resource].size;
+}
+
+
+LYS_API uint32_t FrameGraph::texture(FrameResource resource) const {
+    if (resource == 0 || resource >= pimpl_->resources.size())
+        return 0;
+    uint32_t slot = pimpl_->resources[resource].slot;
+    if (slot == kNone || pimpl_->slots[slot].format == FrameTargetFormat::kDepth16)
+        return 0;
+    return pimpl_->slots[slot].name;
+}
+
+
+LYS_API const FrameGraphStats& FrameGraph::stats() const {
+    return pimpl_->stats;
+}
+}
@@ -0,0 +1,302 @@
+/***************************************************
+* FrameLoop.cc: Fixed-timestep main loop driver    *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "FrameLoop.h"
+
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "types.h"
+#include "Profiler.h"
+
+namespace lys3d {
+namespace {
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+float milliseconds(int64_t start, int64_t end) {
+    return (end - start) / 1.0e6f;
+}
+}
+
+
+LYS_API InterpolatedTransform::InterpolatedTransform() {
+    const float identity[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    reset(Point3Df(), identity);
+}
+
+
+LYS_API void InterpolatedTransform::update(const Point3Df &position, const float *orientation) {
+    previousPosition_ = position_;
+    position_ = position;
+    std::copy(orientation_, orientation_ + 4, previousOrientation_);
+    std::copy(orientation, orientation + 4, orientation_);
+}
+
+
+LYS_API void InterpolatedTransform::reset(const Point3Df &position, const float *orientation) {
+    previousPosition_ = position_ = position;
+    std::copy(orientation, orientation + 4, previousOrientation_);
+    std::copy(orientation, orientation + 4, orientation_);
+}
+
+
+LYS_API Point3Df InterpolatedTransform::position(float alpha) const {
+    return previousPosition_ + (position_ - previousPosition_) * alpha;
+}
+
+
+LYS_API void InterpolatedTransform::matrix(float alpha, float *matrix) const {
+    // Normalized lerp; steps are short enough that it's as good as a slerp
+    float q[4], length = 0.0f;
+    float sign = 0.0f;
+    for (int i = 0; i < 4; ++i)
+        sign += previousOrientation_[i] * orientation_[i];
+    sign = sign < 0.0f ? -1.0f : 1.0f;
+    for (int i = 0; i < 4; ++i) {
+        q[i] = previousOrientation_[i] + (sign * orientation_[i] - previousOrientation_[i]) * alpha;
+        length += q[i] * q[i];
+    }
+    float scale = length > 0.0f ? 1.0f / sqrtf(length) : 0.0f;
+    float x = q[0] * scale, y = q[1] * scale, z = q[2] * scale, w = q[3] * scale;
+    float xx = x * x, yy = y * y, zz = z * z;
+    float xy = x * y, xz = x * z, yz = y * z;
+    float wx = w * x, wy = w * y, wz = w * z;
+    const float rotation[16] = {1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f,
+                                2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f,
+                                2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f,
+                                0.0f, 0.0f, 0.0f, 1.0f};
+    std::copy(rotation, rotation + 16, matrix);
+    Point3Df p = position(alpha);
+    matrix[12] = p.x();
+    matrix[13] = p.y();
+    matrix[14] = p.z();
+}
+
+
+struct FrameLoop::Impl {
+    explicit Impl(const FrameLoopSettings &new_settings) {
+        settings = new_settings;
+        settings.stepSeconds = std::max(settings.stepSeconds, 1.0e-6);
+        settings.maxSteps = std::max(settings.maxSteps, 1u);
+        accumulator = 0.0;
+        lastTime = -1;
+        steps = 0;
+        pendingAlpha = 0.0f;
+        jobSteps = 0;
+        jobMs = 0.0f;
+        busy = false;
+        quit = false;
+        stepCounter = Profiler::global().counter("Simulation steps");
+        if (settings.threaded)
+            thread = std::thread(&Impl::threadMain, this);
+    }
+
+    ~Impl() {
+        if (!thread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+
+    void runSteps(const FrameLoopCallbacks &callbacks, uint32_t count) {
+        if (!callbacks.step || count == 0)
+            return;
+        LYS_PROFILE_ZONE("Frame steps");
+        for (uint32_t i = 0; i < count; ++i)
+            callbacks.step(settings.stepSeconds, callbacks.userData);
+    }
+
+    void threadMain() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return quit || busy; });
+            if (quit)
+                return;
+            lock.unlock();
+            int64_t start = now();
+            runSteps(job, jobSteps);
+            float ms = milliseconds(start, now());
+            lock.lock();
+            jobMs = ms;
+            busy = false;
+            done.notify_all();
+        }
+    }
+
+    // Blocks until the steps running on the thread are done
+    void wait() {
+        if (!thread.joinable())
+            return;
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return !busy; });
+    }
+
+    bool frame(const FrameLoopCallbacks &callbacks, double seconds) {
+        int64_t start = now();
+        stats = FrameLoopStats();
+        if (callbacks.input) {
+            LYS_PROFILE_ZONE("Frame input");
+            bool running = callbacks.input(callbacks.userData);
+            stats.inputMs = milliseconds(start, now());
+            if (!running)
+                return false;
+        }
+
+        // Whole steps are run and the rest carried over; past maxSteps the
+        // time is dropped rather than owed. Rounding error shouldn't leave
+        // a step a hair short of due
+        accumulator += std::max(seconds, 0.0);
+        double due = floor(accumulator / settings.stepSeconds + 1.0e-9);
+        uint32_t count = settings.maxSteps;
+        if (due <= settings.maxSteps)
+            count = static_cast<uint32_t>(due);
+        else
+            stats.droppedSteps = static_cast<uint32_t>(std::min(due - settings.maxSteps, 4294967295.0));
+        accumulator = std::max(accumulator - due * settings.stepSeconds, 0.0);
+        float alpha = std::min(static_cast<float>(accumulator / settings.stepSeconds), 1.0f);
+        stats.steps = count;
+        steps += count;
+        Profiler::global().count(stepCounter, count);
+
+        // Threaded, this frame renders what the last frame's steps made,
+        // and its own steps run meanwhile
+        int64_t phase = now();
+        if (thread.joinable()) {
+            wait();
+            stats.waitMs = milliseconds(phase, now());
+            stats.stepMs = jobMs;
+        } else {
+            runSteps(callbacks, count);
+            stats.stepMs = milliseconds(phase, now());
+        }
+        phase = now();
+        if (callbacks.sync) {
+            LYS_PROFILE_ZONE("Frame sync");
+            callbacks.sync(callbacks.userData);
+        }
+        stats.syncMs = milliseconds(phase, now());
+        if (thread.joinable()) {
+            std::swap(alpha, pendingAlpha);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job = callbacks;
+                jobSteps = count;
+                busy = true;
+            }
+            wake.notify_all();
+        }
+        stats.alpha = alpha;
+
+        phase = now();
+        if (callbacks.render) {
+            LYS_PROFILE_ZONE("Frame render");
+            callbacks.render(alpha, callbacks.userData);
+        }
+        stats.renderMs = milliseconds(phase, now());
+        phase = now();
+        bool running = true;
+        if (callbacks.present) {
+            LYS_PROFILE_ZONE("Frame present");
+            running = callbacks.present(callbacks.userData);
+        }
+        int64_t end = now();
+        stats.presentMs = milliseconds(phase, end);
+        stats.frameMs = milliseconds(start, end);
+        return running;
+    }
+
+    FrameLoopSettings settings;
+    FrameLoopStats stats;
+    // Time not yet simulated, always less than a step between frames
+    double accumulator;
+    int64_t lastTime;
+    uint64_t steps;
+    // The alpha of the steps running on the thread, for the frame after
+    float pendingAlpha;
+    uint32_t stepCounter;
+
+    // Shared with the simulation thread
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    FrameLoopCallbacks job;
+    uint32_t jobSteps;
+    float jobMs;
+    bool busy;
+    bool quit;
+};
+
+
+LYS_API FrameLoop::FrameLoop(const FrameLoopSettings &settings) {
+    pimpl_ = new Impl(settings);
+}
+
+
+LYS_API FrameLoop::~FrameLoop() {
+    pimpl_->wait();
+    delete pimpl_;
+}
+
+
+LYS_API const FrameLoopSettings& FrameLoop::settings() const {
+    return pimpl_->settings;
+}
+
+
+LYS_API bool FrameLoop::frame(const FrameLoopCallbacks &callbacks) {
+    Impl &impl = *pimpl_;
+    int64_t time = now();
+    double seconds = impl.lastTime < 0 ? 0.0 : (time - impl.lastTime) / 1.0e9;
+    impl.lastTime = time;
+    return impl.frame(callbacks, seconds);
+}
+
+
+LYS_API bool FrameLoop::frame(const FrameLoopCallbacks &callbacks, double seconds) {
+    return pimpl_->frame(callbacks, seconds);
+}
+
+
+LYS_API void FrameLoop::run(const FrameLoopCallbacks &callbacks) {
+    while (frame(callbacks)) {}
+    pimpl_->wait();
+}
+
+
+LYS_API void FrameLoop::reset() {
+    Impl &impl = *pimpl_;
+    impl.wait();
+    impl.accumulator = 0.0;
+    impl.lastTime = -1;
+    impl.pendingAlpha = 0.0f;
+}
+
+
+LYS_API uint64_t FrameLoop::stepCount() const {
+    return pimpl_->steps;
+}
+
+
+LYS_API const FrameLoopStats& FrameLoop::stats() const {
+    return pimpl_->stats;
+}
+}
@@ -5,12 +5,37 @@
 #include "gl2.h"
 
 #include <SDL2/SDL_video.h>
+#ifdef LYS_DEBUG
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <SDL2/SDL_log.h>
+#endif
 
 /* The main change here is to not use Galogen's default proc-loading code;
- * instead, simply use SDL for all of our function-pointer needs.
- * Also see resetGLPointers() at the end of the file.
+ * instead, simply use SDL for all of our function-pointer needs, unless
+ * setGLProcLoader() was given something else.
+ * Also see resetGLPointers() and loadGLPointers() at the end of the file,
+ * and the checked wrappers of the debug layer after them.
  */
-#define GalogenGetProcAddress SDL_GL_GetProcAddress
+#define GalogenGetProcAddress getGLProc
+
+static GLProcLoader glProcLoader = NULL;
+
+/* ISO C has no conversion between object and function pointers, so the
+ * address SDL hands back as a void pointer is read out through a union
+ * instead; the cast from there to each PFN_ type is function to function.
+ */
+static GLProc getGLProc(const char *name) {
+    union {
+        void *object;
+        GLProc function;
+    } address;
+    if (glProcLoader != NULL)
+        return glProcLoader(name);
+    address.object = SDL_GL_GetProcAddress(name);
+    return address.function;
+}
 
 static void  GL_APIENTRY _impl_glVertexAttribPointer (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void * pointer) {
   _glptr_glVertexAttribPointer = (PFN_glVertexAttribPointer)GalogenGetProcAddress("glVertexAttribPointer");
@@ -865,8 +890,20 @@ static void  GL_APIENTRY _impl_glBindTexture (GLenum target, GLuint texture) {
 PFN_glBindTexture _glptr_glBindTexture = _impl_glBindTexture;
 
 
+/* Layers that wrap the function pointers (see addGLResetCallback()) get to
+ * reinstall themselves whenever the pointers are reset.
+ */
+#define MAX_RESET_CALLBACKS 8
+static struct {
+    GLResetCallback callback;
+    void *userData;
+} resetCallbacks[MAX_RESET_CALLBACKS];
+static int resetCallbackCount = 0;
+
+
 /** Custom function to reset all GL function pointers, e.g. after changing contexts */
 void resetGLPointers() {
+    int i;
     _glptr_glVertexAttribPointer = _impl_glVertexAttribPointer;
     _glptr_glVertexAttrib3fv = _impl_glVertexAttrib3fv;
     _glptr_glVertexAttrib3f = _impl_glVertexAttrib3f;
@@ -1009,4 +1046,2057 @@ void resetGLPointers() {
     _glptr_glBlendColor = _impl_glBlendColor;
     _glptr_glUniform2f = _impl_glUniform2f;
     _glptr_glBindTexture = _impl_glBindTexture;
+
+    for (i = 0; i < resetCallbackCount; ++i)
+        resetCallbacks[i].callback(resetCallbacks[i].userData);
+}
+
+
+/** Custom function to resolve the function pointers with another loader */
+void setGLProcLoader(GLProcLoader loader) {
+    glProcLoader = loader;
+}
+
+
+/** Custom function to resolve every GL function pointer that is still lazy */
+void loadGLPointers() {
+    if (_glptr_glVertexAttribPointer == _impl_glVertexAttribPointer)
+        _glptr_glVertexAttribPointer = (PFN_glVertexAttribPointer)getGLProc("glVertexAttribPointer");
+    if (_glptr_glVertexAttrib3fv == _impl_glVertexAttrib3fv)
+        _glptr_glVertexAttrib3fv = (PFN_glVertexAttrib3fv)getGLProc("glVertexAttrib3fv");
+    if (_glptr_glVertexAttrib3f == _impl_glVertexAttrib3f)
+        _glptr_glVertexAttrib3f = (PFN_glVertexAttrib3f)getGLProc("glVertexAttrib3f");
+    if (_glptr_glVertexAttrib2fv == _impl_glVertexAttrib2fv)
+        _glptr_glVertexAttrib2fv = (PFN_glVertexAttrib2fv)getGLProc("glVertexAttrib2fv");
+    if (_glptr_glVertexAttrib1fv == _impl_glVertexAttrib1fv)
+        _glptr_glVertexAttrib1fv = (PFN_glVertexAttrib1fv)getGLProc("glVertexAttrib1fv");
+    if (_glptr_glValidateProgram == _impl_glValidateProgram)
+        _glptr_glValidateProgram = (PFN_glValidateProgram)getGLProc("glValidateProgram");
+    if (_glptr_glUseProgram == _impl_glUseProgram)
+        _glptr_glUseProgram = (PFN_glUseProgram)getGLProc("glUseProgram");
+    if (_glptr_glUniformMatrix4fv == _impl_glUniformMatrix4fv)
+        _glptr_glUniformMatrix4fv = (PFN_glUniformMatrix4fv)getGLProc("glUniformMatrix4fv");
+    if (_glptr_glUniformMatrix3fv == _impl_glUniformMatrix3fv)
+        _glptr_glUniformMatrix3fv = (PFN_glUniformMatrix3fv)getGLProc("glUniformMatrix3fv");
+    if (_glptr_glUniformMatrix2fv == _impl_glUniformMatrix2fv)
+        _glptr_glUniformMatrix2fv = (PFN_glUniformMatrix2fv)getGLProc("glUniformMatrix2fv");
+    if (_glptr_glUniform4fv == _impl_glUniform4fv)
+        _glptr_glUniform4fv = (PFN_glUniform4fv)getGLProc("glUniform4fv");
+    if (_glptr_glUniform3iv == _impl_glUniform3iv)
+        _glptr_glUniform3iv = (PFN_glUniform3iv)getGLProc("glUniform3iv");
+    if (_glptr_glUniform3fv == _impl_glUniform3fv)
+        _glptr_glUniform3fv = (PFN_glUniform3fv)getGLProc("glUniform3fv");
+    if (_glptr_glUniform2fv == _impl_glUniform2fv)
+        _glptr_glUniform2fv = (PFN_glUniform2fv)getGLProc("glUniform2fv");
+    if (_glptr_glUniform1iv == _impl_glUniform1iv)
+        _glptr_glUniform1iv = (PFN_glUniform1iv)getGLProc("glUniform1iv");
+    if (_glptr_glUniform1i == _impl_glUniform1i)
+        _glptr_glUniform1i = (PFN_glUniform1i)getGLProc("glUniform1i");
+    if (_glptr_glUniform1fv == _impl_glUniform1fv)
+        _glptr_glUniform1fv = (PFN_glUniform1fv)getGLProc("glUniform1fv");
+    if (_glptr_glTexSubImage2D == _impl_glTexSubImage2D)
+        _glptr_glTexSubImage2D = (PFN_glTexSubImage2D)getGLProc("glTexSubImage2D");
+    if (_glptr_glTexParameteri == _impl_glTexParameteri)
+        _glptr_glTexParameteri = (PFN_glTexParameteri)getGLProc("glTexParameteri");
+    if (_glptr_glUniform3f == _impl_glUniform3f)
+        _glptr_glUniform3f = (PFN_glUniform3f)getGLProc("glUniform3f");
+    if (_glptr_glTexParameterf == _impl_glTexParameterf)
+        _glptr_glTexParameterf = (PFN_glTexParameterf)getGLProc("glTexParameterf");
+    if (_glptr_glStencilOpSeparate == _impl_glStencilOpSeparate)
+        _glptr_glStencilOpSeparate = (PFN_glStencilOpSeparate)getGLProc("glStencilOpSeparate");
+    if (_glptr_glStencilMask == _impl_glStencilMask)
+        _glptr_glStencilMask = (PFN_glStencilMask)getGLProc("glStencilMask");
+    if (_glptr_glStencilFunc == _impl_glStencilFunc)
+        _glptr_glStencilFunc = (PFN_glStencilFunc)getGLProc("glStencilFunc");
+    if (_glptr_glShaderSource == _impl_glShaderSource)
+        _glptr_glShaderSource = (PFN_glShaderSource)getGLProc("glShaderSource");
+    if (_glptr_glUniform1f == _impl_glUniform1f)
+        _glptr_glUniform1f = (PFN_glUniform1f)getGLProc("glUniform1f");
+    if (_glptr_glShaderBinary == _impl_glShaderBinary)
+        _glptr_glShaderBinary = (PFN_glShaderBinary)getGLProc("glShaderBinary");
+    if (_glptr_glHint == _impl_glHint)
+        _glptr_glHint = (PFN_glHint)getGLProc("glHint");
+    if (_glptr_glScissor == _impl_glScissor)
+        _glptr_glScissor = (PFN_glScissor)getGLProc("glScissor");
+    if (_glptr_glGetBufferParameteriv == _impl_glGetBufferParameteriv)
+        _glptr_glGetBufferParameteriv = (PFN_glGetBufferParameteriv)getGLProc("glGetBufferParameteriv");
+    if (_glptr_glRenderbufferStorage == _impl_glRenderbufferStorage)
+        _glptr_glRenderbufferStorage = (PFN_glRenderbufferStorage)getGLProc("glRenderbufferStorage");
+    if (_glptr_glReadPixels == _impl_glReadPixels)
+        _glptr_glReadPixels = (PFN_glReadPixels)getGLProc("glReadPixels");
+    if (_glptr_glPixelStorei == _impl_glPixelStorei)
+        _glptr_glPixelStorei = (PFN_glPixelStorei)getGLProc("glPixelStorei");
+    if (_glptr_glDeleteTextures == _impl_glDeleteTextures)
+        _glptr_glDeleteTextures = (PFN_glDeleteTextures)getGLProc("glDeleteTextures");
+    if (_glptr_glIsBuffer == _impl_glIsBuffer)
+        _glptr_glIsBuffer = (PFN_glIsBuffer)getGLProc("glIsBuffer");
+    if (_glptr_glLineWidth == _impl_glLineWidth)
+        _glptr_glLineWidth = (PFN_glLineWidth)getGLProc("glLineWidth");
+    if (_glptr_glIsEnabled == _impl_glIsEnabled)
+        _glptr_glIsEnabled = (PFN_glIsEnabled)getGLProc("glIsEnabled");
+    if (_glptr_glGetVertexAttribiv == _impl_glGetVertexAttribiv)
+        _glptr_glGetVertexAttribiv = (PFN_glGetVertexAttribiv)getGLProc("glGetVertexAttribiv");
+    if (_glptr_glGetUniformLocation == _impl_glGetUniformLocation)
+        _glptr_glGetUniformLocation = (PFN_glGetUniformLocation)getGLProc("glGetUniformLocation");
+    if (_glptr_glGetTexParameteriv == _impl_glGetTexParameteriv)
+        _glptr_glGetTexParameteriv = (PFN_glGetTexParameteriv)getGLProc("glGetTexParameteriv");
+    if (_glptr_glGetVertexAttribPointerv == _impl_glGetVertexAttribPointerv)
+        _glptr_glGetVertexAttribPointerv = (PFN_glGetVertexAttribPointerv)getGLProc("glGetVertexAttribPointerv");
+    if (_glptr_glViewport == _impl_glViewport)
+        _glptr_glViewport = (PFN_glViewport)getGLProc("glViewport");
+    if (_glptr_glGetTexParameterfv == _impl_glGetTexParameterfv)
+        _glptr_glGetTexParameterfv = (PFN_glGetTexParameterfv)getGLProc("glGetTexParameterfv");
+    if (_glptr_glIsTexture == _impl_glIsTexture)
+        _glptr_glIsTexture = (PFN_glIsTexture)getGLProc("glIsTexture");
+    if (_glptr_glGetString == _impl_glGetString)
+        _glptr_glGetString = (PFN_glGetString)getGLProc("glGetString");
+    if (_glptr_glCopyTexImage2D == _impl_glCopyTexImage2D)
+        _glptr_glCopyTexImage2D = (PFN_glCopyTexImage2D)getGLProc("glCopyTexImage2D");
+    if (_glptr_glIsProgram == _impl_glIsProgram)
+        _glptr_glIsProgram = (PFN_glIsProgram)getGLProc("glIsProgram");
+    if (_glptr_glVertexAttrib4fv == _impl_glVertexAttrib4fv)
+        _glptr_glVertexAttrib4fv = (PFN_glVertexAttrib4fv)getGLProc("glVertexAttrib4fv");
+    if (_glptr_glGetUniformiv == _impl_glGetUniformiv)
+        _glptr_glGetUniformiv = (PFN_glGetUniformiv)getGLProc("glGetUniformiv");
+    if (_glptr_glUniform3i == _impl_glUniform3i)
+        _glptr_glUniform3i = (PFN_glUniform3i)getGLProc("glUniform3i");
+    if (_glptr_glGetShaderPrecisionFormat == _impl_glGetShaderPrecisionFormat)
+        _glptr_glGetShaderPrecisionFormat = (PFN_glGetShaderPrecisionFormat)getGLProc("glGetShaderPrecisionFormat");
+    if (_glptr_glGetShaderiv == _impl_glGetShaderiv)
+        _glptr_glGetShaderiv = (PFN_glGetShaderiv)getGLProc("glGetShaderiv");
+    if (_glptr_glGetRenderbufferParameteriv == _impl_glGetRenderbufferParameteriv)
+        _glptr_glGetRenderbufferParameteriv = (PFN_glGetRenderbufferParameteriv)getGLProc("glGetRenderbufferParameteriv");
+    if (_glptr_glGetProgramiv == _impl_glGetProgramiv)
+        _glptr_glGetProgramiv = (PFN_glGetProgramiv)getGLProc("glGetProgramiv");
+    if (_glptr_glGetIntegerv == _impl_glGetIntegerv)
+        _glptr_glGetIntegerv = (PFN_glGetIntegerv)getGLProc("glGetIntegerv");
+    if (_glptr_glGetFloatv == _impl_glGetFloatv)
+        _glptr_glGetFloatv = (PFN_glGetFloatv)getGLProc("glGetFloatv");
+    if (_glptr_glUniform2i == _impl_glUniform2i)
+        _glptr_glUniform2i = (PFN_glUniform2i)getGLProc("glUniform2i");
+    if (_glptr_glGetError == _impl_glGetError)
+        _glptr_glGetError = (PFN_glGetError)getGLProc("glGetError");
+    if (_glptr_glGetBooleanv == _impl_glGetBooleanv)
+        _glptr_glGetBooleanv = (PFN_glGetBooleanv)getGLProc("glGetBooleanv");
+    if (_glptr_glVertexAttrib4f == _impl_glVertexAttrib4f)
+        _glptr_glVertexAttrib4f = (PFN_glVertexAttrib4f)getGLProc("glVertexAttrib4f");
+    if (_glptr_glGetAttribLocation == _impl_glGetAttribLocation)
+        _glptr_glGetAttribLocation = (PFN_glGetAttribLocation)getGLProc("glGetAttribLocation");
+    if (_glptr_glGetActiveUniform == _impl_glGetActiveUniform)
+        _glptr_glGetActiveUniform = (PFN_glGetActiveUniform)getGLProc("glGetActiveUniform");
+    if (_glptr_glTexParameteriv == _impl_glTexParameteriv)
+        _glptr_glTexParameteriv = (PFN_glTexParameteriv)getGLProc("glTexParameteriv");
+    if (_glptr_glGetActiveAttrib == _impl_glGetActiveAttrib)
+        _glptr_glGetActiveAttrib = (PFN_glGetActiveAttrib)getGLProc("glGetActiveAttrib");
+    if (_glptr_glStencilMaskSeparate == _impl_glStencilMaskSeparate)
+        _glptr_glStencilMaskSeparate = (PFN_glStencilMaskSeparate)getGLProc("glStencilMaskSeparate");
+    if (_glptr_glGenRenderbuffers == _impl_glGenRenderbuffers)
+        _glptr_glGenRenderbuffers = (PFN_glGenRenderbuffers)getGLProc("glGenRenderbuffers");
+    if (_glptr_glCompressedTexSubImage2D == _impl_glCompressedTexSubImage2D)
+        _glptr_glCompressedTexSubImage2D = (PFN_glCompressedTexSubImage2D)getGLProc("glCompressedTexSubImage2D");
+    if (_glptr_glGetProgramInfoLog == _impl_glGetProgramInfoLog)
+        _glptr_glGetProgramInfoLog = (PFN_glGetProgramInfoLog)getGLProc("glGetProgramInfoLog");
+    if (_glptr_glDeleteShader == _impl_glDeleteShader)
+        _glptr_glDeleteShader = (PFN_glDeleteShader)getGLProc("glDeleteShader");
+    if (_glptr_glGenBuffers == _impl_glGenBuffers)
+        _glptr_glGenBuffers = (PFN_glGenBuffers)getGLProc("glGenBuffers");
+    if (_glptr_glSampleCoverage == _impl_glSampleCoverage)
+        _glptr_glSampleCoverage = (PFN_glSampleCoverage)getGLProc("glSampleCoverage");
+    if (_glptr_glGenTextures == _impl_glGenTextures)
+        _glptr_glGenTextures = (PFN_glGenTextures)getGLProc("glGenTextures");
+    if (_glptr_glGetVertexAttribfv == _impl_glGetVertexAttribfv)
+        _glptr_glGetVertexAttribfv = (PFN_glGetVertexAttribfv)getGLProc("glGetVertexAttribfv");
+    if (_glptr_glUniform4iv == _impl_glUniform4iv)
+        _glptr_glUniform4iv = (PFN_glUniform4iv)getGLProc("glUniform4iv");
+    if (_glptr_glFrontFace == _impl_glFrontFace)
+        _glptr_glFrontFace = (PFN_glFrontFace)getGLProc("glFrontFace");
+    if (_glptr_glUniform2iv == _impl_glUniform2iv)
+        _glptr_glUniform2iv = (PFN_glUniform2iv)getGLProc("glUniform2iv");
+    if (_glptr_glIsShader == _impl_glIsShader)
+        _glptr_glIsShader = (PFN_glIsShader)getGLProc("glIsShader");
+    if (_glptr_glBindFramebuffer == _impl_glBindFramebuffer)
+        _glptr_glBindFramebuffer = (PFN_glBindFramebuffer)getGLProc("glBindFramebuffer");
+    if (_glptr_glFramebufferTexture2D == _impl_glFramebufferTexture2D)
+        _glptr_glFramebufferTexture2D = (PFN_glFramebufferTexture2D)getGLProc("glFramebufferTexture2D");
+    if (_glptr_glUniform4i == _impl_glUniform4i)
+        _glptr_glUniform4i = (PFN_glUniform4i)getGLProc("glUniform4i");
+    if (_glptr_glClearStencil == _impl_glClearStencil)
+        _glptr_glClearStencil = (PFN_glClearStencil)getGLProc("glClearStencil");
+    if (_glptr_glDeleteRenderbuffers == _impl_glDeleteRenderbuffers)
+        _glptr_glDeleteRenderbuffers = (PFN_glDeleteRenderbuffers)getGLProc("glDeleteRenderbuffers");
+    if (_glptr_glFinish == _impl_glFinish)
+        _glptr_glFinish = (PFN_glFinish)getGLProc("glFinish");
+    if (_glptr_glBlendFuncSeparate == _impl_glBlendFuncSeparate)
+        _glptr_glBlendFuncSeparate = (PFN_glBlendFuncSeparate)getGLProc("glBlendFuncSeparate");
+    if (_glptr_glBindAttribLocation == _impl_glBindAttribLocation)
+        _glptr_glBindAttribLocation = (PFN_glBindAttribLocation)getGLProc("glBindAttribLocation");
+    if (_glptr_glClear == _impl_glClear)
+        _glptr_glClear = (PFN_glClear)getGLProc("glClear");
+    if (_glptr_glEnableVertexAttribArray == _impl_glEnableVertexAttribArray)
+        _glptr_glEnableVertexAttribArray = (PFN_glEnableVertexAttribArray)getGLProc("glEnableVertexAttribArray");
+    if (_glptr_glStencilFuncSeparate == _impl_glStencilFuncSeparate)
+        _glptr_glStencilFuncSeparate = (PFN_glStencilFuncSeparate)getGLProc("glStencilFuncSeparate");
+    if (_glptr_glPolygonOffset == _impl_glPolygonOffset)
+        _glptr_glPolygonOffset = (PFN_glPolygonOffset)getGLProc("glPolygonOffset");
+    if (_glptr_glDisable == _impl_glDisable)
+        _glptr_glDisable = (PFN_glDisable)getGLProc("glDisable");
+    if (_glptr_glDetachShader == _impl_glDetachShader)
+        _glptr_glDetachShader = (PFN_glDetachShader)getGLProc("glDetachShader");
+    if (_glptr_glReleaseShaderCompiler == _impl_glReleaseShaderCompiler)
+        _glptr_glReleaseShaderCompiler = (PFN_glReleaseShaderCompiler)getGLProc("glReleaseShaderCompiler");
+    if (_glptr_glCompressedTexImage2D == _impl_glCompressedTexImage2D)
+        _glptr_glCompressedTexImage2D = (PFN_glCompressedTexImage2D)getGLProc("glCompressedTexImage2D");
+    if (_glptr_glBindRenderbuffer == _impl_glBindRenderbuffer)
+        _glptr_glBindRenderbuffer = (PFN_glBindRenderbuffer)getGLProc("glBindRenderbuffer");
+    if (_glptr_glDepthMask == _impl_glDepthMask)
+        _glptr_glDepthMask = (PFN_glDepthMask)getGLProc("glDepthMask");
+    if (_glptr_glIsFramebuffer == _impl_glIsFramebuffer)
+        _glptr_glIsFramebuffer = (PFN_glIsFramebuffer)getGLProc("glIsFramebuffer");
+    if (_glptr_glGetUniformfv == _impl_glGetUniformfv)
+        _glptr_glGetUniformfv = (PFN_glGetUniformfv)getGLProc("glGetUniformfv");
+    if (_glptr_glUniform4f == _impl_glUniform4f)
+        _glptr_glUniform4f = (PFN_glUniform4f)getGLProc("glUniform4f");
+    if (_glptr_glAttachShader == _impl_glAttachShader)
+        _glptr_glAttachShader = (PFN_glAttachShader)getGLProc("glAttachShader");
+    if (_glptr_glFramebufferRenderbuffer == _impl_glFramebufferRenderbuffer)
+        _glptr_glFramebufferRenderbuffer = (PFN_glFramebufferRenderbuffer)getGLProc("glFramebufferRenderbuffer");
+    if (_glptr_glStencilOp == _impl_glStencilOp)
+        _glptr_glStencilOp = (PFN_glStencilOp)getGLProc("glStencilOp");
+    if (_glptr_glDisableVertexAttribArray == _impl_glDisableVertexAttribArray)
+        _glptr_glDisableVertexAttribArray = (PFN_glDisableVertexAttribArray)getGLProc("glDisableVertexAttribArray");
+    if (_glptr_glIsRenderbuffer == _impl_glIsRenderbuffer)
+        _glptr_glIsRenderbuffer = (PFN_glIsRenderbuffer)getGLProc("glIsRenderbuffer");
+    if (_glptr_glDeleteProgram == _impl_glDeleteProgram)
+        _glptr_glDeleteProgram = (PFN_glDeleteProgram)getGLProc("glDeleteProgram");
+    if (_glptr_glDrawArrays == _impl_glDrawArrays)
+        _glptr_glDrawArrays = (PFN_glDrawArrays)getGLProc("glDrawArrays");
+    if (_glptr_glBlendEquationSeparate == _impl_glBlendEquationSeparate)
+        _glptr_glBlendEquationSeparate = (PFN_glBlendEquationSeparate)getGLProc("glBlendEquationSeparate");
+    if (_glptr_glCompileShader == _impl_glCompileShader)
+        _glptr_glCompileShader = (PFN_glCompileShader)getGLProc("glCompileShader");
+    if (_glptr_glVertexAttrib1f == _impl_glVertexAttrib1f)
+        _glptr_glVertexAttrib1f = (PFN_glVertexAttrib1f)getGLProc("glVertexAttrib1f");
+    if (_glptr_glDeleteFramebuffers == _impl_glDeleteFramebuffers)
+        _glptr_glDeleteFramebuffers = (PFN_glDeleteFramebuffers)getGLProc("glDeleteFramebuffers");
+    if (_glptr_glDeleteBuffers == _impl_glDeleteBuffers)
+        _glptr_glDeleteBuffers = (PFN_glDeleteBuffers)getGLProc("glDeleteBuffers");
+    if (_glptr_glTexParameterfv == _impl_glTexParameterfv)
+        _glptr_glTexParameterfv = (PFN_glTexParameterfv)getGLProc("glTexParameterfv");
+    if (_glptr_glLinkProgram == _impl_glLinkProgram)
+        _glptr_glLinkProgram = (PFN_glLinkProgram)getGLProc("glLinkProgram");
+    if (_glptr_glGenerateMipmap == _impl_glGenerateMipmap)
+        _glptr_glGenerateMipmap = (PFN_glGenerateMipmap)getGLProc("glGenerateMipmap");
+    if (_glptr_glCullFace == _impl_glCullFace)
+        _glptr_glCullFace = (PFN_glCullFace)getGLProc("glCullFace");
+    if (_glptr_glVertexAttrib2f == _impl_glVertexAttrib2f)
+        _glptr_glVertexAttrib2f = (PFN_glVertexAttrib2f)getGLProc("glVertexAttrib2f");
+    if (_glptr_glTexImage2D == _impl_glTexImage2D)
+        _glptr_glTexImage2D = (PFN_glTexImage2D)getGLProc("glTexImage2D");
+    if (_glptr_glDrawElements == _impl_glDrawElements)
+        _glptr_glDrawElements = (PFN_glDrawElements)getGLProc("glDrawElements");
+    if (_glptr_glGenFramebuffers == _impl_glGenFramebuffers)
+        _glptr_glGenFramebuffers = (PFN_glGenFramebuffers)getGLProc("glGenFramebuffers");
+    if (_glptr_glCreateShader == _impl_glCreateShader)
+        _glptr_glCreateShader = (PFN_glCreateShader)getGLProc("glCreateShader");
+    if (_glptr_glGetFramebufferAttachmentParameteriv == _impl_glGetFramebufferAttachmentParameteriv)
+        _glptr_glGetFramebufferAttachmentParameteriv = (PFN_glGetFramebufferAttachmentParameteriv)getGLProc("glGetFramebufferAttachmentParameteriv");
+    if (_glptr_glClearColor == _impl_glClearColor)
+        _glptr_glClearColor = (PFN_glClearColor)getGLProc("glClearColor");
+    if (_glptr_glCreateProgram == _impl_glCreateProgram)
+        _glptr_glCreateProgram = (PFN_glCreateProgram)getGLProc("glCreateProgram");
+    if (_glptr_glClearDepthf == _impl_glClearDepthf)
+        _glptr_glClearDepthf = (PFN_glClearDepthf)getGLProc("glClearDepthf");
+    if (_glptr_glBlendFunc == _impl_glBlendFunc)
+        _glptr_glBlendFunc = (PFN_glBlendFunc)getGLProc("glBlendFunc");
+    if (_glptr_glBindBuffer == _impl_glBindBuffer)
+        _glptr_glBindBuffer = (PFN_glBindBuffer)getGLProc("glBindBuffer");
+    if (_glptr_glGetShaderInfoLog == _impl_glGetShaderInfoLog)
+        _glptr_glGetShaderInfoLog = (PFN_glGetShaderInfoLog)getGLProc("glGetShaderInfoLog");
+    if (_glptr_glCheckFramebufferStatus == _impl_glCheckFramebufferStatus)
+        _glptr_glCheckFramebufferStatus = (PFN_glCheckFramebufferStatus)getGLProc("glCheckFramebufferStatus");
+    if (_glptr_glBufferSubData == _impl_glBufferSubData)
+        _glptr_glBufferSubData = (PFN_glBufferSubData)getGLProc("glBufferSubData");
+    if (_glptr_glActiveTexture == _impl_glActiveTexture)
+        _glptr_glActiveTexture = (PFN_glActiveTexture)getGLProc("glActiveTexture");
+    if (_glptr_glColorMask == _impl_glColorMask)
+        _glptr_glColorMask = (PFN_glColorMask)getGLProc("glColorMask");
+    if (_glptr_glBufferData == _impl_glBufferData)
+        _glptr_glBufferData = (PFN_glBufferData)getGLProc("glBufferData");
+    if (_glptr_glDepthFunc == _impl_glDepthFunc)
+        _glptr_glDepthFunc = (PFN_glDepthFunc)getGLProc("glDepthFunc");
+    if (_glptr_glFlush == _impl_glFlush)
+        _glptr_glFlush = (PFN_glFlush)getGLProc("glFlush");
+    if (_glptr_glCopyTexSubImage2D == _impl_glCopyTexSubImage2D)
+        _glptr_glCopyTexSubImage2D = (PFN_glCopyTexSubImage2D)getGLProc("glCopyTexSubImage2D");
+    if (_glptr_glGetAttachedShaders == _impl_glGetAttachedShaders)
+        _glptr_glGetAttachedShaders = (PFN_glGetAttachedShaders)getGLProc("glGetAttachedShaders");
+    if (_glptr_glDepthRangef == _impl_glDepthRangef)
+        _glptr_glDepthRangef = (PFN_glDepthRangef)getGLProc("glDepthRangef");
+    if (_glptr_glBlendEquation == _impl_glBlendEquation)
+        _glptr_glBlendEquation = (PFN_glBlendEquation)getGLProc("glBlendEquation");
+    if (_glptr_glGetShaderSource == _impl_glGetShaderSource)
+        _glptr_glGetShaderSource = (PFN_glGetShaderSource)getGLProc("glGetShaderSource");
+    if (_glptr_glEnable == _impl_glEnable)
+        _glptr_glEnable = (PFN_glEnable)getGLProc("glEnable");
+    if (_glptr_glBlendColor == _impl_glBlendColor)
+        _glptr_glBlendColor = (PFN_glBlendColor)getGLProc("glBlendColor");
+    if (_glptr_glUniform2f == _impl_glUniform2f)
+        _glptr_glUniform2f = (PFN_glUniform2f)getGLProc("glUniform2f");
+    if (_glptr_glBindTexture == _impl_glBindTexture)
+        _glptr_glBindTexture = (PFN_glBindTexture)getGLProc("glBindTexture");
+}
+
+
+int addGLResetCallback(GLResetCallback callback, void *user_data) {
+    if (resetCallbackCount == MAX_RESET_CALLBACKS)
+        return 0;
+    resetCallbacks[resetCallbackCount].callback = callback;
+    resetCallbacks[resetCallbackCount].userData = user_data;
+    ++resetCallbackCount;
+    return 1;
+}
+
+
+void removeGLResetCallback(GLResetCallback callback, void *user_data) {
+    int i, j;
+    for (i = 0; i < resetCallbackCount; ++i) {
+        if (resetCallbacks[i].callback == callback && resetCallbacks[i].userData == user_data) {
+            for (j = i + 1; j < resetCallbackCount; ++j)
+                resetCallbacks[j - 1] = resetCallbacks[j];
+            --resetCallbackCount;
+            return;
+        }
+    }
+}
+
+
+/* Custom debug layer, in LYS_DEBUG builds only: checked wrappers for every
+ * function pointer, installed over them by enableGLChecks().
+ */
+#ifdef LYS_DEBUG
+LYS_GL_THREAD_LOCAL GLCallSite _glCallSite;
+
+/* Errors drained after a single call, at most */
+#define MAX_ERRORS_PER_CALL 8
+/* Texture units whose bindings are tracked */
+#define MAX_TRACKED_UNITS 32
+/* Call sites of slow paths that are tracked across frames */
+#define MAX_TRACKED_SITES 256
+/* Frames a call site must make a slow path in before it is logged */
+#define HOT_SITE_FRAMES 3
+/* Binding or capability not known yet, e.g. right after installing */
+#define UNKNOWN_BINDING 0xFFFFFFFFu
+#define UNKNOWN_CAPABILITY 2
+
+static int glChecksInstalled = 0;
+/* The thread that enabled the layer, told apart by the address of its copy
+ * of glThreadMarker. Only its calls are tracked, since the bindings and
+ * slow path counts describe its context; errors are logged from any thread.
+ */
+static LYS_GL_THREAD_LOCAL char glThreadMarker;
+static const char *glChecksThread = NULL;
+static GLSlowPathCounts slowPathCounts;
+static unsigned int slowPathFrame = 0;
+
+/* What the wrapped context has bound, to spot redundant binds */
+static struct {
+    GLuint buffers[2];
+    GLuint textures[MAX_TRACKED_UNITS * 2];
+    GLuint framebuffer;
+    GLuint renderbuffer;
+    GLuint program;
+    GLuint unit;
+    unsigned char capabilities[9];
+} glState;
+
+static struct {
+    GLCallSite site;
+    unsigned int lastFrame;
+    unsigned int frames;
+} slowSites[MAX_TRACKED_SITES];
+static int slowSiteCount = 0;
+
+/* checkGLCall() needs it before the wrappers */
+static PFN_glGetError _real_glGetError;
+
+static int onGLChecksThread(void) {
+    return glChecksThread == &glThreadMarker;
+}
+
+static void forgetGLState(void) {
+    unsigned int i;
+    glState.buffers[0] = glState.buffers[1] = UNKNOWN_BINDING;
+    for (i = 0; i < MAX_TRACKED_UNITS * 2; ++i)
+        glState.textures[i] = UNKNOWN_BINDING;
+    glState.framebuffer = glState.renderbuffer = glState.program = UNKNOWN_BINDING;
+    glState.unit = 0;
+    for (i = 0; i < sizeof(glState.capabilities); ++i)
+        glState.capabilities[i] = UNKNOWN_CAPABILITY;
+}
+
+static const char *glErrorName(GLenum error) {
+    switch (error) {
+    case GL_INVALID_ENUM:
+        return "GL_INVALID_ENUM";
+    case GL_INVALID_VALUE:
+        return "GL_INVALID_VALUE";
+    case GL_INVALID_OPERATION:
+        return "GL_INVALID_OPERATION";
+    case GL_INVALID_FRAMEBUFFER_OPERATION:
+        return "GL_INVALID_FRAMEBUFFER_OPERATION";
+    case GL_OUT_OF_MEMORY:
+        return "GL_OUT_OF_MEMORY";
+    default:
+        return "an unknown error";
+    }
+}
+
+/* Logs every error the call raised, then forgets the call site so calls
+ * that don't go through the gl* macros aren't blamed on it.
+ */
+static void checkGLCall(const char *call, const char *format, ...) {
+    GLenum error = _real_glGetError();
+    int reported = 0;
+    char args[256];
+    va_list list;
+    while (error != GL_NO_ERROR && reported < MAX_ERRORS_PER_CALL) {
+        if (reported == 0) {
+            va_start(list, format);
+            vsnprintf(args, sizeof(args), format, list);
+            va_end(list);
+            if (onGLChecksThread())
+                ++slowPathCounts.errors;
+        }
+        SDL_LogError(SDL_LOG_CATEGORY_RENDER, "%s:%d: %s(%s) raised %s",
+                     _glCallSite.file != NULL ? _glCallSite.file : "(unknown)", _glCallSite.line, call, args,
+                     glErrorName(error));
+        ++reported;
+        error = _real_glGetError();
+    }
+    _glCallSite.file = NULL;
+}
+
+/* Logs a call site once it has made a slow path in a few frames, as one in
+ * the render loop would, rather than only while loading.
+ */
+static void noteGLSlowPath(const char *call, const char *what) {
+    int i;
+    if (_glCallSite.file == NULL)
+        return;
+    for (i = 0; i < slowSiteCount; ++i) {
+        if (slowSites[i].site.line == _glCallSite.line && slowSites[i].site.file == _glCallSite.file)
+            break;
+    }
+    if (i == slowSiteCount) {
+        if (slowSiteCount == MAX_TRACKED_SITES)
+            return;
+        slowSites[i].site = _glCallSite;
+        slowSites[i].lastFrame = slowPathFrame - 1;
+        slowSites[i].frames = 0;
+        ++slowSiteCount;
+    }
+    if (slowSites[i].lastFrame == slowPathFrame)
+        return;
+    slowSites[i].lastFrame = slowPathFrame;
+    if (++slowSites[i].frames == HOT_SITE_FRAMES)
+        SDL_LogWarn(SDL_LOG_CATEGORY_RENDER, "%s:%d: %s %s, frame after frame", _glCallSite.file, _glCallSite.line,
+                    call, what);
+}
+
+static void countGLQuery(const char *call) {
+    if (!onGLChecksThread())
+        return;
+    ++slowPathCounts.queries;
+    noteGLSlowPath(call, "waits on the driver");
+}
+
+static GLuint *glBufferBinding(GLenum target) {
+    switch (target) {
+    case GL_ARRAY_BUFFER:
+        return &glState.buffers[0];
+    case GL_ELEMENT_ARRAY_BUFFER:
+        return &glState.buffers[1];
+    default:
+        return NULL;
+    }
+}
+
+static GLuint *glTextureBinding(GLenum target) {
+    if (glState.unit >= MAX_TRACKED_UNITS)
+        return NULL;
+    switch (target) {
+    case GL_TEXTURE_2D:
+        return &glState.textures[glState.unit * 2];
+    case GL_TEXTURE_CUBE_MAP:
+        return &glState.textures[glState.unit * 2 + 1];
+    default:
+        return NULL;
+    }
+}
+
+static void noteGLBind(const char *call, GLuint *binding, GLuint name) {
+    if (binding == NULL || !onGLChecksThread())
+        return;
+    if (*binding == name) {
+        ++slowPathCounts.redundantBinds;
+        noteGLSlowPath(call, "binds what is already bound");
+    }
+    *binding = name;
+}
+
+/* Deleted objects are unbound from the context */
+static void forgetGLNames(GLuint *bindings, int count, GLsizei n, const GLuint *names) {
+    int i, j;
+    if (names == NULL || !onGLChecksThread())
+        return;
+    for (i = 0; i < n; ++i) {
+        for (j = 0; j < count; ++j) {
+            if (names[i] != 0 && bindings[j] == names[i])
+                bindings[j] = 0;
+        }
+    }
+}
+
+static void noteGLCapability(const char *call, GLenum cap, unsigned char enable) {
+    static const GLenum capabilities[9] = {
+        GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST, GL_DITHER, GL_POLYGON_OFFSET_FILL,
+        GL_SAMPLE_ALPHA_TO_COVERAGE, GL_SAMPLE_COVERAGE, GL_SCISSOR_TEST, GL_STENCIL_TEST
+    };
+    int i;
+    if (!onGLChecksThread())
+        return;
+    for (i = 0; i < 9; ++i) {
+        if (capabilities[i] != cap)
+            continue;
+        if (glState.capabilities[i] == enable) {
+            ++slowPathCounts.redundantStates;
+            noteGLSlowPath(call, "sets what is already set");
+        }
+        glState.capabilities[i] = enable;
+        return;
+    }
+}
+
+static PFN_glVertexAttribPointer _real_glVertexAttribPointer;
+static void  GL_APIENTRY _check_glVertexAttribPointer (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void * pointer) {
+  _real_glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+  checkGLCall("glVertexAttribPointer", "%u, %d, 0x%X, %u, %d, %p", index, size, type, (unsigned int)normalized, stride, (const void *)pointer);
+}
+
+static PFN_glVertexAttrib3fv _real_glVertexAttrib3fv;
+static void  GL_APIENTRY _check_glVertexAttrib3fv (GLuint index, const GLfloat * v) {
+  _real_glVertexAttrib3fv(index, v);
+  checkGLCall("glVertexAttrib3fv", "%u, %p", index, (const void *)v);
+}
+
+static PFN_glVertexAttrib3f _real_glVertexAttrib3f;
+static void  GL_APIENTRY _check_glVertexAttrib3f (GLuint index, GLfloat x, GLfloat y, GLfloat z) {
+  _real_glVertexAttrib3f(index, x, y, z);
+  checkGLCall("glVertexAttrib3f", "%u, %g, %g, %g", index, (double)x, (double)y, (double)z);
+}
+
+static PFN_glVertexAttrib2fv _real_glVertexAttrib2fv;
+static void  GL_APIENTRY _check_glVertexAttrib2fv (GLuint index, const GLfloat * v) {
+  _real_glVertexAttrib2fv(index, v);
+  checkGLCall("glVertexAttrib2fv", "%u, %p", index, (const void *)v);
+}
+
+static PFN_glVertexAttrib1fv _real_glVertexAttrib1fv;
+static void  GL_APIENTRY _check_glVertexAttrib1fv (GLuint index, const GLfloat * v) {
+  _real_glVertexAttrib1fv(index, v);
+  checkGLCall("glVertexAttrib1fv", "%u, %p", index, (const void *)v);
+}
+
+static PFN_glValidateProgram _real_glValidateProgram;
+static void  GL_APIENTRY _check_glValidateProgram (GLuint program) {
+  _real_glValidateProgram(program);
+  checkGLCall("glValidateProgram", "%u", program);
+}
+
+static PFN_glUseProgram _real_glUseProgram;
+static void  GL_APIENTRY _check_glUseProgram (GLuint program) {
+  noteGLBind("glUseProgram", &glState.program, program);
+  _real_glUseProgram(program);
+  checkGLCall("glUseProgram", "%u", program);
+}
+
+static PFN_glUniformMatrix4fv _real_glUniformMatrix4fv;
+static void  GL_APIENTRY _check_glUniformMatrix4fv (GLint location, GLsizei count, GLboolean transpose, const GLfloat * value) {
+  _real_glUniformMatrix4fv(location, count, transpose, value);
+  checkGLCall("glUniformMatrix4fv", "%d, %d, %u, %p", location, count, (unsigned int)transpose, (const void *)value);
+}
+
+static PFN_glUniformMatrix3fv _real_glUniformMatrix3fv;
+static void  GL_APIENTRY _check_glUniformMatrix3fv (GLint location, GLsizei count, GLboolean transpose, const GLfloat * value) {
+  _real_glUniformMatrix3fv(location, count, transpose, value);
+  checkGLCall("glUniformMatrix3fv", "%d, %d, %u, %p", location, count, (unsigned int)transpose, (const void *)value);
+}
+
+static PFN_glUniformMatrix2fv _real_glUniformMatrix2fv;
+static void  GL_APIENTRY _check_glUniformMatrix2fv (GLint location, GLsizei count, GLboolean transpose, const GLfloat * value) {
+  _real_glUniformMatrix2fv(location, count, transpose, value);
+  checkGLCall("glUniformMatrix2fv", "%d, %d, %u, %p", location, count, (unsigned int)transpose, (const void *)value);
+}
+
+static PFN_glUniform4fv _real_glUniform4fv;
+static void  GL_APIENTRY _check_glUniform4fv (GLint location, GLsizei count, const GLfloat * value) {
+  _real_glUniform4fv(location, count, value);
+  checkGLCall("glUniform4fv", "%d, %d, %p", location, count, (const void *)value);
+}
+
+static PFN_glUniform3iv _real_glUniform3iv;
+static void  GL_APIENTRY _check_glUniform3iv (GLint location, GLsizei count, const GLint * value) {
+  _real_glUniform3iv(location, count, value);
+  checkGLCall("glUniform3iv", "%d, %d, %p", location, count, (const void *)value);
+}
+
+static PFN_glUniform3fv _real_glUniform3fv;
+static void  GL_APIENTRY _check_glUniform3fv (GLint location, GLsizei count, const GLfloat * value) {
+  _real_glUniform3fv(location, count, value);
+  checkGLCall("glUniform3fv", "%d, %d, %p", location, count, (const void *)value);
+}
+
+static PFN_glUniform2fv _real_glUniform2fv;
+static void  GL_APIENTRY _check_glUniform2fv (GLint location, GLsizei count, const GLfloat * value) {
+  _real_glUniform2fv(location, count, value);
+  checkGLCall("glUniform2fv", "%d, %d, %p", location, count, (const void *)value);
+}
+
+static PFN_glUniform1iv _real_glUniform1iv;
+static void  GL_APIENTRY _check_glUniform1iv (GLint location, GLsizei count, const GLint * value) {
+  _real_glUniform1iv(location, count, value);
+  checkGLCall("glUniform1iv", "%d, %d, %p", location, count, (const void *)value);
+}
+
+static PFN_glUniform1i _real_glUniform1i;
+static void  GL_APIENTRY _check_glUniform1i (GLint location, GLint v0) {
+  _real_glUniform1i(location, v0);
+  checkGLCall("glUniform1i", "%d, %d", location, v0);
+}
+
+static PFN_glUniform1fv _real_glUniform1fv;
+static void  GL_APIENTRY _check_glUniform1fv (GLint location, GLsizei count, const GLfloat * value) {
+  _real_glUniform1fv(location, count, value);
+  checkGLCall("glUniform1fv", "%d, %d, %p", location, count, (const void *)value);
+}
+
+static PFN_glTexSubImage2D _real_glTexSubImage2D;
+static void  GL_APIENTRY _check_glTexSubImage2D (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void * pixels) {
+  _real_glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+  checkGLCall("glTexSubImage2D", "0x%X, %d, %d, %d, %d, %d, 0x%X, 0x%X, %p", target, level, xoffset, yoffset, width, height, format, type, (const void *)pixels);
+}
+
+static PFN_glTexParameteri _real_glTexParameteri;
+static void  GL_APIENTRY _check_glTexParameteri (GLenum target, GLenum pname, GLint param) {
+  _real_glTexParameteri(target, pname, param);
+  checkGLCall("glTexParameteri", "0x%X, 0x%X, %d", target, pname, param);
+}
+
+static PFN_glUniform3f _real_glUniform3f;
+static void  GL_APIENTRY _check_glUniform3f (GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+  _real_glUniform3f(location, v0, v1, v2);
+  checkGLCall("glUniform3f", "%d, %g, %g, %g", location, (double)v0, (double)v1, (double)v2);
+}
+
+static PFN_glTexParameterf _real_glTexParameterf;
+static void  GL_APIENTRY _check_glTexParameterf (GLenum target, GLenum pname, GLfloat param) {
+  _real_glTexParameterf(target, pname, param);
+  checkGLCall("glTexParameterf", "0x%X, 0x%X, %g", target, pname, (double)param);
+}
+
+static PFN_glStencilOpSeparate _real_glStencilOpSeparate;
+static void  GL_APIENTRY _check_glStencilOpSeparate (GLenum face, GLenum sfail, GLenum dpfail, GLenum dppass) {
+  _real_glStencilOpSeparate(face, sfail, dpfail, dppass);
+  checkGLCall("glStencilOpSeparate", "0x%X, 0x%X, 0x%X, 0x%X", face, sfail, dpfail, dppass);
+}
+
+static PFN_glStencilMask _real_glStencilMask;
+static void  GL_APIENTRY _check_glStencilMask (GLuint mask) {
+  _real_glStencilMask(mask);
+  checkGLCall("glStencilMask", "%u", mask);
+}
+
+static PFN_glStencilFunc _real_glStencilFunc;
+static void  GL_APIENTRY _check_glStencilFunc (GLenum func, GLint ref, GLuint mask) {
+  _real_glStencilFunc(func, ref, mask);
+  checkGLCall("glStencilFunc", "0x%X, %d, %u", func, ref, mask);
+}
+
+static PFN_glShaderSource _real_glShaderSource;
+static void  GL_APIENTRY _check_glShaderSource (GLuint shader, GLsizei count, const GLchar *const* string, const GLint * length) {
+  _real_glShaderSource(shader, count, string, length);
+  checkGLCall("glShaderSource", "%u, %d, %p, %p", shader, count, (const void *)string, (const void *)length);
+}
+
+static PFN_glUniform1f _real_glUniform1f;
+static void  GL_APIENTRY _check_glUniform1f (GLint location, GLfloat v0) {
+  _real_glUniform1f(location, v0);
+  checkGLCall("glUniform1f", "%d, %g", location, (double)v0);
+}
+
+static PFN_glShaderBinary _real_glShaderBinary;
+static void  GL_APIENTRY _check_glShaderBinary (GLsizei count, const GLuint * shaders, GLenum binaryformat, const void * binary, GLsizei length) {
+  _real_glShaderBinary(count, shaders, binaryformat, binary, length);
+  checkGLCall("glShaderBinary", "%d, %p, 0x%X, %p, %d", count, (const void *)shaders, binaryformat, (const void *)binary, length);
+}
+
+static PFN_glHint _real_glHint;
+static void  GL_APIENTRY _check_glHint (GLenum target, GLenum mode) {
+  _real_glHint(target, mode);
+  checkGLCall("glHint", "0x%X, 0x%X", target, mode);
+}
+
+static PFN_glScissor _real_glScissor;
+static void  GL_APIENTRY _check_glScissor (GLint x, GLint y, GLsizei width, GLsizei height) {
+  _real_glScissor(x, y, width, height);
+  checkGLCall("glScissor", "%d, %d, %d, %d", x, y, width, height);
+}
+
+static PFN_glGetBufferParameteriv _real_glGetBufferParameteriv;
+static void  GL_APIENTRY _check_glGetBufferParameteriv (GLenum target, GLenum pname, GLint * params) {
+  countGLQuery("glGetBufferParameteriv");
+  _real_glGetBufferParameteriv(target, pname, params);
+  checkGLCall("glGetBufferParameteriv", "0x%X, 0x%X, %p", target, pname, (const void *)params);
+}
+
+static PFN_glRenderbufferStorage _real_glRenderbufferStorage;
+static void  GL_APIENTRY _check_glRenderbufferStorage (GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+  _real_glRenderbufferStorage(target, internalformat, width, height);
+  checkGLCall("glRenderbufferStorage", "0x%X, 0x%X, %d, %d", target, internalformat, width, height);
+}
+
+static PFN_glReadPixels _real_glReadPixels;
+static void  GL_APIENTRY _check_glReadPixels (GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void * pixels) {
+  countGLQuery("glReadPixels");
+  _real_glReadPixels(x, y, width, height, format, type, pixels);
+  checkGLCall("glReadPixels", "%d, %d, %d, %d, 0x%X, 0x%X, %p", x, y, width, height, format, type, (const void *)pixels);
+}
+
+static PFN_glPixelStorei _real_glPixelStorei;
+static void  GL_APIENTRY _check_glPixelStorei (GLenum pname, GLint param) {
+  _real_glPixelStorei(pname, param);
+  checkGLCall("glPixelStorei", "0x%X, %d", pname, param);
+}
+
+static PFN_glDeleteTextures _real_glDeleteTextures;
+static void  GL_APIENTRY _check_glDeleteTextures (GLsizei n, const GLuint * textures) {
+  forgetGLNames(glState.textures, MAX_TRACKED_UNITS * 2, n, textures);
+  _real_glDeleteTextures(n, textures);
+  checkGLCall("glDeleteTextures", "%d, %p", n, (const void *)textures);
+}
+
+static PFN_glIsBuffer _real_glIsBuffer;
+static GLboolean GL_APIENTRY _check_glIsBuffer (GLuint buffer) {
+  countGLQuery("glIsBuffer");
+  GLboolean result = _real_glIsBuffer(buffer);
+  checkGLCall("glIsBuffer", "%u", buffer);
+  return result;
+}
+
+static PFN_glLineWidth _real_glLineWidth;
+static void  GL_APIENTRY _check_glLineWidth (GLfloat width) {
+  _real_glLineWidth(width);
+  checkGLCall("glLineWidth", "%g", (double)width);
+}
+
+static PFN_glIsEnabled _real_glIsEnabled;
+static GLboolean GL_APIENTRY _check_glIsEnabled (GLenum cap) {
+  countGLQuery("glIsEnabled");
+  GLboolean result = _real_glIsEnabled(cap);
+  checkGLCall("glIsEnabled", "0x%X", cap);
+  return result;
+}
+
+static PFN_glGetVertexAttribiv _real_glGetVertexAttribiv;
+static void  GL_APIENTRY _check_glGetVertexAttribiv (GLuint index, GLenum pname, GLint * params) {
+  countGLQuery("glGetVertexAttribiv");
+  _real_glGetVertexAttribiv(index, pname, params);
+  checkGLCall("glGetVertexAttribiv", "%u, 0x%X, %p", index, pname, (const void *)params);
+}
+
+static PFN_glGetUniformLocation _real_glGetUniformLocation;
+static GLint GL_APIENTRY _check_glGetUniformLocation (GLuint program, const GLchar * name) {
+  countGLQuery("glGetUniformLocation");
+  GLint result = _real_glGetUniformLocation(program, name);
+  checkGLCall("glGetUniformLocation", "%u, %p", program, (const void *)name);
+  return result;
+}
+
+static PFN_glGetTexParameteriv _real_glGetTexParameteriv;
+static void  GL_APIENTRY _check_glGetTexParameteriv (GLenum target, GLenum pname, GLint * params) {
+  countGLQuery("glGetTexParameteriv");
+  _real_glGetTexParameteriv(target, pname, params);
+  checkGLCall("glGetTexParameteriv", "0x%X, 0x%X, %p", target, pname, (const void *)params);
+}
+
+static PFN_glGetVertexAttribPointerv _real_glGetVertexAttribPointerv;
+static void  GL_APIENTRY _check_glGetVertexAttribPointerv (GLuint index, GLenum pname, void ** pointer) {
+  countGLQuery("glGetVertexAttribPointerv");
+  _real_glGetVertexAttribPointerv(index, pname, pointer);
+  checkGLCall("glGetVertexAttribPointerv", "%u, 0x%X, %p", index, pname, (const void *)pointer);
+}
+
+static PFN_glViewport _real_glViewport;
+static void  GL_APIENTRY _check_glViewport (GLint x, GLint y, GLsizei width, GLsizei height) {
+  _real_glViewport(x, y, width, height);
+  checkGLCall("glViewport", "%d, %d, %d, %d", x, y, width, height);
+}
+
+static PFN_glGetTexParameterfv _real_glGetTexParameterfv;
+static void  GL_APIENTRY _check_glGetTexParameterfv (GLenum target, GLenum pname, GLfloat * params) {
+  countGLQuery("glGetTexParameterfv");
+  _real_glGetTexParameterfv(target, pname, params);
+  checkGLCall("glGetTexParameterfv", "0x%X, 0x%X, %p", target, pname, (const void *)params);
+}
+
+static PFN_glIsTexture _real_glIsTexture;
+static GLboolean GL_APIENTRY _check_glIsTexture (GLuint texture) {
+  countGLQuery("glIsTexture");
+  GLboolean result = _real_glIsTexture(texture);
+  checkGLCall("glIsTexture", "%u", texture);
+  return result;
+}
+
+static PFN_glGetString _real_glGetString;
+static const GLubyte * GL_APIENTRY _check_glGetString (GLenum name) {
+  countGLQuery("glGetString");
+  const GLubyte * result = _real_glGetString(name);
+  checkGLCall("glGetString", "0x%X", name);
+  return result;
+}
+
+static PFN_glCopyTexImage2D _real_glCopyTexImage2D;
+static void  GL_APIENTRY _check_glCopyTexImage2D (GLenum target, GLint level, GLenum internalformat, GLint x, GLint y, GLsizei width, GLsizei height, GLint border) {
+  _real_glCopyTexImage2D(target, level, internalformat, x, y, width, height, border);
+  checkGLCall("glCopyTexImage2D", "0x%X, %d, 0x%X, %d, %d, %d, %d, %d", target, level, internalformat, x, y, width, height, border);
+}
+
+static PFN_glIsProgram _real_glIsProgram;
+static GLboolean GL_APIENTRY _check_glIsProgram (GLuint program) {
+  countGLQuery("glIsProgram");
+  GLboolean result = _real_glIsProgram(program);
+  checkGLCall("glIsProgram", "%u", program);
+  return result;
+}
+
+static PFN_glVertexAttrib4fv _real_glVertexAttrib4fv;
+static void  GL_APIENTRY _check_glVertexAttrib4fv (GLuint index, const GLfloat * v) {
+  _real_glVertexAttrib4fv(index, v);
+  checkGLCall("glVertexAttrib4fv", "%u, %p", index, (const void *)v);
+}
+
+static PFN_glGetUniformiv _real_glGetUniformiv;
+static void  GL_APIENTRY _check_glGetUniformiv (GLuint program, GLint location, GLint * params) {
+  countGLQuery("glGetUniformiv");
+  _real_glGetUniformiv(program, location, params);
+  checkGLCall("glGetUniformiv", "%u, %d, %p", program, location, (const void *)params);
+}
+
+static PFN_glUniform3i _real_glUniform3i;
+static void  GL_APIENTRY _check_glUniform3i (GLint location, GLint v0, GLint v1, GLint v2) {
+  _real_glUniform3i(location, v0, v1, v2);
+  checkGLCall("glUniform3i", "%d, %d, %d, %d", location, v0, v1, v2);
+}
+
+static PFN_glGetShaderPrecisionFormat _real_glGetShaderPrecisionFormat;
+static void  GL_APIENTRY _check_glGetShaderPrecisionFormat (GLenum shadertype, GLenum precisiontype, GLint * range, GLint * precision) {
+  countGLQuery("glGetShaderPrecisionFormat");
+  _real_glGetShaderPrecisionFormat(shadertype, precisiontype, range, precision);
+  checkGLCall("glGetShaderPrecisionFormat", "0x%X, 0x%X, %p, %p", shadertype, precisiontype, (const void *)range, (const void *)precision);
+}
+
+static PFN_glGetShaderiv _real_glGetShaderiv;
+static void  GL_APIENTRY _check_glGetShaderiv (GLuint shader, GLenum pname, GLint * params) {
+  countGLQuery("glGetShaderiv");
+  _real_glGetShaderiv(shader, pname, params);
+  checkGLCall("glGetShaderiv", "%u, 0x%X, %p", shader, pname, (const void *)params);
+}
+
+static PFN_glGetRenderbufferParameteriv _real_glGetRenderbufferParameteriv;
+static void  GL_APIENTRY _check_glGetRenderbufferParameteriv (GLenum target, GLenum pname, GLint * params) {
+  countGLQuery("glGetRenderbufferParameteriv");
+  _real_glGetRenderbufferParameteriv(target, pname, params);
+  checkGLCall("glGetRenderbufferParameteriv", "0x%X, 0x%X, %p", target, pname, (const void *)params);
+}
+
+static PFN_glGetProgramiv _real_glGetProgramiv;
+static void  GL_APIENTRY _check_glGetProgramiv (GLuint program, GLenum pname, GLint * params) {
+  countGLQuery("glGetProgramiv");
+  _real_glGetProgramiv(program, pname, params);
+  checkGLCall("glGetProgramiv", "%u, 0x%X, %p", program, pname, (const void *)params);
+}
+
+static PFN_glGetIntegerv _real_glGetIntegerv;
+static void  GL_APIENTRY _check_glGetIntegerv (GLenum pname, GLint * data) {
+  countGLQuery("glGetIntegerv");
+  _real_glGetIntegerv(pname, data);
+  checkGLCall("glGetIntegerv", "0x%X, %p", pname, (const void *)data);
+}
+
+static PFN_glGetFloatv _real_glGetFloatv;
+static void  GL_APIENTRY _check_glGetFloatv (GLenum pname, GLfloat * data) {
+  countGLQuery("glGetFloatv");
+  _real_glGetFloatv(pname, data);
+  checkGLCall("glGetFloatv", "0x%X, %p", pname, (const void *)data);
+}
+
+static PFN_glUniform2i _real_glUniform2i;
+static void  GL_APIENTRY _check_glUniform2i (GLint location, GLint v0, GLint v1) {
+  _real_glUniform2i(location, v0, v1);
+  checkGLCall("glUniform2i", "%d, %d, %d", location, v0, v1);
+}
+
+static GLenum GL_APIENTRY _check_glGetError () {
+  countGLQuery("glGetError");
+  GLenum result = _real_glGetError();
+  _glCallSite.file = NULL;
+  return result;
+}
+
+static PFN_glGetBooleanv _real_glGetBooleanv;
+static void  GL_APIENTRY _check_glGetBooleanv (GLenum pname, GLboolean * data) {
+  countGLQuery("glGetBooleanv");
+  _real_glGetBooleanv(pname, data);
+  checkGLCall("glGetBooleanv", "0x%X, %p", pname, (const void *)data);
+}
+
+static PFN_glVertexAttrib4f _real_glVertexAttrib4f;
+static void  GL_APIENTRY _check_glVertexAttrib4f (GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w) {
+  _real_glVertexAttrib4f(index, x, y, z, w);
+  checkGLCall("glVertexAttrib4f", "%u, %g, %g, %g, %g", index, (double)x, (double)y, (double)z, (double)w);
+}
+
+static PFN_glGetAttribLocation _real_glGetAttribLocation;
+static GLint GL_APIENTRY _check_glGetAttribLocation (GLuint program, const GLchar * name) {
+  countGLQuery("glGetAttribLocation");
+  GLint result = _real_glGetAttribLocation(program, name);
+  checkGLCall("glGetAttribLocation", "%u, %p", program, (const void *)name);
+  return result;
+}
+
+static PFN_glGetActiveUniform _real_glGetActiveUniform;
+static void  GL_APIENTRY _check_glGetActiveUniform (GLuint program, GLuint index, GLsizei bufSize, GLsizei * length, GLint * size, GLenum * type, GLchar * name) {
+  countGLQuery("glGetActiveUniform");
+  _real_glGetActiveUniform(program, index, bufSize, length, size, type, name);
+  checkGLCall("glGetActiveUniform", "%u, %u, %d, %p, %p, %p, %p", program, index, bufSize, (const void *)length, (const void *)size, (const void *)type, (const void *)name);
+}
+
+static PFN_glTexParameteriv _real_glTexParameteriv;
+static void  GL_APIENTRY _check_glTexParameteriv (GLenum target, GLenum pname, const GLint * params) {
+  _real_glTexParameteriv(target, pname, params);
+  checkGLCall("glTexParameteriv", "0x%X, 0x%X, %p", target, pname, (const void *)params);
+}
+
+static PFN_glGetActiveAttrib _real_glGetActiveAttrib;
+static void  GL_APIENTRY _check_glGetActiveAttrib (GLuint program, GLuint index, GLsizei bufSize, GLsizei * length, GLint * size, GLenum * type, GLchar * name) {
+  countGLQuery("glGetActiveAttrib");
+  _real_glGetActiveAttrib(program, index, bufSize, length, size, type, name);
+  checkGLCall("glGetActiveAttrib", "%u, %u, %d, %p, %p, %p, %p", program, index, bufSize, (const void *)length, (const void *)size, (const void *)type, (const void *)name);
+}
+
+static PFN_glStencilMaskSeparate _real_glStencilMaskSeparate;
+static void  GL_APIENTRY _check_glStencilMaskSeparate (GLenum face, GLuint mask) {
+  _real_glStencilMaskSeparate(face, mask);
+  checkGLCall("glStencilMaskSeparate", "0x%X, %u", face, mask);
 }
+
+static PFN_glGenRenderbuffers _real_glGenRenderbuffers;
+static void  GL_APIENTRY _check_glGenRenderbuffers (GLsizei n, GLuint * renderbuffers) {
+  _real_glGenRenderbuffers(n, renderbuffers);
+  checkGLCall("glGenRenderbuffers", "%d, %p", n, (const void *)renderbuffers);
+}
+
+static PFN_glCompressedTexSubImage2D _real_glCompressedTexSubImage2D;
+static void  GL_APIENTRY _check_glCompressedTexSubImage2D (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void * data) {
+  _real_glCompressedTexSubImage2D(target, level, xoffset, yoffset, width, height, format, imageSize, data);
+  checkGLCall("glCompressedTexSubImage2D", "0x%X, %d, %d, %d, %d, %d, 0x%X, %d, %p", target, level, xoffset, yoffset, width, height, format, imageSize, (const void *)data);
+}
+
+static PFN_glGetProgramInfoLog _real_glGetProgramInfoLog;
+static void  GL_APIENTRY _check_glGetProgramInfoLog (GLuint program, GLsizei bufSize, GLsizei * length, GLchar * infoLog) {
+  countGLQuery("glGetProgramInfoLog");
+  _real_glGetProgramInfoLog(program, bufSize, length, infoLog);
+  checkGLCall("glGetProgramInfoLog", "%u, %d, %p, %p", program, bufSize, (const void *)length, (const void *)infoLog);
+}
+
+static PFN_glDeleteShader _real_glDeleteShader;
+static void  GL_APIENTRY _check_glDeleteShader (GLuint shader) {
+  _real_glDeleteShader(shader);
+  checkGLCall("glDeleteShader", "%u", shader);
+}
+
+static PFN_glGenBuffers _real_glGenBuffers;
+static void  GL_APIENTRY _check_glGenBuffers (GLsizei n, GLuint * buffers) {
+  _real_glGenBuffers(n, buffers);
+  checkGLCall("glGenBuffers", "%d, %p", n, (const void *)buffers);
+}
+
+static PFN_glSampleCoverage _real_glSampleCoverage;
+static void  GL_APIENTRY _check_glSampleCoverage (GLfloat value, GLboolean invert) {
+  _real_glSampleCoverage(value, invert);
+  checkGLCall("glSampleCoverage", "%g, %u", (double)value, (unsigned int)invert);
+}
+
+static PFN_glGenTextures _real_glGenTextures;
+static void  GL_APIENTRY _check_glGenTextures (GLsizei n, GLuint * textures) {
+  _real_glGenTextures(n, textures);
+  checkGLCall("glGenTextures", "%d, %p", n, (const void *)textures);
+}
+
+static PFN_glGetVertexAttribfv _real_glGetVertexAttribfv;
+static void  GL_APIENTRY _check_glGetVertexAttribfv (GLuint index, GLenum pname, GLfloat * params) {
+  countGLQuery("glGetVertexAttribfv");
+  _real_glGetVertexAttribfv(index, pname, params);
+  checkGLCall("glGetVertexAttribfv", "%u, 0x%X, %p", index, pname, (const void *)params);
+}
+
+static PFN_glUniform4iv _real_glUniform4iv;
+static void  GL_APIENTRY _check_glUniform4iv (GLint location, GLsizei count, const GLint * value) {
+  _real_glUniform4iv(location, count, value);
+  checkGLCall("glUniform4iv", "%d, %d, %p", location, count, (const void *)value);
+}
+
+static PFN_glFrontFace _real_glFrontFace;
+static void  GL_APIENTRY _check_glFrontFace (GLenum mode) {
+  _real_glFrontFace(mode);
+  checkGLCall("glFrontFace", "0x%X", mode);
+}
+
+static PFN_glUniform2iv _real_glUniform2iv;
+static void  GL_APIENTRY _check_glUniform2iv (GLint location, GLsizei count, const GLint * value) {
+  _real_glUniform2iv(location, count, value);
+  checkGLCall("glUniform2iv", "%d, %d, %p", location, count, (const void *)value);
+}
+
+static PFN_glIsShader _real_glIsShader;
+static GLboolean GL_APIENTRY _check_glIsShader (GLuint shader) {
+  countGLQuery("glIsShader");
+  GLboolean result = _real_glIsShader(shader);
+  checkGLCall("glIsShader", "%u", shader);
+  return result;
+}
+
+static PFN_glBindFramebuffer _real_glBindFramebuffer;
+static void  GL_APIENTRY _check_glBindFramebuffer (GLenum target, GLuint framebuffer) {
+  noteGLBind("glBindFramebuffer", &glState.framebuffer, framebuffer);
+  _real_glBindFramebuffer(target, framebuffer);
+  checkGLCall("glBindFramebuffer", "0x%X, %u", target, framebuffer);
+}
+
+static PFN_glFramebufferTexture2D _real_glFramebufferTexture2D;
+static void  GL_APIENTRY _check_glFramebufferTexture2D (GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+  _real_glFramebufferTexture2D(target, attachment, textarget, texture, level);
+  checkGLCall("glFramebufferTexture2D", "0x%X, 0x%X, 0x%X, %u, %d", target, attachment, textarget, texture, level);
+}
+
+static PFN_glUniform4i _real_glUniform4i;
+static void  GL_APIENTRY _check_glUniform4i (GLint location, GLint v0, GLint v1, GLint v2, GLint v3) {
+  _real_glUniform4i(location, v0, v1, v2, v3);
+  checkGLCall("glUniform4i", "%d, %d, %d, %d, %d", location, v0, v1, v2, v3);
+}
+
+static PFN_glClearStencil _real_glClearStencil;
+static void  GL_APIENTRY _check_glClearStencil (GLint s) {
+  _real_glClearStencil(s);
+  checkGLCall("glClearStencil", "%d", s);
+}
+
+static PFN_glDeleteRenderbuffers _real_glDeleteRenderbuffers;
+static void  GL_APIENTRY _check_glDeleteRenderbuffers (GLsizei n, const GLuint * renderbuffers) {
+  forgetGLNames(&glState.renderbuffer, 1, n, renderbuffers);
+  _real_glDeleteRenderbuffers(n, renderbuffers);
+  checkGLCall("glDeleteRenderbuffers", "%d, %p", n, (const void *)renderbuffers);
+}
+
+static PFN_glFinish _real_glFinish;
+static void  GL_APIENTRY _check_glFinish () {
+  countGLQuery("glFinish");
+  _real_glFinish();
+  checkGLCall("glFinish", "");
+}
+
+static PFN_glBlendFuncSeparate _real_glBlendFuncSeparate;
+static void  GL_APIENTRY _check_glBlendFuncSeparate (GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha) {
+  _real_glBlendFuncSeparate(sfactorRGB, dfactorRGB, sfactorAlpha, dfactorAlpha);
+  checkGLCall("glBlendFuncSeparate", "0x%X, 0x%X, 0x%X, 0x%X", sfactorRGB, dfactorRGB, sfactorAlpha, dfactorAlpha);
+}
+
+static PFN_glBindAttribLocation _real_glBindAttribLocation;
+static void  GL_APIENTRY _check_glBindAttribLocation (GLuint program, GLuint index, const GLchar * name) {
+  _real_glBindAttribLocation(program, index, name);
+  checkGLCall("glBindAttribLocation", "%u, %u, %p", program, index, (const void *)name);
+}
+
+static PFN_glClear _real_glClear;
+static void  GL_APIENTRY _check_glClear (GLbitfield mask) {
+  _real_glClear(mask);
+  checkGLCall("glClear", "0x%X", mask);
+}
+
+static PFN_glEnableVertexAttribArray _real_glEnableVertexAttribArray;
+static void  GL_APIENTRY _check_glEnableVertexAttribArray (GLuint index) {
+  _real_glEnableVertexAttribArray(index);
+  checkGLCall("glEnableVertexAttribArray", "%u", index);
+}
+
+static PFN_glStencilFuncSeparate _real_glStencilFuncSeparate;
+static void  GL_APIENTRY _check_glStencilFuncSeparate (GLenum face, GLenum func, GLint ref, GLuint mask) {
+  _real_glStencilFuncSeparate(face, func, ref, mask);
+  checkGLCall("glStencilFuncSeparate", "0x%X, 0x%X, %d, %u", face, func, ref, mask);
+}
+
+static PFN_glPolygonOffset _real_glPolygonOffset;
+static void  GL_APIENTRY _check_glPolygonOffset (GLfloat factor, GLfloat units) {
+  _real_glPolygonOffset(factor, units);
+  checkGLCall("glPolygonOffset", "%g, %g", (double)factor, (double)units);
+}
+
+static PFN_glDisable _real_glDisable;
+static void  GL_APIENTRY _check_glDisable (GLenum cap) {
+  noteGLCapability("glDisable", cap, 0);
+  _real_glDisable(cap);
+  checkGLCall("glDisable", "0x%X", cap);
+}
+
+static PFN_glDetachShader _real_glDetachShader;
+static void  GL_APIENTRY _check_glDetachShader (GLuint program, GLuint shader) {
+  _real_glDetachShader(program, shader);
+  checkGLCall("glDetachShader", "%u, %u", program, shader);
+}
+
+static PFN_glReleaseShaderCompiler _real_glReleaseShaderCompiler;
+static void  GL_APIENTRY _check_glReleaseShaderCompiler () {
+  _real_glReleaseShaderCompiler();
+  checkGLCall("glReleaseShaderCompiler", "");
+}
+
+static PFN_glCompressedTexImage2D _real_glCompressedTexImage2D;
+static void  GL_APIENTRY _check_glCompressedTexImage2D (GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void * data) {
+  _real_glCompressedTexImage2D(target, level, internalformat, width, height, border, imageSize, data);
+  checkGLCall("glCompressedTexImage2D", "0x%X, %d, 0x%X, %d, %d, %d, %d, %p", target, level, internalformat, width, height, border, imageSize, (const void *)data);
+}
+
+static PFN_glBindRenderbuffer _real_glBindRenderbuffer;
+static void  GL_APIENTRY _check_glBindRenderbuffer (GLenum target, GLuint renderbuffer) {
+  noteGLBind("glBindRenderbuffer", &glState.renderbuffer, renderbuffer);
+  _real_glBindRenderbuffer(target, renderbuffer);
+  checkGLCall("glBindRenderbuffer", "0x%X, %u", target, renderbuffer);
+}
+
+static PFN_glDepthMask _real_glDepthMask;
+static void  GL_APIENTRY _check_glDepthMask (GLboolean flag) {
+  _real_glDepthMask(flag);
+  checkGLCall("glDepthMask", "%u", (unsigned int)flag);
+}
+
+static PFN_glIsFramebuffer _real_glIsFramebuffer;
+static GLboolean GL_APIENTRY _check_glIsFramebuffer (GLuint framebuffer) {
+  countGLQuery("glIsFramebuffer");
+  GLboolean result = _real_glIsFramebuffer(framebuffer);
+  checkGLCall("glIsFramebuffer", "%u", framebuffer);
+  return result;
+}
+
+static PFN_glGetUniformfv _real_glGetUniformfv;
+static void  GL_APIENTRY _check_glGetUniformfv (GLuint program, GLint location, GLfloat * params) {
+  countGLQuery("glGetUniformfv");
+  _real_glGetUniformfv(program, location, params);
+  checkGLCall("glGetUniformfv", "%u, %d, %p", program, location, (const void *)params);
+}
+
+static PFN_glUniform4f _real_glUniform4f;
+static void  GL_APIENTRY _check_glUniform4f (GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+  _real_glUniform4f(location, v0, v1, v2, v3);
+  checkGLCall("glUniform4f", "%d, %g, %g, %g, %g", location, (double)v0, (double)v1, (double)v2, (double)v3);
+}
+
+static PFN_glAttachShader _real_glAttachShader;
+static void  GL_APIENTRY _check_glAttachShader (GLuint program, GLuint shader) {
+  _real_glAttachShader(program, shader);
+  checkGLCall("glAttachShader", "%u, %u", program, shader);
+}
+
+static PFN_glFramebufferRenderbuffer _real_glFramebufferRenderbuffer;
+static void  GL_APIENTRY _check_glFramebufferRenderbuffer (GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+  _real_glFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+  checkGLCall("glFramebufferRenderbuffer", "0x%X, 0x%X, 0x%X, %u", target, attachment, renderbuffertarget, renderbuffer);
+}
+
+static PFN_glStencilOp _real_glStencilOp;
+static void  GL_APIENTRY _check_glStencilOp (GLenum fail, GLenum zfail, GLenum zpass) {
+  _real_glStencilOp(fail, zfail, zpass);
+  checkGLCall("glStencilOp", "0x%X, 0x%X, 0x%X", fail, zfail, zpass);
+}
+
+static PFN_glDisableVertexAttribArray _real_glDisableVertexAttribArray;
+static void  GL_APIENTRY _check_glDisableVertexAttribArray (GLuint index) {
+  _real_glDisableVertexAttribArray(index);
+  checkGLCall("glDisableVertexAttribArray", "%u", index);
+}
+
+static PFN_glIsRenderbuffer _real_glIsRenderbuffer;
+static GLboolean GL_APIENTRY _check_glIsRenderbuffer (GLuint renderbuffer) {
+  countGLQuery("glIsRenderbuffer");
+  GLboolean result = _real_glIsRenderbuffer(renderbuffer);
+  checkGLCall("glIsRenderbuffer", "%u", renderbuffer);
+  return result;
+}
+
+static PFN_glDeleteProgram _real_glDeleteProgram;
+static void  GL_APIENTRY _check_glDeleteProgram (GLuint program) {
+  _real_glDeleteProgram(program);
+  checkGLCall("glDeleteProgram", "%u", program);
+}
+
+static PFN_glDrawArrays _real_glDrawArrays;
+static void  GL_APIENTRY _check_glDrawArrays (GLenum mode, GLint first, GLsizei count) {
+  _real_glDrawArrays(mode, first, count);
+  checkGLCall("glDrawArrays", "0x%X, %d, %d", mode, first, count);
+}
+
+static PFN_glBlendEquationSeparate _real_glBlendEquationSeparate;
+static void  GL_APIENTRY _check_glBlendEquationSeparate (GLenum modeRGB, GLenum modeAlpha) {
+  _real_glBlendEquationSeparate(modeRGB, modeAlpha);
+  checkGLCall("glBlendEquationSeparate", "0x%X, 0x%X", modeRGB, modeAlpha);
+}
+
+static PFN_glCompileShader _real_glCompileShader;
+static void  GL_APIENTRY _check_glCompileShader (GLuint shader) {
+  _real_glCompileShader(shader);
+  checkGLCall("glCompileShader", "%u", shader);
+}
+
+static PFN_glVertexAttrib1f _real_glVertexAttrib1f;
+static void  GL_APIENTRY _check_glVertexAttrib1f (GLuint index, GLfloat x) {
+  _real_glVertexAttrib1f(index, x);
+  checkGLCall("glVertexAttrib1f", "%u, %g", index, (double)x);
+}
+
+static PFN_glDeleteFramebuffers _real_glDeleteFramebuffers;
+static void  GL_APIENTRY _check_glDeleteFramebuffers (GLsizei n, const GLuint * framebuffers) {
+  forgetGLNames(&glState.framebuffer, 1, n, framebuffers);
+  _real_glDeleteFramebuffers(n, framebuffers);
+  checkGLCall("glDeleteFramebuffers", "%d, %p", n, (const void *)framebuffers);
+}
+
+static PFN_glDeleteBuffers _real_glDeleteBuffers;
+static void  GL_APIENTRY _check_glDeleteBuffers (GLsizei n, const GLuint * buffers) {
+  forgetGLNames(glState.buffers, 2, n, buffers);
+  _real_glDeleteBuffers(n, buffers);
+  checkGLCall("glDeleteBuffers", "%d, %p", n, (const void *)buffers);
+}
+
+static PFN_glTexParameterfv _real_glTexParameterfv;
+static void  GL_APIENTRY _check_glTexParameterfv (GLenum target, GLenum pname, const GLfloat * params) {
+  _real_glTexParameterfv(target, pname, params);
+  checkGLCall("glTexParameterfv", "0x%X, 0x%X, %p", target, pname, (const void *)params);
+}
+
+static PFN_glLinkProgram _real_glLinkProgram;
+static void  GL_APIENTRY _check_glLinkProgram (GLuint program) {
+  _real_glLinkProgram(program);
+  checkGLCall("glLinkProgram", "%u", program);
+}
+
+static PFN_glGenerateMipmap _real_glGenerateMipmap;
+static void  GL_APIENTRY _check_glGenerateMipmap (GLenum target) {
+  _real_glGenerateMipmap(target);
+  checkGLCall("glGenerateMipmap", "0x%X", target);
+}
+
+static PFN_glCullFace _real_glCullFace;
+static void  GL_APIENTRY _check_glCullFace (GLenum mode) {
+  _real_glCullFace(mode);
+  checkGLCall("glCullFace", "0x%X", mode);
+}
+
+static PFN_glVertexAttrib2f _real_glVertexAttrib2f;
+static void  GL_APIENTRY _check_glVertexAttrib2f (GLuint index, GLfloat x, GLfloat y) {
+  _real_glVertexAttrib2f(index, x, y);
+  checkGLCall("glVertexAttrib2f", "%u, %g, %g", index, (double)x, (double)y);
+}
+
+static PFN_glTexImage2D _real_glTexImage2D;
+static void  GL_APIENTRY _check_glTexImage2D (GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void * pixels) {
+  _real_glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+  checkGLCall("glTexImage2D", "0x%X, %d, %d, %d, %d, %d, 0x%X, 0x%X, %p", target, level, internalformat, width, height, border, format, type, (const void *)pixels);
+}
+
+static PFN_glDrawElements _real_glDrawElements;
+static void  GL_APIENTRY _check_glDrawElements (GLenum mode, GLsizei count, GLenum type, const void * indices) {
+  _real_glDrawElements(mode, count, type, indices);
+  checkGLCall("glDrawElements", "0x%X, %d, 0x%X, %p", mode, count, type, (const void *)indices);
+}
+
+static PFN_glGenFramebuffers _real_glGenFramebuffers;
+static void  GL_APIENTRY _check_glGenFramebuffers (GLsizei n, GLuint * framebuffers) {
+  _real_glGenFramebuffers(n, framebuffers);
+  checkGLCall("glGenFramebuffers", "%d, %p", n, (const void *)framebuffers);
+}
+
+static PFN_glCreateShader _real_glCreateShader;
+static GLuint GL_APIENTRY _check_glCreateShader (GLenum type) {
+  GLuint result = _real_glCreateShader(type);
+  checkGLCall("glCreateShader", "0x%X", type);
+  return result;
+}
+
+static PFN_glGetFramebufferAttachmentParameteriv _real_glGetFramebufferAttachmentParameteriv;
+static void  GL_APIENTRY _check_glGetFramebufferAttachmentParameteriv (GLenum target, GLenum attachment, GLenum pname, GLint * params) {
+  countGLQuery("glGetFramebufferAttachmentParameteriv");
+  _real_glGetFramebufferAttachmentParameteriv(target, attachment, pname, params);
+  checkGLCall("glGetFramebufferAttachmentParameteriv", "0x%X, 0x%X, 0x%X, %p", target, attachment, pname, (const void *)params);
+}
+
+static PFN_glClearColor _real_glClearColor;
+static void  GL_APIENTRY _check_glClearColor (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+  _real_glClearColor(red, green, blue, alpha);
+  checkGLCall("glClearColor", "%g, %g, %g, %g", (double)red, (double)green, (double)blue, (double)alpha);
+}
+
+static PFN_glCreateProgram _real_glCreateProgram;
+static GLuint GL_APIENTRY _check_glCreateProgram () {
+  GLuint result = _real_glCreateProgram();
+  checkGLCall("glCreateProgram", "");
+  return result;
+}
+
+static PFN_glClearDepthf _real_glClearDepthf;
+static void  GL_APIENTRY _check_glClearDepthf (GLfloat d) {
+  _real_glClearDepthf(d);
+  checkGLCall("glClearDepthf", "%g", (double)d);
+}
+
+static PFN_glBlendFunc _real_glBlendFunc;
+static void  GL_APIENTRY _check_glBlendFunc (GLenum sfactor, GLenum dfactor) {
+  _real_glBlendFunc(sfactor, dfactor);
+  checkGLCall("glBlendFunc", "0x%X, 0x%X", sfactor, dfactor);
+}
+
+static PFN_glBindBuffer _real_glBindBuffer;
+static void  GL_APIENTRY _check_glBindBuffer (GLenum target, GLuint buffer) {
+  noteGLBind("glBindBuffer", glBufferBinding(target), buffer);
+  _real_glBindBuffer(target, buffer);
+  checkGLCall("glBindBuffer", "0x%X, %u", target, buffer);
+}
+
+static PFN_glGetShaderInfoLog _real_glGetShaderInfoLog;
+static void  GL_APIENTRY _check_glGetShaderInfoLog (GLuint shader, GLsizei bufSize, GLsizei * length, GLchar * infoLog) {
+  countGLQuery("glGetShaderInfoLog");
+  _real_glGetShaderInfoLog(shader, bufSize, length, infoLog);
+  checkGLCall("glGetShaderInfoLog", "%u, %d, %p, %p", shader, bufSize, (const void *)length, (const void *)infoLog);
+}
+
+static PFN_glCheckFramebufferStatus _real_glCheckFramebufferStatus;
+static GLenum GL_APIENTRY _check_glCheckFramebufferStatus (GLenum target) {
+  countGLQuery("glCheckFramebufferStatus");
+  GLenum result = _real_glCheckFramebufferStatus(target);
+  checkGLCall("glCheckFramebufferStatus", "0x%X", target);
+  return result;
+}
+
+static PFN_glBufferSubData _real_glBufferSubData;
+static void  GL_APIENTRY _check_glBufferSubData (GLenum target, GLintptr offset, GLsizeiptr size, const void * data) {
+  _real_glBufferSubData(target, offset, size, data);
+  checkGLCall("glBufferSubData", "0x%X, %lld, %lld, %p", target, (long long)offset, (long long)size, (const void *)data);
+}
+
+static PFN_glActiveTexture _real_glActiveTexture;
+static void  GL_APIENTRY _check_glActiveTexture (GLenum texture) {
+  if (onGLChecksThread())
+    glState.unit = texture - GL_TEXTURE0;
+  _real_glActiveTexture(texture);
+  checkGLCall("glActiveTexture", "0x%X", texture);
+}
+
+static PFN_glColorMask _real_glColorMask;
+static void  GL_APIENTRY _check_glColorMask (GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+  _real_glColorMask(red, green, blue, alpha);
+  checkGLCall("glColorMask", "%u, %u, %u, %u", (unsigned int)red, (unsigned int)green, (unsigned int)blue, (unsigned int)alpha);
+}
+
+static PFN_glBufferData _real_glBufferData;
+static void  GL_APIENTRY _check_glBufferData (GLenum target, GLsizeiptr size, const void * data, GLenum usage) {
+  _real_glBufferData(target, size, data, usage);
+  checkGLCall("glBufferData", "0x%X, %lld, %p, 0x%X", target, (long long)size, (const void *)data, usage);
+}
+
+static PFN_glDepthFunc _real_glDepthFunc;
+static void  GL_APIENTRY _check_glDepthFunc (GLenum func) {
+  _real_glDepthFunc(func);
+  checkGLCall("glDepthFunc", "0x%X", func);
+}
+
+static PFN_glFlush _real_glFlush;
+static void  GL_APIENTRY _check_glFlush () {
+  _real_glFlush();
+  checkGLCall("glFlush", "");
+}
+
+static PFN_glCopyTexSubImage2D _real_glCopyTexSubImage2D;
+static void  GL_APIENTRY _check_glCopyTexSubImage2D (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height) {
+  _real_glCopyTexSubImage2D(target, level, xoffset, yoffset, x, y, width, height);
+  checkGLCall("glCopyTexSubImage2D", "0x%X, %d, %d, %d, %d, %d, %d, %d", target, level, xoffset, yoffset, x, y, width, height);
+}
+
+static PFN_glGetAttachedShaders _real_glGetAttachedShaders;
+static void  GL_APIENTRY _check_glGetAttachedShaders (GLuint program, GLsizei maxCount, GLsizei * count, GLuint * shaders) {
+  countGLQuery("glGetAttachedShaders");
+  _real_glGetAttachedShaders(program, maxCount, count, shaders);
+  checkGLCall("glGetAttachedShaders", "%u, %d, %p, %p", program, maxCount, (const void *)count, (const void *)shaders);
+}
+
+static PFN_glDepthRangef _real_glDepthRangef;
+static void  GL_APIENTRY _check_glDepthRangef (GLfloat n, GLfloat f) {
+  _real_glDepthRangef(n, f);
+  checkGLCall("glDepthRangef", "%g, %g", (double)n, (double)f);
+}
+
+static PFN_glBlendEquation _real_glBlendEquation;
+static void  GL_APIENTRY _check_glBlendEquation (GLenum mode) {
+  _real_glBlendEquation(mode);
+  checkGLCall("glBlendEquation", "0x%X", mode);
+}
+
+static PFN_glGetShaderSource _real_glGetShaderSource;
+static void  GL_APIENTRY _check_glGetShaderSource (GLuint shader, GLsizei bufSize, GLsizei * length, GLchar * source) {
+  countGLQuery("glGetShaderSource");
+  _real_glGetShaderSource(shader, bufSize, length, source);
+  checkGLCall("glGetShaderSource", "%u, %d, %p, %p", shader, bufSize, (const void *)length, (const void *)source);
+}
+
+static PFN_glEnable _real_glEnable;
+static void  GL_APIENTRY _check_glEnable (GLenum cap) {
+  noteGLCapability("glEnable", cap, 1);
+  _real_glEnable(cap);
+  checkGLCall("glEnable", "0x%X", cap);
+}
+
+static PFN_glBlendColor _real_glBlendColor;
+static void  GL_APIENTRY _check_glBlendColor (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+  _real_glBlendColor(red, green, blue, alpha);
+  checkGLCall("glBlendColor", "%g, %g, %g, %g", (double)red, (double)green, (double)blue, (double)alpha);
+}
+
+static PFN_glUniform2f _real_glUniform2f;
+static void  GL_APIENTRY _check_glUniform2f (GLint location, GLfloat v0, GLfloat v1) {
+  _real_glUniform2f(location, v0, v1);
+  checkGLCall("glUniform2f", "%d, %g, %g", location, (double)v0, (double)v1);
+}
+
+static PFN_glBindTexture _real_glBindTexture;
+static void  GL_APIENTRY _check_glBindTexture (GLenum target, GLuint texture) {
+  noteGLBind("glBindTexture", glTextureBinding(target), texture);
+  _real_glBindTexture(target, texture);
+  checkGLCall("glBindTexture", "0x%X, %u", target, texture);
+}
+
+
+static void installGLChecks(void *user_data) {
+    (void)user_data;
+    /* Save real entry points (or whichever layer was installed before us) */
+    loadGLPointers();
+    forgetGLState();
+    _real_glVertexAttribPointer = _glptr_glVertexAttribPointer;
+    _glptr_glVertexAttribPointer = _check_glVertexAttribPointer;
+    _real_glVertexAttrib3fv = _glptr_glVertexAttrib3fv;
+    _glptr_glVertexAttrib3fv = _check_glVertexAttrib3fv;
+    _real_glVertexAttrib3f = _glptr_glVertexAttrib3f;
+    _glptr_glVertexAttrib3f = _check_glVertexAttrib3f;
+    _real_glVertexAttrib2fv = _glptr_glVertexAttrib2fv;
+    _glptr_glVertexAttrib2fv = _check_glVertexAttrib2fv;
+    _real_glVertexAttrib1fv = _glptr_glVertexAttrib1fv;
+    _glptr_glVertexAttrib1fv = _check_glVertexAttrib1fv;
+    _real_glValidateProgram = _glptr_glValidateProgram;
+    _glptr_glValidateProgram = _check_glValidateProgram;
+    _real_glUseProgram = _glptr_glUseProgram;
+    _glptr_glUseProgram = _check_glUseProgram;
+    _real_glUniformMatrix4fv = _glptr_glUniformMatrix4fv;
+    _glptr_glUniformMatrix4fv = _check_glUniformMatrix4fv;
+    _real_glUniformMatrix3fv = _glptr_glUniformMatrix3fv;
+    _glptr_glUniformMatrix3fv = _check_glUniformMatrix3fv;
+    _real_glUniformMatrix2fv = _glptr_glUniformMatrix2fv;
+    _glptr_glUniformMatrix2fv = _check_glUniformMatrix2fv;
+    _real_glUniform4fv = _glptr_glUniform4fv;
+    _glptr_glUniform4fv = _check_glUniform4fv;
+    _real_glUniform3iv = _glptr_glUniform3iv;
+    _glptr_glUniform3iv = _check_glUniform3iv;
+    _real_glUniform3fv = _glptr_glUniform3fv;
+    _glptr_glUniform3fv = _check_glUniform3fv;
+    _real_glUniform2fv = _glptr_glUniform2fv;
+    _glptr_glUniform2fv = _check_glUniform2fv;
+    _real_glUniform1iv = _glptr_glUniform1iv;
+    _glptr_glUniform1iv = _check_glUniform1iv;
+    _real_glUniform1i = _glptr_glUniform1i;
+    _glptr_glUniform1i = _check_glUniform1i;
+    _real_glUniform1fv = _glptr_glUniform1fv;
+    _glptr_glUniform1fv = _check_glUniform1fv;
+    _real_glTexSubImage2D = _glptr_glTexSubImage2D;
+    _glptr_glTexSubImage2D = _check_glTexSubImage2D;
+    _real_glTexParameteri = _glptr_glTexParameteri;
+    _glptr_glTexParameteri = _check_glTexParameteri;
+    _real_glUniform3f = _glptr_glUniform3f;
+    _glptr_glUniform3f = _check_glUniform3f;
+    _real_glTexParameterf = _glptr_glTexParameterf;
+    _glptr_glTexParameterf = _check_glTexParameterf;
+    _real_glStencilOpSeparate = _glptr_glStencilOpSeparate;
+    _glptr_glStencilOpSeparate = _check_glStencilOpSeparate;
+    _real_glStencilMask = _glptr_glStencilMask;
+    _glptr_glStencilMask = _check_glStencilMask;
+    _real_glStencilFunc = _glptr_glStencilFunc;
+    _glptr_glStencilFunc = _check_glStencilFunc;
+    _real_glShaderSource = _glptr_glShaderSource;
+    _glptr_glShaderSource = _check_glShaderSource;
+    _real_glUniform1f = _glptr_glUniform1f;
+    _glptr_glUniform1f = _check_glUniform1f;
+    _real_glShaderBinary = _glptr_glShaderBinary;
+    _glptr_glShaderBinary = _check_glShaderBinary;
+    _real_glHint = _glptr_glHint;
+    _glptr_glHint = _check_glHint;
+    _real_glScissor = _glptr_glScissor;
+    _glptr_glScissor = _check_glScissor;
+    _real_glGetBufferParameteriv = _glptr_glGetBufferParameteriv;
+    _glptr_glGetBufferParameteriv = _check_glGetBufferParameteriv;
+    _real_glRenderbufferStorage = _glptr_glRenderbufferStorage;
+    _glptr_glRenderbufferStorage = _check_glRenderbufferStorage;
+    _real_glReadPixels = _glptr_glReadPixels;
+    _glptr_glReadPixels = _check_glReadPixels;
+    _real_glPixelStorei = _glptr_glPixelStorei;
+    _glptr_glPixelStorei = _check_glPixelStorei;
+    _real_glDeleteTextures = _glptr_glDeleteTextures;
+    _glptr_glDeleteTextures = _check_glDeleteTextures;
+    _real_glIsBuffer = _glptr_glIsBuffer;
+    _glptr_glIsBuffer = _check_glIsBuffer;
+    _real_glLineWidth = _glptr_glLineWidth;
+    _glptr_glLineWidth = _check_glLineWidth;
+    _real_glIsEnabled = _glptr_glIsEnabled;
+    _glptr_glIsEnabled = _check_glIsEnabled;
+    _real_glGetVertexAttribiv = _glptr_glGetVertexAttribiv;
+    _glptr_glGetVertexAttribiv = _check_glGetVertexAttribiv;
+    _real_glGetUniformLocation = _glptr_glGetUniformLocation;
+    _glptr_glGetUniformLocation = _check_glGetUniformLocation;
+    _real_glGetTexParameteriv = _glptr_glGetTexParameteriv;
+    _glptr_glGetTexParameteriv = _check_glGetTexParameteriv;
+    _real_glGetVertexAttribPointerv = _glptr_glGetVertexAttribPointerv;
+    _glptr_glGetVertexAttribPointerv = _check_glGetVertexAttribPointerv;
+    _real_glViewport = _glptr_glViewport;
+    _glptr_glViewport = _check_glViewport;
+    _real_glGetTexParameterfv = _glptr_glGetTexParameterfv;
+    _glptr_glGetTexParameterfv = _check_glGetTexParameterfv;
+    _real_glIsTexture = _glptr_glIsTexture;
+    _glptr_glIsTexture = _check_glIsTexture;
+    _real_glGetString = _glptr_glGetString;
+    _glptr_glGetString = _check_glGetString;
+    _real_glCopyTexImage2D = _glptr_glCopyTexImage2D;
+    _glptr_glCopyTexImage2D = _check_glCopyTexImage2D;
+    _real_glIsProgram = _glptr_glIsProgram;
+    _glptr_glIsProgram = _check_glIsProgram;
+    _real_glVertexAttrib4fv = _glptr_glVertexAttrib4fv;
+    _glptr_glVertexAttrib4fv = _check_glVertexAttrib4fv;
+    _real_glGetUniformiv = _glptr_glGetUniformiv;
+    _glptr_glGetUniformiv = _check_glGetUniformiv;
+    _real_glUniform3i = _glptr_glUniform3i;
+    _glptr_glUniform3i = _check_glUniform3i;
+    _real_glGetShaderPrecisionFormat = _glptr_glGetShaderPrecisionFormat;
+    _glptr_glGetShaderPrecisionFormat = _check_glGetShaderPrecisionFormat;
+    _real_glGetShaderiv = _glptr_glGetShaderiv;
+    _glptr_glGetShaderiv = _check_glGetShaderiv;
+    _real_glGetRenderbufferParameteriv = _glptr_glGetRenderbufferParameteriv;
+    _glptr_glGetRenderbufferParameteriv = _check_glGetRenderbufferParameteriv;
+    _real_glGetProgramiv = _glptr_glGetProgramiv;
+    _glptr_glGetProgramiv = _check_glGetProgramiv;
+    _real_glGetIntegerv = _glptr_glGetIntegerv;
+    _glptr_glGetIntegerv = _check_glGetIntegerv;
+    _real_glGetFloatv = _glptr_glGetFloatv;
+    _glptr_glGetFloatv = _check_glGetFloatv;
+    _real_glUniform2i = _glptr_glUniform2i;
+    _glptr_glUniform2i = _check_glUniform2i;
+    _real_glGetError = _glptr_glGetError;
+    _glptr_glGetError = _check_glGetError;
+    _real_glGetBooleanv = _glptr_glGetBooleanv;
+    _glptr_glGetBooleanv = _check_glGetBooleanv;
+    _real_glVertexAttrib4f = _glptr_glVertexAttrib4f;
+    _glptr_glVertexAttrib4f = _check_glVertexAttrib4f;
+    _real_glGetAttribLocation = _glptr_glGetAttribLocation;
+    _glptr_glGetAttribLocation = _check_glGetAttribLocation;
+    _real_glGetActiveUniform = _glptr_glGetActiveUniform;
+    _glptr_glGetActiveUniform = _check_glGetActiveUniform;
+    _real_glTexParameteriv = _glptr_glTexParameteriv;
+    _glptr_glTexParameteriv = _check_glTexParameteriv;
+    _real_glGetActiveAttrib = _glptr_glGetActiveAttrib;
+    _glptr_glGetActiveAttrib = _check_glGetActiveAttrib;
+    _real_glStencilMaskSeparate = _glptr_glStencilMaskSeparate;
+    _glptr_glStencilMaskSeparate = _check_glStencilMaskSeparate;
+    _real_glGenRenderbuffers = _glptr_glGenRenderbuffers;
+    _glptr_glGenRenderbuffers = _check_glGenRenderbuffers;
+    _real_glCompressedTexSubImage2D = _glptr_glCompressedTexSubImage2D;
+    _glptr_glCompressedTexSubImage2D = _check_glCompressedTexSubImage2D;
+    _real_glGetProgramInfoLog = _glptr_glGetProgramInfoLog;
+    _glptr_glGetProgramInfoLog = _check_glGetProgramInfoLog;
+    _real_glDeleteShader = _glptr_glDeleteShader;
+    _glptr_glDeleteShader = _check_glDeleteShader;
+    _real_glGenBuffers = _glptr_glGenBuffers;
+    _glptr_glGenBuffers = _check_glGenBuffers;
+    _real_glSampleCoverage = _glptr_glSampleCoverage;
+    _glptr_glSampleCoverage = _check_glSampleCoverage;
+    _real_glGenTextures = _glptr_glGenTextures;
+    _glptr_glGenTextures = _check_glGenTextures;
+    _real_glGetVertexAttribfv = _glptr_glGetVertexAttribfv;
+    _glptr_glGetVertexAttribfv = _check_glGetVertexAttribfv;
+    _real_glUniform4iv = _glptr_glUniform4iv;
+    _glptr_glUniform4iv = _check_glUniform4iv;
+    _real_glFrontFace = _glptr_glFrontFace;
+    _glptr_glFrontFace = _check_glFrontFace;
+    _real_glUniform2iv = _glptr_glUniform2iv;
+    _glptr_glUniform2iv = _check_glUniform2iv;
+    _real_glIsShader = _glptr_glIsShader;
+    _glptr_glIsShader = _check_glIsShader;
+    _real_glBindFramebuffer = _glptr_glBindFramebuffer;
+    _glptr_glBindFramebuffer = _check_glBindFramebuffer;
+    _real_glFramebufferTexture2D = _glptr_glFramebufferTexture2D;
+    _glptr_glFramebufferTexture2D = _check_glFramebufferTexture2D;
+    _real_glUniform4i = _glptr_glUniform4i;
+    _glptr_glUniform4i = _check_glUniform4i;
+    _real_glClearStencil = _glptr_glClearStencil;
+    _glptr_glClearStencil = _check_glClearStencil;
+    _real_glDeleteRenderbuffers = _glptr_glDeleteRenderbuffers;
+    _glptr_glDeleteRenderbuffers = _check_glDeleteRenderbuffers;
+    _real_glFinish = _glptr_glFinish;
+    _glptr_glFinish = _check_glFinish;
+    _real_glBlendFuncSeparate = _glptr_glBlendFuncSeparate;
+    _glptr_glBlendFuncSeparate = _check_glBlendFuncSeparate;
+    _real_glBindAttribLocation = _glptr_glBindAttribLocation;
+    _glptr_glBindAttribLocation = _check_glBindAttribLocation;
+    _real_glClear = _glptr_glClear;
+    _glptr_glClear = _check_glClear;
+    _real_glEnableVertexAttribArray = _glptr_glEnableVertexAttribArray;
+    _glptr_glEnableVertexAttribArray = _check_glEnableVertexAttribArray;
+    _real_glStencilFuncSeparate = _glptr_glStencilFuncSeparate;
+    _glptr_glStencilFuncSeparate = _check_glStencilFuncSeparate;
+    _real_glPolygonOffset = _glptr_glPolygonOffset;
+    _glptr_glPolygonOffset = _check_glPolygonOffset;
+    _real_glDisable = _glptr_glDisable;
+    _glptr_glDisable = _check_glDisable;
+    _real_glDetachShader = _glptr_glDetachShader;
+    _glptr_glDetachShader = _check_glDetachShader;
+    _real_glReleaseShaderCompiler = _glptr_glReleaseShaderCompiler;
+    _glptr_glReleaseShaderCompiler = _check_glReleaseShaderCompiler;
+    _real_glCompressedTexImage2D = _glptr_glCompressedTexImage2D;
+    _glptr_glCompressedTexImage2D = _check_glCompressedTexImage2D;
+    _real_glBindRenderbuffer = _glptr_glBindRenderbuffer;
+    _glptr_glBindRenderbuffer = _check_glBindRenderbuffer;
+    _real_glDepthMask = _glptr_glDepthMask;
+    _glptr_glDepthMask = _check_glDepthMask;
+    _real_glIsFramebuffer = _glptr_glIsFramebuffer;
+    _glptr_glIsFramebuffer = _check_glIsFramebuffer;
+    _real_glGetUniformfv = _glptr_glGetUniformfv;
+    _glptr_glGetUniformfv = _check_glGetUniformfv;
+    _real_glUniform4f = _glptr_glUniform4f;
+    _glptr_glUniform4f = _check_glUniform4f;
+    _real_glAttachShader = _glptr_glAttachShader;
+    _glptr_glAttachShader = _check_glAttachShader;
+    _real_glFramebufferRenderbuffer = _glptr_glFramebufferRenderbuffer;
+    _glptr_glFramebufferRenderbuffer = _check_glFramebufferRenderbuffer;
+    _real_glStencilOp = _glptr_glStencilOp;
+    _glptr_glStencilOp = _check_glStencilOp;
+    _real_glDisableVertexAttribArray = _glptr_glDisableVertexAttribArray;
+    _glptr_glDisableVertexAttribArray = _check_glDisableVertexAttribArray;
+    _real_glIsRenderbuffer = _glptr_glIsRenderbuffer;
+    _glptr_glIsRenderbuffer = _check_glIsRenderbuffer;
+    _real_glDeleteProgram = _glptr_glDeleteProgram;
+    _glptr_glDeleteProgram = _check_glDeleteProgram;
+    _real_glDrawArrays = _glptr_glDrawArrays;
+    _glptr_glDrawArrays = _check_glDrawArrays;
+    _real_glBlendEquationSeparate = _glptr_glBlendEquationSeparate;
+    _glptr_glBlendEquationSeparate = _check_glBlendEquationSeparate;
+    _real_glCompileShader = _glptr_glCompileShader;
+    _glptr_glCompileShader = _check_glCompileShader;
+    _real_glVertexAttrib1f = _glptr_glVertexAttrib1f;
+    _glptr_glVertexAttrib1f = _check_glVertexAttrib1f;
+    _real_glDeleteFramebuffers = _glptr_glDeleteFramebuffers;
+    _glptr_glDeleteFramebuffers = _check_glDeleteFramebuffers;
+    _real_glDeleteBuffers = _glptr_glDeleteBuffers;
+    _glptr_glDeleteBuffers = _check_glDeleteBuffers;
+    _real_glTexParameterfv = _glptr_glTexParameterfv;
+    _glptr_glTexParameterfv = _check_glTexParameterfv;
+    _real_glLinkProgram = _glptr_glLinkProgram;
+    _glptr_glLinkProgram = _check_glLinkProgram;
+    _real_glGenerateMipmap = _glptr_glGenerateMipmap;
+    _glptr_glGenerateMipmap = _check_glGenerateMipmap;
+    _real_glCullFace = _glptr_glCullFace;
+    _glptr_glCullFace = _check_glCullFace;
+    _real_glVertexAttrib2f = _glptr_glVertexAttrib2f;
+    _glptr_glVertexAttrib2f = _check_glVertexAttrib2f;
+    _real_glTexImage2D = _glptr_glTexImage2D;
+    _glptr_glTexImage2D = _check_glTexImage2D;
+    _real_glDrawElements = _glptr_glDrawElements;
+    _glptr_glDrawElements = _check_glDrawElements;
+    _real_glGenFramebuffers = _glptr_glGenFramebuffers;
+    _glptr_glGenFramebuffers = _check_glGenFramebuffers;
+    _real_glCreateShader = _glptr_glCreateShader;
+    _glptr_glCreateShader = _check_glCreateShader;
+    _real_glGetFramebufferAttachmentParameteriv = _glptr_glGetFramebufferAttachmentParameteriv;
+    _glptr_glGetFramebufferAttachmentParameteriv = _check_glGetFramebufferAttachmentParameteriv;
+    _real_glClearColor = _glptr_glClearColor;
+    _glptr_glClearColor = _check_glClearColor;
+    _real_glCreateProgram = _glptr_glCreateProgram;
+    _glptr_glCreateProgram = _check_glCreateProgram;
+    _real_glClearDepthf = _glptr_glClearDepthf;
+    _glptr_glClearDepthf = _check_glClearDepthf;
+    _real_glBlendFunc = _glptr_glBlendFunc;
+    _glptr_glBlendFunc = _check_glBlendFunc;
+    _real_glBindBuffer = _glptr_glBindBuffer;
+    _glptr_glBindBuffer = _check_glBindBuffer;
+    _real_glGetShaderInfoLog = _glptr_glGetShaderInfoLog;
+    _glptr_glGetShaderInfoLog = _check_glGetShaderInfoLog;
+    _real_glCheckFramebufferStatus = _glptr_glCheckFramebufferStatus;
+    _glptr_glCheckFramebufferStatus = _check_glCheckFramebufferStatus;
+    _real_glBufferSubData = _glptr_glBufferSubData;
+    _glptr_glBufferSubData = _check_glBufferSubData;
+    _real_glActiveTexture = _glptr_glActiveTexture;
+    _glptr_glActiveTexture = _check_glActiveTexture;
+    _real_glColorMask = _glptr_glColorMask;
+    _glptr_glColorMask = _check_glColorMask;
+    _real_glBufferData = _glptr_glBufferData;
+    _glptr_glBufferData = _check_glBufferData;
+    _real_glDepthFunc = _glptr_glDepthFunc;
+    _glptr_glDepthFunc = _check_glDepthFunc;
+    _real_glFlush = _glptr_glFlush;
+    _glptr_glFlush = _check_glFlush;
+    _real_glCopyTexSubImage2D = _glptr_glCopyTexSubImage2D;
+    _glptr_glCopyTexSubImage2D = _check_glCopyTexSubImage2D;
+    _real_glGetAttachedShaders = _glptr_glGetAttachedShaders;
+    _glptr_glGetAttachedShaders = _check_glGetAttachedShaders;
+    _real_glDepthRangef = _glptr_glDepthRangef;
+    _glptr_glDepthRangef = _check_glDepthRangef;
+    _real_glBlendEquation = _glptr_glBlendEquation;
+    _glptr_glBlendEquation = _check_glBlendEquation;
+    _real_glGetShaderSource = _glptr_glGetShaderSource;
+    _glptr_glGetShaderSource = _check_glGetShaderSource;
+    _real_glEnable = _glptr_glEnable;
+    _glptr_glEnable = _check_glEnable;
+    _real_glBlendColor = _glptr_glBlendColor;
+    _glptr_glBlendColor = _check_glBlendColor;
+    _real_glUniform2f = _glptr_glUniform2f;
+    _glptr_glUniform2f = _check_glUniform2f;
+    _real_glBindTexture = _glptr_glBindTexture;
+    _glptr_glBindTexture = _check_glBindTexture;
+}
+
+
+static void removeGLChecks(void) {
+    if (_glptr_glVertexAttribPointer == _check_glVertexAttribPointer)
+        _glptr_glVertexAttribPointer = _real_glVertexAttribPointer;
+    if (_glptr_glVertexAttrib3fv == _check_glVertexAttrib3fv)
+        _glptr_glVertexAttrib3fv = _real_glVertexAttrib3fv;
+    if (_glptr_glVertexAttrib3f == _check_glVertexAttrib3f)
+        _glptr_glVertexAttrib3f = _real_glVertexAttrib3f;
+    if (_glptr_glVertexAttrib2fv == _check_glVertexAttrib2fv)
+        _glptr_glVertexAttrib2fv = _real_glVertexAttrib2fv;
+    if (_glptr_glVertexAttrib1fv == _check_glVertexAttrib1fv)
+        _glptr_glVertexAttrib1fv = _real_glVertexAttrib1fv;
+    if (_glptr_glValidateProgram == _check_glValidateProgram)
+        _glptr_glValidateProgram = _real_glValidateProgram;
+    if (_glptr_glUseProgram == _check_glUseProgram)
+        _glptr_glUseProgram = _real_glUseProgram;
+    if (_glptr_glUniformMatrix4fv == _check_glUniformMatrix4fv)
+        _glptr_glUniformMatrix4fv = _real_glUniformMatrix4fv;
+    if (_glptr_glUniformMatrix3fv == _check_glUniformMatrix3fv)
+        _glptr_glUniformMatrix3fv = _real_glUniformMatrix3fv;
+    if (_glptr_glUniformMatrix2fv == _check_glUniformMatrix2fv)
+        _glptr_glUniformMatrix2fv = _real_glUniformMatrix2fv;
+    if (_glptr_glUniform4fv == _check_glUniform4fv)
+        _glptr_glUniform4fv = _real_glUniform4fv;
+    if (_glptr_glUniform3iv == _check_glUniform3iv)
+        _glptr_glUniform3iv = _real_glUniform3iv;
+    if (_glptr_glUniform3fv == _check_glUniform3fv)
+        _glptr_glUniform3fv = _real_glUniform3fv;
+    if (_glptr_glUniform2fv == _check_glUniform2fv)
+        _glptr_glUniform2fv = _real_glUniform2fv;
+    if (_glptr_glUniform1iv == _check_glUniform1iv)
+        _glptr_glUniform1iv = _real_glUniform1iv;
+    if (_glptr_glUniform1i == _check_glUniform1i)
+        _glptr_glUniform1i = _real_glUniform1i;
+    if (_glptr_glUniform1fv == _check_glUniform1fv)
+        _glptr_glUniform1fv = _real_glUniform1fv;
+    if (_glptr_glTexSubImage2D == _check_glTexSubImage2D)
+        _glptr_glTexSubImage2D = _real_glTexSubImage2D;
+    if (_glptr_glTexParameteri == _check_glTexParameteri)
+        _glptr_glTexParameteri = _real_glTexParameteri;
+    if (_glptr_glUniform3f == _check_glUniform3f)
+        _glptr_glUniform3f = _real_glUniform3f;
+    if (_glptr_glTexParameterf == _check_glTexParameterf)
+        _glptr_glTexParameterf = _real_glTexParameterf;
+    if (_glptr_glStencilOpSeparate == _check_glStencilOpSeparate)
+        _glptr_glStencilOpSeparate = _real_glStencilOpSeparate;
+    if (_glptr_glStencilMask == _check_glStencilMask)
+        _glptr_glStencilMask = _real_glStencilMask;
+    if (_glptr_glStencilFunc == _check_glStencilFunc)
+        _glptr_glStencilFunc = _real_glStencilFunc;
+    if (_glptr_glShaderSource == _check_glShaderSource)
+        _glptr_glShaderSource = _real_glShaderSource;
+    if (_glptr_glUniform1f == _check_glUniform1f)
+        _glptr_glUniform1f = _real_glUniform1f;
+    if (_glptr_glShaderBinary == _check_glShaderBinary)
+        _glptr_glShaderBinary = _real_glShaderBinary;
+    if (_glptr_glHint == _check_glHint)
+        _glptr_glHint = _real_glHint;
+    if (_glptr_glScissor == _check_glScissor)
+        _glptr_glScissor = _real_glScissor;
+    if (_glptr_glGetBufferParameteriv == _check_glGetBufferParameteriv)
+        _glptr_glGetBufferParameteriv = _real_glGetBufferParameteriv;
+    if (_glptr_glRenderbufferStorage == _check_glRenderbufferStorage)
+        _glptr_glRenderbufferStorage = _real_glRenderbufferStorage;
+    if (_glptr_glReadPixels == _check_glReadPixels)
+        _glptr_glReadPixels = _real_glReadPixels;
+    if (_glptr_glPixelStorei == _check_glPixelStorei)
+        _glptr_glPixelStorei = _real_glPixelStorei;
+    if (_glptr_glDeleteTextures == _check_glDeleteTextures)
+        _glptr_glDeleteTextures = _real_glDeleteTextures;
+    if (_glptr_glIsBuffer == _check_glIsBuffer)
+        _glptr_glIsBuffer = _real_glIsBuffer;
+    if (_glptr_glLineWidth == _check_glLineWidth)
+        _glptr_glLineWidth = _real_glLineWidth;
+    if (_glptr_glIsEnabled == _check_glIsEnabled)
+        _glptr_glIsEnabled = _real_glIsEnabled;
+    if (_glptr_glGetVertexAttribiv == _check_glGetVertexAttribiv)
+        _glptr_glGetVertexAttribiv = _real_glGetVertexAttribiv;
+    if (_glptr_glGetUniformLocation == _check_glGetUniformLocation)
+        _glptr_glGetUniformLocation = _real_glGetUniformLocation;
+    if (_glptr_glGetTexParameteriv == _check_glGetTexParameteriv)
+        _glptr_glGetTexParameteriv = _real_glGetTexParameteriv;
+    if (_glptr_glGetVertexAttribPointerv == _check_glGetVertexAttribPointerv)
+        _glptr_glGetVertexAttribPointerv = _real_glGetVertexAttribPointerv;
+    if (_glptr_glViewport == _check_glViewport)
+        _glptr_glViewport = _real_glViewport;
+    if (_glptr_glGetTexParameterfv == _check_glGetTexParameterfv)
+        _glptr_glGetTexParameterfv = _real_glGetTexParameterfv;
+    if (_glptr_glIsTexture == _check_glIsTexture)
+        _glptr_glIsTexture = _real_glIsTexture;
+    if (_glptr_glGetString == _check_glGetString)
+        _glptr_glGetString = _real_glGetString;
+    if (_glptr_glCopyTexImage2D == _check_glCopyTexImage2D)
+        _glptr_glCopyTexImage2D = _real_glCopyTexImage2D;
+    if (_glptr_glIsProgram == _check_glIsProgram)
+        _glptr_glIsProgram = _real_glIsProgram;
+    if (_glptr_glVertexAttrib4fv == _check_glVertexAttrib4fv)
+        _glptr_glVertexAttrib4fv = _real_glVertexAttrib4fv;
+    if (_glptr_glGetUniformiv == _check_glGetUniformiv)
+        _glptr_glGetUniformiv = _real_glGetUniformiv;
+    if (_glptr_glUniform3i == _check_glUniform3i)
+        _glptr_glUniform3i = _real_glUniform3i;
+    if (_glptr_glGetShaderPrecisionFormat == _check_glGetShaderPrecisionFormat)
+        _glptr_glGetShaderPrecisionFormat = _real_glGetShaderPrecisionFormat;
+    if (_glptr_glGetShaderiv == _check_glGetShaderiv)
+        _glptr_glGetShaderiv = _real_glGetShaderiv;
+    if (_glptr_glGetRenderbufferParameteriv == _check_glGetRenderbufferParameteriv)
+        _glptr_glGetRenderbufferParameteriv = _real_glGetRenderbufferParameteriv;
+    if (_glptr_glGetProgramiv == _check_glGetProgramiv)
+        _glptr_glGetProgramiv = _real_glGetProgramiv;
+    if (_glptr_glGetIntegerv == _check_glGetIntegerv)
+        _glptr_glGetIntegerv = _real_glGetIntegerv;
+    if (_glptr_glGetFloatv == _check_glGetFloatv)
+        _glptr_glGetFloatv = _real_glGetFloatv;
+    if (_glptr_glUniform2i == _check_glUniform2i)
+        _glptr_glUniform2i = _real_glUniform2i;
+    if (_glptr_glGetError == _check_glGetError)
+        _glptr_glGetError = _real_glGetError;
+    if (_glptr_glGetBooleanv == _check_glGetBooleanv)
+        _glptr_glGetBooleanv = _real_glGetBooleanv;
+    if (_glptr_glVertexAttrib4f == _check_glVertexAttrib4f)
+        _glptr_glVertexAttrib4f = _real_glVertexAttrib4f;
+    if (_glptr_glGetAttribLocation == _check_glGetAttribLocation)
+        _glptr_glGetAttribLocation = _real_glGetAttribLocation;
+    if (_glptr_glGetActiveUniform == _check_glGetActiveUniform)
+        _glptr_glGetActiveUniform = _real_glGetActiveUniform;
+    if (_glptr_glTexParameteriv == _check_glTexParameteriv)
+        _glptr_glTexParameteriv = _real_glTexParameteriv;
+    if (_glptr_glGetActiveAttrib == _check_glGetActiveAttrib)
+        _glptr_glGetActiveAttrib = _real_glGetActiveAttrib;
+    if (_glptr_glStencilMaskSeparate == _check_glStencilMaskSeparate)
+        _glptr_glStencilMaskSeparate = _real_glStencilMaskSeparate;
+    if (_glptr_glGenRenderbuffers == _check_glGenRenderbuffers)
+        _glptr_glGenRenderbuffers = _real_glGenRenderbuffers;
+    if (_glptr_glCompressedTexSubImage2D == _check_glCompressedTexSubImage2D)
+        _glptr_glCompressedTexSubImage2D = _real_glCompressedTexSubImage2D;
+    if (_glptr_glGetProgramInfoLog == _check_glGetProgramInfoLog)
+        _glptr_glGetProgramInfoLog = _real_glGetProgramInfoLog;
+    if (_glptr_glDeleteShader == _check_glDeleteShader)
+        _glptr_glDeleteShader = _real_glDeleteShader;
+    if (_glptr_glGenBuffers == _check_glGenBuffers)
+        _glptr_glGenBuffers = _real_glGenBuffers;
+    if (_glptr_glSampleCoverage == _check_glSampleCoverage)
+        _glptr_glSampleCoverage = _real_glSampleCoverage;
+    if (_glptr_glGenTextures == _check_glGenTextures)
+        _glptr_glGenTextures = _real_glGenTextures;
+    if (_glptr_glGetVertexAttribfv == _check_glGetVertexAttribfv)
+        _glptr_glGetVertexAttribfv = _real_glGetVertexAttribfv;
+    if (_glptr_glUniform4iv == _check_glUniform4iv)
+        _glptr_glUniform4iv = _real_glUniform4iv;
+    if (_glptr_glFrontFace == _check_glFrontFace)
+        _glptr_glFrontFace = _real_glFrontFace;
+    if (_glptr_glUniform2iv == _check_glUniform2iv)
+        _glptr_glUniform2iv = _real_glUniform2iv;
+    if (_glptr_glIsShader == _check_glIsShader)
+        _glptr_glIsShader = _real_glIsShader;
+    if (_glptr_glBindFramebuffer == _check_glBindFramebuffer)
+        _glptr_glBindFramebuffer = _real_glBindFramebuffer;
+    if (_glptr_glFramebufferTexture2D == _check_glFramebufferTexture2D)
+        _glptr_glFramebufferTexture2D = _real_glFramebufferTexture2D;
+    if (_glptr_glUniform4i == _check_glUniform4i)
+        _glptr_glUniform4i = _real_glUniform4i;
+    if (_glptr_glClearStencil == _check_glClearStencil)
+        _glptr_glClearStencil = _real_glClearStencil;
+    if (_glptr_glDeleteRenderbuffers == _check_glDeleteRenderbuffers)
+        _glptr_glDeleteRenderbuffers = _real_glDeleteRenderbuffers;
+    if (_glptr_glFinish == _check_glFinish)
+        _glptr_glFinish = _real_glFinish;
+    if (_glptr_glBlendFuncSeparate == _check_glBlendFuncSeparate)
+        _glptr_glBlendFuncSeparate = _real_glBlendFuncSeparate;
+    if (_glptr_glBindAttribLocation == _check_glBindAttribLocation)
+        _glptr_glBindAttribLocation = _real_glBindAttribLocation;
+    if (_glptr_glClear == _check_glClear)
+        _glptr_glClear = _real_glClear;
+    if (_glptr_glEnableVertexAttribArray == _check_glEnableVertexAttribArray)
+        _glptr_glEnableVertexAttribArray = _real_glEnableVertexAttribArray;
+    if (_glptr_glStencilFuncSeparate == _check_glStencilFuncSeparate)
+        _glptr_glStencilFuncSeparate = _real_glStencilFuncSeparate;
+    if (_glptr_glPolygonOffset == _check_glPolygonOffset)
+        _glptr_glPolygonOffset = _real_glPolygonOffset;
+    if (_glptr_glDisable == _check_glDisable)
+        _glptr_glDisable = _real_glDisable;
+    if (_glptr_glDetachShader == _check_glDetachShader)
+        _glptr_glDetachShader = _real_glDetachShader;
+    if (_glptr_glReleaseShaderCompiler == _check_glReleaseShaderCompiler)
+        _glptr_glReleaseShaderCompiler = _real_glReleaseShaderCompiler;
+    if (_glptr_glCompressedTexImage2D == _check_glCompressedTexImage2D)
+        _glptr_glCompressedTexImage2D = _real_glCompressedTexImage2D;
+    if (_glptr_glBindRenderbuffer == _check_glBindRenderbuffer)
+        _glptr_glBindRenderbuffer = _real_glBindRenderbuffer;
+    if (_glptr_glDepthMask == _check_glDepthMask)
+        _glptr_glDepthMask = _real_glDepthMask;
+    if (_glptr_glIsFramebuffer == _check_glIsFramebuffer)
+        _glptr_glIsFramebuffer = _real_glIsFramebuffer;
+    if (_glptr_glGetUniformfv == _check_glGetUniformfv)
+        _glptr_glGetUniformfv = _real_glGetUniformfv;
+    if (_glptr_glUniform4f == _check_glUniform4f)
+        _glptr_glUniform4f = _real_glUniform4f;
+    if (_glptr_glAttachShader == _check_glAttachShader)
+        _glptr_glAttachShader = _real_glAttachShader;
+    if (_glptr_glFramebufferRenderbuffer == _check_glFramebufferRenderbuffer)
+        _glptr_glFramebufferRenderbuffer = _real_glFramebufferRenderbuffer;
+    if (_glptr_glStencilOp == _check_glStencilOp)
+        _glptr_glStencilOp = _real_glStencilOp;
+    if (_glptr_glDisableVertexAttribArray == _check_glDisableVertexAttribArray)
+        _glptr_glDisableVertexAttribArray = _real_glDisableVertexAttribArray;
+    if (_glptr_glIsRenderbuffer == _check_glIsRenderbuffer)
+        _glptr_glIsRenderbuffer = _real_glIsRenderbuffer;
+    if (_glptr_glDeleteProgram == _check_glDeleteProgram)
+        _glptr_glDeleteProgram = _real_glDeleteProgram;
+    if (_glptr_glDrawArrays == _check_glDrawArrays)
+        _glptr_glDrawArrays = _real_glDrawArrays;
+    if (_glptr_glBlendEquationSeparate == _check_glBlendEquationSeparate)
+        _glptr_glBlendEquationSeparate = _real_glBlendEquationSeparate;
+    if (_glptr_glCompileShader == _check_glCompileShader)
+        _glptr_glCompileShader = _real_glCompileShader;
+    if (_glptr_glVertexAttrib1f == _check_glVertexAttrib1f)
+        _glptr_glVertexAttrib1f = _real_glVertexAttrib1f;
+    if (_glptr_glDeleteFramebuffers == _check_glDeleteFramebuffers)
+        _glptr_glDeleteFramebuffers = _real_glDeleteFramebuffers;
+    if (_glptr_glDeleteBuffers == _check_glDeleteBuffers)
+        _glptr_glDeleteBuffers = _real_glDeleteBuffers;
+    if (_glptr_glTexParameterfv == _check_glTexParameterfv)
+        _glptr_glTexParameterfv = _real_glTexParameterfv;
+    if (_glptr_glLinkProgram == _check_glLinkProgram)
+        _glptr_glLinkProgram = _real_glLinkProgram;
+    if (_glptr_glGenerateMipmap == _check_glGenerateMipmap)
+        _glptr_glGenerateMipmap = _real_glGenerateMipmap;
+    if (_glptr_glCullFace == _check_glCullFace)
+        _glptr_glCullFace = _real_glCullFace;
+    if (_glptr_glVertexAttrib2f == _check_glVertexAttrib2f)
+        _glptr_glVertexAttrib2f = _real_glVertexAttrib2f;
+    if (_glptr_glTexImage2D == _check_glTexImage2D)
+        _glptr_glTexImage2D = _real_glTexImage2D;
+    if (_glptr_glDrawElements == _check_glDrawElements)
+        _glptr_glDrawElements = _real_glDrawElements;
+    if (_glptr_glGenFramebuffers == _check_glGenFramebuffers)
+        _glptr_glGenFramebuffers = _real_glGenFramebuffers;
+    if (_glptr_glCreateShader == _check_glCreateShader)
+        _glptr_glCreateShader = _real_glCreateShader;
+    if (_glptr_glGetFramebufferAttachmentParameteriv == _check_glGetFramebufferAttachmentParameteriv)
+        _glptr_glGetFramebufferAttachmentParameteriv = _real_glGetFramebufferAttachmentParameteriv;
+    if (_glptr_glClearColor == _check_glClearColor)
+        _glptr_glClearColor = _real_glClearColor;
+    if (_glptr_glCreateProgram == _check_glCreateProgram)
+        _glptr_glCreateProgram = _real_glCreateProgram;
+    if (_glptr_glClearDepthf == _check_glClearDepthf)
+        _glptr_glClearDepthf = _real_glClearDepthf;
+    if (_glptr_glBlendFunc == _check_glBlendFunc)
+        _glptr_glBlendFunc = _real_glBlendFunc;
+    if (_glptr_glBindBuffer == _check_glBindBuffer)
+        _glptr_glBindBuffer = _real_glBindBuffer;
+    if (_glptr_glGetShaderInfoLog == _check_glGetShaderInfoLog)
+        _glptr_glGetShaderInfoLog = _real_glGetShaderInfoLog;
+    if (_glptr_glCheckFramebufferStatus == _check_glCheckFramebufferStatus)
+        _glptr_glCheckFramebufferStatus = _real_glCheckFramebufferStatus;
+    if (_glptr_glBufferSubData == _check_glBufferSubData)
+        _glptr_glBufferSubData = _real_glBufferSubData;
+    if (_glptr_glActiveTexture == _check_glActiveTexture)
+        _glptr_glActiveTexture = _real_glActiveTexture;
+    if (_glptr_glColorMask == _check_glColorMask)
+        _glptr_glColorMask = _real_glColorMask;
+    if (_glptr_glBufferData == _check_glBufferData)
+        _glptr_glBufferData = _real_glBufferData;
+    if (_glptr_glDepthFunc == _check_glDepthFunc)
+        _glptr_glDepthFunc = _real_glDepthFunc;
+    if (_glptr_glFlush == _check_glFlush)
+        _glptr_glFlush = _real_glFlush;
+    if (_glptr_glCopyTexSubImage2D == _check_glCopyTexSubImage2D)
+        _glptr_glCopyTexSubImage2D = _real_glCopyTexSubImage2D;
+    if (_glptr_glGetAttachedShaders == _check_glGetAttachedShaders)
+        _glptr_glGetAttachedShaders = _real_glGetAttachedShaders;
+    if (_glptr_glDepthRangef == _check_glDepthRangef)
+        _glptr_glDepthRangef = _real_glDepthRangef;
+    if (_glptr_glBlendEquation == _check_glBlendEquation)
+        _glptr_glBlendEquation = _real_glBlendEquation;
+    if (_glptr_glGetShaderSource == _check_glGetShaderSource)
+        _glptr_glGetShaderSource = _real_glGetShaderSource;
+    if (_glptr_glEnable == _check_glEnable)
+        _glptr_glEnable = _real_glEnable;
+    if (_glptr_glBlendColor == _check_glBlendColor)
+        _glptr_glBlendColor = _real_glBlendColor;
+    if (_glptr_glUniform2f == _check_glUniform2f)
+        _glptr_glUniform2f = _real_glUniform2f;
+    if (_glptr_glBindTexture == _check_glBindTexture)
+        _glptr_glBindTexture = _real_glBindTexture;
+}
+
+
+int enableGLChecks(int enable) {
+    if (!enable) {
+        if (glChecksInstalled) {
+            removeGLResetCallback(installGLChecks, NULL);
+            removeGLChecks();
+            glChecksInstalled = 0;
+            glChecksThread = NULL;
+        }
+        return 1;
+    }
+
+    if (glChecksInstalled)
+        return 1;
+    if (!addGLResetCallback(installGLChecks, NULL))
+        return 0;
+    glChecksInstalled = 1;
+    glChecksThread = &glThreadMarker;
+    installGLChecks(NULL);
+    return 1;
+}
+
+
+void takeGLSlowPathCounts(GLSlowPathCounts *counts) {
+    *counts = slowPathCounts;
+    memset(&slowPathCounts, 0, sizeof(slowPathCounts));
+    ++slowPathFrame;
+}
+#endif
@@ -360,573 +360,656 @@ typedef khronos_int32_t  GLfixed;
 /** Custom function to reset all GL function pointers, e.g. after changing contexts */
 void resetGLPointers();
 
+/** Custom function pointer types, for setGLProcLoader(). */
+typedef void (GL_APIENTRY *GLProc)(void);
+typedef GLProc (*GLProcLoader)(const char *name);
+
+/** Custom hook to resolve the function pointers with something other than \
+ * SDL_GL_GetProcAddress(), such as the fake GL of the tests; NULL goes back \
+ * to SDL. Pointers already resolved are kept until resetGLPointers().
+ */
+void setGLProcLoader(GLProcLoader loader);
+
+/** Custom function to resolve every GL function pointer that is still lazy.
+ * Needs a current context. Layers that wrap the pointers call this first, so
+ * the pointers they save are the real entry points.
+ */
+void loadGLPointers();
+
+/** Custom callback, run at the end of every resetGLPointers() call so layers \
+ * that wrap function pointers (profiling, tracing, error checks) can install \
+ * themselves again. Callbacks run in the order they were added.
+ */
+typedef void (*GLResetCallback)(void *user_data);
+
+/** Register a reset callback. Returns 0 if too many are registered already. */
+int addGLResetCallback(GLResetCallback callback, void *user_data);
+
+/** Remove a reset callback registered with the same user data. */
+void removeGLResetCallback(GLResetCallback callback, void *user_data);
+
+#ifdef LYS_DEBUG
+#if defined(_MSC_VER)
+#define LYS_GL_THREAD_LOCAL __declspec(thread)
+#else
+#define LYS_GL_THREAD_LOCAL __thread
+#endif
+
+/** Custom call-site tracking: in LYS_DEBUG builds every gl* macro stores \
+ * where it was used before making the call, for the debug layer to report. \
+ * Each thread has its own. Other builds call the function pointers directly.
+ */
+typedef struct GLCallSite {
+    const char *file;
+    int line;
+} GLCallSite;
+extern LYS_GL_THREAD_LOCAL GLCallSite _glCallSite;
+#define LYS_GL_CALL(pointer) (_glCallSite.file = __FILE__, _glCallSite.line = __LINE__, pointer)
+
+/** Custom counts of the calls the debug layer knows to be slow. */
+typedef struct GLSlowPathCounts {
+    /** Calls that raised a GL error */
+    unsigned int errors;
+    /** glGet*, glIs*, glCheckFramebufferStatus, glReadPixels and glFinish, \
+     * which wait for the driver (or the GPU) to catch up
+     */
+    unsigned int queries;
+    /** Binding the buffer, texture, framebuffer, renderbuffer or program \
+     * that is already bound
+     */
+    unsigned int redundantBinds;
+    /** Enabling or disabling a capability that already is */
+    unsigned int redundantStates;
+} GLSlowPathCounts;
+
+/** Custom debug layer, in LYS_DEBUG builds only. Wraps every function \
+ * pointer so each call is followed by glGetError(); errors are logged with \
+ * the call site and arguments, and the application's own glGetError() \
+ * calls see none. Slow paths are counted, and call sites that make them \
+ * frame after frame are logged once. Enabling needs a current context; \
+ * the layer reinstalls itself whenever the pointers are reset. Bindings \
+ * and slow paths are only tracked on the enabling thread, whose context \
+ * they describe; errors are logged from every thread. \
+ * Returns 0 if too many reset callbacks are registered.
+ */
+int enableGLChecks(int enable);
+
+/** Custom debug layer function to get the slow path counts since the last \
+ * call and start new ones; call it once a frame, on the enabling thread, \
+ * and again after any calls to leave out of the counts.
+ */
+void takeGLSlowPathCounts(GLSlowPathCounts *counts);
+#else
+#define LYS_GL_CALL(pointer) pointer
+#endif
+
 typedef void  (GL_APIENTRY *PFN_glVertexAttribPointer)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void * pointer);
 extern PFN_glVertexAttribPointer _glptr_glVertexAttribPointer;
-#define glVertexAttribPointer _glptr_glVertexAttribPointer
+#define glVertexAttribPointer LYS_GL_CALL(_glptr_glVertexAttribPointer)
 
 typedef void  (GL_APIENTRY *PFN_glVertexAttrib3fv)(GLuint index, const GLfloat * v);
 extern PFN_glVertexAttrib3fv _glptr_glVertexAttrib3fv;
-#define glVertexAttrib3fv _glptr_glVertexAttrib3fv
+#define glVertexAttrib3fv LYS_GL_CALL(_glptr_glVertexAttrib3fv)
 
 typedef void  (GL_APIENTRY *PFN_glVertexAttrib3f)(GLuint index, GLfloat x, GLfloat y, GLfloat z);
 extern PFN_glVertexAttrib3f _glptr_glVertexAttrib3f;
-#define glVertexAttrib3f _glptr_glVertexAttrib3f
+#define glVertexAttrib3f LYS_GL_CALL(_glptr_glVertexAttrib3f)
 
 typedef void  (GL_APIENTRY *PFN_glVertexAttrib2fv)(GLuint index, const GLfloat * v);
 extern PFN_glVertexAttrib2fv _glptr_glVertexAttrib2fv;
-#define glVertexAttrib2fv _glptr_glVertexAttrib2fv
+#define glVertexAttrib2fv LYS_GL_CALL(_glptr_glVertexAttrib2fv)
 
 typedef void  (GL_APIENTRY *PFN_glVertexAttrib1fv)(GLuint index, const GLfloat * v);
 extern PFN_glVertexAttrib1fv _glptr_glVertexAttrib1fv;
-#define glVertexAttrib1fv _glptr_glVertexAttrib1fv
+#define glVertexAttrib1fv LYS_GL_CALL(_glptr_glVertexAttrib1fv)
 
 typedef void  (GL_APIENTRY *PFN_glValidateProgram)(GLuint program);
 extern PFN_glValidateProgram _glptr_glValidateProgram;
-#define glValidateProgram _glptr_glValidateProgram
+#define glValidateProgram LYS_GL_CALL(_glptr_glValidateProgram)
 
 typedef void  (GL_APIENTRY *PFN_glUseProgram)(GLuint program);
 extern PFN_glUseProgram _glptr_glUseProgram;
-#define glUseProgram _glptr_glUseProgram
+#define glUseProgram LYS_GL_CALL(_glptr_glUseProgram)
 
 typedef void  (GL_APIENTRY *PFN_glUniformMatrix4fv)(GLint location, GLsizei count, GLboolean transpose, const GLfloat * value);
 extern PFN_glUniformMatrix4fv _glptr_glUniformMatrix4fv;
-#define glUniformMatrix4fv _glptr_glUniformMatrix4fv
+#define glUniformMatrix4fv LYS_GL_CALL(_glptr_glUniformMatrix4fv)
 
 typedef void  (GL_APIENTRY *PFN_glUniformMatrix3fv)(GLint location, GLsizei count, GLboolean transpose, const GLfloat * value);
 extern PFN_glUniformMatrix3fv _glptr_glUniformMatrix3fv;
-#define glUniformMatrix3fv _glptr_glUniformMatrix3fv
+#define glUniformMatrix3fv LYS_GL_CALL(_glptr_glUniformMatrix3fv)
 
 typedef void  (GL_APIENTRY *PFN_glUniformMatrix2fv)(GLint location, GLsizei count, GLboolean transpose, const GLfloat * value);
 extern PFN_glUniformMatrix2fv _glptr_glUniformMatrix2fv;
-#define glUniformMatrix2fv _glptr_glUniformMatrix2fv
+#define glUniformMatrix2fv LYS_GL_CALL(_glptr_glUniformMatrix2fv)
 
 typedef void  (GL_APIENTRY *PFN_glUniform4fv)(GLint location, GLsizei count, const GLfloat * value);
 extern PFN_glUniform4fv _glptr_glUniform4fv;
-#define glUniform4fv _glptr_glUniform4fv
+#define glUniform4fv LYS_GL_CALL(_glptr_glUniform4fv)
 
 typedef void  (GL_APIENTRY *PFN_glUniform3iv)(GLint location, GLsizei count, const GLint * value);
 extern PFN_glUniform3iv _glptr_glUniform3iv;
-#define glUniform3iv _glptr_glUniform3iv
+#define glUniform3iv LYS_GL_CALL(_glptr_glUniform3iv)
 
 typedef void  (GL_APIENTRY *PFN_glUniform3fv)(GLint location, GLsizei count, const GLfloat * value);
 extern PFN_glUniform3fv _glptr_glUniform3fv;
-#define glUniform3fv _glptr_glUniform3fv
+#define glUniform3fv LYS_GL_CALL(_glptr_glUniform3fv)
 
 typedef void  (GL_APIENTRY *PFN_glUniform2fv)(GLint location, GLsizei count, const GLfloat * value);
 extern PFN_glUniform2fv _glptr_glUniform2fv;
-#define glUniform2fv _glptr_glUniform2fv
+#define glUniform2fv LYS_GL_CALL(_glptr_glUniform2fv)
 
 typedef void  (GL_APIENTRY *PFN_glUniform1iv)(GLint location, GLsizei count, const GLint * value);
 extern PFN_glUniform1iv _glptr_glUniform1iv;
-#define glUniform1iv _glptr_glUniform1iv
+#define glUniform1iv LYS_GL_CALL(_glptr_glUniform1iv)
 
 typedef void  (GL_APIENTRY *PFN_glUniform1i)(GLint location, GLint v0);
 extern PFN_glUniform1i _glptr_glUniform1i;
-#define glUniform1i _glptr_glUniform1i
+#define glUniform1i LYS_GL_CALL(_glptr_glUniform1i)
 
 typedef void  (GL_APIENTRY *PFN_glUniform1fv)(GLint location, GLsizei count, const GLfloat * value);
 extern PFN_glUniform1fv _glptr_glUniform1fv;
-#define glUniform1fv _glptr_glUniform1fv
+#define glUniform1fv LYS_GL_CALL(_glptr_glUniform1fv)
 
 typedef void  (GL_APIENTRY *PFN_glTexSubImage2D)(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void * pixels);
 extern PFN_glTexSubImage2D _glptr_glTexSubImage2D;
-#define glTexSubImage2D _glptr_glTexSubImage2D
+#define glTexSubImage2D LYS_GL_CALL(_glptr_glTexSubImage2D)
 
 typedef void  (GL_APIENTRY *PFN_glTexParameteri)(GLenum target, GLenum pname, GLint param);
 extern PFN_glTexParameteri _glptr_glTexParameteri;
-#define glTexParameteri _glptr_glTexParameteri
+#define glTexParameteri LYS_GL_CALL(_glptr_glTexParameteri)
 
 typedef void  (GL_APIENTRY *PFN_glUniform3f)(GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
 extern PFN_glUniform3f _glptr_glUniform3f;
-#define glUniform3f _glptr_glUniform3f
+#define glUniform3f LYS_GL_CALL(_glptr_glUniform3f)
 
 typedef void  (GL_APIENTRY *PFN_glTexParameterf)(GLenum target, GLenum pname, GLfloat param);
 extern PFN_glTexParameterf _glptr_glTexParameterf;
-#define glTexParameterf _glptr_glTexParameterf
+#define glTexParameterf LYS_GL_CALL(_glptr_glTexParameterf)
 
 typedef void  (GL_APIENTRY *PFN_glStencilOpSeparate)(GLenum face, GLenum sfail, GLenum dpfail, GLenum dppass);
 extern PFN_glStencilOpSeparate _glptr_glStencilOpSeparate;
-#define glStencilOpSeparate _glptr_glStencilOpSeparate
+#define glStencilOpSeparate LYS_GL_CALL(_glptr_glStencilOpSeparate)
 
 typedef void  (GL_APIENTRY *PFN_glStencilMask)(GLuint mask);
 extern PFN_glStencilMask _glptr_glStencilMask;
-#define glStencilMask _glptr_glStencilMask
+#define glStencilMask LYS_GL_CALL(_glptr_glStencilMask)
 
 typedef void  (GL_APIENTRY *PFN_glStencilFunc)(GLenum func, GLint ref, GLuint mask);
 extern PFN_glStencilFunc _glptr_glStencilFunc;
-#define glStencilFunc _glptr_glStencilFunc
+#define glStencilFunc LYS_GL_CALL(_glptr_glStencilFunc)
 
 typedef void  (GL_APIENTRY *PFN_glShaderSource)(GLuint shader, GLsizei count, const GLchar *const* string, const GLint * length);
 extern PFN_glShaderSource _glptr_glShaderSource;
-#define glShaderSource _glptr_glShaderSource
+#define glShaderSource LYS_GL_CALL(_glptr_glShaderSource)
 
 typedef void  (GL_APIENTRY *PFN_glUniform1f)(GLint location, GLfloat v0);
 extern PFN_glUniform1f _glptr_glUniform1f;
-#define glUniform1f _glptr_glUniform1f
+#define glUniform1f LYS_GL_CALL(_glptr_glUniform1f)
 
 typedef void  (GL_APIENTRY *PFN_glShaderBinary)(GLsizei count, const GLuint * shaders, GLenum binaryformat, const void * binary, GLsizei length);
 extern PFN_glShaderBinary _glptr_glShaderBinary;
-#define glShaderBinary _glptr_glShaderBinary
+#define glShaderBinary LYS_GL_CALL(_glptr_glShaderBinary)
 
 typedef void  (GL_APIENTRY *PFN_glHint)(GLenum target, GLenum mode);
 extern PFN_glHint _glptr_glHint;
-#define glHint _glptr_glHint
+#define glHint LYS_GL_CALL(_glptr_glHint)
 
 typedef void  (GL_APIENTRY *PFN_glScissor)(GLint x, GLint y, GLsizei width, GLsizei height);
 extern PFN_glScissor _glptr_glScissor;
-#define glScissor _glptr_glScissor
+#define glScissor LYS_GL_CALL(_glptr_glScissor)
 
 typedef void  (GL_APIENTRY *PFN_glGetBufferParameteriv)(GLenum target, GLenum pname, GLint * params);
 extern PFN_glGetBufferParameteriv _glptr_glGetBufferParameteriv;
-#define glGetBufferParameteriv _glptr_glGetBufferParameteriv
+#define glGetBufferParameteriv LYS_GL_CALL(_glptr_glGetBufferParameteriv)
 
 typedef void  (GL_APIENTRY *PFN_glRenderbufferStorage)(GLenum target, GLenum internalformat, GLsizei width, GLsizei height);
 extern PFN_glRenderbufferStorage _glptr_glRenderbufferStorage;
-#define glRenderbufferStorage _glptr_glRenderbufferStorage
+#define glRenderbufferStorage LYS_GL_CALL(_glptr_glRenderbufferStorage)
 
 typedef void  (GL_APIENTRY *PFN_glReadPixels)(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void * pixels);
 extern PFN_glReadPixels _glptr_glReadPixels;
-#define glReadPixels _glptr_glReadPixels
+#define glReadPixels LYS_GL_CALL(_glptr_glReadPixels)
 
 typedef void  (GL_APIENTRY *PFN_glPixelStorei)(GLenum pname, GLint param);
 extern PFN_glPixelStorei _glptr_glPixelStorei;
-#define glPixelStorei _glptr_glPixelStorei
+#define glPixelStorei LYS_GL_CALL(_glptr_glPixelStorei)
 
 typedef void  (GL_APIENTRY *PFN_glDeleteTextures)(GLsizei n, const GLuint * textures);
 extern PFN_glDeleteTextures _glptr_glDeleteTextures;
-#define glDeleteTextures _glptr_glDeleteTextures
+#define glDeleteTextures LYS_GL_CALL(_glptr_glDeleteTextures)
 
 typedef GLboolean (GL_APIENTRY *PFN_glIsBuffer)(GLuint buffer);
 extern PFN_glIsBuffer _glptr_glIsBuffer;
-#define glIsBuffer _glptr_glIsBuffer
+#define glIsBuffer LYS_GL_CALL(_glptr_glIsBuffer)
 
 typedef void  (GL_APIENTRY *PFN_glLineWidth)(GLfloat width);
 extern PFN_glLineWidth _glptr_glLineWidth;
-#define glLineWidth _glptr_glLineWidth
+#define glLineWidth LYS_GL_CALL(_glptr_glLineWidth)
 
 typedef GLboolean (GL_APIENTRY *PFN_glIsEnabled)(GLenum cap);
 extern PFN_glIsEnabled _glptr_glIsEnabled;
-#define glIsEnabled _glptr_glIsEnabled
+#define glIsEnabled LYS_GL_CALL(_glptr_glIsEnabled)
 
 typedef void  (GL_APIENTRY *PFN_glGetVertexAttribiv)(GLuint index, GLenum pname, GLint * params);
 extern PFN_glGetVertexAttribiv _glptr_glGetVertexAttribiv;
-#define glGetVertexAttribiv _glptr_glGetVertexAttribiv
+#define glGetVertexAttribiv LYS_GL_CALL(_glptr_glGetVertexAttribiv)
 
 typedef GLint (GL_APIENTRY *PFN_glGetUniformLocation)(GLuint program, const GLchar * name);
 extern PFN_glGetUniformLocation _glptr_glGetUniformLocation;
-#define glGetUniformLocation _glptr_glGetUniformLocation
+#define glGetUniformLocation LYS_GL_CALL(_glptr_glGetUniformLocation)
 
 typedef void  (GL_APIENTRY *PFN_glGetTexParameteriv)(GLenum target, GLenum pname, GLint * params);
 extern PFN_glGetTexParameteriv _glptr_glGetTexParameteriv;
-#define glGetTexParameteriv _glptr_glGetTexParameteriv
+#define glGetTexParameteriv LYS_GL_CALL(_glptr_glGetTexParameteriv)
 
 typedef void  (GL_APIENTRY *PFN_glGetVertexAttribPointerv)(GLuint index, GLenum pname, void ** pointer);
 extern PFN_glGetVertexAttribPointerv _glptr_glGetVertexAttribPointerv;
-#define glGetVertexAttribPointerv _glptr_glGetVertexAttribPointerv
+#define glGetVertexAttribPointerv LYS_GL_CALL(_glptr_glGetVertexAttribPointerv)
 
 typedef void  (GL_APIENTRY *PFN_glViewport)(GLint x, GLint y, GLsizei width, GLsizei height);
 extern PFN_glViewport _glptr_glViewport;
-#define glViewport _glptr_glViewport
+#define glViewport LYS_GL_CALL(_glptr_glViewport)
 
 typedef void  (GL_APIENTRY *PFN_glGetTexParameterfv)(GLenum target, GLenum pname, GLfloat * params);
 extern PFN_glGetTexParameterfv _glptr_glGetTexParameterfv;
-#define glGetTexParameterfv _glptr_glGetTexParameterfv
+#define glGetTexParameterfv LYS_GL_CALL(_glptr_glGetTexParameterfv)
 
 typedef GLboolean (GL_APIENTRY *PFN_glIsTexture)(GLuint texture);
 extern PFN_glIsTexture _glptr_glIsTexture;
-#define glIsTexture _glptr_glIsTexture
+#define glIsTexture LYS_GL_CALL(_glptr_glIsTexture)
 
 typedef const GLubyte * (GL_APIENTRY *PFN_glGetString)(GLenum name);
 extern PFN_glGetString _glptr_glGetString;
-#define glGetString _glptr_glGetString
+#define glGetString LYS_GL_CALL(_glptr_glGetString)
 
 typedef void  (GL_APIENTRY *PFN_glCopyTexImage2D)(GLenum target, GLint level, GLenum internalformat, GLint x, GLint y, GLsizei width, GLsizei height, GLint border);
 extern PFN_glCopyTexImage2D _glptr_glCopyTexImage2D;
-#define glCopyTexImage2D _glptr_glCopyTexImage2D
+#define glCopyTexImage2D LYS_GL_CALL(_glptr_glCopyTexImage2D)
 
 typedef GLboolean (GL_APIENTRY *PFN_glIsProgram)(GLuint program);
 extern PFN_glIsProgram _glptr_glIsProgram;
-#define glIsProgram _glptr_glIsProgram
+#define glIsProgram LYS_GL_CALL(_glptr_glIsProgram)
 
 typedef void  (GL_APIENTRY *PFN_glVertexAttrib4fv)(GLuint index, const GLfloat * v);
 extern PFN_glVertexAttrib4fv _glptr_glVertexAttrib4fv;
-#define glVertexAttrib4fv _glptr_glVertexAttrib4fv
+#define glVertexAttrib4fv LYS_GL_CALL(_glptr_glVertexAttrib4fv)
 
 typedef void  (GL_APIENTRY *PFN_glGetUniformiv)(GLuint program, GLint location, GLint * params);
 extern PFN_glGetUniformiv _glptr_glGetUniformiv;
-#define glGetUniformiv _glptr_glGetUniformiv
+#define glGetUniformiv LYS_GL_CALL(_glptr_glGetUniformiv)
 
 typedef void  (GL_APIENTRY *PFN_glUniform3i)(GLint location, GLint v0, GLint v1, GLint v2);
 extern PFN_glUniform3i _glptr_glUniform3i;
-#define glUniform3i _glptr_glUniform3i
+#define glUniform3i LYS_GL_CALL(_glptr_glUniform3i)
 
 typedef void  (GL_APIENTRY *PFN_glGetShaderPrecisionFormat)(GLenum shadertype, GLenum precisiontype, GLint * range, GLint * precision);
 extern PFN_glGetShaderPrecisionFormat _glptr_glGetShaderPrecisionFormat;
-#define glGetShaderPrecisionFormat _glptr_glGetShaderPrecisionFormat
+#define glGetShaderPrecisionFormat LYS_GL_CALL(_glptr_glGetShaderPrecisionFormat)
 
 typedef void  (GL_APIENTRY *PFN_glGetShaderiv)(GLuint shader, GLenum pname, GLint * params);
 extern PFN_glGetShaderiv _glptr_glGetShaderiv;
-#define glGetShaderiv _glptr_glGetShaderiv
+#define glGetShaderiv LYS_GL_CALL(_glptr_glGetShaderiv)
 
 typedef void  (GL_APIENTRY *PFN_glGetRenderbufferParameteriv)(GLenum target, GLenum pname, GLint * params);
 extern PFN_glGetRenderbufferParameteriv _glptr_glGetRenderbufferParameteriv;
-#define glGetRenderbufferParameteriv _glptr_glGetRenderbufferParameteriv
+#define glGetRenderbufferParameteriv LYS_GL_CALL(_glptr_glGetRenderbufferParameteriv)
 
 typedef void  (GL_APIENTRY *PFN_glGetProgramiv)(GLuint program, GLenum pname, GLint * params);
 extern PFN_glGetProgramiv _glptr_glGetProgramiv;
-#define glGetProgramiv _glptr_glGetProgramiv
+#define glGetProgramiv LYS_GL_CALL(_glptr_glGetProgramiv)
 
 typedef void  (GL_APIENTRY *PFN_glGetIntegerv)(GLenum pname, GLint * data);
 extern PFN_glGetIntegerv _glptr_glGetIntegerv;
-#define glGetIntegerv _glptr_glGetIntegerv
+#define glGetIntegerv LYS_GL_CALL(_glptr_glGetIntegerv)
 
 typedef void  (GL_APIENTRY *PFN_glGetFloatv)(GLenum pname, GLfloat * data);
 extern PFN_glGetFloatv _glptr_glGetFloatv;
-#define glGetFloatv _glptr_glGetFloatv
+#define glGetFloatv LYS_GL_CALL(_glptr_glGetFloatv)
 
 typedef void  (GL_APIENTRY *PFN_glUniform2i)(GLint location, GLint v0, GLint v1);
 extern PFN_glUniform2i _glptr_glUniform2i;
-#define glUniform2i _glptr_glUniform2i
+#define glUniform2i LYS_GL_CALL(_glptr_glUniform2i)
 
 typedef GLenum (GL_APIENTRY *PFN_glGetError)();
 extern PFN_glGetError _glptr_glGetError;
-#define glGetError _glptr_glGetError
+#define glGetError LYS_GL_CALL(_glptr_glGetError)
 
 typedef void  (GL_APIENTRY *PFN_glGetBooleanv)(GLenum pname, GLboolean * data);
 extern PFN_glGetBooleanv _glptr_glGetBooleanv;
-#define glGetBooleanv _glptr_glGetBooleanv
+#define glGetBooleanv LYS_GL_CALL(_glptr_glGetBooleanv)
 
 typedef void  (GL_APIENTRY *PFN_glVertexAttrib4f)(GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
 extern PFN_glVertexAttrib4f _glptr_glVertexAttrib4f;
-#define glVertexAttrib4f _glptr_glVertexAttrib4f
+#define glVertexAttrib4f LYS_GL_CALL(_glptr_glVertexAttrib4f)
 
 typedef GLint (GL_APIENTRY *PFN_glGetAttribLocation)(GLuint program, const GLchar * name);
 extern PFN_glGetAttribLocation _glptr_glGetAttribLocation;
-#define glGetAttribLocation _glptr_glGetAttribLocation
+#define glGetAttribLocation LYS_GL_CALL(_glptr_glGetAttribLocation)
 
 typedef void  (GL_APIENTRY *PFN_glGetActiveUniform)(GLuint program, GLuint index, GLsizei bufSize, GLsizei * length, GLint * size, GLenum * type, GLchar * name);
 extern PFN_glGetActiveUniform _glptr_glGetActiveUniform;
-#define glGetActiveUniform _glptr_glGetActiveUniform
+#define glGetActiveUniform LYS_GL_CALL(_glptr_glGetActiveUniform)
 
 typedef void  (GL_APIENTRY *PFN_glTexParameteriv)(GLenum target, GLenum pname, const GLint * params);
 extern PFN_glTexParameteriv _glptr_glTexParameteriv;
-#define glTexParameteriv _glptr_glTexParameteriv
+#define glTexParameteriv LYS_GL_CALL(_glptr_glTexParameteriv)
 
 typedef void  (GL_APIENTRY *PFN_glGetActiveAttrib)(GLuint program, GLuint index, GLsizei bufSize, GLsizei * length, GLint * size, GLenum * type, GLchar * name);
 extern PFN_glGetActiveAttrib _glptr_glGetActiveAttrib;
-#define glGetActiveAttrib _glptr_glGetActiveAttrib
+#define glGetActiveAttrib LYS_GL_CALL(_glptr_glGetActiveAttrib)
 
 typedef void  (GL_APIENTRY *PFN_glStencilMaskSeparate)(GLenum face, GLuint mask);
 extern PFN_glStencilMaskSeparate _glptr_glStencilMaskSeparate;
-#define glStencilMaskSeparate _glptr_glStencilMaskSeparate
+#define glStencilMaskSeparate LYS_GL_CALL(_glptr_glStencilMaskSeparate)
 
 typedef void  (GL_APIENTRY *PFN_glGenRenderbuffers)(GLsizei n, GLuint * renderbuffers);
 extern PFN_glGenRenderbuffers _glptr_glGenRenderbuffers;
-#define glGenRenderbuffers _glptr_glGenRenderbuffers
+#define glGenRenderbuffers LYS_GL_CALL(_glptr_glGenRenderbuffers)
 
 typedef void  (GL_APIENTRY *PFN_glCompressedTexSubImage2D)(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void * data);
 extern PFN_glCompressedTexSubImage2D _glptr_glCompressedTexSubImage2D;
-#define glCompressedTexSubImage2D _glptr_glCompressedTexSubImage2D
+#define glCompressedTexSubImage2D LYS_GL_CALL(_glptr_glCompressedTexSubImage2D)
 
 typedef void  (GL_APIENTRY *PFN_glGetProgramInfoLog)(GLuint program, GLsizei bufSize, GLsizei * length, GLchar * infoLog);
 extern PFN_glGetProgramInfoLog _glptr_glGetProgramInfoLog;
-#define glGetProgramInfoLog _glptr_glGetProgramInfoLog
+#define glGetProgramInfoLog LYS_GL_CALL(_glptr_glGetProgramInfoLog)
 
 typedef void  (GL_APIENTRY *PFN_glDeleteShader)(GLuint shader);
 extern PFN_glDeleteShader _glptr_glDeleteShader;
-#define glDeleteShader _glptr_glDeleteShader
+#define glDeleteShader LYS_GL_CALL(_glptr_glDeleteShader)
 
 typedef void  (GL_APIENTRY *PFN_glGenBuffers)(GLsizei n, GLuint * buffers);
 extern PFN_glGenBuffers _glptr_glGenBuffers;
-#define glGenBuffers _glptr_glGenBuffers
+#define glGenBuffers LYS_GL_CALL(_glptr_glGenBuffers)
 
 typedef void  (GL_APIENTRY *PFN_glSampleCoverage)(GLfloat value, GLboolean invert);
 extern PFN_glSampleCoverage _glptr_glSampleCoverage;
-#define glSampleCoverage _glptr_glSampleCoverage
+#define glSampleCoverage LYS_GL_CALL(_glptr_glSampleCoverage)
 
 typedef void  (GL_APIENTRY *PFN_glGenTextures)(GLsizei n, GLuint * textures);
 extern PFN_glGenTextures _glptr_glGenTextures;
-#define glGenTextures _glptr_glGenTextures
+#define glGenTextures LYS_GL_CALL(_glptr_glGenTextures)
 
 typedef void  (GL_APIENTRY *PFN_glGetVertexAttribfv)(GLuint index, GLenum pname, GLfloat * params);
 extern PFN_glGetVertexAttribfv _glptr_glGetVertexAttribfv;
-#define glGetVertexAttribfv _glptr_glGetVertexAttribfv
+#define glGetVertexAttribfv LYS_GL_CALL(_glptr_glGetVertexAttribfv)
 
 typedef void  (GL_APIENTRY *PFN_glUniform4iv)(GLint location, GLsizei count, const GLint * value);
 extern PFN_glUniform4iv _glptr_glUniform4iv;
-#define glUniform4iv _glptr_glUniform4iv
+#define glUniform4iv LYS_GL_CALL(_glptr_glUniform4iv)
 
 typedef void  (GL_APIENTRY *PFN_glFrontFace)(GLenum mode);
 extern PFN_glFrontFace _glptr_glFrontFace;
-#define glFrontFace _glptr_glFrontFace
+#define glFrontFace LYS_GL_CALL(_glptr_glFrontFace)
 
 typedef void  (GL_APIENTRY *PFN_glUniform2iv)(GLint location, GLsizei count, const GLint * value);
 extern PFN_glUniform2iv _glptr_glUniform2iv;
-#define glUniform2iv _glptr_glUniform2iv
+#define glUniform2iv LYS_GL_CALL(_glptr_glUniform2iv)
 
 typedef GLboolean (GL_APIENTRY *PFN_glIsShader)(GLuint shader);
 extern PFN_glIsShader _glptr_glIsShader;
-#define glIsShader _glptr_glIsShader
+#define glIsShader LYS_GL_CALL(_glptr_glIsShader)
 
 typedef void  (GL_APIENTRY *PFN_glBindFramebuffer)(GLenum target, GLuint framebuffer);
 extern PFN_glBindFramebuffer _glptr_glBindFramebuffer;
-#define glBindFramebuffer _glptr_glBindFramebuffer
+#define glBindFramebuffer LYS_GL_CALL(_glptr_glBindFramebuffer)
 
 typedef void  (GL_APIENTRY *PFN_glFramebufferTexture2D)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
 extern PFN_glFramebufferTexture2D _glptr_glFramebufferTexture2D;
-#define glFramebufferTexture2D _glptr_glFramebufferTexture2D
+#define glFramebufferTexture2D LYS_GL_CALL(_glptr_glFramebufferTexture2D)
 
 typedef void  (GL_APIENTRY *PFN_glUniform4i)(GLint location, GLint v0, GLint v1, GLint v2, GLint v3);
 extern PFN_glUniform4i _glptr_glUniform4i;
-#define glUniform4i _glptr_glUniform4i
+#define glUniform4i LYS_GL_CALL(_glptr_glUniform4i)
 
 typedef void  (GL_APIENTRY *PFN_glClearStencil)(GLint s);
 extern PFN_glClearStencil _glptr_glClearStencil;
-#define glClearStencil _glptr_glClearStencil
+#define glClearStencil LYS_GL_CALL(_glptr_glClearStencil)
 
 typedef void  (GL_APIENTRY *PFN_glDeleteRenderbuffers)(GLsizei n, const GLuint * renderbuffers);
 extern PFN_glDeleteRenderbuffers _glptr_glDeleteRenderbuffers;
-#define glDeleteRenderbuffers _glptr_glDeleteRenderbuffers
+#define glDeleteRenderbuffers LYS_GL_CALL(_glptr_glDeleteRenderbuffers)
 
 typedef void  (GL_APIENTRY *PFN_glFinish)();
 extern PFN_glFinish _glptr_glFinish;
-#define glFinish _glptr_glFinish
+#define glFinish LYS_GL_CALL(_glptr_glFinish)
 
 typedef void  (GL_APIENTRY *PFN_glBlendFuncSeparate)(GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha);
 extern PFN_glBlendFuncSeparate _glptr_glBlendFuncSeparate;
-#define glBlendFuncSeparate _glptr_glBlendFuncSeparate
+#define glBlendFuncSeparate LYS_GL_CALL(_glptr_glBlendFuncSeparate)
 
 typedef void  (GL_APIENTRY *PFN_glBindAttribLocation)(GLuint program, GLuint index, const GLchar * name);
 extern PFN_glBindAttribLocation _glptr_glBindAttribLocation;
-#define glBindAttribLocation _glptr_glBindAttribLocation
+#define glBindAttribLocation LYS_GL_CALL(_glptr_glBindAttribLocation)
 
 typedef void  (GL_APIENTRY *PFN_glClear)(GLbitfield mask);
 extern PFN_glClear _glptr_glClear;
-#define glClear _glptr_glClear
+#define glClear LYS_GL_CALL(_glptr_glClear)
 
 typedef void  (GL_APIENTRY *PFN_glEnableVertexAttribArray)(GLuint index);
 extern PFN_glEnableVertexAttribArray _glptr_glEnableVertexAttribArray;
-#define glEnableVertexAttribArray _glptr_glEnableVertexAttribArray
+#define glEnableVertexAttribArray LYS_GL_CALL(_glptr_glEnableVertexAttribArray)
 
 typedef void  (GL_APIENTRY *PFN_glStencilFuncSeparate)(GLenum face, GLenum func, GLint ref, GLuint mask);
 extern PFN_glStencilFuncSeparate _glptr_glStencilFuncSeparate;
-#define glStencilFuncSeparate _glptr_glStencilFuncSeparate
+#define glStencilFuncSeparate LYS_GL_CALL(_glptr_glStencilFuncSeparate)
 
 typedef void  (GL_APIENTRY *PFN_glPolygonOffset)(GLfloat factor, GLfloat units);
 extern PFN_glPolygonOffset _glptr_glPolygonOffset;
-#define glPolygonOffset _glptr_glPolygonOffset
+#define glPolygonOffset LYS_GL_CALL(_glptr_glPolygonOffset)
 
 typedef void  (GL_APIENTRY *PFN_glDisable)(GLenum cap);
 extern PFN_glDisable _glptr_glDisable;
-#define glDisable _glptr_glDisable
+#define glDisable LYS_GL_CALL(_glptr_glDisable)
 
 typedef void  (GL_APIENTRY *PFN_glDetachShader)(GLuint program, GLuint shader);
 extern PFN_glDetachShader _glptr_glDetachShader;
-#define glDetachShader _glptr_glDetachShader
+#define glDetachShader LYS_GL_CALL(_glptr_glDetachShader)
 
 typedef void  (GL_APIENTRY *PFN_glReleaseShaderCompiler)();
 extern PFN_glReleaseShaderCompiler _glptr_glReleaseShaderCompiler;
-#define glReleaseShaderCompiler _glptr_glReleaseShaderCompiler
+#define glReleaseShaderCompiler LYS_GL_CALL(_glptr_glReleaseShaderCompiler)
 
 typedef void  (GL_APIENTRY *PFN_glCompressedTexImage2D)(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void * data);
 extern PFN_glCompressedTexImage2D _glptr_glCompressedTexImage2D;
-#define glCompressedTexImage2D _glptr_glCompressedTexImage2D
+#define glCompressedTexImage2D LYS_GL_CALL(_glptr_glCompressedTexImage2D)
 
 typedef void  (GL_APIENTRY *PFN_glBindRenderbuffer)(GLenum target, GLuint renderbuffer);
 extern PFN_glBindRenderbuffer _glptr_glBindRenderbuffer;
-#define glBindRenderbuffer _glptr_glBindRenderbuffer
+#define glBindRenderbuffer LYS_GL_CALL(_glptr_glBindRenderbuffer)
 
 typedef void  (GL_APIENTRY *PFN_glDepthMask)(GLboolean flag);
 extern PFN_glDepthMask _glptr_glDepthMask;
-#define glDepthMask _glptr_glDepthMask
+#define glDepthMask LYS_GL_CALL(_glptr_glDepthMask)
 
 typedef GLboolean (GL_APIENTRY *PFN_glIsFramebuffer)(GLuint framebuffer);
 extern PFN_glIsFramebuffer _glptr_glIsFramebuffer;
-#define glIsFramebuffer _glptr_glIsFramebuffer
+#define glIsFramebuffer LYS_GL_CALL(_glptr_glIsFramebuffer)
 
 typedef void  (GL_APIENTRY *PFN_glGetUniformfv)(GLuint program, GLint location, GLfloat * params);
 extern PFN_glGetUniformfv _glptr_glGetUniformfv;
-#define glGetUniformfv _glptr_glGetUniformfv
+#define glGetUniformfv LYS_GL_CALL(_glptr_glGetUniformfv)
 
 typedef void  (GL_APIENTRY *PFN_glUniform4f)(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
 extern PFN_glUniform4f _glptr_glUniform4f;
-#define glUniform4f _glptr_glUniform4f
+#define glUniform4f LYS_GL_CALL(_glptr_glUniform4f)
 
 typedef void  (GL_APIENTRY *PFN_glAttachShader)(GLuint program, GLuint shader);
 extern PFN_glAttachShader _glptr_glAttachShader;
-#define glAttachShader _glptr_glAttachShader
+#define glAttachShader LYS_GL_CALL(_glptr_glAttachShader)
 
 typedef void  (GL_APIENTRY *PFN_glFramebufferRenderbuffer)(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
 extern PFN_glFramebufferRenderbuffer _glptr_glFramebufferRenderbuffer;
-#define glFramebufferRenderbuffer _glptr_glFramebufferRenderbuffer
+#define glFramebufferRenderbuffer LYS_GL_CALL(_glptr_glFramebufferRenderbuffer)
 
 typedef void  (GL_APIENTRY *PFN_glStencilOp)(GLenum fail, GLenum zfail, GLenum zpass);
 extern PFN_glStencilOp _glptr_glStencilOp;
-#define glStencilOp _glptr_glStencilOp
+#define glStencilOp LYS_GL_CALL(_glptr_glStencilOp)
 
 typedef void  (GL_APIENTRY *PFN_glDisableVertexAttribArray)(GLuint index);
 extern PFN_glDisableVertexAttribArray _glptr_glDisableVertexAttribArray;
-#define glDisableVertexAttribArray _glptr_glDisableVertexAttribArray
+#define glDisableVertexAttribArray LYS_GL_CALL(_glptr_glDisableVertexAttribArray)
 
 typedef GLboolean (GL_APIENTRY *PFN_glIsRenderbuffer)(GLuint renderbuffer);
 extern PFN_glIsRenderbuffer _glptr_glIsRenderbuffer;
-#define glIsRenderbuffer _glptr_glIsRenderbuffer
+#define glIsRenderbuffer LYS_GL_CALL(_glptr_glIsRenderbuffer)
 
 typedef void  (GL_APIENTRY *PFN_glDeleteProgram)(GLuint program);
 extern PFN_glDeleteProgram _glptr_glDeleteProgram;
-#define glDeleteProgram _glptr_glDeleteProgram
+#define glDeleteProgram LYS_GL_CALL(_glptr_glDeleteProgram)
 
 typedef void  (GL_APIENTRY *PFN_glDrawArrays)(GLenum mode, GLint first, GLsizei count);
 extern PFN_glDrawArrays _glptr_glDrawArrays;
-#define glDrawArrays _glptr_glDrawArrays
+#define glDrawArrays LYS_GL_CALL(_glptr_glDrawArrays)
 
 typedef void  (GL_APIENTRY *PFN_glBlendEquationSeparate)(GLenum modeRGB, GLenum modeAlpha);
 extern PFN_glBlendEquationSeparate _glptr_glBlendEquationSeparate;
-#define glBlendEquationSeparate _glptr_glBlendEquationSeparate
+#define glBlendEquationSeparate LYS_GL_CALL(_glptr_glBlendEquationSeparate)
 
 typedef void  (GL_APIENTRY *PFN_glCompileShader)(GLuint shader);
 extern PFN_glCompileShader _glptr_glCompileShader;
-#define glCompileShader _glptr_glCompileShader
+#define glCompileShader LYS_GL_CALL(_glptr_glCompileShader)
 
 typedef void  (GL_APIENTRY *PFN_glVertexAttrib1f)(GLuint index, GLfloat x);
 extern PFN_glVertexAttrib1f _glptr_glVertexAttrib1f;
-#define glVertexAttrib1f _glptr_glVertexAttrib1f
+#define glVertexAttrib1f LYS_GL_CALL(_glptr_glVertexAttrib1f)
 
 typedef void  (GL_APIENTRY *PFN_glDeleteFramebuffers)(GLsizei n, const GLuint * framebuffers);
 extern PFN_glDeleteFramebuffers _glptr_glDeleteFramebuffers;
-#define glDeleteFramebuffers _glptr_glDeleteFramebuffers
+#define glDeleteFramebuffers LYS_GL_CALL(_glptr_glDeleteFramebuffers)
 
 typedef void  (GL_APIENTRY *PFN_glDeleteBuffers)(GLsizei n, const GLuint * buffers);
 extern PFN_glDeleteBuffers _glptr_glDeleteBuffers;
-#define glDeleteBuffers _glptr_glDeleteBuffers
+#define glDeleteBuffers LYS_GL_CALL(_glptr_glDeleteBuffers)
 
 typedef void  (GL_APIENTRY *PFN_glTexParameterfv)(GLenum target, GLenum pname, const GLfloat * params);
 extern PFN_glTexParameterfv _glptr_glTexParameterfv;
-#define glTexParameterfv _glptr_glTexParameterfv
+#define glTexParameterfv LYS_GL_CALL(_glptr_glTexParameterfv)
 
 typedef void  (GL_APIENTRY *PFN_glLinkProgram)(GLuint program);
 extern PFN_glLinkProgram _glptr_glLinkProgram;
-#define glLinkProgram _glptr_glLinkProgram
+#define glLinkProgram LYS_GL_CALL(_glptr_glLinkProgram)
 
 typedef void  (GL_APIENTRY *PFN_glGenerateMipmap)(GLenum target);
 extern PFN_glGenerateMipmap _glptr_glGenerateMipmap;
-#define glGenerateMipmap _glptr_glGenerateMipmap
+#define glGenerateMipmap LYS_GL_CALL(_glptr_glGenerateMipmap)
 
 typedef void  (GL_APIENTRY *PFN_glCullFace)(GLenum mode);
 extern PFN_glCullFace _glptr_glCullFace;
-#define glCullFace _glptr_glCullFace
+#define glCullFace LYS_GL_CALL(_glptr_glCullFace)
 
 typedef void  (GL_APIENTRY *PFN_glVertexAttrib2f)(GLuint index, GLfloat x, GLfloat y);
 extern PFN_glVertexAttrib2f _glptr_glVertexAttrib2f;
-#define glVertexAttrib2f _glptr_glVertexAttrib2f
+#define glVertexAttrib2f LYS_GL_CALL(_glptr_glVertexAttrib2f)
 
 typedef void  (GL_APIENTRY *PFN_glTexImage2D)(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void * pixels);
 extern PFN_glTexImage2D _glptr_glTexImage2D;
-#define glTexImage2D _glptr_glTexImage2D
+#define glTexImage2D LYS_GL_CALL(_glptr_glTexImage2D)
 
 typedef void  (GL_APIENTRY *PFN_glDrawElements)(GLenum mode, GLsizei count, GLenum type, const void * indices);
 extern PFN_glDrawElements _glptr_glDrawElements;
-#define glDrawElements _glptr_glDrawElements
+#define glDrawElements LYS_GL_CALL(_glptr_glDrawElements)
 
 typedef void  (GL_APIENTRY *PFN_glGenFramebuffers)(GLsizei n, GLuint * framebuffers);
 extern PFN_glGenFramebuffers _glptr_glGenFramebuffers;
-#define glGenFramebuffers _glptr_glGenFramebuffers
+#define glGenFramebuffers LYS_GL_CALL(_glptr_glGenFramebuffers)
 
 typedef GLuint (GL_APIENTRY *PFN_glCreateShader)(GLenum type);
 extern PFN_glCreateShader _glptr_glCreateShader;
-#define glCreateShader _glptr_glCreateShader
+#define glCreateShader LYS_GL_CALL(_glptr_glCreateShader)
 
 typedef void  (GL_APIENTRY *PFN_glGetFramebufferAttachmentParameteriv)(GLenum target, GLenum attachment, GLenum pname, GLint * params);
 extern PFN_glGetFramebufferAttachmentParameteriv _glptr_glGetFramebufferAttachmentParameteriv;
-#define glGetFramebufferAttachmentParameteriv _glptr_glGetFramebufferAttachmentParameteriv
+#define glGetFramebufferAttachmentParameteriv LYS_GL_CALL(_glptr_glGetFramebufferAttachmentParameteriv)
 
 typedef void  (GL_APIENTRY *PFN_glClearColor)(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
 extern PFN_glClearColor _glptr_glClearColor;
-#define glClearColor _glptr_glClearColor
+#define glClearColor LYS_GL_CALL(_glptr_glClearColor)
 
 typedef GLuint (GL_APIENTRY *PFN_glCreateProgram)();
 extern PFN_glCreateProgram _glptr_glCreateProgram;
-#define glCreateProgram _glptr_glCreateProgram
+#define glCreateProgram LYS_GL_CALL(_glptr_glCreateProgram)
 
 typedef void  (GL_APIENTRY *PFN_glClearDepthf)(GLfloat d);
 extern PFN_glClearDepthf _glptr_glClearDepthf;
-#define glClearDepthf _glptr_glClearDepthf
+#define glClearDepthf LYS_GL_CALL(_glptr_glClearDepthf)
 
 typedef void  (GL_APIENTRY *PFN_glBlendFunc)(GLenum sfactor, GLenum dfactor);
 extern PFN_glBlendFunc _glptr_glBlendFunc;
-#define glBlendFunc _glptr_glBlendFunc
+#define glBlendFunc LYS_GL_CALL(_glptr_glBlendFunc)
 
 typedef void  (GL_APIENTRY *PFN_glBindBuffer)(GLenum target, GLuint buffer);
 extern PFN_glBindBuffer _glptr_glBindBuffer;
-#define glBindBuffer _glptr_glBindBuffer
+#define glBindBuffer LYS_GL_CALL(_glptr_glBindBuffer)
 
 typedef void  (GL_APIENTRY *PFN_glGetShaderInfoLog)(GLuint shader, GLsizei bufSize, GLsizei * length, GLchar * infoLog);
 extern PFN_glGetShaderInfoLog _glptr_glGetShaderInfoLog;
-#define glGetShaderInfoLog _glptr_glGetShaderInfoLog
+#define glGetShaderInfoLog LYS_GL_CALL(_glptr_glGetShaderInfoLog)
 
 typedef GLenum (GL_APIENTRY *PFN_glCheckFramebufferStatus)(GLenum target);
 extern PFN_glCheckFramebufferStatus _glptr_glCheckFramebufferStatus;
-#define glCheckFramebufferStatus _glptr_glCheckFramebufferStatus
+#define glCheckFramebufferStatus LYS_GL_CALL(_glptr_glCheckFramebufferStatus)
 
 typedef void  (GL_APIENTRY *PFN_glBufferSubData)(GLenum target, GLintptr offset, GLsizeiptr size, const void * data);
 extern PFN_glBufferSubData _glptr_glBufferSubData;
-#define glBufferSubData _glptr_glBufferSubData
+#define glBufferSubData LYS_GL_CALL(_glptr_glBufferSubData)
 
 typedef void  (GL_APIENTRY *PFN_glActiveTexture)(GLenum texture);
 extern PFN_glActiveTexture _glptr_glActiveTexture;
-#define glActiveTexture _glptr_glActiveTexture
+#define glActiveTexture LYS_GL_CALL(_glptr_glActiveTexture)
 
 typedef void  (GL_APIENTRY *PFN_glColorMask)(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
 extern PFN_glColorMask _glptr_glColorMask;
-#define glColorMask _glptr_glColorMask
+#define glColorMask LYS_GL_CALL(_glptr_glColorMask)
 
 typedef void  (GL_APIENTRY *PFN_glBufferData)(GLenum target, GLsizeiptr size, const void * data, GLenum usage);
 extern PFN_glBufferData _glptr_glBufferData;
-#define glBufferData _glptr_glBufferData
+#define glBufferData LYS_GL_CALL(_glptr_glBufferData)
 
 typedef void  (GL_APIENTRY *PFN_glDepthFunc)(GLenum func);
 extern PFN_glDepthFunc _glptr_glDepthFunc;
-#define glDepthFunc _glptr_glDepthFunc
+#define glDepthFunc LYS_GL_CALL(_glptr_glDepthFunc)
 
 typedef void  (GL_APIENTRY *PFN_glFlush)();
 extern PFN_glFlush _glptr_glFlush;
-#define glFlush _glptr_glFlush
+#define glFlush LYS_GL_CALL(_glptr_glFlush)
 
 typedef void  (GL_APIENTRY *PFN_glCopyTexSubImage2D)(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height);
 extern PFN_glCopyTexSubImage2D _glptr_glCopyTexSubImage2D;
-#define glCopyTexSubImage2D _glptr_glCopyTexSubImage2D
+#define glCopyTexSubImage2D LYS_GL_CALL(_glptr_glCopyTexSubImage2D)
 
 typedef void  (GL_APIENTRY *PFN_glGetAttachedShaders)(GLuint program, GLsizei maxCount, GLsizei * count, GLuint * shaders);
 extern PFN_glGetAttachedShaders _glptr_glGetAttachedShaders;
-#define glGetAttachedShaders _glptr_glGetAttachedShaders
+#define glGetAttachedShaders LYS_GL_CALL(_glptr_glGetAttachedShaders)
 
 typedef void  (GL_APIENTRY *PFN_glDepthRangef)(GLfloat n, GLfloat f);
 extern PFN_glDepthRangef _glptr_glDepthRangef;
-#define glDepthRangef _glptr_glDepthRangef
+#define glDepthRangef LYS_GL_CALL(_glptr_glDepthRangef)
 
 typedef void  (GL_APIENTRY *PFN_glBlendEquation)(GLenum mode);
 extern PFN_glBlendEquation _glptr_glBlendEquation;
-#define glBlendEquation _glptr_glBlendEquation
+#define glBlendEquation LYS_GL_CALL(_glptr_glBlendEquation)
 
 typedef void  (GL_APIENTRY *PFN_glGetShaderSource)(GLuint shader, GLsizei bufSize, GLsizei * length, GLchar * source);
 extern PFN_glGetShaderSource _glptr_glGetShaderSource;
-#define glGetShaderSource _glptr_glGetShaderSource
+#define glGetShaderSource LYS_GL_CALL(_glptr_glGetShaderSource)
 
 typedef void  (GL_APIENTRY *PFN_glEnable)(GLenum cap);
 extern PFN_glEnable _glptr_glEnable;
-#define glEnable _glptr_glEnable
+#define glEnable LYS_GL_CALL(_glptr_glEnable)
 
 typedef void  (GL_APIENTRY *PFN_glBlendColor)(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
 extern PFN_glBlendColor _glptr_glBlendColor;
-#define glBlendColor _glptr_glBlendColor
+#define glBlendColor LYS_GL_CALL(_glptr_glBlendColor)
 
 typedef void  (GL_APIENTRY *PFN_glUniform2f)(GLint location, GLfloat v0, GLfloat v1);
 extern PFN_glUniform2f _glptr_glUniform2f;
-#define glUniform2f _glptr_glUniform2f
+#define glUniform2f LYS_GL_CALL(_glptr_glUniform2f)
 
 typedef void  (GL_APIENTRY *PFN_glBindTexture)(GLenum target, GLuint texture);
 extern PFN_glBindTexture _glptr_glBindTexture;
-#define glBindTexture _glptr_glBindTexture
+#define glBindTexture LYS_GL_CALL(_glptr_glBindTexture)
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,44 @@
+/* GLES 2.0 extension tokens used by Lys3D.
+   gl2.h only contains the core profile, so the extension enums we rely on
+   are collected here. Availability must always be checked at runtime (e.g.
+   with SDL_GL_ExtensionSupported()) before using any of them.
+ */
+#ifndef LYS3D_GL2EXT_H_
+#define LYS3D_GL2EXT_H_
+
+#include "gl2.h"
+
+/* GL_OES_compressed_ETC1_RGB8_texture */
+#define GL_ETC1_RGB8_OES 0x8D64
+
+/* GL_OES_vertex_half_float */
+#define GL_HALF_FLOAT_OES 0x8D61
+
+/* GL_EXT_discard_framebuffer (load with SDL_GL_GetProcAddress()) */
+#define GL_COLOR_EXT 0x1800
+#define GL_DEPTH_EXT 0x1801
+#define GL_STENCIL_EXT 0x1802
+typedef void (GL_APIENTRY *PFN_glDiscardFramebufferEXT)(GLenum target, GLsizei numAttachments, const GLenum *attachments);
+
+/* GL_EXT_disjoint_timer_query (load with SDL_GL_GetProcAddress()) */
+#define GL_QUERY_RESULT_EXT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE_EXT 0x8867
+#define GL_TIME_ELAPSED_EXT 0x88BF
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+typedef void (GL_APIENTRY *PFN_glGenQueriesEXT)(GLsizei n, GLuint *ids);
+typedef void (GL_APIENTRY *PFN_glDeleteQueriesEXT)(GLsizei n, const GLuint *ids);
+typedef void (GL_APIENTRY *PFN_glBeginQueryEXT)(GLenum target, GLuint id);
+typedef void (GL_APIENTRY *PFN_glEndQueryEXT)(GLenum target);
+typedef void (GL_APIENTRY *PFN_glGetQueryObjectuivEXT)(GLuint id, GLenum pname, GLuint *params);
+typedef void (GL_APIENTRY *PFN_glGetQueryObjectui64vEXT)(GLuint id, GLenum pname, GLuint64 *params);
+
+/* GL_NV_pixel_buffer_object (GL_PIXEL_PACK_BUFFER_ARB on desktop GL) */
+#define GL_PIXEL_PACK_BUFFER_NV 0x88EB
+
+/* GL_EXT_map_buffer_range and GL_OES_mapbuffer (load with
+   SDL_GL_GetProcAddress(); glMapBufferRange/glUnmapBuffer on desktop GL) */
+#define GL_MAP_READ_BIT_EXT 0x0001
+typedef void *(GL_APIENTRY *PFN_glMapBufferRangeEXT)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLboolean (GL_APIENTRY *PFN_glUnmapBufferOES)(GLenum target);
+
+#endif
@@ -0,0 +1,413 @@
+/***************************************************
+* GLState.cc: Shadowed GL state for engine passes  *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "GLState.h"
+
+#include <atomic>
+
+#include "GLES2/gl2.h"
+
+#include "types.h"
+
+namespace lys3d {
+namespace {
+// Texture units whose 2D bindings are shadowed
+const uint32_t kUnits = 32;
+const GLuint kUnknown = 0xFFFFFFFF;
+
+// What the shadow has seen set, or queried, since it was installed
+enum Known : uint32_t {
+    kKnownBlend = 1,
+    kKnownDepthTest = 2,
+    kKnownCullFace = 4,
+    kKnownScissorTest = 8,
+    kKnownBlendFunc = 16,
+    kKnownDepthMask = 32,
+    kKnownProgram = 64,
+    kKnownArrayBuffer = 128,
+    kKnownActiveTexture = 256,
+    kKnownViewport = 512
+};
+
+struct Shadow {
+    uint32_t known;
+    GLboolean blend;
+    GLboolean depthTest;
+    GLboolean cullFace;
+    GLboolean scissorTest;
+    GLboolean depthMask;
+    GLenum blendFunc[4];
+    GLuint program;
+    GLuint arrayBuffer;
+    GLenum activeTexture;
+    // kUnknown where not seen
+    GLuint textures[kUnits];
+    GLint viewport[4];
+};
+
+Shadow gShadow;
+uint32_t gEnables = 0;
+// The thread that enabled the shadow, told apart by the address of its
+// copy of tMarker. Other threads' calls are on other contexts.
+thread_local char tMarker;
+std::atomic<const char*> gThread(nullptr);
+
+bool onShadowThread() {
+    return gThread.load(std::memory_order_relaxed) == &tMarker;
+}
+
+void forgetShadow() {
+    gShadow.known = 0;
+    for (GLuint &texture : gShadow.textures)
+        texture = kUnknown;
+}
+
+// The capability's flag in the shadow and its Known bit, or null for
+// capabilities it doesn't keep
+GLboolean* shadowedCapability(GLenum capability, uint32_t *known) {
+    switch (capability) {
+    case GL_BLEND:
+        *known = kKnownBlend;
+        return &gShadow.blend;
+    case GL_DEPTH_TEST:
+        *known = kKnownDepthTest;
+        return &gShadow.depthTest;
+    case GL_CULL_FACE:
+        *known = kKnownCullFace;
+        return &gShadow.cullFace;
+    case GL_SCISSOR_TEST:
+        *known = kKnownScissorTest;
+        return &gShadow.scissorTest;
+    default:
+        return nullptr;
+    }
+}
+
+// The slot of the active unit's 2D binding, or null if it isn't known
+// which unit that is
+GLuint* activeTextureSlot() {
+    if (!(gShadow.known & kKnownActiveTexture) || gShadow.activeTexture - GL_TEXTURE0 >= kUnits)
+        return nullptr;
+    return &gShadow.textures[gShadow.activeTexture - GL_TEXTURE0];
+}
+
+void noteCapability(GLenum capability, GLboolean enabled) {
+    uint32_t known = 0;
+    GLboolean *value = shadowedCapability(capability, &known);
+    if (value == nullptr)
+        return;
+    *value = enabled;
+    gShadow.known |= known;
+}
+
+void noteBlendFunc(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha) {
+    gShadow.blendFunc[0] = src_rgb;
+    gShadow.blendFunc[1] = dst_rgb;
+    gShadow.blendFunc[2] = src_alpha;
+    gShadow.blendFunc[3] = dst_alpha;
+    gShadow.known |= kKnownBlendFunc;
+}
+
+void noteDepthMask(GLboolean flag) {
+    gShadow.depthMask = flag;
+    gShadow.known |= kKnownDepthMask;
+}
+
+void noteProgram(GLuint program) {
+    gShadow.program = program;
+    gShadow.known |= kKnownProgram;
+}
+
+void noteBuffer(GLenum target, GLuint buffer) {
+    if (target != GL_ARRAY_BUFFER)
+        return;
+    gShadow.arrayBuffer = buffer;
+    gShadow.known |= kKnownArrayBuffer;
+}
+
+// Deleted buffers and textures are unbound from the context
+void noteDeletedBuffers(GLsizei count, const GLuint *buffers) {
+    for (GLsizei i = 0; buffers != nullptr && i < count; ++i) {
+        if (buffers[i] != 0 && gShadow.arrayBuffer == buffers[i])
+            gShadow.arrayBuffer = 0;
+    }
+}
+
+void noteActiveTexture(GLenum unit) {
+    gShadow.activeTexture = unit;
+    gShadow.known |= kKnownActiveTexture;
+}
+
+void noteTexture(GLenum target, GLuint texture) {
+    if (target != GL_TEXTURE_2D)
+        return;
+    GLuint *slot = activeTextureSlot();
+    if (slot != nullptr) {
+        *slot = texture;
+    } else if (!(gShadow.known & kKnownActiveTexture)) {
+        // Bound to some unit, so none of them can be trusted
+        for (GLuint &known_texture : gShadow.textures)
+            known_texture = kUnknown;
+    }
+}
+
+void noteDeletedTextures(GLsizei count, const GLuint *textures) {
+    for (GLsizei i = 0; textures != nullptr && i < count; ++i) {
+        for (GLuint &texture : gShadow.textures) {
+            if (textures[i] != 0 && texture == textures[i])
+                texture = 0;
+        }
+    }
+}
+
+void noteViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    gShadow.viewport[0] = x;
+    gShadow.viewport[1] = y;
+    gShadow.viewport[2] = width;
+    gShadow.viewport[3] = height;
+    gShadow.known |= kKnownViewport;
+}
+
+// Names are given without the gl prefix, which would expand to _glptr_gl*
+#define LYS_GL_SHADOW(name, params, args, noting) \
+    PFN_gl##name real##name = nullptr; \
+    void GL_APIENTRY shadow##name params { \
+        real##name args; \
+        if (onShadowThread()) \
+            noting; \
+    }
+
+LYS_GL_SHADOW(Enable, (GLenum cap), (cap), noteCapability(cap, GL_TRUE))
+LYS_GL_SHADOW(Disable, (GLenum cap), (cap), noteCapability(cap, GL_FALSE))
+LYS_GL_SHADOW(BlendFunc, (GLenum sfactor, GLenum dfactor), (sfactor, dfactor),
+              noteBlendFunc(sfactor, dfactor, sfactor, dfactor))
+LYS_GL_SHADOW(BlendFuncSeparate, (GLenum srgb, GLenum drgb, GLenum salpha, GLenum dalpha),
+              (srgb, drgb, salpha, dalpha), noteBlendFunc(srgb, drgb, salpha, dalpha))
+LYS_GL_SHADOW(DepthMask, (GLboolean flag), (flag), noteDepthMask(flag))
+LYS_GL_SHADOW(UseProgram, (GLuint program), (program), noteProgram(program))
+LYS_GL_SHADOW(BindBuffer, (GLenum target, GLuint buffer), (target, buffer), noteBuffer(target, buffer))
+LYS_GL_SHADOW(DeleteBuffers, (GLsizei n, const GLuint *buffers), (n, buffers), noteDeletedBuffers(n, buffers))
+LYS_GL_SHADOW(ActiveTexture, (GLenum texture), (texture), noteActiveTexture(texture))
+LYS_GL_SHADOW(BindTexture, (GLenum target, GLuint texture), (target, texture), noteTexture(target, texture))
+LYS_GL_SHADOW(DeleteTextures, (GLsizei n, const GLuint *textures), (n, textures),
+              noteDeletedTextures(n, textures))
+LYS_GL_SHADOW(Viewport, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height),
+              noteViewport(x, y, width, height))
+
+#define LYS_GL_SHADOW_LIST(X) \
+    X(Enable) X(Disable) X(BlendFunc) X(BlendFuncSeparate) X(DepthMask) X(UseProgram) \
+    X(BindBuffer) X(DeleteBuffers) X(ActiveTexture) X(BindTexture) X(DeleteTextures) X(Viewport)
+
+void installShadow(void*) {
+    // Save real entry points (or whichever layer was installed before us)
+    loadGLPointers();
+    forgetShadow();
+#define LYS_INSTALL_SHADOW(name) \
+    real##name = _glptr_gl##name; \
+    _glptr_gl##name = shadow##name;
+    LYS_GL_SHADOW_LIST(LYS_INSTALL_SHADOW)
+#undef LYS_INSTALL_SHADOW
+}
+
+void removeShadow() {
+#define LYS_REMOVE_SHADOW(name) \
+    if (_glptr_gl##name == shadow##name) \
+        _glptr_gl##name = real##name;
+    LYS_GL_SHADOW_LIST(LYS_REMOVE_SHADOW)
+#undef LYS_REMOVE_SHADOW
+}
+
+GLuint queryInteger(GLenum name) {
+    GLint value = 0;
+    glGetIntegerv(name, &value);
+    return static_cast<GLuint>(value);
+}
+
+GLboolean capability(GLenum capability, bool shadowed) {
+    uint32_t known = 0;
+    GLboolean *value = shadowed ? shadowedCapability(capability, &known) : nullptr;
+    if (value != nullptr && (gShadow.known & known))
+        return *value;
+    GLboolean enabled = glIsEnabled(capability);
+    if (value != nullptr)
+        noteCapability(capability, enabled);
+    return enabled;
+}
+
+// Whether the shadow knows a value is already what it would be set to
+template <typename T>
+bool alreadySet(bool shadowed, uint32_t known, const T *value, const T *wanted, uint32_t count) {
+    if (!shadowed || !(gShadow.known & known))
+        return false;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (value[i] != wanted[i])
+            return false;
+    }
+    return true;
+}
+}
+
+
+void saveGLState(uint32_t parts, GLStateSnapshot *state) {
+    bool shadowed = onShadowThread();
+    state->parts = parts;
+    if (parts & kGLStateCapabilities) {
+        state->blend = capability(GL_BLEND, shadowed);
+        state->depthTest = capability(GL_DEPTH_TEST, shadowed);
+        state->cullFace = capability(GL_CULL_FACE, shadowed);
+        state->scissorTest = capability(GL_SCISSOR_TEST, shadowed);
+    }
+    if (parts & kGLStateBlendFunc) {
+        if (!shadowed || !(gShadow.known & kKnownBlendFunc)) {
+            state->blendFunc[0] = queryInteger(GL_BLEND_SRC_RGB);
+            state->blendFunc[1] = queryInteger(GL_BLEND_DST_RGB);
+            state->blendFunc[2] = queryInteger(GL_BLEND_SRC_ALPHA);
+            state->blendFunc[3] = queryInteger(GL_BLEND_DST_ALPHA);
+            if (shadowed)
+                noteBlendFunc(state->blendFunc[0], state->blendFunc[1], state->blendFunc[2], state->blendFunc[3]);
+        } else {
+            for (uint32_t i = 0; i < 4; ++i)
+                state->blendFunc[i] = gShadow.blendFunc[i];
+        }
+    }
+    if (parts & kGLStateDepthMask) {
+        if (!shadowed || !(gShadow.known & kKnownDepthMask)) {
+            state->depthMask = GL_TRUE;
+            glGetBooleanv(GL_DEPTH_WRITEMASK, &state->depthMask);
+            if (shadowed)
+                noteDepthMask(state->depthMask);
+        } else {
+            state->depthMask = gShadow.depthMask;
+        }
+    }
+    if (parts & kGLStateBindings) {
+        if (!shadowed || !(gShadow.known & kKnownProgram)) {
+            state->program = queryInteger(GL_CURRENT_PROGRAM);
+            if (shadowed)
+                noteProgram(state->program);
+        } else {
+            state->program = gShadow.program;
+        }
+        if (!shadowed || !(gShadow.known & kKnownArrayBuffer)) {
+            state->arrayBuffer = queryInteger(GL_ARRAY_BUFFER_BINDING);
+            if (shadowed)
+                noteBuffer(GL_ARRAY_BUFFER, state->arrayBuffer);
+        } else {
+            state->arrayBuffer = gShadow.arrayBuffer;
+        }
+        if (!shadowed || !(gShadow.known & kKnownActiveTexture)) {
+            state->activeTexture = queryInteger(GL_ACTIVE_TEXTURE);
+            if (shadowed)
+                noteActiveTexture(state->activeTexture);
+        } else {
+            state->activeTexture = gShadow.activeTexture;
+        }
+        if (!shadowed || gShadow.textures[0] == kUnknown) {
+            // Unit 0's binding can only be asked for with it active
+            if (state->activeTexture != GL_TEXTURE0)
+                glActiveTexture(GL_TEXTURE0);
+            state->texture = queryInteger(GL_TEXTURE_BINDING_2D);
+            if (shadowed)
+                gShadow.textures[0] = state->texture;
+            if (state->activeTexture != GL_TEXTURE0)
+                glActiveTexture(state->activeTexture);
+        } else {
+            state->texture = gShadow.textures[0];
+        }
+    }
+    if (parts & kGLStateViewport) {
+        if (!shadowed || !(gShadow.known & kKnownViewport)) {
+            glGetIntegerv(GL_VIEWPORT, state->viewport);
+            if (shadowed)
+                noteViewport(state->viewport[0], state->viewport[1], state->viewport[2], state->viewport[3]);
+        } else {
+            for (uint32_t i = 0; i < 4; ++i)
+                state->viewport[i] = gShadow.viewport[i];
+        }
+    }
+}
+
+
+void restoreGLState(const GLStateSnapshot &state) {
+    bool shadowed = onShadowThread();
+    if (state.parts & kGLStateCapabilities) {
+        setGLCapability(GL_BLEND, state.blend == GL_TRUE);
+        setGLCapability(GL_DEPTH_TEST, state.depthTest == GL_TRUE);
+        setGLCapability(GL_CULL_FACE, state.cullFace == GL_TRUE);
+        setGLCapability(GL_SCISSOR_TEST, state.scissorTest == GL_TRUE);
+    }
+    if ((state.parts & kGLStateBlendFunc) && !alreadySet(shadowed, kKnownBlendFunc, gShadow.blendFunc, state.blendFunc, 4))
+        glBlendFuncSeparate(state.blendFunc[0], state.blendFunc[1], state.blendFunc[2], state.blendFunc[3]);
+    if ((state.parts & kGLStateDepthMask) && !alreadySet(shadowed, kKnownDepthMask, &gShadow.depthMask, &state.depthMask, 1))
+        glDepthMask(state.depthMask);
+    if (state.parts & kGLStateBindings) {
+        if (!alreadySet(shadowed, kKnownProgram, &gShadow.program, &state.program, 1))
+            glUseProgram(state.program);
+        if (!alreadySet(shadowed, kKnownArrayBuffer, &gShadow.arrayBuffer, &state.arrayBuffer, 1))
+            glBindBuffer(GL_ARRAY_BUFFER, state.arrayBuffer);
+        if (!shadowed || gShadow.textures[0] != state.texture) {
+            const GLenum unit = GL_TEXTURE0;
+            if (!alreadySet(shadowed, kKnownActiveTexture, &gShadow.activeTexture, &unit, 1))
+                glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, state.texture);
+        }
+        if (!alreadySet(shadowed, kKnownActiveTexture, &gShadow.activeTexture, &state.activeTexture, 1))
+            glActiveTexture(state.activeTexture);
+    }
+    if ((state.parts & kGLStateViewport) && !alreadySet(shadowed, kKnownViewport, gShadow.viewport, state.viewport, 4))
+        glViewport(state.viewport[0], state.viewport[1], state.viewport[2], state.viewport[3]);
+}
+
+
+void setGLCapability(GLenum capability, bool enable) {
+    uint32_t known = 0;
+    GLboolean *value = onShadowThread() ? shadowedCapability(capability, &known) : nullptr;
+    if (value != nullptr && (gShadow.known & known) && *value == (enable ? GL_TRUE : GL_FALSE))
+        return;
+    if (enable)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+
+GLuint boundTexture2D() {
+    if (!onShadowThread())
+        return queryInteger(GL_TEXTURE_BINDING_2D);
+    GLuint *slot = activeTextureSlot();
+    if (slot != nullptr && *slot != kUnknown)
+        return *slot;
+    GLuint texture = queryInteger(GL_TEXTURE_BINDING_2D);
+    if (slot != nullptr)
+        *slot = texture;
+    return texture;
+}
+
+
+bool shadowGLState(bool enable) {
+    if (!enable) {
+        if (gEnables > 0 && --gEnables == 0) {
+            removeGLResetCallback(installShadow, nullptr);
+            removeShadow();
+            gThread.store(nullptr, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    if (gEnables == 0) {
+        if (!addGLResetCallback(installShadow, nullptr))
+            return false;
+        gThread.store(&tMarker, std::memory_order_relaxed);
+        installShadow(nullptr);
+    }
+    ++gEnables;
+    return true;
+}
+}
@@ -0,0 +1,83 @@
+/***************************************************
+* GLState.h: Shadowed GL state for engine passes   *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_GLSTATE_H_
+#define LYS3D_GLSTATE_H_
+
+#include "GLES2/gl2.h"
+
+#include "types.h"
+
+namespace lys3d {
+
+/** Parts of the GL state saveGLState() can save. */
+enum GLStatePart : uint32_t {
+    kGLStateCapabilities = 1,  ///< Blending, depth test, face culling, scissor test
+    kGLStateBlendFunc = 2,
+    kGLStateDepthMask = 4,
+    kGLStateBindings = 8,      ///< Program, array buffer, active unit, unit 0's 2D texture
+    kGLStateViewport = 16
+};
+
+/** GL state the engine's own passes change and put back. */
+struct GLStateSnapshot {
+    uint32_t parts;
+    GLboolean blend;
+    GLboolean depthTest;
+    GLboolean cullFace;
+    GLboolean scissorTest;
+    GLboolean depthMask;
+    /** Source and destination RGB factors, then alpha. */
+    GLenum blendFunc[4];
+    GLuint program;
+    GLuint arrayBuffer;
+    GLenum activeTexture;
+    GLuint texture;
+    GLint viewport[4];
+};
+
+/** Keep a shadow of the state in GLStateSnapshot by wrapping the calls \
+ * that change it, so saving it needs no glGet* and restoring it only \
+ * makes the calls that change something. Only calls on the thread that \
+ * enabled it are seen. The shadow is forgotten whenever the function \
+ * pointers are reset, and what it hasn't seen set since is queried once. \
+ * Enabling again nests; internal to WindowGLES2, which enables it for \
+ * as long as its context exists.
+ * \param enable Whether to enable it, or undo one enabling.
+ * \returns False if too many reset callbacks are registered.
+ */
+bool shadowGLState(bool enable);
+
+/** Save parts of the state, from the shadow on its thread and otherwise \
+ * with glGet*.
+ * \param parts GLStatePart bits.
+ * \param state Where to save them.
+ */
+void saveGLState(uint32_t parts, GLStateSnapshot *state);
+
+/** Put back saved state. Texture unit 0 is active while its texture is \
+ * bound.
+ * \param state The state from saveGLState().
+ */
+void restoreGLState(const GLStateSnapshot &state);
+
+/** Enable or disable a capability unless the shadow knows it already is.
+ * \param capability The capability, e.g. GL_BLEND.
+ * \param enable Whether to enable it.
+ */
+void setGLCapability(GLenum capability, bool enable);
+
+/** Get the 2D texture bound to the active unit, from the shadow on its \
+ * thread and otherwise with glGetIntegerv().
+ * \returns The texture name.
+ */
+GLuint boundTexture2D();
+}
+#endif // LYS3D_GLSTATE_H_
@@ -0,0 +1,1144 @@
+/***************************************************
+* GLTrace.cc: GL call-stream capture & replay      *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "GLTrace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+#include "GLES2/gl2.h"
+#include "GLES2/gl2ext.h"
+
+#include "types.h"
+
+namespace lys3d {
+namespace {
+// A trace is a header, then a record per call: the opcode, the arguments,
+// then whatever the call returned. Every field is one native-endian 32-bit
+// word, or two for sizes and offsets, and data is padded to whole words,
+// so a loaded trace can be passed to GL in place.
+const char kMagic[8] = {'L', 'Y', 'S', 'G', 'L', 'T', 'R', '\0'};
+const uint32_t kVersion = 1;
+const uint32_t kByteOrder = 0x01020304;
+// Header: magic, version, byte order, framebuffer width and height
+const size_t kHeaderBytes = sizeof(kMagic) + 4 * 4;
+// Size word of a null data pointer
+const uint32_t kNullData = 0xFFFFFFFF;
+// Capture buffer size that triggers a write
+const size_t kFlushBytes = 1 << 20;
+const uint32_t kMaxArgs = 9;
+
+// Every GL function, with its signature: a character for the return value,
+// then one per argument.
+//   -  a 32-bit value, kept as is; as the return value, not recorded
+//   w  a 64-bit size or offset
+//   o  a pointer into the bound buffer, recorded as an offset
+//   b t f r p s  a buffer, texture, framebuffer, renderbuffer, program or
+//      shader name, translated on replay
+//   u  a uniform location, translated per program
+//   S  a string
+//   B  a block of data, sized by blockBytes()
+//   N  names of the kind nameKind() gives, as many as the argument before
+//   G  the same, but written by the call (glGen*)
+//   L  shader source strings, as many as the argument before; the lengths
+//      after them are folded in
+//   x  not recorded; null on replay
+//   O  written by the call; scratch memory on replay
+// Opcodes are positions in this list, after the frame mark, so changing it
+// needs a new kVersion.
+#define LYS_GL_CALLS(X) \
+    X(ActiveTexture, "--") \
+    X(AttachShader, "-ps") \
+    X(BindAttribLocation, "-p-S") \
+    X(BindBuffer, "--b") \
+    X(BindFramebuffer, "--f") \
+    X(BindRenderbuffer, "--r") \
+    X(BindTexture, "--t") \
+    X(BlendColor, "-----") \
+    X(BlendEquation, "--") \
+    X(BlendEquationSeparate, "---") \
+    X(BlendFunc, "---") \
+    X(BlendFuncSeparate, "-----") \
+    X(BufferData, "--wB-") \
+    X(BufferSubData, "--wwB") \
+    X(CheckFramebufferStatus, "--") \
+    X(Clear, "--") \
+    X(ClearColor, "-----") \
+    X(ClearDepthf, "--") \
+    X(ClearStencil, "--") \
+    X(ColorMask, "-----") \
+    X(CompileShader, "-s") \
+    X(CompressedTexImage2D, "--------B") \
+    X(CompressedTexSubImage2D, "---------B") \
+    X(CopyTexImage2D, "---------") \
+    X(CopyTexSubImage2D, "---------") \
+    X(CreateProgram, "p") \
+    X(CreateShader, "s-") \
+    X(CullFace, "--") \
+    X(DeleteBuffers, "--N") \
+    X(DeleteFramebuffers, "--N") \
+    X(DeleteProgram, "-p") \
+    X(DeleteRenderbuffers, "--N") \
+    X(DeleteShader, "-s") \
+    X(DeleteTextures, "--N") \
+    X(DepthFunc, "--") \
+    X(DepthMask, "--") \
+    X(DepthRangef, "---") \
+    X(DetachShader, "-ps") \
+    X(Disable, "--") \
+    X(DisableVertexAttribArray, "--") \
+    X(DrawArrays, "----") \
+    X(DrawElements, "----o") \
+    X(Enable, "--") \
+    X(EnableVertexAttribArray, "--") \
+    X(Finish, "-") \
+    X(Flush, "-") \
+    X(FramebufferRenderbuffer, "----r") \
+    X(FramebufferTexture2D, "----t-") \
+    X(FrontFace, "--") \
+    X(GenBuffers, "--G") \
+    X(GenFramebuffers, "--G") \
+    X(GenRenderbuffers, "--G") \
+    X(GenTextures, "--G") \
+    X(GenerateMipmap, "--") \
+    X(GetActiveAttrib, "-p--OOOO") \
+    X(GetActiveUniform, "-p--OOOO") \
+    X(GetAttachedShaders, "-p-OO") \
+    X(GetAttribLocation, "-pS") \
+    X(GetBooleanv, "--O") \
+    X(GetBufferParameteriv, "---O") \
+    X(GetError, "-") \
+    X(GetFloatv, "--O") \
+    X(GetFramebufferAttachmentParameteriv, "----O") \
+    X(GetIntegerv, "--O") \
+    X(GetProgramInfoLog, "-p-OO") \
+    X(GetProgramiv, "-p-O") \
+    X(GetRenderbufferParameteriv, "---O") \
+    X(GetShaderInfoLog, "-s-OO") \
+    X(GetShaderPrecisionFormat, "---OO") \
+    X(GetShaderSource, "-s-OO") \
+    X(GetShaderiv, "-s-O") \
+    X(GetString, "--") \
+    X(GetTexParameterfv, "---O") \
+    X(GetTexParameteriv, "---O") \
+    X(GetUniformLocation, "upS") \
+    X(GetUniformfv, "-puO") \
+    X(GetUniformiv, "-puO") \
+    X(GetVertexAttribPointerv, "---O") \
+    X(GetVertexAttribfv, "---O") \
+    X(GetVertexAttribiv, "---O") \
+    X(Hint, "---") \
+    X(IsBuffer, "-b") \
+    X(IsEnabled, "--") \
+    X(IsFramebuffer, "-f") \
+    X(IsProgram, "-p") \
+    X(IsRenderbuffer, "-r") \
+    X(IsShader, "-s") \
+    X(IsTexture, "-t") \
+    X(LineWidth, "--") \
+    X(LinkProgram, "-p") \
+    X(PixelStorei, "---") \
+    X(PolygonOffset, "---") \
+    X(ReadPixels, "-------O") \
+    X(ReleaseShaderCompiler, "-") \
+    X(RenderbufferStorage, "-----") \
+    X(SampleCoverage, "---") \
+    X(Scissor, "-----") \
+    X(ShaderBinary, "--N-B-") \
+    X(ShaderSource, "-s-Lx") \
+    X(StencilFunc, "----") \
+    X(StencilFuncSeparate, "-----") \
+    X(StencilMask, "--") \
+    X(StencilMaskSeparate, "---") \
+    X(StencilOp, "----") \
+    X(StencilOpSeparate, "-----") \
+    X(TexImage2D, "---------B") \
+    X(TexParameterf, "----") \
+    X(TexParameterfv, "---B") \
+    X(TexParameteri, "----") \
+    X(TexParameteriv, "---B") \
+    X(TexSubImage2D, "---------B") \
+    X(Uniform1f, "-u-") \
+    X(Uniform1fv, "-u-B") \
+    X(Uniform1i, "-u-") \
+    X(Uniform1iv, "-u-B") \
+    X(Uniform2f, "-u--") \
+    X(Uniform2fv, "-u-B") \
+    X(Uniform2i, "-u--") \
+    X(Uniform2iv, "-u-B") \
+    X(Uniform3f, "-u---") \
+    X(Uniform3fv, "-u-B") \
+    X(Uniform3i, "-u---") \
+    X(Uniform3iv, "-u-B") \
+    X(Uniform4f, "-u----") \
+    X(Uniform4fv, "-u-B") \
+    X(Uniform4i, "-u----") \
+    X(Uniform4iv, "-u-B") \
+    X(UniformMatrix2fv, "-u--B") \
+    X(UniformMatrix3fv, "-u--B") \
+    X(UniformMatrix4fv, "-u--B") \
+    X(UseProgram, "-p") \
+    X(ValidateProgram, "-p") \
+    X(VertexAttrib1f, "---") \
+    X(VertexAttrib1fv, "--B") \
+    X(VertexAttrib2f, "----") \
+    X(VertexAttrib2fv, "--B") \
+    X(VertexAttrib3f, "-----") \
+    X(VertexAttrib3fv, "--B") \
+    X(VertexAttrib4f, "------") \
+    X(VertexAttrib4fv, "--B") \
+    X(VertexAttribPointer, "------o") \
+    X(Viewport, "-----")
+
+enum Op : uint32_t {
+    kOpFrame = 0,
+#define LYS_GL_CALL_OP(name, signature) kOp##name,
+    LYS_GL_CALLS(LYS_GL_CALL_OP)
+#undef LYS_GL_CALL_OP
+    kOpCount
+};
+
+// Kinds of object names, in signature order
+enum NameKind : int {
+    kNameBuffer = 0,
+    kNameTexture,
+    kNameFramebuffer,
+    kNameRenderbuffer,
+    kNameProgram,
+    kNameShader,
+    kNameKindCount
+};
+
+int nameKind(char code) {
+    const char *kinds = "btfrps";
+    const char *kind = code != '\0' ? strchr(kinds, code) : nullptr;
+    return kind != nullptr ? static_cast<int>(kind - kinds) : -1;
+}
+
+// Kind of the names an N or G argument holds
+int nameKind(uint32_t op) {
+    switch (op) {
+    case kOpDeleteBuffers:
+    case kOpGenBuffers:
+        return kNameBuffer;
+    case kOpDeleteTextures:
+    case kOpGenTextures:
+        return kNameTexture;
+    case kOpDeleteFramebuffers:
+    case kOpGenFramebuffers:
+        return kNameFramebuffer;
+    case kOpDeleteRenderbuffers:
+    case kOpGenRenderbuffers:
+        return kNameRenderbuffer;
+    default:
+        return kNameShader;
+    }
+}
+
+// A count argument, with negative ones (a GL error) as none
+uint64_t count(uint64_t slot) {
+    int32_t value = static_cast<int32_t>(static_cast<uint32_t>(slot));
+    return value > 0 ? static_cast<uint64_t>(value) : 0;
+}
+
+uint32_t bytesPerPixel(GLenum format, GLenum type) {
+    uint32_t channels = 4;
+    switch (format) {
+    case GL_ALPHA:
+    case GL_LUMINANCE:
+    case GL_DEPTH_COMPONENT:
+        channels = 1;
+        break;
+    case GL_LUMINANCE_ALPHA:
+        channels = 2;
+        break;
+    case GL_RGB:
+        channels = 3;
+        break;
+    }
+
+    switch (type) {
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+        return 2;
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT_OES:
+        return channels * 2;
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+        return channels * 4;
+    default:
+        return channels;
+    }
+}
+
+// Bytes GL reads for an image, with rows padded to the unpack alignment
+// except the last
+uint64_t imageBytes(uint64_t width, uint64_t height, uint64_t format, uint64_t type, uint32_t alignment) {
+    uint64_t row = count(width) * bytesPerPixel(static_cast<GLenum>(format), static_cast<GLenum>(type));
+    uint64_t rows = count(height);
+    if (row == 0 || rows == 0)
+        return 0;
+    uint64_t stride = (row + alignment - 1) / alignment * alignment;
+    return stride * (rows - 1) + row;
+}
+
+// Bytes a B argument points to
+uint64_t blockBytes(uint32_t op, const uint64_t *slots, uint32_t unpack_alignment) {
+    switch (op) {
+    case kOpBufferData:
+        return static_cast<int64_t>(slots[1]) > 0 ? slots[1] : 0;
+    case kOpBufferSubData:
+        return static_cast<int64_t>(slots[2]) > 0 ? slots[2] : 0;
+    case kOpCompressedTexImage2D:
+        return count(slots[6]);
+    case kOpCompressedTexSubImage2D:
+        return count(slots[7]);
+    case kOpShaderBinary:
+        return count(slots[4]);
+    case kOpTexImage2D:
+        return imageBytes(slots[3], slots[4], slots[6], slots[7], unpack_alignment);
+    case kOpTexSubImage2D:
+        return imageBytes(slots[4], slots[5], slots[6], slots[7], unpack_alignment);
+    case kOpTexParameterfv:
+    case kOpTexParameteriv:
+    case kOpVertexAttrib1fv:
+        return 4;
+    case kOpVertexAttrib2fv:
+        return 8;
+    case kOpVertexAttrib3fv:
+        return 12;
+    case kOpVertexAttrib4fv:
+        return 16;
+    case kOpUniform1fv:
+    case kOpUniform1iv:
+        return count(slots[1]) * 4;
+    case kOpUniform2fv:
+    case kOpUniform2iv:
+        return count(slots[1]) * 8;
+    case kOpUniform3fv:
+    case kOpUniform3iv:
+        return count(slots[1]) * 12;
+    case kOpUniform4fv:
+    case kOpUniform4iv:
+    case kOpUniformMatrix2fv:
+        return count(slots[1]) * 16;
+    case kOpUniformMatrix3fv:
+        return count(slots[1]) * 36;
+    case kOpUniformMatrix4fv:
+        return count(slots[1]) * 64;
+    default:
+        return 0;
+    }
+}
+
+
+// Arguments travel as 64-bit slots: integers and enums as their value,
+// floats as their bits and pointers as addresses
+template <typename T>
+uint64_t toSlot(T value) {
+    return static_cast<uint64_t>(value);
+}
+
+template <typename T>
+uint64_t toSlot(T *value) {
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value));
+}
+
+uint64_t toSlot(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// 32-bit values arrive zero-extended, so they're truncated back first
+template <typename T>
+struct FromSlot {
+    static T get(uint64_t slot) {
+        return sizeof(T) > 4 ? static_cast<T>(slot) : static_cast<T>(static_cast<uint32_t>(slot));
+    }
+};
+
+template <typename T>
+struct FromSlot<T*> {
+    static T* get(uint64_t slot) {
+        return reinterpret_cast<T*>(static_cast<uintptr_t>(slot));
+    }
+};
+
+template <>
+struct FromSlot<float> {
+    static float get(uint64_t slot) {
+        uint32_t bits = static_cast<uint32_t>(slot);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+template <size_t... I>
+struct Indices {};
+
+template <size_t N, size_t... I>
+struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+
+template <size_t... I>
+struct MakeIndices<0, I...> {
+    typedef Indices<I...> Type;
+};
+
+
+typedef void (GL_APIENTRY *GLProc)();
+
+// Entry points the capture wrappers forward to
+GLProc gReal[kOpCount];
+
+// Buffers the trace while capturing
+struct Writer {
+    FILE *file = nullptr;
+    Vector<uint8_t> buffer;
+    uint64_t written = 0;
+    bool failed = false;
+    uint32_t frames = 0;
+    uint32_t unpackAlignment = 4;
+
+    void word(uint32_t value) {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+    }
+
+    void wide(uint64_t value) {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+    }
+
+    void data(const void *data, size_t size) {
+        const uint8_t *bytes = static_cast<const uint8_t*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+        buffer.resize((buffer.size() + 3) & ~static_cast<size_t>(3), 0);
+    }
+
+    void block(const void *data, uint64_t size) {
+        if (data == nullptr) {
+            word(kNullData);
+            return;
+        }
+        word(static_cast<uint32_t>(size));
+        this->data(data, static_cast<size_t>(size));
+    }
+
+    // Strings keep their terminator, so they can be replayed in place
+    void string(const char *text, size_t length) {
+        word(static_cast<uint32_t>(length));
+        buffer.insert(buffer.end(), text, text + length);
+        data("", 1);
+    }
+
+    void flush() {
+        if (!buffer.empty() && fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+            failed = true;
+        written += buffer.size();
+        buffer.clear();
+    }
+
+    void begin(uint32_t op, const uint64_t *slots);
+    void end(uint32_t op, const uint64_t *slots, uint64_t result);
+};
+
+Writer *gWriter = nullptr;
+
+template <uint32_t Op, typename F>
+struct GLFunction;
+
+template <uint32_t Op, typename R, typename... A>
+struct GLFunction<Op, R (GL_APIENTRY *)(A...)> {
+    typedef R (GL_APIENTRY *Pointer)(A...);
+    static const size_t kArgs = sizeof...(A);
+    static_assert(kArgs <= kMaxArgs, "Too many arguments");
+
+    static R GL_APIENTRY hook(A... args) {
+        const uint64_t slots[] = {toSlot(args)..., 0};
+        if (gWriter != nullptr)
+            gWriter->begin(Op, slots);
+        R result = reinterpret_cast<Pointer>(gReal[Op])(args...);
+        if (gWriter != nullptr)
+            gWriter->end(Op, slots, toSlot(result));
+        return result;
+    }
+
+    template <size_t... I>
+    static R invoke(GLProc function, const uint64_t *slots, Indices<I...>) {
+        (void)slots;
+        return reinterpret_cast<Pointer>(function)(FromSlot<A>::get(slots[I])...);
+    }
+
+    static void replay(GLProc function, const uint64_t *slots, uint64_t *result) {
+        *result = toSlot(invoke(function, slots, typename MakeIndices<kArgs>::Type()));
+    }
+};
+
+template <uint32_t Op, typename... A>
+struct GLFunction<Op, void (GL_APIENTRY *)(A...)> {
+    typedef void (GL_APIENTRY *Pointer)(A...);
+    static const size_t kArgs = sizeof...(A);
+    static_assert(kArgs <= kMaxArgs, "Too many arguments");
+
+    static void GL_APIENTRY hook(A... args) {
+        const uint64_t slots[] = {toSlot(args)..., 0};
+        if (gWriter != nullptr)
+            gWriter->begin(Op, slots);
+        reinterpret_cast<Pointer>(gReal[Op])(args...);
+        if (gWriter != nullptr)
+            gWriter->end(Op, slots, 0);
+    }
+
+    template <size_t... I>
+    static void invoke(GLProc function, const uint64_t *slots, Indices<I...>) {
+        (void)slots;
+        reinterpret_cast<Pointer>(function)(FromSlot<A>::get(slots[I])...);
+    }
+
+    static void replay(GLProc function, const uint64_t *slots, uint64_t *result) {
+        invoke(function, slots, typename MakeIndices<kArgs>::Type());
+        *result = 0;
+    }
+};
+
+// Names are given without the gl prefix, which would expand to _glptr_gl*
+#define LYS_GL_CALL_FUNCTIONS(name, signature) \
+    typedef GLFunction<kOp##name, PFN_gl##name> Function##name; \
+    static_assert(sizeof(signature) - 2 == Function##name::kArgs, "Signature of gl" #name " is the wrong length"); \
+    void install##name() { \
+        gReal[kOp##name] = reinterpret_cast<GLProc>(_glptr_gl##name); \
+        _glptr_gl##name = Function##name::hook; \
+    } \
+    void remove##name() { \
+        if (_glptr_gl##name == Function##name::hook) \
+            _glptr_gl##name = reinterpret_cast<PFN_gl##name>(gReal[kOp##name]); \
+    } \
+    void replay##name(const uint64_t *slots, uint64_t *result) { \
+        Function##name::replay(reinterpret_cast<GLProc>(_glptr_gl##name), slots, result); \
+    }
+LYS_GL_CALLS(LYS_GL_CALL_FUNCTIONS)
+#undef LYS_GL_CALL_FUNCTIONS
+
+struct OpInfo {
+    const char *signature;
+    void (*install)();
+    void (*remove)();
+    void (*replay)(const uint64_t *slots, uint64_t *result);
+};
+
+const OpInfo kOps[kOpCount] = {
+    {"", nullptr, nullptr, nullptr},
+#define LYS_GL_CALL_INFO(name, signature) {signature, install##name, remove##name, replay##name},
+    LYS_GL_CALLS(LYS_GL_CALL_INFO)
+#undef LYS_GL_CALL_INFO
+};
+
+void installGLHooks(void*) {
+    // Save real entry points (or whichever layer was installed before us)
+    loadGLPointers();
+    for (uint32_t op = 1; op < kOpCount; ++op)
+        kOps[op].install();
+}
+
+void removeGLHooks() {
+    for (uint32_t op = 1; op < kOpCount; ++op)
+        kOps[op].remove();
+}
+
+
+void Writer::begin(uint32_t op, const uint64_t *slots) {
+    const char *signature = kOps[op].signature + 1;
+    word(op);
+    for (uint32_t i = 0; signature[i] != '\0'; ++i) {
+        const void *pointer = FromSlot<const void*>::get(slots[i]);
+        switch (signature[i]) {
+        case 'w':
+        case 'o':
+            wide(slots[i]);
+            break;
+        case 'S': {
+            const char *text = static_cast<const char*>(pointer);
+            string(text != nullptr ? text : "", text != nullptr ? strlen(text) : 0);
+            break;
+        }
+        case 'B':
+            block(pointer, blockBytes(op, slots, unpackAlignment));
+            break;
+        case 'N': {
+            const GLuint *names = static_cast<const GLuint*>(pointer);
+            for (uint64_t n = 0; n < count(slots[i - 1]); ++n)
+                word(names != nullptr ? names[n] : 0);
+            break;
+        }
+        case 'L': {
+            const GLchar *const *strings = static_cast<const GLchar *const*>(pointer);
+            const GLint *lengths = FromSlot<const GLint*>::get(slots[i + 1]);
+            for (uint64_t n = 0; n < count(slots[i - 1]); ++n) {
+                const char *text = strings != nullptr && strings[n] != nullptr ? strings[n] : "";
+                bool sized = lengths != nullptr && lengths[n] >= 0;
+                string(text, sized ? static_cast<size_t>(lengths[n]) : strlen(text));
+            }
+            break;
+        }
+        case 'G':
+        case 'x':
+        case 'O':
+            break;
+        default:
+            word(static_cast<uint32_t>(slots[i]));
+        }
+    }
+
+    // Texture uploads are sized by the alignment when they're made
+    if (op == kOpPixelStorei && slots[0] == GL_UNPACK_ALIGNMENT) {
+        uint32_t alignment = static_cast<uint32_t>(slots[1]);
+        if (alignment == 1 || alignment == 2 || alignment == 4 || alignment == 8)
+            unpackAlignment = alignment;
+    }
+}
+
+
+void Writer::end(uint32_t op, const uint64_t *slots, uint64_t result) {
+    const char *signature = kOps[op].signature;
+    for (uint32_t i = 0; signature[i + 1] != '\0'; ++i) {
+        if (signature[i + 1] != 'G')
+            continue;
+        const GLuint *names = FromSlot<const GLuint*>::get(slots[i]);
+        for (uint64_t n = 0; n < count(slots[i - 1]); ++n)
+            word(names != nullptr ? names[n] : 0);
+    }
+    if (signature[0] != '-')
+        word(static_cast<uint32_t>(result));
+    if (buffer.size() >= kFlushBytes)
+        flush();
+}
+
+
+// Reads a loaded trace, refusing to run off its end
+struct Reader {
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+
+    bool word(uint32_t *value) {
+        if (size - pos < sizeof(*value))
+            return false;
+        memcpy(value, data + pos, sizeof(*value));
+        pos += sizeof(*value);
+        return true;
+    }
+
+    bool wide(uint64_t *value) {
+        if (size - pos < sizeof(*value))
+            return false;
+        memcpy(value, data + pos, sizeof(*value));
+        pos += sizeof(*value);
+        return true;
+    }
+
+    bool bytes(uint64_t length, const uint8_t **out) {
+        uint64_t padded = (length + 3) & ~static_cast<uint64_t>(3);
+        if (size - pos < padded)
+            return false;
+        *out = data + pos;
+        pos += static_cast<size_t>(padded);
+        return true;
+    }
+
+    bool string(const char **out) {
+        uint32_t length;
+        const uint8_t *text;
+        if (!word(&length) || !bytes(length + static_cast<uint64_t>(1), &text) || text[length] != '\0')
+            return false;
+        *out = reinterpret_cast<const char*>(text);
+        return true;
+    }
+};
+
+// Replay scratch memory: room for each output argument, with the last one
+// (a name, log or pixels) given the rest
+const size_t kOutputStride = 64;
+const size_t kMinScratchBytes = 64 * 1024;
+
+size_t outputBytes(uint32_t op, const uint64_t *slots) {
+    switch (op) {
+    case kOpReadPixels:
+        return static_cast<size_t>((count(slots[2]) * 16 + 8) * count(slots[3]));
+    case kOpGetActiveAttrib:
+    case kOpGetActiveUniform:
+        return static_cast<size_t>(count(slots[2]));
+    case kOpGetAttachedShaders:
+        return static_cast<size_t>(count(slots[1]) * sizeof(GLuint));
+    case kOpGetProgramInfoLog:
+    case kOpGetShaderInfoLog:
+    case kOpGetShaderSource:
+        return static_cast<size_t>(count(slots[1]));
+    default:
+        return 0;
+    }
+}
+
+int64_t since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+
+struct GLCapture::Impl {
+    Writer writer;
+};
+
+
+LYS_API GLCapture::GLCapture() {
+    pimpl_ = new Impl();
+}
+
+
+LYS_API GLCapture::~GLCapture() {
+    stop();
+    delete pimpl_;
+}
+
+
+LYS_API GLCapture& GLCapture::global() {
+    static GLCapture capture;
+    return capture;
+}
+
+
+LYS_API bool GLCapture::start(const String &path, const Dimension2Di32 &framebuffer_size) {
+    if (gWriter != nullptr)
+        return false;
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    if (!addGLResetCallback(installGLHooks, nullptr)) {
+        fclose(file);
+        return false;
+    }
+
+    Writer &writer = pimpl_->writer;
+    writer.file = file;
+    writer.buffer.reserve(kFlushBytes + 4096);
+    writer.written = 0;
+    writer.failed = false;
+    writer.frames = 0;
+    writer.unpackAlignment = 4;
+    writer.data(kMagic, sizeof(kMagic));
+    writer.word(kVersion);
+    writer.word(kByteOrder);
+    writer.word(static_cast<uint32_t>(framebuffer_size.width()));
+    writer.word(static_cast<uint32_t>(framebuffer_size.height()));
+    gWriter = &writer;
+    installGLHooks(nullptr);
+    return true;
+}
+
+
+LYS_API bool GLCapture::stop() {
+    Writer &writer = pimpl_->writer;
+    if (gWriter != &writer)
+        return false;
+    removeGLResetCallback(installGLHooks, nullptr);
+    removeGLHooks();
+    gWriter = nullptr;
+
+    writer.flush();
+    if (fclose(writer.file) != 0)
+        writer.failed = true;
+    writer.file = nullptr;
+    Vector<uint8_t>().swap(writer.buffer);
+    return !writer.failed;
+}
+
+
+LYS_API bool GLCapture::isCapturing() const {
+    return gWriter == &pimpl_->writer;
+}
+
+
+LYS_API void GLCapture::frame() {
+    Writer &writer = pimpl_->writer;
+    if (gWriter != &writer)
+        return;
+    writer.word(kOpFrame);
+    ++writer.frames;
+    writer.flush();
+}
+
+
+LYS_API uint32_t GLCapture::frames() const {
+    return pimpl_->writer.frames;
+}
+
+
+LYS_API uint64_t GLCapture::bytes() const {
+    return pimpl_->writer.written + pimpl_->writer.buffer.size();
+}
+
+
+struct GLReplay::Impl {
+    Impl() {
+        frameCount = 0;
+        frame = 0;
+        pos = 0;
+        program = 0;
+        unpackAlignment = 4;
+    }
+
+    // Reads the call at the reader's position, after its opcode, and makes
+    // it if executing. Returns false if the trace is cut short or corrupt.
+    bool call(Reader *in, uint32_t op, bool execute);
+
+    GLuint translate(int kind, uint32_t name) const {
+        auto found = names[kind].find(name);
+        return found != names[kind].end() ? found->second : name;
+    }
+
+    Vector<uint8_t> trace;
+    uint32_t frameCount;
+    uint32_t frame;
+    size_t pos;
+    Dimension2Di32 framebufferSize;
+    GLReplayStats stats;
+
+    // Captured names and uniform locations (keyed by program) to the
+    // replay's own
+    std::unordered_map<uint32_t, GLuint> names[kNameKindCount];
+    std::unordered_map<uint64_t, GLint> uniforms;
+    // The captured program in use
+    uint32_t program;
+    // GL_UNPACK_ALIGNMENT as of the call being loaded, to size image blocks
+    uint32_t unpackAlignment;
+
+    Vector<uint8_t> scratch;
+    Vector<GLuint> nameScratch;
+    Vector<uint32_t> capturedNames;
+    Vector<const GLchar*> strings;
+};
+
+
+bool GLReplay::Impl::call(Reader *in, uint32_t op, bool execute) {
+    const char *signature = kOps[op].signature;
+    uint64_t slots[kMaxArgs] = {0};
+    // Arguments as captured, before translation
+    uint32_t words[kMaxArgs] = {0};
+    uint32_t outputs[kMaxArgs];
+    uint32_t output_count = 0;
+    uint64_t generated = 0;
+    uint32_t value = 0;
+    // Size word of the call's B argument, if it has one
+    uint32_t block = kNullData;
+    // Uniform locations belong to the program named in the call, if any,
+    // otherwise to the one in use
+    uint32_t call_program = program;
+    nameScratch.clear();
+    capturedNames.clear();
+    strings.clear();
+
+    for (uint32_t i = 0; signature[i + 1] != '\0'; ++i) {
+        char code = signature[i + 1];
+        switch (code) {
+        case 'w':
+        case 'o':
+            if (!in->wide(&slots[i]))
+                return false;
+            break;
+        case 'S': {
+            const char *text;
+            if (!in->string(&text))
+                return false;
+            slots[i] = toSlot(text);
+            break;
+        }
+        case 'B': {
+            const uint8_t *data;
+            if (!in->word(&value))
+                return false;
+            block = value;
+            if (value == kNullData)
+                break;
+            if (!in->bytes(value, &data))
+                return false;
+            slots[i] = toSlot(data);
+            stats.uploadedBytes += value;
+            break;
+        }
+        case 'N':
+            for (uint64_t n = 0; n < count(slots[i - 1]); ++n) {
+                if (!in->word(&value))
+                    return false;
+                capturedNames.push_back(value);
+                nameScratch.push_back(translate(nameKind(op), value));
+            }
+            slots[i] = toSlot(nameScratch.data());
+            break;
+        case 'G':
+            // The names follow the call, so the trace must have room for them
+            generated = count(slots[i - 1]);
+            if (generated > (in->size - in->pos) / sizeof(uint32_t))
+                return false;
+            if (execute)
+                nameScratch.resize(static_cast<size_t>(generated));
+            slots[i] = toSlot(nameScratch.data());
+            break;
+        case 'L':
+            for (uint64_t n = 0; n < count(slots[i - 1]); ++n) {
+                const char *text;
+                if (!in->string(&text))
+                    return false;
+                strings.push_back(text);
+            }
+            slots[i] = toSlot(strings.data());
+            break;
+        case 'x':
+            break;
+        case 'O':
+            outputs[output_count++] = i;
+            break;
+        default:
+            if (!in->word(&value))
+                return false;
+            slots[i] = words[i] = value;
+            if (code == 'p')
+                call_program = value;
+            if (code == 'u') {
+                auto found = uniforms.find(static_cast<uint64_t>(call_program) << 32 | value);
+                if (found != uniforms.end())
+                    slots[i] = static_cast<uint32_t>(found->second);
+            } else if (nameKind(code) >= 0) {
+                slots[i] = translate(nameKind(code), value);
+            }
+        }
+    }
+
+    // While loading: a block shorter than the call's size arguments say
+    // would be read past on replay
+    if (!execute) {
+        if (block != kNullData && block < blockBytes(op, slots, unpackAlignment))
+            return false;
+        if (op == kOpPixelStorei && slots[0] == GL_UNPACK_ALIGNMENT
+            && (slots[1] == 1 || slots[1] == 2 || slots[1] == 4 || slots[1] == 8))
+            unpackAlignment = static_cast<uint32_t>(slots[1]);
+    }
+
+    uint64_t result = 0;
+    if (execute) {
+        if (output_count > 0) {
+            size_t bytes = std::max(kMinScratchBytes, kOutputStride * output_count + outputBytes(op, slots));
+            if (scratch.size() < bytes)
+                scratch.resize(bytes);
+            for (uint32_t n = 0; n < output_count; ++n)
+                slots[outputs[n]] = toSlot(scratch.data() + kOutputStride * n);
+        }
+        kOps[op].replay(slots, &result);
+        ++stats.calls;
+        if (op == kOpDrawArrays || op == kOpDrawElements)
+            ++stats.drawCalls;
+    }
+
+    // What the capture got back, to map to what the replay did
+    for (uint64_t n = 0; n < generated; ++n) {
+        if (!in->word(&value))
+            return false;
+        if (execute)
+            names[nameKind(op)][value] = nameScratch[static_cast<size_t>(n)];
+    }
+    if (signature[0] != '-') {
+        if (!in->word(&value))
+            return false;
+        if (execute && signature[0] == 'u')
+            uniforms[static_cast<uint64_t>(call_program) << 32 | value] = static_cast<GLint>(result);
+        else if (execute)
+            names[nameKind(signature[0])][value] = static_cast<GLuint>(result);
+    }
+    if (!execute)
+        return true;
+
+    switch (op) {
+    case kOpDeleteBuffers:
+    case kOpDeleteFramebuffers:
+    case kOpDeleteRenderbuffers:
+    case kOpDeleteTextures:
+        for (uint32_t name : capturedNames)
+            names[nameKind(op)].erase(name);
+        break;
+    case kOpDeleteProgram:
+        names[kNameProgram].erase(words[0]);
+        break;
+    case kOpDeleteShader:
+        names[kNameShader].erase(words[0]);
+        break;
+    case kOpUseProgram:
+        program = words[0];
+        break;
+    }
+    return true;
+}
+
+
+LYS_API GLReplay::GLReplay() {
+    pimpl_ = new Impl();
+}
+
+
+LYS_API GLReplay::~GLReplay() {
+    delete pimpl_;
+}
+
+
+LYS_API bool GLReplay::load(const String &path) {
+    Vector<uint8_t> data;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+    uint8_t chunk[16384];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + read);
+    bool failed = ferror(file) != 0;
+    fclose(file);
+    return !failed && loadFromMemory(data.data(), data.size());
+}
+
+
+LYS_API bool GLReplay::loadFromMemory(const void *data, size_t size) {
+    Impl &impl = *pimpl_;
+    impl.trace.clear();
+    impl.frameCount = 0;
+    impl.frame = 0;
+    impl.pos = 0;
+    impl.unpackAlignment = 4;
+
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    Reader in = {bytes, size, sizeof(kMagic)};
+    uint32_t version, byte_order, width, height;
+    if (size < kHeaderBytes || memcmp(bytes, kMagic, sizeof(kMagic)) != 0 || !in.word(&version)
+        || !in.word(&byte_order) || !in.word(&width) || !in.word(&height) || version != kVersion
+        || byte_order != kByteOrder)
+        return false;
+
+    // Walk every call once, so replaying never meets a broken one
+    uint32_t frames = 0;
+    bool open_frame = false;
+    uint32_t op;
+    while (in.word(&op)) {
+        if (op == kOpFrame) {
+            ++frames;
+            open_frame = false;
+        } else if (op >= kOpCount || !impl.call(&in, op, false)) {
+            return false;
+        } else {
+            open_frame = true;
+        }
+    }
+    if (in.pos != size)
+        return false;
+
+    impl.trace.assign(bytes, bytes + size);
+    impl.stats = GLReplayStats();
+    impl.frameCount = frames + (open_frame ? 1 : 0);
+    impl.pos = kHeaderBytes;
+    impl.framebufferSize = Dimension2Di32(static_cast<int32_t>(width), static_cast<int32_t>(height));
+    return true;
+}
+
+
+LYS_API uint32_t GLReplay::frameCount() const {
+    return pimpl_->frameCount;
+}
+
+
+LYS_API Dimension2Di32 GLReplay::framebufferSize() const {
+    return pimpl_->framebufferSize;
+}
+
+
+LYS_API uint32_t GLReplay::frame() const {
+    return pimpl_->frame;
+}
+
+
+LYS_API bool GLReplay::replayFrame(bool finish) {
+    Impl &impl = *pimpl_;
+    if (impl.frame >= impl.frameCount)
+        return false;
+
+    impl.stats = GLReplayStats();
+    Reader in = {impl.trace.data(), impl.trace.size(), impl.pos};
+    auto start = std::chrono::steady_clock::now();
+    uint32_t op;
+    while (in.word(&op) && op != kOpFrame)
+        impl.call(&in, op, true);
+    impl.stats.cpuMs = since(start) / 1.0e6f;
+    impl.pos = in.pos;
+    ++impl.frame;
+
+    if (finish) {
+        start = std::chrono::steady_clock::now();
+        glFinish();
+        impl.stats.finishMs = since(start) / 1.0e6f;
+    }
+    return true;
+}
+
+
+LYS_API void GLReplay::rewind() {
+    Impl &impl = *pimpl_;
+    Vector<GLuint> names;
+    for (int kind = 0; kind < kNameKindCount; ++kind) {
+        names.clear();
+        for (const auto &name : impl.names[kind])
+            names.push_back(name.second);
+        impl.names[kind].clear();
+        if (names.empty())
+            continue;
+        GLsizei count = static_cast<GLsizei>(names.size());
+        switch (kind) {
+        case kNameBuffer:
+            glDeleteBuffers(count, names.data());
+            break;
+        case kNameTexture:
+            glDeleteTextures(count, names.data());
+            break;
+        case kNameFramebuffer:
+            glDeleteFramebuffers(count, names.data());
+            break;
+        case kNameRenderbuffer:
+            glDeleteRenderbuffers(count, names.data());
+            break;
+        case kNameProgram:
+            for (GLuint name : names)
+                glDeleteProgram(name);
+            break;
+        case kNameShader:
+            for (GLuint name : names)
+                glDeleteShader(name);
+            break;
+        }
+    }
+    impl.uniforms.clear();
+    impl.program = 0;
+    impl.frame = 0;
+    impl.pos = impl.trace.empty() ? 0 : kHeaderBytes;
+}
+
+
+LYS_API const GLReplayStats& GLReplay::stats() const {
+    return pimpl_->stats;
+}
+}
@@ -0,0 +1,347 @@
+/***************************************************
+* GeometryPool.cc: Shared static vertex/index data *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "GeometryPool.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "GLES2/gl2.h"
+
+#include "config.h"
+#include "types.h"
+#include "OffsetAllocator.h"
+#include "Profiler.h"
+#include "ResourceRegistry.h"
+
+namespace lys3d {
+namespace {
+struct PoolMesh {
+    OffsetAllocation vertices;
+    OffsetAllocation indices;
+    bool live;
+};
+}
+
+
+struct GeometryPool::Impl {
+    Impl(const VertexLayout &vertex_layout, uint32_t vertex_capacity, uint32_t index_capacity)
+        : layout(vertex_layout),
+          vertexAllocator(vertex_capacity),
+          indexAllocator(index_capacity) {
+        vertexBuffer = 0;
+        indexBuffer = 0;
+        boundBase = ~static_cast<size_t>(0);
+        moves = 0;
+        movedBytes = 0;
+        indicesFirst = false;
+        vertexData.resize(static_cast<size_t>(vertex_capacity) * layout.stride());
+        indexData.resize(index_capacity);
+    }
+
+    PoolMesh* find(uint32_t id) {
+        if (id == 0 || id > meshes.size() || !meshes[id - 1].live)
+            return nullptr;
+        return &meshes[id - 1];
+    }
+
+    // Copy a range from the top of the buffer into a lower hole it fits in
+    bool relocate(OffsetAllocator *allocator, OffsetAllocation *range, uint8_t *data, uint32_t unit,
+                  GLenum target, GLuint buffer) {
+        OffsetAllocation moved = allocator->allocate(range->size);
+        if (!moved.isValid())
+            return false;
+        if (moved.offset > range->offset) {
+            allocator->free(moved);
+            return false;
+        }
+
+        size_t bytes = static_cast<size_t>(range->size) * unit;
+        uint8_t *dst = data + static_cast<size_t>(moved.offset) * unit;
+        memcpy(dst, data + static_cast<size_t>(range->offset) * unit, bytes);
+        if (buffer != 0) {
+            glBindBuffer(target, buffer);
+            glBufferSubData(target, static_cast<GLintptr>(moved.offset) * unit, static_cast<GLsizeiptr>(bytes), dst);
+        }
+        allocator->free(*range);
+        *range = moved;
+        ++moves;
+        movedBytes += bytes;
+        return true;
+    }
+
+    // Slide one range down over the hole before it, if there is one
+    void move(OffsetAllocator *allocator, OffsetAllocation *range, uint8_t *data, uint32_t unit,
+              GLenum target, GLuint buffer) {
+        OffsetAllocation moved = allocator->slideDown(*range);
+        if (moved.offset == range->offset)
+            return;
+
+        size_t bytes = static_cast<size_t>(range->size) * unit;
+        uint8_t *dst = data + static_cast<size_t>(moved.offset) * unit;
+        memmove(dst, data + static_cast<size_t>(range->offset) * unit, bytes);
+        if (buffer != 0) {
+            glBindBuffer(target, buffer);
+            glBufferSubData(target, static_cast<GLintptr>(moved.offset) * unit, static_cast<GLsizeiptr>(bytes), dst);
+        }
+        *range = moved;
+        ++moves;
+        movedBytes += bytes;
+    }
+
+    VertexLayout layout;
+    OffsetAllocator vertexAllocator;
+    OffsetAllocator indexAllocator;
+    GLuint vertexBuffer;
+    GLuint indexBuffer;
+    size_t boundBase;
+    Vector<uint8_t> vertexData;
+    Vector<uint16_t> indexData;
+    Vector<PoolMesh> meshes;
+    Vector<uint32_t> freeIds;
+    Vector<uint32_t> order;
+    uint32_t moves;
+    uint64_t movedBytes;
+    bool indicesFirst;
+};
+
+
+LYS_API GeometryPool::GeometryPool(const VertexLayout &layout, uint32_t vertex_capacity,
+                                   uint32_t index_capacity) {
+    pimpl_ = new Impl(layout, vertex_capacity, index_capacity);
+}
+
+
+LYS_API GeometryPool::~GeometryPool() {
+    this->destroy();
+    delete this->pimpl_;
+}
+
+
+LYS_API bool GeometryPool::create() {
+    if (isCreated())
+        return true;
+
+    // Whole-buffer uploads from the CPU copy; the unused parts are zeros
+    GLuint buffers[2];
+    glGenBuffers(2, buffers);
+    pimpl_->vertexBuffer = buffers[0];
+    pimpl_->indexBuffer = buffers[1];
+    glBindBuffer(GL_ARRAY_BUFFER, pimpl_->vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(pimpl_->vertexData.size()), pimpl_->vertexData.data(),
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pimpl_->indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(pimpl_->indexData.size() * sizeof(uint16_t)),
+                 pimpl_->indexData.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    ResourceRegistry &registry = ResourceRegistry::global();
+    registry.track(GpuResourceType::kBuffer, pimpl_->vertexBuffer, pimpl_->vertexData.size());
+    registry.track(GpuResourceType::kBuffer, pimpl_->indexBuffer, pimpl_->indexData.size() * sizeof(uint16_t));
+    return true;
+}
+
+
+LYS_API void GeometryPool::destroy() {
+    ResourceRegistry &registry = ResourceRegistry::global();
+    registry.release(GpuResourceType::kBuffer, pimpl_->vertexBuffer);
+    registry.release(GpuResourceType::kBuffer, pimpl_->indexBuffer);
+    pimpl_->vertexBuffer = 0;
+    pimpl_->indexBuffer = 0;
+}
+
+
+LYS_API bool GeometryPool::isCreated() const {
+    return pimpl_->vertexBuffer != 0;
+}
+
+
+LYS_API const VertexLayout& GeometryPool::layout() const {
+    return pimpl_->layout;
+}
+
+
+LYS_API uint32_t GeometryPool::add(const void *vertices, uint32_t vertex_count, const uint16_t *indices,
+                                   uint32_t index_count) {
+    Impl &impl = *pimpl_;
+    if (vertex_count == 0 || vertex_count > 65536 || index_count == 0)
+        return 0;
+
+    PoolMesh mesh;
+    mesh.vertices = impl.vertexAllocator.allocate(vertex_count);
+    mesh.indices = impl.indexAllocator.allocate(index_count);
+    if (!mesh.vertices.isValid() || !mesh.indices.isValid()) {
+        impl.vertexAllocator.free(mesh.vertices);
+        impl.indexAllocator.free(mesh.indices);
+        return 0;
+    }
+    mesh.live = true;
+
+    uint32_t stride = impl.layout.stride();
+    uint8_t *vertex_dst = impl.vertexData.data() + static_cast<size_t>(mesh.vertices.offset) * stride;
+    uint16_t *index_dst = impl.indexData.data() + mesh.indices.offset;
+    memcpy(vertex_dst, vertices, static_cast<size_t>(vertex_count) * stride);
+    memcpy(index_dst, indices, static_cast<size_t>(index_count) * sizeof(uint16_t));
+    if (isCreated()) {
+        glBindBuffer(GL_ARRAY_BUFFER, impl.vertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(mesh.vertices.offset) * stride,
+                        static_cast<GLsizeiptr>(vertex_count) * stride, vertex_dst);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, impl.indexBuffer);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLintptr>(mesh.indices.offset * sizeof(uint16_t)),
+                        static_cast<GLsizeiptr>(index_count * sizeof(uint16_t)), index_dst);
+    }
+
+    if (!impl.freeIds.empty()) {
+        uint32_t id = impl.freeIds.back();
+        impl.freeIds.pop_back();
+        impl.meshes[id - 1] = mesh;
+        return id;
+    }
+    impl.meshes.push_back(mesh);
+    return static_cast<uint32_t>(impl.meshes.size());
+}
+
+
+LYS_API uint32_t GeometryPool::add(const Mesh &mesh) {
+    if (pimpl_->layout.stride() != sizeof(MeshVertex))
+        return 0;
+    return add(mesh.vertices().data(), static_cast<uint32_t>(mesh.vertices().size()), mesh.indices().data(),
+               static_cast<uint32_t>(mesh.indices().size()));
+}
+
+
+LYS_API void GeometryPool::remove(uint32_t id) {
+    PoolMesh *mesh = pimpl_->find(id);
+    if (mesh == nullptr)
+        return;
+    pimpl_->vertexAllocator.free(mesh->vertices);
+    pimpl_->indexAllocator.free(mesh->indices);
+    mesh->live = false;
+    pimpl_->freeIds.push_back(id);
+}
+
+
+LYS_API void GeometryPool::bind() {
+    glBindBuffer(GL_ARRAY_BUFFER, pimpl_->vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pimpl_->indexBuffer);
+    pimpl_->layout.apply(0);
+    pimpl_->boundBase = 0;
+}
+
+
+LYS_API void GeometryPool::unbind() const {
+    pimpl_->layout.disable();
+}
+
+
+LYS_API void GeometryPool::draw(uint32_t id, uint32_t first_index, uint32_t index_count) {
+    PoolMesh *mesh = pimpl_->find(id);
+    if (mesh == nullptr || first_index >= mesh->indices.size)
+        return;
+    index_count = std::min(index_count, mesh->indices.size - first_index);
+
+    // GLES2 has no base vertex, so each mesh gets its own attribute base
+    size_t base = static_cast<size_t>(mesh->vertices.offset) * pimpl_->layout.stride();
+    if (base != pimpl_->boundBase) {
+        pimpl_->layout.rebase(base);
+        pimpl_->boundBase = base;
+    }
+    size_t index_bytes = (static_cast<size_t>(mesh->indices.offset) + first_index) * sizeof(uint16_t);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(index_count), GL_UNSIGNED_SHORT,
+                   reinterpret_cast<const void*>(index_bytes));
+}
+
+
+LYS_API uint32_t GeometryPool::defragment(uint64_t max_bytes) {
+    LYS_PROFILE_ZONE("Geometry defragmentation");
+    Impl &impl = *pimpl_;
+    impl.moves = 0;
+    impl.movedBytes = 0;
+
+    // Two steps per buffer: ranges at the top move into lower holes they
+    // fit in, which costs one copy per hole filled; then whatever holes are
+    // left get closed from the bottom up, each range sliding over the hole
+    // before it so the free space gathers at the end of the buffer. Both
+    // buffers share the budget, and a range that won't fit in what is left
+    // of it stays put, unless nothing has moved yet. The buffers take turns
+    // going first, so neither waits for the other to be tidy
+    for (int pass = 0; pass < 2; ++pass) {
+        bool vertices = (pass == 0) != impl.indicesFirst;
+        OffsetAllocator *allocator = vertices ? &impl.vertexAllocator : &impl.indexAllocator;
+        uint8_t *data = vertices ? impl.vertexData.data() : reinterpret_cast<uint8_t*>(impl.indexData.data());
+        uint32_t unit = vertices ? impl.layout.stride() : static_cast<uint32_t>(sizeof(uint16_t));
+        GLenum target = vertices ? GL_ARRAY_BUFFER : GL_ELEMENT_ARRAY_BUFFER;
+        GLuint buffer = vertices ? impl.vertexBuffer : impl.indexBuffer;
+        auto range = [&impl, vertices](uint32_t index) -> OffsetAllocation& {
+            return vertices ? impl.meshes[index].vertices : impl.meshes[index].indices;
+        };
+        auto fits = [&impl, max_bytes, unit](const OffsetAllocation &moving) {
+            uint64_t bytes = static_cast<uint64_t>(moving.size) * unit;
+            return impl.moves == 0 || impl.movedBytes + bytes <= max_bytes;
+        };
+
+        impl.order.clear();
+        for (uint32_t i = 0; i < impl.meshes.size(); ++i) {
+            if (impl.meshes[i].live)
+                impl.order.push_back(i);
+        }
+        std::sort(impl.order.begin(), impl.order.end(), [&range](uint32_t a, uint32_t b) {
+            return range(a).offset < range(b).offset;
+        });
+
+        for (auto it = impl.order.rbegin(); it != impl.order.rend() && impl.movedBytes < max_bytes; ++it) {
+            if (fits(range(*it)))
+                impl.relocate(allocator, &range(*it), data, unit, target, buffer);
+        }
+
+        // Relocation changed the order, but only by moving ranges into holes
+        std::sort(impl.order.begin(), impl.order.end(), [&range](uint32_t a, uint32_t b) {
+            return range(a).offset < range(b).offset;
+        });
+        for (uint32_t index : impl.order) {
+            if (impl.movedBytes >= max_bytes || !fits(range(index)))
+                break;
+            impl.move(allocator, &range(index), data, unit, target, buffer);
+        }
+    }
+    impl.indicesFirst = !impl.indicesFirst;
+    impl.boundBase = ~static_cast<size_t>(0);
+    return impl.moves;
+}
+
+
+LYS_API uint32_t GeometryPool::vertexOffset(uint32_t id) const {
+    PoolMesh *mesh = pimpl_->find(id);
+    return mesh != nullptr ? mesh->vertices.offset : 0;
+}
+
+
+LYS_API uint32_t GeometryPool::indexOffset(uint32_t id) const {
+    PoolMesh *mesh = pimpl_->find(id);
+    return mesh != nullptr ? mesh->indices.offset : 0;
+}
+
+
+LYS_API GeometryPoolStats GeometryPool::stats() const {
+    const Impl &impl = *pimpl_;
+    GeometryPoolStats stats;
+    stats.meshCount = impl.vertexAllocator.allocationCount();
+    stats.vertexBytes = static_cast<uint64_t>(impl.vertexAllocator.size() - impl.vertexAllocator.freeSize())
+        * impl.layout.stride();
+    stats.indexBytes = static_cast<uint64_t>(impl.indexAllocator.size() - impl.indexAllocator.freeSize())
+        * sizeof(uint16_t);
+    stats.vertexFragmentation = impl.vertexAllocator.fragmentation();
+    stats.indexFragmentation = impl.indexAllocator.fragmentation();
+    stats.moves = impl.moves;
+    stats.movedBytes = impl.movedBytes;
+    return stats;
+}
+}
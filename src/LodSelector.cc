@@ -0,0 +1,115 @@
+/***************************************************
+* LodSelector.cc: Screen-space-error LOD selection *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "LodSelector.h"
+
+#include <math.h>
+
+#include "Simd.h"
+#include "config.h"
+#include "types.h"
+#include "Profiler.h"
+
+namespace lys3d {
+namespace {
+// Distances are clamped to this so the camera being inside a bounding sphere
+// doesn't divide by zero (or flip the sign).
+const float kMinDistance = 1e-3f;
+}
+
+
+LYS_API LodSelector::LodSelector() {
+    projection(Dimension2Di32(1920, 1080), 1.0471976f);
+    threshold_ = 1.0f;
+    hysteresis_ = 0.25f;
+}
+
+
+LYS_API void LodSelector::projection(const IWindow &window, float fov_y) {
+    projection(window.sizeInPixels(), fov_y);
+}
+
+
+LYS_API void LodSelector::projection(const Dimension2Di32 &viewport, float fov_y) {
+    // Pixels covered by one world unit at distance 1
+    projScale_ = viewport.height() / (2.0f * tanf(fov_y * 0.5f));
+}
+
+
+LYS_API void LodSelector::select(const Point3Df &camera, LodVisibleList *list) {
+    LYS_PROFILE_ZONE("LOD selection");
+    size_t count = list->size();
+    pixelsPerUnit_.resize(count);
+    float *ppu = pixelsPerUnit_.data();
+    const float *cx = list->centerX.data();
+    const float *cy = list->centerY.data();
+    const float *cz = list->centerZ.data();
+    const float *radius = list->radius.data();
+
+    // Pass 1: projected scale of every instance (distance to the nearest
+    // point of its bounding sphere), four at a time where possible.
+    size_t i = 0;
+#ifdef LYS_SIMD_SSE2
+    const __m128 cam_x = _mm_set1_ps(camera.x());
+    const __m128 cam_y = _mm_set1_ps(camera.y());
+    const __m128 cam_z = _mm_set1_ps(camera.z());
+    const __m128 scale = _mm_set1_ps(projScale_);
+    const __m128 min_dist = _mm_set1_ps(kMinDistance);
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(cx + i), cam_x);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(cy + i), cam_y);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(cz + i), cam_z);
+        __m128 dist_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                                    _mm_mul_ps(dz, dz));
+        __m128 dist = _mm_sub_ps(_mm_sqrt_ps(dist_sq), _mm_loadu_ps(radius + i));
+        _mm_storeu_ps(ppu + i, _mm_div_ps(scale, _mm_max_ps(dist, min_dist)));
+    }
+#endif
+    for (; i < count; ++i) {
+        float dx = cx[i] - camera.x();
+        float dy = cy[i] - camera.y();
+        float dz = cz[i] - camera.z();
+        float dist = sqrtf(dx * dx + dy * dy + dz * dz) - radius[i];
+        ppu[i] = projScale_ / fmaxf(dist, kMinDistance);
+    }
+
+    // Pass 2: walk each chain from last frame's level. Refine as soon as the
+    // error is visible, but only coarsen once it's comfortably below the
+    // threshold, so instances near a boundary don't flicker between levels.
+    float coarsen_threshold = threshold_ * (1.0f - hysteresis_);
+    stats_ = LodStats();
+    stats_.instances = static_cast<uint32_t>(count);
+    for (i = 0; i < count; ++i) {
+        const Mesh *mesh = list->meshes[i];
+        const Vector<MeshLod> &lods = mesh->lods();
+        if (lods.empty()) {
+            list->levels[i] = 0;
+            continue;
+        }
+
+        // Instances scaled up from the mesh's own bounds magnify its errors
+        float pixels = ppu[i];
+        if (mesh->boundsRadius() > 0.0f && list->radius[i] > 0.0f)
+            pixels *= list->radius[i] / mesh->boundsRadius();
+
+        size_t level = list->levels[i];
+        if (level >= lods.size())
+            level = lods.size() - 1;
+        while (level > 0 && lods[level].error * pixels > threshold_)
+            --level;
+        while (level + 1 < lods.size() && lods[level + 1].error * pixels <= coarsen_threshold)
+            ++level;
+
+        list->levels[i] = static_cast<uint8_t>(level);
+        stats_.fullDetailTriangles += lods[0].indexCount / 3;
+        stats_.selectedTriangles += lods[level].indexCount / 3;
+    }
+}
+}
@@ -0,0 +1,294 @@
+/***************************************************
+* Material.cc: Materials & shader permutations    *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Material.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+#include "GLES2/gl2.h"
+
+#include "config.h"
+#include "types.h"
+
+namespace lys3d {
+namespace {
+const char* kFeatureDefines[4] = {
+    "#define MATERIAL_NORMAL_MAP 1\n",
+    "#define MATERIAL_EMISSIVE 1\n",
+    "#define MATERIAL_SKINNING 1\n",
+    "#define MATERIAL_FOG 1\n",
+};
+
+const char* kSlotNames[kMaterialParamCount] = {
+    "MATERIAL_BASE_COLOR",
+    "MATERIAL_SURFACE",
+    "MATERIAL_EMISSIVE_COLOR",
+    "MATERIAL_FOG_COLOR",
+};
+
+const float kDefaults[kMaterialParamCount][4] = {
+    {1.0f, 1.0f, 1.0f, 1.0f},
+    {0.5f, 0.0f, 1.0f, 0.0f},
+    {0.0f, 0.0f, 0.0f, 0.0f},
+    {0.5f, 0.5f, 0.5f, 0.0f},
+};
+
+std::atomic<uint32_t> nextShaderIndex(0);
+std::atomic<uint32_t> nextMaterialId(0);
+
+// Shared by every material, so no two blocks ever get the same stamp
+std::atomic<uint64_t> nextStamp(1);
+
+// Bumped whenever programs are built or deleted, so binders know their
+// current program may be gone
+std::atomic<uint32_t> programGeneration(0);
+}
+
+
+LYS_API uint32_t materialUploadRange(uint64_t stamp, uint64_t resident_stamp, const float *block,
+                                     const float *resident, uint32_t slots, uint32_t *first) {
+    *first = 0;
+    if (resident_stamp == 0)
+        return slots;
+    if (stamp == resident_stamp)
+        return 0;
+
+    int32_t low = -1, high = -1;
+    for (uint32_t slot = 0; slot < slots; ++slot) {
+        if (memcmp(&block[slot * 4], &resident[slot * 4], sizeof(float) * 4) == 0)
+            continue;
+        if (low < 0)
+            low = static_cast<int32_t>(slot);
+        high = static_cast<int32_t>(slot);
+    }
+    if (low < 0)
+        return 0;
+    *first = static_cast<uint32_t>(low);
+    return static_cast<uint32_t>(high - low + 1);
+}
+
+
+struct MaterialShader::Impl {
+    // A program and the uniform block it currently holds
+    struct Permutation {
+        ShaderProgram program;
+        int32_t locations[kMaterialMaxSlots];
+        uint32_t activeSlots;
+        uint64_t stamp;
+        float resident[kMaterialMaxSlots * 4];
+    };
+
+    uint32_t index;
+    uint32_t built;
+    String log;
+    Permutation permutations[kMaterialPermutationCount];
+};
+
+
+LYS_API MaterialShader::MaterialShader() {
+    pimpl_ = new Impl();
+    pimpl_->index = nextShaderIndex++ & 0xFF;
+    pimpl_->built = 0;
+}
+
+
+LYS_API MaterialShader::~MaterialShader() {
+    delete pimpl_;
+}
+
+
+LYS_API String MaterialShader::defines(uint32_t features) {
+    String text;
+    for (uint32_t i = 0; i < 4; ++i) {
+        if (features & (1u << i))
+            text += kFeatureDefines[i];
+    }
+    char line[64];
+    snprintf(line, sizeof(line), "#define MATERIAL_SLOTS %u\n", materialSlotCount(features));
+    text += line;
+    for (uint32_t param = 0; param < kMaterialParamCount; ++param) {
+        int32_t slot = materialSlot(features, static_cast<MaterialParam>(param));
+        if (slot < 0)
+            continue;
+        snprintf(line, sizeof(line), "#define %s %d\n", kSlotNames[param], slot);
+        text += line;
+    }
+    return text;
+}
+
+
+LYS_API bool MaterialShader::build(const String &vertex_source, const String &fragment_source,
+                                   const Vector<uint32_t> &feature_sets) {
+    destroy();
+    ++programGeneration;
+    Vector<uint32_t> all;
+    const Vector<uint32_t> *sets = &feature_sets;
+    if (feature_sets.empty()) {
+        for (uint32_t features = 0; features < kMaterialPermutationCount; ++features)
+            all.push_back(features);
+        sets = &all;
+    }
+
+    bool ok = true;
+    for (uint32_t features : *sets) {
+        if (features >= kMaterialPermutationCount) {
+            ok = false;
+            continue;
+        }
+        Impl::Permutation &permutation = pimpl_->permutations[features];
+        String defines = MaterialShader::defines(features);
+        if (!permutation.program.build(vertex_source, fragment_source, defines)) {
+            pimpl_->log += defines;
+            pimpl_->log += permutation.program.log();
+            ok = false;
+            continue;
+        }
+
+        // Elements past the last one the shader reads aren't active, and a
+        // range starting at one of them would upload nothing
+        permutation.activeSlots = 0;
+        for (uint32_t slot = 0; slot < materialSlotCount(features); ++slot) {
+            char name[32];
+            snprintf(name, sizeof(name), "u_material[%u]", slot);
+            permutation.locations[slot] = permutation.program.uniformLocation(name);
+            if (permutation.locations[slot] >= 0)
+                permutation.activeSlots = slot + 1;
+        }
+        permutation.stamp = 0;
+        ++pimpl_->built;
+    }
+    return ok;
+}
+
+
+LYS_API void MaterialShader::destroy() {
+    for (Impl::Permutation &permutation : pimpl_->permutations)
+        permutation.program.destroy();
+    ++programGeneration;
+    pimpl_->built = 0;
+    pimpl_->log.clear();
+}
+
+
+LYS_API const ShaderProgram* MaterialShader::program(uint32_t features) const {
+    if (features >= kMaterialPermutationCount || !pimpl_->permutations[features].program.isBuilt())
+        return nullptr;
+    return &pimpl_->permutations[features].program;
+}
+
+
+LYS_API uint32_t MaterialShader::programCount() const {
+    return pimpl_->built;
+}
+
+
+LYS_API const String& MaterialShader::log() const {
+    return pimpl_->log;
+}
+
+
+LYS_API uint32_t MaterialShader::index() const {
+    return pimpl_->index;
+}
+
+
+LYS_API Material::Material(const MaterialShader *shader, uint32_t features) {
+    shader_ = shader;
+    features_ = features & (kMaterialPermutationCount - 1);
+    id_ = nextMaterialId++ & 0xFFFFF;
+    sortKey_ = ((shader != nullptr ? shader->index() : 0) << 24) | (features_ << 20) | id_;
+    stamp_ = nextStamp++;
+    memset(block_, 0, sizeof(block_));
+    for (uint32_t param = 0; param < kMaterialParamCount; ++param) {
+        int32_t slot = materialSlot(features_, static_cast<MaterialParam>(param));
+        if (slot >= 0)
+            memcpy(&block_[slot * 4], kDefaults[param], sizeof(kDefaults[param]));
+    }
+}
+
+
+LYS_API bool Material::set(MaterialParam param, float x, float y, float z, float w) {
+    int32_t slot = materialSlot(features_, param);
+    if (slot < 0)
+        return false;
+    setSlot(static_cast<uint32_t>(slot), x, y, z, w);
+    return true;
+}
+
+
+LYS_API bool Material::get(MaterialParam param, float values[4]) const {
+    int32_t slot = materialSlot(features_, param);
+    if (slot < 0)
+        return false;
+    memcpy(values, &block_[slot * 4], sizeof(float) * 4);
+    return true;
+}
+
+
+LYS_API void Material::setSlot(uint32_t slot, float x, float y, float z, float w) {
+    float *values = &block_[slot * 4];
+    values[0] = x;
+    values[1] = y;
+    values[2] = z;
+    values[3] = w;
+    stamp_ = nextStamp++;
+}
+
+
+LYS_API MaterialBinder::MaterialBinder() {
+    current_ = 0;
+    generation_ = programGeneration;
+}
+
+
+LYS_API bool MaterialBinder::bind(const Material &material) {
+    if (material.shader() == nullptr)
+        return false;
+    MaterialShader::Impl::Permutation &permutation = material.shader()->pimpl_->permutations[material.features()];
+    if (!permutation.program.isBuilt())
+        return false;
+    ++stats_.binds;
+
+    if (generation_ != programGeneration) {
+        current_ = 0;
+        generation_ = programGeneration;
+    }
+    if (permutation.program.program() != current_) {
+        permutation.program.use();
+        current_ = permutation.program.program();
+        ++stats_.programChanges;
+    }
+
+    const float *block = material.block();
+    uint32_t first;
+    uint32_t count = materialUploadRange(material.stamp(), permutation.stamp, block, permutation.resident,
+                                         permutation.activeSlots, &first);
+    if (count > 0) {
+        glUniform4fv(permutation.locations[first], static_cast<GLsizei>(count), &block[first * 4]);
+        memcpy(&permutation.resident[first * 4], &block[first * 4], sizeof(float) * 4 * count);
+        ++stats_.uniformCalls;
+        stats_.uploadedSlots += count;
+    }
+    permutation.stamp = material.stamp();
+    return true;
+}
+
+
+LYS_API void MaterialBinder::reset() {
+    current_ = 0;
+}
+
+
+LYS_API void MaterialBinder::resetStats() {
+    stats_ = MaterialBindStats();
+}
+}
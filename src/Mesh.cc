@@ -0,0 +1,192 @@
+/***************************************************
+* Mesh.cc: Indexed triangle mesh with LOD chain    *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Mesh.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <physfs.h>
+
+#include "config.h"
+#include "types.h"
+
+namespace lys3d {
+namespace {
+const uint32_t kMeshMagic = 0x4D53594C; // "LYSM"
+const uint32_t kMeshVersion = 1;
+
+struct MeshHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t lodCount;
+    float bounds[4];
+};
+
+size_t paddedIndexBytes(size_t count) {
+    return (count * sizeof(uint16_t) + 3) & ~static_cast<size_t>(3);
+}
+}
+
+
+LYS_API void Mesh::resetLods() {
+    lods_.clear();
+    MeshLod lod;
+    lod.indexOffset = 0;
+    lod.indexCount = static_cast<uint32_t>(indices_.size());
+    lod.error = 0.0f;
+    lods_.push_back(lod);
+}
+
+
+LYS_API uint32_t Mesh::triangleCount(size_t lod) const {
+    if (lod >= lods_.size())
+        return 0;
+    return lods_[lod].indexCount / 3;
+}
+
+
+LYS_API void Mesh::computeBounds() {
+    if (vertices_.empty()) {
+        boundsCenter_ = Point3Df();
+        boundsRadius_ = 0.0f;
+        return;
+    }
+
+    // Center of the AABB is good enough for LOD and culling purposes
+    Point3Df lo(vertices_[0].position[0], vertices_[0].position[1], vertices_[0].position[2]);
+    Point3Df hi = lo;
+    for (const MeshVertex &v : vertices_) {
+        lo = Point3Df(fminf(lo.x(), v.position[0]), fminf(lo.y(), v.position[1]),
+                      fminf(lo.z(), v.position[2]));
+        hi = Point3Df(fmaxf(hi.x(), v.position[0]), fmaxf(hi.y(), v.position[1]),
+                      fmaxf(hi.z(), v.position[2]));
+    }
+    boundsCenter_ = (lo + hi) * 0.5f;
+
+    float radius_sq = 0.0f;
+    for (const MeshVertex &v : vertices_) {
+        Point3Df p(v.position[0], v.position[1], v.position[2]);
+        radius_sq = fmaxf(radius_sq, (p - boundsCenter_).lengthSquared());
+    }
+    boundsRadius_ = sqrtf(radius_sq);
+}
+
+
+LYS_API bool Mesh::load(const String &path) {
+    clear();
+    PHYSFS_File *file = PHYSFS_openRead(path.c_str());
+    if (file == nullptr)
+        return false;
+
+    PHYSFS_sint64 length = PHYSFS_fileLength(file);
+    if (length <= 0) {
+        PHYSFS_close(file);
+        return false;
+    }
+
+    Vector<uint8_t> data(static_cast<size_t>(length));
+    PHYSFS_sint64 read = PHYSFS_readBytes(file, data.data(), data.size());
+    PHYSFS_close(file);
+    if (read != length)
+        return false;
+
+    return loadFromMemory(data.data(), data.size());
+}
+
+
+LYS_API bool Mesh::loadFromMemory(const void *data, size_t size) {
+    clear();
+    if (data == nullptr || size < sizeof(MeshHeader))
+        return false;
+
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    MeshHeader header;
+    memcpy(&header, bytes, sizeof(header));
+    if (header.magic != kMeshMagic || header.version != kMeshVersion)
+        return false;
+
+    size_t lod_bytes = header.lodCount * sizeof(MeshLod);
+    size_t vertex_bytes = header.vertexCount * sizeof(MeshVertex);
+    size_t index_bytes = paddedIndexBytes(header.indexCount);
+    if (header.vertexCount > 65536 || size < sizeof(header) + lod_bytes + vertex_bytes + index_bytes)
+        return false;
+
+    bytes += sizeof(header);
+    lods_.resize(header.lodCount);
+    memcpy(lods_.data(), bytes, lod_bytes);
+    bytes += lod_bytes;
+    vertices_.resize(header.vertexCount);
+    memcpy(vertices_.data(), bytes, vertex_bytes);
+    bytes += vertex_bytes;
+    indices_.resize(header.indexCount);
+    memcpy(indices_.data(), bytes, header.indexCount * sizeof(uint16_t));
+
+    // Reject anything that would make us read out of bounds later
+    for (const MeshLod &lod : lods_) {
+        if (lod.indexCount % 3 != 0 || lod.indexOffset > header.indexCount
+            || lod.indexCount > header.indexCount - lod.indexOffset) {
+            clear();
+            return false;
+        }
+    }
+    for (uint16_t index : indices_) {
+        if (index >= header.vertexCount) {
+            clear();
+            return false;
+        }
+    }
+
+    if (lods_.empty())
+        resetLods();
+    boundsCenter_ = Point3Df(header.bounds[0], header.bounds[1], header.bounds[2]);
+    boundsRadius_ = header.bounds[3];
+    return true;
+}
+
+
+LYS_API void Mesh::saveToMemory(Vector<uint8_t> *out) const {
+    MeshHeader header;
+    header.magic = kMeshMagic;
+    header.version = kMeshVersion;
+    header.vertexCount = static_cast<uint32_t>(vertices_.size());
+    header.indexCount = static_cast<uint32_t>(indices_.size());
+    header.lodCount = static_cast<uint32_t>(lods_.size());
+    header.bounds[0] = boundsCenter_.x();
+    header.bounds[1] = boundsCenter_.y();
+    header.bounds[2] = boundsCenter_.z();
+    header.bounds[3] = boundsRadius_;
+
+    size_t lod_bytes = lods_.size() * sizeof(MeshLod);
+    size_t vertex_bytes = vertices_.size() * sizeof(MeshVertex);
+    size_t index_bytes = paddedIndexBytes(indices_.size());
+    out->assign(sizeof(header) + lod_bytes + vertex_bytes + index_bytes, 0);
+
+    uint8_t *bytes = out->data();
+    memcpy(bytes, &header, sizeof(header));
+    bytes += sizeof(header);
+    memcpy(bytes, lods_.data(), lod_bytes);
+    bytes += lod_bytes;
+    memcpy(bytes, vertices_.data(), vertex_bytes);
+    bytes += vertex_bytes;
+    memcpy(bytes, indices_.data(), indices_.size() * sizeof(uint16_t));
+}
+
+
+LYS_API void Mesh::clear() {
+    vertices_.clear();
+    indices_.clear();
+    lods_.clear();
+    boundsCenter_ = Point3Df();
+    boundsRadius_ = 0.0f;
+}
+}
@@ -0,0 +1,359 @@
+/***************************************************
+* MeshOptimizer.cc: Index & vertex order tuning    *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "MeshOptimizer.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "config.h"
+#include "types.h"
+
+namespace lys3d {
+namespace {
+// Forsyth's tuning constants, from "Linear-Speed Vertex Cache Optimisation"
+const float kCacheDecayPower = 1.5f;
+const float kLastTriangleScore = 0.75f;
+const float kValenceBoostScale = 2.0f;
+const float kValenceBoostPower = 0.5f;
+const uint32_t kMaxCacheSize = 32;
+
+// Overdraw clusters smaller than this aren't worth sorting
+const uint32_t kMinClusterTriangles = 32;
+
+struct Vertex {
+    int32_t cachePosition;
+    float score;
+    uint32_t adjacencyOffset;
+    uint32_t liveTriangles;
+};
+
+float vertexScore(const Vertex &v, uint32_t cache_size) {
+    if (v.liveTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (v.cachePosition >= 0) {
+        if (v.cachePosition < 3) {
+            // The last triangle's vertices are penalized a bit, or the
+            // optimizer would happily emit long thin fans.
+            score = kLastTriangleScore;
+        } else {
+            float scaler = 1.0f / (cache_size - 3);
+            score = powf(1.0f - (v.cachePosition - 3) * scaler, kCacheDecayPower);
+        }
+    }
+    // Finish off vertices with few triangles left, so they leave the cache
+    return score + kValenceBoostScale * powf(static_cast<float>(v.liveTriangles), -kValenceBoostPower);
+}
+
+struct Cluster {
+    size_t first;
+    size_t count;
+    float sortKey;
+};
+}
+
+
+LYS_API void MeshOptimizer::optimize(Mesh *mesh) const {
+    if (mesh->lods().empty())
+        mesh->resetLods();
+
+    const Vector<MeshLod> &lods = mesh->lods();
+    for (size_t level = 0; level < lods.size(); ++level) {
+        // Reordering a range another level shares would move triangles out
+        // from under that level, so shared ranges keep their first order
+        const MeshLod &lod = lods[level];
+        bool shared = false;
+        for (size_t other = 0; other < level && !shared; ++other) {
+            shared = lod.indexOffset < lods[other].indexOffset + lods[other].indexCount
+                  && lods[other].indexOffset < lod.indexOffset + lod.indexCount;
+        }
+        if (shared)
+            continue;
+        uint16_t *indices = mesh->indices().data() + lod.indexOffset;
+        optimizeVertexCache(indices, lod.indexCount, mesh->vertices().size());
+        if (overdraw_)
+            optimizeOverdraw(indices, lod.indexCount, mesh->vertices());
+    }
+    optimizeVertexFetch(mesh);
+}
+
+
+LYS_API void MeshOptimizer::optimizeVertexCache(uint16_t *indices, size_t count, size_t vertex_count) const {
+    size_t triangle_count = count / 3;
+    if (triangle_count == 0)
+        return;
+
+    // Triangle adjacency per vertex, packed back-to-back. Each vertex's live
+    // triangles are kept at the front of its range.
+    Vector<Vertex> vertices(vertex_count);
+    for (Vertex &v : vertices) {
+        v.cachePosition = -1;
+        v.liveTriangles = 0;
+    }
+    for (size_t i = 0; i < triangle_count * 3; ++i)
+        ++vertices[indices[i]].liveTriangles;
+    uint32_t offset = 0;
+    for (Vertex &v : vertices) {
+        v.adjacencyOffset = offset;
+        offset += v.liveTriangles;
+        v.liveTriangles = 0;
+    }
+    Vector<uint32_t> adjacency(offset);
+    for (size_t t = 0; t < triangle_count; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            Vertex &v = vertices[indices[t * 3 + k]];
+            adjacency[v.adjacencyOffset + v.liveTriangles++] = static_cast<uint32_t>(t);
+        }
+    }
+    for (Vertex &v : vertices)
+        v.score = vertexScore(v, cacheSize_);
+
+    Vector<float> triangle_scores(triangle_count);
+    Vector<bool> emitted(triangle_count, false);
+    int64_t best = -1;
+    float best_score = -1.0f;
+    for (size_t t = 0; t < triangle_count; ++t) {
+        triangle_scores[t] = vertices[indices[t * 3]].score + vertices[indices[t * 3 + 1]].score
+                           + vertices[indices[t * 3 + 2]].score;
+        if (triangle_scores[t] > best_score) {
+            best_score = triangle_scores[t];
+            best = static_cast<int64_t>(t);
+        }
+    }
+
+    Vector<uint16_t> output;
+    output.reserve(triangle_count * 3);
+    uint32_t cache[kMaxCacheSize + 3];
+    uint32_t cache_entries = 0;
+    size_t cursor = 0;
+
+    while (output.size() < triangle_count * 3) {
+        if (best < 0) {
+            // Nothing in the cache has triangles left; take the next one in
+            // the original order.
+            while (emitted[cursor])
+                ++cursor;
+            best = static_cast<int64_t>(cursor);
+        }
+
+        size_t t = static_cast<size_t>(best);
+        emitted[t] = true;
+        uint32_t tri[3] = {indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]};
+        for (uint32_t id : tri) {
+            output.push_back(static_cast<uint16_t>(id));
+            // Move this triangle out of the live part of the vertex's range
+            Vertex &v = vertices[id];
+            uint32_t *adj = adjacency.data() + v.adjacencyOffset;
+            for (uint32_t i = 0; i < v.liveTriangles; ++i) {
+                if (adj[i] == t) {
+                    adj[i] = adj[v.liveTriangles - 1];
+                    adj[v.liveTriangles - 1] = static_cast<uint32_t>(t);
+                    --v.liveTriangles;
+                    break;
+                }
+            }
+        }
+
+        // LRU update: the new triangle goes to the front
+        uint32_t new_cache[kMaxCacheSize + 3];
+        uint32_t new_entries = 0;
+        for (uint32_t id : tri)
+            new_cache[new_entries++] = id;
+        for (uint32_t i = 0; i < cache_entries; ++i) {
+            uint32_t id = cache[i];
+            if (id != tri[0] && id != tri[1] && id != tri[2])
+                new_cache[new_entries++] = id;
+        }
+
+        // Rescore everything in (or just pushed out of) the cache, and look
+        // for the best triangle among their neighbours. Entries past
+        // cacheSize_ fell out, and lose their cache bonus.
+        best = -1;
+        best_score = -1.0f;
+        for (uint32_t i = 0; i < new_entries; ++i) {
+            uint32_t id = new_cache[i];
+            Vertex &v = vertices[id];
+            v.cachePosition = (i < cacheSize_) ? static_cast<int32_t>(i) : -1;
+            float score = vertexScore(v, cacheSize_);
+            float delta = score - v.score;
+            v.score = score;
+            const uint32_t *adj = adjacency.data() + v.adjacencyOffset;
+            for (uint32_t j = 0; j < v.liveTriangles; ++j) {
+                uint32_t neighbour = adj[j];
+                triangle_scores[neighbour] += delta;
+                if (triangle_scores[neighbour] > best_score) {
+                    best_score = triangle_scores[neighbour];
+                    best = neighbour;
+                }
+            }
+        }
+        cache_entries = new_entries < cacheSize_ ? new_entries : cacheSize_;
+        memcpy(cache, new_cache, cache_entries * sizeof(uint32_t));
+    }
+
+    memcpy(indices, output.data(), output.size() * sizeof(uint16_t));
+}
+
+
+LYS_API void MeshOptimizer::optimizeOverdraw(uint16_t *indices, size_t count,
+                                             const Vector<MeshVertex> &vertices) const {
+    size_t triangle_count = count / 3;
+    if (triangle_count <= kMinClusterTriangles)
+        return;
+
+    // Per-triangle misses in the current (cache-optimized) order
+    Vector<uint32_t> timestamps(vertices.size(), 0);
+    Vector<uint8_t> misses(triangle_count, 0);
+    uint32_t time = cacheSize_ + 1;
+    for (size_t t = 0; t < triangle_count; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            uint16_t id = indices[t * 3 + k];
+            if (time - timestamps[id] > cacheSize_) {
+                timestamps[id] = time++;
+                ++misses[t];
+            }
+        }
+    }
+    float target_acmr = static_cast<float>(time - cacheSize_ - 1) / triangle_count * overdrawThreshold_;
+
+    // Cut where the cache would restart anyway (all 3 vertices missed), or
+    // where the cluster so far is about as cache-efficient as the whole mesh.
+    Vector<Cluster> clusters;
+    Cluster current = {0, 0, 0.0f};
+    uint32_t cluster_misses = 0;
+    for (size_t t = 0; t < triangle_count; ++t) {
+        bool cut = false;
+        if (current.count >= kMinClusterTriangles) {
+            float acmr = static_cast<float>(cluster_misses) / current.count;
+            cut = (misses[t] == 3) || (acmr <= target_acmr);
+        }
+        if (cut) {
+            clusters.push_back(current);
+            current.first = t;
+            current.count = 0;
+            cluster_misses = 0;
+        }
+        ++current.count;
+        cluster_misses += misses[t];
+    }
+    clusters.push_back(current);
+    if (clusters.size() < 2)
+        return;
+
+    // Sort key: how far the cluster sits out along its own facing direction,
+    // relative to the mesh centroid. Outward-facing clusters on the hull come
+    // first, so they tend to occlude what's drawn after them.
+    double mesh_centroid[3] = {0.0, 0.0, 0.0};
+    double mesh_area = 0.0;
+    Vector<float> cluster_data(clusters.size() * 7, 0.0f); // centroid, normal, area
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        float *data = &cluster_data[c * 7];
+        for (size_t t = clusters[c].first; t < clusters[c].first + clusters[c].count; ++t) {
+            const float *p0 = vertices[indices[t * 3]].position;
+            const float *p1 = vertices[indices[t * 3 + 1]].position;
+            const float *p2 = vertices[indices[t * 3 + 2]].position;
+            float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2],
+                          e1[0] * e2[1] - e1[1] * e2[0]};
+            float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; ++k) {
+                float center = (p0[k] + p1[k] + p2[k]) / 3.0f;
+                data[k] += center * area;
+                data[3 + k] += n[k];
+                mesh_centroid[k] += center * area;
+            }
+            data[6] += area;
+            mesh_area += area;
+        }
+    }
+    for (int k = 0; k < 3; ++k)
+        mesh_centroid[k] = mesh_area > 0.0 ? mesh_centroid[k] / mesh_area : 0.0;
+
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        const float *data = &cluster_data[c * 7];
+        float length = sqrtf(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+        float key = 0.0f;
+        if (data[6] > 0.0f && length > 0.0f) {
+            for (int k = 0; k < 3; ++k)
+                key += (data[k] / data[6] - static_cast<float>(mesh_centroid[k])) * data[3 + k] / length;
+        }
+        clusters[c].sortKey = key;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    Vector<uint16_t> sorted;
+    sorted.reserve(triangle_count * 3);
+    for (const Cluster &cluster : clusters)
+        sorted.insert(sorted.end(), indices + cluster.first * 3,
+                      indices + (cluster.first + cluster.count) * 3);
+    memcpy(indices, sorted.data(), sorted.size() * sizeof(uint16_t));
+}
+
+
+LYS_API void MeshOptimizer::optimizeVertexFetch(Mesh *mesh) const {
+    Vector<MeshVertex> &vertices = mesh->vertices();
+    Vector<int32_t> remap(vertices.size(), -1);
+    Vector<MeshVertex> reordered;
+    reordered.reserve(vertices.size());
+
+    // Walk the levels in order so each level's vertices stay mostly together.
+    // Levels may share index ranges, so each index is renumbered only the
+    // first time a level covers it.
+    Vector<bool> renumbered(mesh->indices().size(), false);
+    for (const MeshLod &lod : mesh->lods()) {
+        for (uint32_t i = 0; i < lod.indexCount; ++i) {
+            if (renumbered[lod.indexOffset + i])
+                continue;
+            renumbered[lod.indexOffset + i] = true;
+            uint16_t &index = mesh->indices()[lod.indexOffset + i];
+            if (remap[index] < 0) {
+                remap[index] = static_cast<int32_t>(reordered.size());
+                reordered.push_back(vertices[index]);
+            }
+            index = static_cast<uint16_t>(remap[index]);
+        }
+    }
+    vertices.swap(reordered);
+}
+
+
+LYS_API VertexCacheStats MeshOptimizer::analyze(const uint16_t *indices, size_t count,
+                                                size_t vertex_count) const {
+    VertexCacheStats stats;
+    Vector<uint32_t> timestamps(vertex_count, 0);
+    Vector<bool> seen(vertex_count, false);
+    uint32_t time = cacheSize_ + 1;
+
+    // FIFO: a vertex is still cached if fewer than cacheSize misses happened
+    // since it was last loaded.
+    for (size_t i = 0; i < (count / 3) * 3; ++i) {
+        uint16_t id = indices[i];
+        if (time - timestamps[id] > cacheSize_) {
+            timestamps[id] = time++;
+            ++stats.misses;
+        }
+        if (!seen[id]) {
+            seen[id] = true;
+            ++stats.vertices;
+        }
+    }
+
+    stats.triangles = static_cast<uint32_t>(count / 3);
+    stats.acmr = stats.triangles ? static_cast<float>(stats.misses) / stats.triangles : 0.0f;
+    stats.atvr = stats.vertices ? static_cast<float>(stats.misses) / stats.vertices : 0.0f;
+    return stats;
+}
+}
@@ -0,0 +1,300 @@
+/***************************************************
+* MeshSimplifier.cc: LOD chain generation          *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "MeshSimplifier.h"
+
+#include <math.h>
+#include <algorithm>
+#include <unordered_map>
+
+#include "config.h"
+#include "types.h"
+
+namespace lys3d {
+namespace {
+// Finest grid tried, as a fraction of the mesh's largest extent
+const uint32_t kFinestGrid = 256;
+
+// Symmetric 4x4 plane quadric, stored as its upper triangle
+struct Quadric {
+    double a[10];
+
+    void clear() {
+        for (double &v : a)
+            v = 0.0;
+    }
+
+    void addPlane(double nx, double ny, double nz, double d, double weight) {
+        a[0] += weight * nx * nx; a[1] += weight * nx * ny; a[2] += weight * nx * nz;
+        a[3] += weight * nx * d;  a[4] += weight * ny * ny; a[5] += weight * ny * nz;
+        a[6] += weight * ny * d;  a[7] += weight * nz * nz; a[8] += weight * nz * d;
+        a[9] += weight * d * d;
+    }
+
+    // Solve for the point of minimum error; false if the system is singular
+    // (e.g. all planes in the cell are parallel).
+    bool minimize(double *x, double *y, double *z) const {
+        double m00 = a[0], m01 = a[1], m02 = a[2];
+        double m11 = a[4], m12 = a[5], m22 = a[7];
+        double b0 = -a[3], b1 = -a[6], b2 = -a[8];
+        double c00 = m11 * m22 - m12 * m12;
+        double c01 = m02 * m12 - m01 * m22;
+        double c02 = m01 * m12 - m02 * m11;
+        double det = m00 * c00 + m01 * c01 + m02 * c02;
+        double scale = fabs(m00) + fabs(m11) + fabs(m22);
+        if (fabs(det) <= 1e-9 * scale * scale * scale)
+            return false;
+        double c11 = m00 * m22 - m02 * m02;
+        double c12 = m01 * m02 - m00 * m12;
+        double c22 = m00 * m11 - m01 * m01;
+        *x = (c00 * b0 + c01 * b1 + c02 * b2) / det;
+        *y = (c01 * b0 + c11 * b1 + c12 * b2) / det;
+        *z = (c02 * b0 + c12 * b1 + c22 * b2) / det;
+        return true;
+    }
+};
+
+struct Cluster {
+    Quadric quadric;
+    double position[3];
+    float normal[3];
+    float uv[2];
+    uint32_t count;
+    int32_t cell[3];
+};
+
+struct Triangle {
+    uint32_t v[3];
+
+    // Rotate so the smallest index comes first, keeping the winding
+    void canonicalize() {
+        while (v[0] > v[1] || v[0] > v[2]) {
+            uint32_t t = v[0];
+            v[0] = v[1];
+            v[1] = v[2];
+            v[2] = t;
+        }
+    }
+
+    bool operator<(const Triangle &o) const {
+        return v[0] != o.v[0] ? v[0] < o.v[0] : (v[1] != o.v[1] ? v[1] < o.v[1] : v[2] < o.v[2]);
+    }
+
+    bool operator==(const Triangle &o) const {
+        return v[0] == o.v[0] && v[1] == o.v[1] && v[2] == o.v[2];
+    }
+};
+
+struct Level {
+    Vector<MeshVertex> vertices;
+    Vector<uint16_t> indices;
+    float error;
+};
+
+// Cluster the base level onto a grid with the given cell size.
+void clusterLevel(const Vector<MeshVertex> &vertices, const Vector<uint16_t> &indices,
+                  const float *origin, float cell_size, Level *level) {
+    std::unordered_map<uint64_t, uint32_t> cell_map;
+    Vector<Cluster> clusters;
+    Vector<uint32_t> remap(vertices.size());
+    float inv_cell = 1.0f / cell_size;
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const MeshVertex &v = vertices[i];
+        int32_t cell[3];
+        for (int k = 0; k < 3; ++k)
+            cell[k] = static_cast<int32_t>(floorf((v.position[k] - origin[k]) * inv_cell));
+        uint64_t key = (static_cast<uint64_t>(cell[0] & 0x1FFFFF) << 42)
+                     | (static_cast<uint64_t>(cell[1] & 0x1FFFFF) << 21)
+                     | static_cast<uint64_t>(cell[2] & 0x1FFFFF);
+
+        auto found = cell_map.find(key);
+        uint32_t id;
+        if (found == cell_map.end()) {
+            id = static_cast<uint32_t>(clusters.size());
+            cell_map[key] = id;
+            Cluster cluster;
+            cluster.quadric.clear();
+            for (int k = 0; k < 3; ++k) {
+                cluster.position[k] = 0.0;
+                cluster.normal[k] = 0.0f;
+                cluster.cell[k] = cell[k];
+            }
+            cluster.uv[0] = cluster.uv[1] = 0.0f;
+            cluster.count = 0;
+            clusters.push_back(cluster);
+        } else {
+            id = found->second;
+        }
+        remap[i] = id;
+
+        Cluster &cluster = clusters[id];
+        for (int k = 0; k < 3; ++k) {
+            cluster.position[k] += v.position[k];
+            cluster.normal[k] += v.normal[k];
+        }
+        cluster.uv[0] += v.uv[0];
+        cluster.uv[1] += v.uv[1];
+        ++cluster.count;
+    }
+
+    // Accumulate each triangle's plane into the clusters of its corners, and
+    // keep the triangles that don't collapse.
+    Vector<Triangle> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const float *p0 = vertices[indices[i]].position;
+        const float *p1 = vertices[indices[i + 1]].position;
+        const float *p2 = vertices[indices[i + 2]].position;
+        double e1[3], e2[3], n[3];
+        for (int k = 0; k < 3; ++k) {
+            e1[k] = p1[k] - p0[k];
+            e2[k] = p2[k] - p0[k];
+        }
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        double area2 = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        Triangle tri;
+        for (int k = 0; k < 3; ++k)
+            tri.v[k] = remap[indices[i + k]];
+
+        if (area2 > 0.0) {
+            for (int k = 0; k < 3; ++k)
+                n[k] /= area2;
+            double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+            for (int k = 0; k < 3; ++k)
+                clusters[tri.v[k]].quadric.addPlane(n[0], n[1], n[2], d, area2 * 0.5);
+        }
+
+        if (tri.v[0] != tri.v[1] && tri.v[1] != tri.v[2] && tri.v[0] != tri.v[2]) {
+            tri.canonicalize();
+            triangles.push_back(tri);
+        }
+    }
+    std::sort(triangles.begin(), triangles.end());
+    triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+    // Place each cluster's vertex, compacting away clusters no triangle uses
+    Vector<int32_t> used(clusters.size(), -1);
+    level->vertices.clear();
+    level->indices.clear();
+    for (const Triangle &tri : triangles) {
+        for (uint32_t id : tri.v) {
+            if (used[id] < 0) {
+                const Cluster &c = clusters[id];
+                double avg[3] = {c.position[0] / c.count, c.position[1] / c.count,
+                                 c.position[2] / c.count};
+                double pos[3];
+                bool inside = c.quadric.minimize(&pos[0], &pos[1], &pos[2]);
+                // Keep the optimum within (a little around) its cell, or it
+                // can shoot off to infinity on nearly-flat regions.
+                for (int k = 0; inside && k < 3; ++k) {
+                    double lo = origin[k] + (c.cell[k] - 0.5) * cell_size;
+                    double hi = origin[k] + (c.cell[k] + 1.5) * cell_size;
+                    inside = (pos[k] >= lo && pos[k] <= hi);
+                }
+
+                MeshVertex out;
+                float length = sqrtf(c.normal[0] * c.normal[0] + c.normal[1] * c.normal[1]
+                                     + c.normal[2] * c.normal[2]);
+                for (int k = 0; k < 3; ++k) {
+                    out.position[k] = static_cast<float>(inside ? pos[k] : avg[k]);
+                    out.normal[k] = length > 0.0f ? c.normal[k] / length : 0.0f;
+                }
+                out.uv[0] = c.uv[0] / c.count;
+                out.uv[1] = c.uv[1] / c.count;
+                used[id] = static_cast<int32_t>(level->vertices.size());
+                level->vertices.push_back(out);
+            }
+            level->indices.push_back(static_cast<uint16_t>(used[id]));
+        }
+    }
+
+    // Geometric error: the furthest any original vertex ended up moving
+    float error_sq = 0.0f;
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        if (used[remap[i]] < 0)
+            continue;
+        const MeshVertex &rep = level->vertices[used[remap[i]]];
+        float dx = rep.position[0] - vertices[i].position[0];
+        float dy = rep.position[1] - vertices[i].position[1];
+        float dz = rep.position[2] - vertices[i].position[2];
+        error_sq = fmaxf(error_sq, dx * dx + dy * dy + dz * dz);
+    }
+    level->error = sqrtf(error_sq);
+}
+}
+
+
+LYS_API uint32_t MeshSimplifier::generate(Mesh *mesh) const {
+    if (mesh->lods().empty())
+        mesh->resetLods();
+    const MeshLod base_lod = mesh->lods()[0];
+
+    // Compact level 0 so old chain data doesn't leak into the new one
+    Vector<MeshVertex> vertices;
+    Vector<uint16_t> indices;
+    Vector<int32_t> remap(mesh->vertices().size(), -1);
+    for (uint32_t i = 0; i < base_lod.indexCount; ++i) {
+        uint16_t index = mesh->indices()[base_lod.indexOffset + i];
+        if (remap[index] < 0) {
+            remap[index] = static_cast<int32_t>(vertices.size());
+            vertices.push_back(mesh->vertices()[index]);
+        }
+        indices.push_back(static_cast<uint16_t>(remap[index]));
+    }
+    mesh->vertices() = vertices;
+    mesh->indices() = indices;
+    mesh->resetLods();
+    mesh->computeBounds();
+    if (vertices.empty())
+        return 1;
+
+    float origin[3], extent = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+        float lo = vertices[0].position[k], hi = lo;
+        for (const MeshVertex &v : vertices) {
+            lo = fminf(lo, v.position[k]);
+            hi = fmaxf(hi, v.position[k]);
+        }
+        origin[k] = lo;
+        extent = fmaxf(extent, hi - lo);
+    }
+    if (extent <= 0.0f)
+        return 1;
+
+    uint32_t last_triangles = mesh->triangleCount(0);
+    Level level;
+    for (float cell = extent / kFinestGrid; cell <= extent && mesh->lods().size() < maxLods_; cell *= 2.0f) {
+        clusterLevel(vertices, indices, origin, cell, &level);
+        uint32_t triangles = static_cast<uint32_t>(level.indices.size() / 3);
+        if (triangles == 0)
+            break;
+        if (triangles > last_triangles * (1.0f - minReduction_))
+            continue;
+        if (mesh->vertices().size() + level.vertices.size() > 65536)
+            break;
+
+        MeshLod lod;
+        lod.indexOffset = static_cast<uint32_t>(mesh->indices().size());
+        lod.indexCount = static_cast<uint32_t>(level.indices.size());
+        // Keep the errors monotonic so LOD selection can walk the chain
+        lod.error = fmaxf(level.error, mesh->lods().back().error);
+        uint16_t base = static_cast<uint16_t>(mesh->vertices().size());
+        mesh->vertices().insert(mesh->vertices().end(), level.vertices.begin(), level.vertices.end());
+        for (uint16_t index : level.indices)
+            mesh->indices().push_back(static_cast<uint16_t>(base + index));
+        mesh->lods().push_back(lod);
+        last_triangles = triangles;
+    }
+
+    return static_cast<uint32_t>(mesh->lods().size());
+}
+}
@@ -0,0 +1,755 @@
+/***************************************************
+* NBodySystem.cc: Barnes-Hut gravity simulation    *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "NBodySystem.h"
+
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "config.h"
+#include "types.h"
+#include "Profiler.h"
+#include "Simd.h"
+
+namespace lys3d {
+namespace {
+// Morton codes interleave 21 bits per axis; the top 3 levels of the octree
+// (9 bits) pick the cell a body is sorted and built in
+const uint32_t kDepth = 21;
+const uint32_t kCellLevels = 3;
+const uint32_t kCells = 1u << (3 * kCellLevels);
+
+// Work handed out at a time
+const uint32_t kBodyBatch = 4096;
+const uint32_t kLeafBatch = 4;
+const uint32_t kPairBatch = 32;
+
+enum Phase {
+    kPhaseDrift,
+    kPhaseCodes,
+    kPhaseCells,
+    kPhaseForces,
+    kPhaseDirect,
+    kPhaseEnergy
+};
+
+struct Key {
+    uint64_t code;
+    uint32_t body;
+
+    bool operator<(const Key &other) const {
+        return code < other.code || (code == other.code && body < other.body);
+    }
+};
+
+// Nodes are stored depth first, so a node's children follow it and next
+// skips its whole subtree; leaves are the nodes whose next is their index + 1
+struct Node {
+    double x, y, z, mass;
+    double size;
+    uint32_t next;
+    uint32_t begin, count;
+};
+
+struct Bodies {
+    const double *x, *y, *z, *m;
+};
+
+// Interactions gathered by one leaf's walk, and what a thread adds up
+struct Scratch {
+    Vector<double> x, y, z, m;
+    double lowest[3], highest[3];
+    uint64_t interactions;
+};
+
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t spreadBits(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8) & 0x100f00f00f00f00full;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+}
+
+uint32_t cellOf(uint64_t code) {
+    return static_cast<uint32_t>(code >> (3 * (kDepth - kCellLevels)));
+}
+
+// Sums the pull of count masses on the point (x, y, z), leaving out pairs
+// with no separation at all. out receives the acceleration and the
+// potential, sum(m / r), both still to be multiplied by G.
+void accumulate(double x, double y, double z, const double *lx, const double *ly, const double *lz,
+                const double *lm, uint32_t count, double eps2, double out[4]) {
+    uint32_t j = 0;
+    double ax = 0.0, ay = 0.0, az = 0.0, phi = 0.0;
+#if defined(LYS_SIMD_AVX)
+    __m256d px = _mm256_set1_pd(x), py = _mm256_set1_pd(y), pz = _mm256_set1_pd(z);
+    __m256d e = _mm256_set1_pd(eps2), one = _mm256_set1_pd(1.0), zero = _mm256_setzero_pd();
+    __m256d sx = zero, sy = zero, sz = zero, sp = zero;
+    for (; j + 4 <= count; j += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(lx + j), px);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ly + j), py);
+        __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(lz + j), pz);
+        __m256d r2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)),
+                                   _mm256_add_pd(_mm256_mul_pd(dz, dz), e));
+        __m256d inv = _mm256_div_pd(one, _mm256_sqrt_pd(r2));
+        inv = _mm256_and_pd(inv, _mm256_cmp_pd(r2, zero, _CMP_GT_OQ));
+        __m256d mi = _mm256_mul_pd(_mm256_loadu_pd(lm + j), inv);
+        sp = _mm256_add_pd(sp, mi);
+        __m256d mi3 = _mm256_mul_pd(mi, _mm256_mul_pd(inv, inv));
+        sx = _mm256_add_pd(sx, _mm256_mul_pd(dx, mi3));
+        sy = _mm256_add_pd(sy, _mm256_mul_pd(dy, mi3));
+        sz = _mm256_add_pd(sz, _mm256_mul_pd(dz, mi3));
+    }
+    double lanes[4][4];
+    _mm256_storeu_pd(lanes[0], sx);
+    _mm256_storeu_pd(lanes[1], sy);
+    _mm256_storeu_pd(lanes[2], sz);
+    _mm256_storeu_pd(lanes[3], sp);
+    ax = (lanes[0][0] + lanes[0][1]) + (lanes[0][2] + lanes[0][3]);
+    ay = (lanes[1][0] + lanes[1][1]) + (lanes[1][2] + lanes[1][3]);
+    az = (lanes[2][0] + lanes[2][1]) + (lanes[2][2] + lanes[2][3]);
+    phi = (lanes[3][0] + lanes[3][1]) + (lanes[3][2] + lanes[3][3]);
+#elif defined(LYS_SIMD_SSE2)
+    __m128d px = _mm_set1_pd(x), py = _mm_set1_pd(y), pz = _mm_set1_pd(z);
+    __m128d e = _mm_set1_pd(eps2), one = _mm_set1_pd(1.0), zero = _mm_setzero_pd();
+    __m128d sx = zero, sy = zero, sz = zero, sp = zero;
+    for (; j + 2 <= count; j += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(lx + j), px);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(ly + j), py);
+        __m128d dz = _mm_sub_pd(_mm_loadu_pd(lz + j), pz);
+        __m128d r2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)),
+                                _mm_add_pd(_mm_mul_pd(dz, dz), e));
+        __m128d inv = _mm_div_pd(one, _mm_sqrt_pd(r2));
+        inv = _mm_and_pd(inv, _mm_cmpgt_pd(r2, zero));
+        __m128d mi = _mm_mul_pd(_mm_loadu_pd(lm + j), inv);
+        sp = _mm_add_pd(sp, mi);
+        __m128d mi3 = _mm_mul_pd(mi, _mm_mul_pd(inv, inv));
+        sx = _mm_add_pd(sx, _mm_mul_pd(dx, mi3));
+        sy = _mm_add_pd(sy, _mm_mul_pd(dy, mi3));
+        sz = _mm_add_pd(sz, _mm_mul_pd(dz, mi3));
+    }
+    double lanes[4][2];
+    _mm_storeu_pd(lanes[0], sx);
+    _mm_storeu_pd(lanes[1], sy);
+    _mm_storeu_pd(lanes[2], sz);
+    _mm_storeu_pd(lanes[3], sp);
+    ax = lanes[0][0] + lanes[0][1];
+    ay = lanes[1][0] + lanes[1][1];
+    az = lanes[2][0] + lanes[2][1];
+    phi = lanes[3][0] + lanes[3][1];
+#endif
+    for (; j < count; ++j) {
+        double dx = lx[j] - x, dy = ly[j] - y, dz = lz[j] - z;
+        double r2 = dx * dx + dy * dy + dz * dz + eps2;
+        if (r2 <= 0.0)
+            continue;
+        double inv = 1.0 / sqrt(r2);
+        double mi = lm[j] * inv;
+        phi += mi;
+        double mi3 = mi * inv * inv;
+        ax += dx * mi3;
+        ay += dy * mi3;
+        az += dz * mi3;
+    }
+    out[0] = ax;
+    out[1] = ay;
+    out[2] = az;
+    out[3] = phi;
+}
+
+// Builds the subtree of the sorted keys [begin, end), whose codes share
+// their first depth digits, depth first into out
+void buildSubtree(const Key *keys, uint32_t begin, uint32_t end, uint32_t depth, double size,
+                  uint32_t leaf_size, const Bodies &bodies, Vector<Node> *out) {
+    uint32_t index = static_cast<uint32_t>(out->size());
+    out->push_back(Node());
+    double mass = 0.0, mx = 0.0, my = 0.0, mz = 0.0, cx = 0.0, cy = 0.0, cz = 0.0;
+    if (end - begin <= leaf_size || depth >= kDepth) {
+        for (uint32_t k = begin; k < end; ++k) {
+            uint32_t b = keys[k].body;
+            double m = bodies.m[b];
+            mass += m;
+            mx += m * bodies.x[b];
+            my += m * bodies.y[b];
+            mz += m * bodies.z[b];
+            cx += bodies.x[b];
+            cy += bodies.y[b];
+            cz += bodies.z[b];
+        }
+    } else {
+        uint32_t shift = 3 * (kDepth - 1 - depth), first = begin;
+        for (uint32_t octant = 0; octant < 8 && first < end; ++octant) {
+            const Key *last = std::partition_point(keys + first, keys + end, [&](const Key &key) {
+                return (static_cast<uint32_t>(key.code >> shift) & 7) <= octant;
+            });
+            uint32_t stop = static_cast<uint32_t>(last - keys);
+            if (stop == first)
+                continue;
+            uint32_t child = static_cast<uint32_t>(out->size());
+            buildSubtree(keys, first, stop, depth + 1, size * 0.5, leaf_size, bodies, out);
+            const Node &node = (*out)[child];
+            mass += node.mass;
+            mx += node.mass * node.x;
+            my += node.mass * node.y;
+            mz += node.mass * node.z;
+            cx += node.count * node.x;
+            cy += node.count * node.y;
+            cz += node.count * node.z;
+            first = stop;
+        }
+    }
+
+    Node &node = (*out)[index];
+    if (mass > 0.0) {
+        node.x = mx / mass;
+        node.y = my / mass;
+        node.z = mz / mass;
+    } else {
+        // Only test particles: the mass is 0 anyway, so any point inside will do
+        node.x = cx / (end - begin);
+        node.y = cy / (end - begin);
+        node.z = cz / (end - begin);
+    }
+    node.mass = mass;
+    node.size = size;
+    node.begin = begin;
+    node.count = end - begin;
+    node.next = static_cast<uint32_t>(out->size());
+}
+}
+
+
+struct NBodySystem::Impl {
+    explicit Impl(const NBodySettings &new_settings) {
+        settings = new_settings;
+        settings.leafSize = std::max(1u, std::min(settings.leafSize, 64u));
+        dirty = true;
+        rootSize = 1.0;
+        scale = 1.0;
+        for (int axis = 0; axis < 3; ++axis)
+            origin[axis] = 0.0;
+        kick = drift = 0.0;
+        directOut = nullptr;
+        phase = kPhaseDrift;
+        cellNodes.resize(kCells);
+        scratch.resize(settings.workers + 1);
+        generation = 0;
+        busy = 0;
+        quit = false;
+        next = 0;
+        interactionCounter = Profiler::global().counter("N-body interactions");
+        for (uint32_t i = 0; i < settings.workers; ++i)
+            threads.push_back(std::thread(&Impl::workerMain, this, i + 1));
+    }
+
+    ~Impl() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    void workerMain(uint32_t index) {
+        uint32_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen = generation;
+            lock.unlock();
+            work(index);
+            lock.lock();
+            if (--busy == 0)
+                done.notify_all();
+        }
+    }
+
+    // Runs the given phase on every thread, returning when it's done
+    void run(Phase new_phase) {
+        phase = new_phase;
+        next = 0;
+        if (!threads.empty()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = static_cast<uint32_t>(threads.size());
+            ++generation;
+        }
+        wake.notify_all();
+        work(0);
+        if (!threads.empty()) {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&] { return busy == 0; });
+        }
+    }
+
+    void work(uint32_t thread) {
+        Scratch &mine = scratch[thread];
+        uint32_t count = static_cast<uint32_t>(x.size());
+        switch (phase) {
+        case kPhaseDrift:
+            for (uint32_t first = next.fetch_add(kBodyBatch); first < count; first = next.fetch_add(kBodyBatch))
+                driftBodies(first, std::min(count, first + kBodyBatch), mine);
+            break;
+        case kPhaseCodes:
+            for (uint32_t first = next.fetch_add(kBodyBatch); first < count; first = next.fetch_add(kBodyBatch))
+                encodeBodies(first, std::min(count, first + kBodyBatch));
+            break;
+        case kPhaseCells:
+            for (uint32_t cell = next.fetch_add(1); cell < kCells; cell = next.fetch_add(1))
+                buildCell(cell);
+            break;
+        case kPhaseForces: {
+            uint32_t leaf_count = static_cast<uint32_t>(leaves.size());
+            for (uint32_t first = next.fetch_add(kLeafBatch); first < leaf_count;
+                 first = next.fetch_add(kLeafBatch)) {
+                for (uint32_t leaf = first; leaf < std::min(leaf_count, first + kLeafBatch); ++leaf)
+                    leafForces(nodes[leaves[leaf]], mine);
+            }
+            break;
+        }
+        case kPhaseDirect:
+        case kPhaseEnergy:
+            for (uint32_t first = next.fetch_add(kPairBatch); first < count; first = next.fetch_add(kPairBatch))
+                sumPairs(first, std::min(count, first + kPairBatch));
+            break;
+        }
+    }
+
+    // First half of a leapfrog step (kick, then drift), finding the bounds
+    // of the new positions on the way
+    void driftBodies(uint32_t first, uint32_t last, Scratch &mine) {
+        for (uint32_t i = first; i < last; ++i) {
+            vx[i] += ax[i] * kick;
+            vy[i] += ay[i] * kick;
+            vz[i] += az[i] * kick;
+            x[i] += vx[i] * drift;
+            y[i] += vy[i] * drift;
+            z[i] += vz[i] * drift;
+            mine.lowest[0] = std::min(mine.lowest[0], x[i]);
+            mine.lowest[1] = std::min(mine.lowest[1], y[i]);
+            mine.lowest[2] = std::min(mine.lowest[2], z[i]);
+            mine.highest[0] = std::max(mine.highest[0], x[i]);
+            mine.highest[1] = std::max(mine.highest[1], y[i]);
+            mine.highest[2] = std::max(mine.highest[2], z[i]);
+        }
+    }
+
+    void encodeBodies(uint32_t first, uint32_t last) {
+        const double kMaxCoordinate = static_cast<double>((1u << kDepth) - 1);
+        for (uint32_t i = first; i < last; ++i) {
+            double position[3] = {x[i], y[i], z[i]};
+            uint64_t code = 0;
+            for (int axis = 0; axis < 3; ++axis) {
+                double q = std::max(0.0, std::min((position[axis] - origin[axis]) * scale, kMaxCoordinate));
+                code |= spreadBits(static_cast<uint64_t>(q)) << (2 - axis);
+            }
+            keys[i].code = code;
+            keys[i].body = i;
+        }
+    }
+
+    void buildCell(uint32_t cell) {
+        Vector<Node> &out = cellNodes[cell];
+        out.clear();
+        uint32_t begin = cellStart[cell], end = cellStart[cell + 1];
+        if (begin == end)
+            return;
+        std::sort(sorted.begin() + begin, sorted.begin() + end);
+        Bodies bodies = {x.data(), y.data(), z.data(), m.data()};
+        buildSubtree(sorted.data(), begin, end, kCellLevels, rootSize / (1u << kCellLevels), settings.leafSize,
+                     bodies, &out);
+    }
+
+    // Joins the cell subtrees under the top levels of the tree; returns
+    // false if there were no bodies below the given node
+    bool assemble(uint32_t depth, uint32_t prefix) {
+        if (depth == kCellLevels) {
+            const Vector<Node> &sub = cellNodes[prefix];
+            uint32_t base = static_cast<uint32_t>(nodes.size());
+            for (const Node &node : sub) {
+                nodes.push_back(node);
+                nodes.back().next += base;
+            }
+            return !sub.empty();
+        }
+
+        uint32_t index = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(Node());
+        double mass = 0.0, mx = 0.0, my = 0.0, mz = 0.0, cx = 0.0, cy = 0.0, cz = 0.0;
+        uint32_t count = 0, begin = 0;
+        for (uint32_t octant = 0; octant < 8; ++octant) {
+            uint32_t child = static_cast<uint32_t>(nodes.size());
+            if (!assemble(depth + 1, prefix * 8 + octant))
+                continue;
+            const Node &node = nodes[child];
+            if (count == 0)
+                begin = node.begin;
+            count += node.count;
+            mass += node.mass;
+            mx += node.mass * node.x;
+            my += node.mass * node.y;
+            mz += node.mass * node.z;
+            cx += node.count * node.x;
+            cy += node.count * node.y;
+            cz += node.count * node.z;
+        }
+        if (count == 0) {
+            nodes.pop_back();
+            return false;
+        }
+
+        Node &node = nodes[index];
+        node.x = mass > 0.0 ? mx / mass : cx / count;
+        node.y = mass > 0.0 ? my / mass : cy / count;
+        node.z = mass > 0.0 ? mz / mass : cz / count;
+        node.mass = mass;
+        node.size = rootSize / (1u << depth);
+        node.begin = begin;
+        node.count = count;
+        node.next = static_cast<uint32_t>(nodes.size());
+        return true;
+    }
+
+    // Walks the tree once for all of a leaf's bodies, then sums their forces
+    // and finishes their step with the second half kick
+    void leafForces(const Node &leaf, Scratch &mine) {
+        double lowest[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL}, highest[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+        for (uint32_t k = leaf.begin; k < leaf.begin + leaf.count; ++k) {
+            uint32_t b = sorted[k].body;
+            double position[3] = {x[b], y[b], z[b]};
+            for (int axis = 0; axis < 3; ++axis) {
+                lowest[axis] = std::min(lowest[axis], position[axis]);
+                highest[axis] = std::max(highest[axis], position[axis]);
+            }
+        }
+
+        mine.x.clear();
+        mine.y.clear();
+        mine.z.clear();
+        mine.m.clear();
+        double theta2 = settings.theta * settings.theta;
+        uint32_t node_count = static_cast<uint32_t>(nodes.size());
+        for (uint32_t i = 0; i < node_count;) {
+            const Node &node = nodes[i];
+            // Distance from the node's center of mass to the leaf's bounds
+            double dx = std::max(0.0, std::max(lowest[0] - node.x, node.x - highest[0]));
+            double dy = std::max(0.0, std::max(lowest[1] - node.y, node.y - highest[1]));
+            double dz = std::max(0.0, std::max(lowest[2] - node.z, node.z - highest[2]));
+            if (node.size * node.size < theta2 * (dx * dx + dy * dy + dz * dz)) {
+                mine.x.push_back(node.x);
+                mine.y.push_back(node.y);
+                mine.z.push_back(node.z);
+                mine.m.push_back(node.mass);
+                i = node.next;
+            } else if (node.next == i + 1) {
+                for (uint32_t k = node.begin; k < node.begin + node.count; ++k) {
+                    uint32_t b = sorted[k].body;
+                    mine.x.push_back(x[b]);
+                    mine.y.push_back(y[b]);
+                    mine.z.push_back(z[b]);
+                    mine.m.push_back(m[b]);
+                }
+                i = node.next;
+            } else {
+                ++i;
+            }
+        }
+
+        uint32_t list = static_cast<uint32_t>(mine.m.size());
+        double eps2 = settings.softening * settings.softening, sum[4];
+        for (uint32_t k = leaf.begin; k < leaf.begin + leaf.count; ++k) {
+            uint32_t b = sorted[k].body;
+            accumulate(x[b], y[b], z[b], mine.x.data(), mine.y.data(), mine.z.data(), mine.m.data(), list, eps2,
+                       sum);
+            ax[b] = settings.gravity * sum[0];
+            ay[b] = settings.gravity * sum[1];
+            az[b] = settings.gravity * sum[2];
+            vx[b] += ax[b] * kick;
+            vy[b] += ay[b] * kick;
+            vz[b] += az[b] * kick;
+        }
+        mine.interactions += static_cast<uint64_t>(list) * leaf.count;
+    }
+
+    void sumPairs(uint32_t first, uint32_t last) {
+        uint32_t count = static_cast<uint32_t>(x.size());
+        double eps2 = settings.softening * settings.softening, sum[4];
+        for (uint32_t i = first; i < last; ++i) {
+            accumulate(x[i], y[i], z[i], x.data(), y.data(), z.data(), m.data(), count, eps2, sum);
+            if (phase == kPhaseDirect) {
+                directOut[i] = Point3Dd(settings.gravity * sum[0], settings.gravity * sum[1],
+                                        settings.gravity * sum[2]);
+            } else {
+                // A softened body would pull on itself
+                if (eps2 > 0.0)
+                    sum[3] -= m[i] / settings.softening;
+                potential[i] = m[i] * sum[3];
+            }
+        }
+    }
+
+    // Kicks by first_kick, drifts, rebuilds the tree, then sets the new
+    // accelerations and kicks by last_kick
+    void simulate(double first_kick, double drift_time, double last_kick) {
+        LYS_PROFILE_ZONE("N-body step");
+        int64_t start = now();
+        uint32_t count = static_cast<uint32_t>(x.size());
+        stats = NBodyStats();
+        stats.bodies = count;
+        dirty = false;
+        if (count == 0)
+            return;
+
+        for (Scratch &s : scratch) {
+            for (int axis = 0; axis < 3; ++axis) {
+                s.lowest[axis] = HUGE_VAL;
+                s.highest[axis] = -HUGE_VAL;
+            }
+            s.interactions = 0;
+        }
+        kick = first_kick;
+        drift = drift_time;
+        run(kPhaseDrift);
+
+        // The root is the bounding cube of every body
+        double lowest[3], extent = 0.0;
+        for (int axis = 0; axis < 3; ++axis) {
+            double highest = -HUGE_VAL;
+            lowest[axis] = HUGE_VAL;
+            for (const Scratch &s : scratch) {
+                lowest[axis] = std::min(lowest[axis], s.lowest[axis]);
+                highest = std::max(highest, s.highest[axis]);
+            }
+            origin[axis] = lowest[axis];
+            extent = std::max(extent, highest - lowest[axis]);
+        }
+        rootSize = extent > 0.0 ? extent : 1.0;
+        scale = (1u << kDepth) / rootSize;
+        keys.resize(count);
+        run(kPhaseCodes);
+
+        // Counting sort into cells, sorted and built on their own
+        uint32_t cell_count[kCells] = {};
+        for (const Key &key : keys)
+            ++cell_count[cellOf(key.code)];
+        cellStart[0] = 0;
+        for (uint32_t cell = 0; cell < kCells; ++cell)
+            cellStart[cell + 1] = cellStart[cell] + cell_count[cell];
+        sorted.resize(count);
+        for (const Key &key : keys) {
+            uint32_t cell = cellOf(key.code);
+            sorted[cellStart[cell] + --cell_count[cell]] = key;
+        }
+        run(kPhaseCells);
+
+        nodes.clear();
+        leaves.clear();
+        assemble(0, 0);
+        for (uint32_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i].next == i + 1)
+                leaves.push_back(i);
+        }
+        int64_t built = now();
+
+        kick = last_kick;
+        run(kPhaseForces);
+        for (const Scratch &s : scratch)
+            stats.interactions += s.interactions;
+        stats.nodes = static_cast<uint32_t>(nodes.size());
+        stats.leaves = static_cast<uint32_t>(leaves.size());
+        stats.buildMs = (built - start) / 1.0e6f;
+        stats.forceMs = (now() - built) / 1.0e6f;
+        Profiler::global().count(interactionCounter, static_cast<int64_t>(stats.interactions));
+    }
+
+    NBodySettings settings;
+    Vector<double> x, y, z, vx, vy, vz, ax, ay, az, m;
+    bool dirty;
+    NBodyStats stats;
+    uint32_t interactionCounter;
+
+    // The octree
+    double origin[3];
+    double rootSize;
+    double scale;
+    Vector<Key> keys;
+    Vector<Key> sorted;
+    uint32_t cellStart[kCells + 1];
+    Vector<Vector<Node>> cellNodes;
+    Vector<Node> nodes;
+    Vector<uint32_t> leaves;
+
+    // Parameters of the current phase
+    Phase phase;
+    double kick;
+    double drift;
+    Point3Dd *directOut;
+    Vector<double> potential;
+
+    // Shared with the worker threads
+    Vector<Scratch> scratch;
+    Vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint32_t generation;
+    uint32_t busy;
+    bool quit;
+    std::atomic<uint32_t> next;
+};
+
+
+LYS_API NBodySystem::NBodySystem(const NBodySettings &settings) {
+    pimpl_ = new Impl(settings);
+}
+
+
+LYS_API NBodySystem::~NBodySystem() {
+    delete pimpl_;
+}
+
+
+LYS_API const NBodySettings& NBodySystem::settings() const {
+    return pimpl_->settings;
+}
+
+
+LYS_API uint32_t NBodySystem::add(const Point3Dd &position, const Point3Dd &velocity, double mass) {
+    Impl &impl = *pimpl_;
+    impl.x.push_back(position.x());
+    impl.y.push_back(position.y());
+    impl.z.push_back(position.z());
+    impl.vx.push_back(velocity.x());
+    impl.vy.push_back(velocity.y());
+    impl.vz.push_back(velocity.z());
+    impl.ax.push_back(0.0);
+    impl.ay.push_back(0.0);
+    impl.az.push_back(0.0);
+    impl.m.push_back(mass);
+    impl.dirty = true;
+    return static_cast<uint32_t>(impl.x.size() - 1);
+}
+
+
+LYS_API void NBodySystem::clear() {
+    Impl &impl = *pimpl_;
+    Vector<double> *arrays[] = {&impl.x, &impl.y, &impl.z, &impl.vx, &impl.vy, &impl.vz,
+                                &impl.ax, &impl.ay, &impl.az, &impl.m};
+    for (Vector<double> *array : arrays)
+        array->clear();
+    impl.dirty = true;
+}
+
+
+LYS_API uint32_t NBodySystem::size() const {
+    return static_cast<uint32_t>(pimpl_->x.size());
+}
+
+
+LYS_API Point3Dd NBodySystem::position(uint32_t body) const {
+    const Impl &impl = *pimpl_;
+    return Point3Dd(impl.x[body], impl.y[body], impl.z[body]);
+}
+
+
+LYS_API void NBodySystem::position(uint32_t body, const Point3Dd &position) {
+    Impl &impl = *pimpl_;
+    impl.x[body] = position.x();
+    impl.y[body] = position.y();
+    impl.z[body] = position.z();
+    impl.dirty = true;
+}
+
+
+LYS_API Point3Dd NBodySystem::velocity(uint32_t body) const {
+    const Impl &impl = *pimpl_;
+    return Point3Dd(impl.vx[body], impl.vy[body], impl.vz[body]);
+}
+
+
+LYS_API void NBodySystem::velocity(uint32_t body, const Point3Dd &velocity) {
+    Impl &impl = *pimpl_;
+    impl.vx[body] = velocity.x();
+    impl.vy[body] = velocity.y();
+    impl.vz[body] = velocity.z();
+}
+
+
+LYS_API double NBodySystem::mass(uint32_t body) const {
+    return pimpl_->m[body];
+}
+
+
+LYS_API void NBodySystem::mass(uint32_t body, double mass) {
+    pimpl_->m[body] = mass;
+    pimpl_->dirty = true;
+}
+
+
+LYS_API Point3Dd NBodySystem::acceleration(uint32_t body) const {
+    const Impl &impl = *pimpl_;
+    return Point3Dd(impl.ax[body], impl.ay[body], impl.az[body]);
+}
+
+
+LYS_API void NBodySystem::step(double seconds) {
+    Impl &impl = *pimpl_;
+    if (impl.dirty)
+        impl.simulate(0.0, 0.0, 0.0);
+    impl.simulate(seconds * 0.5, seconds, seconds * 0.5);
+}
+
+
+LYS_API void NBodySystem::computeAccelerations() {
+    pimpl_->simulate(0.0, 0.0, 0.0);
+}
+
+
+LYS_API void NBodySystem::directAccelerations(Point3Dd *out) {
+    Impl &impl = *pimpl_;
+    impl.directOut = out;
+    impl.run(kPhaseDirect);
+    impl.directOut = nullptr;
+}
+
+
+LYS_API double NBodySystem::energy() {
+    Impl &impl = *pimpl_;
+    impl.potential.resize(impl.x.size());
+    impl.run(kPhaseEnergy);
+    double kinetic = 0.0, potential = 0.0;
+    for (size_t i = 0; i < impl.x.size(); ++i) {
+        kinetic += 0.5 * impl.m[i] * (impl.vx[i] * impl.vx[i] + impl.vy[i] * impl.vy[i] + impl.vz[i] * impl.vz[i]);
+        potential += impl.potential[i];
+    }
+    // Every pair was counted from both ends
+    return kinetic - 0.5 * impl.settings.gravity * potential;
+}
+
+
+LYS_API const NBodyStats& NBodySystem::stats() const {
+    return pimpl_->stats;
+}
+}
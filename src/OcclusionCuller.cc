@@ -0,0 +1,549 @@
+/***************************************************
+* OcclusionCuller.cc: CPU depth-buffer culling     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "OcclusionCuller.h"
+
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "config.h"
+#include "types.h"
+#include "Profiler.h"
+#include "Simd.h"
+
+namespace lys3d {
+namespace {
+struct ClipVertex {
+    float x, y, z, w;
+};
+
+// A triangle ready to rasterize: edge functions A * x + B * y + C (positive
+// inside), the depth plane, and the pixel bounds
+struct ScreenTriangle {
+    float edgeA[3], edgeB[3], edgeC[3];
+    float depthA, depthB, depthC;
+    int32_t minX, minY, maxX, maxY;
+};
+
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int32_t roundUp(int32_t value, int32_t multiple) {
+    return std::max(multiple, (value + multiple - 1) / multiple * multiple);
+}
+
+// Column-major, as GL expects: out = a * b
+void multiply(const float a[16], const float b[16], float out[16]) {
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            out[c * 4 + r] = a[r] * b[c * 4] + a[4 + r] * b[c * 4 + 1] + a[8 + r] * b[c * 4 + 2]
+                           + a[12 + r] * b[c * 4 + 3];
+        }
+    }
+}
+
+ClipVertex transform(const float m[16], float x, float y, float z) {
+    ClipVertex v;
+    v.x = m[0] * x + m[4] * y + m[8] * z + m[12];
+    v.y = m[1] * x + m[5] * y + m[9] * z + m[13];
+    v.z = m[2] * x + m[6] * y + m[10] * z + m[14];
+    v.w = m[3] * x + m[7] * y + m[11] * z + m[15];
+    return v;
+}
+
+ClipVertex lerp(const ClipVertex &a, const ClipVertex &b, float t) {
+    ClipVertex v;
+    v.x = a.x + (b.x - a.x) * t;
+    v.y = a.y + (b.y - a.y) * t;
+    v.z = a.z + (b.z - a.z) * t;
+    v.w = a.w + (b.w - a.w) * t;
+    return v;
+}
+
+// Keep the nearer depth of every pixel in [x, x_end) of a row that the
+// triangle covers. x is aligned to the SIMD width, and the buffer is padded
+// so whole vectors never run past the tile.
+void rasterSpan(const ScreenTriangle &t, float *row, int32_t x, int32_t x_end, float py) {
+    float rowC[3];
+    for (int e = 0; e < 3; ++e)
+        rowC[e] = t.edgeB[e] * py + t.edgeC[e];
+    float depth_row = t.depthB * py + t.depthC;
+#if defined(LYS_SIMD_AVX)
+    const __m256 lanes = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 a0 = _mm256_set1_ps(t.edgeA[0]), a1 = _mm256_set1_ps(t.edgeA[1]), a2 = _mm256_set1_ps(t.edgeA[2]);
+    const __m256 c0 = _mm256_set1_ps(rowC[0]), c1 = _mm256_set1_ps(rowC[1]), c2 = _mm256_set1_ps(rowC[2]);
+    const __m256 za = _mm256_set1_ps(t.depthA), zc = _mm256_set1_ps(depth_row);
+    for (x &= ~7; x < x_end; x += 8) {
+        __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), lanes);
+        __m256 inside = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a0, px), c0), zero, _CMP_GE_OQ),
+                          _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a1, px), c1), zero, _CMP_GE_OQ)),
+            _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a2, px), c2), zero, _CMP_GE_OQ));
+        __m256 old = _mm256_loadu_ps(row + x);
+        __m256 nearer = _mm256_min_ps(old, _mm256_add_ps(_mm256_mul_ps(za, px), zc));
+        _mm256_storeu_ps(row + x, _mm256_blendv_ps(old, nearer, inside));
+    }
+#elif defined(LYS_SIMD_SSE2)
+    const __m128 lanes = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 a0 = _mm_set1_ps(t.edgeA[0]), a1 = _mm_set1_ps(t.edgeA[1]), a2 = _mm_set1_ps(t.edgeA[2]);
+    const __m128 c0 = _mm_set1_ps(rowC[0]), c1 = _mm_set1_ps(rowC[1]), c2 = _mm_set1_ps(rowC[2]);
+    const __m128 za = _mm_set1_ps(t.depthA), zc = _mm_set1_ps(depth_row);
+    for (x &= ~3; x < x_end; x += 4) {
+        __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), c0), zero),
+                                              _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), c1), zero)),
+                                   _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), c2), zero));
+        __m128 old = _mm_loadu_ps(row + x);
+        __m128 nearer = _mm_min_ps(old, _mm_add_ps(_mm_mul_ps(za, px), zc));
+        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+    }
+#else
+    for (; x < x_end; ++x) {
+        float px = x + 0.5f;
+        if (t.edgeA[0] * px + rowC[0] >= 0.0f && t.edgeA[1] * px + rowC[1] >= 0.0f
+                && t.edgeA[2] * px + rowC[2] >= 0.0f)
+            row[x] = std::min(row[x], t.depthA * px + depth_row);
+    }
+#endif
+}
+}
+
+
+struct OcclusionCuller::Impl {
+    Impl(const Dimension2Di32 &resolution, uint32_t workers) {
+        enabled = true;
+        width = roundUp(resolution.width(), kBlockSize);
+        height = roundUp(resolution.height(), kBlockSize);
+        size = Dimension2Di32(width, height);
+        tilesX = (width + kTileWidth - 1) / kTileWidth;
+        tilesY = (height + kTileHeight - 1) / kTileHeight;
+        blocksX = width / kBlockSize;
+        depth.assign(static_cast<size_t>(width) * height, 1.0f);
+        blockMax.assign(static_cast<size_t>(blocksX) * (height / kBlockSize), 1.0f);
+        bins.resize(static_cast<size_t>(tilesX) * tilesY);
+        for (int i = 0; i < 16; ++i)
+            viewProjection[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+        generation = 0;
+        busy = 0;
+        quit = false;
+        nextTile = 0;
+        Profiler &profiler = Profiler::global();
+        culledCounter = profiler.counter("Objects occlusion culled");
+        percentCounter = profiler.counter("Occlusion culled (%)", false);
+        for (uint32_t i = 0; i < workers; ++i)
+            threads.push_back(std::thread(&Impl::workerMain, this));
+    }
+
+    ~Impl() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    void workerMain() {
+        uint32_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen = generation;
+            lock.unlock();
+            runTiles();
+            lock.lock();
+            if (--busy == 0)
+                done.notify_all();
+        }
+    }
+
+    void runTiles() {
+        uint32_t count = static_cast<uint32_t>(bins.size());
+        for (uint32_t tile = nextTile.fetch_add(1); tile < count; tile = nextTile.fetch_add(1))
+            rasterTile(tile);
+    }
+
+    void rasterTile(uint32_t tile) {
+        int32_t x0 = static_cast<int32_t>(tile % tilesX) * kTileWidth;
+        int32_t y0 = static_cast<int32_t>(tile / tilesX) * kTileHeight;
+        int32_t x1 = std::min(width, x0 + kTileWidth), y1 = std::min(height, y0 + kTileHeight);
+        for (uint32_t index : bins[tile]) {
+            const ScreenTriangle &t = triangles[index];
+            int32_t min_x = std::max(x0, t.minX), max_x = std::min(x1, t.maxX);
+            int32_t min_y = std::max(y0, t.minY), max_y = std::min(y1, t.maxY);
+            for (int32_t y = min_y; y < max_y; ++y)
+                rasterSpan(t, &depth[static_cast<size_t>(y) * width], min_x, max_x, y + 0.5f);
+        }
+
+        // Farthest depth of each block
+        for (int32_t by = y0; by < y1; by += kBlockSize) {
+            for (int32_t bx = x0; bx < x1; bx += kBlockSize) {
+                float farthest = 0.0f;
+                for (int32_t y = by; y < by + kBlockSize; ++y) {
+                    const float *row = &depth[static_cast<size_t>(y) * width + bx];
+                    for (int32_t x = 0; x < kBlockSize; ++x)
+                        farthest = std::max(farthest, row[x]);
+                }
+                blockMax[static_cast<size_t>(by / kBlockSize) * blocksX + bx / kBlockSize] = farthest;
+            }
+        }
+    }
+
+    // Clip against the near plane (z = -w); the far side needs no clipping,
+    // since depths past 1 never win against the cleared buffer
+    void addTriangle(const ClipVertex &a, const ClipVertex &b, const ClipVertex &c) {
+        const ClipVertex in[3] = {a, b, c};
+        ClipVertex out[4];
+        int count = 0;
+        for (int i = 0; i < 3; ++i) {
+            const ClipVertex &cur = in[i], &next = in[(i + 1) % 3];
+            float d_cur = cur.z + cur.w, d_next = next.z + next.w;
+            if (d_cur >= 0.0f)
+                out[count++] = cur;
+            if ((d_cur >= 0.0f) != (d_next >= 0.0f))
+                out[count++] = lerp(cur, next, d_cur / (d_cur - d_next));
+        }
+        if (count >= 3)
+            setup(out[0], out[1], out[2]);
+        if (count == 4)
+            setup(out[0], out[2], out[3]);
+    }
+
+    void setup(const ClipVertex &a, const ClipVertex &b, const ClipVertex &c) {
+        const ClipVertex *v[3] = {&a, &b, &c};
+        float x[3], y[3], z[3];
+        for (int i = 0; i < 3; ++i) {
+            if (v[i]->w <= 0.0f)
+                return;
+            float inv_w = 1.0f / v[i]->w;
+            x[i] = (v[i]->x * inv_w * 0.5f + 0.5f) * width;
+            y[i] = (v[i]->y * inv_w * 0.5f + 0.5f) * height;
+            z[i] = v[i]->z * inv_w * 0.5f + 0.5f;
+        }
+
+        // Back-facing or degenerate
+        float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (area <= 0.0f)
+            return;
+
+        ScreenTriangle t;
+        t.minX = std::max(0, static_cast<int32_t>(floorf(std::min(x[0], std::min(x[1], x[2])))));
+        t.minY = std::max(0, static_cast<int32_t>(floorf(std::min(y[0], std::min(y[1], y[2])))));
+        t.maxX = std::min(width, static_cast<int32_t>(ceilf(std::max(x[0], std::max(x[1], x[2])))));
+        t.maxY = std::min(height, static_cast<int32_t>(ceilf(std::max(y[0], std::max(y[1], y[2])))));
+        if (t.minX >= t.maxX || t.minY >= t.maxY || std::min(z[0], std::min(z[1], z[2])) > 1.0f)
+            return;
+        for (int e = 0; e < 3; ++e) {
+            int n = (e + 1) % 3;
+            t.edgeA[e] = y[e] - y[n];
+            t.edgeB[e] = x[n] - x[e];
+            t.edgeC[e] = -(t.edgeA[e] * x[e] + t.edgeB[e] * y[e]);
+        }
+        t.depthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+        t.depthB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+        t.depthC = z[0] - t.depthA * x[0] - t.depthB * y[0];
+
+        uint32_t index = static_cast<uint32_t>(triangles.size());
+        triangles.push_back(t);
+        ++stats.triangles;
+        for (int32_t ty = t.minY / kTileHeight; ty <= (t.maxY - 1) / kTileHeight; ++ty) {
+            for (int32_t tx = t.minX / kTileWidth; tx <= (t.maxX - 1) / kTileWidth; ++tx)
+                bins[static_cast<size_t>(ty) * tilesX + tx].push_back(index);
+        }
+    }
+
+    bool test(const Box3Df &box) const {
+        const Point3Df &lo = box.min(), &hi = box.max();
+        const float *m = viewProjection;
+        float min_x = 1.0f, max_x = -1.0f, min_y = 1.0f, max_y = -1.0f, min_z = 2.0f;
+        int behind = 0;
+#ifdef LYS_SIMD_SSE2
+        // Four corners at a time: the near face, then the far face
+        const __m128 cx = _mm_setr_ps(lo.x(), hi.x(), lo.x(), hi.x());
+        const __m128 cy = _mm_setr_ps(lo.y(), lo.y(), hi.y(), hi.y());
+        __m128 lo_x = _mm_set1_ps(1.0f), hi_x = _mm_set1_ps(-1.0f);
+        __m128 lo_y = _mm_set1_ps(1.0f), hi_y = _mm_set1_ps(-1.0f), lo_z = _mm_set1_ps(2.0f);
+        for (int face = 0; face < 2; ++face) {
+            __m128 cz = _mm_set1_ps(face == 0 ? lo.z() : hi.z());
+            __m128 px = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0]), cx), _mm_mul_ps(_mm_set1_ps(m[4]), cy)),
+                                   _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[8]), cz), _mm_set1_ps(m[12])));
+            __m128 py = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[1]), cx), _mm_mul_ps(_mm_set1_ps(m[5]), cy)),
+                                   _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[9]), cz), _mm_set1_ps(m[13])));
+            __m128 pz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[2]), cx), _mm_mul_ps(_mm_set1_ps(m[6]), cy)),
+                                   _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[10]), cz), _mm_set1_ps(m[14])));
+            __m128 pw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[3]), cx), _mm_mul_ps(_mm_set1_ps(m[7]), cy)),
+                                   _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[11]), cz), _mm_set1_ps(m[15])));
+            int mask = _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(pz, pw), _mm_setzero_ps()));
+            behind += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + (mask >> 3);
+            __m128 inv_w = _mm_div_ps(_mm_set1_ps(1.0f), pw);
+            px = _mm_mul_ps(px, inv_w);
+            py = _mm_mul_ps(py, inv_w);
+            lo_x = _mm_min_ps(lo_x, px);
+            hi_x = _mm_max_ps(hi_x, px);
+            lo_y = _mm_min_ps(lo_y, py);
+            hi_y = _mm_max_ps(hi_y, py);
+            lo_z = _mm_min_ps(lo_z, _mm_mul_ps(pz, inv_w));
+        }
+        float values[4];
+        _mm_storeu_ps(values, lo_x);
+        min_x = std::min(std::min(values[0], values[1]), std::min(values[2], values[3]));
+        _mm_storeu_ps(values, hi_x);
+        max_x = std::max(std::max(values[0], values[1]), std::max(values[2], values[3]));
+        _mm_storeu_ps(values, lo_y);
+        min_y = std::min(std::min(values[0], values[1]), std::min(values[2], values[3]));
+        _mm_storeu_ps(values, hi_y);
+        max_y = std::max(std::max(values[0], values[1]), std::max(values[2], values[3]));
+        _mm_storeu_ps(values, lo_z);
+        min_z = std::min(std::min(values[0], values[1]), std::min(values[2], values[3]));
+#else
+        for (int i = 0; i < 8; ++i) {
+            ClipVertex c = transform(m, (i & 1) ? hi.x() : lo.x(), (i & 2) ? hi.y() : lo.y(),
+                                     (i & 4) ? hi.z() : lo.z());
+            behind += (c.z + c.w < 0.0f) ? 1 : 0;
+            float inv_w = 1.0f / c.w;
+            min_x = std::min(min_x, c.x * inv_w);
+            max_x = std::max(max_x, c.x * inv_w);
+            min_y = std::min(min_y, c.y * inv_w);
+            max_y = std::max(max_y, c.y * inv_w);
+            min_z = std::min(min_z, c.z * inv_w);
+        }
+#endif
+        // Entirely behind the near plane, or too close to the camera to say
+        // anything
+        if (behind > 0)
+            return behind < 8;
+        if (max_x < -1.0f || min_x > 1.0f || max_y < -1.0f || min_y > 1.0f || min_z > 1.0f)
+            return false;
+
+        int32_t x0 = std::max(0, static_cast<int32_t>(floorf((min_x * 0.5f + 0.5f) * width)));
+        int32_t x1 = std::min(width, static_cast<int32_t>(ceilf((max_x * 0.5f + 0.5f) * width)));
+        int32_t y0 = std::max(0, static_cast<int32_t>(floorf((min_y * 0.5f + 0.5f) * height)));
+        int32_t y1 = std::min(height, static_cast<int32_t>(ceilf((max_y * 0.5f + 0.5f) * height)));
+        float nearest = min_z * 0.5f + 0.5f;
+        for (int32_t by = y0 / kBlockSize; by * kBlockSize < y1; ++by) {
+            for (int32_t bx = x0 / kBlockSize; bx * kBlockSize < x1; ++bx) {
+                // Everything in the block is in front of the box
+                if (blockMax[static_cast<size_t>(by) * blocksX + bx] <= nearest)
+                    continue;
+                int32_t px0 = std::max(x0, bx * kBlockSize), px1 = std::min(x1, (bx + 1) * kBlockSize);
+                int32_t py0 = std::max(y0, by * kBlockSize), py1 = std::min(y1, (by + 1) * kBlockSize);
+                for (int32_t y = py0; y < py1; ++y) {
+                    const float *row = &depth[static_cast<size_t>(y) * width];
+                    for (int32_t x = px0; x < px1; ++x) {
+                        if (row[x] > nearest)
+                            return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    bool enabled;
+    int32_t width;
+    int32_t height;
+    Dimension2Di32 size;
+    int32_t tilesX;
+    int32_t tilesY;
+    int32_t blocksX;
+    Vector<float> depth;
+    Vector<float> blockMax;
+    float viewProjection[16];
+    Vector<ClipVertex> clip;
+    Vector<ScreenTriangle> triangles;
+    Vector<Vector<uint32_t>> bins;
+    OcclusionStats stats;
+    uint32_t culledCounter;
+    uint32_t percentCounter;
+
+    // Shared with the worker threads
+    Vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint32_t generation;
+    uint32_t busy;
+    bool quit;
+    std::atomic<uint32_t> nextTile;
+};
+
+
+LYS_API OcclusionCuller::OcclusionCuller(const Dimension2Di32 &resolution, uint32_t workers) {
+    pimpl_ = new Impl(resolution, workers);
+}
+
+
+LYS_API OcclusionCuller::~OcclusionCuller() {
+    delete pimpl_;
+}
+
+
+LYS_API bool OcclusionCuller::isEnabled() const {
+    return pimpl_->enabled;
+}
+
+
+LYS_API void OcclusionCuller::enable(bool enable) {
+    pimpl_->enabled = enable;
+}
+
+
+LYS_API const Dimension2Di32& OcclusionCuller::resolution() const {
+    return pimpl_->size;
+}
+
+
+LYS_API void OcclusionCuller::beginFrame(const float view_projection[16]) {
+    Impl &impl = *pimpl_;
+    if (impl.stats.tested > 0)
+        Profiler::global().set(impl.percentCounter, lroundf(impl.stats.culledPercent()));
+    impl.stats = OcclusionStats();
+    impl.triangles.clear();
+    for (Vector<uint32_t> &bin : impl.bins)
+        bin.clear();
+    if (!impl.enabled)
+        return;
+    std::copy(view_projection, view_projection + 16, impl.viewProjection);
+    std::fill(impl.depth.begin(), impl.depth.end(), 1.0f);
+    std::fill(impl.blockMax.begin(), impl.blockMax.end(), 1.0f);
+}
+
+
+LYS_API void OcclusionCuller::addOccluder(const float *positions, uint32_t vertex_count, const uint16_t *indices,
+                                          uint32_t index_count, const float model[16], uint32_t stride) {
+    Impl &impl = *pimpl_;
+    if (!impl.enabled)
+        return;
+    int64_t start = now();
+    float mvp[16];
+    if (model != nullptr)
+        multiply(impl.viewProjection, model, mvp);
+    else
+        std::copy(impl.viewProjection, impl.viewProjection + 16, mvp);
+
+    if (stride == 0)
+        stride = 3 * sizeof(float);
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(positions);
+    Vector<ClipVertex> &clip = impl.clip;
+    clip.resize(vertex_count);
+    for (uint32_t i = 0; i < vertex_count; ++i) {
+        const float *p = reinterpret_cast<const float*>(bytes + static_cast<size_t>(i) * stride);
+        clip[i] = transform(mvp, p[0], p[1], p[2]);
+    }
+    for (uint32_t i = 0; i + 2 < index_count; i += 3) {
+        if (indices[i] < vertex_count && indices[i + 1] < vertex_count && indices[i + 2] < vertex_count)
+            impl.addTriangle(clip[indices[i]], clip[indices[i + 1]], clip[indices[i + 2]]);
+    }
+    ++impl.stats.occluders;
+    impl.stats.rasterMs += (now() - start) / 1.0e6f;
+}
+
+
+LYS_API void OcclusionCuller::addOccluder(const Box3Df &box) {
+    // Corner i has the maximum coordinate on the axes whose bit is set
+    static const uint16_t kIndices[36] = {
+        0, 2, 1, 1, 2, 3,   // -Z
+        4, 5, 6, 5, 7, 6,   // +Z
+        0, 1, 4, 1, 5, 4,   // -Y
+        2, 6, 3, 3, 6, 7,   // +Y
+        0, 4, 2, 2, 4, 6,   // -X
+        1, 3, 5, 3, 7, 5    // +X
+    };
+    float corners[24];
+    for (int i = 0; i < 8; ++i) {
+        corners[i * 3] = (i & 1) ? box.max().x() : box.min().x();
+        corners[i * 3 + 1] = (i & 2) ? box.max().y() : box.min().y();
+        corners[i * 3 + 2] = (i & 4) ? box.max().z() : box.min().z();
+    }
+    addOccluder(corners, 8, kIndices, 36);
+}
+
+
+LYS_API void OcclusionCuller::rasterize() {
+    Impl &impl = *pimpl_;
+    if (!impl.enabled)
+        return;
+    LYS_PROFILE_ZONE("Occlusion rasterize");
+    int64_t start = now();
+    impl.nextTile = 0;
+    if (!impl.threads.empty()) {
+        std::lock_guard<std::mutex> lock(impl.mutex);
+        impl.busy = static_cast<uint32_t>(impl.threads.size());
+        ++impl.generation;
+    }
+    impl.wake.notify_all();
+    impl.runTiles();
+    if (!impl.threads.empty()) {
+        std::unique_lock<std::mutex> lock(impl.mutex);
+        impl.done.wait(lock, [&] { return impl.busy == 0; });
+    }
+    impl.stats.rasterMs += (now() - start) / 1.0e6f;
+}
+
+
+LYS_API bool OcclusionCuller::isVisible(const Box3Df &box) {
+    Impl &impl = *pimpl_;
+    if (!impl.enabled)
+        return true;
+    int64_t start = now();
+    bool visible = impl.test(box);
+    ++impl.stats.tested;
+    if (!visible) {
+        ++impl.stats.culled;
+        Profiler::global().count(impl.culledCounter);
+    }
+    impl.stats.testMs += (now() - start) / 1.0e6f;
+    return visible;
+}
+
+
+LYS_API uint32_t OcclusionCuller::cull(const Box3Df *boxes, size_t count, uint8_t *visible) {
+    Impl &impl = *pimpl_;
+    if (!impl.enabled) {
+        std::fill(visible, visible + count, static_cast<uint8_t>(1));
+        return static_cast<uint32_t>(count);
+    }
+    LYS_PROFILE_ZONE("Occlusion test");
+    int64_t start = now();
+    uint32_t visible_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        visible[i] = impl.test(boxes[i]) ? 1 : 0;
+        visible_count += visible[i];
+    }
+    uint32_t culled = static_cast<uint32_t>(count) - visible_count;
+    impl.stats.tested += static_cast<uint32_t>(count);
+    impl.stats.culled += culled;
+    Profiler::global().count(impl.culledCounter, culled);
+    impl.stats.testMs += (now() - start) / 1.0e6f;
+    return visible_count;
+}
+
+
+LYS_API const float* OcclusionCuller::depth() const {
+    return pimpl_->depth.data();
+}
+
+
+LYS_API const OcclusionStats& OcclusionCuller::stats() const {
+    return pimpl_->stats;
+}
+}
@@ -0,0 +1,294 @@
+/***************************************************
+* OffsetAllocator.cc: TLSF range sub-allocation    *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "OffsetAllocator.h"
+
+#include <string.h>
+
+#include "config.h"
+#include "types.h"
+
+namespace lys3d {
+namespace {
+const uint32_t kMantissaBits = 3;
+const uint32_t kMantissaValue = 1 << kMantissaBits;
+const uint32_t kMantissaMask = kMantissaValue - 1;
+
+uint32_t highestBit(uint32_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 31 - static_cast<uint32_t>(__builtin_clz(value));
+#else
+    uint32_t bit = 0;
+    while (value >>= 1)
+        ++bit;
+    return bit;
+#endif
+}
+
+uint32_t lowestBit(uint32_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<uint32_t>(__builtin_ctz(value));
+#else
+    uint32_t bit = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+// Size classes as 5.3 floats. Allocations round up, so any range in the bin
+// found is big enough; free ranges round down, so they fit their bin's class.
+uint32_t binRoundUp(uint32_t size) {
+    if (size < kMantissaValue)
+        return size;
+    uint32_t start = highestBit(size) - kMantissaBits;
+    uint32_t bin = ((start + 1) << kMantissaBits) + ((size >> start) & kMantissaMask);
+    if (size & ((1u << start) - 1))
+        ++bin;  // Carries into the exponent when the mantissa overflows
+    return bin;
+}
+
+uint32_t binRoundDown(uint32_t size) {
+    if (size < kMantissaValue)
+        return size;
+    uint32_t start = highestBit(size) - kMantissaBits;
+    return ((start + 1) << kMantissaBits) | ((size >> start) & kMantissaMask);
+}
+}
+
+
+LYS_API OffsetAllocator::OffsetAllocator(uint32_t size, uint32_t max_allocations) {
+    size_ = size;
+    maxAllocations_ = max_allocations;
+    reset();
+}
+
+
+LYS_API void OffsetAllocator::reset() {
+    freeSize_ = 0;
+    allocationCount_ = 0;
+    topMask_ = 0;
+    memset(leafMasks_, 0, sizeof(leafMasks_));
+    for (uint32_t &head : binHeads_)
+        head = kUnused;
+
+    // Free ranges never outnumber allocations by more than one
+    uint32_t node_count = maxAllocations_ * 2 + 1;
+    nodes_.assign(node_count, Node());
+    freeNodes_.resize(node_count);
+    for (uint32_t i = 0; i < node_count; ++i)
+        freeNodes_[i] = node_count - 1 - i;
+
+    if (size_ > 0)
+        insertFree(0, size_);
+}
+
+
+LYS_API OffsetAllocation OffsetAllocator::allocate(uint32_t size) {
+    OffsetAllocation allocation;
+    allocation.offset = 0;
+    allocation.size = 0;
+    allocation.node = OffsetAllocation::kNoSpace;
+    if (size == 0 || size > freeSize_ || allocationCount_ == maxAllocations_)
+        return allocation;
+
+    // First non-empty bin at or above the rounded-up size class
+    uint32_t min_bin = binRoundUp(size);
+    uint32_t top = min_bin >> kMantissaBits;
+    uint32_t leaf_mask = top < kTopBins ? leafMasks_[top] & (0xFFu << (min_bin & kMantissaMask)) : 0;
+    uint32_t top_mask = top + 1 < kTopBins ? topMask_ & (0xFFFFFFFFu << (top + 1)) : 0;
+    uint32_t index = kUnused;
+    if (leaf_mask != 0) {
+        index = binHeads_[(top << kMantissaBits) | lowestBit(leaf_mask)];
+    } else if (top_mask != 0) {
+        top = lowestBit(top_mask);
+        index = binHeads_[(top << kMantissaBits) | lowestBit(leafMasks_[top])];
+    } else {
+        // Last resort: the bin below may still hold a range that fits
+        // (e.g. an exact fit for a size between two classes)
+        for (uint32_t i = binHeads_[binRoundDown(size)]; i != kUnused; i = nodes_[i].binNext) {
+            if (nodes_[i].size >= size) {
+                index = i;
+                break;
+            }
+        }
+        if (index == kUnused)
+            return allocation;
+    }
+
+    removeFree(index);
+    Node &node = nodes_[index];
+    uint32_t remainder = node.size - size;
+    node.size = size;
+    node.used = true;
+    ++allocationCount_;
+
+    // Give the tail back as a free range, linked in after this one
+    if (remainder > 0) {
+        uint32_t split = insertFree(node.offset + size, remainder);
+        nodes_[split].neighborPrev = index;
+        nodes_[split].neighborNext = node.neighborNext;
+        if (node.neighborNext != kUnused)
+            nodes_[node.neighborNext].neighborPrev = split;
+        node.neighborNext = split;
+    }
+
+    allocation.offset = nodes_[index].offset;
+    allocation.size = size;
+    allocation.node = index;
+    return allocation;
+}
+
+
+LYS_API void OffsetAllocator::free(const OffsetAllocation &allocation) {
+    if (!allocation.isValid() || allocation.node >= nodes_.size() || !nodes_[allocation.node].used)
+        return;
+
+    uint32_t index = allocation.node;
+    uint32_t offset = nodes_[index].offset, size = nodes_[index].size;
+    uint32_t prev = nodes_[index].neighborPrev, next = nodes_[index].neighborNext;
+    --allocationCount_;
+
+    // Swallow free neighbours, then reinsert the merged range in their place
+    if (prev != kUnused && !nodes_[prev].used) {
+        offset = nodes_[prev].offset;
+        size += nodes_[prev].size;
+        removeFree(prev);
+        uint32_t before = nodes_[prev].neighborPrev;
+        freeNodes_.push_back(prev);
+        prev = before;
+    }
+    if (next != kUnused && !nodes_[next].used) {
+        size += nodes_[next].size;
+        removeFree(next);
+        uint32_t after = nodes_[next].neighborNext;
+        freeNodes_.push_back(next);
+        next = after;
+    }
+    freeNodes_.push_back(index);
+
+    uint32_t merged = insertFree(offset, size);
+    nodes_[merged].neighborPrev = prev;
+    nodes_[merged].neighborNext = next;
+    if (prev != kUnused)
+        nodes_[prev].neighborNext = merged;
+    if (next != kUnused)
+        nodes_[next].neighborPrev = merged;
+}
+
+
+LYS_API OffsetAllocation OffsetAllocator::slideDown(const OffsetAllocation &allocation) {
+    if (!allocation.isValid() || allocation.node >= nodes_.size() || !nodes_[allocation.node].used)
+        return allocation;
+    uint32_t index = allocation.node;
+    Node &node = nodes_[index];
+    uint32_t prev = node.neighborPrev;
+    if (prev == kUnused || nodes_[prev].used)
+        return allocation;
+
+    // The gap moves from before the allocation to after it
+    uint32_t gap = nodes_[prev].size;
+    node.offset = nodes_[prev].offset;
+    removeFree(prev);
+    uint32_t before = nodes_[prev].neighborPrev;
+    freeNodes_.push_back(prev);
+    node.neighborPrev = before;
+    if (before != kUnused)
+        nodes_[before].neighborNext = index;
+
+    uint32_t next = node.neighborNext;
+    if (next != kUnused && !nodes_[next].used) {
+        gap += nodes_[next].size;
+        removeFree(next);
+        uint32_t after = nodes_[next].neighborNext;
+        freeNodes_.push_back(next);
+        next = after;
+    }
+    uint32_t free_node = insertFree(node.offset + node.size, gap);
+    node.neighborNext = free_node;
+    nodes_[free_node].neighborPrev = index;
+    nodes_[free_node].neighborNext = next;
+    if (next != kUnused)
+        nodes_[next].neighborPrev = free_node;
+
+    OffsetAllocation moved = allocation;
+    moved.offset = node.offset;
+    return moved;
+}
+
+
+LYS_API uint32_t OffsetAllocator::largestFree() const {
+    if (topMask_ == 0)
+        return 0;
+    uint32_t top = highestBit(topMask_);
+    uint32_t bin = (top << kMantissaBits) | highestBit(leafMasks_[top]);
+    // Ranges in a bin can be up to one size class apart, so check them all
+    uint32_t largest = 0;
+    for (uint32_t index = binHeads_[bin]; index != kUnused; index = nodes_[index].binNext) {
+        if (nodes_[index].size > largest)
+            largest = nodes_[index].size;
+    }
+    return largest;
+}
+
+
+LYS_API float OffsetAllocator::fragmentation() const {
+    if (freeSize_ == 0)
+        return 0.0f;
+    return 1.0f - static_cast<float>(largestFree()) / static_cast<float>(freeSize_);
+}
+
+
+uint32_t OffsetAllocator::insertFree(uint32_t offset, uint32_t size) {
+    uint32_t index = freeNodes_.back();
+    freeNodes_.pop_back();
+
+    uint32_t bin = binRoundDown(size);
+    uint32_t top = bin >> kMantissaBits;
+    topMask_ |= 1u << top;
+    leafMasks_[top] |= static_cast<uint8_t>(1u << (bin & kMantissaMask));
+
+    Node &node = nodes_[index];
+    node.offset = offset;
+    node.size = size;
+    node.used = false;
+    node.binPrev = kUnused;
+    node.binNext = binHeads_[bin];
+    node.neighborPrev = kUnused;
+    node.neighborNext = kUnused;
+    if (node.binNext != kUnused)
+        nodes_[node.binNext].binPrev = index;
+    binHeads_[bin] = index;
+    freeSize_ += size;
+    return index;
+}
+
+
+void OffsetAllocator::removeFree(uint32_t index) {
+    Node &node = nodes_[index];
+    if (node.binPrev != kUnused) {
+        nodes_[node.binPrev].binNext = node.binNext;
+    } else {
+        uint32_t bin = binRoundDown(node.size);
+        binHeads_[bin] = node.binNext;
+        if (node.binNext == kUnused) {
+            uint32_t top = bin >> kMantissaBits;
+            leafMasks_[top] &= static_cast<uint8_t>(~(1u << (bin & kMantissaMask)));
+            if (leafMasks_[top] == 0)
+                topMask_ &= ~(1u << top);
+        }
+    }
+    if (node.binNext != kUnused)
+        nodes_[node.binNext].binPrev = node.binPrev;
+    freeSize_ -= node.size;
+}
+}
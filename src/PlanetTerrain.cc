@@ -0,0 +1,883 @@
+/***************************************************
+* PlanetTerrain.cc: Cube-sphere quadtree terrain   *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "PlanetTerrain.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "GLES2/gl2.h"
+#include "config.h"
+#include "types.h"
+#include "Profiler.h"
+#include "ResourceRegistry.h"
+
+namespace lys3d {
+namespace {
+const double kPi = 3.14159265358979323846;
+
+// Points kept per node for bounds and horizon tests: the corners, the edge
+// midpoints and the center
+const int kBoundPoints = 9;
+
+// Each face's outward normal and the directions u and v run along;
+// s x t = n, so grid triangles wind counter-clockwise seen from outside
+struct FaceAxes {
+    double n[3], s[3], t[3];
+};
+
+const FaceAxes kFaces[6] = {
+    {{1, 0, 0}, {0, 0, -1}, {0, 1, 0}},
+    {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+    {{0, 1, 0}, {1, 0, 0}, {0, 0, -1}},
+    {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}},
+    {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}},
+    {{0, 0, -1}, {-1, 0, 0}, {0, 1, 0}},
+};
+
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double length(const double v[3]) {
+    return sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+// Unit direction for face coordinates u and v in [-1, 1]; the tangent warp
+// spreads vertices evenly in angle instead of bunching them up at the
+// middle of each face
+void faceDirection(uint32_t face, double u, double v, double out[3]) {
+    const FaceAxes &axes = kFaces[face];
+    double a = tan(u * kPi * 0.25), b = tan(v * kPi * 0.25);
+    for (int c = 0; c < 3; ++c)
+        out[c] = axes.n[c] + axes.s[c] * a + axes.t[c] * b;
+    double inv = 1.0 / length(out);
+    for (int c = 0; c < 3; ++c)
+        out[c] *= inv;
+}
+
+// Grid indices around a chunk's border, counter-clockwise seen from outside
+void borderLoop(uint32_t size, Vector<uint16_t> *loop) {
+    loop->clear();
+    for (uint32_t i = 0; i < size - 1; ++i)
+        loop->push_back(static_cast<uint16_t>(i));
+    for (uint32_t j = 0; j < size - 1; ++j)
+        loop->push_back(static_cast<uint16_t>(j * size + size - 1));
+    for (uint32_t i = size - 1; i > 0; --i)
+        loop->push_back(static_cast<uint16_t>((size - 1) * size + i));
+    for (uint32_t j = size - 1; j > 0; --j)
+        loop->push_back(static_cast<uint16_t>(j * size));
+}
+
+// Integer lattice hash for value noise, to [-1, 1]
+double latticeValue(int32_t x, int32_t y, int32_t z, uint32_t seed) {
+    uint32_t h = seed * 0x9E3779B9u;
+    h ^= static_cast<uint32_t>(x) * 0x85EBCA6Bu;
+    h = (h << 13) | (h >> 19);
+    h ^= static_cast<uint32_t>(y) * 0xC2B2AE35u;
+    h = (h << 13) | (h >> 19);
+    h ^= static_cast<uint32_t>(z) * 0x27D4EB2Fu;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return h * (2.0 / 4294967295.0) - 1.0;
+}
+
+double valueNoise(double x, double y, double z, uint32_t seed) {
+    double fx = floor(x), fy = floor(y), fz = floor(z);
+    int32_t ix = static_cast<int32_t>(fx), iy = static_cast<int32_t>(fy), iz = static_cast<int32_t>(fz);
+    double tx = x - fx, ty = y - fy, tz = z - fz;
+    tx = tx * tx * (3.0 - 2.0 * tx);
+    ty = ty * ty * (3.0 - 2.0 * ty);
+    tz = tz * tz * (3.0 - 2.0 * tz);
+    double plane[2];
+    for (int dz = 0; dz < 2; ++dz) {
+        double v00 = latticeValue(ix, iy, iz + dz, seed), v10 = latticeValue(ix + 1, iy, iz + dz, seed);
+        double v01 = latticeValue(ix, iy + 1, iz + dz, seed), v11 = latticeValue(ix + 1, iy + 1, iz + dz, seed);
+        double a = v00 + (v10 - v00) * tx, b = v01 + (v11 - v01) * tx;
+        plane[dz] = a + (b - a) * ty;
+    }
+    return plane[0] + (plane[1] - plane[0]) * tz;
+}
+
+// Is a point hidden behind a sphere of the given radius, seen from the
+// camera? Both relative to the sphere's center
+bool belowHorizon(const double camera[3], double radius, const double point[3]) {
+    double cv[3], vt[3];
+    for (int c = 0; c < 3; ++c) {
+        cv[c] = camera[c] / radius;
+        vt[c] = point[c] / radius - cv[c];
+    }
+    double horizon = cv[0] * cv[0] + cv[1] * cv[1] + cv[2] * cv[2] - 1.0;
+    if (horizon <= 0.0)
+        return false;
+    double along = -(vt[0] * cv[0] + vt[1] * cv[1] + vt[2] * cv[2]);
+    return along > horizon && along * along / (vt[0] * vt[0] + vt[1] * vt[1] + vt[2] * vt[2]) > horizon;
+}
+
+struct Node {
+    bool live;
+    bool pending;
+    uint8_t face;
+    uint8_t level;
+    uint32_t x, y;
+    uint32_t generation;
+    int32_t children;   // First of four consecutive nodes, or -1
+    int32_t slot;       // Cache slot holding the mesh, or -1
+    double origin[3];   // Center of the chunk at height 0
+    double radius;      // Bounding sphere around origin
+    double lowest;      // Height range covered by the bounds
+    double highest;
+    double spacing;     // Distance between vertices
+    double error;       // Geometric error of the mesh
+    double bounds[kBoundPoints][3];  // Bound points at the top height
+};
+
+struct Job {
+    int32_t node;
+    uint32_t generation;
+    uint8_t face;
+    uint8_t level;
+    uint32_t x, y;
+    double origin[3];
+    double skirt;
+    PlanetHeightFunc height;
+    void *userData;
+};
+
+struct Result {
+    int32_t node;
+    uint32_t generation;
+    double lowest;
+    double highest;
+    Vector<uint8_t> vertices;
+};
+
+struct Slot {
+    int32_t node;
+    uint32_t buffer;
+    uint64_t lastUsed;
+    bool dirty;
+    Vector<uint8_t> data;
+};
+
+struct Candidate {
+    int32_t node;
+    double priority;
+
+    // Sorts the most urgent first
+    bool operator<(const Candidate &other) const {
+        return priority > other.priority;
+    }
+};
+}
+
+
+struct PlanetTerrain::Impl {
+    explicit Impl(const PlanetSettings &planet_settings) {
+        settings = planet_settings;
+        settings.chunkSize = std::max(3u, std::min(settings.chunkSize, 129u));
+        settings.maxLevel = std::min(settings.maxLevel, 30u);
+        settings.cacheSize = std::max(6u, std::min(settings.cacheSize, 65535u));
+        settings.uploadsPerFrame = std::max(1u, settings.uploadsPerFrame);
+        settings.maxPending = std::max(1u, settings.maxPending);
+        layout.add(kAttribPosition, 3, VertexFormat::kFloat).add(kAttribNormal, 3, VertexFormat::kShortNorm);
+        uint32_t size = settings.chunkSize;
+        borderLoop(size, &border);
+        vertexCount = size * size + static_cast<uint32_t>(border.size());
+        buildIndices();
+
+        height = &PlanetTerrain::noiseHeight;
+        userData = &defaultNoise;
+        threshold = 2.0f;
+        projScale = 0.0f;
+        frame = 0;
+        liveNodes = 0;
+        outstanding = 0;
+        indexBuffer = 0;
+        hasFrustum = false;
+        memset(frustum, 0, sizeof(frustum));
+        memset(camera, 0, sizeof(camera));
+        Slot empty;
+        empty.node = -1;
+        empty.buffer = 0;
+        empty.lastUsed = 0;
+        empty.dirty = false;
+        slots.assign(settings.cacheSize, empty);
+        for (uint32_t face = 0; face < 6; ++face)
+            initNode(allocate(1), static_cast<uint8_t>(face), 0, 0, 0, -settings.maxHeight, settings.maxHeight);
+
+        Profiler &profiler = Profiler::global();
+        drawnCounter = profiler.counter("Terrain chunks drawn", false);
+        builtCounter = profiler.counter("Terrain chunks uploaded");
+        building = 0;
+        quit = false;
+        for (uint32_t i = 0; i < settings.workers; ++i)
+            threads.push_back(std::thread(&Impl::workerMain, this));
+    }
+
+    ~Impl() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    void buildIndices() {
+        uint32_t size = settings.chunkSize;
+        for (uint32_t j = 0; j + 1 < size; ++j) {
+            for (uint32_t i = 0; i + 1 < size; ++i) {
+                uint16_t a = static_cast<uint16_t>(j * size + i), b = static_cast<uint16_t>(a + 1);
+                uint16_t c = static_cast<uint16_t>(a + size), d = static_cast<uint16_t>(c + 1);
+                uint16_t quad[6] = {a, b, d, a, d, c};
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+        // Skirts: a wall hanging down from each border edge, facing out
+        uint32_t count = static_cast<uint32_t>(border.size());
+        for (uint32_t k = 0; k < count; ++k) {
+            uint16_t a = border[k], b = border[(k + 1) % count];
+            uint16_t sa = static_cast<uint16_t>(size * size + k);
+            uint16_t sb = static_cast<uint16_t>(size * size + (k + 1) % count);
+            uint16_t quad[6] = {a, sa, b, b, sa, sb};
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+
+    // Nodes are allocated in blocks (one root, or four siblings)
+    int32_t allocate(uint32_t count) {
+        int32_t first;
+        if (count == 4 && !freeBlocks.empty()) {
+            first = freeBlocks.back();
+            freeBlocks.pop_back();
+        } else {
+            first = static_cast<int32_t>(nodes.size());
+            Node node;
+            memset(&node, 0, sizeof(node));
+            nodes.resize(nodes.size() + count, node);
+        }
+        liveNodes += count;
+        return first;
+    }
+
+    void initNode(int32_t index, uint8_t face, uint8_t level, uint32_t x, uint32_t y, double lowest,
+                  double highest) {
+        Node &node = nodes[index];
+        node.live = true;
+        node.pending = false;
+        node.face = face;
+        node.level = level;
+        node.x = x;
+        node.y = y;
+        ++node.generation;
+        node.children = -1;
+        node.slot = -1;
+
+        double cells = static_cast<double>(1u << level), size = 2.0 / cells;
+        double center[3];
+        faceDirection(face, -1.0 + (x + 0.5) * size, -1.0 + (y + 0.5) * size, center);
+        for (int c = 0; c < 3; ++c)
+            node.origin[c] = center[c] * settings.radius;
+
+        // Coarse meshes miss terrain features and cut through the curve of
+        // the sphere; both shrink with the vertex spacing
+        double angle = kPi * 0.5 / cells / (settings.chunkSize - 1);
+        node.spacing = angle * settings.radius;
+        double sag = settings.radius * (1.0 - cos(angle * 0.5));
+        node.error = std::min(settings.roughness * node.spacing, 2.0 * settings.maxHeight) + sag;
+        bound(&node, lowest, highest);
+    }
+
+    // Fit the bounds to a height range: the whole range until something
+    // is known, then what the node's (or its parent's) mesh measured
+    void bound(Node *node, double lowest, double highest) {
+        node->lowest = std::max(lowest, -settings.maxHeight);
+        node->highest = std::min(highest, settings.maxHeight);
+        double cells = static_cast<double>(1u << node->level), size = 2.0 / cells;
+        double u0 = -1.0 + node->x * size, v0 = -1.0 + node->y * size;
+        double top = settings.radius + node->highest, bottom = settings.radius + node->lowest;
+        node->radius = 0.0;
+        for (int p = 0; p < kBoundPoints; ++p) {
+            double dir[3];
+            faceDirection(node->face, u0 + size * 0.5 * (p % 3), v0 + size * 0.5 * (p / 3), dir);
+            double up[3], down[3];
+            for (int c = 0; c < 3; ++c) {
+                node->bounds[p][c] = dir[c] * top;
+                up[c] = node->bounds[p][c] - node->origin[c];
+                down[c] = dir[c] * bottom - node->origin[c];
+            }
+            node->radius = std::max(node->radius, std::max(length(up), length(down)));
+        }
+        // Edges bulge between the sampled points on coarse levels
+        node->radius *= 1.1;
+    }
+
+    void freeNode(int32_t index) {
+        Node &node = nodes[index];
+        if (node.children >= 0)
+            collapse(index);
+        if (node.slot >= 0)
+            slots[node.slot].node = -1;
+        node.live = false;
+        node.slot = -1;
+        ++node.generation;  // Drops any mesh still being built
+        --liveNodes;
+    }
+
+    void collapse(int32_t index) {
+        int32_t first = nodes[index].children;
+        for (int32_t c = 0; c < 4; ++c)
+            freeNode(first + c);
+        nodes[index].children = -1;
+        freeBlocks.push_back(first);
+    }
+
+    void split(int32_t index) {
+        int32_t first = allocate(4);
+        Node &node = nodes[index];
+        uint8_t face = node.face, level = static_cast<uint8_t>(node.level + 1);
+        uint32_t x = node.x * 2, y = node.y * 2;
+        // Children can stray from their parent's heights by its error
+        double lowest = node.lowest - node.error, highest = node.highest + node.error;
+        node.children = first;
+        for (int32_t c = 0; c < 4; ++c)
+            initNode(first + c, face, level, x + (c & 1), y + (c >> 1), lowest, highest);
+    }
+
+    void touch(const Node &node) {
+        if (node.slot >= 0)
+            slots[node.slot].lastUsed = frame;
+    }
+
+    void request(int32_t index, double priority) {
+        const Node &node = nodes[index];
+        if (node.slot < 0 && !node.pending) {
+            Candidate candidate = {index, priority};
+            candidates.push_back(candidate);
+        }
+    }
+
+    bool culled(const Node &node, const double relative[3]) const {
+        if (node.level >= 2) {
+            double occluder = settings.radius - settings.maxHeight;
+            bool hidden = true;
+            for (int p = 0; p < kBoundPoints && hidden; ++p)
+                hidden = belowHorizon(camera, occluder, node.bounds[p]);
+            if (hidden)
+                return true;
+        }
+        if (hasFrustum) {
+            for (int p = 0; p < 6; ++p) {
+                const double *plane = frustum[p];
+                double d = plane[0] * relative[0] + plane[1] * relative[1] + plane[2] * relative[2] + plane[3];
+                if (d < -node.radius * length(plane))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    void emit(const Node &node, const double relative[3]) {
+        PlanetChunk chunk;
+        for (int c = 0; c < 3; ++c)
+            chunk.offset[c] = static_cast<float>(relative[c]);
+        chunk.face = node.face;
+        chunk.level = node.level;
+        chunk.slot = static_cast<uint16_t>(node.slot);
+        visible.push_back(chunk);
+        stats.deepestLevel = std::max<uint32_t>(stats.deepestLevel, node.level);
+    }
+
+    void visit(int32_t index) {
+        double relative[3];
+        for (int c = 0; c < 3; ++c)
+            relative[c] = nodes[index].origin[c] - camera[c];
+        if (culled(nodes[index], relative))
+            return;
+        touch(nodes[index]);
+        double distance = std::max(length(relative) - nodes[index].radius, 1.0e-3);
+        double error = nodes[index].error * projScale / distance;
+        if (error > threshold && nodes[index].level < settings.maxLevel) {
+            if (nodes[index].children < 0)
+                split(index);
+            // Only swap in the children once all four can be drawn
+            int32_t first = nodes[index].children;
+            bool ready = true;
+            for (int32_t c = 0; c < 4; ++c) {
+                touch(nodes[first + c]);
+                if (nodes[first + c].slot < 0) {
+                    request(first + c, error);
+                    ready = false;
+                }
+            }
+            if (ready || nodes[index].slot < 0) {
+                // Without a mesh of its own, draw whatever children there are
+                for (int32_t c = 0; c < 4; ++c) {
+                    if (ready || nodes[first + c].slot >= 0)
+                        visit(first + c);
+                }
+                if (ready)
+                    return;
+            }
+        } else if (nodes[index].children >= 0) {
+            // Hysteresis: keep the children (but nothing deeper) until well
+            // past the threshold
+            int32_t first = nodes[index].children;
+            if (error < threshold * 0.5f) {
+                collapse(index);
+            } else {
+                for (int32_t c = 0; c < 4; ++c) {
+                    if (nodes[first + c].children >= 0)
+                        collapse(first + c);
+                }
+            }
+        }
+        if (nodes[index].slot >= 0)
+            emit(nodes[index], relative);
+        else
+            request(index, error * 2.0);
+    }
+
+    void workerMain() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return quit || !queue.empty(); });
+            if (quit)
+                return;
+            Job job = queue.front();
+            queue.pop_front();
+            ++building;
+            lock.unlock();
+
+            Result result;
+            build(job, &result);
+
+            lock.lock();
+            results.push_back(std::move(result));
+            --building;
+            if (queue.empty() && building == 0)
+                idle.notify_all();
+        }
+    }
+
+    // Heights and positions are worked out in double precision, with a
+    // ring of extra samples so normals match along shared edges
+    void build(const Job &job, Result *result) const {
+        int32_t size = static_cast<int32_t>(settings.chunkSize), ring = size + 2;
+        double cells = static_cast<double>(1u << job.level), extent = 2.0 / cells;
+        double step = extent / (size - 1);
+        double u0 = -1.0 + job.x * extent, v0 = -1.0 + job.y * extent;
+        Vector<double> positions(static_cast<size_t>(ring) * ring * 3);
+        result->lowest = settings.maxHeight;
+        result->highest = -settings.maxHeight;
+        for (int32_t j = -1; j <= size; ++j) {
+            for (int32_t i = -1; i <= size; ++i) {
+                double dir[3];
+                faceDirection(job.face, u0 + i * step, v0 + j * step, dir);
+                double h = job.height(job.userData, dir);
+                result->lowest = std::min(result->lowest, h);
+                result->highest = std::max(result->highest, h);
+                double r = settings.radius + h;
+                double *p = &positions[((j + 1) * ring + (i + 1)) * 3];
+                for (int c = 0; c < 3; ++c)
+                    p[c] = dir[c] * r;
+            }
+        }
+
+        uint32_t stride = layout.stride();
+        uint16_t position_offset = layout.attributes()[0].offset, normal_offset = layout.attributes()[1].offset;
+        result->node = job.node;
+        result->generation = job.generation;
+        result->vertices.assign(static_cast<size_t>(vertexCount) * stride, 0);
+        uint8_t *out = result->vertices.data();
+        auto write = [&](uint32_t vertex, int32_t i, int32_t j, double drop) {
+            const double *p = &positions[((j + 1) * ring + (i + 1)) * 3];
+            const double *left = p - 3, *right = p + 3, *down = p - ring * 3, *up = p + ring * 3;
+            double du[3], dv[3], n[3];
+            for (int c = 0; c < 3; ++c) {
+                du[c] = right[c] - left[c];
+                dv[c] = up[c] - down[c];
+            }
+            n[0] = du[1] * dv[2] - du[2] * dv[1];
+            n[1] = du[2] * dv[0] - du[0] * dv[2];
+            n[2] = du[0] * dv[1] - du[1] * dv[0];
+            double inv = 1.0 / std::max(length(n), 1.0e-30), scale = 1.0 - drop / length(p);
+            float position[3];
+            int16_t normal[3];
+            for (int c = 0; c < 3; ++c) {
+                position[c] = static_cast<float>(p[c] * scale - job.origin[c]);
+                normal[c] = static_cast<int16_t>(lround(n[c] * inv * 32767.0));
+            }
+            memcpy(out + vertex * stride + position_offset, position, sizeof(position));
+            memcpy(out + vertex * stride + normal_offset, normal, sizeof(normal));
+        };
+        for (int32_t j = 0; j < size; ++j) {
+            for (int32_t i = 0; i < size; ++i)
+                write(static_cast<uint32_t>(j * size + i), i, j, 0.0);
+        }
+        for (uint32_t k = 0; k < border.size(); ++k)
+            write(static_cast<uint32_t>(size * size) + k, border[k] % size, border[k] / size, job.skirt);
+    }
+
+    void integrate() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (Result &result : results)
+                ready.push_back(std::move(result));
+            results.clear();
+        }
+        uint32_t taken = 0;
+        while (!ready.empty() && taken < settings.uploadsPerFrame) {
+            Result result = std::move(ready.front());
+            ready.pop_front();
+            --outstanding;
+            if (result.node >= static_cast<int32_t>(nodes.size()) || !nodes[result.node].live
+                || nodes[result.node].generation != result.generation)
+                continue;
+            Node &node = nodes[result.node];
+            node.pending = false;
+            bound(&node, result.lowest, result.highest);
+
+            // A free slot, or else the least recently used one that wasn't
+            // drawn last frame
+            int32_t best = -1;
+            for (uint32_t s = 0; s < slots.size(); ++s) {
+                const Slot &slot = slots[s];
+                if (slot.node < 0) {
+                    best = static_cast<int32_t>(s);
+                    break;
+                }
+                if (slot.lastUsed + 1 < frame && (best < 0 || slot.lastUsed < slots[best].lastUsed))
+                    best = static_cast<int32_t>(s);
+            }
+            if (best < 0) {
+                ++stats.cacheMisses;
+                continue;
+            }
+            Slot &slot = slots[best];
+            if (slot.node >= 0)
+                nodes[slot.node].slot = -1;
+            slot.node = result.node;
+            slot.lastUsed = frame;
+            slot.data.swap(result.vertices);
+            if (!slot.dirty)
+                dirty.push_back(static_cast<uint16_t>(best));
+            slot.dirty = true;
+            node.slot = best;
+            ++taken;
+        }
+        stats.uploads = taken;
+        Profiler::global().count(builtCounter, taken);
+    }
+
+    void queueJobs() {
+        // Don't build more than the slots not needed this frame can take
+        uint32_t spare = 0;
+        for (const Slot &slot : slots)
+            spare += (slot.node < 0 || slot.lastUsed < frame) ? 1 : 0;
+        uint32_t limit = std::min(settings.maxPending, spare);
+
+        std::sort(candidates.begin(), candidates.end());
+        uint32_t queued = 0;
+        for (const Candidate &candidate : candidates) {
+            Node &node = nodes[candidate.node];
+            if (!node.live || node.pending || node.slot >= 0)
+                continue;
+            if (outstanding >= limit) {
+                if (outstanding < settings.maxPending)
+                    ++stats.cacheMisses;
+                continue;
+            }
+            Job job;
+            job.node = candidate.node;
+            job.generation = node.generation;
+            job.face = node.face;
+            job.level = node.level;
+            job.x = node.x;
+            job.y = node.y;
+            memcpy(job.origin, node.origin, sizeof(job.origin));
+            job.skirt = node.spacing * 2.0;
+            job.height = height;
+            job.userData = userData;
+            node.pending = true;
+            ++outstanding;
+            ++queued;
+            if (threads.empty()) {
+                Result result;
+                build(job, &result);
+                ready.push_back(std::move(result));
+            } else {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(job);
+            }
+        }
+        if (queued > 0)
+            wake.notify_all();
+    }
+
+    PlanetSettings settings;
+    VertexLayout layout;
+    Vector<uint16_t> border;
+    Vector<uint16_t> indices;
+    uint32_t vertexCount;
+    PlanetHeightFunc height;
+    void *userData;
+    PlanetNoise defaultNoise;
+    float threshold;
+    float projScale;
+    uint64_t frame;
+    double camera[3];
+    double frustum[6][4];
+    bool hasFrustum;
+    Vector<Node> nodes;
+    Vector<int32_t> freeBlocks;
+    uint32_t liveNodes;
+    Vector<Slot> slots;
+    Vector<uint16_t> dirty;
+    uint32_t indexBuffer;
+    Vector<Candidate> candidates;
+    std::deque<Result> ready;
+    uint32_t outstanding;
+    Vector<PlanetChunk> visible;
+    PlanetStats stats;
+    uint32_t drawnCounter;
+    uint32_t builtCounter;
+
+    // Shared with the worker threads
+    Vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<Job> queue;
+    Vector<Result> results;
+    uint32_t building;
+    bool quit;
+};
+
+
+LYS_API PlanetTerrain::PlanetTerrain(const PlanetSettings &settings) {
+    pimpl_ = new Impl(settings);
+    projection(Dimension2Di32(1920, 1080), 1.0471976f);
+}
+
+
+LYS_API PlanetTerrain::~PlanetTerrain() {
+    destroy();
+    delete pimpl_;
+}
+
+
+LYS_API const PlanetSettings& PlanetTerrain::settings() const {
+    return pimpl_->settings;
+}
+
+
+LYS_API void PlanetTerrain::heightSource(PlanetHeightFunc func, void *user_data) {
+    pimpl_->height = func;
+    pimpl_->userData = user_data;
+}
+
+
+LYS_API float PlanetTerrain::threshold() const {
+    return pimpl_->threshold;
+}
+
+
+LYS_API void PlanetTerrain::threshold(float pixels) {
+    pimpl_->threshold = pixels;
+}
+
+
+LYS_API void PlanetTerrain::projection(const IWindow &window, float fov_y) {
+    projection(window.sizeInPixels(), fov_y);
+}
+
+
+LYS_API void PlanetTerrain::projection(const Dimension2Di32 &viewport, float fov_y) {
+    // Pixels covered by one world unit at distance 1
+    pimpl_->projScale = viewport.height() / (2.0f * tanf(fov_y * 0.5f));
+}
+
+
+LYS_API void PlanetTerrain::plan(const Point3Dd &camera, const float view_projection[16]) {
+    Impl &impl = *pimpl_;
+    LYS_PROFILE_ZONE("Terrain plan");
+    int64_t start = now();
+    ++impl.frame;
+    impl.stats.cacheMisses = 0;
+    impl.stats.deepestLevel = 0;
+    impl.integrate();
+
+    impl.camera[0] = camera.x();
+    impl.camera[1] = camera.y();
+    impl.camera[2] = camera.z();
+    impl.hasFrustum = view_projection != nullptr;
+    if (impl.hasFrustum) {
+        // Planes from the rows of the matrix: w + x, w - x, w + y, ...
+        for (int p = 0; p < 6; ++p) {
+            int row = p / 2;
+            double sign = (p & 1) ? -1.0 : 1.0;
+            for (int c = 0; c < 4; ++c)
+                impl.frustum[p][c] = view_projection[c * 4 + 3] + sign * view_projection[c * 4 + row];
+        }
+    }
+
+    impl.visible.clear();
+    impl.candidates.clear();
+    for (int32_t face = 0; face < 6; ++face)
+        impl.visit(face);
+    impl.queueJobs();
+
+    uint32_t resident = 0;
+    for (const Slot &slot : impl.slots)
+        resident += slot.node >= 0 ? 1 : 0;
+    impl.stats.chunksDrawn = static_cast<uint32_t>(impl.visible.size());
+    impl.stats.nodes = impl.liveNodes;
+    impl.stats.resident = resident;
+    impl.stats.pending = impl.outstanding;
+    impl.stats.planMs = (now() - start) / 1.0e6f;
+    Profiler::global().set(impl.drawnCounter, impl.stats.chunksDrawn);
+}
+
+
+LYS_API void PlanetTerrain::upload() {
+    Impl &impl = *pimpl_;
+    LYS_PROFILE_ZONE("Terrain upload");
+    int64_t start = now();
+    ResourceRegistry &registry = ResourceRegistry::global();
+    if (impl.indexBuffer == 0) {
+        glGenBuffers(1, &impl.indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, impl.indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(impl.indices.size() * sizeof(uint16_t)),
+                     impl.indices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        registry.track(GpuResourceType::kBuffer, impl.indexBuffer, impl.indices.size() * sizeof(uint16_t));
+    }
+    for (uint16_t index : impl.dirty) {
+        Slot &slot = impl.slots[index];
+        if (!slot.dirty)
+            continue;
+        GLsizeiptr bytes = static_cast<GLsizeiptr>(slot.data.size());
+        if (slot.buffer == 0) {
+            glGenBuffers(1, &slot.buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, slot.buffer);
+            glBufferData(GL_ARRAY_BUFFER, bytes, slot.data.data(), GL_STATIC_DRAW);
+            registry.track(GpuResourceType::kBuffer, slot.buffer, slot.data.size());
+        } else {
+            // Same size every time, so the buffer is reused as is
+            glBindBuffer(GL_ARRAY_BUFFER, slot.buffer);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, slot.data.data());
+        }
+        slot.dirty = false;
+        Vector<uint8_t>().swap(slot.data);
+    }
+    impl.dirty.clear();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    impl.stats.uploadMs = (now() - start) / 1.0e6f;
+}
+
+
+LYS_API void PlanetTerrain::update(const Point3Dd &camera, const float view_projection[16]) {
+    plan(camera, view_projection);
+    upload();
+}
+
+
+LYS_API void PlanetTerrain::finish() {
+    Impl &impl = *pimpl_;
+    std::unique_lock<std::mutex> lock(impl.mutex);
+    impl.idle.wait(lock, [&] { return impl.queue.empty() && impl.building == 0; });
+}
+
+
+LYS_API const Vector<PlanetChunk>& PlanetTerrain::visible() const {
+    return pimpl_->visible;
+}
+
+
+LYS_API const VertexLayout& PlanetTerrain::layout() const {
+    return pimpl_->layout;
+}
+
+
+LYS_API void PlanetTerrain::draw(int32_t offset_location) {
+    Impl &impl = *pimpl_;
+    if (impl.indexBuffer == 0 || impl.visible.empty())
+        return;
+    LYS_PROFILE_ZONE("Terrain draw");
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, impl.indexBuffer);
+    bool applied = false;
+    for (const PlanetChunk &chunk : impl.visible) {
+        const Slot &slot = impl.slots[chunk.slot];
+        if (slot.buffer == 0 || slot.dirty)
+            continue;
+        glBindBuffer(GL_ARRAY_BUFFER, slot.buffer);
+        if (applied) {
+            impl.layout.rebase(0);
+        } else {
+            impl.layout.apply();
+            applied = true;
+        }
+        glUniform3fv(offset_location, 1, chunk.offset);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(impl.indices.size()), GL_UNSIGNED_SHORT, nullptr);
+    }
+    if (applied)
+        impl.layout.disable();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+
+LYS_API void PlanetTerrain::destroy() {
+    Impl &impl = *pimpl_;
+    ResourceRegistry &registry = ResourceRegistry::global();
+    for (Slot &slot : impl.slots) {
+        registry.release(GpuResourceType::kBuffer, slot.buffer);
+        slot.buffer = 0;
+        if (slot.node >= 0)
+            impl.nodes[slot.node].slot = -1;
+        slot.node = -1;
+        slot.dirty = false;
+        Vector<uint8_t>().swap(slot.data);
+    }
+    impl.dirty.clear();
+    registry.release(GpuResourceType::kBuffer, impl.indexBuffer);
+    impl.indexBuffer = 0;
+    impl.visible.clear();
+}
+
+
+LYS_API const PlanetStats& PlanetTerrain::stats() const {
+    return pimpl_->stats;
+}
+
+
+LYS_API double PlanetTerrain::noiseHeight(void *user_data, const double direction[3]) {
+    const PlanetNoise &noise = *static_cast<const PlanetNoise*>(user_data);
+    double sum = 0.0, amplitude = noise.amplitude, frequency = noise.frequency;
+    for (uint32_t octave = 0; octave < noise.octaves; ++octave) {
+        sum += amplitude * valueNoise(direction[0] * frequency, direction[1] * frequency, direction[2] * frequency,
+                                      noise.seed + octave);
+        amplitude *= 0.5;
+        frequency *= 2.0;
+    }
+    return sum;
+}
+}
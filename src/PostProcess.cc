@@ -0,0 +1,431 @@
+/***************************************************
+* PostProcess.cc: Bloom, tonemapping and grading   *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "PostProcess.h"
+
+#include <algorithm>
+
+#include "GLES2/gl2.h"
+
+#include "config.h"
+#include "types.h"
+#include "ResourceRegistry.h"
+#include "ShaderProgram.h"
+#include "VertexLayout.h"
+
+namespace lys3d {
+namespace {
+enum PostStep : uint32_t {
+    kStepPrefilter,
+    kStepDownsample,
+    kStepUpsample,
+    kStepComposite,
+    kStepCount
+};
+
+const char* kFullscreenVS =
+    "attribute vec2 a_position;\n"
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "    v_texcoord = a_position * 0.5 + 0.5;\n"
+    "    gl_Position = vec4(a_position, 0.0, 1.0);\n"
+    "}\n";
+
+// Four bilinear taps one source texel off the center average a 4x4 block,
+// which is all a 2:1 reduction needs. With PREFILTER, the result is also
+// thresholded with a soft knee; u_curve = (threshold, threshold - knee,
+// 2 * knee, 0.25 / knee).
+const char* kDownsampleFS =
+    "uniform sampler2D u_source;\n"
+    "uniform vec2 u_texel;\n"
+    "#ifdef PREFILTER\n"
+    "uniform vec4 u_curve;\n"
+    "uniform float u_range;\n"
+    "#endif\n"
+    "varying vec2 v_texcoord;\n"
+    "vec3 tap(vec2 offset) {\n"
+    "    return texture2D(u_source, v_texcoord + offset * u_texel).rgb;\n"
+    "}\n"
+    "void main() {\n"
+    "    vec3 c = 0.25 * (tap(vec2(-1.0, -1.0)) + tap(vec2(1.0, -1.0))\n"
+    "                   + tap(vec2(-1.0, 1.0)) + tap(vec2(1.0, 1.0)));\n"
+    "#ifdef PREFILTER\n"
+    "    float b = max(c.r, max(c.g, c.b)) * u_range;\n"
+    "    float soft = clamp(b - u_curve.y, 0.0, u_curve.z);\n"
+    "    c *= max(soft * soft * u_curve.w, b - u_curve.x) / max(b, 0.0001);\n"
+    "#endif\n"
+    "    gl_FragColor = vec4(c, 1.0);\n"
+    "}\n";
+
+// A tent filter from four bilinear taps half a source texel off the center;
+// added onto the larger level by blending
+const char* kUpsampleFS =
+    "uniform sampler2D u_source;\n"
+    "uniform vec2 u_texel;\n"
+    "varying vec2 v_texcoord;\n"
+    "vec3 tap(vec2 offset) {\n"
+    "    return texture2D(u_source, v_texcoord + offset * u_texel).rgb;\n"
+    "}\n"
+    "void main() {\n"
+    "    vec3 c = 0.25 * (tap(vec2(-0.5, -0.5)) + tap(vec2(0.5, -0.5))\n"
+    "                   + tap(vec2(-0.5, 0.5)) + tap(vec2(0.5, 0.5)));\n"
+    "    gl_FragColor = vec4(c, 1.0);\n"
+    "}\n";
+
+// Everything after the bloom, in one pass; u_exposure includes sceneRange
+const char* kCompositeFS =
+    "uniform sampler2D u_scene;\n"
+    "uniform float u_exposure;\n"
+    "varying vec2 v_texcoord;\n"
+    "#ifdef BLOOM\n"
+    "uniform sampler2D u_bloom;\n"
+    "uniform float u_bloomIntensity;\n"
+    "#endif\n"
+    "#ifdef COLOR_GRADE\n"
+    "uniform vec3 u_lift;\n"
+    "uniform vec3 u_gamma;\n"
+    "uniform vec3 u_gain;\n"
+    "uniform vec2 u_grade;\n"
+    "#endif\n"
+    "#ifdef VIGNETTE\n"
+    "uniform vec3 u_vignette;\n"
+    "uniform float u_aspect;\n"
+    "#endif\n"
+    "void main() {\n"
+    "    vec3 c = texture2D(u_scene, v_texcoord).rgb;\n"
+    "#ifdef BLOOM\n"
+    "    c += texture2D(u_bloom, v_texcoord).rgb * u_bloomIntensity;\n"
+    "#endif\n"
+    "    c *= u_exposure;\n"
+    "#ifdef TONEMAP\n"
+    "    c = (c * (2.51 * c + 0.03)) / (c * (2.43 * c + 0.59) + 0.14);\n"
+    "#endif\n"
+    "#ifdef COLOR_GRADE\n"
+    "    c = clamp(c, 0.0, 1.0);\n"
+    "    c = pow(max(c * u_gain + u_lift * (1.0 - c), 0.0), u_gamma);\n"
+    "    c = mix(vec3(dot(c, vec3(0.2126, 0.7152, 0.0722))), c, u_grade.x);\n"
+    "    c = (c - 0.5) * u_grade.y + 0.5;\n"
+    "#endif\n"
+    "#ifdef VIGNETTE\n"
+    "    float d = length((v_texcoord - 0.5) * vec2(u_aspect, 1.0));\n"
+    "    c *= 1.0 - u_vignette.x * smoothstep(u_vignette.y, u_vignette.z, d);\n"
+    "#endif\n"
+    "    gl_FragColor = vec4(clamp(c, 0.0, 1.0), 1.0);\n"
+    "}\n";
+
+// One triangle covering the screen
+const float kTriangle[6] = {-1.0f, -1.0f, 3.0f, -1.0f, -1.0f, 3.0f};
+
+struct BloomProgram {
+    ShaderProgram program;
+    int32_t texel;
+    int32_t curve;  ///< Prefilter only
+    int32_t range;  ///< Prefilter only
+};
+
+struct CompositeProgram {
+    ShaderProgram program;
+    int32_t exposure;
+    int32_t bloomIntensity;
+    int32_t lift;
+    int32_t gamma;
+    int32_t gain;
+    int32_t grade;
+    int32_t vignette;
+    int32_t aspect;
+};
+
+Dimension2Di32 divide(const Dimension2Di32 &size, int32_t divisor) {
+    return Dimension2Di32(std::max(1, size.width() / divisor), std::max(1, size.height() / divisor));
+}
+}
+
+
+struct PostProcess::Impl {
+    struct Pass {
+        Impl *impl;
+        uint32_t step;
+    };
+
+    Impl() {
+        buffer = 0;
+        failed = false;
+        scene = 0;
+        half = 0;
+        quarter = 0;
+        output = 0;
+        for (uint32_t i = 0; i < kStepCount; ++i) {
+            passes[i].impl = this;
+            passes[i].step = i;
+        }
+        layout.add(kAttribPosition, 2, VertexFormat::kFloat);
+    }
+
+    static void run(const FrameGraph &graph, void *user_data) {
+        Pass *pass = static_cast<Pass*>(user_data);
+        pass->impl->draw(graph, pass->step);
+    }
+
+    bool build(BloomProgram *bloom, const char *fragment, const char *defines) {
+        ShaderProgram &program = bloom->program;
+        if (!program.build(kFullscreenVS, fragment, defines)) {
+            log = program.log();
+            failed = true;
+            return false;
+        }
+        program.use();
+        glUniform1i(program.uniformLocation("u_source"), 0);
+        bloom->texel = program.uniformLocation("u_texel");
+        bloom->curve = program.uniformLocation("u_curve");
+        bloom->range = program.uniformLocation("u_range");
+        return true;
+    }
+
+    bool buildBloom() {
+        if (downsample.program.isBuilt())
+            return true;
+        if (!build(&prefilter, kDownsampleFS, "#define PREFILTER 1\n")
+                || !build(&downsample, kDownsampleFS, "")
+                || !build(&upsample, kUpsampleFS, "")) {
+            prefilter.program.destroy();
+            downsample.program.destroy();
+            upsample.program.destroy();
+            return false;
+        }
+        return true;
+    }
+
+    CompositeProgram* buildComposite(uint32_t effects) {
+        CompositeProgram &composite = composites[effects & kPostAllEffects];
+        if (composite.program.isBuilt())
+            return &composite;
+        if (!composite.program.build(kFullscreenVS, kCompositeFS, PostProcess::defines(effects))) {
+            log = composite.program.log();
+            failed = true;
+            return nullptr;
+        }
+        ShaderProgram &program = composite.program;
+        program.use();
+        glUniform1i(program.uniformLocation("u_scene"), 0);
+        glUniform1i(program.uniformLocation("u_bloom"), 1);
+        composite.exposure = program.uniformLocation("u_exposure");
+        composite.bloomIntensity = program.uniformLocation("u_bloomIntensity");
+        composite.lift = program.uniformLocation("u_lift");
+        composite.gamma = program.uniformLocation("u_gamma");
+        composite.gain = program.uniformLocation("u_gain");
+        composite.grade = program.uniformLocation("u_grade");
+        composite.vignette = program.uniformLocation("u_vignette");
+        composite.aspect = program.uniformLocation("u_aspect");
+        return &composite;
+    }
+
+    bool createBuffer() {
+        if (buffer != 0)
+            return true;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(kTriangle), kTriangle, GL_STATIC_DRAW);
+        ResourceRegistry::global().track(GpuResourceType::kBuffer, buffer, sizeof(kTriangle));
+        return buffer != 0;
+    }
+
+    void useBloom(const BloomProgram &bloom, const Dimension2Di32 &size) {
+        bloom.program.use();
+        glUniform2f(bloom.texel, 1.0f / size.width(), 1.0f / size.height());
+    }
+
+    void draw(const FrameGraph &graph, uint32_t step) {
+        // Don't retry a failed build every frame
+        if (failed || !createBuffer())
+            return;
+        const PostSettings &s = frameSettings;
+        glDisable(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_SCISSOR_TEST);
+        glActiveTexture(GL_TEXTURE0);
+
+        if (step == kStepComposite) {
+            CompositeProgram *composite = buildComposite(s.effects);
+            if (composite == nullptr)
+                return;
+            composite->program.use();
+            glUniform1f(composite->exposure, s.exposure * s.sceneRange);
+            if (s.effects & kPostBloom) {
+                glUniform1f(composite->bloomIntensity, s.bloomIntensity);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, graph.texture(half));
+                glActiveTexture(GL_TEXTURE0);
+            }
+            if (s.effects & kPostColorGrade) {
+                float gamma[3];
+                for (int i = 0; i < 3; ++i)
+                    gamma[i] = 1.0f / std::max(s.gamma[i], 0.01f);
+                glUniform3fv(composite->lift, 1, s.lift);
+                glUniform3fv(composite->gamma, 1, gamma);
+                glUniform3fv(composite->gain, 1, s.gain);
+                glUniform2f(composite->grade, s.saturation, s.contrast);
+            }
+            if (s.effects & kPostVignette) {
+                Dimension2Di32 size = graph.size(output);
+                glUniform3f(composite->vignette, s.vignetteIntensity, s.vignetteRadius,
+                            s.vignetteRadius + std::max(s.vignetteSoftness, 0.001f));
+                glUniform1f(composite->aspect, static_cast<float>(size.width()) / std::max(1, size.height()));
+            }
+            glBindTexture(GL_TEXTURE_2D, graph.texture(scene));
+        } else {
+            if (!buildBloom())
+                return;
+            if (step == kStepPrefilter) {
+                useBloom(prefilter, graph.size(scene));
+                float knee = std::max(s.bloomKnee, 0.0001f);
+                glUniform4f(prefilter.curve, s.bloomThreshold, s.bloomThreshold - knee, 2.0f * knee, 0.25f / knee);
+                glUniform1f(prefilter.range, s.sceneRange);
+                glBindTexture(GL_TEXTURE_2D, graph.texture(scene));
+            } else if (step == kStepDownsample) {
+                useBloom(downsample, graph.size(half));
+                glBindTexture(GL_TEXTURE_2D, graph.texture(half));
+            } else {
+                useBloom(upsample, graph.size(quarter));
+                glBindTexture(GL_TEXTURE_2D, graph.texture(quarter));
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_ONE, GL_ONE);
+            }
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        layout.apply();
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        layout.disable();
+        glDisable(GL_BLEND);
+    }
+
+    PostSettings settings;
+    PostSettings frameSettings;
+    VertexLayout layout;
+    uint32_t buffer;
+    BloomProgram prefilter;
+    BloomProgram downsample;
+    BloomProgram upsample;
+    CompositeProgram composites[kPostAllEffects + 1];
+    String log;
+    bool failed;
+    FrameResource scene;
+    FrameResource half;
+    FrameResource quarter;
+    FrameResource output;
+    Pass passes[kStepCount];
+};
+
+
+LYS_API PostProcess::PostProcess(const PostSettings &settings) {
+    pimpl_ = new Impl();
+    pimpl_->settings = settings;
+}
+
+
+LYS_API PostProcess::~PostProcess() {
+    destroy();
+    delete pimpl_;
+}
+
+
+LYS_API const PostSettings& PostProcess::settings() const {
+    return pimpl_->settings;
+}
+
+
+LYS_API void PostProcess::settings(const PostSettings &settings) {
+    // A different permutation gets its own chance to build
+    if ((settings.effects & kPostAllEffects) != (pimpl_->settings.effects & kPostAllEffects))
+        pimpl_->failed = false;
+    pimpl_->settings = settings;
+}
+
+
+LYS_API uint32_t PostProcess::addPasses(FrameGraph &graph, FrameResource scene, FrameResource output) {
+    Impl &impl = *pimpl_;
+    impl.frameSettings = impl.settings;
+    impl.scene = scene;
+    impl.output = output;
+    uint32_t effects = impl.frameSettings.effects;
+
+    if (effects & kPostBloom) {
+        FrameTargetDesc desc;
+        desc.size = divide(graph.size(scene), 2);
+        impl.half = graph.create(desc);
+        desc.size = divide(graph.size(scene), 4);
+        impl.quarter = graph.create(desc);
+
+        uint32_t pass = graph.addPass("Bloom downsample (half)", Impl::run, &impl.passes[kStepPrefilter]);
+        graph.read(pass, scene);
+        graph.write(pass, impl.half);
+        pass = graph.addPass("Bloom downsample (quarter)", Impl::run, &impl.passes[kStepDownsample]);
+        graph.read(pass, impl.half);
+        graph.write(pass, impl.quarter);
+        pass = graph.addPass("Bloom upsample (half)", Impl::run, &impl.passes[kStepUpsample]);
+        graph.read(pass, impl.quarter);
+        graph.write(pass, impl.half);
+    }
+
+    uint32_t pass = graph.addPass("Post composite", Impl::run, &impl.passes[kStepComposite]);
+    graph.read(pass, scene);
+    if (effects & kPostBloom)
+        graph.read(pass, impl.half);
+    graph.write(pass, output);
+    return pass;
+}
+
+
+LYS_API bool PostProcess::prepare() {
+    Impl &impl = *pimpl_;
+    impl.failed = false;
+    if ((impl.settings.effects & kPostBloom) && !impl.buildBloom())
+        return false;
+    return impl.buildComposite(impl.settings.effects) != nullptr;
+}
+
+
+LYS_API void PostProcess::destroy() {
+    Impl &impl = *pimpl_;
+    impl.prefilter.program.destroy();
+    impl.downsample.program.destroy();
+    impl.upsample.program.destroy();
+    for (CompositeProgram &composite : impl.composites)
+        composite.program.destroy();
+    ResourceRegistry::global().release(GpuResourceType::kBuffer, impl.buffer);
+    impl.buffer = 0;
+    impl.failed = false;
+}
+
+
+LYS_API const String& PostProcess::log() const {
+    return pimpl_->log;
+}
+
+
+LYS_API String PostProcess::defines(uint32_t effects) {
+    String text;
+    if (effects & kPostBloom)
+        text += "#define BLOOM 1\n";
+    if (effects & kPostTonemap)
+        text += "#define TONEMAP 1\n";
+    if (effects & kPostColorGrade)
+        text += "#define COLOR_GRADE 1\n";
+    if (effects & kPostVignette)
+        text += "#define VIGNETTE 1\n";
+    return text;
+}
+
+
+LYS_API uint32_t PostProcess::passCount(uint32_t effects) {
+    return (effects & kPostBloom) ? static_cast<uint32_t>(kStepCount) : 1;
+}
+}
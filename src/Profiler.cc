@@ -0,0 +1,552 @@
+/***************************************************
+* Profiler.cc: Hierarchical CPU zones & counters   *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Profiler.h"
+
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "GLES2/gl2.h"
+#include "GLES2/gl2ext.h"
+
+#include "config.h"
+#include "types.h"
+
+namespace lys3d {
+namespace {
+const uint32_t kMaxCounters = 64;
+
+// Allocations are counted outside of any profiler, since operator new can
+// run before (or while) the global profiler is constructed.
+std::atomic<int64_t> gAllocations(0);
+
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// One zone at one place in the hierarchy. In a thread's tree, merged is
+// the matching node of the frame's combined tree, once endFrame() has
+// looked it up
+struct Node {
+    uint32_t zone;
+    int32_t parent;
+    uint32_t depth;
+    uint32_t calls;
+    int64_t total;
+    int64_t children;
+    int32_t merged;
+};
+
+// The zones one thread has entered. Only the owner enters and leaves, so
+// its lock is uncontended except while a frame begins or ends; nodes are
+// keyed by (parent node + 1) << 32 | zone
+struct ThreadTree {
+    std::thread::id thread;
+    std::mutex mutex;
+    Vector<Node> nodes;
+    std::unordered_map<uint64_t, int32_t> nodeMap;
+    int32_t current;
+};
+
+// Instances get serials rather than being told apart by address, which a
+// later instance could reuse
+std::atomic<uint64_t> gNextSerial(1);
+
+// The tree this thread last used, and whose it is. One entry suffices:
+// everything normally goes to the global profiler
+thread_local uint64_t tTreeOwner = 0;
+thread_local ThreadTree *tTree = nullptr;
+
+// Finds the node for zone under parent in nodes, creating it if needed
+int32_t findNode(Vector<Node> &nodes, std::unordered_map<uint64_t, int32_t> &node_map,
+                 uint32_t zone, int32_t parent) {
+    uint64_t key = (static_cast<uint64_t>(parent + 1) << 32) | zone;
+    auto found = node_map.find(key);
+    if (found != node_map.end())
+        return found->second;
+    Node created;
+    created.zone = zone;
+    created.parent = parent;
+    created.depth = parent >= 0 ? nodes[parent].depth + 1 : 0;
+    created.calls = 0;
+    created.total = 0;
+    created.children = 0;
+    created.merged = -1;
+    int32_t node = static_cast<int32_t>(nodes.size());
+    nodes.push_back(created);
+    node_map[key] = node;
+    return node;
+}
+
+void resetTimes(Vector<Node> &nodes) {
+    for (Node &node : nodes) {
+        node.calls = 0;
+        node.total = 0;
+        node.children = 0;
+    }
+}
+
+
+// GL call counting. The wrappers forward to the real entry points saved when
+// they were installed, so they cost one atomic add per call.
+std::atomic<int64_t> *gGLCounters = nullptr;
+Profiler *gGLProfiler = nullptr;
+
+inline void countGLCall(uint32_t counter, int64_t amount = 1) {
+    gGLCounters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+uint32_t bytesPerPixel(GLenum format, GLenum type) {
+    uint32_t channels = 4;
+    switch (format) {
+    case GL_ALPHA:
+    case GL_LUMINANCE:
+    case GL_DEPTH_COMPONENT:
+        channels = 1;
+        break;
+    case GL_LUMINANCE_ALPHA:
+        channels = 2;
+        break;
+    case GL_RGB:
+        channels = 3;
+        break;
+    }
+
+    switch (type) {
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+        return 2;
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT_OES:
+        return channels * 2;
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+        return channels * 4;
+    default:
+        return channels;
+    }
+}
+
+// Names are given without the gl prefix, which would expand to _glptr_gl*
+#define LYS_GL_HOOK(name, params, args, counting) \
+    PFN_gl##name real##name = nullptr; \
+    void GL_APIENTRY hook##name params { \
+        counting; \
+        real##name args; \
+    }
+#define LYS_GL_STATE_HOOK(name, params, args) \
+    LYS_GL_HOOK(name, params, args, countGLCall(kCounterStateChanges))
+
+LYS_GL_HOOK(DrawArrays, (GLenum mode, GLint first, GLsizei count), (mode, first, count),
+            countGLCall(kCounterDrawCalls))
+LYS_GL_HOOK(DrawElements, (GLenum mode, GLsizei count, GLenum type, const void *indices),
+            (mode, count, type, indices), countGLCall(kCounterDrawCalls))
+
+LYS_GL_STATE_HOOK(Enable, (GLenum cap), (cap))
+LYS_GL_STATE_HOOK(Disable, (GLenum cap), (cap))
+LYS_GL_STATE_HOOK(BlendFunc, (GLenum sfactor, GLenum dfactor), (sfactor, dfactor))
+LYS_GL_STATE_HOOK(BlendFuncSeparate, (GLenum srgb, GLenum drgb, GLenum salpha, GLenum dalpha),
+                  (srgb, drgb, salpha, dalpha))
+LYS_GL_STATE_HOOK(BlendEquation, (GLenum mode), (mode))
+LYS_GL_STATE_HOOK(DepthFunc, (GLenum func), (func))
+LYS_GL_STATE_HOOK(DepthMask, (GLboolean flag), (flag))
+LYS_GL_STATE_HOOK(ColorMask, (GLboolean r, GLboolean g, GLboolean b, GLboolean a), (r, g, b, a))
+LYS_GL_STATE_HOOK(CullFace, (GLenum mode), (mode))
+LYS_GL_STATE_HOOK(FrontFace, (GLenum mode), (mode))
+LYS_GL_STATE_HOOK(UseProgram, (GLuint program), (program))
+LYS_GL_STATE_HOOK(ActiveTexture, (GLenum texture), (texture))
+LYS_GL_STATE_HOOK(BindTexture, (GLenum target, GLuint texture), (target, texture))
+LYS_GL_STATE_HOOK(BindBuffer, (GLenum target, GLuint buffer), (target, buffer))
+LYS_GL_STATE_HOOK(BindFramebuffer, (GLenum target, GLuint framebuffer), (target, framebuffer))
+LYS_GL_STATE_HOOK(BindRenderbuffer, (GLenum target, GLuint renderbuffer), (target, renderbuffer))
+LYS_GL_STATE_HOOK(Viewport, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height))
+LYS_GL_STATE_HOOK(Scissor, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height))
+
+LYS_GL_HOOK(BufferData, (GLenum target, GLsizeiptr size, const void *data, GLenum usage),
+            (target, size, data, usage), if (data) countGLCall(kCounterUploadedBytes, size))
+LYS_GL_HOOK(BufferSubData, (GLenum target, GLintptr offset, GLsizeiptr size, const void *data),
+            (target, offset, size, data), countGLCall(kCounterUploadedBytes, size))
+LYS_GL_HOOK(TexImage2D, (GLenum target, GLint level, GLint internalformat, GLsizei width,
+                           GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels),
+            (target, level, internalformat, width, height, border, format, type, pixels),
+            if (pixels) countGLCall(kCounterUploadedBytes,
+                                    static_cast<int64_t>(width) * height * bytesPerPixel(format, type)))
+LYS_GL_HOOK(TexSubImage2D, (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width,
+                              GLsizei height, GLenum format, GLenum type, const void *pixels),
+            (target, level, xoffset, yoffset, width, height, format, type, pixels),
+            countGLCall(kCounterUploadedBytes, static_cast<int64_t>(width) * height * bytesPerPixel(format, type)))
+LYS_GL_HOOK(CompressedTexImage2D, (GLenum target, GLint level, GLenum internalformat, GLsizei width,
+                                     GLsizei height, GLint border, GLsizei size, const void *data),
+            (target, level, internalformat, width, height, border, size, data),
+            countGLCall(kCounterUploadedBytes, size))
+LYS_GL_HOOK(CompressedTexSubImage2D, (GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                                        GLsizei width, GLsizei height, GLenum format, GLsizei size,
+                                        const void *data),
+            (target, level, xoffset, yoffset, width, height, format, size, data),
+            countGLCall(kCounterUploadedBytes, size))
+
+#define LYS_GL_HOOK_LIST(X) \
+    X(DrawArrays) X(DrawElements) X(Enable) X(Disable) X(BlendFunc) \
+    X(BlendFuncSeparate) X(BlendEquation) X(DepthFunc) X(DepthMask) X(ColorMask) \
+    X(CullFace) X(FrontFace) X(UseProgram) X(ActiveTexture) X(BindTexture) \
+    X(BindBuffer) X(BindFramebuffer) X(BindRenderbuffer) X(Viewport) X(Scissor) \
+    X(BufferData) X(BufferSubData) X(TexImage2D) X(TexSubImage2D) \
+    X(CompressedTexImage2D) X(CompressedTexSubImage2D)
+
+void installGLHooks(void*) {
+    // Save real entry points (or whichever layer was installed before us)
+    loadGLPointers();
+#define LYS_INSTALL_HOOK(name) \
+    real##name = _glptr_gl##name; \
+    _glptr_gl##name = hook##name;
+    LYS_GL_HOOK_LIST(LYS_INSTALL_HOOK)
+#undef LYS_INSTALL_HOOK
+}
+
+void removeGLHooks() {
+#define LYS_REMOVE_HOOK(name) \
+    if (_glptr_gl##name == hook##name) \
+        _glptr_gl##name = real##name;
+    LYS_GL_HOOK_LIST(LYS_REMOVE_HOOK)
+#undef LYS_REMOVE_HOOK
+}
+}
+
+
+struct Profiler::Impl {
+    Impl() {
+        serial = gNextSerial.fetch_add(1);
+        enabled = false;
+        counterCount = kCounterBuiltinCount;
+        for (uint32_t i = 0; i < kMaxCounters; ++i) {
+            counters[i] = 0;
+            lastCounters[i] = 0;
+            counterNames[i] = nullptr;
+            perFrame[i] = true;
+        }
+        counterNames[kCounterDrawCalls] = "Draw calls";
+        counterNames[kCounterStateChanges] = "State changes";
+        counterNames[kCounterUploadedBytes] = "Uploaded bytes";
+        counterNames[kCounterAllocations] = "Allocations";
+        frameStart = 0;
+        frameTime = 0.0f;
+        historyNext = 0;
+        historyCount = 0;
+        allocationBase = 0;
+    }
+
+    ~Impl() {
+        for (ThreadTree *tree : threads)
+            delete tree;
+    }
+
+    ThreadTree* local() {
+        if (tTreeOwner == serial)
+            return tTree;
+        std::lock_guard<std::mutex> lock(mutex);
+        std::thread::id id = std::this_thread::get_id();
+        ThreadTree *found = nullptr;
+        for (ThreadTree *tree : threads) {
+            if (tree->thread == id)
+                found = tree;
+        }
+        if (found == nullptr) {
+            found = new ThreadTree();
+            found->thread = id;
+            found->current = -1;
+            threads.push_back(found);
+        }
+        tTreeOwner = serial;
+        tTree = found;
+        return found;
+    }
+
+    uint64_t serial;
+    std::atomic<bool> enabled;
+    std::mutex mutex;
+    Vector<ThreadTree*> threads;
+
+    // Zones; nodes persist between frames so ids stay stable, only their
+    // times are reset. Each thread records into its own tree, and
+    // endFrame() merges them into this one.
+    Vector<const char*> zoneNames;
+    Vector<Node> nodes;
+    std::unordered_map<uint64_t, int32_t> nodeMap;
+    Vector<ProfilerZoneStats> lastZones;
+
+    std::atomic<int64_t> counters[kMaxCounters];
+    int64_t lastCounters[kMaxCounters];
+    const char *counterNames[kMaxCounters];
+    bool perFrame[kMaxCounters];
+    std::atomic<uint32_t> counterCount;
+    int64_t allocationBase;
+
+    int64_t frameStart;
+    float frameTime;
+    float history[kHistoryLength];
+    uint32_t historyNext, historyCount;
+};
+
+
+LYS_API Profiler::Profiler() {
+    pimpl_ = new Impl();
+}
+
+
+LYS_API Profiler::~Profiler() {
+    countGL(false);
+    delete this->pimpl_;
+}
+
+
+LYS_API Profiler& Profiler::global() {
+    static Profiler profiler;
+    return profiler;
+}
+
+
+LYS_API bool Profiler::isEnabled() const {
+    return pimpl_->enabled.load(std::memory_order_relaxed);
+}
+
+
+LYS_API void Profiler::enable(bool enable) {
+    pimpl_->enabled = enable;
+    if (enable)
+        pimpl_->frameStart = 0;
+}
+
+
+LYS_API void Profiler::beginFrame() {
+    if (!isEnabled())
+        return;
+
+    int64_t time = now();
+    if (pimpl_->frameStart != 0) {
+        pimpl_->frameTime = (time - pimpl_->frameStart) * 1e-6f;
+        pimpl_->history[pimpl_->historyNext] = pimpl_->frameTime;
+        pimpl_->historyNext = (pimpl_->historyNext + 1) % kHistoryLength;
+        if (pimpl_->historyCount < kHistoryLength)
+            ++pimpl_->historyCount;
+    }
+    pimpl_->frameStart = time;
+
+    uint32_t counter_count = pimpl_->counterCount;
+    for (uint32_t i = 0; i < counter_count; ++i) {
+        if (pimpl_->perFrame[i])
+            pimpl_->counters[i] = 0;
+    }
+    pimpl_->allocationBase = gAllocations.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    for (ThreadTree *tree : pimpl_->threads) {
+        std::lock_guard<std::mutex> tree_lock(tree->mutex);
+        resetTimes(tree->nodes);
+    }
+}
+
+
+LYS_API void Profiler::endFrame() {
+    if (!isEnabled())
+        return;
+
+    uint32_t counter_count = pimpl_->counterCount;
+    for (uint32_t i = 0; i < counter_count; ++i)
+        pimpl_->lastCounters[i] = pimpl_->counters[i];
+    pimpl_->lastCounters[kCounterAllocations] += gAllocations.load(std::memory_order_relaxed)
+                                              - pimpl_->allocationBase;
+
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    resetTimes(pimpl_->nodes);
+    for (ThreadTree *tree : pimpl_->threads) {
+        // Parents are created before their children, so a parent's merged
+        // node is always known by the time its children are reached
+        std::lock_guard<std::mutex> tree_lock(tree->mutex);
+        for (Node &node : tree->nodes) {
+            if (node.merged < 0) {
+                int32_t parent = node.parent >= 0 ? tree->nodes[node.parent].merged : -1;
+                node.merged = findNode(pimpl_->nodes, pimpl_->nodeMap, node.zone, parent);
+            }
+            Node &merged = pimpl_->nodes[node.merged];
+            merged.calls += node.calls;
+            merged.total += node.total;
+            merged.children += node.children;
+        }
+    }
+
+    pimpl_->lastZones.clear();
+    for (const Node &node : pimpl_->nodes) {
+        if (node.calls == 0)
+            continue;
+        ProfilerZoneStats stats;
+        stats.name = pimpl_->zoneNames[node.zone];
+        stats.depth = node.depth;
+        stats.calls = node.calls;
+        stats.totalMs = node.total * 1e-6f;
+        stats.selfMs = (node.total - node.children) * 1e-6f;
+        pimpl_->lastZones.push_back(stats);
+    }
+}
+
+
+LYS_API uint32_t Profiler::zone(const char *name) {
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    for (size_t i = 0; i < pimpl_->zoneNames.size(); ++i) {
+        if (strcmp(pimpl_->zoneNames[i], name) == 0)
+            return static_cast<uint32_t>(i);
+    }
+    pimpl_->zoneNames.push_back(name);
+    return static_cast<uint32_t>(pimpl_->zoneNames.size() - 1);
+}
+
+
+LYS_API uint32_t Profiler::counter(const char *name, bool per_frame) {
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    uint32_t counter_count = pimpl_->counterCount;
+    for (uint32_t i = 0; i < counter_count; ++i) {
+        if (strcmp(pimpl_->counterNames[i], name) == 0)
+            return i;
+    }
+    // Out of slots: share the last one rather than fail
+    if (counter_count == kMaxCounters)
+        return kMaxCounters - 1;
+
+    pimpl_->counterNames[counter_count] = name;
+    pimpl_->perFrame[counter_count] = per_frame;
+    pimpl_->counterCount = counter_count + 1;
+    return counter_count;
+}
+
+
+LYS_API void Profiler::count(uint32_t id, int64_t amount) {
+    if (id < kMaxCounters)
+        pimpl_->counters[id].fetch_add(amount, std::memory_order_relaxed);
+}
+
+
+LYS_API void Profiler::set(uint32_t id, int64_t value) {
+    if (id < kMaxCounters)
+        pimpl_->counters[id].store(value, std::memory_order_relaxed);
+}
+
+
+LYS_API void Profiler::countAllocation() {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+LYS_API bool Profiler::isCountingGL() const {
+    return gGLProfiler == this;
+}
+
+
+LYS_API bool Profiler::countGL(bool enable) {
+    if (!enable) {
+        if (gGLProfiler == this) {
+            removeGLResetCallback(installGLHooks, nullptr);
+            removeGLHooks();
+            gGLProfiler = nullptr;
+        }
+        return true;
+    }
+
+    if (gGLProfiler != nullptr)
+        return gGLProfiler == this;
+    if (!addGLResetCallback(installGLHooks, nullptr))
+        return false;
+    gGLProfiler = this;
+    gGLCounters = pimpl_->counters;
+    installGLHooks(nullptr);
+    return true;
+}
+
+
+LYS_API float Profiler::frameTime() const {
+    return pimpl_->frameTime;
+}
+
+
+LYS_API void Profiler::frameTimes(Vector<float> *times) const {
+    times->clear();
+    uint32_t first = (pimpl_->historyNext + kHistoryLength - pimpl_->historyCount) % kHistoryLength;
+    for (uint32_t i = 0; i < pimpl_->historyCount; ++i)
+        times->push_back(pimpl_->history[(first + i) % kHistoryLength]);
+}
+
+
+LYS_API void Profiler::topZones(size_t count, Vector<ProfilerZoneStats> *zones) const {
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    *zones = pimpl_->lastZones;
+    std::stable_sort(zones->begin(), zones->end(), [](const ProfilerZoneStats &a, const ProfilerZoneStats &b) {
+        return a.totalMs > b.totalMs;
+    });
+    if (zones->size() > count)
+        zones->resize(count);
+}
+
+
+LYS_API uint32_t Profiler::counterCount() const {
+    return pimpl_->counterCount;
+}
+
+
+LYS_API const char* Profiler::counterName(uint32_t id) const {
+    return id < pimpl_->counterCount ? pimpl_->counterNames[id] : nullptr;
+}
+
+
+LYS_API int64_t Profiler::counterValue(uint32_t id) const {
+    return id < pimpl_->counterCount ? pimpl_->lastCounters[id] : 0;
+}
+
+
+LYS_API int32_t Profiler::enter(uint32_t zone, int32_t *parent) {
+    ThreadTree *tree = pimpl_->local();
+    std::lock_guard<std::mutex> lock(tree->mutex);
+    *parent = tree->current;
+    tree->current = findNode(tree->nodes, tree->nodeMap, zone, *parent);
+    return tree->current;
+}
+
+
+LYS_API void Profiler::leave(int32_t node, int32_t parent, int64_t nanoseconds) {
+    ThreadTree *tree = pimpl_->local();
+    std::lock_guard<std::mutex> lock(tree->mutex);
+    ++tree->nodes[node].calls;
+    tree->nodes[node].total += nanoseconds;
+    if (parent >= 0)
+        tree->nodes[parent].children += nanoseconds;
+    tree->current = parent;
+}
+
+
+LYS_API ProfileScope::ProfileScope(uint32_t zone) {
+    Profiler &profiler = Profiler::global();
+    if (!profiler.isEnabled()) {
+        node_ = -1;
+        return;
+    }
+    node_ = profiler.enter(zone, &parent_);
+    start_ = now();
+}
+
+
+LYS_API ProfileScope::~ProfileScope() {
+    if (node_ >= 0)
+        Profiler::global().leave(node_, parent_, now() - start_);
+}
+}
@@ -0,0 +1,328 @@
+/***************************************************
+* ProfilerOverlay.cc: In-window profiler display   *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "ProfilerOverlay.h"
+
+#include <stdio.h>
+
+#include "GLES2/gl2.h"
+
+#include "config.h"
+#include "types.h"
+#include "GLState.h"
+#include "ResourceRegistry.h"
+
+namespace lys3d {
+namespace {
+// 5x7 glyphs for ' ' to '_' (lowercase is drawn as uppercase), one byte per
+// row with the leftmost pixel in bit 4. Glyph 64 is a solid block for rects.
+const uint8_t kFont[65][7] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04},
+    {0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00}, {0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A},
+    {0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04}, {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03},
+    {0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D}, {0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08},
+    {0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00}, {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}, {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00},
+    {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E},
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E},
+    {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E},
+    {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},
+    {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C},
+    {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08},
+    {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}, {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00},
+    {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}, {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04},
+    {0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E}, {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11},
+    {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E},
+    {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F},
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F},
+    {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E},
+    {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11},
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11},
+    {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E},
+    {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D},
+    {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E},
+    {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E},
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A},
+    {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04},
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, {0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E},
+    {0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00}, {0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E},
+    {0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F},
+    {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+};
+const uint32_t kSolidGlyph = 64;
+
+// Glyphs sit in 6x8 cells, 16 to a row, in a 128x64 luminance texture
+const int kCellWidth = 6, kCellHeight = 8, kCellsPerRow = 16;
+const int kTextureWidth = 128, kTextureHeight = 64;
+
+// Panel layout, in font pixels (multiplied by the overlay scale)
+const int kPanelColumns = 46;
+const int kBarWidth = 2;
+const int kGraphHeight = 40;
+const float kTargetMs = 1000.0f / 60.0f;
+
+const char* kOverlayVS =
+    "attribute vec2 a_position;\n"
+    "attribute vec2 a_texcoord;\n"
+    "attribute vec4 a_color;\n"
+    "uniform vec2 u_scale;\n"
+    "varying vec2 v_texcoord;\n"
+    "varying vec4 v_color;\n"
+    "void main() {\n"
+    "    v_texcoord = a_texcoord;\n"
+    "    v_color = a_color;\n"
+    "    gl_Position = vec4(a_position * u_scale + vec2(-1.0, 1.0), 0.0, 1.0);\n"
+    "}\n";
+
+const char* kOverlayFS =
+    "uniform sampler2D u_font;\n"
+    "varying vec2 v_texcoord;\n"
+    "varying vec4 v_color;\n"
+    "void main() {\n"
+    "    gl_FragColor = vec4(v_color.rgb, v_color.a * texture2D(u_font, v_texcoord).r);\n"
+    "}\n";
+
+uint16_t texelU(float x) {
+    return static_cast<uint16_t>(x / kTextureWidth * 65535.0f + 0.5f);
+}
+
+uint16_t texelV(float y) {
+    return static_cast<uint16_t>(y / kTextureHeight * 65535.0f + 0.5f);
+}
+
+// Human-readable byte counts
+void formatBytes(int64_t bytes, char *out, size_t size) {
+    if (bytes >= 10 * 1024 * 1024)
+        snprintf(out, size, "%.1f MB", bytes / (1024.0 * 1024.0));
+    else if (bytes >= 10 * 1024)
+        snprintf(out, size, "%.1f KB", bytes / 1024.0);
+    else
+        snprintf(out, size, "%lld B", static_cast<long long>(bytes));
+}
+}
+
+
+ProfilerOverlay::ProfilerOverlay() {
+    texture_ = 0;
+    buffer_ = 0;
+    bufferSize_ = 0;
+    scaleLocation_ = -1;
+    failed_ = false;
+    scale_ = 1.0f;
+    layout_.add(kAttribPosition, 2, VertexFormat::kFloat)
+           .add(kAttribTexCoord, 2, VertexFormat::kUShortNorm)
+           .add(kAttribColor, 4, VertexFormat::kUByteNorm);
+}
+
+
+ProfilerOverlay::~ProfilerOverlay() {
+    ResourceRegistry &registry = ResourceRegistry::global();
+    registry.release(GpuResourceType::kTexture, texture_);
+    registry.release(GpuResourceType::kBuffer, buffer_);
+}
+
+
+bool ProfilerOverlay::create() {
+    if (!program_.build(kOverlayVS, kOverlayFS))
+        return false;
+    scaleLocation_ = program_.uniformLocation("u_scale");
+    program_.use();
+    glUniform1i(program_.uniformLocation("u_font"), 0);
+
+    Vector<uint8_t> pixels(kTextureWidth * kTextureHeight, 0);
+    for (uint32_t glyph = 0; glyph <= kSolidGlyph; ++glyph) {
+        int x0 = (glyph % kCellsPerRow) * kCellWidth;
+        int y0 = (glyph / kCellsPerRow) * kCellHeight;
+        for (int row = 0; row < 7; ++row) {
+            for (int col = 0; col < 5; ++col) {
+                if (kFont[glyph][row] & (0x10 >> col))
+                    pixels[(y0 + row) * kTextureWidth + x0 + col] = 0xFF;
+            }
+        }
+    }
+
+    glGenTextures(1, &texture_);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, kTextureWidth, kTextureHeight, 0, GL_LUMINANCE,
+                 GL_UNSIGNED_BYTE, pixels.data());
+
+    glGenBuffers(1, &buffer_);
+    ResourceRegistry::global().track(GpuResourceType::kTexture, texture_, kTextureWidth * kTextureHeight);
+    return true;
+}
+
+
+void ProfilerOverlay::rect(float x, float y, float w, float h, uint32_t rgba) {
+    // Every corner samples the middle of the solid glyph
+    float sx = (kSolidGlyph % kCellsPerRow) * kCellWidth + 2.5f;
+    float sy = (kSolidGlyph / kCellsPerRow) * kCellHeight + 3.5f;
+    Vertex v;
+    v.u = texelU(sx);
+    v.v = texelV(sy);
+    v.color[0] = static_cast<uint8_t>(rgba >> 24);
+    v.color[1] = static_cast<uint8_t>(rgba >> 16);
+    v.color[2] = static_cast<uint8_t>(rgba >> 8);
+    v.color[3] = static_cast<uint8_t>(rgba);
+
+    const float corners[6][2] = {{x, y}, {x, y + h}, {x + w, y}, {x + w, y}, {x, y + h}, {x + w, y + h}};
+    for (const float *corner : corners) {
+        v.x = corner[0];
+        v.y = corner[1];
+        vertices_.push_back(v);
+    }
+}
+
+
+void ProfilerOverlay::text(float x, float y, const char *str, uint32_t rgba) {
+    Vertex v;
+    v.color[0] = static_cast<uint8_t>(rgba >> 24);
+    v.color[1] = static_cast<uint8_t>(rgba >> 16);
+    v.color[2] = static_cast<uint8_t>(rgba >> 8);
+    v.color[3] = static_cast<uint8_t>(rgba);
+
+    for (; *str; ++str, x += kCellWidth * scale_) {
+        int c = static_cast<unsigned char>(*str);
+        if (c >= 'a' && c <= 'z')
+            c -= 'a' - 'A';
+        if (c <= ' ' || c > '_')
+            continue;
+
+        int glyph = c - ' ';
+        float u0 = static_cast<float>((glyph % kCellsPerRow) * kCellWidth);
+        float v0 = static_cast<float>((glyph / kCellsPerRow) * kCellHeight);
+        float w = 5.0f * scale_, h = 7.0f * scale_;
+        const float corners[6][4] = {
+            {x, y, u0, v0}, {x, y + h, u0, v0 + 7.0f}, {x + w, y, u0 + 5.0f, v0},
+            {x + w, y, u0 + 5.0f, v0}, {x, y + h, u0, v0 + 7.0f}, {x + w, y + h, u0 + 5.0f, v0 + 7.0f}
+        };
+        for (const float *corner : corners) {
+            v.x = corner[0];
+            v.y = corner[1];
+            v.u = texelU(corner[2]);
+            v.v = texelV(corner[3]);
+            vertices_.push_back(v);
+        }
+    }
+}
+
+
+void ProfilerOverlay::draw(const Profiler &profiler, const Dimension2Di32 &viewport) {
+    if (failed_ || viewport.width() <= 0 || viewport.height() <= 0)
+        return;
+
+    // Lay out the panel first; it's cheap, and the GL work all happens at once
+    scale_ = static_cast<float>(viewport.height() >= 1080 ? viewport.height() / 540 : 1);
+    const float pad = 4.0f * scale_;
+    const float cell = kCellWidth * scale_;
+    const float line = 9.0f * scale_;
+    const float graph_height = kGraphHeight * scale_;
+    const float graph_width = Profiler::kHistoryLength * kBarWidth * scale_;
+    profiler.topZones(kTopZones, &zones_);
+    profiler.frameTimes(&history_);
+    uint32_t custom_counters = profiler.counterCount() - kCounterBuiltinCount;
+    float width = kPanelColumns * cell + pad * 2.0f;
+    float height = pad * 2.0f + graph_height + line * (4.5f + custom_counters + zones_.size());
+
+    vertices_.clear();
+    char buffer[96], bytes[32];
+    float x = pad * 2.0f, y = pad * 2.0f;
+    rect(pad, pad, width, height, 0x000000B0);
+
+    float frame_ms = profiler.frameTime();
+    snprintf(buffer, sizeof(buffer), "FRAME %6.2f MS  %6.1f FPS", frame_ms,
+             frame_ms > 0.0f ? 1000.0f / frame_ms : 0.0f);
+    text(x, y, buffer, 0xFFFFFFFF);
+    y += line;
+
+    // Frame time graph, scaled to fit at least two 60 Hz frames
+    float max_ms = kTargetMs * 2.0f;
+    for (float ms : history_)
+        max_ms = ms > max_ms ? ms : max_ms;
+    rect(x, y, graph_width, graph_height, 0x303030C0);
+    float bar_x = x + graph_width - history_.size() * kBarWidth * scale_;
+    for (float ms : history_) {
+        float bar_height = ms / max_ms * graph_height;
+        uint32_t color = ms <= kTargetMs * 1.05f ? 0x40D040FF : (ms <= kTargetMs * 2.1f ? 0xE0C040FF : 0xE04040FF);
+        rect(bar_x, y + graph_height - bar_height, kBarWidth * scale_, bar_height, color);
+        bar_x += kBarWidth * scale_;
+    }
+    rect(x, y + graph_height - kTargetMs / max_ms * graph_height, graph_width, scale_, 0xFFFFFF60);
+    y += graph_height + line * 0.5f;
+
+    // Counters
+    snprintf(buffer, sizeof(buffer), "DRAWS %-8lld STATES %lld",
+             static_cast<long long>(profiler.counterValue(kCounterDrawCalls)),
+             static_cast<long long>(profiler.counterValue(kCounterStateChanges)));
+    text(x, y, buffer, 0xFFFFFFFF);
+    y += line;
+    formatBytes(profiler.counterValue(kCounterUploadedBytes), bytes, sizeof(bytes));
+    snprintf(buffer, sizeof(buffer), "UPLOAD %-11s ALLOCS %lld", bytes,
+             static_cast<long long>(profiler.counterValue(kCounterAllocations)));
+    text(x, y, buffer, 0xFFFFFFFF);
+    y += line;
+    for (uint32_t i = kCounterBuiltinCount; i < profiler.counterCount(); ++i) {
+        snprintf(buffer, sizeof(buffer), "%-30.30s %lld", profiler.counterName(i),
+                 static_cast<long long>(profiler.counterValue(i)));
+        text(x, y, buffer, 0xC0C0FFFF);
+        y += line;
+    }
+
+    // Top zones, indented by depth
+    snprintf(buffer, sizeof(buffer), "%-30s %7s %7s", "ZONE", "MS", "SELF");
+    text(x, y, buffer, 0xA0A0A0FF);
+    y += line;
+    for (const ProfilerZoneStats &zone : zones_) {
+        int indent = static_cast<int>(zone.depth < 8 ? zone.depth : 8);
+        snprintf(buffer, sizeof(buffer), "%*s%-*.*s %7.2f %7.2f", indent, "", 30 - indent, 30 - indent,
+                 zone.name, zone.totalMs, zone.selfMs);
+        text(x, y, buffer, 0xFFFFFFFF);
+        y += line;
+    }
+
+    // Save what we touch, so the overlay can be drawn at any point
+    GLStateSnapshot saved;
+    saveGLState(kGLStateCapabilities | kGLStateBlendFunc | kGLStateBindings | kGLStateViewport, &saved);
+    glActiveTexture(GL_TEXTURE0);
+
+    if (texture_ == 0 && !create()) {
+        failed_ = true;
+    } else {
+        glViewport(0, 0, viewport.width(), viewport.height());
+        setGLCapability(GL_DEPTH_TEST, false);
+        setGLCapability(GL_CULL_FACE, false);
+        setGLCapability(GL_SCISSOR_TEST, false);
+        setGLCapability(GL_BLEND, true);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        program_.use();
+        glUniform2f(scaleLocation_, 2.0f / viewport.width(), -2.0f / viewport.height());
+        glBindTexture(GL_TEXTURE_2D, texture_);
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices_.size() * sizeof(Vertex)),
+                     vertices_.data(), GL_STREAM_DRAW);
+        uint32_t buffer_size = static_cast<uint32_t>(vertices_.size() * sizeof(Vertex));
+        if (buffer_size != bufferSize_) {
+            bufferSize_ = buffer_size;
+            ResourceRegistry::global().track(GpuResourceType::kBuffer, buffer_, bufferSize_);
+        }
+        layout_.apply();
+        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices_.size()));
+        layout_.disable();
+    }
+
+    restoreGLState(saved);
+}
+}
@@ -0,0 +1,72 @@
+/***************************************************
+* ProfilerOverlay.h: In-window profiler display    *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_PROFILEROVERLAY_H_
+#define LYS3D_PROFILEROVERLAY_H_
+
+#include "types.h"
+#include "Dimension2D.h"
+#include "Profiler.h"
+#include "ShaderProgram.h"
+#include "VertexLayout.h"
+
+namespace lys3d {
+
+/** Draws a Profiler's last frame (frame time graph, counters and top zones) \
+ * over the current framebuffer with a built-in 5x7 pixel font.
+ * Everything goes into one streamed vertex buffer and one draw call, so the \
+ * overlay barely shows up in the numbers it reports. Internal to WindowGLES2.
+ */
+class ProfilerOverlay {
+  public:
+    /** Number of zones listed. */
+    static const size_t kTopZones = 8;
+
+    ProfilerOverlay();
+
+    /** Deletes the GL objects; the context they were made in must be current. */
+    ~ProfilerOverlay();
+
+    ProfilerOverlay(const ProfilerOverlay& other) = delete;
+    ProfilerOverlay& operator=(const ProfilerOverlay& other) = delete;
+
+    /** Draw the overlay in the top-left corner of the bound framebuffer.
+     * Blending, depth test, culling and scissor state, the bound program, \
+     * array buffer, texture and viewport are restored afterwards.
+     * \param profiler The profiler to show.
+     * \param viewport Framebuffer size, in pixels.
+     */
+    void draw(const Profiler &profiler, const Dimension2Di32 &viewport);
+
+  private:
+    struct Vertex {
+        float x, y;
+        uint16_t u, v;
+        uint8_t color[4];
+    };
+
+    bool create();
+    void rect(float x, float y, float w, float h, uint32_t rgba);
+    void text(float x, float y, const char *str, uint32_t rgba);
+
+    ShaderProgram program_;
+    VertexLayout layout_;
+    uint32_t texture_;
+    uint32_t buffer_;
+    uint32_t bufferSize_;
+    int32_t scaleLocation_;
+    bool failed_;
+    float scale_;
+    Vector<Vertex> vertices_;
+    Vector<float> history_;
+    Vector<ProfilerZoneStats> zones_;
+};
+}
+#endif // LYS3D_PROFILEROVERLAY_H_
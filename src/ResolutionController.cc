@@ -0,0 +1,86 @@
+/***************************************************
+* ResolutionController.cc: Dynamic resolution      *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "ResolutionController.h"
+
+#include <math.h>
+#include <algorithm>
+
+#include "config.h"
+#include "types.h"
+
+namespace lys3d {
+namespace {
+// Growing needs the smoothed time this far under the budget, so a scale
+// that lands just under it stays put
+const float kGrowThreshold = 0.9f;
+}
+
+
+LYS_API ResolutionController::ResolutionController(const DynamicResolutionSettings &settings) {
+    settings_ = settings;
+    reset();
+}
+
+
+LYS_API void ResolutionController::settings(const DynamicResolutionSettings &settings) {
+    settings_ = settings;
+    scale_ = std::max(settings_.minScale, std::min(scale_, settings_.maxScale));
+}
+
+
+LYS_API float ResolutionController::update(float frame_ms) {
+    if (frame_ms <= 0.0f)
+        return scale_;
+    // Hitches (e.g. loading) count as two frames' worth at most, so a single
+    // one doesn't swamp the average
+    frame_ms = std::min(frame_ms, settings_.targetFrameMs * 2.0f);
+    if (smoothedMs_ <= 0.0f)
+        smoothedMs_ = frame_ms;
+    else
+        smoothedMs_ += settings_.smoothing * (frame_ms - smoothedMs_);
+
+    float budget = settings_.targetFrameMs * settings_.headroom;
+    if (frame_ms > settings_.targetFrameMs || smoothedMs_ > budget) {
+        // A dropped frame counts for half against the average
+        float cost = smoothedMs_;
+        if (frame_ms > settings_.targetFrameMs)
+            cost = std::max(cost, 0.5f * (frame_ms + smoothedMs_));
+        framesUnder_ = 0;
+        if (cost > budget)
+            rescale(scale_ * sqrtf(budget / cost));
+    } else if (smoothedMs_ < budget * kGrowThreshold) {
+        if (++framesUnder_ >= settings_.growDelay) {
+            framesUnder_ = 0;
+            rescale(std::min(scale_ * sqrtf(budget / smoothedMs_), scale_ + settings_.maxGrowStep));
+        }
+    } else {
+        framesUnder_ = 0;
+    }
+    return scale_;
+}
+
+
+LYS_API void ResolutionController::reset() {
+    scale_ = settings_.maxScale;
+    smoothedMs_ = 0.0f;
+    framesUnder_ = 0;
+}
+
+
+void ResolutionController::rescale(float wanted) {
+    float scale = std::max(settings_.minScale, std::min(wanted, settings_.maxScale));
+    if (scale == scale_)
+        return;
+    // Predict what the new scale costs rather than wait for the average
+    smoothedMs_ *= (scale * scale) / (scale_ * scale_);
+    scale_ = scale;
+}
+}
@@ -0,0 +1,312 @@
+/***************************************************
+* ResourceRegistry.cc: GL object accounting        *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "ResourceRegistry.h"
+
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+#include "GLES2/gl2.h"
+#include <SDL2/SDL_video.h>
+
+#include "config.h"
+#include "types.h"
+#include "Profiler.h"
+
+namespace lys3d {
+namespace {
+const uint32_t kTypeCount = static_cast<uint32_t>(GpuResourceType::kCount);
+
+const char* kByteCounterNames[kTypeCount] = {
+    "GPU texture bytes",
+    "GPU buffer bytes",
+    "GPU renderbuffer bytes",
+    "GPU program bytes",
+    "GPU framebuffer bytes",
+};
+
+struct Record {
+    uint64_t bytes;
+    uint64_t lastUsed;
+    GpuEvictCallback evict;
+    void *userData;
+};
+
+struct PendingDelete {
+    GpuResourceType type;
+    uint32_t name;
+    uint64_t frame;
+    SDL_GLContext context;
+};
+
+struct Victim {
+    GpuResourceType type;
+    uint32_t name;
+    uint64_t lastUsed;
+    uint64_t bytes;
+    GpuEvictCallback evict;
+    void *userData;
+};
+
+uint64_t key(GpuResourceType type, uint32_t name) {
+    return (static_cast<uint64_t>(type) << 32) | name;
+}
+
+void deleteObject(GpuResourceType type, GLuint name) {
+    switch (type) {
+    case GpuResourceType::kTexture:
+        glDeleteTextures(1, &name);
+        break;
+    case GpuResourceType::kBuffer:
+        glDeleteBuffers(1, &name);
+        break;
+    case GpuResourceType::kRenderbuffer:
+        glDeleteRenderbuffers(1, &name);
+        break;
+    case GpuResourceType::kProgram:
+        glDeleteProgram(name);
+        break;
+    case GpuResourceType::kFramebuffer:
+        glDeleteFramebuffers(1, &name);
+        break;
+    default:
+        break;
+    }
+}
+}
+
+
+struct ResourceRegistry::Impl {
+    Impl() {
+        frame = 0;
+        deleteDelay = 2;
+        memset(stats, 0, sizeof(stats));
+        Profiler &profiler = Profiler::global();
+        for (uint32_t i = 0; i < kTypeCount; ++i)
+            byteCounters[i] = profiler.counter(kByteCounterNames[i], false);
+        evictionCounter = profiler.counter("GPU evictions");
+        pendingCounter = profiler.counter("GPU deletes pending", false);
+    }
+
+    mutable std::mutex mutex;
+    uint64_t frame;
+    uint32_t deleteDelay;
+    std::unordered_map<uint64_t, Record> records;
+    Vector<PendingDelete> deletes;
+    Vector<Victim> victims;
+    GpuResourceStats stats[kTypeCount];
+    uint32_t byteCounters[kTypeCount];
+    uint32_t evictionCounter;
+    uint32_t pendingCounter;
+};
+
+
+LYS_API ResourceRegistry::ResourceRegistry() {
+    pimpl_ = new Impl();
+}
+
+
+LYS_API ResourceRegistry::~ResourceRegistry() {
+    delete pimpl_;
+}
+
+
+LYS_API ResourceRegistry& ResourceRegistry::global() {
+    static ResourceRegistry registry;
+    return registry;
+}
+
+
+LYS_API void ResourceRegistry::track(GpuResourceType type, uint32_t name, uint64_t bytes) {
+    if (name == 0 || type >= GpuResourceType::kCount)
+        return;
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    GpuResourceStats &stats = pimpl_->stats[static_cast<uint32_t>(type)];
+    auto found = pimpl_->records.find(key(type, name));
+    if (found != pimpl_->records.end()) {
+        stats.bytes = stats.bytes - found->second.bytes + bytes;
+        found->second.bytes = bytes;
+        found->second.lastUsed = pimpl_->frame;
+        return;
+    }
+
+    Record record;
+    record.bytes = bytes;
+    record.lastUsed = pimpl_->frame;
+    record.evict = nullptr;
+    record.userData = nullptr;
+    pimpl_->records[key(type, name)] = record;
+    ++stats.count;
+    stats.bytes += bytes;
+}
+
+
+LYS_API void ResourceRegistry::reloadable(GpuResourceType type, uint32_t name, GpuEvictCallback callback,
+                                          void *user_data) {
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    auto found = pimpl_->records.find(key(type, name));
+    if (found != pimpl_->records.end()) {
+        found->second.evict = callback;
+        found->second.userData = user_data;
+    }
+}
+
+
+LYS_API void ResourceRegistry::touch(GpuResourceType type, uint32_t name) {
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    auto found = pimpl_->records.find(key(type, name));
+    if (found != pimpl_->records.end())
+        found->second.lastUsed = pimpl_->frame;
+}
+
+
+LYS_API void ResourceRegistry::release(GpuResourceType type, uint32_t name) {
+    if (name == 0 || type >= GpuResourceType::kCount)
+        return;
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    GpuResourceStats &stats = pimpl_->stats[static_cast<uint32_t>(type)];
+    auto found = pimpl_->records.find(key(type, name));
+    if (found != pimpl_->records.end()) {
+        --stats.count;
+        stats.bytes -= found->second.bytes;
+        pimpl_->records.erase(found);
+    }
+
+    PendingDelete pending;
+    pending.type = type;
+    pending.name = name;
+    pending.frame = pimpl_->frame;
+    pending.context = SDL_GL_GetCurrentContext();
+    pimpl_->deletes.push_back(pending);
+    ++stats.pendingDeletes;
+}
+
+
+LYS_API uint64_t ResourceRegistry::budget(GpuResourceType type) const {
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    return type < GpuResourceType::kCount ? pimpl_->stats[static_cast<uint32_t>(type)].budget : 0;
+}
+
+
+LYS_API void ResourceRegistry::budget(GpuResourceType type, uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    if (type < GpuResourceType::kCount)
+        pimpl_->stats[static_cast<uint32_t>(type)].budget = bytes;
+}
+
+
+LYS_API uint32_t ResourceRegistry::deleteDelay() const {
+    return pimpl_->deleteDelay;
+}
+
+
+LYS_API void ResourceRegistry::deleteDelay(uint32_t frames) {
+    pimpl_->deleteDelay = frames;
+}
+
+
+LYS_API uint32_t ResourceRegistry::enforce() {
+    Impl &impl = *pimpl_;
+    uint32_t evicted = 0;
+    for (uint32_t t = 0; t < kTypeCount; ++t) {
+        GpuResourceType type = static_cast<GpuResourceType>(t);
+        uint64_t over;
+        {
+            std::lock_guard<std::mutex> lock(impl.mutex);
+            impl.stats[t].evictions = 0;
+            const GpuResourceStats &stats = impl.stats[t];
+            if (stats.budget == 0 || stats.bytes <= stats.budget)
+                continue;
+            over = stats.bytes - stats.budget;
+
+            // Candidates: reloadable and not used this frame, oldest first
+            impl.victims.clear();
+            for (const auto &entry : impl.records) {
+                const Record &record = entry.second;
+                if ((entry.first >> 32) != t || record.evict == nullptr || record.lastUsed >= impl.frame)
+                    continue;
+                Victim victim;
+                victim.type = type;
+                victim.name = static_cast<uint32_t>(entry.first);
+                victim.lastUsed = record.lastUsed;
+                victim.bytes = record.bytes;
+                victim.evict = record.evict;
+                victim.userData = record.userData;
+                impl.victims.push_back(victim);
+            }
+            std::sort(impl.victims.begin(), impl.victims.end(), [](const Victim &a, const Victim &b) {
+                return a.lastUsed != b.lastUsed ? a.lastUsed < b.lastUsed : a.bytes > b.bytes;
+            });
+        }
+
+        // The callbacks call back into the registry, so no lock here
+        uint32_t type_evictions = 0;
+        for (size_t i = 0; i < impl.victims.size() && over > 0; ++i) {
+            const Victim &victim = impl.victims[i];
+            victim.evict(victim.userData, victim.type, victim.name);
+            over = victim.bytes >= over ? 0 : over - victim.bytes;
+            ++type_evictions;
+        }
+        std::lock_guard<std::mutex> lock(impl.mutex);
+        impl.stats[t].evictions = type_evictions;
+        evicted += type_evictions;
+    }
+    return evicted;
+}
+
+
+LYS_API void ResourceRegistry::collect(bool all) {
+    Impl &impl = *pimpl_;
+    SDL_GLContext current = SDL_GL_GetCurrentContext();
+    std::lock_guard<std::mutex> lock(impl.mutex);
+    size_t kept = 0;
+    for (size_t i = 0; i < impl.deletes.size(); ++i) {
+        const PendingDelete &pending = impl.deletes[i];
+        if (pending.context == current && current != nullptr
+            && (all || pending.frame + impl.deleteDelay <= impl.frame)) {
+            deleteObject(pending.type, pending.name);
+        } else if (pending.context != nullptr) {
+            impl.deletes[kept++] = pending;
+            continue;
+        }
+        // Deleted, or queued without a context (so nothing to delete)
+        --impl.stats[static_cast<uint32_t>(pending.type)].pendingDeletes;
+    }
+    impl.deletes.resize(kept);
+}
+
+
+LYS_API void ResourceRegistry::endFrame() {
+    LYS_PROFILE_ZONE("GPU resources");
+    uint32_t evicted = enforce();
+    ++pimpl_->frame;
+    collect();
+
+    Profiler &profiler = Profiler::global();
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    for (uint32_t t = 0; t < kTypeCount; ++t)
+        profiler.set(pimpl_->byteCounters[t], static_cast<int64_t>(pimpl_->stats[t].bytes));
+    profiler.count(pimpl_->evictionCounter, evicted);
+    profiler.set(pimpl_->pendingCounter, static_cast<int64_t>(pimpl_->deletes.size()));
+}
+
+
+LYS_API GpuResourceStats ResourceRegistry::stats(GpuResourceType type) const {
+    std::lock_guard<std::mutex> lock(pimpl_->mutex);
+    if (type >= GpuResourceType::kCount) {
+        GpuResourceStats empty;
+        memset(&empty, 0, sizeof(empty));
+        return empty;
+    }
+    return pimpl_->stats[static_cast<uint32_t>(type)];
+}
+}
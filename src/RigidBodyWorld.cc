@@ -0,0 +1,1622 @@
+/***************************************************
+* RigidBodyWorld.cc: Rigid-body dynamics           *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "RigidBodyWorld.h"
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "config.h"
+#include "types.h"
+#include "Box3D.h"
+#include "Broadphase.h"
+#include "Profiler.h"
+#include "Simd.h"
+
+namespace lys3d {
+namespace {
+const uint32_t kNone = 0xFFFFFFFF;
+const uint32_t kBatchSize = 64;
+const uint32_t kMaxPoints = 4;
+const uint32_t kMaxColors = 64;
+
+// Approach speed below which contacts don't bounce
+const float kBounceSpeed = 1.0f;
+
+// How much a separating axis must beat the one before it to be picked, so
+// resting contacts don't flip between axes
+const float kAxisRelative = 0.98f;
+const float kAxisAbsolute = 0.001f;
+
+enum Phase {
+    kPhaseNarrow,
+    kPhaseSolve
+};
+
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Vec3 {
+    float x, y, z;
+
+    float operator[](int i) const {
+        return (&x)[i];
+    }
+};
+
+Vec3 vec3(float x, float y, float z) {
+    Vec3 v = {x, y, z};
+    return v;
+}
+
+Vec3 toVec3(const Point3Df &p) {
+    return vec3(p.x(), p.y(), p.z());
+}
+
+Point3Df toPoint(const Vec3 &v) {
+    return Point3Df(v.x, v.y, v.z);
+}
+
+Vec3 operator+(const Vec3 &a, const Vec3 &b) {
+    return vec3(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+Vec3 operator-(const Vec3 &a, const Vec3 &b) {
+    return vec3(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+Vec3 operator-(const Vec3 &a) {
+    return vec3(-a.x, -a.y, -a.z);
+}
+
+Vec3 operator*(const Vec3 &a, float s) {
+    return vec3(a.x * s, a.y * s, a.z * s);
+}
+
+float dot(const Vec3 &a, const Vec3 &b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Vec3 cross(const Vec3 &a, const Vec3 &b) {
+    return vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+struct Quat {
+    float x, y, z, w;
+};
+
+Quat normalize(const Quat &q) {
+    float length = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    float scale = length > 0.0f ? 1.0f / length : 0.0f;
+    Quat out = {q.x * scale, q.y * scale, q.z * scale, q.w * scale};
+    if (scale == 0.0f)
+        out.w = 1.0f;
+    return out;
+}
+
+// Row-major 3x3; for a rotation, the columns are the body's axes
+struct Mat3 {
+    float m[3][3];
+
+    Vec3 column(int i) const {
+        return vec3(m[0][i], m[1][i], m[2][i]);
+    }
+
+    Vec3 operator*(const Vec3 &v) const {
+        return vec3(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+                    m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+                    m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+    }
+
+    // Multiplies by the transpose: world to local for a rotation
+    Vec3 transposed(const Vec3 &v) const {
+        return vec3(m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z,
+                    m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z,
+                    m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z);
+    }
+};
+
+Mat3 rotation(const Quat &q) {
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    Mat3 r = {{{1.0f - 2.0f * (yy + zz), 2.0f * (xy - wz), 2.0f * (xz + wy)},
+               {2.0f * (xy + wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz - wx)},
+               {2.0f * (xz - wy), 2.0f * (yz + wx), 1.0f - 2.0f * (xx + yy)}}};
+    return r;
+}
+
+struct Body {
+    Vec3 position;
+    Quat orientation;
+    Vec3 velocity;
+    Vec3 angular;
+    Mat3 basis;
+    // Inverse inertia, diagonal in local space and in world space
+    Vec3 inverseInertia;
+    Mat3 worldInverseInertia;
+    Vec3 halfExtents;
+    float inverseMass;
+    float friction;
+    float restitution;
+    // Seconds spent slower than the sleep speed
+    float sleepTimer;
+    uint32_t proxy;
+    // Island this step, and the index among its bodies (0 is the ground)
+    uint32_t island;
+    uint32_t slot;
+    // The island it fell asleep with, as a list
+    uint32_t sleepFirst;
+    uint32_t sleepNext;
+    BodyShape shape;
+    ProxyMotion motion;
+    bool alive;
+    bool awake;
+    // Changed while static or asleep, so its proxy needs moving. Static
+    // bodies keep it through the step's wake pass, to wake what they reach
+    bool moved;
+};
+
+struct ContactPoint {
+    // On body a, in its local space, to match points across steps
+    Vec3 local;
+    // Midway between the surfaces
+    Vec3 position;
+    // Negative when overlapping
+    float separation;
+    // Only the normal impulse carries over; warm started friction kept
+    // tall stacks swaying
+    float normalImpulse;
+};
+
+// Contacts between two bodies, a < b, with the normal pointing from a to b
+struct Manifold {
+    uint32_t a, b;
+    Vec3 normal;
+    uint32_t count;
+    ContactPoint points[kMaxPoints];
+};
+
+struct Island {
+    uint32_t firstBody, bodyCount;
+    uint32_t firstManifold, manifoldCount;
+};
+
+// A contact candidate, before reduction to kMaxPoints
+struct Candidate {
+    Vec3 position;
+    float separation;
+};
+
+// A body's linear and angular velocity while its island is solved, and the
+// push velocity that only moves it out of overlaps
+struct SolverBody {
+    float velocity[2][6];
+};
+
+enum Pass {
+    kPassVelocity,
+    kPassPush,
+    kPassBounce
+};
+
+// Lane-wide contact point rows: three axes (normal and two tangents), each
+// with the direction, the lever arms crossed with it, those arms scaled by
+// the bodies' inverse inertia, the effective mass and the impulse so far
+enum Row {
+    kDirection = 0,
+    kArmA = 3,
+    kArmB = 6,
+    kSpinA = 9,
+    kSpinB = 12,
+    kMass = 15,
+    kImpulse = 16,
+    kAxisRows = 17,
+
+    kNormal = 0,
+    kTangent1 = kAxisRows,
+    kTangent2 = 2 * kAxisRows,
+    // Target normal velocities: closing the gap of a speculative contact,
+    // pushing out of an overlap, and bouncing
+    kTarget = 3 * kAxisRows,
+    kPush,
+    kBounce,
+    kPushImpulse,
+    // 1 if the contact bounces
+    kBounces,
+    kFriction,
+    kInverseMassA,
+    kInverseMassB,
+    kRowCount
+};
+
+#if defined(LYS_SIMD_AVX)
+const uint32_t kLanes = 8;
+
+struct Wide {
+    __m256 v;
+};
+
+Wide load(const float *p) {
+    Wide w = {_mm256_loadu_ps(p)};
+    return w;
+}
+
+void store(float *p, const Wide &w) {
+    _mm256_storeu_ps(p, w.v);
+}
+
+Wide splat(float f) {
+    Wide w = {_mm256_set1_ps(f)};
+    return w;
+}
+
+Wide operator+(const Wide &a, const Wide &b) {
+    Wide w = {_mm256_add_ps(a.v, b.v)};
+    return w;
+}
+
+Wide operator-(const Wide &a, const Wide &b) {
+    Wide w = {_mm256_sub_ps(a.v, b.v)};
+    return w;
+}
+
+Wide operator*(const Wide &a, const Wide &b) {
+    Wide w = {_mm256_mul_ps(a.v, b.v)};
+    return w;
+}
+
+Wide min(const Wide &a, const Wide &b) {
+    Wide w = {_mm256_min_ps(a.v, b.v)};
+    return w;
+}
+
+Wide max(const Wide &a, const Wide &b) {
+    Wide w = {_mm256_max_ps(a.v, b.v)};
+    return w;
+}
+
+// 1 where a > 0, else 0
+Wide positive(const Wide &a) {
+    Wide w = {_mm256_and_ps(_mm256_cmp_ps(a.v, _mm256_setzero_ps(), _CMP_GT_OQ), _mm256_set1_ps(1.0f))};
+    return w;
+}
+#elif defined(LYS_SIMD_SSE2)
+const uint32_t kLanes = 4;
+
+struct Wide {
+    __m128 v;
+};
+
+Wide load(const float *p) {
+    Wide w = {_mm_loadu_ps(p)};
+    return w;
+}
+
+void store(float *p, const Wide &w) {
+    _mm_storeu_ps(p, w.v);
+}
+
+Wide splat(float f) {
+    Wide w = {_mm_set1_ps(f)};
+    return w;
+}
+
+Wide operator+(const Wide &a, const Wide &b) {
+    Wide w = {_mm_add_ps(a.v, b.v)};
+    return w;
+}
+
+Wide operator-(const Wide &a, const Wide &b) {
+    Wide w = {_mm_sub_ps(a.v, b.v)};
+    return w;
+}
+
+Wide operator*(const Wide &a, const Wide &b) {
+    Wide w = {_mm_mul_ps(a.v, b.v)};
+    return w;
+}
+
+Wide min(const Wide &a, const Wide &b) {
+    Wide w = {_mm_min_ps(a.v, b.v)};
+    return w;
+}
+
+Wide max(const Wide &a, const Wide &b) {
+    Wide w = {_mm_max_ps(a.v, b.v)};
+    return w;
+}
+
+Wide positive(const Wide &a) {
+    Wide w = {_mm_and_ps(_mm_cmpgt_ps(a.v, _mm_setzero_ps()), _mm_set1_ps(1.0f))};
+    return w;
+}
+#else
+const uint32_t kLanes = 4;
+
+struct Wide {
+    float v[4];
+};
+
+Wide load(const float *p) {
+    Wide w;
+    for (int i = 0; i < 4; ++i)
+        w.v[i] = p[i];
+    return w;
+}
+
+void store(float *p, const Wide &w) {
+    for (int i = 0; i < 4; ++i)
+        p[i] = w.v[i];
+}
+
+Wide splat(float f) {
+    Wide w = {{f, f, f, f}};
+    return w;
+}
+
+Wide operator+(const Wide &a, const Wide &b) {
+    Wide w;
+    for (int i = 0; i < 4; ++i)
+        w.v[i] = a.v[i] + b.v[i];
+    return w;
+}
+
+Wide operator-(const Wide &a, const Wide &b) {
+    Wide w;
+    for (int i = 0; i < 4; ++i)
+        w.v[i] = a.v[i] - b.v[i];
+    return w;
+}
+
+Wide operator*(const Wide &a, const Wide &b) {
+    Wide w;
+    for (int i = 0; i < 4; ++i)
+        w.v[i] = a.v[i] * b.v[i];
+    return w;
+}
+
+Wide min(const Wide &a, const Wide &b) {
+    Wide w;
+    for (int i = 0; i < 4; ++i)
+        w.v[i] = std::min(a.v[i], b.v[i]);
+    return w;
+}
+
+Wide max(const Wide &a, const Wide &b) {
+    Wide w;
+    for (int i = 0; i < 4; ++i)
+        w.v[i] = std::max(a.v[i], b.v[i]);
+    return w;
+}
+
+Wide positive(const Wide &a) {
+    Wide w;
+    for (int i = 0; i < 4; ++i)
+        w.v[i] = a.v[i] > 0.0f ? 1.0f : 0.0f;
+    return w;
+}
+#endif
+
+// Up to kLanes contact points, no two sharing a body other than the ground
+struct Batch {
+    uint32_t a[kLanes];
+    uint32_t b[kLanes];
+    // Manifold << 2 | point, or kNone for an empty lane
+    uint32_t contact[kLanes];
+    float rows[kRowCount][kLanes];
+};
+
+// The velocities of a batch's bodies, one lane per contact
+struct Lanes {
+    Wide va[3], wa[3], vb[3], wb[3];
+};
+
+void gather(const Batch &batch, const SolverBody *bodies, uint32_t set, Lanes *lanes) {
+    float values[12][kLanes];
+    for (uint32_t lane = 0; lane < kLanes; ++lane) {
+        const float *a = bodies[batch.a[lane]].velocity[set], *b = bodies[batch.b[lane]].velocity[set];
+        for (int k = 0; k < 6; ++k) {
+            values[k][lane] = a[k];
+            values[6 + k][lane] = b[k];
+        }
+    }
+    for (int k = 0; k < 3; ++k) {
+        lanes->va[k] = load(values[k]);
+        lanes->wa[k] = load(values[3 + k]);
+        lanes->vb[k] = load(values[6 + k]);
+        lanes->wb[k] = load(values[9 + k]);
+    }
+}
+
+// Lanes sharing the ground write back the same zero velocity, so no two
+// lanes ever race on a body
+void scatter(const Batch &batch, const Lanes &lanes, uint32_t set, SolverBody *bodies) {
+    float values[12][kLanes];
+    for (int k = 0; k < 3; ++k) {
+        store(values[k], lanes.va[k]);
+        store(values[3 + k], lanes.wa[k]);
+        store(values[6 + k], lanes.vb[k]);
+        store(values[9 + k], lanes.wb[k]);
+    }
+    for (uint32_t lane = 0; lane < kLanes; ++lane) {
+        float *a = bodies[batch.a[lane]].velocity[set];
+        for (int k = 0; k < 6; ++k)
+            a[k] = values[k][lane];
+        float *b = bodies[batch.b[lane]].velocity[set];
+        for (int k = 0; k < 6; ++k)
+            b[k] = values[6 + k][lane];
+    }
+}
+
+// Velocity of b relative to a along one axis
+Wide relativeVelocity(const Batch &batch, uint32_t axis, const Lanes &lanes) {
+    Wide sum = splat(0.0f);
+    for (int k = 0; k < 3; ++k) {
+        sum = sum + (lanes.vb[k] - lanes.va[k]) * load(batch.rows[axis + kDirection + k])
+              + lanes.wb[k] * load(batch.rows[axis + kArmB + k]) - lanes.wa[k] * load(batch.rows[axis + kArmA + k]);
+    }
+    return sum;
+}
+
+void applyImpulse(const Batch &batch, uint32_t axis, const Wide &impulse, Lanes *lanes) {
+    Wide linear_a = impulse * load(batch.rows[kInverseMassA]), linear_b = impulse * load(batch.rows[kInverseMassB]);
+    for (int k = 0; k < 3; ++k) {
+        Wide direction = load(batch.rows[axis + kDirection + k]);
+        lanes->va[k] = lanes->va[k] - direction * linear_a;
+        lanes->wa[k] = lanes->wa[k] - load(batch.rows[axis + kSpinA + k]) * impulse;
+        lanes->vb[k] = lanes->vb[k] + direction * linear_b;
+        lanes->wb[k] = lanes->wb[k] + load(batch.rows[axis + kSpinB + k]) * impulse;
+    }
+}
+
+void warmStart(const Batch &batch, SolverBody *bodies) {
+    Lanes lanes;
+    gather(batch, bodies, 0, &lanes);
+    applyImpulse(batch, kNormal, load(batch.rows[kNormal + kImpulse]), &lanes);
+    scatter(batch, lanes, 0, bodies);
+}
+
+// One sequential impulse pass over a batch's contacts. The velocity pass
+// keeps friction within the normal impulse's cone, then stops the bodies
+// closing in; the push pass works on the push velocities alone, so pushing
+// out of an overlap moves the bodies without speeding them up; the bounce
+// pass adds restitution to contacts that were hit hard enough
+void solveBatch(Batch *batch, Pass pass, SolverBody *bodies) {
+    Lanes lanes;
+    uint32_t set = pass == kPassPush ? 1 : 0;
+    gather(*batch, bodies, set, &lanes);
+    if (pass == kPassVelocity) {
+        Wide limit = load(batch->rows[kFriction]) * load(batch->rows[kNormal + kImpulse]);
+        Wide lower = splat(0.0f) - limit;
+        for (uint32_t axis = kTangent1; axis <= kTangent2; axis += kAxisRows) {
+            Wide old = load(batch->rows[axis + kImpulse]);
+            Wide impulse = old - load(batch->rows[axis + kMass]) * relativeVelocity(*batch, axis, lanes);
+            impulse = min(max(impulse, lower), limit);
+            store(batch->rows[axis + kImpulse], impulse);
+            applyImpulse(*batch, axis, impulse - old, &lanes);
+        }
+    }
+
+    uint32_t target = pass == kPassVelocity ? kTarget : (pass == kPassPush ? kPush : kBounce);
+    uint32_t accumulated = pass == kPassPush ? kPushImpulse : kNormal + kImpulse;
+    Wide old = load(batch->rows[accumulated]);
+    Wide change = load(batch->rows[kNormal + kMass])
+                  * (load(batch->rows[target]) - relativeVelocity(*batch, kNormal, lanes));
+    if (pass == kPassBounce)
+        change = change * load(batch->rows[kBounces]) * positive(old);
+    Wide impulse = max(old + change, splat(0.0f));
+    store(batch->rows[accumulated], impulse);
+    applyImpulse(*batch, kNormal, impulse - old, &lanes);
+    scatter(*batch, lanes, set, bodies);
+}
+
+// Clips a convex polygon to the side of a plane where dot(normal, x) <= offset
+uint32_t clip(const Vec3 *in, uint32_t count, const Vec3 &normal, float offset, Vec3 *out) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const Vec3 &p = in[i], &q = in[(i + 1) % count];
+        float dp = dot(normal, p) - offset, dq = dot(normal, q) - offset;
+        if (dp <= 0.0f)
+            out[kept++] = p;
+        if ((dp < 0.0f && dq > 0.0f) || (dp > 0.0f && dq < 0.0f))
+            out[kept++] = p + (q - p) * (dp / (dp - dq));
+    }
+    return kept;
+}
+
+// Keeps the deepest point, the one farthest from it, and the two spanning
+// the most area on either side of the line between those
+uint32_t reduce(const Candidate *candidates, uint32_t count, const Vec3 &normal, Candidate *out) {
+    if (count <= kMaxPoints) {
+        std::copy(candidates, candidates + count, out);
+        return count;
+    }
+    uint32_t first = 0;
+    for (uint32_t i = 1; i < count; ++i) {
+        if (candidates[i].separation < candidates[first].separation)
+            first = i;
+    }
+    uint32_t second = first;
+    float farthest = -1.0f;
+    for (uint32_t i = 0; i < count; ++i) {
+        Vec3 d = candidates[i].position - candidates[first].position;
+        if (dot(d, d) > farthest) {
+            farthest = dot(d, d);
+            second = i;
+        }
+    }
+    uint32_t third = first, fourth = first;
+    float most = 0.0f, least = 0.0f;
+    Vec3 line = candidates[second].position - candidates[first].position;
+    for (uint32_t i = 0; i < count; ++i) {
+        float area = dot(cross(line, candidates[i].position - candidates[first].position), normal);
+        if (area > most) {
+            most = area;
+            third = i;
+        }
+        if (area < least) {
+            least = area;
+            fourth = i;
+        }
+    }
+    uint32_t kept = 0;
+    uint32_t picks[] = {first, second, third, fourth};
+    for (uint32_t i = 0; i < kMaxPoints; ++i) {
+        if (i < 2 || picks[i] != first)
+            out[kept++] = candidates[picks[i]];
+    }
+    return kept;
+}
+
+void setPoints(const Candidate *candidates, uint32_t count, Manifold *manifold) {
+    manifold->count = count;
+    for (uint32_t i = 0; i < count; ++i) {
+        manifold->points[i].position = candidates[i].position;
+        manifold->points[i].separation = candidates[i].separation;
+    }
+}
+
+bool collideSpheres(const Body &a, const Body &b, float margin, Manifold *manifold) {
+    Vec3 d = b.position - a.position;
+    float distance = sqrtf(dot(d, d));
+    float separation = distance - a.halfExtents.x - b.halfExtents.x;
+    if (separation > margin)
+        return false;
+    Vec3 normal = distance > 1e-6f ? d * (1.0f / distance) : vec3(0.0f, 1.0f, 0.0f);
+    Candidate point = {a.position + normal * (a.halfExtents.x + separation * 0.5f), separation};
+    manifold->normal = normal;
+    setPoints(&point, 1, manifold);
+    return true;
+}
+
+// The normal points from the box to the sphere
+bool collideBoxSphere(const Body &box, const Body &sphere, float margin, Manifold *manifold) {
+    Vec3 center = box.basis.transposed(sphere.position - box.position);
+    const Vec3 &h = box.halfExtents;
+    float radius = sphere.halfExtents.x;
+    Vec3 closest = vec3(std::max(-h.x, std::min(center.x, h.x)), std::max(-h.y, std::min(center.y, h.y)),
+                        std::max(-h.z, std::min(center.z, h.z)));
+    Vec3 d = center - closest;
+    float distance = sqrtf(dot(d, d));
+    Vec3 normal;
+    float separation;
+    if (distance > 1e-6f) {
+        normal = d * (1.0f / distance);
+        separation = distance - radius;
+    } else {
+        // Center inside: out through the nearest face
+        int axis = 0;
+        float best = FLT_MAX;
+        for (int i = 0; i < 3; ++i) {
+            float depth = h[i] - fabsf(center[i]);
+            if (depth < best) {
+                best = depth;
+                axis = i;
+            }
+        }
+        float sign = center[axis] < 0.0f ? -1.0f : 1.0f;
+        normal = vec3(axis == 0 ? sign : 0.0f, axis == 1 ? sign : 0.0f, axis == 2 ? sign : 0.0f);
+        (&closest.x)[axis] = h[axis] * sign;
+        separation = -best - radius;
+    }
+    if (separation > margin)
+        return false;
+    Vec3 surface = center - normal * radius;
+    Candidate point = {box.position + box.basis * ((closest + surface) * 0.5f), separation};
+    manifold->normal = box.basis * normal;
+    setPoints(&point, 1, manifold);
+    return true;
+}
+
+// Clips the incident box's face most against the normal to the reference
+// box's face; the normal points out of the reference box
+uint32_t clipFaces(const Body &reference, int axis, const Vec3 &normal, const Body &incident, float margin,
+                   Candidate *out) {
+    int face = 0;
+    float most = -1.0f;
+    for (int i = 0; i < 3; ++i) {
+        float along = fabsf(dot(incident.basis.column(i), normal));
+        if (along > most) {
+            most = along;
+            face = i;
+        }
+    }
+    Vec3 face_normal = incident.basis.column(face) * (dot(incident.basis.column(face), normal) > 0.0f ? -1.0f : 1.0f);
+    Vec3 center = incident.position + face_normal * incident.halfExtents[face];
+    Vec3 u = incident.basis.column((face + 1) % 3) * incident.halfExtents[(face + 1) % 3];
+    Vec3 v = incident.basis.column((face + 2) % 3) * incident.halfExtents[(face + 2) % 3];
+    Vec3 polygon[8] = {center + u + v, center - u + v, center - u - v, center + u - v};
+    Vec3 clipped[8];
+    uint32_t count = 4;
+    for (int side = 1; side <= 2 && count > 0; ++side) {
+        int other = (axis + side) % 3;
+        Vec3 side_normal = reference.basis.column(other);
+        float offset = dot(side_normal, reference.position);
+        count = clip(polygon, count, side_normal, offset + reference.halfExtents[other], clipped);
+        count = clip(clipped, count, -side_normal, reference.halfExtents[other] - offset, polygon);
+    }
+
+    Vec3 surface = reference.position + normal * reference.halfExtents[axis];
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        float separation = dot(normal, polygon[i] - surface);
+        if (separation <= margin) {
+            Candidate candidate = {polygon[i] - normal * (separation * 0.5f), separation};
+            out[kept++] = candidate;
+        }
+    }
+    return kept;
+}
+
+// Separating axis test over the 15 axes, then face clipping or the closest
+// points of two edges; the normal points from a to b
+bool collideBoxes(const Body &a, const Body &b, float margin, Manifold *manifold) {
+    Vec3 t = b.position - a.position;
+    const Vec3 &ha = a.halfExtents, &hb = b.halfExtents;
+    float absolute[3][3];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j)
+            absolute[i][j] = fabsf(dot(a.basis.column(i), b.basis.column(j))) + 1e-6f;
+    }
+
+    float face_a = -FLT_MAX;
+    int axis_a = 0;
+    for (int i = 0; i < 3; ++i) {
+        float separation = fabsf(dot(t, a.basis.column(i)))
+                           - (ha[i] + hb.x * absolute[i][0] + hb.y * absolute[i][1] + hb.z * absolute[i][2]);
+        if (separation > margin)
+            return false;
+        if (separation > face_a) {
+            face_a = separation;
+            axis_a = i;
+        }
+    }
+    float face_b = -FLT_MAX;
+    int axis_b = 0;
+    for (int j = 0; j < 3; ++j) {
+        float separation = fabsf(dot(t, b.basis.column(j)))
+                           - (hb[j] + ha.x * absolute[0][j] + ha.y * absolute[1][j] + ha.z * absolute[2][j]);
+        if (separation > margin)
+            return false;
+        if (separation > face_b) {
+            face_b = separation;
+            axis_b = j;
+        }
+    }
+    float edge = -FLT_MAX;
+    int edge_a = 0, edge_b = 0;
+    Vec3 edge_axis = vec3(0.0f, 0.0f, 0.0f);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            Vec3 axis = cross(a.basis.column(i), b.basis.column(j));
+            float length = sqrtf(dot(axis, axis));
+            if (length < 1e-4f)
+                continue;
+            axis = axis * (1.0f / length);
+            float ra = 0.0f, rb = 0.0f;
+            for (int k = 0; k < 3; ++k) {
+                ra += ha[k] * fabsf(dot(a.basis.column(k), axis));
+                rb += hb[k] * fabsf(dot(b.basis.column(k), axis));
+            }
+            float separation = fabsf(dot(t, axis)) - ra - rb;
+            if (separation > margin)
+                return false;
+            if (separation > edge) {
+                edge = separation;
+                edge_a = i;
+                edge_b = j;
+                edge_axis = axis;
+            }
+        }
+    }
+
+    Candidate candidates[8], kept[kMaxPoints];
+    float face = face_a;
+    bool use_b = face_b > kAxisRelative * face_a + kAxisAbsolute;
+    if (use_b)
+        face = face_b;
+    if (edge > kAxisRelative * face + kAxisAbsolute) {
+        Vec3 axis = dot(edge_axis, t) < 0.0f ? -edge_axis : edge_axis;
+        Vec3 da = a.basis.column(edge_a), db = b.basis.column(edge_b);
+        Vec3 pa = a.position, pb = b.position;
+        for (int k = 0; k < 3; ++k) {
+            Vec3 ca = a.basis.column(k), cb = b.basis.column(k);
+            if (k != edge_a)
+                pa = pa + ca * (dot(ca, axis) > 0.0f ? ha[k] : -ha[k]);
+            if (k != edge_b)
+                pb = pb + cb * (dot(cb, axis) > 0.0f ? -hb[k] : hb[k]);
+        }
+        // Closest points of the two edges' lines, kept on the edges
+        Vec3 r = pa - pb;
+        float along = dot(da, db), c = dot(da, r), f = dot(db, r), denominator = 1.0f - along * along;
+        float s = denominator > 1e-6f ? (along * f - c) / denominator : 0.0f;
+        float u = denominator > 1e-6f ? (f - along * c) / denominator : 0.0f;
+        s = std::max(-ha[edge_a], std::min(s, ha[edge_a]));
+        u = std::max(-hb[edge_b], std::min(u, hb[edge_b]));
+        Vec3 on_a = pa + da * s, on_b = pb + db * u;
+        Candidate point = {(on_a + on_b) * 0.5f, dot(on_b - on_a, axis)};
+        manifold->normal = axis;
+        setPoints(&point, 1, manifold);
+        return true;
+    }
+
+    uint32_t count;
+    Vec3 normal;
+    if (use_b) {
+        normal = b.basis.column(axis_b) * (dot(t, b.basis.column(axis_b)) > 0.0f ? -1.0f : 1.0f);
+        count = clipFaces(b, axis_b, normal, a, margin, candidates);
+        normal = -normal;
+    } else {
+        normal = a.basis.column(axis_a) * (dot(t, a.basis.column(axis_a)) > 0.0f ? 1.0f : -1.0f);
+        count = clipFaces(a, axis_a, normal, b, margin, candidates);
+    }
+    if (count == 0)
+        return false;
+    manifold->normal = normal;
+    setPoints(kept, reduce(candidates, count, normal, kept), manifold);
+    return true;
+}
+
+bool collide(const Body &a, const Body &b, float margin, Manifold *manifold) {
+    if (a.shape == BodyShape::kSphere && b.shape == BodyShape::kSphere)
+        return collideSpheres(a, b, margin, manifold);
+    if (a.shape == BodyShape::kBox && b.shape == BodyShape::kBox)
+        return collideBoxes(a, b, margin, manifold);
+    if (a.shape == BodyShape::kBox)
+        return collideBoxSphere(a, b, margin, manifold);
+    if (!collideBoxSphere(b, a, margin, manifold))
+        return false;
+    manifold->normal = -manifold->normal;
+    return true;
+}
+
+// Two directions perpendicular to a unit normal and to each other
+void tangents(const Vec3 &normal, Vec3 *first, Vec3 *second) {
+    if (fabsf(normal.x) >= 0.57735f)
+        *first = vec3(normal.y, -normal.x, 0.0f);
+    else
+        *first = vec3(0.0f, normal.z, -normal.y);
+    *first = *first * (1.0f / sqrtf(dot(*first, *first)));
+    *second = cross(normal, *first);
+}
+
+// Found by one thread
+struct Scratch {
+    Vector<SolverBody> bodies;
+    Vector<uint64_t> colorMasks;
+    // A contact point's lane data, before it's placed in a batch
+    Vector<float> rows;
+    Vector<uint32_t> rowBodies;
+    Vector<uint32_t> rowContacts;
+    Vector<uint8_t> rowColors;
+    Vector<uint32_t> colorCounts;
+    Vector<Batch> batches;
+    uint32_t colors;
+    // Totals over the islands this thread solved
+    uint32_t mostColors;
+    uint32_t batchCount;
+    uint32_t slept;
+};
+}
+
+struct RigidBodyWorld::Impl {
+    explicit Impl(const RigidBodySettings &new_settings) {
+        settings = new_settings;
+        BroadphaseSettings broadphase_settings;
+        broadphase_settings.cellSize = settings.cellSize;
+        broadphase_settings.workers = settings.workers;
+        broadphase = new Broadphase(broadphase_settings);
+        seconds = 0.0f;
+        phase = kPhaseNarrow;
+        scratch.resize(settings.workers + 1);
+        generation = 0;
+        busy = 0;
+        quit = false;
+        next = 0;
+        awakeCounter = Profiler::global().counter("Awake bodies", false);
+        for (uint32_t i = 0; i < settings.workers; ++i)
+            threads.push_back(std::thread(&Impl::workerMain, this, i + 1));
+    }
+
+    ~Impl() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+        delete broadphase;
+    }
+
+    void workerMain(uint32_t index) {
+        uint32_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen = generation;
+            lock.unlock();
+            work(index);
+            lock.lock();
+            if (--busy == 0)
+                done.notify_all();
+        }
+    }
+
+    // Runs the given phase on every thread, returning when it's done
+    void run(Phase new_phase) {
+        phase = new_phase;
+        next = 0;
+        if (!threads.empty()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = static_cast<uint32_t>(threads.size());
+            ++generation;
+        }
+        wake.notify_all();
+        work(0);
+        if (!threads.empty()) {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&] { return busy == 0; });
+        }
+    }
+
+    void work(uint32_t thread) {
+        Scratch &mine = scratch[thread];
+        if (phase == kPhaseNarrow) {
+            uint32_t count = static_cast<uint32_t>(candidates.size());
+            for (uint32_t first = next.fetch_add(kBatchSize); first < count; first = next.fetch_add(kBatchSize)) {
+                uint32_t last = std::min(count, first + kBatchSize);
+                for (uint32_t i = first; i < last; ++i)
+                    narrowphase(i);
+            }
+        } else {
+            // Largest islands first, one at a time, so they spread evenly
+            uint32_t count = static_cast<uint32_t>(islandOrder.size());
+            for (uint32_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+                solveIsland(islandOrder[i], mine);
+        }
+    }
+
+    // Whether a body is simulated this step
+    bool active(const Body &body) const {
+        return body.awake && body.inverseMass > 0.0f;
+    }
+
+    void updateBasis(Body *body) {
+        body->basis = rotation(body->orientation);
+        const Mat3 &r = body->basis;
+        const Vec3 &d = body->inverseInertia;
+        for (int i = 0; i < 3; ++i) {
+            for (int k = 0; k < 3; ++k)
+                body->worldInverseInertia.m[i][k] = r.m[i][0] * d.x * r.m[k][0] + r.m[i][1] * d.y * r.m[k][1]
+                                                    + r.m[i][2] * d.z * r.m[k][2];
+        }
+    }
+
+    Box3Df bounds(const Body &body) const {
+        // Spheres keep their radius in all three
+        Vec3 extent = body.halfExtents;
+        if (body.shape == BodyShape::kBox) {
+            const Mat3 &r = body.basis;
+            const Vec3 &h = body.halfExtents;
+            extent = vec3(fabsf(r.m[0][0]) * h.x + fabsf(r.m[0][1]) * h.y + fabsf(r.m[0][2]) * h.z,
+                          fabsf(r.m[1][0]) * h.x + fabsf(r.m[1][1]) * h.y + fabsf(r.m[1][2]) * h.z,
+                          fabsf(r.m[2][0]) * h.x + fabsf(r.m[2][1]) * h.y + fabsf(r.m[2][2]) * h.z);
+        }
+        float margin = settings.contactMargin;
+        Vec3 half = extent + vec3(margin, margin, margin);
+        return Box3Df(toPoint(body.position - half), toPoint(body.position + half));
+    }
+
+    void wakeBody(uint32_t id) {
+        Body &body = bodies[id];
+        if (body.inverseMass == 0.0f || body.awake)
+            return;
+        uint32_t first = body.sleepFirst;
+        if (first == kNone) {
+            body.awake = true;
+            body.sleepTimer = 0.0f;
+            return;
+        }
+        for (uint32_t i = first; i != kNone;) {
+            Body &member = bodies[i];
+            uint32_t following = member.sleepNext;
+            member.awake = true;
+            member.sleepTimer = 0.0f;
+            member.sleepFirst = member.sleepNext = kNone;
+            i = following;
+        }
+    }
+
+    // Brings the proxies in line with the bodies: awake ones are dynamic,
+    // static and sleeping ones static
+    void syncProxies() {
+        for (uint32_t id = 0; id < bodies.size(); ++id) {
+            Body &body = bodies[id];
+            if (!body.alive)
+                continue;
+            ProxyMotion motion = active(body) ? ProxyMotion::kDynamic : ProxyMotion::kStatic;
+            if (motion != body.motion) {
+                broadphase->remove(body.proxy);
+                body.proxy = broadphase->add(bounds(body), motion, id);
+                body.motion = motion;
+            } else if (motion == ProxyMotion::kDynamic || body.moved) {
+                broadphase->move(body.proxy, bounds(body));
+            }
+            if (body.moved && body.inverseMass == 0.0f)
+                movedStatics.push_back(id);
+            else
+                body.moved = false;
+        }
+    }
+
+    void narrowphase(uint32_t index) {
+        Manifold &manifold = candidates[index];
+        manifold.count = 0;
+        const BroadphasePair &pair = broadphase->pairs()[index];
+        uint32_t a = broadphase->userData(pair.a), b = broadphase->userData(pair.b);
+        if (a > b)
+            std::swap(a, b);
+        const Body &body_a = bodies[a], &body_b = bodies[b];
+        if ((!active(body_a) && !active(body_b)) || !collide(body_a, body_b, settings.contactMargin, &manifold))
+            return;
+        manifold.a = a;
+        manifold.b = b;
+
+        // Warm start from the matching points of last step's manifold
+        const Manifold *last = nullptr;
+        uint64_t key = static_cast<uint64_t>(a) << 32 | b;
+        Vector<std::pair<uint64_t, uint32_t>>::const_iterator found = std::lower_bound(
+            previousKeys.begin(), previousKeys.end(), std::make_pair(key, 0u));
+        if (found != previousKeys.end() && found->first == key)
+            last = &previous[found->second];
+        float match = 4.0f * settings.contactMargin;
+        for (uint32_t i = 0; i < manifold.count; ++i) {
+            ContactPoint &point = manifold.points[i];
+            point.local = body_a.basis.transposed(point.position - body_a.position);
+            point.normalImpulse = 0.0f;
+            if (!last)
+                continue;
+            float closest = match * match;
+            for (uint32_t j = 0; j < last->count; ++j) {
+                Vec3 d = last->points[j].local - point.local;
+                if (dot(d, d) < closest) {
+                    closest = dot(d, d);
+                    point.normalImpulse = last->points[j].normalImpulse;
+                }
+            }
+        }
+    }
+
+    uint32_t find(uint32_t id) {
+        while (parents[id] != id) {
+            parents[id] = parents[parents[id]];
+            id = parents[id];
+        }
+        return id;
+    }
+
+    // Groups awake bodies joined by contacts, with their manifolds
+    void buildIslands() {
+        parents.resize(bodies.size());
+        for (uint32_t id = 0; id < bodies.size(); ++id)
+            parents[id] = id;
+        for (const Manifold &manifold : manifolds) {
+            if (active(bodies[manifold.a]) && active(bodies[manifold.b])) {
+                uint32_t a = find(manifold.a), b = find(manifold.b);
+                if (a != b)
+                    parents[std::max(a, b)] = std::min(a, b);
+            }
+        }
+
+        islands.clear();
+        for (uint32_t id = 0; id < bodies.size(); ++id) {
+            Body &body = bodies[id];
+            body.island = kNone;
+            if (!body.alive || !active(body))
+                continue;
+            uint32_t root = find(id);
+            if (root == id) {
+                body.island = static_cast<uint32_t>(islands.size());
+                Island island = {0, 0, 0, 0};
+                islands.push_back(island);
+            } else {
+                body.island = bodies[root].island;
+            }
+            ++islands[body.island].bodyCount;
+        }
+        for (const Manifold &manifold : manifolds) {
+            uint32_t island = bodies[manifold.a].island;
+            if (island == kNone)
+                island = bodies[manifold.b].island;
+            ++islands[island].manifoldCount;
+        }
+
+        uint32_t body_total = 0, manifold_total = 0;
+        for (Island &island : islands) {
+            island.firstBody = body_total;
+            island.firstManifold = manifold_total;
+            body_total += island.bodyCount;
+            manifold_total += island.manifoldCount;
+            island.bodyCount = island.manifoldCount = 0;
+        }
+        islandBodies.resize(body_total);
+        islandManifolds.resize(manifold_total);
+        for (uint32_t id = 0; id < bodies.size(); ++id) {
+            if (bodies[id].island != kNone) {
+                Island &island = islands[bodies[id].island];
+                islandBodies[island.firstBody + island.bodyCount++] = id;
+            }
+        }
+        for (uint32_t i = 0; i < manifolds.size(); ++i) {
+            uint32_t index = bodies[manifolds[i].a].island;
+            if (index == kNone)
+                index = bodies[manifolds[i].b].island;
+            Island &island = islands[index];
+            islandManifolds[island.firstManifold + island.manifoldCount++] = i;
+        }
+
+        islandOrder.resize(islands.size());
+        for (uint32_t i = 0; i < islands.size(); ++i)
+            islandOrder[i] = i;
+        std::stable_sort(islandOrder.begin(), islandOrder.end(), [&](uint32_t a, uint32_t b) {
+            return islands[a].manifoldCount > islands[b].manifoldCount;
+        });
+    }
+
+    // The lane data of one contact point
+    void prepare(const Manifold &manifold, uint32_t index, const SolverBody *solver_bodies, float *rows) {
+        const Body &a = bodies[manifold.a], &b = bodies[manifold.b];
+        const ContactPoint &point = manifold.points[index];
+        Vec3 arm_a = point.position - a.position, arm_b = point.position - b.position;
+        Vec3 directions[3];
+        directions[0] = manifold.normal;
+        tangents(manifold.normal, &directions[1], &directions[2]);
+        float inverse_mass_a = active(a) ? a.inverseMass : 0.0f, inverse_mass_b = active(b) ? b.inverseMass : 0.0f;
+        float impulses[3] = {point.normalImpulse, 0.0f, 0.0f};
+        for (uint32_t axis = 0; axis < 3; ++axis) {
+            float *row = rows + axis * kAxisRows;
+            Vec3 spin_a = cross(arm_a, directions[axis]), spin_b = cross(arm_b, directions[axis]);
+            Vec3 scaled_a = active(a) ? a.worldInverseInertia * spin_a : vec3(0.0f, 0.0f, 0.0f);
+            Vec3 scaled_b = active(b) ? b.worldInverseInertia * spin_b : vec3(0.0f, 0.0f, 0.0f);
+            for (int k = 0; k < 3; ++k) {
+                row[kDirection + k] = directions[axis][k];
+                row[kArmA + k] = spin_a[k];
+                row[kArmB + k] = spin_b[k];
+                row[kSpinA + k] = scaled_a[k];
+                row[kSpinB + k] = scaled_b[k];
+            }
+            float effective = inverse_mass_a + inverse_mass_b + dot(spin_a, scaled_a) + dot(spin_b, scaled_b);
+            row[kMass] = effective > 0.0f ? 1.0f / effective : 0.0f;
+            row[kImpulse] = impulses[axis];
+        }
+
+        // Speculative contacts let the bodies close the gap, but no more
+        float inverse_step = 1.0f / seconds;
+        float separation = point.separation;
+        rows[kTarget] = separation > 0.0f ? -separation * inverse_step : 0.0f;
+        float overlap = std::max(-separation - settings.allowedPenetration, 0.0f);
+        rows[kPush] = settings.correction * overlap * inverse_step;
+        rows[kPushImpulse] = 0.0f;
+
+        const float *va = solver_bodies[active(a) ? a.slot : 0].velocity[0];
+        const float *vb = solver_bodies[active(b) ? b.slot : 0].velocity[0];
+        float approach = 0.0f;
+        for (int k = 0; k < 3; ++k)
+            approach += (vb[k] - va[k]) * manifold.normal[k] + vb[3 + k] * rows[kArmB + k] - va[3 + k] * rows[kArmA + k];
+        float restitution = std::max(a.restitution, b.restitution);
+        rows[kBounces] = restitution > 0.0f && approach < -kBounceSpeed ? 1.0f : 0.0f;
+        rows[kBounce] = -restitution * approach;
+        rows[kFriction] = std::max(a.friction, b.friction);
+        rows[kInverseMassA] = inverse_mass_a;
+        rows[kInverseMassB] = inverse_mass_b;
+    }
+
+    // Colors an island's contact points and packs each color into batches
+    void buildBatches(const Island &island, Scratch &mine) {
+        uint32_t point_total = 0;
+        for (uint32_t i = 0; i < island.manifoldCount; ++i)
+            point_total += manifolds[islandManifolds[island.firstManifold + i]].count;
+        mine.rows.resize(static_cast<size_t>(point_total) * kRowCount);
+        mine.rowBodies.resize(point_total * 2);
+        mine.rowContacts.resize(point_total);
+        mine.rowColors.resize(point_total);
+        mine.colorMasks.assign(island.bodyCount + 1, 0);
+        mine.colorCounts.assign(kMaxColors + 1, 0);
+
+        uint32_t row = 0;
+        for (uint32_t i = 0; i < island.manifoldCount; ++i) {
+            uint32_t index = islandManifolds[island.firstManifold + i];
+            const Manifold &manifold = manifolds[index];
+            uint32_t a = active(bodies[manifold.a]) ? bodies[manifold.a].slot : 0;
+            uint32_t b = active(bodies[manifold.b]) ? bodies[manifold.b].slot : 0;
+            for (uint32_t point = 0; point < manifold.count; ++point, ++row) {
+                prepare(manifold, point, mine.bodies.data(), &mine.rows[static_cast<size_t>(row) * kRowCount]);
+                mine.rowBodies[row * 2] = a;
+                mine.rowBodies[row * 2 + 1] = b;
+                mine.rowContacts[row] = index << 2 | point;
+
+                // The first color neither body has used; the ground is free
+                uint64_t used = (a ? mine.colorMasks[a] : 0) | (b ? mine.colorMasks[b] : 0);
+                uint32_t color = kMaxColors;
+                if (~used != 0) {
+                    color = static_cast<uint32_t>(__builtin_ctzll(~used));
+                    if (a)
+                        mine.colorMasks[a] |= 1ull << color;
+                    if (b)
+                        mine.colorMasks[b] |= 1ull << color;
+                }
+                mine.rowColors[row] = static_cast<uint8_t>(color);
+                ++mine.colorCounts[color];
+            }
+        }
+
+        // Batches per color, each color padded to whole batches; points past
+        // the last color get a batch each
+        uint32_t batch_total = 0;
+        mine.colors = 0;
+        for (uint32_t color = 0; color <= kMaxColors; ++color) {
+            uint32_t count = mine.colorCounts[color];
+            if (count > 0 && color < kMaxColors)
+                mine.colors = color + 1;
+            mine.colorCounts[color] = batch_total * kLanes;
+            batch_total += color < kMaxColors ? (count + kLanes - 1) / kLanes : count;
+        }
+        mine.batches.resize(batch_total);
+        for (Batch &batch : mine.batches) {
+            std::fill(batch.a, batch.a + kLanes, 0u);
+            std::fill(batch.b, batch.b + kLanes, 0u);
+            std::fill(batch.contact, batch.contact + kLanes, kNone);
+            std::fill(&batch.rows[0][0], &batch.rows[0][0] + kRowCount * kLanes, 0.0f);
+        }
+        for (uint32_t i = 0; i < point_total; ++i) {
+            uint32_t color = mine.rowColors[i];
+            uint32_t slot = mine.colorCounts[color];
+            mine.colorCounts[color] += color < kMaxColors ? 1 : kLanes;
+            Batch &batch = mine.batches[slot / kLanes];
+            uint32_t lane = slot % kLanes;
+            batch.a[lane] = mine.rowBodies[i * 2];
+            batch.b[lane] = mine.rowBodies[i * 2 + 1];
+            batch.contact[lane] = mine.rowContacts[i];
+            const float *rows = &mine.rows[static_cast<size_t>(i) * kRowCount];
+            for (uint32_t k = 0; k < kRowCount; ++k)
+                batch.rows[k][lane] = rows[k];
+        }
+    }
+
+    // Moves a body by its velocity plus its push, keeping only the velocity
+    void integrate(Body *body, const SolverBody &solver) {
+        const float *v = solver.velocity[0], *push = solver.velocity[1];
+        body->velocity = vec3(v[0], v[1], v[2]);
+        body->angular = vec3(v[3], v[4], v[5]);
+        body->position = body->position + (body->velocity + vec3(push[0], push[1], push[2])) * seconds;
+        Vec3 w = body->angular + vec3(push[3], push[4], push[5]);
+        const Quat &q = body->orientation;
+        float h = 0.5f * seconds;
+        Quat spun = {q.x + h * (w.x * q.w + w.y * q.z - w.z * q.y), q.y + h * (w.y * q.w + w.z * q.x - w.x * q.z),
+                     q.z + h * (w.z * q.w + w.x * q.y - w.y * q.x), q.w - h * (w.x * q.x + w.y * q.y + w.z * q.z)};
+        body->orientation = normalize(spun);
+        updateBasis(body);
+    }
+
+    void solveIsland(uint32_t index, Scratch &mine) {
+        const Island &island = islands[index];
+        mine.bodies.resize(island.bodyCount + 1);
+        SolverBody ground = {{{0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}}};
+        mine.bodies[0] = ground;
+        Vec3 gravity = toVec3(settings.gravity) * seconds;
+        for (uint32_t i = 0; i < island.bodyCount; ++i) {
+            Body &body = bodies[islandBodies[island.firstBody + i]];
+            body.slot = i + 1;
+            Vec3 v = body.velocity + gravity;
+            const Vec3 &w = body.angular;
+            SolverBody solver = {{{v.x, v.y, v.z, w.x, w.y, w.z}, {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}}};
+            mine.bodies[i + 1] = solver;
+        }
+
+        mine.batches.clear();
+        mine.colors = 0;
+        if (island.manifoldCount > 0) {
+            buildBatches(island, mine);
+            for (const Batch &batch : mine.batches)
+                warmStart(batch, mine.bodies.data());
+            for (uint32_t i = 0; i < settings.iterations; ++i) {
+                for (Batch &batch : mine.batches)
+                    solveBatch(&batch, kPassVelocity, mine.bodies.data());
+            }
+            for (Batch &batch : mine.batches)
+                solveBatch(&batch, kPassBounce, mine.bodies.data());
+            for (uint32_t i = 0; i < settings.iterations; ++i) {
+                for (Batch &batch : mine.batches)
+                    solveBatch(&batch, kPassPush, mine.bodies.data());
+            }
+            for (const Batch &batch : mine.batches) {
+                for (uint32_t lane = 0; lane < kLanes; ++lane) {
+                    if (batch.contact[lane] == kNone)
+                        continue;
+                    ContactPoint &point = manifolds[batch.contact[lane] >> 2].points[batch.contact[lane] & 3];
+                    point.normalImpulse = batch.rows[kNormal + kImpulse][lane];
+                }
+            }
+        }
+
+        // Move the bodies, and see whether the island can sleep
+        float sleep_speed = settings.sleepSpeed * settings.sleepSpeed, still = FLT_MAX;
+        for (uint32_t i = 0; i < island.bodyCount; ++i) {
+            Body &body = bodies[islandBodies[island.firstBody + i]];
+            integrate(&body, mine.bodies[i + 1]);
+            if (dot(body.velocity, body.velocity) < sleep_speed && dot(body.angular, body.angular) < sleep_speed)
+                body.sleepTimer += seconds;
+            else
+                body.sleepTimer = 0.0f;
+            still = std::min(still, body.sleepTimer);
+        }
+        if (still >= settings.sleepTime) {
+            uint32_t first = islandBodies[island.firstBody];
+            for (uint32_t i = 0; i < island.bodyCount; ++i) {
+                Body &body = bodies[islandBodies[island.firstBody + i]];
+                body.awake = false;
+                body.velocity = body.angular = vec3(0.0f, 0.0f, 0.0f);
+                body.sleepFirst = first;
+                body.sleepNext = i + 1 < island.bodyCount ? islandBodies[island.firstBody + i + 1] : kNone;
+            }
+            ++mine.slept;
+        }
+        mine.batchCount += static_cast<uint32_t>(mine.batches.size());
+        mine.mostColors = std::max(mine.mostColors, mine.colors);
+    }
+
+    void step(float new_seconds) {
+        LYS_PROFILE_ZONE("Rigid body step");
+        int64_t start = now();
+        seconds = new_seconds;
+        stats = RigidBodyStats();
+
+        syncProxies();
+        broadphase->update();
+        const Vector<BroadphasePair> &pairs = broadphase->pairs();
+        int64_t broadphase_end = now();
+
+        // Anything moving that reaches a sleeping island wakes all of it,
+        // before its contacts are generated. So does a static body that was
+        // moved there
+        for (const BroadphasePair &pair : pairs) {
+            uint32_t a = broadphase->userData(pair.a), b = broadphase->userData(pair.b);
+            const Body &body_a = bodies[a], &body_b = bodies[b];
+            if (((active(body_a) && body_a.sleepTimer == 0.0f) || body_a.moved) && !body_b.awake)
+                wakeBody(b);
+            else if (((active(body_b) && body_b.sleepTimer == 0.0f) || body_b.moved) && !body_a.awake)
+                wakeBody(a);
+        }
+        for (uint32_t id : movedStatics)
+            bodies[id].moved = false;
+        movedStatics.clear();
+
+        candidates.resize(pairs.size());
+        run(kPhaseNarrow);
+        manifolds.clear();
+        for (const Manifold &manifold : candidates) {
+            if (manifold.count > 0) {
+                manifolds.push_back(manifold);
+                stats.contacts += manifold.count;
+            }
+        }
+        int64_t narrowphase_end = now();
+
+        buildIslands();
+        for (Scratch &s : scratch) {
+            s.slept = 0;
+            s.batchCount = 0;
+            s.mostColors = 0;
+        }
+        run(kPhaseSolve);
+        for (Scratch &s : scratch) {
+            stats.sleptIslands += s.slept;
+            stats.batches += s.batchCount;
+            stats.colors = std::max(stats.colors, s.mostColors);
+        }
+
+        // This step's manifolds warm start the next
+        previous.swap(manifolds);
+        previousKeys.resize(previous.size());
+        for (uint32_t i = 0; i < previous.size(); ++i)
+            previousKeys[i] = std::make_pair(static_cast<uint64_t>(previous[i].a) << 32 | previous[i].b, i);
+        std::sort(previousKeys.begin(), previousKeys.end());
+
+        for (const Body &body : bodies) {
+            if (body.alive) {
+                ++stats.bodies;
+                if (active(body))
+                    ++stats.awakeBodies;
+            }
+        }
+        freeIds.insert(freeIds.end(), removedIds.begin(), removedIds.end());
+        removedIds.clear();
+        stats.manifolds = static_cast<uint32_t>(previous.size());
+        stats.islands = static_cast<uint32_t>(islands.size());
+        stats.iterations = settings.iterations;
+        int64_t end = now();
+        stats.broadphaseMs = (broadphase_end - start) / 1.0e6f;
+        stats.narrowphaseMs = (narrowphase_end - broadphase_end) / 1.0e6f;
+        stats.solverMs = (end - narrowphase_end) / 1.0e6f;
+        stats.stepMs = (end - start) / 1.0e6f;
+        Profiler::global().set(awakeCounter, stats.awakeBodies);
+    }
+
+    // Wakes the bodies whose boxes overlapped this one's at the last step
+    void wakeNeighbours(uint32_t id) {
+        uint32_t proxy = bodies[id].proxy;
+        for (const BroadphasePair &pair : broadphase->pairs()) {
+            if (pair.a == proxy)
+                wakeBody(broadphase->userData(pair.b));
+            else if (pair.b == proxy)
+                wakeBody(broadphase->userData(pair.a));
+        }
+    }
+
+    // Wakes a changed body, and flags its proxy if it stays static. A
+    // static body never sleeps, so what may be resting on it is woken
+    // instead
+    void touch(uint32_t id) {
+        if (bodies[id].inverseMass == 0.0f)
+            wakeNeighbours(id);
+        wakeBody(id);
+        bodies[id].moved = true;
+    }
+
+    RigidBodySettings settings;
+    Broadphase *broadphase;
+    Vector<Body> bodies;
+    Vector<uint32_t> freeIds;
+    Vector<uint32_t> removedIds;
+    Vector<uint32_t> movedStatics;
+    RigidBodyStats stats;
+    uint32_t awakeCounter;
+    float seconds;
+
+    // One per broadphase pair, then the touching ones
+    Vector<Manifold> candidates;
+    Vector<Manifold> manifolds;
+    // Last step's manifolds, and their a << 32 | b keys, sorted
+    Vector<Manifold> previous;
+    Vector<std::pair<uint64_t, uint32_t>> previousKeys;
+
+    Vector<uint32_t> parents;
+    Vector<Island> islands;
+    Vector<uint32_t> islandBodies;
+    Vector<uint32_t> islandManifolds;
+    Vector<uint32_t> islandOrder;
+
+    // Shared with the worker threads
+    Phase phase;
+    Vector<Scratch> scratch;
+    Vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint32_t generation;
+    uint32_t busy;
+    bool quit;
+    std::atomic<uint32_t> next;
+};
+
+
+LYS_API RigidBodyWorld::RigidBodyWorld(const RigidBodySettings &settings) {
+    pimpl_ = new Impl(settings);
+}
+
+
+LYS_API RigidBodyWorld::~RigidBodyWorld() {
+    delete pimpl_;
+}
+
+
+LYS_API const RigidBodySettings& RigidBodyWorld::settings() const {
+    return pimpl_->settings;
+}
+
+
+LYS_API uint32_t RigidBodyWorld::add(const RigidBodyDesc &desc) {
+    Impl &impl = *pimpl_;
+    uint32_t id;
+    if (impl.freeIds.empty()) {
+        id = static_cast<uint32_t>(impl.bodies.size());
+        impl.bodies.push_back(Body());
+    } else {
+        id = impl.freeIds.back();
+        impl.freeIds.pop_back();
+    }
+
+    Body &body = impl.bodies[id];
+    body.shape = desc.shape;
+    body.halfExtents = toVec3(desc.halfExtents);
+    if (desc.shape == BodyShape::kSphere)
+        body.halfExtents = vec3(desc.halfExtents.x(), desc.halfExtents.x(), desc.halfExtents.x());
+    body.position = toVec3(desc.position);
+    Quat orientation = {desc.orientation[0], desc.orientation[1], desc.orientation[2], desc.orientation[3]};
+    body.orientation = normalize(orientation);
+    body.velocity = toVec3(desc.velocity);
+    body.angular = toVec3(desc.angularVelocity);
+    body.friction = desc.friction;
+    body.restitution = desc.restitution;
+    body.inverseMass = desc.mass > 0.0f ? 1.0f / desc.mass : 0.0f;
+    body.inverseInertia = vec3(0.0f, 0.0f, 0.0f);
+    if (desc.mass > 0.0f) {
+        const Vec3 &h = body.halfExtents;
+        if (desc.shape == BodyShape::kSphere) {
+            float inertia = 0.4f * desc.mass * h.x * h.x;
+            body.inverseInertia = vec3(1.0f / inertia, 1.0f / inertia, 1.0f / inertia);
+        } else {
+            float third = desc.mass / 3.0f;
+            body.inverseInertia = vec3(1.0f / (third * (h.y * h.y + h.z * h.z)),
+                                       1.0f / (third * (h.x * h.x + h.z * h.z)),
+                                       1.0f / (third * (h.x * h.x + h.y * h.y)));
+        }
+    } else {
+        body.velocity = body.angular = vec3(0.0f, 0.0f, 0.0f);
+    }
+    impl.updateBasis(&body);
+    body.sleepTimer = 0.0f;
+    body.island = kNone;
+    body.slot = 0;
+    body.sleepFirst = body.sleepNext = kNone;
+    body.alive = true;
+    body.awake = desc.mass > 0.0f;
+    body.moved = false;
+    body.motion = impl.active(body) ? ProxyMotion::kDynamic : ProxyMotion::kStatic;
+    body.proxy = impl.broadphase->add(impl.bounds(body), body.motion, id);
+    return id;
+}
+
+
+LYS_API void RigidBodyWorld::remove(uint32_t body) {
+    Impl &impl = *pimpl_;
+    Body &removed = impl.bodies[body];
+    if (!removed.alive)
+        return;
+    // Its sleeping island may be resting on it
+    impl.wakeBody(body);
+    impl.wakeNeighbours(body);
+    impl.broadphase->remove(removed.proxy);
+    removed.alive = false;
+    removed.awake = false;
+    impl.removedIds.push_back(body);
+}
+
+
+LYS_API Point3Df RigidBodyWorld::position(uint32_t body) const {
+    return toPoint(pimpl_->bodies[body].position);
+}
+
+
+LYS_API void RigidBodyWorld::position(uint32_t body, const Point3Df &position) {
+    pimpl_->bodies[body].position = toVec3(position);
+    pimpl_->touch(body);
+}
+
+
+LYS_API const float* RigidBodyWorld::orientation(uint32_t body) const {
+    return &pimpl_->bodies[body].orientation.x;
+}
+
+
+LYS_API void RigidBodyWorld::orientation(uint32_t body, const float *orientation) {
+    Body &turned = pimpl_->bodies[body];
+    Quat q = {orientation[0], orientation[1], orientation[2], orientation[3]};
+    turned.orientation = normalize(q);
+    pimpl_->updateBasis(&turned);
+    pimpl_->touch(body);
+}
+
+
+LYS_API Point3Df RigidBodyWorld::velocity(uint32_t body) const {
+    return toPoint(pimpl_->bodies[body].velocity);
+}
+
+
+LYS_API void RigidBodyWorld::velocity(uint32_t body, const Point3Df &velocity) {
+    Body &changed = pimpl_->bodies[body];
+    if (changed.inverseMass == 0.0f)
+        return;
+    changed.velocity = toVec3(velocity);
+    pimpl_->wakeBody(body);
+}
+
+
+LYS_API Point3Df RigidBodyWorld::angularVelocity(uint32_t body) const {
+    return toPoint(pimpl_->bodies[body].angular);
+}
+
+
+LYS_API void RigidBodyWorld::angularVelocity(uint32_t body, const Point3Df &angular_velocity) {
+    Body &changed = pimpl_->bodies[body];
+    if (changed.inverseMass == 0.0f)
+        return;
+    changed.angular = toVec3(angular_velocity);
+    pimpl_->wakeBody(body);
+}
+
+
+LYS_API void RigidBodyWorld::applyImpulse(uint32_t body, const Point3Df &impulse, const Point3Df &point) {
+    Body &pushed = pimpl_->bodies[body];
+    if (pushed.inverseMass == 0.0f)
+        return;
+    Vec3 j = toVec3(impulse);
+    pushed.velocity = pushed.velocity + j * pushed.inverseMass;
+    pushed.angular = pushed.angular + pushed.worldInverseInertia * cross(toVec3(point) - pushed.position, j);
+    pimpl_->wakeBody(body);
+}
+
+
+LYS_API bool RigidBodyWorld::awake(uint32_t body) const {
+    return pimpl_->active(pimpl_->bodies[body]);
+}
+
+
+LYS_API void RigidBodyWorld::wake(uint32_t body) {
+    pimpl_->wakeBody(body);
+}
+
+
+LYS_API void RigidBodyWorld::transform(uint32_t body, float *matrix) const {
+    const Body &drawn = pimpl_->bodies[body];
+    for (int column = 0; column < 3; ++column) {
+        for (int row = 0; row < 3; ++row)
+            matrix[column * 4 + row] = drawn.basis.m[row][column];
+        matrix[column * 4 + 3] = 0.0f;
+    }
+    matrix[12] = drawn.position.x;
+    matrix[13] = drawn.position.y;
+    matrix[14] = drawn.position.z;
+    matrix[15] = 1.0f;
+}
+
+
+LYS_API void RigidBodyWorld::step(float seconds) {
+    pimpl_->step(seconds);
+}
+
+
+LYS_API const RigidBodyStats& RigidBodyWorld::stats() const {
+    return pimpl_->stats;
+}
+}
@@ -0,0 +1,277 @@
+/***************************************************
+* SceneTarget.cc: Scaled offscreen scene rendering *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "SceneTarget.h"
+
+#include <math.h>
+#include <algorithm>
+
+#include "GLES2/gl2.h"
+#include "GLES2/gl2ext.h"
+#include <SDL2/SDL_video.h>
+
+#include "config.h"
+#include "types.h"
+#include "GLState.h"
+#include "ResourceRegistry.h"
+
+namespace lys3d {
+namespace {
+const char* kUpscaleVS =
+    "attribute vec2 a_position;\n"
+    "uniform vec2 u_uvScale;\n"
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "    v_texcoord = (a_position * 0.5 + 0.5) * u_uvScale;\n"
+    "    gl_Position = vec4(a_position, 0.0, 1.0);\n"
+    "}\n";
+
+// Clamped so bilinear filtering never reaches past the scene's corner
+const char* kUpscaleFS =
+    "uniform sampler2D u_scene;\n"
+    "uniform vec2 u_uvMax;\n"
+    "varying vec2 v_texcoord;\n"
+    "void main() {\n"
+    "    gl_FragColor = texture2D(u_scene, min(v_texcoord, u_uvMax));\n"
+    "}\n";
+
+// One triangle covering the screen
+const float kTriangle[6] = {-1.0f, -1.0f, 3.0f, -1.0f, -1.0f, 3.0f};
+}
+
+
+SceneTarget::SceneTarget() {
+    buffer_ = 0;
+    texture_ = 0;
+    depth_ = 0;
+    framebuffer_ = 0;
+    uvScaleLocation_ = -1;
+    uvMaxLocation_ = -1;
+    failed_ = false;
+    discard_ = nullptr;
+    genQueries_ = nullptr;
+    deleteQueries_ = nullptr;
+    beginQuery_ = nullptr;
+    endQuery_ = nullptr;
+    getQueryuiv_ = nullptr;
+    getQueryui64v_ = nullptr;
+    for (uint32_t i = 0; i < kTimerQueries; ++i) {
+        queries_[i] = 0;
+        pending_[i] = false;
+    }
+    nextQuery_ = 0;
+    timing_ = false;
+    extensionsChecked_ = false;
+    gpuMs_ = -1.0f;
+    layout_.add(kAttribPosition, 2, VertexFormat::kFloat);
+}
+
+
+SceneTarget::~SceneTarget() {
+    destroyTarget();
+    ResourceRegistry::global().release(GpuResourceType::kBuffer, buffer_);
+    if (deleteQueries_ != nullptr && queries_[0] != 0)
+        deleteQueries_(kTimerQueries, queries_);
+}
+
+
+bool SceneTarget::create(const Dimension2Di32 &size) {
+    destroyTarget();
+    ResourceRegistry &registry = ResourceRegistry::global();
+    if (buffer_ == 0) {
+        if (!program_.build(kUpscaleVS, kUpscaleFS))
+            return false;
+        uvScaleLocation_ = program_.uniformLocation("u_uvScale");
+        uvMaxLocation_ = program_.uniformLocation("u_uvMax");
+        program_.use();
+        glUniform1i(program_.uniformLocation("u_scene"), 0);
+
+        glGenBuffers(1, &buffer_);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(kTriangle), kTriangle, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        registry.track(GpuResourceType::kBuffer, buffer_, sizeof(kTriangle));
+    }
+
+    GLsizei width = size.width(), height = size.height();
+    glGenTextures(1, &texture_);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &depth_);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &framebuffer_);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_);
+    bool complete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+    uint64_t pixels = static_cast<uint64_t>(width) * static_cast<uint64_t>(height);
+    registry.track(GpuResourceType::kTexture, texture_, pixels * 4);
+    registry.track(GpuResourceType::kRenderbuffer, depth_, pixels * 2);
+    registry.track(GpuResourceType::kFramebuffer, framebuffer_, 0);
+    if (!complete) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        destroyTarget();
+        return false;
+    }
+    size_ = size;
+    return true;
+}
+
+
+void SceneTarget::destroyTarget() {
+    ResourceRegistry &registry = ResourceRegistry::global();
+    registry.release(GpuResourceType::kFramebuffer, framebuffer_);
+    registry.release(GpuResourceType::kRenderbuffer, depth_);
+    registry.release(GpuResourceType::kTexture, texture_);
+    framebuffer_ = 0;
+    depth_ = 0;
+    texture_ = 0;
+    size_ = Dimension2Di32();
+}
+
+
+void SceneTarget::checkExtensions() {
+    if (extensionsChecked_)
+        return;
+    extensionsChecked_ = true;
+    if (SDL_GL_ExtensionSupported("GL_EXT_discard_framebuffer") == SDL_TRUE)
+        discard_ = (PFN_glDiscardFramebufferEXT)SDL_GL_GetProcAddress("glDiscardFramebufferEXT");
+    if (SDL_GL_ExtensionSupported("GL_EXT_disjoint_timer_query") != SDL_TRUE)
+        return;
+    genQueries_ = (PFN_glGenQueriesEXT)SDL_GL_GetProcAddress("glGenQueriesEXT");
+    deleteQueries_ = (PFN_glDeleteQueriesEXT)SDL_GL_GetProcAddress("glDeleteQueriesEXT");
+    beginQuery_ = (PFN_glBeginQueryEXT)SDL_GL_GetProcAddress("glBeginQueryEXT");
+    endQuery_ = (PFN_glEndQueryEXT)SDL_GL_GetProcAddress("glEndQueryEXT");
+    getQueryuiv_ = (PFN_glGetQueryObjectuivEXT)SDL_GL_GetProcAddress("glGetQueryObjectuivEXT");
+    getQueryui64v_ = (PFN_glGetQueryObjectui64vEXT)SDL_GL_GetProcAddress("glGetQueryObjectui64vEXT");
+    if (genQueries_ && deleteQueries_ && beginQuery_ && endQuery_ && getQueryuiv_ && getQueryui64v_)
+        genQueries_(kTimerQueries, queries_);
+}
+
+
+bool SceneTarget::begin(const Dimension2Di32 &native, float scale, float max_scale) {
+    checkExtensions();
+
+    // Reallocate only when the window (or the largest scale) changes size
+    Dimension2Di32 wanted(std::max(1, static_cast<int32_t>(ceilf(native.width() * max_scale))),
+                          std::max(1, static_cast<int32_t>(ceilf(native.height() * max_scale))));
+    if (!failed_ && (wanted.width() != size_.width() || wanted.height() != size_.height()))
+        failed_ = !create(wanted);
+    native_ = native;
+    if (failed_) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        viewport_ = native;
+        glViewport(0, 0, native.width(), native.height());
+        return false;
+    }
+
+    scale = std::min(scale, max_scale);
+    int32_t width = static_cast<int32_t>(lroundf(native.width() * scale));
+    int32_t height = static_cast<int32_t>(lroundf(native.height() * scale));
+    viewport_ = Dimension2Di32(std::max(1, std::min(size_.width(), width)),
+                               std::max(1, std::min(size_.height(), height)));
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glViewport(0, 0, viewport_.width(), viewport_.height());
+
+    // Clearing everything is what lets a tiler skip loading the old contents
+    glDisable(GL_SCISSOR_TEST);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    return true;
+}
+
+
+void SceneTarget::end() {
+    if (failed_ || framebuffer_ == 0)
+        return;
+
+    // Depth is done with; color gets stored for the upscale
+    if (discard_ != nullptr) {
+        GLenum attachment = GL_DEPTH_ATTACHMENT;
+        discard_(GL_FRAMEBUFFER, 1, &attachment);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, native_.width(), native_.height());
+
+    GLStateSnapshot saved;
+    saveGLState(kGLStateCapabilities | kGLStateBindings, &saved);
+    glActiveTexture(GL_TEXTURE0);
+
+    setGLCapability(GL_BLEND, false);
+    setGLCapability(GL_DEPTH_TEST, false);
+    setGLCapability(GL_CULL_FACE, false);
+    setGLCapability(GL_SCISSOR_TEST, false);
+    program_.use();
+    float u = static_cast<float>(viewport_.width()) / size_.width();
+    float v = static_cast<float>(viewport_.height()) / size_.height();
+    glUniform2f(uvScaleLocation_, u, v);
+    glUniform2f(uvMaxLocation_, u - 0.5f / size_.width(), v - 0.5f / size_.height());
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+    layout_.apply();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    layout_.disable();
+    restoreGLState(saved);
+}
+
+
+void SceneTarget::beginTiming() {
+    checkExtensions();
+    if (queries_[0] == 0)
+        return;
+
+    // Collect finished queries, oldest first; a disjoint event (e.g. a
+    // clock change) spoils everything in flight
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    for (uint32_t i = 0; i < kTimerQueries; ++i) {
+        uint32_t index = (nextQuery_ + i) % kTimerQueries;
+        if (!pending_[index])
+            continue;
+        GLuint available = 0;
+        getQueryuiv_(queries_[index], GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+        if (!available)
+            break;
+        GLuint64 nanoseconds = 0;
+        getQueryui64v_(queries_[index], GL_QUERY_RESULT_EXT, &nanoseconds);
+        pending_[index] = false;
+        if (!disjoint)
+            gpuMs_ = static_cast<float>(nanoseconds / 1.0e6);
+    }
+
+    // Skip the frame rather than wait if every query is still in flight
+    if (pending_[nextQuery_])
+        return;
+    beginQuery_(GL_TIME_ELAPSED_EXT, queries_[nextQuery_]);
+    timing_ = true;
+}
+
+
+void SceneTarget::endTiming() {
+    if (!timing_)
+        return;
+    endQuery_(GL_TIME_ELAPSED_EXT);
+    pending_[nextQuery_] = true;
+    nextQuery_ = (nextQuery_ + 1) % kTimerQueries;
+    timing_ = false;
+}
+}
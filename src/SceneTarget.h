@@ -0,0 +1,114 @@
+/***************************************************
+* SceneTarget.h: Scaled offscreen scene rendering  *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_SCENETARGET_H_
+#define LYS3D_SCENETARGET_H_
+
+#include "GLES2/gl2ext.h"
+
+#include "types.h"
+#include "Dimension2D.h"
+#include "ShaderProgram.h"
+#include "VertexLayout.h"
+
+namespace lys3d {
+
+/** An offscreen color + depth target the 3D scene renders into at a \
+ * fraction of the window's resolution, then stretched over the default \
+ * framebuffer with one bilinear fullscreen triangle.
+ * The target is allocated once at the largest scale and the scene renders \
+ * into its bottom-left corner, so changing the scale never reallocates. \
+ * Also times frames on the GPU with GL_EXT_disjoint_timer_query where \
+ * available. Internal to WindowGLES2.
+ */
+class SceneTarget {
+  public:
+    /** Number of timer queries in flight; results are read this many \
+     * frames late so the CPU never waits for them.
+     */
+    static const uint32_t kTimerQueries = 4;
+
+    SceneTarget();
+
+    /** Deletes the GL objects; the context they were made in must be current. */
+    ~SceneTarget();
+
+    SceneTarget(const SceneTarget& other) = delete;
+    SceneTarget& operator=(const SceneTarget& other) = delete;
+
+    /** Bind and clear the target, with the viewport set to the scaled size.
+     * \param native The default framebuffer size, in pixels.
+     * \param scale The scale to render at.
+     * \param max_scale The largest scale to allocate for.
+     * \returns False if the target can't be created; the default \
+     * framebuffer is bound instead.
+     */
+    bool begin(const Dimension2Di32 &native, float scale, float max_scale);
+
+    /** Stretch the scene over the default framebuffer and leave that bound \
+     * with its full viewport. Blending, depth test, culling and scissor \
+     * state and the bound program, array buffer and texture are restored.
+     */
+    void end();
+
+    /** Get the size the scene is rendered at.
+     * \returns The viewport size from the last begin().
+     */
+    const Dimension2Di32& viewport() const {
+        return viewport_;
+    }
+
+    /** Start timing a frame on the GPU, and collect any finished results. */
+    void beginTiming();
+
+    /** Stop timing the frame. */
+    void endTiming();
+
+    /** Get the most recent GPU frame time.
+     * \returns The time in milliseconds, or a negative value if GPU timing \
+     * isn't available (yet).
+     */
+    float gpuMs() const {
+        return gpuMs_;
+    }
+
+  private:
+    void checkExtensions();
+    bool create(const Dimension2Di32 &size);
+    void destroyTarget();
+
+    ShaderProgram program_;
+    VertexLayout layout_;
+    uint32_t buffer_;
+    uint32_t texture_;
+    uint32_t depth_;
+    uint32_t framebuffer_;
+    int32_t uvScaleLocation_;
+    int32_t uvMaxLocation_;
+    bool failed_;
+    Dimension2Di32 size_;
+    Dimension2Di32 native_;
+    Dimension2Di32 viewport_;
+    PFN_glDiscardFramebufferEXT discard_;
+    PFN_glGenQueriesEXT genQueries_;
+    PFN_glDeleteQueriesEXT deleteQueries_;
+    PFN_glBeginQueryEXT beginQuery_;
+    PFN_glEndQueryEXT endQuery_;
+    PFN_glGetQueryObjectuivEXT getQueryuiv_;
+    PFN_glGetQueryObjectui64vEXT getQueryui64v_;
+    uint32_t queries_[kTimerQueries];
+    bool pending_[kTimerQueries];
+    uint32_t nextQuery_;
+    bool timing_;
+    bool extensionsChecked_;
+    float gpuMs_;
+};
+}
+#endif // LYS3D_SCENETARGET_H_
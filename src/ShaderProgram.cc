@@ -0,0 +1,144 @@
+/***************************************************
+* ShaderProgram.cc: GLSL program compilation       *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "ShaderProgram.h"
+
+#include "GLES2/gl2.h"
+
+#include "config.h"
+#include "types.h"
+#include "ResourceRegistry.h"
+#include "VertexLayout.h"
+
+namespace lys3d {
+namespace {
+const char* kAttribNames[kAttribCount] = {
+    "a_position",
+    "a_normal",
+    "a_texcoord",
+    "a_color",
+    "a_joints",
+    "a_weights",
+};
+
+const char* kFragmentPrologue =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n";
+
+GLuint compileShader(GLenum type, const String &defines, const String &source, String *log) {
+    const char *parts[3] = {
+        type == GL_FRAGMENT_SHADER ? kFragmentPrologue : "",
+        defines.c_str(),
+        source.c_str()
+    };
+
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 3, parts, nullptr);
+    glCompileShader(shader);
+
+    GLint status = GL_FALSE, length = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    if (length > 1) {
+        String message(static_cast<size_t>(length), '\0');
+        glGetShaderInfoLog(shader, length, nullptr, &message[0]);
+        message.resize(static_cast<size_t>(length - 1));
+        *log += message;
+    }
+
+    if (status != GL_TRUE) {
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+}
+
+
+LYS_API ShaderProgram::ShaderProgram() {
+    program_ = 0;
+}
+
+
+LYS_API ShaderProgram::~ShaderProgram() {
+    this->destroy();
+}
+
+
+LYS_API bool ShaderProgram::build(const String &vertex_source, const String &fragment_source,
+                                  const String &defines) {
+    destroy();
+    log_.clear();
+
+    GLuint vertex = compileShader(GL_VERTEX_SHADER, defines, vertex_source, &log_);
+    GLuint fragment = compileShader(GL_FRAGMENT_SHADER, defines, fragment_source, &log_);
+    if (vertex == 0 || fragment == 0) {
+        if (vertex)
+            glDeleteShader(vertex);
+        if (fragment)
+            glDeleteShader(fragment);
+        return false;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    for (uint32_t i = 0; i < kAttribCount; ++i)
+        glBindAttribLocation(program, i, kAttribNames[i]);
+    glLinkProgram(program);
+
+    // The program keeps the compiled code; the shader objects can go now.
+    glDetachShader(program, vertex);
+    glDetachShader(program, fragment);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    GLint status = GL_FALSE, length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+    if (length > 1) {
+        String message(static_cast<size_t>(length), '\0');
+        glGetProgramInfoLog(program, length, nullptr, &message[0]);
+        message.resize(static_cast<size_t>(length - 1));
+        log_ += message;
+    }
+
+    if (status != GL_TRUE) {
+        glDeleteProgram(program);
+        return false;
+    }
+    program_ = program;
+    // Drivers don't say how big the linked code is; the source is a stand-in
+    ResourceRegistry::global().track(GpuResourceType::kProgram, program_,
+                                     vertex_source.size() + fragment_source.size() + defines.size() * 2);
+    return true;
+}
+
+
+LYS_API void ShaderProgram::destroy() {
+    if (program_) {
+        ResourceRegistry::global().release(GpuResourceType::kProgram, program_);
+        program_ = 0;
+    }
+}
+
+
+LYS_API void ShaderProgram::use() const {
+    glUseProgram(program_);
+}
+
+
+LYS_API int32_t ShaderProgram::uniformLocation(const char *name) const {
+    if (program_ == 0)
+        return -1;
+    return glGetUniformLocation(program_, name);
+}
+}
@@ -0,0 +1,540 @@
+/***************************************************
+* ShadowAtlas.cc: Cached shadow-map tile atlas     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "ShadowAtlas.h"
+
+#include <algorithm>
+
+#include "GLES2/gl2.h"
+#include <SDL2/SDL_video.h>
+
+#include "config.h"
+#include "types.h"
+#include "Profiler.h"
+#include "ResourceRegistry.h"
+
+namespace lys3d {
+namespace {
+// Tiles shrink only once the importance drops this far below the size that
+// the next smaller tile would be chosen for, so lights hovering around a size
+// boundary don't get reallocated (and re-rendered) every frame.
+const float kShrinkHysteresis = 0.75f;
+
+// Tiles that have never been rendered hold garbage, so they jump the queue.
+const float kInvalidTilePriority = 4.0f;
+
+struct LightEntry {
+    uint32_t id;
+    ShadowLight light;
+    int32_t level;      // Allocator level of the tile, or -1 if none
+    Point2Di32 origin;
+    bool dirty;         // Needs re-rendering
+    bool valid;         // Tile contents match a (possibly stale) render
+    uint32_t waitFrames;
+};
+
+struct CasterEntry {
+    uint32_t id;
+    Box3Df bounds;
+};
+
+Box3Df lightBounds(const ShadowLight &light) {
+    return Box3Df::fromCenter(light.position, Point3Df(light.range, light.range, light.range));
+}
+}
+
+
+struct ShadowAtlas::Impl {
+    Impl(int32_t atlas_size, int32_t min_tile_size) {
+        atlasSize = atlas_size;
+        levels = 1;
+        while ((atlas_size >> levels) >= min_tile_size && levels < 16)
+            ++levels;
+        freeTiles.resize(levels);
+        freeTiles[0].push_back(Point2Di32(0, 0));
+        budget = 4;
+        texture = 0;
+        depthBuffer = 0;
+        framebuffer = 0;
+        depthTexture = false;
+    }
+
+    int32_t tileSize(int32_t level) const {
+        return atlasSize >> level;
+    }
+
+    // Quadtree buddy allocator: each level holds a free list of tiles of
+    // size atlasSize >> level; bigger tiles are split on demand.
+    bool allocate(int32_t level, Point2Di32 *origin) {
+        Vector<Point2Di32> &free_list = freeTiles[level];
+        if (!free_list.empty()) {
+            *origin = free_list.back();
+            free_list.pop_back();
+            return true;
+        }
+        if (level == 0)
+            return false;
+
+        Point2Di32 parent;
+        if (!allocate(level - 1, &parent))
+            return false;
+        int32_t size = tileSize(level);
+        free_list.push_back(Point2Di32(parent.x() + size, parent.y() + size));
+        free_list.push_back(Point2Di32(parent.x(), parent.y() + size));
+        free_list.push_back(Point2Di32(parent.x() + size, parent.y()));
+        *origin = parent;
+        return true;
+    }
+
+    void release(int32_t level, const Point2Di32 &origin) {
+        Vector<Point2Di32> &free_list = freeTiles[level];
+        if (level > 0) {
+            // Merge back into the parent if all three siblings are free.
+            int32_t size = tileSize(level);
+            int32_t px = origin.x() & ~(size * 2 - 1);
+            int32_t py = origin.y() & ~(size * 2 - 1);
+            size_t siblings[3];
+            int found = 0;
+            for (size_t i = 0; i < free_list.size() && found < 3; ++i) {
+                const Point2Di32 &p = free_list[i];
+                if ((p.x() & ~(size * 2 - 1)) == px && (p.y() & ~(size * 2 - 1)) == py)
+                    siblings[found++] = i;
+            }
+            if (found == 3) {
+                // Erase from the back so the earlier indices stay valid
+                for (int i = 2; i >= 0; --i) {
+                    free_list[siblings[i]] = free_list.back();
+                    free_list.pop_back();
+                }
+                release(level - 1, Point2Di32(px, py));
+                return;
+            }
+        }
+        free_list.push_back(origin);
+    }
+
+    void releaseTile(LightEntry &entry) {
+        if (entry.level >= 0) {
+            release(entry.level, entry.origin);
+            stats.allocatedTexels -= static_cast<uint64_t>(tileSize(entry.level)) * tileSize(entry.level);
+        }
+        entry.level = -1;
+        entry.valid = false;
+        entry.dirty = true;
+    }
+
+    LightEntry* findLight(uint32_t id) {
+        for (LightEntry &entry : lights) {
+            if (entry.id == id)
+                return &entry;
+        }
+        return nullptr;
+    }
+
+    void invalidate(const Box3Df &bounds) {
+        for (LightEntry &entry : lights) {
+            if (!entry.dirty && lightBounds(entry.light).intersects(bounds))
+                entry.dirty = true;
+        }
+    }
+
+    // Pick the allocator level for a light, keeping the current one unless
+    // the importance moved clearly past a size boundary.
+    int32_t desiredLevel(const LightEntry &entry) const {
+        float wanted = entry.light.importance * tileSize(1);
+        int32_t level = 1;
+        while (level < levels - 1 && wanted <= tileSize(level + 1))
+            ++level;
+        if (entry.level > level)
+            return level; // Grow immediately
+        if (entry.level >= 0 && entry.level < level) {
+            if (wanted > tileSize(entry.level + 1) * kShrinkHysteresis)
+                return entry.level;
+        }
+        return level;
+    }
+
+    int32_t atlasSize;
+    int32_t levels;
+    Vector<Vector<Point2Di32>> freeTiles;
+    Vector<LightEntry> lights;
+    Vector<CasterEntry> casters;
+    Vector<ShadowTile> updates;
+    ShadowAtlasStats stats;
+    uint32_t budget;
+    uint32_t texture;
+    uint32_t depthBuffer;
+    uint32_t framebuffer;
+    bool depthTexture;
+};
+
+
+LYS_API ShadowAtlas::ShadowAtlas(int32_t atlas_size, int32_t min_tile_size) {
+    pimpl_ = new Impl(atlas_size, min_tile_size);
+}
+
+
+LYS_API ShadowAtlas::~ShadowAtlas() {
+    this->destroy();
+    delete this->pimpl_;
+}
+
+
+LYS_API bool ShadowAtlas::create() {
+    if (isCreated())
+        return true;
+
+    GLsizei size = pimpl_->atlasSize;
+    pimpl_->depthTexture = (SDL_GL_ExtensionSupported("GL_OES_depth_texture") == SDL_TRUE);
+
+    glGenTextures(1, &pimpl_->texture);
+    glBindTexture(GL_TEXTURE_2D, pimpl_->texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(1, &pimpl_->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, pimpl_->framebuffer);
+
+    if (pimpl_->depthTexture) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, size, size, 0,
+                     GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                               pimpl_->texture, 0);
+    } else {
+        // No depth textures, so casters write packed depth into RGBA8 and we
+        // still need a depth buffer for the depth test itself.
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, nullptr);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                               pimpl_->texture, 0);
+        glGenRenderbuffers(1, &pimpl_->depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, pimpl_->depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, size, size);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                                  pimpl_->depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    }
+
+    bool complete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Depth textures are 32-bit here, as is the RGBA8 fallback
+    ResourceRegistry &registry = ResourceRegistry::global();
+    uint64_t pixels = static_cast<uint64_t>(size) * size;
+    registry.track(GpuResourceType::kTexture, pimpl_->texture, pixels * 4);
+    if (pimpl_->depthBuffer != 0)
+        registry.track(GpuResourceType::kRenderbuffer, pimpl_->depthBuffer, pixels * 2);
+    registry.track(GpuResourceType::kFramebuffer, pimpl_->framebuffer, 0);
+    if (!complete) {
+        destroy();
+        return false;
+    }
+
+    // Whatever was in the texture before is gone, so re-render every tile.
+    for (LightEntry &entry : pimpl_->lights) {
+        entry.dirty = true;
+        entry.valid = false;
+    }
+    return true;
+}
+
+
+LYS_API void ShadowAtlas::destroy() {
+    ResourceRegistry &registry = ResourceRegistry::global();
+    if (pimpl_->framebuffer) {
+        registry.release(GpuResourceType::kFramebuffer, pimpl_->framebuffer);
+        pimpl_->framebuffer = 0;
+    }
+    if (pimpl_->depthBuffer) {
+        registry.release(GpuResourceType::kRenderbuffer, pimpl_->depthBuffer);
+        pimpl_->depthBuffer = 0;
+    }
+    if (pimpl_->texture) {
+        registry.release(GpuResourceType::kTexture, pimpl_->texture);
+        pimpl_->texture = 0;
+    }
+}
+
+
+LYS_API bool ShadowAtlas::isCreated() const {
+    return (pimpl_->framebuffer != 0);
+}
+
+
+LYS_API bool ShadowAtlas::usesDepthTexture() const {
+    return pimpl_->depthTexture;
+}
+
+
+LYS_API uint32_t ShadowAtlas::texture() const {
+    return pimpl_->texture;
+}
+
+
+LYS_API int32_t ShadowAtlas::atlasSize() const {
+    return pimpl_->atlasSize;
+}
+
+
+LYS_API uint32_t ShadowAtlas::budget() const {
+    return pimpl_->budget;
+}
+
+
+LYS_API void ShadowAtlas::budget(uint32_t max_tiles) {
+    pimpl_->budget = max_tiles;
+}
+
+
+LYS_API void ShadowAtlas::light(uint32_t id, const ShadowLight &light) {
+    LightEntry *entry = pimpl_->findLight(id);
+    if (entry == nullptr) {
+        LightEntry new_entry;
+        new_entry.id = id;
+        new_entry.light = light;
+        new_entry.level = -1;
+        new_entry.dirty = true;
+        new_entry.valid = false;
+        new_entry.waitFrames = 0;
+        pimpl_->lights.push_back(new_entry);
+        return;
+    }
+
+    if (entry->light.position != light.position || entry->light.direction != light.direction
+        || entry->light.range != light.range)
+        entry->dirty = true;
+    entry->light = light;
+}
+
+
+LYS_API void ShadowAtlas::removeLight(uint32_t id) {
+    Vector<LightEntry> &lights = pimpl_->lights;
+    for (size_t i = 0; i < lights.size(); ++i) {
+        if (lights[i].id == id) {
+            pimpl_->releaseTile(lights[i]);
+            lights[i] = lights.back();
+            lights.pop_back();
+            return;
+        }
+    }
+}
+
+
+LYS_API void ShadowAtlas::caster(uint32_t id, const Box3Df &bounds) {
+    for (CasterEntry &entry : pimpl_->casters) {
+        if (entry.id == id) {
+            if (entry.bounds != bounds) {
+                pimpl_->invalidate(entry.bounds);
+                pimpl_->invalidate(bounds);
+                entry.bounds = bounds;
+            }
+            return;
+        }
+    }
+
+    CasterEntry entry;
+    entry.id = id;
+    entry.bounds = bounds;
+    pimpl_->casters.push_back(entry);
+    pimpl_->invalidate(bounds);
+}
+
+
+LYS_API void ShadowAtlas::removeCaster(uint32_t id) {
+    Vector<CasterEntry> &casters = pimpl_->casters;
+    for (size_t i = 0; i < casters.size(); ++i) {
+        if (casters[i].id == id) {
+            pimpl_->invalidate(casters[i].bounds);
+            casters[i] = casters.back();
+            casters.pop_back();
+            return;
+        }
+    }
+}
+
+
+LYS_API const Vector<ShadowTile>& ShadowAtlas::plan() {
+    LYS_PROFILE_ZONE("Shadow atlas planning");
+    Vector<LightEntry> &lights = pimpl_->lights;
+    ShadowAtlasStats &stats = pimpl_->stats;
+    uint64_t allocated_texels = stats.allocatedTexels;
+    stats = ShadowAtlasStats();
+    stats.allocatedTexels = allocated_texels;
+    pimpl_->updates.clear();
+
+    // Most important lights get first pick of the atlas space.
+    std::sort(lights.begin(), lights.end(), [](const LightEntry &a, const LightEntry &b) {
+        return a.light.importance > b.light.importance;
+    });
+
+    Vector<int32_t> levels(lights.size());
+    uint64_t wanted_texels = 0;
+    for (size_t i = 0; i < lights.size(); ++i) {
+        levels[i] = pimpl_->desiredLevel(lights[i]);
+        uint64_t size = static_cast<uint64_t>(pimpl_->tileSize(levels[i]));
+        wanted_texels += size * size;
+    }
+
+    // If the atlas is oversubscribed, shrink the least important lights first
+    // (one step per round) until everything fits or nothing can shrink further.
+    uint64_t atlas_texels = static_cast<uint64_t>(pimpl_->atlasSize) * pimpl_->atlasSize;
+    bool shrunk = true;
+    while (wanted_texels > atlas_texels && shrunk) {
+        shrunk = false;
+        for (size_t i = lights.size(); i-- > 0 && wanted_texels > atlas_texels;) {
+            if (levels[i] < pimpl_->levels - 1) {
+                uint64_t size = static_cast<uint64_t>(pimpl_->tileSize(levels[i]));
+                wanted_texels -= size * size - (size / 2) * (size / 2);
+                ++levels[i];
+                shrunk = true;
+            }
+        }
+    }
+
+    // Free everything that changes size first, so shrinking lights make room.
+    for (size_t i = 0; i < lights.size(); ++i) {
+        if (lights[i].level >= 0 && lights[i].level != levels[i])
+            pimpl_->releaseTile(lights[i]);
+    }
+
+    for (size_t i = 0; i < lights.size(); ++i) {
+        LightEntry &entry = lights[i];
+        if (entry.level >= 0)
+            continue;
+
+        // Settle for a smaller tile if the atlas is too full for the ideal one.
+        for (int32_t level = levels[i]; level < pimpl_->levels; ++level) {
+            if (pimpl_->allocate(level, &entry.origin)) {
+                entry.level = level;
+                int32_t size = pimpl_->tileSize(level);
+                stats.allocatedTexels += static_cast<uint64_t>(size) * size;
+                break;
+            }
+        }
+        if (entry.level < 0)
+            ++stats.unallocatedLights;
+    }
+
+    // Refresh the dirty tiles with the highest priority, within the budget.
+    // Waiting raises the priority so unimportant lights are not starved.
+    Vector<LightEntry*> dirty;
+    for (LightEntry &entry : lights) {
+        if (entry.level < 0)
+            continue;
+        if (entry.dirty)
+            dirty.push_back(&entry);
+        else
+            ++stats.cachedTiles;
+    }
+    std::sort(dirty.begin(), dirty.end(), [](const LightEntry *a, const LightEntry *b) {
+        float pa = a->light.importance * (1.0f + a->waitFrames) * (a->valid ? 1.0f : kInvalidTilePriority);
+        float pb = b->light.importance * (1.0f + b->waitFrames) * (b->valid ? 1.0f : kInvalidTilePriority);
+        return pa > pb;
+    });
+
+    for (LightEntry *entry : dirty) {
+        if (pimpl_->updates.size() < pimpl_->budget) {
+            ShadowTile tile;
+            tile.lightId = entry->id;
+            tile.origin = entry->origin;
+            tile.size = pimpl_->tileSize(entry->level);
+            pimpl_->updates.push_back(tile);
+            entry->dirty = false;
+            entry->valid = true;
+            entry->waitFrames = 0;
+        } else {
+            ++entry->waitFrames;
+            ++stats.deferredTiles;
+            // A stale but previously rendered tile is still better than nothing.
+            if (entry->valid)
+                ++stats.cachedTiles;
+        }
+    }
+    stats.refreshedTiles = static_cast<uint32_t>(pimpl_->updates.size());
+
+    return pimpl_->updates;
+}
+
+
+LYS_API bool ShadowAtlas::tile(uint32_t id, ShadowTile *tile) const {
+    const LightEntry *entry = pimpl_->findLight(id);
+    if (entry == nullptr || entry->level < 0 || !entry->valid)
+        return false;
+
+    if (tile != nullptr) {
+        tile->lightId = id;
+        tile->origin = entry->origin;
+        tile->size = pimpl_->tileSize(entry->level);
+    }
+    return true;
+}
+
+
+LYS_API void ShadowAtlas::uvTransform(const ShadowTile &tile, float scale_offset[4]) const {
+    float inv_size = 1.0f / pimpl_->atlasSize;
+    scale_offset[0] = tile.size * inv_size;
+    scale_offset[1] = tile.size * inv_size;
+    scale_offset[2] = tile.origin.x() * inv_size;
+    scale_offset[3] = tile.origin.y() * inv_size;
+}
+
+
+LYS_API bool ShadowAtlas::bindTile(const ShadowTile &tile) {
+    if (!isCreated())
+        return false;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, pimpl_->framebuffer);
+    glViewport(tile.origin.x(), tile.origin.y(), tile.size, tile.size);
+    glScissor(tile.origin.x(), tile.origin.y(), tile.size, tile.size);
+    glEnable(GL_SCISSOR_TEST);
+    glDepthMask(GL_TRUE);
+
+    if (pimpl_->depthTexture) {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    } else {
+        // lysPackDepth() wraps 1.0 around to all zeros, so clear to all ones
+        // instead, which unpacks to just past the far plane
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+    return true;
+}
+
+
+LYS_API void ShadowAtlas::finishTiles() {
+    if (!isCreated())
+        return;
+
+    glDisable(GL_SCISSOR_TEST);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+
+LYS_API const ShadowAtlasStats& ShadowAtlas::stats() const {
+    return pimpl_->stats;
+}
+
+
+LYS_API const char* kShadowPackGLSL =
+    "vec4 lysPackDepth(float depth) {\n"
+    "    vec4 enc = fract(vec4(1.0, 255.0, 65025.0, 16581375.0) * depth);\n"
+    "    enc -= enc.yzww * vec4(1.0 / 255.0, 1.0 / 255.0, 1.0 / 255.0, 0.0);\n"
+    "    return enc;\n"
+    "}\n"
+    "float lysUnpackDepth(vec4 rgba) {\n"
+    "    return dot(rgba, vec4(1.0, 1.0 / 255.0, 1.0 / 65025.0, 1.0 / 16581375.0));\n"
+    "}\n";
+}
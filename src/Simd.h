@@ -0,0 +1,28 @@
+/***************************************************
+* Simd.h: Internal SIMD instruction set selection  *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_SIMD_H_
+#define LYS3D_SIMD_H_
+
+// SSE2 is baseline on x86-64, so it's the only x86 path we bother with for
+// now; everything else (ARM included, until someone writes a NEON path) uses
+// the scalar fallback next to each SIMD loop.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define LYS_SIMD_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+// AVX is never baseline, so it's only used when the build enables it.
+#if defined(__AVX__)
+    #define LYS_SIMD_AVX 1
+    #include <immintrin.h>
+#endif
+
+#endif // LYS3D_SIMD_H_
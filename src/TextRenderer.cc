@@ -0,0 +1,446 @@
+/***************************************************
+* TextRenderer.cc: Batched SDF text                *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "TextRenderer.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+
+#include "GLES2/gl2.h"
+
+#include "config.h"
+#include "types.h"
+#include "Profiler.h"
+#include "ResourceRegistry.h"
+#include "ShaderProgram.h"
+#include "VertexLayout.h"
+
+namespace lys3d {
+namespace {
+const uint32_t kNone = 0xFFFFFFFFu;
+const uint32_t kReplacement = 0xFFFD;
+
+// The sharpness in a_position.z turns the distance read from the atlas into
+// screen pixels, giving a one pixel wide antialiased edge at any size
+const char* kTextVS =
+    "attribute vec3 a_position;\n"
+    "attribute vec2 a_texcoord;\n"
+    "attribute vec4 a_color;\n"
+    "uniform vec2 u_scale;\n"
+    "varying vec2 v_texcoord;\n"
+    "varying vec4 v_color;\n"
+    "varying float v_sharpness;\n"
+    "void main() {\n"
+    "    v_texcoord = a_texcoord;\n"
+    "    v_color = a_color;\n"
+    "    v_sharpness = a_position.z;\n"
+    "    gl_Position = vec4(a_position.xy * u_scale + vec2(-1.0, 1.0), 0.0, 1.0);\n"
+    "}\n";
+
+const char* kTextFS =
+    "uniform sampler2D u_atlas;\n"
+    "varying vec2 v_texcoord;\n"
+    "varying vec4 v_color;\n"
+    "varying float v_sharpness;\n"
+    "void main() {\n"
+    "    float distance = texture2D(u_atlas, v_texcoord).r - 0.5;\n"
+    "    float coverage = clamp(distance * v_sharpness + 0.5, 0.0, 1.0);\n"
+    "    gl_FragColor = vec4(v_color.rgb, v_color.a * coverage);\n"
+    "}\n";
+
+struct Vertex {
+    float x, y, sharpness;
+    uint16_t u, v;
+    uint8_t color[4];
+};
+
+// One atlas cell, linked into the least-recently-used list
+struct Entry {
+    uint64_t key;
+    uint32_t prev, next;
+    // The batch that last used it; cells in the current batch can't be
+    // reused until it's drawn
+    uint32_t batch;
+    uint16_t width, height;
+    int16_t left, top;
+    // Atlas pixels per em; less than glyphSize for glyphs too big for a cell
+    float pixelSize;
+};
+
+// Decodes one UTF-8 character and steps past it
+uint32_t decode(const char **text) {
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(*text);
+    uint32_t c = p[0], length = 1, minimum = 0;
+    if (c >= 0xF0 && c < 0xF5) {
+        length = 4;
+        c &= 0x07;
+        minimum = 0x10000;
+    } else if (c >= 0xE0 && c < 0xF0) {
+        length = 3;
+        c &= 0x0F;
+        minimum = 0x800;
+    } else if (c >= 0xC2 && c < 0xE0) {
+        length = 2;
+        c &= 0x1F;
+        minimum = 0x80;
+    } else if (c >= 0x80) {
+        // Continuation bytes, overlong leads and 0xF5 up, which would start
+        // sequences past U+10FFFF
+        ++*text;
+        return kReplacement;
+    }
+    for (uint32_t i = 1; i < length; ++i) {
+        if ((p[i] & 0xC0) != 0x80) {
+            ++*text;
+            return kReplacement;
+        }
+        c = c << 6 | (p[i] & 0x3F);
+    }
+    *text += length;
+    if (c < minimum || c > 0x10FFFF || (c >= 0xD800 && c < 0xE000))
+        return kReplacement;
+    return c;
+}
+}
+
+
+struct TextRenderer::Impl {
+    explicit Impl(const TextSettings &new_settings) {
+        settings = new_settings;
+        settings.spread = std::max(settings.spread, 1.0f);
+        settings.glyphSize = std::max(settings.glyphSize, 4.0f);
+        settings.atlasSize = std::max(settings.atlasSize, 64u);
+        pad = static_cast<uint32_t>(ceilf(settings.spread)) + 1;
+        cell = static_cast<uint32_t>(ceilf(settings.glyphSize)) + 2 * pad;
+        if (cell > settings.atlasSize) {
+            cell = settings.atlasSize;
+            settings.glyphSize = static_cast<float>(cell - 2 * pad);
+        }
+        columns = settings.atlasSize / cell;
+        entries.resize(columns * columns);
+        atlas.assign(static_cast<size_t>(settings.atlasSize) * settings.atlasSize, 0);
+        head = tail = kNone;
+        filled = 0;
+        batch = 0;
+        dirtyTop = 0;
+        dirtyBottom = settings.atlasSize;
+        stats.capacity = static_cast<uint32_t>(entries.size());
+        texture = 0;
+        buffer = 0;
+        bufferSize = 0;
+        scaleLocation = -1;
+        failed = false;
+        layout.add(kAttribPosition, 3, VertexFormat::kFloat)
+              .add(kAttribTexCoord, 2, VertexFormat::kUShortNorm)
+              .add(kAttribColor, 4, VertexFormat::kUByteNorm);
+    }
+
+    ~Impl() {
+        ResourceRegistry &registry = ResourceRegistry::global();
+        registry.release(GpuResourceType::kTexture, texture);
+        registry.release(GpuResourceType::kBuffer, buffer);
+    }
+
+    void unlink(uint32_t slot) {
+        Entry &entry = entries[slot];
+        (entry.prev == kNone ? head : entries[entry.prev].next) = entry.next;
+        (entry.next == kNone ? tail : entries[entry.next].prev) = entry.prev;
+    }
+
+    void pushFront(uint32_t slot) {
+        Entry &entry = entries[slot];
+        entry.prev = kNone;
+        entry.next = head;
+        (head == kNone ? tail : entries[head].prev) = slot;
+        head = slot;
+    }
+
+    // Renders a glyph into a free cell, or the least recently used one's
+    uint32_t generate(uint32_t font, uint32_t glyph, uint64_t key) {
+        uint32_t slot;
+        if (filled < entries.size()) {
+            slot = filled++;
+        } else {
+            slot = tail;
+            if (entries[slot].batch == batch)
+                flush();
+            unlink(slot);
+            cells.erase(entries[slot].key);
+            ++stats.evicted;
+        }
+
+        // Glyphs that overflow a cell (wide or tall ones) get smaller
+        float pixel_size = settings.glyphSize;
+        GlyphBitmap bitmap;
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            fonts[font]->renderSDF(glyph, pixel_size, settings.spread, &pixels, &bitmap);
+            if (bitmap.width <= cell && bitmap.height <= cell)
+                break;
+            float inner = static_cast<float>(cell - 2 * pad - 1);
+            float outline = static_cast<float>(std::max(bitmap.width, bitmap.height) - 2 * pad);
+            pixel_size *= std::max(inner, 1.0f) / outline;
+        }
+        if (bitmap.width > cell || bitmap.height > cell)
+            bitmap = GlyphBitmap();
+
+        uint32_t x0 = (slot % columns) * cell, y0 = (slot / columns) * cell;
+        for (uint32_t row = 0; row < cell; ++row) {
+            uint8_t *out = &atlas[static_cast<size_t>(y0 + row) * settings.atlasSize + x0];
+            memset(out, 0, cell);
+            if (row < bitmap.height)
+                memcpy(out, &pixels[row * bitmap.width], bitmap.width);
+        }
+        dirtyTop = std::min(dirtyTop, y0);
+        dirtyBottom = std::max(dirtyBottom, y0 + cell);
+
+        Entry &entry = entries[slot];
+        entry.key = key;
+        entry.width = static_cast<uint16_t>(bitmap.width);
+        entry.height = static_cast<uint16_t>(bitmap.height);
+        entry.left = static_cast<int16_t>(bitmap.left);
+        entry.top = static_cast<int16_t>(bitmap.top);
+        entry.pixelSize = pixel_size;
+        cells[key] = slot;
+        pushFront(slot);
+        ++stats.generated;
+        return slot;
+    }
+
+    uint32_t lookup(uint32_t font, uint32_t glyph) {
+        uint64_t key = static_cast<uint64_t>(font) << 32 | glyph;
+        std::unordered_map<uint64_t, uint32_t>::const_iterator found = cells.find(key);
+        uint32_t slot;
+        if (found == cells.end()) {
+            slot = generate(font, glyph, key);
+        } else {
+            slot = found->second;
+            if (head != slot) {
+                unlink(slot);
+                pushFront(slot);
+            }
+        }
+        entries[slot].batch = batch;
+        return slot;
+    }
+
+    // Walks a string's characters, calling emit for each glyph with its pen
+    // position, and returns the extent
+    template <typename Emit>
+    Dimension2Df walk(uint32_t font, const char *utf8, float size, Emit emit) const {
+        const Font &face = *fonts[font];
+        float line = face.lineHeight() * size;
+        float x = 0.0f, width = 0.0f, y = 0.0f;
+        uint32_t previous = kNone;
+        while (*utf8) {
+            uint32_t c = decode(&utf8);
+            if (c == '\n') {
+                width = std::max(width, x);
+                x = 0.0f;
+                y += line;
+                previous = kNone;
+                continue;
+            }
+            uint32_t glyph = face.glyphIndex(c);
+            if (previous != kNone)
+                x += face.kerning(previous, glyph) * size;
+            emit(glyph, x, y);
+            x += face.advance(glyph) * size;
+            previous = glyph;
+        }
+        return Dimension2Df(std::max(width, x), y + line);
+    }
+
+    bool create() {
+        if (!program.build(kTextVS, kTextFS))
+            return false;
+        scaleLocation = program.uniformLocation("u_scale");
+        program.use();
+        glUniform1i(program.uniformLocation("u_atlas"), 0);
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, settings.atlasSize, settings.atlasSize, 0, GL_LUMINANCE,
+                     GL_UNSIGNED_BYTE, nullptr);
+        ResourceRegistry::global().track(GpuResourceType::kTexture, texture, atlas.size());
+        glGenBuffers(1, &buffer);
+        return true;
+    }
+
+    // Draws what's been laid out, after sending the atlas rows it changed
+    void flush() {
+        LYS_PROFILE_ZONE("Text");
+        if (!failed && texture == 0 && !create())
+            failed = true;
+        if (!failed && !vertices.empty()) {
+            program.use();
+            glBindTexture(GL_TEXTURE_2D, texture);
+            if (dirtyTop < dirtyBottom) {
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, dirtyTop, settings.atlasSize, dirtyBottom - dirtyTop,
+                                GL_LUMINANCE, GL_UNSIGNED_BYTE, &atlas[static_cast<size_t>(dirtyTop) * settings.atlasSize]);
+                stats.uploadedBytes += (dirtyBottom - dirtyTop) * settings.atlasSize;
+                dirtyTop = settings.atlasSize;
+                dirtyBottom = 0;
+            }
+            glDisable(GL_DEPTH_TEST);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glUniform2f(scaleLocation, 2.0f / std::max(viewport.width(), 1), -2.0f / std::max(viewport.height(), 1));
+
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            uint32_t size = static_cast<uint32_t>(vertices.size() * sizeof(Vertex));
+            glBufferData(GL_ARRAY_BUFFER, size, vertices.data(), GL_STREAM_DRAW);
+            if (size != bufferSize) {
+                bufferSize = size;
+                ResourceRegistry::global().track(GpuResourceType::kBuffer, buffer, bufferSize);
+            }
+            layout.apply();
+            glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size()));
+            layout.disable();
+            ++stats.drawCalls;
+        }
+        vertices.clear();
+        ++batch;
+    }
+
+    TextSettings settings;
+    TextStats stats;
+    Vector<const Font*> fonts;
+    Dimension2Di32 viewport;
+
+    // The atlas: cell x cell pixel cells, columns to a row, mirrored on the
+    // CPU so changed rows can be sent in one upload
+    uint32_t pad;
+    uint32_t cell;
+    uint32_t columns;
+    Vector<Entry> entries;
+    std::unordered_map<uint64_t, uint32_t> cells;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t filled;
+    uint32_t batch;
+    Vector<uint8_t> atlas;
+    uint32_t dirtyTop;
+    uint32_t dirtyBottom;
+    Vector<uint8_t> pixels;
+    Vector<Vertex> vertices;
+
+    ShaderProgram program;
+    VertexLayout layout;
+    uint32_t texture;
+    uint32_t buffer;
+    uint32_t bufferSize;
+    int32_t scaleLocation;
+    bool failed;
+};
+
+
+LYS_API TextRenderer::TextRenderer(const TextSettings &settings) {
+    pimpl_ = new Impl(settings);
+}
+
+
+LYS_API TextRenderer::~TextRenderer() {
+    delete pimpl_;
+}
+
+
+LYS_API const TextSettings& TextRenderer::settings() const {
+    return pimpl_->settings;
+}
+
+
+LYS_API uint32_t TextRenderer::addFont(const Font *font) {
+    pimpl_->fonts.push_back(font);
+    return static_cast<uint32_t>(pimpl_->fonts.size() - 1);
+}
+
+
+LYS_API void TextRenderer::begin(const Dimension2Di32 &viewport) {
+    Impl &impl = *pimpl_;
+    impl.viewport = viewport;
+    impl.vertices.clear();
+    ++impl.batch;
+    impl.stats = TextStats();
+    impl.stats.capacity = static_cast<uint32_t>(impl.entries.size());
+    impl.stats.cached = impl.filled;
+}
+
+
+LYS_API Dimension2Df TextRenderer::text(uint32_t font, const char *utf8, float x, float y, float size,
+                                        uint32_t rgba) {
+    Impl &impl = *pimpl_;
+    if (font >= impl.fonts.size() || !impl.fonts[font]->isLoaded())
+        return Dimension2Df();
+    Vertex v;
+    v.color[0] = static_cast<uint8_t>(rgba >> 24);
+    v.color[1] = static_cast<uint8_t>(rgba >> 16);
+    v.color[2] = static_cast<uint8_t>(rgba >> 8);
+    v.color[3] = static_cast<uint8_t>(rgba);
+    float baseline = y + impl.fonts[font]->ascent() * size;
+    float texel = 65535.0f / impl.settings.atlasSize;
+    Dimension2Df extent = impl.walk(font, utf8, size, [&](uint32_t glyph, float pen_x, float pen_y) {
+        const Entry &entry = impl.entries[impl.lookup(font, glyph)];
+        if (entry.width == 0)
+            return;
+        uint32_t slot = static_cast<uint32_t>(&entry - impl.entries.data());
+        float u0 = static_cast<float>((slot % impl.columns) * impl.cell);
+        float v0 = static_cast<float>((slot / impl.columns) * impl.cell);
+        float scale = size / entry.pixelSize;
+        float left = x + pen_x + entry.left * scale, top = baseline + pen_y - entry.top * scale;
+        float right = left + entry.width * scale, bottom = top + entry.height * scale;
+        float u1 = u0 + entry.width, v1 = v0 + entry.height;
+        v.sharpness = 2.0f * impl.settings.spread * scale;
+        const float corners[6][4] = {
+            {left, top, u0, v0}, {left, bottom, u0, v1}, {right, top, u1, v0},
+            {right, top, u1, v0}, {left, bottom, u0, v1}, {right, bottom, u1, v1}
+        };
+        for (const float *corner : corners) {
+            v.x = corner[0];
+            v.y = corner[1];
+            v.u = static_cast<uint16_t>(corner[2] * texel + 0.5f);
+            v.v = static_cast<uint16_t>(corner[3] * texel + 0.5f);
+            impl.vertices.push_back(v);
+        }
+        ++impl.stats.glyphs;
+    });
+    impl.stats.cached = impl.filled;
+    return extent;
+}
+
+
+LYS_API Dimension2Df TextRenderer::measure(uint32_t font, const char *utf8, float size) const {
+    const Impl &impl = *pimpl_;
+    if (font >= impl.fonts.size() || !impl.fonts[font]->isLoaded())
+        return Dimension2Df();
+    return impl.walk(font, utf8, size, [](uint32_t, float, float) {});
+}
+
+
+LYS_API void TextRenderer::end() {
+    pimpl_->flush();
+}
+
+
+LYS_API const TextStats& TextRenderer::stats() const {
+    return pimpl_->stats;
+}
+
+
+LYS_API uint32_t TextRenderer::texture() const {
+    return pimpl_->texture;
+}
+}
@@ -0,0 +1,500 @@
+/***************************************************
+* Texture.cc: 2D textures, KTX & image loading     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Texture.h"
+
+#include <stdio.h>
+#include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LYS_HAVE_MMAP 1
+#endif
+
+#include "GLES2/gl2.h"
+#include "GLES2/gl2ext.h"
+#include <SDL2/SDL_video.h>
+#include <SDL_image.h>
+#include <physfs.h>
+
+#include "config.h"
+#include "types.h"
+#include "ResourceRegistry.h"
+
+namespace lys3d {
+namespace {
+const uint8_t kKtxIdentifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+const uint32_t kKtxEndianness = 0x04030201;
+const size_t kKtxHeaderSize = 64;
+
+// ETC1 intensity modifiers, per table codeword
+const int kEtc1Modifiers[8][2] = {
+    {2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}
+};
+
+uint32_t readU32(const uint8_t *p, bool swap) {
+    uint32_t value;
+    memcpy(&value, p, 4);
+    if (swap)
+        value = (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+    return value;
+}
+
+uint8_t clampByte(int value) {
+    return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+void decodeETC1Block(const uint8_t *block, uint8_t *out, uint32_t stride, uint32_t w, uint32_t h) {
+    uint32_t hi = (static_cast<uint32_t>(block[0]) << 24) | (block[1] << 16) | (block[2] << 8) | block[3];
+    uint32_t lo = (static_cast<uint32_t>(block[4]) << 24) | (block[5] << 16) | (block[6] << 8) | block[7];
+
+    int base[2][3];
+    if (hi & 0x2) {
+        // Differential mode: 5-bit base plus a 3-bit signed delta
+        for (int c = 0; c < 3; ++c) {
+            int value = (hi >> (27 - c * 8)) & 0x1F;
+            int delta = (hi >> (24 - c * 8)) & 0x7;
+            delta = delta >= 4 ? delta - 8 : delta;
+            int second = (value + delta) & 0x1F;
+            base[0][c] = (value << 3) | (value >> 2);
+            base[1][c] = (second << 3) | (second >> 2);
+        }
+    } else {
+        // Individual mode: two 4-bit colors
+        for (int c = 0; c < 3; ++c) {
+            base[0][c] = ((hi >> (28 - c * 8)) & 0xF) * 17;
+            base[1][c] = ((hi >> (24 - c * 8)) & 0xF) * 17;
+        }
+    }
+    const int *tables[2] = {kEtc1Modifiers[(hi >> 5) & 0x7], kEtc1Modifiers[(hi >> 2) & 0x7]};
+    bool flip = (hi & 0x1) != 0;
+
+    // Pixel indices are stored column by column
+    for (uint32_t x = 0; x < w; ++x) {
+        for (uint32_t y = 0; y < h; ++y) {
+            uint32_t i = x * 4 + y;
+            int sub = flip ? (y >= 2) : (x >= 2);
+            int index = (((lo >> (i + 16)) & 1) << 1) | ((lo >> i) & 1);
+            int modifier = tables[sub][index & 1];
+            if (index & 2)
+                modifier = -modifier;
+            uint8_t *pixel = out + y * stride + x * 3;
+            for (int c = 0; c < 3; ++c)
+                pixel[c] = clampByte(base[sub][c] + modifier);
+        }
+    }
+}
+
+bool compressedFormatSupported(uint32_t format) {
+    if (format == GL_ETC1_RGB8_OES && SDL_GL_ExtensionSupported("GL_OES_compressed_ETC1_RGB8_texture"))
+        return true;
+
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+    if (count <= 0)
+        return false;
+    Vector<GLint> formats(static_cast<size_t>(count));
+    glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+    for (GLint supported : formats) {
+        if (static_cast<uint32_t>(supported) == format)
+            return true;
+    }
+    return false;
+}
+
+// Bytes glTexImage2D() reads for an uncompressed level, with rows padded to
+// the default unpack alignment of 4 as KTX stores them; 0 for combinations
+// GLES2 can't upload.
+uint64_t uncompressedLevelBytes(uint32_t format, uint32_t type, uint32_t width, uint32_t height) {
+    uint64_t pixel;
+    switch (type) {
+    case GL_UNSIGNED_BYTE:
+        switch (format) {
+        case GL_ALPHA:
+        case GL_LUMINANCE:
+            pixel = 1;
+            break;
+        case GL_LUMINANCE_ALPHA:
+            pixel = 2;
+            break;
+        case GL_RGB:
+            pixel = 3;
+            break;
+        case GL_RGBA:
+            pixel = 4;
+            break;
+        default:
+            return 0;
+        }
+        break;
+    case GL_UNSIGNED_SHORT_5_6_5:
+        if (format != GL_RGB)
+            return 0;
+        pixel = 2;
+        break;
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+        if (format != GL_RGBA)
+            return 0;
+        pixel = 2;
+        break;
+    default:
+        return 0;
+    }
+    uint64_t row = pixel * width;
+    uint64_t stride = (row + 3) & ~static_cast<uint64_t>(3);
+    return stride * (height - 1) + row;
+}
+
+bool isPowerOfTwo(uint32_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+// Filtering that works for the levels we have: GLES2 only samples mipmaps
+// from a complete chain.
+void setFilters(uint32_t width, uint32_t height, uint32_t levels) {
+    uint32_t full_chain = 1;
+    for (uint32_t size = width > height ? width : height; size > 1; size >>= 1)
+        ++full_chain;
+    bool mipmapped = levels >= full_chain && full_chain > 1;
+    bool pot = isPowerOfTwo(width) && isPowerOfTwo(height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, pot ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, pot ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+}
+}
+
+
+LYS_API bool parseKTXHeader(const void *data, size_t size, KtxImage *image, size_t *first_level,
+                            bool *swapped) {
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    image->levels.clear();
+    if (data == nullptr || size < kKtxHeaderSize || memcmp(bytes, kKtxIdentifier, 12) != 0)
+        return false;
+
+    bool swap;
+    uint32_t endianness = readU32(bytes + 12, false);
+    if (endianness == kKtxEndianness)
+        swap = false;
+    else if (readU32(bytes + 12, true) == kKtxEndianness)
+        swap = true;
+    else
+        return false;
+
+    uint32_t header[12];
+    for (int i = 0; i < 12; ++i)
+        header[i] = readU32(bytes + 16 + i * 4, swap);
+    image->glType = header[0];
+    uint32_t type_size = header[1];
+    image->glFormat = header[2];
+    image->glInternalFormat = header[3];
+    image->glBaseInternalFormat = header[4];
+    image->width = header[5];
+    image->height = header[6];
+    uint32_t depth = header[7], array_elements = header[8], faces = header[9];
+    uint32_t level_count = header[10] ? header[10] : 1;
+    uint32_t key_value_bytes = header[11];
+
+    // Other-endian multi-byte texels would need swapping, i.e. a copy
+    if (swap && image->glType != 0 && type_size > 1)
+        return false;
+    if (image->width == 0 || image->height == 0 || depth > 1 || array_elements != 0 || faces != 1)
+        return false;
+    if (level_count > 32)
+        return false;
+
+    for (uint32_t i = 0; i < level_count; ++i) {
+        KtxLevel level;
+        level.data = nullptr;
+        level.size = 0;
+        level.width = image->width >> i ? image->width >> i : 1;
+        level.height = image->height >> i ? image->height >> i : 1;
+        image->levels.push_back(level);
+    }
+    *first_level = kKtxHeaderSize + static_cast<size_t>(key_value_bytes);
+    *swapped = swap;
+    return true;
+}
+
+
+LYS_API bool parseKTX(const void *data, size_t size, KtxImage *image) {
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    size_t offset;
+    bool swap;
+    if (!parseKTXHeader(data, size, image, &offset, &swap))
+        return false;
+
+    for (KtxLevel &level : image->levels) {
+        if (offset > size || size - offset < 4)
+            return false;
+        uint32_t image_size = readU32(bytes + offset, swap);
+        offset += 4;
+        if (size - offset < image_size)
+            return false;
+
+        level.data = bytes + offset;
+        level.size = image_size;
+        offset += (static_cast<size_t>(image_size) + 3) & ~static_cast<size_t>(3);
+    }
+    return true;
+}
+
+
+LYS_API void decodeETC1(const uint8_t *blocks, uint32_t width, uint32_t height, uint8_t *rgb) {
+    uint32_t stride = width * 3;
+    for (uint32_t by = 0; by < height; by += 4) {
+        for (uint32_t bx = 0; bx < width; bx += 4) {
+            uint32_t w = width - bx < 4 ? width - bx : 4;
+            uint32_t h = height - by < 4 ? height - by : 4;
+            decodeETC1Block(blocks, rgb + by * stride + bx * 3, stride, w, h);
+            blocks += 8;
+        }
+    }
+}
+
+
+LYS_API Texture::Texture() {
+    texture_ = 0;
+    levels_ = 0;
+    byteSize_ = 0;
+    compressed_ = false;
+    forceDecode_ = false;
+    decodeFormat_ = TextureDecodeFormat::kRGB565;
+}
+
+
+LYS_API Texture::~Texture() {
+    this->destroy();
+}
+
+
+LYS_API bool Texture::loadKTX(const String &path) {
+    destroy();
+    PHYSFS_File *file = PHYSFS_openRead(path.c_str());
+    if (file == nullptr)
+        return false;
+
+    PHYSFS_sint64 length = PHYSFS_fileLength(file);
+    if (length <= 0) {
+        PHYSFS_close(file);
+        return false;
+    }
+    Vector<uint8_t> data(static_cast<size_t>(length));
+    PHYSFS_sint64 read = PHYSFS_readBytes(file, data.data(), data.size());
+    PHYSFS_close(file);
+    if (read != length)
+        return false;
+
+    return loadKTXFromMemory(data.data(), data.size());
+}
+
+
+LYS_API bool Texture::loadKTXFile(const String &native_path) {
+    destroy();
+#ifdef LYS_HAVE_MMAP
+    int fd = open(native_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    size_t length = static_cast<size_t>(info.st_size);
+    void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+
+    bool loaded = loadKTXFromMemory(mapped, length);
+    munmap(mapped, length);
+    return loaded;
+#else
+    FILE *file = fopen(native_path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+    Vector<uint8_t> data;
+    uint8_t chunk[65536];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + read);
+    fclose(file);
+    return loadKTXFromMemory(data.data(), data.size());
+#endif
+}
+
+
+LYS_API bool Texture::loadKTXFromMemory(const void *data, size_t size) {
+    destroy();
+    KtxImage image;
+    if (!parseKTX(data, size, &image))
+        return false;
+    return load(image);
+}
+
+
+LYS_API bool Texture::load(const KtxImage &image) {
+    destroy();
+    bool compressed = (image.glType == 0);
+    bool native = compressed && !forceDecode_ && compressedFormatSupported(image.glInternalFormat);
+    if (compressed && !native && image.glInternalFormat != GL_ETC1_RGB8_OES)
+        return false;
+
+    // ETC1 levels must hold every block before anything is decoded, and
+    // uncompressed levels every row GL will read
+    if (compressed && !native) {
+        for (const KtxLevel &level : image.levels) {
+            uint64_t needed = static_cast<uint64_t>((level.width + 3) / 4) * ((level.height + 3) / 4) * 8;
+            if (level.size < needed)
+                return false;
+        }
+    } else if (!compressed) {
+        for (const KtxLevel &level : image.levels) {
+            uint64_t needed = uncompressedLevelBytes(image.glFormat, image.glType, level.width, level.height);
+            if (needed == 0 || level.size < needed)
+                return false;
+        }
+    }
+
+    glGenTextures(1, &texture_);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+
+    Vector<uint8_t> rgb, converted;
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        const KtxLevel &level = image.levels[i];
+        GLint lod = static_cast<GLint>(i);
+        if (native) {
+            // Straight from the container; no copies on our side
+            glCompressedTexImage2D(GL_TEXTURE_2D, lod, image.glInternalFormat, level.width, level.height, 0,
+                                   static_cast<GLsizei>(level.size), level.data);
+            byteSize_ += level.size;
+        } else if (compressed) {
+            size_t pixels = static_cast<size_t>(level.width) * level.height;
+            rgb.resize(pixels * 3);
+            decodeETC1(level.data, level.width, level.height, rgb.data());
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            if (decodeFormat_ == TextureDecodeFormat::kRGB565) {
+                converted.resize(pixels * 2);
+                uint16_t *out = reinterpret_cast<uint16_t*>(converted.data());
+                for (size_t p = 0; p < pixels; ++p) {
+                    const uint8_t *c = &rgb[p * 3];
+                    out[p] = static_cast<uint16_t>(((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3));
+                }
+                glTexImage2D(GL_TEXTURE_2D, lod, GL_RGB, level.width, level.height, 0, GL_RGB,
+                             GL_UNSIGNED_SHORT_5_6_5, converted.data());
+                byteSize_ += pixels * 2;
+            } else {
+                converted.resize(pixels * 4);
+                for (size_t p = 0; p < pixels; ++p) {
+                    memcpy(&converted[p * 4], &rgb[p * 3], 3);
+                    converted[p * 4 + 3] = 0xFF;
+                }
+                glTexImage2D(GL_TEXTURE_2D, lod, GL_RGBA, level.width, level.height, 0, GL_RGBA,
+                             GL_UNSIGNED_BYTE, converted.data());
+                byteSize_ += pixels * 4;
+            }
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        } else {
+            // GLES2 wants the internal format to match the format
+            glTexImage2D(GL_TEXTURE_2D, lod, image.glFormat, level.width, level.height, 0, image.glFormat,
+                         image.glType, level.data);
+            byteSize_ += level.size;
+        }
+    }
+
+    levels_ = static_cast<uint32_t>(image.levels.size());
+    if (!compressed && levels_ == 1 && isPowerOfTwo(image.width) && isPowerOfTwo(image.height)) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        for (uint32_t size = image.width > image.height ? image.width : image.height; size > 1; size >>= 1)
+            ++levels_;
+        byteSize_ += byteSize_ / 3;
+    }
+    setFilters(image.width, image.height, levels_);
+
+    size_ = Dimension2Di32(static_cast<int32_t>(image.width), static_cast<int32_t>(image.height));
+    compressed_ = native;
+    ResourceRegistry::global().track(GpuResourceType::kTexture, texture_, byteSize_);
+    return true;
+}
+
+
+LYS_API bool Texture::loadImage(const String &path) {
+    destroy();
+    PHYSFS_File *file = PHYSFS_openRead(path.c_str());
+    if (file == nullptr)
+        return false;
+
+    PHYSFS_sint64 length = PHYSFS_fileLength(file);
+    if (length <= 0) {
+        PHYSFS_close(file);
+        return false;
+    }
+    Vector<uint8_t> data(static_cast<size_t>(length));
+    PHYSFS_sint64 read = PHYSFS_readBytes(file, data.data(), data.size());
+    PHYSFS_close(file);
+    if (read != length)
+        return false;
+
+    return loadImageFromMemory(data.data(), data.size());
+}
+
+
+LYS_API bool Texture::loadImageFromMemory(const void *data, size_t size) {
+    destroy();
+    SDL_RWops *rw = SDL_RWFromConstMem(data, static_cast<int>(size));
+    if (rw == nullptr)
+        return false;
+    SDL_Surface *loaded = IMG_Load_RW(rw, 1);
+    if (loaded == nullptr)
+        return false;
+    SDL_Surface *surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (surface == nullptr)
+        return false;
+
+    SDL_LockSurface(surface);
+    KtxImage image;
+    image.glType = GL_UNSIGNED_BYTE;
+    image.glFormat = GL_RGBA;
+    image.glInternalFormat = GL_RGBA;
+    image.glBaseInternalFormat = GL_RGBA;
+    image.width = static_cast<uint32_t>(surface->w);
+    image.height = static_cast<uint32_t>(surface->h);
+    KtxLevel level = {static_cast<const uint8_t*>(surface->pixels),
+                      static_cast<uint32_t>(surface->pitch * surface->h), image.width, image.height};
+    image.levels.push_back(level);
+    bool uploaded = load(image);
+    SDL_UnlockSurface(surface);
+    SDL_FreeSurface(surface);
+    return uploaded;
+}
+
+
+LYS_API void Texture::destroy() {
+    if (texture_) {
+        ResourceRegistry::global().release(GpuResourceType::kTexture, texture_);
+        texture_ = 0;
+    }
+    size_ = Dimension2Di32(0, 0);
+    levels_ = 0;
+    byteSize_ = 0;
+    compressed_ = false;
+}
+
+
+LYS_API void Texture::bind(uint32_t unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    ResourceRegistry::global().touch(GpuResourceType::kTexture, texture_);
+}
+}
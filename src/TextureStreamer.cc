@@ -0,0 +1,554 @@
+/***************************************************
+* TextureStreamer.cc: Mip streaming within budget  *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "TextureStreamer.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <physfs.h>
+
+#include "config.h"
+#include "types.h"
+#include "Profiler.h"
+#include "ResourceRegistry.h"
+#include "Texture.h"
+
+namespace lys3d {
+namespace {
+const uint32_t kNotLoading = 0xFFFFFFFF;
+const size_t kKtxHeaderSize = 64;
+
+uint32_t readU32(const uint8_t *p, bool swap) {
+    uint32_t value;
+    memcpy(&value, p, 4);
+    if (swap)
+        value = (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+    return value;
+}
+
+struct Entry {
+    String path;
+    /** Header fields and level sizes; level data pointers stay null. */
+    KtxImage header;
+    /** File offset of each level's imageSize field, plus the end of the last level. */
+    Vector<uint64_t> offsets;
+    /** File bytes of levels [i, count), for the budget. */
+    Vector<uint64_t> bytesFrom;
+    bool live;
+    bool swapped;
+    bool failed;
+    bool requested;
+    /** Evicted by the registry: held at the mip tail until that's uploaded. */
+    bool evicting;
+    uint32_t generation;
+    uint32_t tail;
+    uint32_t wanted;
+    uint32_t target;
+    uint32_t resident;
+    uint32_t loading;
+    float pixels;
+    uint64_t lastNeeded;
+    /** Video memory per file byte, learned from the first upload (CPU decoding can grow it). */
+    float memoryScale;
+    Texture* texture;
+};
+
+struct LoadJob {
+    uint32_t id;
+    uint32_t generation;
+    uint32_t level;
+    String path;
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct LoadResult {
+    uint32_t id;
+    uint32_t generation;
+    uint32_t level;
+    bool ok;
+    Vector<uint8_t> data;
+};
+
+uint64_t cost(const Entry &entry, uint32_t level) {
+    return static_cast<uint64_t>(entry.bytesFrom[level] * entry.memoryScale);
+}
+}
+
+
+struct TextureStreamer::Impl {
+    Impl() {
+        budget = 0;
+        minResidentSize = 64;
+        uploadLimit = 4 * 1024 * 1024;
+        projScale = 0.0f;
+        frame = 0;
+        memset(&stats, 0, sizeof(stats));
+        quit = false;
+        inFlight = 0;
+        Profiler &profiler = Profiler::global();
+        residentCounter = profiler.counter("Streamed texture bytes", false);
+        pendingCounter = profiler.counter("Stream requests pending", false);
+        missCounter = profiler.counter("Stream budget misses");
+    }
+
+    Entry* find(uint32_t id) {
+        if (id == 0 || id > entries.size() || !entries[id - 1].live)
+            return nullptr;
+        return &entries[id - 1];
+    }
+
+    const Entry* find(uint32_t id) const {
+        return const_cast<Impl*>(this)->find(id);
+    }
+
+    uint32_t levelFor(const Entry &entry, float pixels) const {
+        // The smallest level still at least as wide (or high) as its coverage
+        uint32_t top = std::max(entry.header.width, entry.header.height);
+        uint32_t level = 0;
+        while (level < entry.tail && static_cast<float>(top >> (level + 1)) >= pixels)
+            ++level;
+        return level;
+    }
+
+    // Registry eviction: fall back to the mip tail, which replaces (and
+    // frees) the texture once it's been re-read. The registry already counts
+    // the bytes as freed, so the texture stops being a candidate until then.
+    static void evict(void *user_data, GpuResourceType type, uint32_t name) {
+        Impl *impl = static_cast<Impl*>(user_data);
+        for (Entry &entry : impl->entries) {
+            if (type == GpuResourceType::kTexture && entry.texture != nullptr && entry.texture->texture() == name) {
+                entry.evicting = true;
+                entry.wanted = entry.tail;
+                ResourceRegistry::global().reloadable(type, name, nullptr, nullptr);
+            }
+        }
+    }
+
+    void loaderMain() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return quit || !queue.empty(); });
+            if (quit)
+                return;
+            LoadJob job = queue.front();
+            queue.pop_front();
+            ++inFlight;
+            lock.unlock();
+
+            LoadResult result;
+            result.id = job.id;
+            result.generation = job.generation;
+            result.level = job.level;
+            result.ok = false;
+            PHYSFS_File *file = PHYSFS_openRead(job.path.c_str());
+            if (file != nullptr) {
+                result.data.resize(static_cast<size_t>(job.size));
+                result.ok = PHYSFS_seek(file, job.offset) != 0
+                    && PHYSFS_readBytes(file, result.data.data(), job.size) == static_cast<PHYSFS_sint64>(job.size);
+                PHYSFS_close(file);
+            }
+
+            lock.lock();
+            results.push_back(std::move(result));
+            --inFlight;
+            if (queue.empty() && inFlight == 0)
+                idle.notify_all();
+        }
+    }
+
+    uint64_t budget;
+    uint32_t minResidentSize;
+    uint64_t uploadLimit;
+    float projScale;
+    uint64_t frame;
+    TextureStreamStats stats;
+    Vector<Entry> entries;
+    Vector<uint32_t> order;
+    Vector<LoadResult> uploads;
+    Vector<Texture*> garbage;
+    uint32_t residentCounter;
+    uint32_t pendingCounter;
+    uint32_t missCounter;
+
+    // Shared with the loader thread
+    std::thread loader;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<LoadJob> queue;
+    Vector<LoadResult> results;
+    uint32_t inFlight;
+    bool quit;
+};
+
+
+LYS_API TextureStreamer::TextureStreamer(uint64_t budget) {
+    pimpl_ = new Impl();
+    pimpl_->budget = budget;
+    projection(Dimension2Di32(1920, 1080), 1.0471976f);
+}
+
+
+LYS_API TextureStreamer::~TextureStreamer() {
+    if (pimpl_->loader.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(pimpl_->mutex);
+            pimpl_->quit = true;
+        }
+        pimpl_->wake.notify_all();
+        pimpl_->loader.join();
+    }
+    for (Entry &entry : pimpl_->entries)
+        delete entry.texture;
+    for (Texture *texture : pimpl_->garbage)
+        delete texture;
+    delete pimpl_;
+}
+
+
+LYS_API uint64_t TextureStreamer::budget() const {
+    return pimpl_->budget;
+}
+
+
+LYS_API void TextureStreamer::budget(uint64_t bytes) {
+    pimpl_->budget = bytes;
+}
+
+
+LYS_API uint32_t TextureStreamer::minResidentSize() const {
+    return pimpl_->minResidentSize;
+}
+
+
+LYS_API void TextureStreamer::minResidentSize(uint32_t pixels) {
+    pimpl_->minResidentSize = pixels;
+}
+
+
+LYS_API uint64_t TextureStreamer::uploadLimit() const {
+    return pimpl_->uploadLimit;
+}
+
+
+LYS_API void TextureStreamer::uploadLimit(uint64_t bytes) {
+    pimpl_->uploadLimit = bytes;
+}
+
+
+LYS_API void TextureStreamer::projection(const IWindow &window, float fov_y) {
+    projection(window.sizeInPixels(), fov_y);
+}
+
+
+LYS_API void TextureStreamer::projection(const Dimension2Di32 &viewport, float fov_y) {
+    pimpl_->projScale = viewport.height() / (2.0f * tanf(fov_y * 0.5f));
+}
+
+
+LYS_API uint32_t TextureStreamer::add(const String &path) {
+    PHYSFS_File *file = PHYSFS_openRead(path.c_str());
+    if (file == nullptr)
+        return 0;
+
+    // Walk the level sizes so reads can later go straight to any level
+    Entry entry;
+    uint8_t header[kKtxHeaderSize];
+    size_t offset;
+    bool ok = PHYSFS_readBytes(file, header, kKtxHeaderSize) == static_cast<PHYSFS_sint64>(kKtxHeaderSize)
+        && parseKTXHeader(header, kKtxHeaderSize, &entry.header, &offset, &entry.swapped);
+    for (size_t i = 0; ok && i < entry.header.levels.size(); ++i) {
+        uint8_t size_field[4];
+        ok = PHYSFS_seek(file, offset) != 0 && PHYSFS_readBytes(file, size_field, 4) == 4;
+        if (!ok)
+            break;
+        uint32_t size = readU32(size_field, entry.swapped);
+        entry.header.levels[i].size = size;
+        entry.offsets.push_back(offset);
+        offset += 4 + ((static_cast<size_t>(size) + 3) & ~static_cast<size_t>(3));
+    }
+    PHYSFS_sint64 length = PHYSFS_fileLength(file);
+    PHYSFS_close(file);
+    if (!ok || length < 0 || offset - 3 > static_cast<uint64_t>(length))
+        return 0;
+    entry.offsets.push_back(offset);
+
+    uint32_t count = static_cast<uint32_t>(entry.header.levels.size());
+    entry.bytesFrom.resize(count + 1);
+    entry.bytesFrom[count] = 0;
+    for (uint32_t i = count; i-- > 0;)
+        entry.bytesFrom[i] = entry.bytesFrom[i + 1] + entry.header.levels[i].size;
+
+    entry.tail = count - 1;
+    while (entry.tail > 0) {
+        const KtxLevel &level = entry.header.levels[entry.tail - 1];
+        if (std::max(level.width, level.height) > pimpl_->minResidentSize)
+            break;
+        --entry.tail;
+    }
+
+    entry.path = path;
+    entry.live = true;
+    entry.failed = false;
+    entry.requested = false;
+    entry.evicting = false;
+    entry.generation = 0;
+    entry.wanted = entry.tail;
+    entry.target = entry.tail;
+    entry.resident = count;
+    entry.loading = kNotLoading;
+    entry.pixels = 0.0f;
+    entry.lastNeeded = pimpl_->frame;
+    entry.memoryScale = 1.0f;
+    entry.texture = nullptr;
+    pimpl_->entries.push_back(std::move(entry));
+
+    if (!pimpl_->loader.joinable())
+        pimpl_->loader = std::thread(&Impl::loaderMain, pimpl_);
+    return static_cast<uint32_t>(pimpl_->entries.size());
+}
+
+
+LYS_API void TextureStreamer::remove(uint32_t id) {
+    Entry *entry = pimpl_->find(id);
+    if (entry == nullptr)
+        return;
+
+    // Ids aren't reused; the generation bump makes any read in flight stale
+    if (entry->texture != nullptr)
+        pimpl_->garbage.push_back(entry->texture);
+    entry->texture = nullptr;
+    entry->live = false;
+    ++entry->generation;
+    entry->header.levels.clear();
+    entry->offsets.clear();
+    entry->bytesFrom.clear();
+}
+
+
+LYS_API void TextureStreamer::request(uint32_t id, float pixels) {
+    Entry *entry = pimpl_->find(id);
+    if (entry == nullptr)
+        return;
+    if (!entry->requested || pixels > entry->pixels)
+        entry->pixels = pixels;
+    entry->requested = true;
+    if (entry->texture != nullptr)
+        ResourceRegistry::global().touch(GpuResourceType::kTexture, entry->texture->texture());
+}
+
+
+LYS_API void TextureStreamer::request(uint32_t id, const Point3Df &camera, const Point3Df &center,
+                                      float radius, float repeat) {
+    float dx = center.x() - camera.x(), dy = center.y() - camera.y(), dz = center.z() - camera.z();
+    float distance = std::max(sqrtf(dx * dx + dy * dy + dz * dz) - radius, 1e-3f);
+    request(id, 2.0f * radius * pimpl_->projScale / distance / repeat);
+}
+
+
+LYS_API void TextureStreamer::plan() {
+    LYS_PROFILE_ZONE("Texture streaming");
+    Impl &impl = *pimpl_;
+    ++impl.frame;
+    impl.stats.budgetMisses = 0;
+    impl.stats.uploads = 0;
+    impl.stats.uploadedBytes = 0;
+
+    // Targets: what this frame's requests want (unrequested textures keep
+    // whatever they last wanted until the budget needs it back)
+    impl.order.clear();
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < impl.entries.size(); ++i) {
+        Entry &entry = impl.entries[i];
+        if (!entry.live || entry.failed)
+            continue;
+        if (entry.requested) {
+            if (!entry.evicting)
+                entry.wanted = impl.levelFor(entry, entry.pixels);
+            entry.lastNeeded = impl.frame;
+        }
+        entry.target = entry.wanted;
+        total += cost(entry, entry.target);
+        impl.order.push_back(i);
+    }
+
+    // Over budget: drop levels from the least recently needed textures first
+    // (among equals, the ones wanting the coarsest levels). Mip tails stay.
+    if (total > impl.budget) {
+        std::stable_sort(impl.order.begin(), impl.order.end(), [&impl](uint32_t a, uint32_t b) {
+            const Entry &ea = impl.entries[a], &eb = impl.entries[b];
+            if (ea.lastNeeded != eb.lastNeeded)
+                return ea.lastNeeded < eb.lastNeeded;
+            return ea.wanted > eb.wanted;
+        });
+        for (uint32_t index : impl.order) {
+            Entry &entry = impl.entries[index];
+            while (total > impl.budget && entry.target < entry.tail) {
+                total -= cost(entry, entry.target) - cost(entry, entry.target + 1);
+                ++entry.target;
+            }
+            if (entry.requested && entry.target > entry.wanted)
+                ++impl.stats.budgetMisses;
+            if (total <= impl.budget)
+                break;
+        }
+    }
+
+    // Queue reads, most recently needed and furthest from their target first
+    std::stable_sort(impl.order.begin(), impl.order.end(), [&impl](uint32_t a, uint32_t b) {
+        const Entry &ea = impl.entries[a], &eb = impl.entries[b];
+        if (ea.lastNeeded != eb.lastNeeded)
+            return ea.lastNeeded > eb.lastNeeded;
+        return ea.target < eb.target;
+    });
+    {
+        std::lock_guard<std::mutex> lock(impl.mutex);
+        for (uint32_t index : impl.order) {
+            Entry &entry = impl.entries[index];
+            if (entry.target == entry.resident || entry.loading != kNotLoading)
+                continue;
+            LoadJob job;
+            job.id = index + 1;
+            job.generation = entry.generation;
+            job.level = entry.target;
+            job.path = entry.path;
+            job.offset = entry.offsets[entry.target];
+            job.size = entry.offsets.back() - job.offset;
+            impl.queue.push_back(job);
+            entry.loading = entry.target;
+        }
+        impl.stats.pendingRequests = static_cast<uint32_t>(impl.queue.size() + impl.inFlight
+                                                           + impl.results.size() + impl.uploads.size());
+    }
+    impl.wake.notify_one();
+
+    for (Entry &entry : impl.entries)
+        entry.requested = false;
+
+    Profiler &profiler = Profiler::global();
+    profiler.set(impl.pendingCounter, impl.stats.pendingRequests);
+    profiler.count(impl.missCounter, impl.stats.budgetMisses);
+}
+
+
+LYS_API void TextureStreamer::upload() {
+    LYS_PROFILE_ZONE("Texture uploads");
+    Impl &impl = *pimpl_;
+    for (Texture *texture : impl.garbage)
+        delete texture;
+    impl.garbage.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(impl.mutex);
+        for (LoadResult &result : impl.results)
+            impl.uploads.push_back(std::move(result));
+        impl.results.clear();
+    }
+
+    size_t done = 0;
+    uint64_t uploaded = 0;
+    for (; done < impl.uploads.size() && (done == 0 || uploaded < impl.uploadLimit); ++done) {
+        LoadResult &result = impl.uploads[done];
+        Entry &entry = impl.entries[result.id - 1];
+        if (!entry.live || entry.generation != result.generation)
+            continue;
+        entry.loading = kNotLoading;
+        if (!result.ok) {
+            entry.failed = true;
+            continue;
+        }
+
+        // The read started at the size field of result.level
+        KtxImage image = entry.header;
+        image.levels.erase(image.levels.begin(), image.levels.begin() + result.level);
+        image.width = image.levels[0].width;
+        image.height = image.levels[0].height;
+        uint64_t base = entry.offsets[result.level];
+        for (uint32_t i = 0; i < image.levels.size(); ++i)
+            image.levels[i].data = result.data.data() + (entry.offsets[result.level + i] - base) + 4;
+
+        Texture *texture = new Texture();
+        if (!texture->load(image)) {
+            delete texture;
+            entry.failed = true;
+            continue;
+        }
+        delete entry.texture;
+        entry.texture = texture;
+        if (result.level == entry.tail)
+            entry.evicting = false;
+        else if (!entry.evicting)
+            ResourceRegistry::global().reloadable(GpuResourceType::kTexture, texture->texture(), &Impl::evict, &impl);
+        entry.resident = result.level;
+        entry.memoryScale = static_cast<float>(texture->byteSize())
+            / static_cast<float>(entry.bytesFrom[result.level]);
+        uploaded += texture->byteSize();
+        ++impl.stats.uploads;
+    }
+    impl.uploads.erase(impl.uploads.begin(), impl.uploads.begin() + done);
+    impl.stats.uploadedBytes = uploaded;
+
+    uint64_t resident = 0;
+    for (const Entry &entry : impl.entries) {
+        if (entry.texture != nullptr)
+            resident += entry.texture->byteSize();
+    }
+    impl.stats.residentBytes = resident;
+    Profiler::global().set(impl.residentCounter, static_cast<int64_t>(resident));
+}
+
+
+LYS_API void TextureStreamer::update() {
+    plan();
+    upload();
+}
+
+
+LYS_API void TextureStreamer::finish() {
+    std::unique_lock<std::mutex> lock(pimpl_->mutex);
+    pimpl_->idle.wait(lock, [this] { return pimpl_->queue.empty() && pimpl_->inFlight == 0; });
+}
+
+
+LYS_API uint32_t TextureStreamer::texture(uint32_t id) const {
+    const Entry *entry = pimpl_->find(id);
+    return (entry != nullptr && entry->texture != nullptr) ? entry->texture->texture() : 0;
+}
+
+
+LYS_API uint32_t TextureStreamer::targetLevel(uint32_t id) const {
+    const Entry *entry = pimpl_->find(id);
+    return entry != nullptr ? entry->target : 0;
+}
+
+
+LYS_API uint32_t TextureStreamer::residentLevel(uint32_t id) const {
+    const Entry *entry = pimpl_->find(id);
+    return entry != nullptr ? entry->resident : 0;
+}
+
+
+LYS_API uint32_t TextureStreamer::levelCount(uint32_t id) const {
+    const Entry *entry = pimpl_->find(id);
+    return entry != nullptr ? static_cast<uint32_t>(entry->header.levels.size()) : 0;
+}
+
+
+LYS_API const TextureStreamStats& TextureStreamer::stats() const {
+    return pimpl_->stats;
+}
+}
@@ -0,0 +1,279 @@
+/***************************************************
+* VertexLayout.cc: Vertex formats & quantization   *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "VertexLayout.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "GLES2/gl2.h"
+#include "GLES2/gl2ext.h"
+#include <SDL2/SDL_video.h>
+
+#include "config.h"
+#include "types.h"
+
+namespace lys3d {
+namespace {
+struct FormatInfo {
+    GLenum type;
+    GLboolean normalized;
+    uint8_t size;
+};
+
+FormatInfo formatInfo(VertexFormat format) {
+    switch (format) {
+        case VertexFormat::kHalfFloat:  return {GL_HALF_FLOAT_OES, GL_FALSE, 2};
+        case VertexFormat::kShortNorm:  return {GL_SHORT, GL_TRUE, 2};
+        case VertexFormat::kUShortNorm: return {GL_UNSIGNED_SHORT, GL_TRUE, 2};
+        case VertexFormat::kByteNorm:   return {GL_BYTE, GL_TRUE, 1};
+        case VertexFormat::kUByteNorm:  return {GL_UNSIGNED_BYTE, GL_TRUE, 1};
+        case VertexFormat::kFloat:
+        default:                        return {GL_FLOAT, GL_FALSE, 4};
+    }
+}
+
+// GLES2 maps signed normalized integers as (2c + 1) / (2^b - 1), so there is
+// no exact zero; encode with the inverse of that rather than the GL3 rule.
+int32_t encodeSnorm(float value, int bits) {
+    float max_code = static_cast<float>((1 << bits) - 1);
+    float code = floorf((fmaxf(-1.0f, fminf(1.0f, value)) * max_code - 1.0f) * 0.5f + 0.5f);
+    float lo = -static_cast<float>(1 << (bits - 1));
+    float hi = static_cast<float>((1 << (bits - 1)) - 1);
+    return static_cast<int32_t>(fmaxf(lo, fminf(hi, code)));
+}
+
+uint32_t encodeUnorm(float value, int bits) {
+    float max_code = static_cast<float>((1 << bits) - 1);
+    return static_cast<uint32_t>(fmaxf(0.0f, fminf(1.0f, value)) * max_code + 0.5f);
+}
+
+// Octahedral mapping of a unit vector onto [-1, 1]^2
+void encodeOctahedral(const float *n, float *out) {
+    float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+    if (l1 <= 0.0f) {
+        out[0] = out[1] = 0.0f;
+        return;
+    }
+    float x = n[0] / l1, y = n[1] / l1;
+    if (n[2] < 0.0f) {
+        float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    out[0] = x;
+    out[1] = y;
+}
+}
+
+
+LYS_API VertexLayout& VertexLayout::add(uint32_t location, uint8_t components, VertexFormat format) {
+    VertexAttribute attribute;
+    attribute.location = location;
+    attribute.components = components;
+    attribute.format = format;
+    attribute.offset = static_cast<uint16_t>(stride_);
+    attributes_.push_back(attribute);
+    stride_ = (stride_ + components * formatInfo(format).size + 3) & ~3u;
+    return *this;
+}
+
+
+LYS_API void VertexLayout::apply(size_t base_offset) const {
+    for (const VertexAttribute &attribute : attributes_) {
+        FormatInfo info = formatInfo(attribute.format);
+        glVertexAttribPointer(attribute.location, attribute.components, info.type,
+                              info.normalized, static_cast<GLsizei>(stride_),
+                              reinterpret_cast<const void*>(base_offset + attribute.offset));
+        glEnableVertexAttribArray(attribute.location);
+    }
+}
+
+
+LYS_API void VertexLayout::rebase(size_t base_offset) const {
+    for (const VertexAttribute &attribute : attributes_) {
+        FormatInfo info = formatInfo(attribute.format);
+        glVertexAttribPointer(attribute.location, attribute.components, info.type,
+                              info.normalized, static_cast<GLsizei>(stride_),
+                              reinterpret_cast<const void*>(base_offset + attribute.offset));
+    }
+}
+
+
+LYS_API void VertexLayout::disable() const {
+    for (const VertexAttribute &attribute : attributes_)
+        glDisableVertexAttribArray(attribute.location);
+}
+
+
+LYS_API VertexLayout VertexLayout::full() {
+    VertexLayout layout;
+    layout.add(kAttribPosition, 3, VertexFormat::kFloat)
+          .add(kAttribNormal, 3, VertexFormat::kFloat)
+          .add(kAttribTexCoord, 2, VertexFormat::kFloat);
+    return layout;
+}
+
+
+LYS_API VertexLayout VertexLayout::compressed(bool half_float_uvs) {
+    // 8 + 4 + 4 bytes. Position gets a 4th short as padding, since 6-byte
+    // attributes would misalign the normal anyway.
+    VertexLayout layout;
+    layout.add(kAttribPosition, 4, VertexFormat::kShortNorm)
+          .add(kAttribNormal, 2, VertexFormat::kByteNorm)
+          .add(kAttribTexCoord, 2, half_float_uvs ? VertexFormat::kHalfFloat : VertexFormat::kUShortNorm);
+    return layout;
+}
+
+
+LYS_API void VertexQuantizer::quantize(const Vector<MeshVertex> &vertices, QuantizedVertices *out) const {
+    bool half_uvs = halfFloatUVs_;
+    if (!forceUVFormat_)
+        half_uvs = (SDL_GL_ExtensionSupported("GL_OES_vertex_half_float") == SDL_TRUE);
+    out->layout = VertexLayout::compressed(half_uvs);
+
+    // Bounds for positions (and UVs, if they end up as integers)
+    float pos_min[3] = {0, 0, 0}, pos_max[3] = {0, 0, 0};
+    float uv_min[2] = {0, 0}, uv_max[2] = {0, 0};
+    if (!vertices.empty()) {
+        memcpy(pos_min, vertices[0].position, sizeof(pos_min));
+        memcpy(pos_max, vertices[0].position, sizeof(pos_max));
+        memcpy(uv_min, vertices[0].uv, sizeof(uv_min));
+        memcpy(uv_max, vertices[0].uv, sizeof(uv_max));
+    }
+    for (const MeshVertex &v : vertices) {
+        for (int k = 0; k < 3; ++k) {
+            pos_min[k] = fminf(pos_min[k], v.position[k]);
+            pos_max[k] = fmaxf(pos_max[k], v.position[k]);
+        }
+        for (int k = 0; k < 2; ++k) {
+            uv_min[k] = fminf(uv_min[k], v.uv[k]);
+            uv_max[k] = fmaxf(uv_max[k], v.uv[k]);
+        }
+    }
+    for (int k = 0; k < 3; ++k) {
+        out->positionBias[k] = (pos_min[k] + pos_max[k]) * 0.5f;
+        out->positionScale[k] = fmaxf((pos_max[k] - pos_min[k]) * 0.5f, 1e-20f);
+    }
+    for (int k = 0; k < 2; ++k) {
+        out->uvScale[k] = half_uvs ? 1.0f : fmaxf(uv_max[k] - uv_min[k], 1e-20f);
+        out->uvBias[k] = half_uvs ? 0.0f : uv_min[k];
+    }
+
+    uint32_t stride = out->layout.stride();
+    out->data.assign(vertices.size() * stride, 0);
+    uint8_t *dst = out->data.data();
+    for (const MeshVertex &v : vertices) {
+        int16_t position[4];
+        for (int k = 0; k < 3; ++k) {
+            float normalized = (v.position[k] - out->positionBias[k]) / out->positionScale[k];
+            position[k] = static_cast<int16_t>(encodeSnorm(normalized, 16));
+        }
+        position[3] = 0;
+        memcpy(dst, position, sizeof(position));
+
+        float oct[2];
+        encodeOctahedral(v.normal, oct);
+        int8_t normal[2] = {static_cast<int8_t>(encodeSnorm(oct[0], 8)),
+                            static_cast<int8_t>(encodeSnorm(oct[1], 8))};
+        memcpy(dst + 8, normal, sizeof(normal));
+
+        uint16_t uv[2];
+        for (int k = 0; k < 2; ++k) {
+            if (half_uvs)
+                uv[k] = floatToHalf(v.uv[k]);
+            else
+                uv[k] = static_cast<uint16_t>(encodeUnorm((v.uv[k] - out->uvBias[k]) / out->uvScale[k], 16));
+        }
+        memcpy(dst + 12, uv, sizeof(uv));
+        dst += stride;
+    }
+}
+
+
+LYS_API uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t exponent = (bits >> 23) & 0xFFu;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+
+    if (exponent == 0xFFu) // Inf / NaN
+        return static_cast<uint16_t>(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+
+    int32_t half_exponent = static_cast<int32_t>(exponent) - 127 + 15;
+    if (half_exponent >= 0x1F) // Overflow to infinity
+        return static_cast<uint16_t>(sign | 0x7C00u);
+
+    if (half_exponent <= 0) {
+        // Subnormal half (or zero)
+        if (half_exponent < -10)
+            return static_cast<uint16_t>(sign);
+        mantissa |= 0x800000u;
+        uint32_t shift = static_cast<uint32_t>(14 - half_exponent);
+        uint32_t half_mantissa = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half_mantissa & 1u)))
+            ++half_mantissa;
+        return static_cast<uint16_t>(sign | half_mantissa);
+    }
+
+    uint32_t half = sign | (static_cast<uint32_t>(half_exponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1FFFu;
+    // Round to nearest even; a carry into the exponent is still correct
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+        ++half;
+    return static_cast<uint16_t>(half);
+}
+
+
+LYS_API float halfToFloat(uint16_t half) {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1Fu;
+    uint32_t mantissa = half & 0x3FFu;
+    uint32_t bits;
+
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            // Normalize the subnormal
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400u) == 0) {
+                mantissa <<= 1;
+                --exponent;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+        }
+    } else if (exponent == 0x1F) {
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+LYS_API const char* kVertexDecodeGLSL =
+    "vec3 lysDecodePosition(vec3 q, vec3 scale, vec3 bias) {\n"
+    "    return q * scale + bias;\n"
+    "}\n"
+    "vec3 lysDecodeNormal(vec2 oct) {\n"
+    "    vec3 n = vec3(oct, 1.0 - abs(oct.x) - abs(oct.y));\n"
+    "    if (n.z < 0.0)\n"
+    "        n.xy = (1.0 - abs(n.yx)) * (step(0.0, n.xy) * 2.0 - 1.0);\n"
+    "    return normalize(n);\n"
+    "}\n";
+}
@@ -10,13 +10,31 @@
 
 #include "WindowGLES2.h"
 
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
 #include "GLES2/gl2.h"
 #include <SDL2/SDL_video.h>
 
 #include "config.h"
 #include "types.h"
+#include "GLState.h"
+#include "GLTrace.h"
+#include "Profiler.h"
+#include "ProfilerOverlay.h"
+#include "ResourceRegistry.h"
+#include "SceneTarget.h"
 
 namespace lys3d {
+namespace {
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+
 struct WindowGLES2::Impl {
     /** Defaults to full-screen VSynced mode at the native screen resolution. */
     Impl() {
@@ -27,6 +45,49 @@ struct WindowGLES2::Impl {
         size = Dimension2Di32(1, 1);
         fullscreenMode = SDL_WINDOW_FULLSCREEN_DESKTOP;
         wantVSync = true;
+        showProfiler = false;
+        overlay = nullptr;
+        dynamicResolution = false;
+        scene = nullptr;
+        sceneActive = false;
+        sceneRendered = false;
+        frameStart = 0;
+        lastSwap = 0;
+        capturing = false;
+        frameCapture = nullptr;
+        glShadowing = false;
+        scaleCounter = Profiler::global().counter("Resolution scale (%)", false);
+#ifdef LYS_DEBUG
+        glChecking = true;
+        glCounters[0] = Profiler::global().counter("GL errors");
+        glCounters[1] = Profiler::global().counter("GL queries");
+        glCounters[2] = Profiler::global().counter("GL redundant binds");
+        glCounters[3] = Profiler::global().counter("GL redundant state");
+#else
+        glChecking = false;
+#endif
+    }
+
+    // Frame times for the resolution controller. Which ones reflect the
+    // GPU depends on what's available: timer queries measure it directly,
+    // without VSync the swap interval does, and with VSync only dropped
+    // frames show up in it.
+    void measureFrame(int64_t before_swap, int64_t after_swap) {
+        const double to_ms = 1.0e-6;
+        if (sceneRendered && frameStart != 0 && lastSwap != 0) {
+            float target = resolution.settings().targetFrameMs;
+            float frame_ms = static_cast<float>((before_swap - frameStart) * to_ms);
+            float interval_ms = static_cast<float>((after_swap - lastSwap) * to_ms);
+            if (scene != nullptr && scene->gpuMs() >= 0.0f)
+                frame_ms = std::max(frame_ms, scene->gpuMs());
+            if (!wantVSync || interval_ms > target * 1.5f)
+                frame_ms = std::max(frame_ms, interval_ms);
+            resolution.update(frame_ms);
+            Profiler::global().set(scaleCounter, lroundf(resolution.scale() * 100.0f));
+        }
+        sceneRendered = false;
+        lastSwap = after_swap;
+        frameStart = after_swap;
     }
 
     SDL_Window* window;
@@ -36,6 +97,24 @@ struct WindowGLES2::Impl {
     Dimension2Di32 size;
     uint32_t fullscreenMode;
     bool wantVSync;
+    bool showProfiler;
+    ProfilerOverlay* overlay;
+    bool dynamicResolution;
+    ResolutionController resolution;
+    SceneTarget* scene;
+    Dimension2Di32 sceneSize;
+    bool sceneActive;
+    bool sceneRendered;
+    int64_t frameStart;
+    int64_t lastSwap;
+    bool capturing;
+    FrameCapture* frameCapture;
+    bool glShadowing;
+    uint32_t scaleCounter;
+    bool glChecking;
+#ifdef LYS_DEBUG
+    uint32_t glCounters[4];
+#endif
 };
 
 
@@ -47,6 +126,7 @@ LYS_API WindowGLES2::WindowGLES2() {
 
 LYS_API WindowGLES2::~WindowGLES2() {
     this->close();
+    delete this->pimpl_->frameCapture;
     delete this->pimpl_;
 }
 
@@ -107,11 +187,60 @@ LYS_API bool WindowGLES2::open() {
     if (!useVSync(pimpl_->wantVSync))
         SDL_ClearError();
 
-    return activate();
+    if (!activate())
+        return false;
+
+    // The scene target, overlay, debug drawing and capture save the state
+    // they change every frame; the shadow lets them do so without glGet*
+    pimpl_->glShadowing = shadowGLState(true);
+
+#ifdef LYS_DEBUG
+    // Checked before the capture hooks, so the capture records the calls
+    // the engine made rather than the checks' glGetError()s
+    if (pimpl_->glChecking && !enableGLChecks(1))
+        pimpl_->glChecking = false;
+#endif
+
+    // Record the GL calls for lys3d-glreplay if asked to, from before any
+    // object is created
+    const char *capture_path = SDL_getenv("LYS3D_GL_CAPTURE");
+    if (capture_path != nullptr && capture_path[0] != '\0')
+        pimpl_->capturing = GLCapture::global().start(capture_path, sizeInPixels());
+    return true;
 }
 
 
 LYS_API void WindowGLES2::close() {
+    // The overlay's GL objects and any deletions still queued for this
+    // window live in its context
+    if (pimpl_->context) {
+        SDL_Window *current_window = SDL_GL_GetCurrentWindow();
+        SDL_GLContext current_context = SDL_GL_GetCurrentContext();
+        if (current_context != pimpl_->context)
+            SDL_GL_MakeCurrent(pimpl_->window, pimpl_->context);
+        delete pimpl_->frameCapture;
+        pimpl_->frameCapture = nullptr;
+        delete pimpl_->overlay;
+        pimpl_->overlay = nullptr;
+        delete pimpl_->scene;
+        pimpl_->scene = nullptr;
+        ResourceRegistry::global().collect(true);
+        if (pimpl_->capturing) {
+            GLCapture::global().stop();
+            pimpl_->capturing = false;
+        }
+#ifdef LYS_DEBUG
+        if (pimpl_->glChecking)
+            enableGLChecks(0);
+#endif
+        if (pimpl_->glShadowing) {
+            shadowGLState(false);
+            pimpl_->glShadowing = false;
+        }
+        if (current_context != pimpl_->context)
+            SDL_GL_MakeCurrent(current_window, current_context);
+    }
+
     if (pimpl_->context) {
         SDL_GL_DeleteContext(pimpl_->context);
         pimpl_->context = nullptr;
@@ -159,12 +288,56 @@ LYS_API bool WindowGLES2::update() {
 
     // TODO: Handle SDL window events
 
+    // The overlay is drawn after the frame is closed, so its own draw call
+    // and state changes never show up in the counters.
+    if (pimpl_->scene != nullptr)
+        pimpl_->scene->endTiming();
+    if (pimpl_->frameCapture != nullptr)
+        pimpl_->frameCapture->capture(sizeInPixels());
+    int64_t before_swap = now();
+    Profiler &profiler = Profiler::global();
+#ifdef LYS_DEBUG
+    if (pimpl_->glChecking) {
+        GLSlowPathCounts counts;
+        takeGLSlowPathCounts(&counts);
+        profiler.count(pimpl_->glCounters[0], counts.errors);
+        profiler.count(pimpl_->glCounters[1], counts.queries);
+        profiler.count(pimpl_->glCounters[2], counts.redundantBinds);
+        profiler.count(pimpl_->glCounters[3], counts.redundantStates);
+    }
+#endif
+    if (pimpl_->showProfiler) {
+        if (!profiler.isCountingGL())
+            profiler.countGL(true);
+        profiler.endFrame();
+        if (pimpl_->overlay == nullptr)
+            pimpl_->overlay = new ProfilerOverlay();
+        pimpl_->overlay->draw(profiler, sizeInPixels());
+#ifdef LYS_DEBUG
+        // Nor in the slow path counts, which would otherwise take them
+        // as the start of the next frame's
+        GLSlowPathCounts overlay_counts;
+        if (pimpl_->glChecking)
+            takeGLSlowPathCounts(&overlay_counts);
+#endif
+    }
+
     SDL_GL_SwapWindow(pimpl_->window);
+    pimpl_->measureFrame(before_swap, now());
+    if (pimpl_->capturing)
+        GLCapture::global().frame();
 
     // Ideally the visible color buffer should be entirely overwritten by new
     // drawings every frame, so only clear the OTHER buffers.
     glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
+    if (pimpl_->showProfiler)
+        profiler.beginFrame();
+
+    // Objects released during the frame are deleted a few swaps later,
+    // once the GPU is done with them
+    ResourceRegistry::global().endFrame();
+
     return true;
 }
 
@@ -301,4 +474,120 @@ LYS_API bool WindowGLES2::useVSync(bool enable) {
 
     return true;
 }
+
+
+LYS_API bool WindowGLES2::isProfilerShown() const {
+    return pimpl_->showProfiler;
+}
+
+
+LYS_API void WindowGLES2::showProfiler(bool show) {
+    if (show == pimpl_->showProfiler)
+        return;
+    pimpl_->showProfiler = show;
+
+    Profiler &profiler = Profiler::global();
+    profiler.enable(show);
+    if (show) {
+        profiler.beginFrame();
+    } else {
+        profiler.countGL(false);
+        if (pimpl_->overlay && SDL_GL_GetCurrentContext() == pimpl_->context) {
+            delete pimpl_->overlay;
+            pimpl_->overlay = nullptr;
+        }
+    }
+}
+
+
+LYS_API bool WindowGLES2::isGLCheckingEnabled() const {
+    return pimpl_->glChecking;
+}
+
+
+LYS_API void WindowGLES2::useGLChecking(bool enable) {
+#ifdef LYS_DEBUG
+    if (enable == pimpl_->glChecking)
+        return;
+    pimpl_->glChecking = enable;
+    if (pimpl_->context != nullptr && !enableGLChecks(enable ? 1 : 0))
+        pimpl_->glChecking = false;
+#else
+    (void)enable;
+#endif
+}
+
+
+LYS_API bool WindowGLES2::isDynamicResolutionEnabled() const {
+    return pimpl_->dynamicResolution;
+}
+
+
+LYS_API void WindowGLES2::useDynamicResolution(bool enable) {
+    if (enable == pimpl_->dynamicResolution)
+        return;
+    pimpl_->dynamicResolution = enable;
+    pimpl_->resolution.reset();
+    if (!enable && pimpl_->scene && SDL_GL_GetCurrentContext() == pimpl_->context) {
+        delete pimpl_->scene;
+        pimpl_->scene = nullptr;
+    }
+}
+
+
+LYS_API float WindowGLES2::resolutionScale() const {
+    return pimpl_->dynamicResolution ? pimpl_->resolution.scale() : 1.0f;
+}
+
+
+LYS_API const DynamicResolutionSettings& WindowGLES2::dynamicResolution() const {
+    return pimpl_->resolution.settings();
+}
+
+
+LYS_API void WindowGLES2::dynamicResolution(const DynamicResolutionSettings &settings) {
+    pimpl_->resolution.settings(settings);
+}
+
+
+LYS_API Dimension2Di32 WindowGLES2::sceneSize() const {
+    return pimpl_->sceneSize;
+}
+
+
+LYS_API bool WindowGLES2::beginScene() {
+    if (pimpl_->context == nullptr)
+        return false;
+
+    Dimension2Di32 native = sizeInPixels();
+    pimpl_->sceneSize = native;
+    if (!pimpl_->dynamicResolution) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, native.width(), native.height());
+        return true;
+    }
+
+    if (pimpl_->scene == nullptr)
+        pimpl_->scene = new SceneTarget();
+    pimpl_->scene->beginTiming();
+    pimpl_->sceneActive = pimpl_->scene->begin(native, pimpl_->resolution.scale(),
+                                               pimpl_->resolution.settings().maxScale);
+    pimpl_->sceneSize = pimpl_->scene->viewport();
+    pimpl_->sceneRendered = true;
+    return pimpl_->sceneActive;
+}
+
+
+LYS_API void WindowGLES2::endScene() {
+    if (pimpl_->sceneActive)
+        pimpl_->scene->end();
+    pimpl_->sceneActive = false;
+}
+
+
+LYS_API FrameCapture& WindowGLES2::frameCapture() {
+    if (pimpl_->frameCapture == nullptr)
+        pimpl_->frameCapture = new FrameCapture();
+    return *pimpl_->frameCapture;
+}
 }
@@ -0,0 +1,179 @@
+/***************************************************
+* Test - Skeletal animation and skinning           *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Animation.h"
+#include "Animator.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "types.h"
+
+static void axisAngle(float x, float y, float z, float angle, float q[4]) {
+    float s = sinf(angle * 0.5f);
+    q[0] = x * s;
+    q[1] = y * s;
+    q[2] = z * s;
+    q[3] = cosf(angle * 0.5f);
+}
+
+static float angleBetween(const float a[4], const float b[4]) {
+    float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    float flip = dot < 0.0f ? -1.0f : 1.0f, chord = 0.0f;
+    for (int c = 0; c < 4; ++c)
+        chord += (a[c] - b[c] * flip) * (a[c] - b[c] * flip);
+    return 4.0f * asinf(fminf(sqrtf(chord) * 0.5f, 1.0f));
+}
+
+// A three-joint arm: the shoulder swings, the elbow bends and slides, the
+// hand holds still
+static lys3d::RawAnimation makeArm(uint32_t frames) {
+    lys3d::RawAnimation raw;
+    raw.jointCount = 3;
+    raw.frames.resize(frames * 3);
+    for (uint32_t f = 0; f < frames; ++f) {
+        float t = f / raw.sampleRate;
+        lys3d::JointPose *pose = &raw.frames[f * 3];
+        axisAngle(0.0f, 0.0f, 1.0f, sinf(t * 2.0f), pose[0].rotation);
+        axisAngle(1.0f, 0.0f, 0.0f, 0.5f + 0.5f * sinf(t * 3.0f), pose[1].rotation);
+        pose[1].translation[1] = 1.0f + 0.1f * t;
+        pose[2].translation[1] = 1.0f;
+    }
+    return raw;
+}
+
+static lys3d::Skeleton makeSkeleton() {
+    lys3d::Skeleton skeleton;
+    lys3d::JointPose pose;
+    skeleton.add(-1, pose);
+    pose.translation[1] = 1.0f;
+    axisAngle(1.0f, 0.0f, 0.0f, 0.3f, pose.rotation);
+    skeleton.add(0, pose);
+    pose.scale = 2.0f;
+    skeleton.add(1, pose);
+    return skeleton;
+}
+
+int main(void) {
+    printf("- Animation: Quaternion packing\n");
+    for (int i = 0; i < 100; ++i) {
+        float q[4], unpacked[4];
+        float x = sinf(i * 1.3f), y = cosf(i * 0.7f), z = sinf(i * 2.9f);
+        float length = sqrtf(x * x + y * y + z * z);
+        axisAngle(x / length, y / length, z / length, i * 0.37f - 10.0f, q);
+        uint16_t packed[3];
+        lys3d::packQuaternion(q, packed);
+        lys3d::unpackQuaternion(packed, unpacked);
+        assert(angleBetween(q, unpacked) < 0.0002f);
+    }
+
+    printf("- Animation: Compression\n");
+    lys3d::RawAnimation raw = makeArm(91);
+    assert(raw.frameCount() == 91);
+    lys3d::AnimationClip clip;
+    assert(!clip.compress(lys3d::RawAnimation()));
+    assert(clip.compress(raw));
+    assert(clip.jointCount() == 3);
+    assert(fabsf(clip.duration() - 3.0f) < 1e-5f);
+    assert(clip.memoryUsage() < raw.frames.size() * sizeof(lys3d::JointPose) / 4);
+    // The hand is constant (3 tracks of 1 key) and the linear slide needs
+    // only its ends; the curves need more
+    assert(clip.keyCount() < 91 * 9 / 3);
+
+    printf("- Animation: Sampling within tolerance\n");
+    lys3d::AnimationTolerance tolerance;
+    lys3d::SkeletonPose pose;
+    for (uint32_t f = 0; f < 91; ++f) {
+        clip.sample(f / raw.sampleRate, false, &pose);
+        assert(pose.jointCount() == 3 && pose.paddedCount() == 4);
+        for (uint32_t j = 0; j < 3; ++j) {
+            lys3d::JointPose sampled = pose.joint(j);
+            const lys3d::JointPose &expected = raw.frames[f * 3 + j];
+            assert(angleBetween(sampled.rotation, expected.rotation) <= tolerance.rotation * 1.01f);
+            for (int c = 0; c < 3; ++c)
+                assert(fabsf(sampled.translation[c] - expected.translation[c]) <= tolerance.translation * 1.01f);
+            assert(fabsf(sampled.scale - expected.scale) <= tolerance.scale * 1.01f);
+        }
+    }
+    // Past the end: held without looping, wrapped with it
+    lys3d::SkeletonPose wrapped;
+    clip.sample(3.5f, false, &pose);
+    clip.sample(3.0f, false, &wrapped);
+    assert(angleBetween(pose.joint(0).rotation, wrapped.joint(0).rotation) < 1e-5f);
+    clip.sample(3.5f, true, &pose);
+    clip.sample(0.5f, false, &wrapped);
+    assert(angleBetween(pose.joint(0).rotation, wrapped.joint(0).rotation) < 1e-3f);
+
+    printf("- Animation: Blending\n");
+    lys3d::SkeletonPose a, b, blended;
+    clip.sample(0.0f, false, &a);
+    clip.sample(1.0f, false, &b);
+    lys3d::SkeletonPose::blend(a, b, 0.0f, &blended);
+    assert(angleBetween(blended.joint(0).rotation, a.joint(0).rotation) < 1e-5f);
+    lys3d::SkeletonPose::blend(a, b, 1.0f, &blended);
+    assert(angleBetween(blended.joint(0).rotation, b.joint(0).rotation) < 1e-5f);
+    assert(fabsf(blended.joint(1).translation[1] - b.joint(1).translation[1]) < 1e-5f);
+    lys3d::SkeletonPose::blend(a, b, 0.5f, &blended);
+    float half = angleBetween(blended.joint(0).rotation, a.joint(0).rotation);
+    assert(fabsf(half - angleBetween(blended.joint(0).rotation, b.joint(0).rotation)) < 1e-3f);
+
+    printf("- Animation: Skinning palette\n");
+    lys3d::Skeleton skeleton = makeSkeleton();
+    assert(skeleton.jointCount() == 3 && skeleton.parent(2) == 1);
+    float palette[36];
+    skeleton.palette(skeleton.bindPose(), palette);
+    for (int j = 0; j < 3; ++j) {
+        for (int i = 0; i < 12; ++i)
+            assert(fabsf(palette[j * 12 + i] - ((i % 5 == 0) ? 1.0f : 0.0f)) < 1e-5f);
+    }
+    // Turning the root a quarter turn around Z turns every joint with it
+    lys3d::SkeletonPose turned = skeleton.bindPose();
+    lys3d::JointPose root;
+    axisAngle(0.0f, 0.0f, 1.0f, 1.5707963f, root.rotation);
+    turned.joint(0, root);
+    skeleton.palette(turned, palette);
+    const float quarter[12] = {0, -1, 0, 0, 1, 0, 0, 0, 0, 0, 1, 0};
+    for (int j = 0; j < 3; ++j) {
+        for (int i = 0; i < 12; ++i)
+            assert(fabsf(palette[j * 12 + i] - quarter[i]) < 1e-4f);
+    }
+
+    printf("- Animator: Threaded update\n");
+    lys3d::AnimationClip walk;
+    raw = makeArm(60);
+    for (lys3d::JointPose &joint : raw.frames)
+        joint.translation[2] = 0.5f;
+    assert(walk.compress(raw));
+    lys3d::Animator serial(0), threaded(3);
+    for (lys3d::Animator *animator : {&serial, &threaded}) {
+        for (uint32_t i = 0; i < 100; ++i) {
+            assert(animator->add(&skeleton) == i);
+            lys3d::AnimationState &state = animator->state(i);
+            state.clip = i % 5 ? &clip : nullptr;
+            state.blendClip = i % 2 ? &walk : nullptr;
+            state.blendWeight = 0.3f;
+            state.time = i * 0.05f;
+            state.speed = 1.0f + i * 0.01f;
+        }
+        animator->update(0.25f);
+        assert(animator->stats().characters == 100);
+        assert(animator->stats().samples == 80 + 40);
+    }
+    for (uint32_t i = 0; i < 100; ++i) {
+        for (uint32_t k = 0; k < 36; ++k)
+            assert(serial.palette(i)[k] == threaded.palette(i)[k]);
+    }
+    assert(serial.palette(0)[0] == 1.0f);  // No clip: bind pose
+    assert(fabsf(serial.state(1).time - (0.05f + 0.25f * 1.01f)) < 1e-5f);
+    serial.clear();
+    assert(serial.count() == 0);
+    return 0;
+}
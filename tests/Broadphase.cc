@@ -0,0 +1,190 @@
+/***************************************************
+* Test - Broadphase collision pairs                *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Broadphase.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <utility>
+
+#include "types.h"
+
+typedef std::set<std::pair<uint32_t, uint32_t>> PairSet;
+
+static uint32_t seed = 1;
+
+static float uniform(float low, float high) {
+    seed = seed * 1664525u + 1013904223u;
+    return low + (high - low) * ((seed >> 8) / 16777216.0f);
+}
+
+static lys3d::Box3Df randomBox(float world, float largest) {
+    lys3d::Point3Df center(uniform(-world, world), uniform(-world, world), uniform(-world, world));
+    lys3d::Point3Df half(uniform(0.0f, largest), uniform(0.0f, largest), uniform(0.0f, largest));
+    return lys3d::Box3Df::fromCenter(center, half * 0.5f);
+}
+
+// Every overlapping pair of live proxies, the slow way
+static PairSet bruteForce(const lys3d::Broadphase &broadphase, const lys3d::Vector<uint32_t> &live) {
+    PairSet pairs;
+    for (size_t i = 0; i < live.size(); ++i) {
+        for (size_t j = i + 1; j < live.size(); ++j) {
+            if (broadphase.bounds(live[i]).intersects(broadphase.bounds(live[j])))
+                pairs.insert(std::make_pair(std::min(live[i], live[j]), std::max(live[i], live[j])));
+        }
+    }
+    return pairs;
+}
+
+static PairSet toSet(const lys3d::Vector<lys3d::BroadphasePair> &pairs) {
+    PairSet set;
+    for (const lys3d::BroadphasePair &pair : pairs) {
+        assert(pair.a < pair.b);
+        assert(set.insert(std::make_pair(pair.a, pair.b)).second);  // No duplicates
+    }
+    return set;
+}
+
+// Checks the pairs and the churn of an update against the last one
+static PairSet check(lys3d::Broadphase *broadphase, const lys3d::Vector<uint32_t> &live, const PairSet &last) {
+    broadphase->update();
+    PairSet pairs = toSet(broadphase->pairs());
+    assert(pairs == bruteForce(*broadphase, live));
+    for (size_t i = 1; i < broadphase->pairs().size(); ++i) {
+        const lys3d::BroadphasePair &a = broadphase->pairs()[i - 1], &b = broadphase->pairs()[i];
+        assert(a.a < b.a || (a.a == b.a && a.b < b.b));
+    }
+    PairSet added, removed;
+    std::set_difference(pairs.begin(), pairs.end(), last.begin(), last.end(), std::inserter(added, added.end()));
+    std::set_difference(last.begin(), last.end(), pairs.begin(), pairs.end(), std::inserter(removed, removed.end()));
+    assert(toSet(broadphase->added()) == added);
+    assert(toSet(broadphase->removed()) == removed);
+    assert(broadphase->stats().pairs == pairs.size());
+    return pairs;
+}
+
+int main(void) {
+    lys3d::BroadphaseSettings settings;
+    settings.workers = 0;
+
+    printf("- Broadphase: Proxies\n");
+    {
+        lys3d::BroadphaseSettings odd = settings;
+        odd.levels = 100;
+        lys3d::Broadphase broadphase(odd);
+        assert(broadphase.settings().levels == 8);
+        lys3d::Box3Df box(lys3d::Point3Df(0.0f, 0.0f, 0.0f), lys3d::Point3Df(1.0f, 1.0f, 1.0f));
+        uint32_t a = broadphase.add(box, lys3d::ProxyMotion::kStatic, 42);
+        uint32_t b = broadphase.add(box, lys3d::ProxyMotion::kDynamic, 7);
+        assert(a != b);
+        assert(broadphase.userData(a) == 42 && broadphase.userData(b) == 7);
+        assert(broadphase.motion(b) == lys3d::ProxyMotion::kDynamic);
+        assert(broadphase.bounds(a) == box);
+        broadphase.update();
+        assert(broadphase.pairs().size() == 1 && broadphase.added().size() == 1);
+        // Touching faces count as overlapping, like Box3D::intersects()
+        broadphase.move(b, lys3d::Box3Df(lys3d::Point3Df(1.0f, 0.0f, 0.0f), lys3d::Point3Df(2.0f, 1.0f, 1.0f)));
+        broadphase.update();
+        assert(broadphase.pairs().size() == 1 && broadphase.added().empty());
+        broadphase.remove(a);
+        broadphase.update();
+        assert(broadphase.pairs().empty() && broadphase.removed().size() == 1);
+        // The removed id is only handed out again after that update
+        assert(broadphase.add(box, lys3d::ProxyMotion::kStatic) == a);
+    }
+
+    printf("- Broadphase: Static scene\n");
+    lys3d::Broadphase broadphase(settings);
+    lys3d::Vector<uint32_t> live;
+    for (int i = 0; i < 600; ++i)
+        live.push_back(broadphase.add(randomBox(40.0f, 6.0f), lys3d::ProxyMotion::kStatic, i));
+    PairSet last = check(&broadphase, live, PairSet());
+    assert(!last.empty());
+    assert(broadphase.stats().staticChanged == 600);
+    broadphase.update();
+    assert(broadphase.stats().staticChanged == 0);
+    assert(broadphase.added().empty() && broadphase.removed().empty());
+    // A few moves are sorted back into place and only they are queried
+    for (int i = 0; i < 5; ++i)
+        broadphase.move(live[i * 7], randomBox(40.0f, 6.0f));
+    broadphase.move(live[1], broadphase.bounds(live[1]));  // Unchanged: free
+    last = check(&broadphase, live, last);
+    assert(broadphase.stats().staticChanged == 5);
+
+    printf("- Broadphase: Dynamic proxies\n");
+    // Bullets, debris and a few large ships, across several hash levels
+    for (int i = 0; i < 700; ++i) {
+        float largest = i % 50 == 0 ? 20.0f : (i % 5 == 0 ? 3.0f : 0.5f);
+        live.push_back(broadphase.add(randomBox(40.0f, largest), lys3d::ProxyMotion::kDynamic, i));
+    }
+    last = check(&broadphase, live, last);
+    assert(broadphase.stats().dynamicProxies == 700);
+    assert(broadphase.stats().hashEntries >= 700);
+    for (int frame = 0; frame < 4; ++frame) {
+        for (uint32_t proxy : live) {
+            if (broadphase.motion(proxy) != lys3d::ProxyMotion::kDynamic)
+                continue;
+            lys3d::Box3Df box = broadphase.bounds(proxy);
+            lys3d::Point3Df step(uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f));
+            broadphase.move(proxy, lys3d::Box3Df(box.min() + step, box.max() + step));
+        }
+        last = check(&broadphase, live, last);
+    }
+
+    printf("- Broadphase: Adding and removing\n");
+    for (int i = 0; i < 100; ++i) {
+        size_t index = static_cast<size_t>(uniform(0.0f, live.size() - 1.0f));
+        broadphase.remove(live[index]);
+        live.erase(live.begin() + index);
+    }
+    for (int i = 0; i < 50; ++i) {
+        lys3d::ProxyMotion motion = i % 2 ? lys3d::ProxyMotion::kStatic : lys3d::ProxyMotion::kDynamic;
+        live.push_back(broadphase.add(randomBox(40.0f, 4.0f), motion));
+    }
+    last = check(&broadphase, live, last);
+
+    printf("- Broadphase: Wide static proxies\n");
+    // Larger than the coarsest cells, so kept out of the sweep-and-prune
+    // list; moving one in and another out of it
+    lys3d::Point3Df wide_half(35.0f, 20.0f, 20.0f);
+    for (int i = 0; i < 3; ++i) {
+        lys3d::Point3Df center(uniform(-40.0f, 40.0f), uniform(-40.0f, 40.0f), uniform(-40.0f, 40.0f));
+        live.push_back(broadphase.add(lys3d::Box3Df::fromCenter(center, wide_half), lys3d::ProxyMotion::kStatic));
+    }
+    last = check(&broadphase, live, last);
+    broadphase.move(live[live.size() - 1], randomBox(40.0f, 6.0f));
+    for (uint32_t proxy : live) {
+        if (broadphase.motion(proxy) == lys3d::ProxyMotion::kStatic) {
+            broadphase.move(proxy, lys3d::Box3Df::fromCenter(broadphase.bounds(proxy).center(), wide_half));
+            break;
+        }
+    }
+    last = check(&broadphase, live, last);
+    broadphase.remove(live[live.size() - 2]);
+    live.erase(live.end() - 2);
+    last = check(&broadphase, live, last);
+
+    printf("- Broadphase: Worker threads\n");
+    lys3d::BroadphaseSettings threaded = settings;
+    threaded.workers = 3;
+    lys3d::Broadphase parallel(threaded);
+    seed = 5;
+    lys3d::Vector<uint32_t> parallel_live;
+    for (int i = 0; i < 2000; ++i) {
+        lys3d::ProxyMotion motion = i % 4 ? lys3d::ProxyMotion::kDynamic : lys3d::ProxyMotion::kStatic;
+        parallel_live.push_back(parallel.add(randomBox(50.0f, 2.0f), motion));
+    }
+    check(&parallel, parallel_live, PairSet());
+    return 0;
+}
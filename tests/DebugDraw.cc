@@ -0,0 +1,163 @@
+/***************************************************
+* Test - Immediate-mode debug shapes               *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "DebugDraw.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+#include "types.h"
+
+using lys3d::DebugDepth;
+using lys3d::Point3Df;
+
+static bool approx(float a, float b) {
+    return fabsf(a - b) < 1.0e-4f;
+}
+
+static void testShapes() {
+    lys3d::DebugDraw draw;
+    lys3d::Box3Df box(Point3Df(-1.0f, 0.0f, 2.0f), Point3Df(1.0f, 3.0f, 4.0f));
+    draw.line(Point3Df(0.0f, 0.0f, 0.0f), Point3Df(1.0f, 2.0f, 3.0f), 0x11223344);
+    draw.box(box, 0xFF0000FF);
+    draw.solidBox(box, 0x00FF0080, DebugDepth::kOverlay);
+    draw.sphere(Point3Df(5.0f, 0.0f, 0.0f), 2.0f, 0xFFFFFFFF, DebugDepth::kOverlay);
+    draw.triangle(Point3Df(), Point3Df(1.0f, 0.0f, 0.0f), Point3Df(0.0f, 1.0f, 0.0f), 0x0000FFFF);
+    assert(draw.stats().lineVertices == 0);
+
+    draw.collect();
+    const lys3d::Vector<lys3d::DebugVertex> &lines = draw.vertices(lys3d::kDebugLines);
+    assert(lines.size() == 2 + 24);
+    assert(lines[1].x == 1.0f && lines[1].y == 2.0f && lines[1].z == 3.0f);
+    assert(lines[0].color[0] == 0x11 && lines[0].color[1] == 0x22 && lines[0].color[2] == 0x33
+           && lines[0].color[3] == 0x44);
+    // Box edges run along one axis each, between the corners
+    for (size_t i = 2; i < lines.size(); i += 2) {
+        int differing = (lines[i].x != lines[i + 1].x) + (lines[i].y != lines[i + 1].y)
+                      + (lines[i].z != lines[i + 1].z);
+        assert(differing == 1);
+        assert(lines[i].x == -1.0f || lines[i].x == 1.0f);
+    }
+    assert(draw.vertices(lys3d::kDebugTriangles).size() == 3);
+    assert(draw.vertices(lys3d::kDebugTrianglesOverlay).size() == 36);
+    assert(draw.vertices(lys3d::kDebugTrianglesOverlay)[0].color[3] == 0x80);
+
+    // Three circles, every point on the sphere
+    const lys3d::Vector<lys3d::DebugVertex> &circles = draw.vertices(lys3d::kDebugLinesOverlay);
+    assert(circles.size() == 3 * 32 * 2);
+    for (const lys3d::DebugVertex &v : circles)
+        assert(fabsf(sqrtf((v.x - 5.0f) * (v.x - 5.0f) + v.y * v.y + v.z * v.z) - 2.0f) < 1.0e-4f);
+    assert(draw.stats().lineVertices == 26 + 192 && draw.stats().triangleVertices == 39);
+    assert(draw.stats().threads == 1);
+
+    // Collected shapes are gone from the next frame
+    draw.collect();
+    for (uint32_t i = 0; i < lys3d::kDebugBatchCount; ++i)
+        assert(draw.vertices(static_cast<lys3d::DebugBatch>(i)).empty());
+}
+
+static void testFrustumAndAxes() {
+    lys3d::DebugDraw draw;
+    // Clip space is the box from -1 to 1
+    const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    draw.frustum(identity, 0xFFFFFFFF);
+
+    // A 90 degree perspective camera at the origin looking down -z, near 1,
+    // far 10: the far plane is 20 x 20
+    const float n = 1.0f, f = 10.0f;
+    const float perspective[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, (f + n) / (n - f), -1, 0, 0, 2 * f * n / (n - f), 0};
+    draw.frustum(perspective, 0xFFFFFFFF);
+    const float singular[16] = {0};
+    draw.frustum(singular, 0xFFFFFFFF);
+
+    const float transform[16] = {0, 1, 0, 0, -1, 0, 0, 0, 0, 0, 1, 0, 4, 5, 6, 1};
+    draw.axes(transform, 2.0f);
+    draw.collect();
+
+    const lys3d::Vector<lys3d::DebugVertex> &lines = draw.vertices(lys3d::kDebugLines);
+    assert(lines.size() == 24 + 24 + 6);
+    for (size_t i = 0; i < 24; ++i)
+        assert(fabsf(lines[i].x) == 1.0f && fabsf(lines[i].y) == 1.0f && fabsf(lines[i].z) == 1.0f);
+    for (size_t i = 24; i < 48; ++i) {
+        const lys3d::DebugVertex &v = lines[i];
+        assert(approx(v.z, -1.0f) || approx(v.z, -10.0f));
+        assert(approx(fabsf(v.x), -v.z) && approx(fabsf(v.y), -v.z));
+    }
+
+    // x maps to +y, y to -x
+    const lys3d::DebugVertex *axes = &lines[48];
+    assert(axes[0].x == 4.0f && axes[0].y == 5.0f && axes[0].z == 6.0f);
+    assert(axes[1].x == 4.0f && axes[1].y == 7.0f && axes[1].z == 6.0f && axes[1].color[0] == 0xFF);
+    assert(axes[3].x == 2.0f && axes[3].y == 5.0f && axes[3].color[1] == 0xFF);
+    assert(axes[5].z == 8.0f && axes[5].color[2] == 0xFF);
+}
+
+// Threads draw while frames are collected; every line turns up once
+static void testThreads() {
+    lys3d::DebugDraw draw;
+    const int kThreads = 4, kLines = 20000;
+    std::atomic<int> finished(0);
+    std::thread threads[kThreads];
+    for (int t = 0; t < kThreads; ++t) {
+        threads[t] = std::thread([&draw, &finished, t] {
+            for (int i = 0; i < kLines; ++i) {
+                float x = static_cast<float>(t);
+                draw.line(Point3Df(x, 0.0f, 0.0f), Point3Df(x, static_cast<float>(i), 0.0f), 0xFFFFFFFF,
+                          i % 2 ? DebugDepth::kTested : DebugDepth::kOverlay);
+            }
+            finished.fetch_add(1);
+        });
+    }
+    uint64_t counts[kThreads] = {0};
+    uint64_t total = 0;
+    bool done = false;
+    while (!done) {
+        done = finished.load() == kThreads;
+        draw.collect();
+        for (lys3d::DebugBatch batch : {lys3d::kDebugLines, lys3d::kDebugLinesOverlay}) {
+            const lys3d::Vector<lys3d::DebugVertex> &lines = draw.vertices(batch);
+            assert(lines.size() % 2 == 0);
+            for (size_t i = 0; i < lines.size(); i += 2) {
+                assert(lines[i].x == lines[i + 1].x);
+                ++counts[static_cast<int>(lines[i].x)];
+            }
+            total += lines.size() / 2;
+        }
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    for (uint64_t count : counts)
+        assert(count == kLines);
+    assert(total == kThreads * kLines);
+    assert(draw.stats().threads == kThreads);
+}
+
+static void testMacro() {
+    lys3d::DebugDraw::global().collect();
+    LYS_DEBUG_DRAW(line(Point3Df(), Point3Df(1.0f, 1.0f, 1.0f), 0xFFFFFFFF));
+    lys3d::DebugDraw::global().collect();
+#ifdef LYS_NDEBUG
+    assert(lys3d::DebugDraw::global().stats().lineVertices == 0);
+#else
+    assert(lys3d::DebugDraw::global().stats().lineVertices == 2);
+#endif
+}
+
+int main(void) {
+    testShapes();
+    testFrustumAndAxes();
+    testThreads();
+    testMacro();
+    puts("DebugDraw tests passed");
+    return 0;
+}
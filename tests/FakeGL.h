@@ -0,0 +1,103 @@
+/***************************************************
+* FakeGL.h: GL entry points for tests, no context  *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#ifndef LYS3D_TESTS_FAKEGL_H_
+#define LYS3D_TESTS_FAKEGL_H_
+
+#include <string.h>
+#include <atomic>
+
+#include "GLES2/gl2.h"
+#include "types.h"
+
+// A handful of GL entry points that do nothing but count calls and hand
+// out queued errors. Tests that need them compile their own copy of gl2.c
+// (its symbols are hidden in the library), then pass fakegl::loader to
+// setGLProcLoader() and call resetGLPointers(). Entry points not faked
+// resolve to null, as missing ones would with a real driver.
+namespace fakegl {
+// Calls made to any fake entry point, and how many of them were queries
+static std::atomic<uint32_t> calls(0);
+static std::atomic<uint32_t> queries(0);
+// Errors glGetError() returns, oldest first
+static lys3d::Vector<GLenum> errors;
+
+static GLenum GL_APIENTRY getError() {
+    if (errors.empty())
+        return GL_NO_ERROR;
+    GLenum error = errors.front();
+    errors.erase(errors.begin());
+    return error;
+}
+
+static void GL_APIENTRY bindBuffer(GLenum, GLuint) { ++calls; }
+static void GL_APIENTRY bindTexture(GLenum, GLuint) { ++calls; }
+static void GL_APIENTRY activeTexture(GLenum) { ++calls; }
+static void GL_APIENTRY useProgram(GLuint) { ++calls; }
+static void GL_APIENTRY enable(GLenum) { ++calls; }
+static void GL_APIENTRY disable(GLenum) { ++calls; }
+static void GL_APIENTRY deleteBuffers(GLsizei, const GLuint*) { ++calls; }
+static void GL_APIENTRY deleteTextures(GLsizei, const GLuint*) { ++calls; }
+static void GL_APIENTRY blendFunc(GLenum, GLenum) { ++calls; }
+static void GL_APIENTRY blendFuncSeparate(GLenum, GLenum, GLenum, GLenum) { ++calls; }
+static void GL_APIENTRY depthMask(GLboolean) { ++calls; }
+static void GL_APIENTRY viewport(GLint, GLint, GLsizei, GLsizei) { ++calls; }
+
+// Queries see a context fresh from creation, with a zero viewport
+static void GL_APIENTRY getIntegerv(GLenum name, GLint *data) {
+    ++calls;
+    ++queries;
+    if (name == GL_VIEWPORT)
+        data[1] = data[2] = data[3] = 0;
+    *data = name == GL_ACTIVE_TEXTURE ? GL_TEXTURE0 : 0;
+}
+
+static void GL_APIENTRY getBooleanv(GLenum, GLboolean *data) {
+    ++calls;
+    ++queries;
+    *data = GL_TRUE;
+}
+
+static GLboolean GL_APIENTRY isEnabled(GLenum) {
+    ++calls;
+    ++queries;
+    return GL_FALSE;
+}
+
+static GLProc loader(const char *name) {
+    static const struct {
+        const char *name;
+        GLProc proc;
+    } procs[] = {
+        {"glGetError", reinterpret_cast<GLProc>(getError)},
+        {"glBindBuffer", reinterpret_cast<GLProc>(bindBuffer)},
+        {"glBindTexture", reinterpret_cast<GLProc>(bindTexture)},
+        {"glActiveTexture", reinterpret_cast<GLProc>(activeTexture)},
+        {"glUseProgram", reinterpret_cast<GLProc>(useProgram)},
+        {"glEnable", reinterpret_cast<GLProc>(enable)},
+        {"glDisable", reinterpret_cast<GLProc>(disable)},
+        {"glDeleteBuffers", reinterpret_cast<GLProc>(deleteBuffers)},
+        {"glDeleteTextures", reinterpret_cast<GLProc>(deleteTextures)},
+        {"glBlendFunc", reinterpret_cast<GLProc>(blendFunc)},
+        {"glBlendFuncSeparate", reinterpret_cast<GLProc>(blendFuncSeparate)},
+        {"glDepthMask", reinterpret_cast<GLProc>(depthMask)},
+        {"glViewport", reinterpret_cast<GLProc>(viewport)},
+        {"glGetIntegerv", reinterpret_cast<GLProc>(getIntegerv)},
+        {"glGetBooleanv", reinterpret_cast<GLProc>(getBooleanv)},
+        {"glIsEnabled", reinterpret_cast<GLProc>(isEnabled)},
+    };
+    for (const auto &proc : procs) {
+        if (strcmp(proc.name, name) == 0)
+            return proc.proc;
+    }
+    return nullptr;
+}
+}
+#endif // LYS3D_TESTS_FAKEGL_H_
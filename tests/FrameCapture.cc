@@ -0,0 +1,137 @@
+/***************************************************
+* Test - Screenshots & video recording             *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "FrameCapture.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+
+using lys3d::Dimension2Di32;
+using lys3d::FrameCapture;
+using lys3d::Vector;
+
+static const char *kVideo = "FrameCapture-test.y4m";
+static const char *kImage = "FrameCapture-test.png";
+
+static Vector<uint8_t> readFile(const char *path) {
+    Vector<uint8_t> data;
+    FILE *file = fopen(path, "rb");
+    assert(file != nullptr);
+    int c;
+    while ((c = fgetc(file)) != EOF)
+        data.push_back(static_cast<uint8_t>(c));
+    fclose(file);
+    return data;
+}
+
+// RGBA rows, bottom first, as glReadPixels() returns them
+static Vector<uint8_t> frame(const Dimension2Di32 &size, const uint8_t bottom[3], const uint8_t top[3]) {
+    Vector<uint8_t> pixels;
+    for (int32_t y = 0; y < size.height(); ++y) {
+        const uint8_t *color = y < size.height() / 2 ? bottom : top;
+        for (int32_t x = 0; x < size.width(); ++x) {
+            pixels.insert(pixels.end(), color, color + 3);
+            pixels.push_back(255);
+        }
+    }
+    return pixels;
+}
+
+static void testRecording() {
+    const uint8_t white[3] = {255, 255, 255}, black[3] = {0, 0, 0}, red[3] = {255, 0, 0};
+    const Dimension2Di32 size(4, 2);
+    FrameCapture capture;
+    assert(!capture.isCapturing());
+    assert(!capture.submit(frame(size, white, white).data(), size));
+    assert(!capture.stopRecording());
+
+    assert(capture.startRecording(kVideo, 30));
+    assert(capture.isRecording() && capture.isCapturing());
+    assert(!capture.startRecording(kVideo, 30));
+    assert(capture.submit(frame(size, white, white).data(), size));
+    assert(capture.submit(frame(size, black, black).data(), size));
+    assert(capture.submit(frame(size, black, red).data(), size));
+    // The video keeps the size of its first frame
+    assert(!capture.submit(frame(Dimension2Di32(2, 2), white, white).data(), Dimension2Di32(2, 2)));
+    assert(capture.stopRecording());
+    assert(!capture.isRecording() && !capture.isCapturing());
+    capture.finish();
+
+    lys3d::FrameCaptureStats stats = capture.stats();
+    assert(stats.captured == 3 && stats.encoded == 3 && stats.dropped == 1 && stats.failed == 0);
+    assert(stats.heldBytes <= capture.memoryLimit());
+
+    // A 4x2 frame is 8 luma samples and 2 of each chroma
+    const char *header = "YUV4MPEG2 W4 H2 F30:1 Ip A1:1 C420jpeg\n";
+    const size_t header_size = strlen(header), frame_size = 6 + 8 + 2 + 2;
+    Vector<uint8_t> data = readFile(kVideo);
+    assert(data.size() == header_size + 3 * frame_size);
+    assert(memcmp(data.data(), header, header_size) == 0);
+    const uint8_t *planes[3];
+    for (int i = 0; i < 3; ++i) {
+        assert(memcmp(&data[header_size + i * frame_size], "FRAME\n", 6) == 0);
+        planes[i] = &data[header_size + i * frame_size + 6];
+    }
+    for (int i = 0; i < 8; ++i) {
+        assert(planes[0][i] == 255 && planes[1][i] == 0);
+        // Top row first, unlike the pixels
+        assert(planes[2][i] == (i < 4 ? 77 : 0));
+    }
+    for (int i = 8; i < 12; ++i)
+        assert(planes[0][i] == 128 && planes[1][i] == 128);
+    assert(planes[2][8] == 107 && planes[2][9] == 107 && planes[2][10] == 192 && planes[2][11] == 192);
+    remove(kVideo);
+}
+
+static void testScreenshot() {
+    const uint8_t gray[3] = {128, 128, 128};
+    const Dimension2Di32 size(3, 3);
+    FrameCapture capture;
+    assert(!capture.screenshot(""));
+    assert(capture.screenshot(kImage));
+    assert(!capture.screenshot(kImage));
+    assert(capture.isCapturing() && !capture.isRecording());
+    assert(capture.submit(frame(size, gray, gray).data(), size));
+    assert(!capture.isCapturing());
+    assert(!capture.submit(frame(size, gray, gray).data(), size));
+    capture.finish();
+    assert(capture.stats().encoded == 1);
+
+    Vector<uint8_t> data = readFile(kImage);
+    assert(data.size() > 8 && memcmp(data.data(), "\x89PNG\r\n\x1a\n", 8) == 0);
+    remove(kImage);
+}
+
+static void testMemoryLimit() {
+    const uint8_t white[3] = {255, 255, 255};
+    const Dimension2Di32 size(4, 2);
+    FrameCapture capture(16);
+    assert(capture.memoryLimit() == 16);
+    assert(capture.startRecording(kVideo));
+    assert(!capture.submit(frame(size, white, white).data(), size));
+    capture.memoryLimit(32);
+    assert(capture.submit(frame(size, white, white).data(), size));
+    assert(capture.stopRecording());
+    capture.finish();
+    lys3d::FrameCaptureStats stats = capture.stats();
+    assert(stats.dropped == 1 && stats.encoded == 1 && stats.heldBytes <= 32);
+    remove(kVideo);
+}
+
+int main(void) {
+    testRecording();
+    testScreenshot();
+    testMemoryLimit();
+    puts("FrameCapture tests passed");
+    return 0;
+}
@@ -0,0 +1,162 @@
+/***************************************************
+* Test - Frame graph culling and target aliasing   *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "FrameGraph.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "types.h"
+
+static lys3d::FrameTargetDesc target(lys3d::FrameTargetFormat format, float scale) {
+    lys3d::FrameTargetDesc desc;
+    desc.format = format;
+    desc.scale = scale;
+    return desc;
+}
+
+int main(void) {
+    // compile() works without a GL context; only execute() needs one.
+    using lys3d::FrameTargetFormat;
+    lys3d::FrameGraph graph;
+    graph.reset(lys3d::Dimension2Di32(1280, 720));
+
+    printf("- FrameGraph: Culling and lifetimes\n");
+    lys3d::FrameTargetDesc shadow_desc = target(FrameTargetFormat::kDepthTexture, 1.0f);
+    shadow_desc.size = lys3d::Dimension2Di32(1024, 1024);
+    lys3d::FrameResource shadow = graph.create(shadow_desc);
+    lys3d::FrameResource color = graph.create(target(FrameTargetFormat::kRGBA8, 1.0f));
+    lys3d::FrameResource depth = graph.create(target(FrameTargetFormat::kDepth16, 1.0f));
+    lys3d::FrameResource debug = graph.create(target(FrameTargetFormat::kRGBA8, 1.0f));
+    lys3d::FrameResource bright = graph.create(target(FrameTargetFormat::kRGBA8, 0.5f));
+    lys3d::FrameResource blur_x = graph.create(target(FrameTargetFormat::kRGBA8, 0.5f));
+    lys3d::FrameResource blur_y = graph.create(target(FrameTargetFormat::kRGBA8, 0.5f));
+    assert(graph.size(bright).width() == 640 && graph.size(bright).height() == 360);
+    assert(graph.size(shadow).width() == 1024);
+
+    uint32_t shadows = graph.addPass("Shadows", nullptr);
+    graph.write(shadows, shadow);
+    uint32_t scene = graph.addPass("Scene", nullptr);
+    graph.read(scene, shadow);
+    graph.write(scene, color);
+    graph.write(scene, depth);
+    uint32_t debug_pass = graph.addPass("Debug view", nullptr);
+    graph.read(debug_pass, color);
+    graph.write(debug_pass, debug);
+    uint32_t transparent = graph.addPass("Transparent", nullptr);
+    graph.write(transparent, color);
+    graph.write(transparent, depth);
+    uint32_t threshold = graph.addPass("Bloom threshold", nullptr);
+    graph.read(threshold, color);
+    graph.write(threshold, bright);
+    uint32_t horizontal = graph.addPass("Bloom blur X", nullptr);
+    graph.read(horizontal, bright);
+    graph.write(horizontal, blur_x);
+    uint32_t vertical = graph.addPass("Bloom blur Y", nullptr);
+    graph.read(vertical, blur_x);
+    graph.write(vertical, blur_y);
+    uint32_t composite = graph.addPass("Composite", nullptr);
+    graph.read(composite, color);
+    graph.read(composite, blur_y);
+    graph.write(composite, graph.backbuffer());
+
+    bool ok = graph.compile();
+    assert(ok);
+    (void)ok;
+    assert(graph.isCulled(debug_pass));
+    assert(!graph.isCulled(shadows) && !graph.isCulled(scene) && !graph.isCulled(transparent));
+    assert(!graph.isCulled(threshold) && !graph.isCulled(horizontal) && !graph.isCulled(vertical));
+    assert(!graph.isCulled(composite));
+    assert(graph.stats().culledPasses == 1);
+
+    printf("- FrameGraph: Clears and discards\n");
+    assert(graph.clearMask(shadows) == lys3d::kFrameDepth);
+    assert(graph.clearMask(scene) == (lys3d::kFrameColor | lys3d::kFrameDepth));
+    assert(graph.clearMask(transparent) == 0);  // Keeps what Scene drew
+    assert(graph.clearMask(composite) == 0);    // WindowGLES2::update() clears it
+    assert(graph.discardMask(shadows) == 0);    // Read by Scene
+    assert(graph.discardMask(scene) == 0);      // Transparent still uses both
+    assert(graph.discardMask(transparent) == lys3d::kFrameDepth);
+    assert(graph.discardMask(threshold) == 0);
+    assert(graph.discardMask(composite) == lys3d::kFrameDepth);
+    graph.clearsBackbuffer(true);
+    ok = graph.compile();
+    assert(ok);
+    assert(graph.clearMask(composite) == (lys3d::kFrameColor | lys3d::kFrameDepth));
+    graph.clearsBackbuffer(false);
+
+    printf("- FrameGraph: Aliasing\n");
+    ok = graph.compile();
+    assert(ok);
+    // The threshold target is dead once blur X has read it, so blur Y reuses it
+    assert(graph.slot(bright) == graph.slot(blur_y));
+    assert(graph.slot(bright) != graph.slot(blur_x));
+    assert(graph.slot(color) != graph.slot(debug));
+    assert(graph.stats().resources == 6);
+    assert(graph.stats().targets == 5);
+    uint64_t full = 1280 * 720, half = 640 * 360;
+    assert(graph.stats().targetBytes == 1024 * 1024 * 4 + full * 4 + full * 2 + half * 4 * 2);
+
+    printf("- FrameGraph: Pool reuse across frames\n");
+    for (int frame = 0; frame < 5; ++frame) {
+        graph.reset(lys3d::Dimension2Di32(1280, 720));
+        lys3d::FrameResource a = graph.create(target(FrameTargetFormat::kRGBA8, 0.5f));
+        lys3d::FrameResource b = graph.create(target(FrameTargetFormat::kRGBA8, 0.5f));
+        uint32_t first = graph.addPass("First", nullptr);
+        graph.write(first, a);
+        uint32_t second = graph.addPass("Second", nullptr);
+        graph.read(second, a);
+        graph.write(second, b);
+        uint32_t last = graph.addPass("Last", nullptr);
+        graph.read(last, b);
+        graph.write(last, graph.backbuffer());
+        ok = graph.compile();
+        assert(ok);
+    }
+    // Everything but the two half-size targets went unused and was released
+    assert(graph.stats().targets == 2);
+
+    printf("- FrameGraph: Culled chains and kept passes\n");
+    graph.reset(lys3d::Dimension2Di32(1280, 720));
+    lys3d::FrameResource a = graph.create(target(FrameTargetFormat::kRGBA8, 1.0f));
+    lys3d::FrameResource b = graph.create(target(FrameTargetFormat::kRGBA8, 1.0f));
+    uint32_t first = graph.addPass("First", nullptr);
+    graph.write(first, a);
+    uint32_t second = graph.addPass("Second", nullptr);
+    graph.read(second, a);
+    graph.write(second, b);
+    ok = graph.compile();
+    assert(ok);
+    assert(graph.isCulled(first) && graph.isCulled(second));
+    graph.keep(second);
+    ok = graph.compile();
+    assert(ok);
+    assert(!graph.isCulled(first) && !graph.isCulled(second));
+    assert(graph.discardMask(second) == lys3d::kFrameColor);
+
+    printf("- FrameGraph: Invalid graphs\n");
+    graph.reset(lys3d::Dimension2Di32(1280, 720));
+    a = graph.create(target(FrameTargetFormat::kRGBA8, 1.0f));
+    first = graph.addPass("Feedback", nullptr);
+    graph.read(first, a);
+    graph.write(first, a);
+    assert(!graph.compile());
+    graph.reset(lys3d::Dimension2Di32(1280, 720));
+    first = graph.addPass("Read backbuffer", nullptr);
+    graph.read(first, graph.backbuffer());
+    assert(!graph.compile());
+    graph.reset(lys3d::Dimension2Di32(1280, 720));
+    a = graph.create(target(FrameTargetFormat::kRGBA8, 1.0f));
+    first = graph.addPass("Two outputs", nullptr);
+    graph.write(first, a);
+    graph.write(first, graph.backbuffer());
+    assert(!graph.compile());
+    return 0;
+}
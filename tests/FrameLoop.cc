@@ -0,0 +1,193 @@
+/***************************************************
+* Test - Fixed-timestep main loop driver           *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "FrameLoop.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+#include "Profiler.h"
+
+static const double kStep = 1.0 / 60.0;
+
+// A ball falling at 1 unit per step, drawn from a copy when threaded
+struct Game {
+    int steps = 0;
+    float height = 0.0f;
+    float drawnHeight = 0.0f;
+    float lastAlpha = -1.0f;
+    int renders = 0;
+    int framesLeft = 1000;
+    bool quit = false;
+};
+
+static bool input(void *user_data) {
+    return !static_cast<Game*>(user_data)->quit;
+}
+
+static void step(double seconds, void *user_data) {
+    assert(seconds == kStep);
+    Game &game = *static_cast<Game*>(user_data);
+    ++game.steps;
+    game.height -= 1.0f;
+}
+
+static void sync(void *user_data) {
+    Game &game = *static_cast<Game*>(user_data);
+    game.drawnHeight = game.height;
+}
+
+static void render(float alpha, void *user_data) {
+    Game &game = *static_cast<Game*>(user_data);
+    game.lastAlpha = alpha;
+    ++game.renders;
+}
+
+static bool present(void *user_data) {
+    return --static_cast<Game*>(user_data)->framesLeft > 0;
+}
+
+static lys3d::FrameLoopCallbacks callbacks(Game *game) {
+    lys3d::FrameLoopCallbacks result;
+    result.input = input;
+    result.step = step;
+    result.sync = sync;
+    result.render = render;
+    result.present = present;
+    result.userData = game;
+    return result;
+}
+
+static bool near(float a, float b) {
+    return fabsf(a - b) < 1e-4f;
+}
+
+int main(void) {
+    printf("- FrameLoop: Accumulating time\n");
+    {
+        Game game;
+        lys3d::FrameLoop loop;
+        assert(loop.frame(callbacks(&game), kStep / 2));
+        assert(game.steps == 0 && game.renders == 1 && near(game.lastAlpha, 0.5f));
+        assert(loop.frame(callbacks(&game), kStep / 2));
+        assert(game.steps == 1 && near(game.lastAlpha, 0.0f));
+        // 144 Hz: one step on most frames, none on some
+        int frames_without = 0;
+        for (int i = 0; i < 144; ++i) {
+            loop.frame(callbacks(&game), 1.0 / 144.0);
+            frames_without += loop.stats().steps == 0;
+            assert(loop.stats().steps <= 1 && loop.stats().alpha >= 0.0f && loop.stats().alpha < 1.0f);
+        }
+        assert(loop.stepCount() == 61 && game.steps == 61 && frames_without == 84);
+        // 30 Hz: two steps every frame
+        loop.frame(callbacks(&game), 2.0 * kStep);
+        assert(loop.stats().steps == 2 && loop.stats().droppedSteps == 0);
+        assert(game.drawnHeight == game.height);
+
+        game.quit = true;
+        assert(!loop.frame(callbacks(&game), kStep));
+        assert(game.renders == 147 && game.steps == 63);
+    }
+
+    printf("- FrameLoop: Catch-up limit\n");
+    {
+        Game game;
+        lys3d::FrameLoopSettings settings;
+        settings.maxSteps = 3;
+        lys3d::FrameLoop loop(settings);
+        // A one-second hitch runs 3 steps and drops the other 57, instead
+        // of owing them to later frames
+        loop.frame(callbacks(&game), 1.0 + kStep / 4);
+        assert(loop.stats().steps == 3 && loop.stats().droppedSteps == 57);
+        assert(near(loop.stats().alpha, 0.25f));
+        loop.frame(callbacks(&game), kStep);
+        assert(loop.stats().steps == 1 && loop.stats().droppedSteps == 0 && game.steps == 4);
+
+        loop.reset();
+        loop.frame(callbacks(&game), kStep / 2);
+        assert(loop.stats().steps == 0 && near(loop.stats().alpha, 0.5f));
+    }
+
+    printf("- FrameLoop: Interpolated transforms\n");
+    {
+        const float unrotated[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        // A quarter turn around y, given with its sign flipped
+        const float turned[4] = {0.0f, -sqrtf(0.5f), 0.0f, -sqrtf(0.5f)};
+        lys3d::InterpolatedTransform transform;
+        transform.reset(lys3d::Point3Df(1.0f, 2.0f, 3.0f), unrotated);
+        assert(transform.position(0.7f) == lys3d::Point3Df(1.0f, 2.0f, 3.0f));
+        transform.update(lys3d::Point3Df(3.0f, 2.0f, 3.0f), turned);
+        assert(near(transform.position(0.5f).x(), 2.0f));
+
+        float matrix[16];
+        transform.matrix(0.0f, matrix);
+        assert(near(matrix[0], 1.0f) && near(matrix[12], 1.0f) && matrix[15] == 1.0f);
+        transform.matrix(1.0f, matrix);
+        // x turns to -z
+        assert(near(matrix[0], 0.0f) && near(matrix[2], -1.0f) && near(matrix[12], 3.0f));
+        // Halfway is an eighth of a turn, the short way round
+        transform.matrix(0.5f, matrix);
+        assert(near(matrix[0], sqrtf(0.5f)) && near(matrix[2], -sqrtf(0.5f)) && near(matrix[5], 1.0f));
+        assert(near(matrix[13], 2.0f) && matrix[3] == 0.0f);
+    }
+
+    printf("- FrameLoop: Threaded simulation\n");
+    {
+        Game game;
+        lys3d::FrameLoopSettings settings;
+        settings.threaded = true;
+        lys3d::FrameLoop loop(settings);
+        // Each frame renders the state the previous frame's steps made
+        loop.frame(callbacks(&game), kStep * 1.5);
+        assert(loop.stats().steps == 1 && game.drawnHeight == 0.0f && game.lastAlpha == 0.0f);
+        loop.frame(callbacks(&game), kStep);
+        assert(game.drawnHeight == -1.0f && near(game.lastAlpha, 0.5f));
+        loop.frame(callbacks(&game), kStep * 1.5);
+        assert(loop.stats().steps == 2 && game.drawnHeight == -2.0f && near(game.lastAlpha, 0.5f));
+        loop.frame(callbacks(&game), kStep);
+        assert(game.drawnHeight == -4.0f && near(game.lastAlpha, 0.0f));
+
+        game.framesLeft = 50;
+        loop.run(callbacks(&game));
+        assert(game.framesLeft == 0 && game.renders == 54);
+        assert(static_cast<uint64_t>(game.steps) == loop.stepCount());
+    }
+
+    printf("- FrameLoop: Profiler zones\n");
+    {
+        lys3d::Profiler &profiler = lys3d::Profiler::global();
+        profiler.enable();
+        Game game;
+        lys3d::FrameLoop loop;
+        profiler.beginFrame();
+        loop.frame(callbacks(&game), kStep * 3);
+        profiler.endFrame();
+        lys3d::Vector<lys3d::ProfilerZoneStats> zones;
+        profiler.topZones(16, &zones);
+        const char *expected[] = {"Frame input", "Frame steps", "Frame sync", "Frame render", "Frame present"};
+        for (const char *name : expected) {
+            bool found = false;
+            for (const lys3d::ProfilerZoneStats &zone : zones)
+                found = found || strcmp(zone.name, name) == 0;
+            assert(found);
+        }
+        bool counted = false;
+        for (uint32_t id = 0; id < profiler.counterCount(); ++id) {
+            if (strcmp(profiler.counterName(id), "Simulation steps") == 0)
+                counted = profiler.counterValue(id) == 3;
+        }
+        assert(counted);
+        profiler.enable(false);
+    }
+    return 0;
+}
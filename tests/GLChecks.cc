@@ -0,0 +1,98 @@
+/***************************************************
+* Test - GL debug layer & proc loading             *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include <assert.h>
+#include <stdio.h>
+#include <thread>
+
+#include "FakeGL.h"
+#include "GLES2/gl2.h"
+
+int main(void) {
+    // The function pointers resolve through the loader
+    printf("- GLChecks: Proc loader\n");
+    setGLProcLoader(fakegl::loader);
+    resetGLPointers();
+    glBindBuffer(GL_ARRAY_BUFFER, 1);
+    assert(fakegl::calls == 1);
+    loadGLPointers();
+    assert(_glptr_glBindBuffer == reinterpret_cast<PFN_glBindBuffer>(fakegl::bindBuffer));
+    assert(_glptr_glClear == nullptr);
+
+#ifdef LYS_DEBUG
+    GLSlowPathCounts counts;
+    assert(enableGLChecks(1));
+    takeGLSlowPathCounts(&counts);
+
+    // Errors are drained after the call, so the application sees none
+    printf("- GLChecks: Errors\n");
+    fakegl::errors.push_back(GL_INVALID_ENUM);
+    fakegl::errors.push_back(GL_INVALID_VALUE);
+    glBindTexture(GL_TEXTURE_2D, 7);
+    assert(fakegl::errors.empty());
+    assert(glGetError() == GL_NO_ERROR);
+    takeGLSlowPathCounts(&counts);
+    assert(counts.errors == 1 && counts.queries == 1);
+
+    // Binding what is bound and setting what is set are counted; the first
+    // bind after installing isn't, as the binding isn't known yet
+    printf("- GLChecks: Slow paths\n");
+    glBindBuffer(GL_ARRAY_BUFFER, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 1);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 1);
+    glEnable(GL_BLEND);
+    glEnable(GL_BLEND);
+    glDisable(GL_BLEND);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    takeGLSlowPathCounts(&counts);
+    assert(counts.redundantBinds == 1 && counts.redundantStates == 1 && counts.queries == 1);
+
+    // Deleting a buffer unbinds it; other texture units bind separately
+    GLuint buffer = 1;
+    glDeleteBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, 1);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 7);
+    glBindTexture(GL_TEXTURE_2D, 7);
+    takeGLSlowPathCounts(&counts);
+    assert(counts.redundantBinds == 1 && counts.errors == 0);
+
+    // Other threads have their own call sites, and leave the enabling
+    // thread's bindings and counts alone
+    printf("- GLChecks: Threads\n");
+    _glCallSite.file = "main";
+    _glCallSite.line = 1;
+    std::thread worker([]() {
+        assert(_glCallSite.file == nullptr);
+        fakegl::errors.push_back(GL_INVALID_OPERATION);
+        glBindBuffer(GL_ARRAY_BUFFER, 2);
+        glBindBuffer(GL_ARRAY_BUFFER, 2);
+        glEnable(GL_CULL_FACE);
+        glEnable(GL_CULL_FACE);
+        assert(_glCallSite.file == nullptr);
+    });
+    worker.join();
+    assert(fakegl::errors.empty());
+    assert(_glCallSite.file != nullptr && _glCallSite.line == 1);
+    _glCallSite.file = nullptr;
+    glBindBuffer(GL_ARRAY_BUFFER, 1);
+    takeGLSlowPathCounts(&counts);
+    assert(counts.errors == 0 && counts.redundantBinds == 1 && counts.redundantStates == 0);
+
+    // Disabling puts the loaded pointers back
+    assert(enableGLChecks(0));
+    assert(_glptr_glBindBuffer == reinterpret_cast<PFN_glBindBuffer>(fakegl::bindBuffer));
+#endif
+
+    setGLProcLoader(nullptr);
+    resetGLPointers();
+    return 0;
+}
@@ -0,0 +1,104 @@
+/***************************************************
+* Test - Shadowed GL state                         *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include <assert.h>
+#include <stdio.h>
+#include <thread>
+
+#include "FakeGL.h"
+#include "GLState.h"
+
+using namespace lys3d;
+
+static const uint32_t kAll = kGLStateCapabilities | kGLStateBlendFunc | kGLStateDepthMask | kGLStateBindings | kGLStateViewport;
+
+// Four capabilities, four blend factors, the depth mask, four bindings and the viewport
+static const uint32_t kAllQueries = 14;
+
+int main(void) {
+    setGLProcLoader(fakegl::loader);
+    resetGLPointers();
+
+    // Without the shadow everything is asked for
+    printf("- GLState: Unshadowed\n");
+    GLStateSnapshot state;
+    saveGLState(kAll, &state);
+    assert(fakegl::queries == kAllQueries);
+    assert(state.depthMask == GL_TRUE && state.activeTexture == GL_TEXTURE0);
+
+    // With it, only once
+    printf("- GLState: Shadowed\n");
+    assert(shadowGLState(true));
+    fakegl::queries = 0;
+    saveGLState(kAll, &state);
+    saveGLState(kAll, &state);
+    assert(fakegl::queries == kAllQueries);
+
+    // Calls that change the state are followed
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(3);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 5);
+    glViewport(1, 2, 3, 4);
+    saveGLState(kAll, &state);
+    assert(state.blend == GL_TRUE && state.blendFunc[1] == GL_ONE_MINUS_SRC_ALPHA && state.blendFunc[3] == GL_ONE_MINUS_SRC_ALPHA);
+    assert(state.program == 3 && state.activeTexture == GL_TEXTURE1 && state.texture == 0);
+    assert(state.viewport[0] == 1 && state.viewport[3] == 4);
+    assert(boundTexture2D() == 5);
+    assert(fakegl::queries == kAllQueries);
+
+    // Restoring and setting capabilities only make calls that change something
+    uint32_t calls = fakegl::calls;
+    restoreGLState(state);
+    setGLCapability(GL_BLEND, true);
+    assert(fakegl::calls == calls);
+    setGLCapability(GL_BLEND, false);
+    glUseProgram(4);
+    calls = fakegl::calls;
+    restoreGLState(state);
+    assert(fakegl::calls == calls + 2);
+
+    // Deleting the bound texture unbinds it
+    GLuint texture = 5;
+    glDeleteTextures(1, &texture);
+    assert(boundTexture2D() == 0 && fakegl::queries == kAllQueries);
+
+    // Other threads use other contexts, so aren't followed and ask GL
+    printf("- GLState: Threads\n");
+    std::thread other([] {
+        glUseProgram(9);
+        GLStateSnapshot theirs;
+        saveGLState(kGLStateBindings, &theirs);
+        assert(theirs.program == 0);
+    });
+    other.join();
+    assert(fakegl::queries == kAllQueries + 4);
+    saveGLState(kGLStateBindings, &state);
+    assert(state.program == 3 && fakegl::queries == kAllQueries + 4);
+
+    // Resetting the function pointers forgets it
+    printf("- GLState: Reset\n");
+    resetGLPointers();
+    fakegl::queries = 0;
+    saveGLState(kAll, &state);
+    saveGLState(kAll, &state);
+    assert(fakegl::queries == kAllQueries);
+    assert(state.program == 0 && state.blend == GL_FALSE);
+
+    // And disabling it goes back to asking every time
+    assert(shadowGLState(false));
+    saveGLState(kAll, &state);
+    assert(fakegl::queries == 2 * kAllQueries);
+
+    setGLProcLoader(nullptr);
+    resetGLPointers();
+    return 0;
+}
@@ -0,0 +1,213 @@
+/***************************************************
+* Test - GL call-stream capture & replay           *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "GLTrace.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+
+using lys3d::Vector;
+
+static const char *kPath = "GLTrace-test.lysgl";
+
+static Vector<uint8_t> readTrace() {
+    Vector<uint8_t> data;
+    FILE *file = fopen(kPath, "rb");
+    assert(file != nullptr);
+    int c;
+    while ((c = fgetc(file)) != EOF)
+        data.push_back(static_cast<uint8_t>(c));
+    fclose(file);
+    return data;
+}
+
+static void appendWord(Vector<uint8_t> *data, uint32_t value) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&value);
+    data->insert(data->end(), bytes, bytes + sizeof(value));
+}
+
+// No GL calls are made, so no context is needed: only the frame marks
+// travel through the trace
+static void testRoundTrip() {
+    lys3d::GLCapture capture;
+    assert(!capture.isCapturing() && !capture.stop());
+    assert(capture.start(kPath, lys3d::Dimension2Di32(640, 360)));
+    assert(capture.isCapturing());
+    lys3d::GLCapture other;
+    assert(!other.start(kPath, lys3d::Dimension2Di32(1, 1)));
+    for (int i = 0; i < 3; ++i)
+        capture.frame();
+    other.frame();
+    assert(capture.frames() == 3 && other.frames() == 0);
+    uint64_t bytes = capture.bytes();
+    assert(capture.stop());
+    assert(!capture.isCapturing() && !capture.stop());
+    capture.frame();
+    assert(capture.frames() == 3);
+
+    Vector<uint8_t> data = readTrace();
+    assert(data.size() == bytes);
+
+    lys3d::GLReplay replay;
+    assert(!replay.load("GLTrace-missing.lysgl"));
+    assert(replay.load(kPath));
+    assert(replay.frameCount() == 3);
+    assert(replay.framebufferSize().width() == 640 && replay.framebufferSize().height() == 360);
+    for (uint32_t frame = 0; frame < 3; ++frame) {
+        assert(replay.frame() == frame);
+        assert(replay.replayFrame());
+        assert(replay.stats().calls == 0 && replay.stats().drawCalls == 0);
+    }
+    assert(!replay.replayFrame() && replay.frame() == 3);
+    replay.rewind();
+    assert(replay.frame() == 0 && replay.replayFrame());
+    remove(kPath);
+}
+
+static void testCorruption() {
+    lys3d::GLCapture capture;
+    assert(capture.start(kPath, lys3d::Dimension2Di32(64, 64)));
+    capture.frame();
+    assert(capture.stop());
+    const Vector<uint8_t> data = readTrace();
+    remove(kPath);
+
+    lys3d::GLReplay replay;
+    assert(replay.loadFromMemory(data.data(), data.size()) && replay.frameCount() == 1);
+
+    // Calls after the last frame mark make one more frame. Opcode 1 is
+    // glActiveTexture, which takes one word
+    Vector<uint8_t> open_frame = data;
+    appendWord(&open_frame, 1);
+    appendWord(&open_frame, 0x84C0);
+    assert(replay.loadFromMemory(open_frame.data(), open_frame.size()) && replay.frameCount() == 2);
+
+    // A call cut short, an unknown opcode, a stray byte, a bad header
+    Vector<uint8_t> broken = data;
+    appendWord(&broken, 1);
+    assert(!replay.loadFromMemory(broken.data(), broken.size()));
+    assert(replay.frameCount() == 0 && !replay.replayFrame());
+    broken = data;
+    appendWord(&broken, 0xFFFF);
+    assert(!replay.loadFromMemory(broken.data(), broken.size()));
+    broken = data;
+    broken.push_back(0);
+    assert(!replay.loadFromMemory(broken.data(), broken.size()));
+    broken = data;
+    broken[0] = 'X';
+    assert(!replay.loadFromMemory(broken.data(), broken.size()));
+    assert(!replay.loadFromMemory(data.data(), 10));
+}
+
+// Opcodes are positions in GLTrace.cc's call list
+static const uint32_t kOpBufferData = 13;
+static const uint32_t kOpGenBuffers = 50;
+static const uint32_t kOpPixelStorei = 91;
+static const uint32_t kOpTexImage2D = 106;
+
+// A B argument: its size word, then the bytes padded to a word
+static void appendBlock(Vector<uint8_t> *data, uint32_t size, uint32_t bytes) {
+    appendWord(data, size);
+    data->resize(data->size() + ((bytes + 3) & ~3u), 0xAB);
+}
+
+static void appendBufferData(Vector<uint8_t> *data, uint64_t size, uint32_t block) {
+    appendWord(data, kOpBufferData);
+    appendWord(data, 0x8892);
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&size);
+    data->insert(data->end(), bytes, bytes + sizeof(size));
+    appendBlock(data, block, block);
+    appendWord(data, 0x88E4);
+}
+
+static void appendTexImage2D(Vector<uint8_t> *data, uint32_t width, uint32_t height, uint32_t block) {
+    const uint32_t args[8] = {0x0DE1, 0, 0x1907, width, height, 0, 0x1907, 0x1401};
+    appendWord(data, kOpTexImage2D);
+    for (uint32_t arg : args)
+        appendWord(data, arg);
+    appendBlock(data, block, block);
+}
+
+// Data blocks must hold what the call's size arguments say GL will read
+static void testBlocks() {
+    lys3d::GLCapture capture;
+    assert(capture.start(kPath, lys3d::Dimension2Di32(64, 64)));
+    assert(capture.stop());
+    const Vector<uint8_t> header = readTrace();
+    remove(kPath);
+
+    lys3d::GLReplay replay;
+    Vector<uint8_t> trace = header;
+    appendBufferData(&trace, 10, 10);
+    appendWord(&trace, 0);
+    assert(replay.loadFromMemory(trace.data(), trace.size()) && replay.frameCount() == 1);
+
+    // A null block takes no bytes; a short one, or a trace cut inside one,
+    // fails the load
+    trace = header;
+    appendWord(&trace, kOpBufferData);
+    appendWord(&trace, 0x8892);
+    appendWord(&trace, 1 << 20);
+    appendWord(&trace, 0);
+    appendWord(&trace, 0xFFFFFFFF);
+    appendWord(&trace, 0x88E4);
+    assert(replay.loadFromMemory(trace.data(), trace.size()));
+    trace = header;
+    appendBufferData(&trace, 1 << 20, 16);
+    assert(!replay.loadFromMemory(trace.data(), trace.size()));
+    assert(replay.frameCount() == 0);
+    trace = header;
+    appendBufferData(&trace, 64, 64);
+    trace.resize(trace.size() - 32);
+    assert(!replay.loadFromMemory(trace.data(), trace.size()));
+
+    // Image rows are padded to the unpack alignment, except the last: a 3x2
+    // RGB image is 12 + 9 bytes at the default of 4, 18 when packed
+    trace = header;
+    appendTexImage2D(&trace, 3, 2, 21);
+    assert(replay.loadFromMemory(trace.data(), trace.size()));
+    trace = header;
+    appendTexImage2D(&trace, 3, 2, 18);
+    assert(!replay.loadFromMemory(trace.data(), trace.size()));
+    trace = header;
+    appendWord(&trace, kOpPixelStorei);
+    appendWord(&trace, 0x0CF5);
+    appendWord(&trace, 1);
+    appendTexImage2D(&trace, 3, 2, 18);
+    assert(replay.loadFromMemory(trace.data(), trace.size()));
+    trace = header;
+    appendTexImage2D(&trace, 4096, 4096, 16);
+    assert(!replay.loadFromMemory(trace.data(), trace.size()));
+
+    // Generated names follow the call; a count the trace can't hold fails
+    // the load rather than sizing the replay's scratch
+    trace = header;
+    appendWord(&trace, kOpGenBuffers);
+    appendWord(&trace, 2);
+    appendWord(&trace, 1);
+    appendWord(&trace, 2);
+    assert(replay.loadFromMemory(trace.data(), trace.size()));
+    trace = header;
+    appendWord(&trace, kOpGenBuffers);
+    appendWord(&trace, 0x7FFFFFFF);
+    appendWord(&trace, 1);
+    assert(!replay.loadFromMemory(trace.data(), trace.size()));
+}
+
+int main(void) {
+    testRoundTrip();
+    testCorruption();
+    testBlocks();
+    puts("GLTrace tests passed");
+    return 0;
+}
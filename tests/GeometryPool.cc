@@ -0,0 +1,75 @@
+/***************************************************
+* Test - Geometry pool allocation & defragmenting  *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "GeometryPool.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "types.h"
+
+int main(void) {
+    // Nothing here calls create(), so no GL context is needed
+    lys3d::VertexLayout layout = lys3d::VertexLayout::full();
+    lys3d::Vector<lys3d::MeshVertex> vertices(100);
+    lys3d::Vector<uint16_t> indices(300, 0);
+
+    printf("- GeometryPool: Adding meshes\n");
+    lys3d::GeometryPool pool(layout, 1000, 3000);
+    lys3d::Vector<uint32_t> ids;
+    for (int i = 0; i < 10; ++i) {
+        uint32_t id = pool.add(vertices.data(), 100, indices.data(), 300);
+        assert(id != 0);
+        ids.push_back(id);
+    }
+    assert(pool.add(vertices.data(), 100, indices.data(), 300) == 0);  // Full
+    lys3d::GeometryPoolStats stats = pool.stats();
+    assert(stats.meshCount == 10);
+    assert(stats.vertexBytes == 1000 * sizeof(lys3d::MeshVertex));
+    assert(stats.indexBytes == 3000 * sizeof(uint16_t));
+
+    lys3d::Mesh mesh;
+    mesh.vertices() = vertices;
+    mesh.indices() = indices;
+    lys3d::VertexLayout compressed = lys3d::VertexLayout::compressed(true);
+    lys3d::GeometryPool small_pool(compressed, 1000, 3000);
+    assert(small_pool.add(mesh) == 0);  // Layout mismatch
+
+    printf("- GeometryPool: Removing leaves holes\n");
+    for (int i = 0; i < 10; i += 2)
+        pool.remove(ids[i]);
+    stats = pool.stats();
+    assert(stats.meshCount == 5);
+    assert(stats.vertexFragmentation > 0.5f);
+    assert(pool.add(vertices.data(), 200, indices.data(), 300) == 0);  // No 200-vertex hole
+
+    printf("- GeometryPool: Incremental defragmentation\n");
+    uint32_t moves = pool.defragment(100 * sizeof(lys3d::MeshVertex));
+    assert(moves == 1);
+    assert(pool.stats().vertexFragmentation > 0.0f);  // One vertex range, then the budget ran out
+    assert(pool.stats().indexFragmentation > 0.0f);   // Which both buffers share
+    assert(pool.stats().movedBytes <= 100 * sizeof(lys3d::MeshVertex));
+    (void)moves;
+    for (int frame = 0; frame < 10; ++frame)
+        pool.defragment();
+    stats = pool.stats();
+    assert(stats.vertexFragmentation == 0.0f);
+    assert(stats.indexFragmentation == 0.0f);
+    for (int i = 1; i < 10; i += 2) {
+        assert(pool.vertexOffset(ids[i]) < 500);
+        assert(pool.indexOffset(ids[i]) < 1500);
+    }
+    vertices.resize(500);
+    indices.resize(1500, 0);
+    uint32_t big = pool.add(vertices.data(), 500, indices.data(), 1500);
+    assert(big != 0);
+    assert(pool.vertexOffset(big) == 500);
+    return 0;
+}
@@ -0,0 +1,78 @@
+/***************************************************
+* Test - Screen-space-error LOD selection          *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "LodSelector.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "types.h"
+
+int main(void) {
+    // A fake chain; selection only looks at the LOD table
+    lys3d::Mesh mesh;
+    mesh.indices().resize(3000 + 300 + 30);
+    float errors[3] = {0.0f, 0.1f, 1.0f};
+    uint32_t offset = 0, counts[3] = {3000, 300, 30};
+    for (int i = 0; i < 3; ++i) {
+        lys3d::MeshLod lod;
+        lod.indexOffset = offset;
+        lod.indexCount = counts[i];
+        lod.error = errors[i];
+        mesh.lods().push_back(lod);
+        offset += counts[i];
+    }
+
+    // 90 degree FOV on a 1000-pixel-high viewport: 500 pixels per unit at
+    // distance 1, so 0.1 error is 1 pixel at 50 units and 1.0 is at 500.
+    lys3d::LodSelector selector;
+    selector.projection(lys3d::Dimension2Di32(1000, 1000), 1.5707963f);
+    selector.threshold(1.0f);
+    selector.hysteresis(0.2f);
+
+    // Enough instances to cover both the SIMD and scalar loops
+    printf("- LodSelector: Selecting over distance\n");
+    lys3d::LodVisibleList list;
+    float distances[7] = {10.0f, 40.0f, 80.0f, 200.0f, 480.0f, 700.0f, 5000.0f};
+    uint8_t expected[7] = {0, 0, 1, 1, 1, 2, 2};
+    for (float d : distances)
+        list.add(lys3d::Point3Df(0.0f, 0.0f, d), 0.0f, &mesh);
+    selector.select(lys3d::Point3Df(), &list);
+    for (size_t i = 0; i < list.size(); ++i) {
+        printf("Distance %.0f: level %u\n", distances[i], list.levels[i]);
+        assert(list.levels[i] == expected[i]);
+    }
+    const lys3d::LodStats &stats = selector.stats();
+    printf("Triangles: %llu full detail, %llu selected\n",
+           static_cast<unsigned long long>(stats.fullDetailTriangles),
+           static_cast<unsigned long long>(stats.selectedTriangles));
+    assert(stats.instances == 7 && stats.fullDetailTriangles == 7000);
+    assert(stats.selectedTriangles == 1000 + 1000 + 100 + 100 + 100 + 10 + 10);
+
+    // Hysteresis: just past the switching distance only refines
+    printf("- LodSelector: Hysteresis\n");
+    list.clear();
+    list.add(lys3d::Point3Df(0.0f, 0.0f, 55.0f), 0.0f, &mesh, 0);
+    list.add(lys3d::Point3Df(0.0f, 0.0f, 45.0f), 0.0f, &mesh, 1);
+    selector.select(lys3d::Point3Df(), &list);
+    assert(list.levels[0] == 0); // 0.9 pixels, not below 0.8 yet
+    assert(list.levels[1] == 0); // 1.1 pixels, refine right away
+    list.centerZ[0] = 65.0f;
+    selector.select(lys3d::Point3Df(), &list);
+    assert(list.levels[0] == 1);
+
+    // The bounding radius counts towards closeness
+    list.clear();
+    list.add(lys3d::Point3Df(0.0f, 0.0f, 80.0f), 50.0f, &mesh, 2);
+    selector.select(lys3d::Point3Df(), &list);
+    assert(list.levels[0] == 0);
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+/***************************************************
+* Test - Materials & shader permutations          *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Material.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "types.h"
+
+using namespace lys3d;
+
+// The layout is worked out by the compiler
+static_assert(materialSlotCount(0) == 2 && kMaterialMaxSlots == 4, "Unexpected block sizes");
+static_assert(materialSlot(kMaterialFog, kMaterialFogColor) == 2, "Fog should follow the surface");
+static_assert(materialSlot(kMaterialEmissive | kMaterialFog, kMaterialFogColor) == 3, "Fog should follow emission");
+static_assert(materialSlot(kMaterialNormalMap | kMaterialSkinning, kMaterialEmissiveColor) == -1,
+              "Emission should be absent");
+static_assert(MaterialPermutation<kMaterialEmissive | kMaterialFog>::kSlots == 4, "Unexpected block size");
+static_assert(MaterialPermutation<kMaterialFog>::Slot<kMaterialFogColor>::kIndex == 2, "Unexpected slot");
+
+static bool contains(const String &text, const char *part) {
+    return text.find(part) != String::npos;
+}
+
+static void testDefines() {
+    String plain = MaterialShader::defines(0);
+    assert(contains(plain, "#define MATERIAL_SLOTS 2\n"));
+    assert(contains(plain, "#define MATERIAL_BASE_COLOR 0\n") && contains(plain, "#define MATERIAL_SURFACE 1\n"));
+    assert(!contains(plain, "MATERIAL_FOG") && !contains(plain, "MATERIAL_EMISSIVE"));
+
+    String full = MaterialShader::defines(kMaterialPermutationCount - 1);
+    assert(contains(full, "#define MATERIAL_NORMAL_MAP 1\n") && contains(full, "#define MATERIAL_SKINNING 1\n"));
+    assert(contains(full, "#define MATERIAL_EMISSIVE 1\n") && contains(full, "#define MATERIAL_FOG 1\n"));
+    assert(contains(full, "#define MATERIAL_SLOTS 4\n"));
+    assert(contains(full, "#define MATERIAL_EMISSIVE_COLOR 2\n") && contains(full, "#define MATERIAL_FOG_COLOR 3\n"));
+}
+
+static void testParameters() {
+    Material material(nullptr, kMaterialFog);
+    assert(material.features() == kMaterialFog && material.slotCount() == 3);
+    float values[4];
+    assert(material.get(kMaterialBaseColor, values) && values[0] == 1.0f && values[3] == 1.0f);
+    assert(material.get(kMaterialSurface, values) && values[0] == 0.5f && values[2] == 1.0f);
+    assert(!material.get(kMaterialEmissiveColor, values));
+
+    uint64_t stamp = material.stamp();
+    assert(!material.set(kMaterialEmissiveColor, 1.0f, 0.0f, 0.0f, 1.0f) && material.stamp() == stamp);
+    assert(material.set(kMaterialFogColor, 0.25f, 0.5f, 0.75f, 0.01f) && material.stamp() != stamp);
+    assert(material.get(kMaterialFogColor, values) && values[1] == 0.5f && values[3] == 0.01f);
+    assert(memcmp(&material.block()[8], values, sizeof(values)) == 0);
+
+    // Typed materials put values straight into their slot
+    StaticMaterial<kMaterialEmissive | kMaterialFog> glowing(nullptr);
+    glowing.set<kMaterialFogColor>(1.0f, 2.0f, 3.0f, 4.0f);
+    assert(glowing.block()[12] == 1.0f && glowing.block()[15] == 4.0f);
+    glowing.set<kMaterialEmissiveColor>(5.0f, 6.0f, 7.0f, 8.0f);
+    assert(glowing.get(kMaterialEmissiveColor, values) && values[0] == 5.0f);
+
+    // Stamps are never shared
+    Material other(nullptr, kMaterialFog);
+    assert(other.stamp() != material.stamp() && other.id() != material.id());
+}
+
+static void testUploadRange() {
+    Material material(nullptr, kMaterialEmissive | kMaterialFog);
+    float resident[kMaterialMaxSlots * 4];
+    uint32_t first = 99;
+
+    // Nothing known yet: the whole block
+    assert(materialUploadRange(material.stamp(), 0, material.block(), resident, 4, &first) == 4 && first == 0);
+    memcpy(resident, material.block(), sizeof(resident));
+    uint64_t resident_stamp = material.stamp();
+
+    // Same stamp: nothing, without looking at the values
+    assert(materialUploadRange(material.stamp(), resident_stamp, material.block(), resident, 4, &first) == 0);
+
+    // One changed slot: one vec4
+    material.set(kMaterialEmissiveColor, 1.0f, 0.5f, 0.25f, 2.0f);
+    assert(materialUploadRange(material.stamp(), resident_stamp, material.block(), resident, 4, &first) == 1);
+    assert(first == 2);
+
+    // Two apart: the range between them
+    material.set(kMaterialSurface, 0.1f, 0.2f, 0.3f, 0.4f);
+    assert(materialUploadRange(material.stamp(), resident_stamp, material.block(), resident, 4, &first) == 2);
+    assert(first == 1);
+
+    // A new stamp with the same values: nothing
+    memcpy(resident, material.block(), sizeof(resident));
+    material.set(kMaterialSurface, 0.1f, 0.2f, 0.3f, 0.4f);
+    assert(materialUploadRange(material.stamp(), resident_stamp, material.block(), resident, 4, &first) == 0);
+
+    // Slots past the ones compared never count
+    material.set(kMaterialFogColor, 0.0f, 0.0f, 0.0f, 1.0f);
+    assert(materialUploadRange(material.stamp(), resident_stamp, material.block(), resident, 3, &first) == 0);
+}
+
+static void testSortKeys() {
+    MaterialShader first, second;
+    assert(second.index() == ((first.index() + 1) & 0xFF));
+    Material a(&second, 0), b(&first, kMaterialFog), c(&first, 0), d(&first, kMaterialFog);
+    const Material *queue[4] = {&a, &b, &c, &d};
+    std::sort(queue, queue + 4, [](const Material *x, const Material *y) {
+        return x->sortKey() < y->sortKey();
+    });
+    // By shader, then permutation, then material
+    assert(queue[0] == &c && queue[1] == &b && queue[2] == &d && queue[3] == &a);
+    assert((b.sortKey() & 0xFFFFF) == b.id() && (b.sortKey() >> 20 & 0xF) == kMaterialFog);
+    assert(first.program(0) == nullptr && first.programCount() == 0);
+
+    MaterialBinder binder;
+    assert(!binder.bind(c) && binder.stats().binds == 0);
+}
+
+int main(void) {
+    testDefines();
+    testParameters();
+    testUploadRange();
+    testSortKeys();
+    puts("Material tests passed");
+    return 0;
+}
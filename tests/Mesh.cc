@@ -0,0 +1,99 @@
+/***************************************************
+* Test - Indexed triangle mesh with LOD chain      *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Mesh.h"
+#include "MeshSimplifier.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "types.h"
+
+// UV sphere with (rings + 1) * (segments + 1) vertices
+static void makeSphere(lys3d::Mesh *mesh, int rings, int segments, float radius) {
+    mesh->clear();
+    for (int r = 0; r <= rings; ++r) {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s <= segments; ++s) {
+            float phi = 6.28318531f * s / segments;
+            lys3d::MeshVertex v;
+            v.normal[0] = sinf(theta) * cosf(phi);
+            v.normal[1] = cosf(theta);
+            v.normal[2] = sinf(theta) * sinf(phi);
+            for (int k = 0; k < 3; ++k)
+                v.position[k] = v.normal[k] * radius;
+            v.uv[0] = static_cast<float>(s) / segments;
+            v.uv[1] = static_cast<float>(r) / rings;
+            mesh->vertices().push_back(v);
+        }
+    }
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            uint16_t a = static_cast<uint16_t>(r * (segments + 1) + s);
+            uint16_t b = static_cast<uint16_t>(a + segments + 1);
+            uint16_t quad[6] = {a, b, static_cast<uint16_t>(a + 1),
+                                static_cast<uint16_t>(a + 1), b, static_cast<uint16_t>(b + 1)};
+            for (uint16_t index : quad)
+                mesh->indices().push_back(index);
+        }
+    }
+    mesh->resetLods();
+    mesh->computeBounds();
+}
+
+int main(void) {
+    lys3d::Mesh mesh;
+    makeSphere(&mesh, 48, 96, 10.0f);
+    assert(mesh.lods().size() == 1);
+    assert(mesh.triangleCount(0) == 48 * 96 * 2);
+    assert(fabsf(mesh.boundsRadius() - 10.0f) < 0.01f);
+
+    // LOD chain generation
+    printf("- Mesh: Generating LOD chain\n");
+    lys3d::MeshSimplifier simplifier;
+    uint32_t levels = simplifier.generate(&mesh);
+    assert(levels == mesh.lods().size() && levels > 1);
+    for (size_t i = 0; i < levels; ++i) {
+        const lys3d::MeshLod &lod = mesh.lods()[i];
+        printf("LOD %u: %u triangles, error %f\n", static_cast<unsigned>(i),
+               mesh.triangleCount(i), lod.error);
+        assert(lod.indexOffset + lod.indexCount <= mesh.indices().size());
+        if (i > 0) {
+            assert(mesh.triangleCount(i) <= mesh.triangleCount(i - 1) * 0.6f);
+            assert(lod.error >= mesh.lods()[i - 1].error);
+            // Simplified surfaces stay close to the original sphere
+            assert(lod.error < 10.0f);
+        }
+    }
+    for (uint16_t index : mesh.indices())
+        assert(index < mesh.vertices().size());
+
+    // Asset round trip
+    printf("- Mesh: Saving and loading\n");
+    lys3d::Vector<uint8_t> data;
+    mesh.saveToMemory(&data);
+    lys3d::Mesh loaded;
+    assert(loaded.loadFromMemory(data.data(), data.size()));
+    assert(loaded.vertices().size() == mesh.vertices().size());
+    assert(loaded.indices() == mesh.indices());
+    assert(loaded.lods().size() == mesh.lods().size());
+    assert(loaded.lods().back().error == mesh.lods().back().error);
+    assert(loaded.boundsRadius() == mesh.boundsRadius());
+
+    // Corrupt assets are rejected
+    printf("- Mesh: Rejecting bad data\n");
+    assert(!loaded.loadFromMemory(data.data(), data.size() - 4));
+    assert(loaded.vertices().empty());
+    data[0] = 'X';
+    assert(!loaded.loadFromMemory(data.data(), data.size()));
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+/***************************************************
+* Test - Index & vertex order tuning               *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "MeshOptimizer.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "types.h"
+
+// UV sphere with (rings + 1) * (segments + 1) vertices
+static void makeSphere(lys3d::Mesh *mesh, int rings, int segments, float radius) {
+    mesh->clear();
+    for (int r = 0; r <= rings; ++r) {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s <= segments; ++s) {
+            float phi = 6.28318531f * s / segments;
+            lys3d::MeshVertex v;
+            v.normal[0] = sinf(theta) * cosf(phi);
+            v.normal[1] = cosf(theta);
+            v.normal[2] = sinf(theta) * sinf(phi);
+            for (int k = 0; k < 3; ++k)
+                v.position[k] = v.normal[k] * radius;
+            v.uv[0] = static_cast<float>(s) / segments;
+            v.uv[1] = static_cast<float>(r) / rings;
+            mesh->vertices().push_back(v);
+        }
+    }
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            uint16_t a = static_cast<uint16_t>(r * (segments + 1) + s);
+            uint16_t b = static_cast<uint16_t>(a + segments + 1);
+            uint16_t quad[6] = {a, b, static_cast<uint16_t>(a + 1),
+                                static_cast<uint16_t>(a + 1), b, static_cast<uint16_t>(b + 1)};
+            for (uint16_t index : quad)
+                mesh->indices().push_back(index);
+        }
+    }
+    mesh->resetLods();
+    mesh->computeBounds();
+}
+
+// Triangles as sorted position triples, to compare meshes regardless of
+// triangle and vertex order.
+static lys3d::Vector<lys3d::Vector<float>> triangleSet(const lys3d::Mesh &mesh) {
+    lys3d::Vector<lys3d::Vector<float>> set;
+    for (size_t i = 0; i < mesh.indices().size(); i += 3) {
+        lys3d::Vector<float> tri;
+        for (int k = 0; k < 3; ++k) {
+            const float *p = mesh.vertices()[mesh.indices()[i + k]].position;
+            tri.insert(tri.end(), p, p + 3);
+        }
+        set.push_back(tri);
+    }
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+int main(void) {
+    lys3d::Mesh mesh;
+    makeSphere(&mesh, 32, 64, 5.0f);
+
+    // Shuffle the triangles, so the input is a cache's worst case
+    srand(1234);
+    size_t triangles = mesh.indices().size() / 3;
+    for (size_t i = triangles - 1; i > 0; --i) {
+        size_t j = static_cast<size_t>(rand()) % (i + 1);
+        for (int k = 0; k < 3; ++k)
+            std::swap(mesh.indices()[i * 3 + k], mesh.indices()[j * 3 + k]);
+    }
+    lys3d::Vector<lys3d::Vector<float>> original = triangleSet(mesh);
+
+    lys3d::MeshOptimizer optimizer;
+    assert(optimizer.cacheSize() == 16);
+    lys3d::VertexCacheStats before = optimizer.analyze(mesh.indices().data(), mesh.indices().size(),
+                                                       mesh.vertices().size());
+    assert(before.triangles == triangles);
+    assert(before.acmr > 2.0f);
+
+    // Pure cache ordering
+    printf("- MeshOptimizer: Vertex cache order\n");
+    lys3d::Mesh cache_only = mesh;
+    optimizer.useOverdraw(false);
+    optimizer.optimize(&cache_only);
+    lys3d::VertexCacheStats after = optimizer.analyze(cache_only.indices().data(), cache_only.indices().size(),
+                                                      cache_only.vertices().size());
+    printf("  ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.acmr, after.acmr, before.atvr, after.atvr);
+    assert(after.triangles == before.triangles);
+    assert(after.acmr < 0.8f);
+    assert(after.atvr < 1.4f);
+    assert(triangleSet(cache_only) == original);
+
+    // Vertex fetch order: first use is in increasing order
+    printf("- MeshOptimizer: Vertex fetch order\n");
+    uint16_t next = 0;
+    for (uint16_t index : cache_only.indices()) {
+        assert(index <= next);
+        if (index == next)
+            ++next;
+    }
+    assert(next == cache_only.vertices().size());
+
+    // Overdraw clusters keep most of the cache benefit
+    printf("- MeshOptimizer: Overdraw clusters\n");
+    lys3d::Mesh sorted = mesh;
+    optimizer.useOverdraw(true);
+    optimizer.optimize(&sorted);
+    lys3d::VertexCacheStats clustered = optimizer.analyze(sorted.indices().data(), sorted.indices().size(),
+                                                          sorted.vertices().size());
+    printf("  ACMR %.3f with overdraw sorting\n", clustered.acmr);
+    assert(clustered.acmr < after.acmr * 1.25f);
+    assert(triangleSet(sorted) == original);
+
+    // Unused vertices are dropped
+    printf("- MeshOptimizer: Unused vertices\n");
+    lys3d::MeshVertex stray = mesh.vertices()[0];
+    mesh.vertices().push_back(stray);
+    optimizer.optimizeVertexFetch(&mesh);
+    assert(mesh.vertices().size() == cache_only.vertices().size());
+
+    // Levels that share indices are renumbered once
+    printf("- MeshOptimizer: Shared level ranges\n");
+    lys3d::Mesh shared;
+    makeSphere(&shared, 8, 16, 1.0f);
+    lys3d::Vector<lys3d::Vector<float>> shared_original = triangleSet(shared);
+    uint32_t half = static_cast<uint32_t>(shared.indices().size() / 6) * 3;
+    lys3d::MeshLod lod = shared.lods()[0];
+    shared.lods().push_back(lod);
+    lod.indexOffset = half;
+    lod.indexCount -= half;
+    shared.lods().push_back(lod);
+    optimizer.optimize(&shared);
+    assert(triangleSet(shared) == shared_original);
+    next = 0;
+    for (uint16_t index : shared.indices()) {
+        assert(index <= next);
+        if (index == next)
+            ++next;
+    }
+    assert(next == shared.vertices().size());
+    return 0;
+}
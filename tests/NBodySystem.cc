@@ -0,0 +1,171 @@
+/***************************************************
+* Test - Barnes-Hut gravity simulation             *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "NBodySystem.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "types.h"
+
+// A random cloud with a dense core, in units where G = 1
+static void addCloud(lys3d::NBodySystem *system, uint32_t count, uint32_t seed) {
+    for (uint32_t i = 0; i < count; ++i) {
+        double p[4];
+        for (int k = 0; k < 4; ++k) {
+            seed = seed * 1664525u + 1013904223u;
+            p[k] = (seed >> 8) / 16777216.0;
+        }
+        double r = p[3] * p[3] * 10.0, cos_t = 2.0 * p[0] - 1.0, sin_t = sqrt(1.0 - cos_t * cos_t);
+        double phi = p[1] * 6.283185307179586;
+        system->add(lys3d::Point3Dd(r * sin_t * cos(phi), r * sin_t * sin(phi), r * cos_t),
+                    lys3d::Point3Dd(), 0.5 + p[2]);
+    }
+}
+
+// Relative errors of the octree's accelerations against direct summation
+static void compare(lys3d::NBodySystem *system, double *rms, double *worst) {
+    lys3d::Vector<lys3d::Point3Dd> exact(system->size());
+    system->computeAccelerations();
+    system->directAccelerations(exact.data());
+    double sum = 0.0;
+    *worst = 0.0;
+    for (uint32_t i = 0; i < system->size(); ++i) {
+        double error = (system->acceleration(i) - exact[i]).length() / exact[i].length();
+        sum += error * error;
+        *worst = std::max(*worst, error);
+    }
+    *rms = sqrt(sum / system->size());
+}
+
+int main(void) {
+    lys3d::NBodySettings settings;
+    settings.gravity = 1.0;
+    settings.workers = 0;
+
+    printf("- NBodySystem: Bodies\n");
+    {
+        lys3d::NBodySettings odd = settings;
+        odd.leafSize = 1000;
+        lys3d::NBodySystem system(odd);
+        assert(system.settings().leafSize == 64);
+        assert(system.add(lys3d::Point3Dd(1.0, 2.0, 3.0), lys3d::Point3Dd(0.0, 1.0, 0.0), 5.0) == 0);
+        assert(system.add(lys3d::Point3Dd(), lys3d::Point3Dd(), 1.0) == 1);
+        assert(system.size() == 2);
+        assert(system.position(0) == lys3d::Point3Dd(1.0, 2.0, 3.0));
+        assert(system.velocity(0) == lys3d::Point3Dd(0.0, 1.0, 0.0));
+        assert(system.mass(0) == 5.0);
+        system.step(0.0);  // Empty steps and coincident bodies stay finite
+        system.position(1, lys3d::Point3Dd(1.0, 2.0, 3.0));
+        system.computeAccelerations();
+        assert(system.acceleration(0) == lys3d::Point3Dd());
+        system.clear();
+        assert(system.size() == 0);
+        system.step(1.0);
+        assert(system.stats().bodies == 0);
+    }
+
+    printf("- NBodySystem: Two bodies\n");
+    {
+        lys3d::NBodySystem system(settings);
+        system.add(lys3d::Point3Dd(0.0, 0.0, 0.0), lys3d::Point3Dd(), 4.0);
+        system.add(lys3d::Point3Dd(2.0, 0.0, 0.0), lys3d::Point3Dd(), 0.0);
+        system.computeAccelerations();
+        // The test particle feels GM / r^2, and doesn't pull back
+        assert(fabs(system.acceleration(1).x() + 1.0) < 1e-12);
+        assert(system.acceleration(0) == lys3d::Point3Dd());
+    }
+
+    printf("- NBodySystem: Exact with theta 0\n");
+    {
+        lys3d::NBodySettings exact = settings;
+        exact.theta = 0.0;
+        lys3d::NBodySystem system(exact);
+        addCloud(&system, 700, 1);
+        double rms, worst;
+        compare(&system, &rms, &worst);
+        assert(worst < 1e-10);
+        assert(system.stats().interactions == 700ull * 700ull);
+    }
+
+    printf("- NBodySystem: Accuracy against direct summation\n");
+    {
+        lys3d::NBodySystem system(settings);
+        addCloud(&system, 5000, 2);
+        double rms, worst;
+        compare(&system, &rms, &worst);
+        printf("  theta 0.5: %.2e RMS, %.2e worst, %.0f interactions per body\n", rms, worst,
+               static_cast<double>(system.stats().interactions) / system.size());
+        assert(rms < 2e-3);
+        assert(worst < 2e-2);
+        assert(system.stats().interactions < 5000ull * 5000ull / 2);
+        assert(system.stats().leaves > 5000 / settings.leafSize);
+    }
+
+    printf("- NBodySystem: Worker threads\n");
+    {
+        lys3d::NBodySettings threaded = settings;
+        threaded.workers = 3;
+        lys3d::NBodySystem serial(settings), parallel(threaded);
+        addCloud(&serial, 3000, 3);
+        addCloud(&parallel, 3000, 3);
+        for (int i = 0; i < 5; ++i) {
+            serial.step(0.01);
+            parallel.step(0.01);
+        }
+        // The same lists are summed in the same order whichever thread does it
+        for (uint32_t i = 0; i < serial.size(); ++i) {
+            assert(serial.position(i) == parallel.position(i));
+            assert(serial.velocity(i) == parallel.velocity(i));
+        }
+        assert(serial.energy() == parallel.energy());
+    }
+
+    printf("- NBodySystem: Long-term stability\n");
+    {
+        // An eccentric orbit around a heavy body, 100 times around
+        lys3d::NBodySystem system(settings);
+        system.add(lys3d::Point3Dd(), lys3d::Point3Dd(), 1000.0);
+        system.add(lys3d::Point3Dd(10.0, 0.0, 0.0), lys3d::Point3Dd(0.0, 12.0, 0.0), 1.0);
+        system.add(lys3d::Point3Dd(0.0, 0.0, 30.0), lys3d::Point3Dd(5.7, 0.0, 0.0), 0.001);
+        double start = system.energy(), worst = 0.0, closest = 1e30;
+        double semi_major = 1.0 / (2.0 / 10.0 - 144.0 / 1001.0);
+        double period = 6.283185307179586 * sqrt(semi_major * semi_major * semi_major / 1001.0);
+        int steps = 100 * 400;
+        for (int i = 0; i < steps; ++i) {
+            system.step(period / 400.0);
+            if (i % 100 == 0)
+                worst = std::max(worst, fabs(system.energy() / start - 1.0));
+            closest = std::min(closest, (system.position(1) - system.position(0)).length());
+        }
+        printf("  energy drift %.2e over %d steps\n", worst, steps);
+        assert(worst < 1e-3);
+        // Still bound, and not spiralling in: it started at the pericenter
+        assert((system.position(1) - system.position(0)).length() < 2.0 * semi_major);
+        assert(closest > 9.5);
+    }
+
+    printf("- NBodySystem: Softening\n");
+    {
+        lys3d::NBodySettings soft = settings;
+        soft.softening = 1.0;
+        lys3d::NBodySystem system(soft);
+        system.add(lys3d::Point3Dd(), lys3d::Point3Dd(), 1.0);
+        system.add(lys3d::Point3Dd(0.0, 1e-9, 0.0), lys3d::Point3Dd(), 1.0);
+        system.computeAccelerations();
+        assert(system.acceleration(0).length() < 1e-8);
+        // -G m1 m2 / sqrt(r^2 + eps^2), without each body's pull on itself
+        assert(fabs(system.energy() + 1.0) < 1e-9);
+    }
+    return 0;
+}
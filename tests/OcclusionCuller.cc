@@ -0,0 +1,117 @@
+/***************************************************
+* Test - CPU occlusion culling                     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "OcclusionCuller.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+
+// A GL-style projection for a camera at the origin looking down -Z
+static void perspective(float fov_y, float aspect, float z_near, float z_far, float out[16]) {
+    float f = 1.0f / tanf(fov_y * 0.5f);
+    memset(out, 0, 16 * sizeof(float));
+    out[0] = f / aspect;
+    out[5] = f;
+    out[10] = (z_far + z_near) / (z_near - z_far);
+    out[11] = -1.0f;
+    out[14] = 2.0f * z_far * z_near / (z_near - z_far);
+}
+
+static lys3d::Box3Df box(float x, float y, float z, float half) {
+    return lys3d::Box3Df::fromCenter(lys3d::Point3Df(x, y, z), lys3d::Point3Df(half, half, half));
+}
+
+// A wall 10 units in front of the camera, as a box and as a mesh
+static void addWall(lys3d::OcclusionCuller *culler, bool as_mesh) {
+    if (!as_mesh) {
+        culler->addOccluder(lys3d::Box3Df(lys3d::Point3Df(-4.0f, -4.0f, -11.0f), lys3d::Point3Df(4.0f, 4.0f, -10.0f)));
+        return;
+    }
+    const float positions[12] = {-4.0f, -4.0f, 0.0f, 4.0f, -4.0f, 0.0f, 4.0f, 4.0f, 0.0f, -4.0f, 4.0f, 0.0f};
+    const uint16_t indices[6] = {0, 1, 2, 0, 2, 3};
+    float model[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, -10.0f, 1};
+    culler->addOccluder(positions, 4, indices, 6, model);
+}
+
+int main(void) {
+    float projection[16];
+    perspective(1.0f, 2.0f, 0.5f, 200.0f, projection);
+
+    for (int workers = 0; workers <= 3; workers += 3) {
+        for (int as_mesh = 0; as_mesh < 2; ++as_mesh) {
+            printf("- OcclusionCuller: %s occluder, %d workers\n", as_mesh ? "Mesh" : "Box", workers);
+            lys3d::OcclusionCuller culler(lys3d::Dimension2Di32(250, 125), workers);
+            assert(culler.resolution().width() == 256 && culler.resolution().height() == 128);
+            culler.beginFrame(projection);
+            addWall(&culler, as_mesh != 0);
+            culler.rasterize();
+            assert(culler.stats().occluders == 1);
+
+            // The wall's depth fills the middle of the buffer
+            const float *depth = culler.depth();
+            assert(depth[64 * 256 + 128] < 1.0f);
+            assert(depth[0] == 1.0f);
+
+            assert(!culler.isVisible(box(0.0f, 0.0f, -20.0f, 1.0f)));    // Behind the wall
+            assert(!culler.isVisible(box(2.0f, -2.0f, -50.0f, 3.0f)));
+            assert(culler.isVisible(box(0.0f, 0.0f, -5.0f, 1.0f)));      // In front of it
+            assert(culler.isVisible(box(10.0f, 0.0f, -20.0f, 1.0f)));    // Beside it
+            assert(culler.isVisible(box(0.0f, 0.0f, -20.0f, 6.0f)));     // Larger than it
+            assert(culler.isVisible(box(0.0f, 0.0f, 0.0f, 1.0f)));       // Around the camera
+            assert(!culler.isVisible(box(0.0f, 0.0f, 20.0f, 1.0f)));     // Behind the camera
+            assert(!culler.isVisible(box(100.0f, 0.0f, -20.0f, 1.0f)));  // Off screen
+            assert(culler.stats().tested == 8 && culler.stats().culled == 4);
+            assert(culler.stats().culledPercent() == 50.0f);
+
+            lys3d::Box3Df boxes[3] = {box(0.0f, 0.0f, -20.0f, 1.0f), box(0.0f, 0.0f, -5.0f, 1.0f),
+                                      box(8.5f, 0.0f, -20.0f, 1.0f)};
+            uint8_t visible[3];
+            assert(culler.cull(boxes, 3, visible) == 2);
+            assert(visible[0] == 0 && visible[1] == 1 && visible[2] == 1);  // Peeks past the edge
+        }
+    }
+
+    printf("- OcclusionCuller: Backfaces and toggling\n");
+    lys3d::OcclusionCuller culler;
+    culler.beginFrame(projection);
+    const float positions[9] = {-4.0f, -4.0f, -10.0f, 4.0f, 4.0f, -10.0f, 4.0f, -4.0f, -10.0f};
+    const uint16_t indices[3] = {0, 1, 2};
+    culler.addOccluder(positions, 3, indices, 3);
+    culler.rasterize();
+    assert(culler.stats().triangles == 0);
+    assert(culler.isVisible(box(1.0f, -1.0f, -20.0f, 0.5f)));
+
+    culler.beginFrame(projection);
+    addWall(&culler, false);
+    culler.rasterize();
+    assert(!culler.isVisible(box(0.0f, 0.0f, -20.0f, 1.0f)));
+    culler.enable(false);
+    assert(!culler.isEnabled());
+    culler.beginFrame(projection);
+    addWall(&culler, false);
+    culler.rasterize();
+    assert(culler.isVisible(box(0.0f, 0.0f, -20.0f, 1.0f)));
+    assert(culler.stats().tested == 0 && culler.stats().occluders == 0);
+    culler.enable();
+
+    printf("- OcclusionCuller: Near plane clipping\n");
+    // A floor running from behind the camera into the distance hides what's under it
+    culler.beginFrame(projection);
+    culler.addOccluder(lys3d::Box3Df(lys3d::Point3Df(-50.0f, -3.0f, -100.0f), lys3d::Point3Df(50.0f, -2.0f, 10.0f)));
+    culler.rasterize();
+    assert(culler.stats().triangles > 0);
+    assert(!culler.isVisible(box(0.0f, -5.0f, -20.0f, 1.0f)));
+    assert(culler.isVisible(box(0.0f, 0.0f, -20.0f, 1.0f)));
+    return 0;
+}
@@ -0,0 +1,124 @@
+/***************************************************
+* Test - TLSF offset allocator                     *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "OffsetAllocator.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "types.h"
+
+using lys3d::OffsetAllocation;
+using lys3d::OffsetAllocator;
+
+// No two live ranges may overlap or leave the space
+static bool disjoint(const lys3d::Vector<OffsetAllocation> &live, uint32_t size) {
+    lys3d::Vector<uint8_t> used(size, 0);
+    for (const OffsetAllocation &a : live) {
+        if (a.offset + a.size > size)
+            return false;
+        for (uint32_t i = a.offset; i < a.offset + a.size; ++i) {
+            if (used[i])
+                return false;
+            used[i] = 1;
+        }
+    }
+    return true;
+}
+
+int main(void) {
+    printf("- OffsetAllocator: Basic allocation\n");
+    OffsetAllocator allocator(1024, 16);
+    assert(allocator.freeSize() == 1024);
+    assert(allocator.largestFree() == 1024);
+    assert(allocator.fragmentation() == 0.0f);
+    OffsetAllocation a = allocator.allocate(100);
+    OffsetAllocation b = allocator.allocate(200);
+    OffsetAllocation c = allocator.allocate(3);
+    assert(a.isValid() && b.isValid() && c.isValid());
+    assert(a.size == 100 && b.size == 200 && c.size == 3);
+    assert(allocator.freeSize() == 1024 - 303);
+    assert(allocator.allocationCount() == 3);
+    assert(disjoint({a, b, c}, 1024));
+    assert(!allocator.allocate(0).isValid());
+    assert(!allocator.allocate(2000).isValid());
+
+    printf("- OffsetAllocator: Coalescing\n");
+    allocator.free(b);
+    assert(allocator.fragmentation() > 0.0f);
+    allocator.free(a);
+    allocator.free(c);
+    assert(allocator.allocationCount() == 0);
+    assert(allocator.freeSize() == 1024);
+    assert(allocator.largestFree() == 1024);  // Everything merged back into one range
+    OffsetAllocation whole = allocator.allocate(1024);
+    assert(whole.isValid() && whole.offset == 0);
+    assert(allocator.freeSize() == 0);
+    assert(!allocator.allocate(1).isValid());
+    allocator.free(whole);
+
+    printf("- OffsetAllocator: Sliding down\n");
+    a = allocator.allocate(100);
+    b = allocator.allocate(100);
+    c = allocator.allocate(100);
+    allocator.free(a);
+    OffsetAllocation slid = allocator.slideDown(b);
+    assert(slid.offset == 0 && slid.size == 100 && slid.node == b.node);
+    assert(allocator.slideDown(slid).offset == 0);  // Nothing free before it
+    assert(allocator.freeSize() == 1024 - 200);
+    allocator.free(slid);
+    c = allocator.slideDown(c);
+    assert(c.offset == 0);
+    assert(allocator.largestFree() == 1024 - 100);  // The holes merged behind it
+    allocator.free(c);
+    assert(allocator.largestFree() == 1024);
+
+    printf("- OffsetAllocator: Allocation limit\n");
+    lys3d::Vector<OffsetAllocation> live;
+    for (int i = 0; i < 16; ++i)
+        live.push_back(allocator.allocate(10));
+    assert(!allocator.allocate(10).isValid());
+    for (const OffsetAllocation &allocation : live)
+        allocator.free(allocation);
+    live.clear();
+
+    printf("- OffsetAllocator: Churn\n");
+    OffsetAllocator churn(1 << 20, 4096);
+    srand(1234);
+    uint32_t failures = 0;
+    for (int step = 0; step < 20000; ++step) {
+        if (!live.empty() && (rand() % 2 == 0 || live.size() == 4096)) {
+            size_t index = static_cast<size_t>(rand()) % live.size();
+            churn.free(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        } else {
+            OffsetAllocation allocation = churn.allocate(1 + static_cast<uint32_t>(rand() % 2000));
+            if (allocation.isValid())
+                live.push_back(allocation);
+            else
+                ++failures;
+        }
+    }
+    assert(failures == 0);
+    assert(disjoint(live, 1 << 20));
+    uint32_t used = 0;
+    for (const OffsetAllocation &allocation : live)
+        used += allocation.size;
+    assert(churn.freeSize() == (1u << 20) - used);
+    for (const OffsetAllocation &allocation : live)
+        churn.free(allocation);
+    assert(churn.freeSize() == 1u << 20 && churn.largestFree() == 1u << 20);
+
+    churn.reset();
+    assert(churn.allocationCount() == 0 && churn.largestFree() == 1u << 20);
+    return 0;
+}
@@ -0,0 +1,161 @@
+/***************************************************
+* Test - Planet terrain quadtree and chunk cache   *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "PlanetTerrain.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "types.h"
+
+static std::atomic<uint32_t> samples(0);
+
+static double flatHeight(void *user_data, const double direction[3]) {
+    (void)direction;
+    ++samples;
+    return *static_cast<const double*>(user_data);
+}
+
+// A GL-style projection for a camera looking down -Z
+static void perspective(float fov_y, float aspect, float z_near, float z_far, float out[16]) {
+    float f = 1.0f / tanf(fov_y * 0.5f);
+    memset(out, 0, 16 * sizeof(float));
+    out[0] = f / aspect;
+    out[5] = f;
+    out[10] = (z_far + z_near) / (z_near - z_far);
+    out[11] = -1.0f;
+    out[14] = 2.0f * z_far * z_near / (z_near - z_far);
+}
+
+// Plan until every wanted chunk is resident (everything is built and
+// uploaded in plan() without workers, or after finish() with them)
+static uint32_t settle(lys3d::PlanetTerrain *terrain, const lys3d::Point3Dd &camera,
+                       const float *view_projection = nullptr) {
+    uint32_t frames = 0;
+    do {
+        terrain->finish();
+        terrain->plan(camera, view_projection);
+        assert(terrain->stats().uploads <= terrain->settings().uploadsPerFrame);
+        assert(terrain->stats().pending <= terrain->settings().maxPending);
+        ++frames;
+    } while ((terrain->stats().pending > 0 || terrain->stats().uploads > 0) && frames < 1000);
+    assert(frames < 1000);
+    return frames;
+}
+
+int main(void) {
+    lys3d::PlanetSettings settings;
+    settings.radius = 1.0e6;
+    settings.maxHeight = 2000.0;
+    settings.workers = 0;
+    settings.cacheSize = 1024;
+    double height = 0.0;
+
+    printf("- PlanetTerrain: Settings\n");
+    {
+        lys3d::PlanetSettings odd = settings;
+        odd.chunkSize = 1000;
+        lys3d::PlanetTerrain terrain(odd);
+        assert(terrain.settings().chunkSize == 129);
+        assert(terrain.layout().stride() == 20);
+        assert(terrain.threshold() == 2.0f);
+    }
+
+    printf("- PlanetTerrain: From orbit\n");
+    lys3d::PlanetTerrain terrain(settings);
+    terrain.heightSource(&flatHeight, &height);
+    lys3d::Point3Dd orbit(0.0, 0.0, 4.0e6);
+    terrain.plan(orbit);
+    assert(terrain.visible().empty());  // Nothing is built yet
+    assert(terrain.stats().pending >= 6);
+    settle(&terrain, orbit);
+    const lys3d::Vector<lys3d::PlanetChunk> &visible = terrain.visible();
+    assert(!visible.empty());
+    uint32_t orbit_chunks = terrain.stats().chunksDrawn;
+    assert(orbit_chunks == visible.size());
+    assert(terrain.stats().deepestLevel <= 3);
+    assert(samples.load() > 0);
+    // Offsets are relative to the camera: the near face's chunks sit
+    // around 3000 km below it
+    for (const lys3d::PlanetChunk &chunk : visible) {
+        if (chunk.face == 4)
+            assert(chunk.offset[2] < -3.0e6f && chunk.offset[2] > -3.2e6f);
+    }
+
+    printf("- PlanetTerrain: Down to the surface\n");
+    lys3d::Point3Dd ground(0.0, 0.0, settings.radius + 50.0);
+    settle(&terrain, ground);
+    uint32_t ground_chunks = terrain.stats().chunksDrawn;
+    assert(terrain.stats().deepestLevel >= 12);
+    assert(ground_chunks > orbit_chunks);
+    // Only the (never culled) coarsest chunks of the far side are drawn
+    for (const lys3d::PlanetChunk &chunk : terrain.visible())
+        assert(chunk.face != 5 || chunk.level < 2);
+    assert(terrain.stats().resident <= settings.cacheSize);
+    uint32_t ground_nodes = terrain.stats().nodes, ground_level = terrain.stats().deepestLevel;
+
+    printf("- PlanetTerrain: Back to orbit\n");
+    settle(&terrain, orbit);
+    assert(terrain.stats().chunksDrawn == orbit_chunks);
+    assert(terrain.stats().nodes < ground_nodes);
+
+    printf("- PlanetTerrain: View culling\n");
+    // Turned around to look away from the planet
+    float away[16];
+    perspective(1.0f, 1.0f, 1.0f, 1.0e8f, away);
+    for (int i = 0; i < 4; ++i) {
+        away[i] = -away[i];
+        away[8 + i] = -away[8 + i];
+    }
+    terrain.plan(orbit, away);
+    assert(terrain.visible().empty());
+
+    printf("- PlanetTerrain: Worker threads\n");
+    lys3d::PlanetSettings threaded = settings;
+    threaded.workers = 3;
+    lys3d::PlanetTerrain parallel(threaded);
+    parallel.heightSource(&flatHeight, &height);
+    settle(&parallel, ground);
+    assert(parallel.stats().chunksDrawn == ground_chunks);
+    assert(parallel.stats().deepestLevel == ground_level);
+
+    printf("- PlanetTerrain: Small cache\n");
+    lys3d::PlanetSettings small = settings;
+    small.cacheSize = 40;
+    lys3d::PlanetTerrain cramped(small);
+    cramped.heightSource(&flatHeight, &height);
+    // Detail stops where the cache runs out, instead of building meshes
+    // with nowhere to go
+    settle(&cramped, ground);
+    assert(cramped.stats().resident <= 40);
+    assert(cramped.stats().cacheMisses > 0);
+    assert(!cramped.visible().empty());
+    assert(cramped.stats().deepestLevel < ground_level);
+
+    printf("- PlanetTerrain: Noise heights\n");
+    lys3d::PlanetNoise noise;
+    double direction[3] = {0.6, 0.0, 0.8}, lowest = 1e30, highest = -1e30;
+    for (int i = 0; i < 1000; ++i) {
+        double angle = i * 0.0063;
+        double d[3] = {cos(angle) * direction[0], sin(angle), cos(angle) * direction[2]};
+        double h = lys3d::PlanetTerrain::noiseHeight(&noise, d);
+        lowest = std::min(lowest, h);
+        highest = std::max(highest, h);
+        assert(fabs(h) < 2.0 * noise.amplitude);
+    }
+    assert(highest - lowest > noise.amplitude * 0.2);
+    assert(lys3d::PlanetTerrain::noiseHeight(&noise, direction) == lys3d::PlanetTerrain::noiseHeight(&noise, direction));
+    return 0;
+}
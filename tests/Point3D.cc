@@ -0,0 +1,57 @@
+/***************************************************
+* Test - Point3D                                   *
+* Copyright (C) 2021 Zach Caldwell                 *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Point3D.h"
+#include "Box3D.h"
+
+#include <assert.h>
+
+int main(void) {
+    // Default constructor
+    lys3d::Point3Di pointDefault;
+    assert(0 == pointDefault.x());
+    assert(0 == pointDefault.y());
+    assert(0 == pointDefault.z());
+
+    // Parameterized constructor
+    lys3d::Point3Di pointParams(2, 3, 4);
+    assert(2 == pointParams.x());
+    assert(3 == pointParams.y());
+    assert(4 == pointParams.z());
+
+    // Setters & Getters
+    pointDefault.x(3);
+    pointDefault.y(5);
+    pointDefault.z(7);
+    assert(3 == pointDefault.x());
+    assert(5 == pointDefault.y());
+    assert(7 == pointDefault.z());
+
+    // Mathematical operators
+    lys3d::Point3Di pointSubtract = pointDefault - pointParams;
+    assert(pointSubtract == lys3d::Point3Di(1, 2, 3));
+    assert(pointSubtract + pointParams == pointDefault);
+    assert(pointSubtract * 2 == lys3d::Point3Di(2, 4, 6));
+    assert(pointSubtract.dot(pointParams) == 20);
+    assert(lys3d::Point3Di(1, 0, 0).cross(lys3d::Point3Di(0, 1, 0)) == lys3d::Point3Di(0, 0, 1));
+    assert(lys3d::Point3Dd(2.0, 3.0, 6.0).length() == 7.0);
+
+    // Boxes
+    lys3d::Box3Df box(lys3d::Point3Df(0, 0, 0), lys3d::Point3Df(2, 2, 2));
+    assert(box.center() == lys3d::Point3Df(1, 1, 1));
+    assert(box.contains(lys3d::Point3Df(2, 1, 0)));
+    assert(!box.contains(lys3d::Point3Df(3, 1, 0)));
+    assert(box.intersects(lys3d::Box3Df(lys3d::Point3Df(2, 2, 2), lys3d::Point3Df(3, 3, 3))));
+    assert(!box.intersects(lys3d::Box3Df(lys3d::Point3Df(2.5f, 0, 0), lys3d::Point3Df(3, 3, 3))));
+    box.expand(lys3d::Point3Df(-1, 4, 1));
+    assert(box.min() == lys3d::Point3Df(-1, 0, 0) && box.max() == lys3d::Point3Df(2, 4, 2));
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/***************************************************
+* Test - Post-processing passes and permutations   *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "PostProcess.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+
+int main(void) {
+    // Only declaring and compiling the passes; nothing here needs GL
+    lys3d::FrameGraph graph;
+    lys3d::PostProcess post;
+
+    printf("- PostProcess: Permutations\n");
+    assert(lys3d::PostProcess::defines(0).empty());
+    lys3d::String all = lys3d::PostProcess::defines(lys3d::kPostAllEffects);
+    assert(strstr(all.c_str(), "#define BLOOM") && strstr(all.c_str(), "#define TONEMAP"));
+    assert(strstr(all.c_str(), "#define COLOR_GRADE") && strstr(all.c_str(), "#define VIGNETTE"));
+    lys3d::String vignette = lys3d::PostProcess::defines(lys3d::kPostVignette);
+    assert(vignette == "#define VIGNETTE 1\n");
+    assert(lys3d::PostProcess::passCount(lys3d::kPostAllEffects) == 4);
+    assert(lys3d::PostProcess::passCount(lys3d::kPostTonemap | lys3d::kPostVignette) == 1);
+
+    printf("- PostProcess: Bloom chain\n");
+    graph.reset(lys3d::Dimension2Di32(1280, 720));
+    lys3d::FrameTargetDesc desc;
+    lys3d::FrameResource scene = graph.create(desc);
+    uint32_t scene_pass = graph.addPass("Scene", nullptr);
+    graph.write(scene_pass, scene);
+    uint32_t last = post.addPasses(graph, scene, graph.backbuffer());
+    bool ok = graph.compile();
+    assert(ok);
+    (void)ok;
+    assert(graph.stats().passes == 5);
+    assert(graph.stats().culledPasses == 0);
+    assert(last == 4);
+    assert(graph.discardMask(scene_pass) == 0);
+    // Scene, half and quarter resolution; nothing at full size but the scene
+    assert(graph.stats().resources == 3);
+    assert(graph.stats().targets == 3);
+    uint64_t full = 1280 * 720 * 4;
+    assert(graph.stats().targetBytes == full + full / 4 + full / 16);
+    // Rendering the scene alone would have needed just one full-size target
+    assert(graph.stats().targetBytes < full * 2);
+
+    printf("- PostProcess: Without bloom\n");
+    lys3d::PostSettings settings = post.settings();
+    settings.effects = lys3d::kPostTonemap | lys3d::kPostColorGrade;
+    post.settings(settings);
+    graph.reset(lys3d::Dimension2Di32(1280, 720));
+    scene = graph.create(desc);
+    scene_pass = graph.addPass("Scene", nullptr);
+    graph.write(scene_pass, scene);
+    last = post.addPasses(graph, scene, graph.backbuffer());
+    ok = graph.compile();
+    assert(ok);
+    assert(graph.stats().passes == 2);
+    assert(graph.stats().resources == 1);
+    assert(last == 1);
+
+    printf("- PostProcess: Unused output is culled\n");
+    graph.reset(lys3d::Dimension2Di32(1280, 720));
+    scene = graph.create(desc);
+    lys3d::FrameResource offscreen = graph.create(desc);
+    scene_pass = graph.addPass("Scene", nullptr);
+    graph.write(scene_pass, scene);
+    post.addPasses(graph, scene, offscreen);
+    ok = graph.compile();
+    assert(ok);
+    assert(graph.stats().culledPasses == 2);
+    return 0;
+}
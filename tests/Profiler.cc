@@ -0,0 +1,146 @@
+/***************************************************
+* Test - Hierarchical CPU zones & counters         *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Profiler.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include "types.h"
+
+LYS_PROFILER_COUNT_ALLOCATIONS()
+
+static lys3d::Vector<int>* volatile allocated = nullptr;
+
+static void spin(int microseconds) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(microseconds);
+    while (std::chrono::steady_clock::now() < end) {}
+}
+
+static void inner() {
+    LYS_PROFILE_ZONE("Inner");
+    spin(500);
+}
+
+static void outer() {
+    LYS_PROFILE_ZONE("Outer");
+    spin(500);
+    inner();
+    inner();
+}
+
+static const lys3d::ProfilerZoneStats* findZone(const lys3d::Vector<lys3d::ProfilerZoneStats> &zones,
+                                                const char *name) {
+    for (const lys3d::ProfilerZoneStats &zone : zones) {
+        if (strcmp(zone.name, name) == 0)
+            return &zone;
+    }
+    return nullptr;
+}
+
+int main(void) {
+    lys3d::Profiler &profiler = lys3d::Profiler::global();
+    lys3d::Vector<lys3d::ProfilerZoneStats> zones;
+
+    // Nothing is recorded while disabled
+    printf("- Profiler: Disabled\n");
+    assert(!profiler.isEnabled());
+    profiler.beginFrame();
+    outer();
+    profiler.endFrame();
+    profiler.topZones(10, &zones);
+    assert(zones.empty());
+
+    // Nested zones
+    printf("- Profiler: Zone hierarchy\n");
+    profiler.enable();
+    profiler.beginFrame();
+    outer();
+    profiler.endFrame();
+    profiler.topZones(10, &zones);
+    assert(zones.size() == 2);
+    assert(strcmp(zones[0].name, "Outer") == 0);
+    const lys3d::ProfilerZoneStats *outer_stats = findZone(zones, "Outer");
+    const lys3d::ProfilerZoneStats *inner_stats = findZone(zones, "Inner");
+    assert(outer_stats->depth == 0 && outer_stats->calls == 1);
+    assert(inner_stats->depth == 1 && inner_stats->calls == 2);
+    assert(outer_stats->totalMs >= 1.5f);
+    assert(inner_stats->totalMs >= 1.0f);
+    assert(outer_stats->selfMs < outer_stats->totalMs - inner_stats->totalMs + 0.01f);
+    profiler.topZones(1, &zones);
+    assert(zones.size() == 1);
+
+    // The same zone at the root of another thread is a separate node
+    printf("- Profiler: Threads\n");
+    profiler.beginFrame();
+    std::thread worker(inner);
+    worker.join();
+    outer();
+    profiler.endFrame();
+    profiler.topZones(10, &zones);
+    assert(zones.size() == 3);
+
+    // Each thread records on its own; the frame merges matching zones
+    profiler.beginFrame();
+    std::thread workers[4];
+    for (std::thread &thread : workers)
+        thread = std::thread(outer);
+    for (std::thread &thread : workers)
+        thread.join();
+    profiler.endFrame();
+    profiler.topZones(10, &zones);
+    assert(zones.size() == 2);
+    assert(findZone(zones, "Outer")->calls == 4);
+    assert(findZone(zones, "Inner")->calls == 8 && findZone(zones, "Inner")->depth == 1);
+
+    // Counters and gauges
+    printf("- Profiler: Counters\n");
+    uint32_t culled = profiler.counter("Culled objects");
+    uint32_t resident = profiler.counter("Resident bytes", false);
+    assert(culled >= lys3d::kCounterBuiltinCount && resident == culled + 1);
+    assert(profiler.counter("Culled objects") == culled);
+    assert(profiler.counterCount() == lys3d::kCounterBuiltinCount + 2);
+    assert(strcmp(profiler.counterName(resident), "Resident bytes") == 0);
+    profiler.beginFrame();
+    profiler.count(lys3d::kCounterDrawCalls, 3);
+    profiler.count(culled, 10);
+    profiler.count(culled);
+    profiler.set(resident, 4096);
+    allocated = new lys3d::Vector<int>(100);
+    delete allocated;
+    profiler.endFrame();
+    assert(profiler.counterValue(lys3d::kCounterDrawCalls) == 3);
+    assert(profiler.counterValue(culled) == 11);
+    assert(profiler.counterValue(resident) == 4096);
+    assert(profiler.counterValue(lys3d::kCounterAllocations) >= 2);
+
+    // Per-frame counters reset, gauges don't
+    profiler.beginFrame();
+    profiler.endFrame();
+    assert(profiler.counterValue(culled) == 0);
+    assert(profiler.counterValue(resident) == 4096);
+
+    // Frame time history
+    printf("- Profiler: Frame times\n");
+    lys3d::Vector<float> times;
+    profiler.frameTimes(&times);
+    assert(!times.empty());
+    for (uint32_t i = 0; i < lys3d::Profiler::kHistoryLength + 10; ++i)
+        profiler.beginFrame();
+    profiler.frameTimes(&times);
+    assert(times.size() == lys3d::Profiler::kHistoryLength);
+    assert(profiler.frameTime() >= 0.0f);
+
+    profiler.enable(false);
+    return 0;
+}
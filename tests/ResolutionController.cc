@@ -0,0 +1,77 @@
+/***************************************************
+* Test - Dynamic resolution controller             *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "ResolutionController.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "types.h"
+
+// Runs frames whose cost grows with the rendered pixel count
+static float run(lys3d::ResolutionController *controller, float full_res_ms, int frames) {
+    float frame_ms = 0.0f;
+    for (int i = 0; i < frames; ++i) {
+        float scale = controller->scale();
+        frame_ms = 1.0f + full_res_ms * scale * scale;
+        controller->update(frame_ms);
+    }
+    return frame_ms;
+}
+
+int main(void) {
+    lys3d::DynamicResolutionSettings settings;
+    settings.targetFrameMs = 16.0f;
+    settings.minScale = 0.5f;
+    settings.maxScale = 1.0f;
+    lys3d::ResolutionController controller(settings);
+    float budget = settings.targetFrameMs * settings.headroom;
+
+    printf("- ResolutionController: Light load stays at full resolution\n");
+    assert(controller.scale() == 1.0f);
+    run(&controller, 8.0f, 200);
+    assert(controller.scale() == 1.0f);
+
+    printf("- ResolutionController: Heavy load scales down under the target\n");
+    float frame_ms = run(&controller, 30.0f, 20);
+    assert(controller.scale() < 0.8f);
+    frame_ms = run(&controller, 30.0f, 300);
+    assert(frame_ms <= settings.targetFrameMs);
+    assert(frame_ms > budget * 0.7f);  // Not needlessly low either
+
+    printf("- ResolutionController: No oscillation at a steady load\n");
+    float settled = controller.scale();
+    for (int i = 0; i < 300; ++i) {
+        run(&controller, 30.0f, 1);
+        assert(controller.scale() >= settled - 0.06f && controller.scale() <= settled + 0.06f);
+    }
+
+    printf("- ResolutionController: Scales back up when the load drops\n");
+    run(&controller, 8.0f, 30);
+    assert(controller.scale() < 1.0f);  // Waits before growing
+    run(&controller, 8.0f, 600);
+    assert(controller.scale() == 1.0f);
+
+    printf("- ResolutionController: A single hitch costs little\n");
+    run(&controller, 8.0f, 100);
+    controller.update(200.0f);
+    assert(controller.scale() > 0.8f);
+
+    printf("- ResolutionController: Limits\n");
+    run(&controller, 500.0f, 100);
+    assert(controller.scale() == settings.minScale);
+    settings.minScale = 0.75f;
+    controller.settings(settings);
+    assert(controller.scale() == 0.75f);
+    controller.reset();
+    assert(controller.scale() == 1.0f);
+    assert(controller.smoothedFrameMs() == 0.0f);
+    return 0;
+}
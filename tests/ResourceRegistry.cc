@@ -0,0 +1,83 @@
+/***************************************************
+* Test - GPU resource accounting & eviction        *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "ResourceRegistry.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "types.h"
+
+using lys3d::GpuResourceType;
+
+struct Owner {
+    lys3d::ResourceRegistry *registry;
+    lys3d::Vector<uint32_t> evicted;
+};
+
+static void evict(void *user_data, GpuResourceType type, uint32_t name) {
+    Owner *owner = static_cast<Owner*>(user_data);
+    owner->evicted.push_back(name);
+    owner->registry->release(type, name);
+}
+
+int main(void) {
+    // No GL context here, so released objects are dropped instead of deleted
+    lys3d::ResourceRegistry registry;
+    Owner owner;
+    owner.registry = &registry;
+
+    printf("- ResourceRegistry: Tracking\n");
+    registry.track(GpuResourceType::kTexture, 1, 100);
+    registry.track(GpuResourceType::kTexture, 2, 200);
+    registry.track(GpuResourceType::kBuffer, 1, 50);
+    registry.track(GpuResourceType::kTexture, 0, 1000);  // Not an object
+    assert(registry.stats(GpuResourceType::kTexture).count == 2);
+    assert(registry.stats(GpuResourceType::kTexture).bytes == 300);
+    assert(registry.stats(GpuResourceType::kBuffer).bytes == 50);
+    registry.track(GpuResourceType::kBuffer, 1, 80);  // Resized
+    assert(registry.stats(GpuResourceType::kBuffer).count == 1);
+    assert(registry.stats(GpuResourceType::kBuffer).bytes == 80);
+
+    printf("- ResourceRegistry: Deferred deletes\n");
+    registry.release(GpuResourceType::kBuffer, 1);
+    assert(registry.stats(GpuResourceType::kBuffer).count == 0);
+    assert(registry.stats(GpuResourceType::kBuffer).bytes == 0);
+    assert(registry.stats(GpuResourceType::kBuffer).pendingDeletes == 1);
+    registry.endFrame();
+    assert(registry.stats(GpuResourceType::kBuffer).pendingDeletes == 0);
+
+    printf("- ResourceRegistry: LRU eviction\n");
+    registry.reloadable(GpuResourceType::kTexture, 1, evict, &owner);
+    registry.reloadable(GpuResourceType::kTexture, 2, evict, &owner);
+    registry.budget(GpuResourceType::kTexture, 250);
+    assert(registry.budget(GpuResourceType::kTexture) == 250);
+    registry.touch(GpuResourceType::kTexture, 1);
+    registry.touch(GpuResourceType::kTexture, 2);
+    registry.endFrame();
+    assert(owner.evicted.empty());  // Both used this frame
+
+    registry.touch(GpuResourceType::kTexture, 2);
+    registry.endFrame();
+    assert(owner.evicted.size() == 1 && owner.evicted[0] == 1);
+    assert(registry.stats(GpuResourceType::kTexture).evictions == 1);
+    assert(registry.stats(GpuResourceType::kTexture).bytes == 200);
+
+    printf("- ResourceRegistry: Permanent objects stay\n");
+    registry.track(GpuResourceType::kTexture, 3, 500);
+    registry.endFrame();
+    registry.endFrame();
+    assert(owner.evicted.size() == 2 && owner.evicted[1] == 2);  // Only the reloadable one goes
+    assert(registry.stats(GpuResourceType::kTexture).count == 1);
+    assert(registry.stats(GpuResourceType::kTexture).bytes == 500);
+    registry.endFrame();
+    assert(registry.stats(GpuResourceType::kTexture).evictions == 0);
+    return 0;
+}
@@ -0,0 +1,264 @@
+/***************************************************
+* Test - Rigid-body dynamics                       *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "RigidBodyWorld.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "types.h"
+
+static const float kStep = 1.0f / 60.0f;
+
+static uint32_t seed = 1;
+
+static float uniform(float low, float high) {
+    seed = seed * 1664525u + 1013904223u;
+    return low + (high - low) * ((seed >> 8) / 16777216.0f);
+}
+
+static bool near(float a, float b, float tolerance) {
+    return fabsf(a - b) <= tolerance;
+}
+
+// A static slab whose top is at y = 0
+static uint32_t addGround(lys3d::RigidBodyWorld *world) {
+    lys3d::RigidBodyDesc ground;
+    ground.halfExtents = lys3d::Point3Df(50.0f, 0.5f, 50.0f);
+    ground.position = lys3d::Point3Df(0.0f, -0.5f, 0.0f);
+    ground.mass = 0.0f;
+    return world->add(ground);
+}
+
+static uint32_t addCrate(lys3d::RigidBodyWorld *world, const lys3d::Point3Df &position) {
+    lys3d::RigidBodyDesc crate;
+    crate.position = position;
+    return world->add(crate);
+}
+
+static void run(lys3d::RigidBodyWorld *world, float seconds) {
+    for (int i = 0; i < static_cast<int>(seconds / kStep + 0.5f); ++i)
+        world->step(kStep);
+}
+
+int main(void) {
+    lys3d::RigidBodySettings settings;
+    settings.workers = 0;
+
+    printf("- RigidBodyWorld: Free fall\n");
+    {
+        lys3d::RigidBodyWorld world(settings);
+        lys3d::RigidBodyDesc ball;
+        ball.shape = lys3d::BodyShape::kSphere;
+        ball.halfExtents = lys3d::Point3Df(0.5f, 0.0f, 0.0f);
+        ball.position = lys3d::Point3Df(0.0f, 100.0f, 0.0f);
+        ball.angularVelocity = lys3d::Point3Df(0.0f, 3.0f, 0.0f);
+        uint32_t body = world.add(ball);
+        run(&world, 1.0f);
+        assert(near(world.velocity(body).y(), -9.81f, 1e-3f));
+        // Semi-implicit Euler falls a step's worth further than the exact 4.905
+        assert(near(world.position(body).y(), 100.0f - 4.905f - 0.5f * 9.81f * kStep, 1e-2f));
+        assert(near(world.angularVelocity(body).y(), 3.0f, 1e-6f));
+        const float *q = world.orientation(body);
+        assert(near(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3], 1.0f, 1e-5f));
+        assert(world.awake(body));
+        assert(world.stats().manifolds == 0 && world.stats().islands == 1);
+    }
+
+    printf("- RigidBodyWorld: Resting and sleeping\n");
+    {
+        lys3d::RigidBodyWorld world(settings);
+        uint32_t ground = addGround(&world);
+        assert(!world.awake(ground));
+        uint32_t crate = addCrate(&world, lys3d::Point3Df(0.0f, 0.6f, 0.0f));
+        run(&world, 0.5f);
+        assert(world.awake(crate));
+        assert(world.stats().manifolds == 1 && world.stats().contacts == 4);
+        assert(world.stats().colors == 4 && world.stats().batches == 4);
+        run(&world, 2.0f);
+        assert(!world.awake(crate));
+        assert(near(world.position(crate).y(), 0.5f, settings.allowedPenetration + 1e-3f));
+        assert(fabsf(world.position(crate).x()) < 1e-3f && fabsf(world.position(crate).z()) < 1e-3f);
+        float matrix[16];
+        world.transform(crate, matrix);
+        assert(near(matrix[5], 1.0f, 1e-4f) && matrix[13] == world.position(crate).y());
+        assert(world.stats().awakeBodies == 0 && world.stats().islands == 0);
+
+        // Sleeping costs nothing until something moving arrives
+        lys3d::RigidBodyDesc ball;
+        ball.shape = lys3d::BodyShape::kSphere;
+        ball.halfExtents = lys3d::Point3Df(0.25f, 0.0f, 0.0f);
+        ball.position = lys3d::Point3Df(-3.0f, 0.75f, 0.0f);
+        ball.velocity = lys3d::Point3Df(6.0f, 0.0f, 0.0f);
+        world.add(ball);
+        bool woke = false;
+        for (int i = 0; i < 60 && !woke; ++i) {
+            world.step(kStep);
+            woke = world.awake(crate);
+        }
+        assert(woke);
+        run(&world, 1.0f);
+        assert(world.position(crate).x() > 0.1f);
+    }
+
+    printf("- RigidBodyWorld: Moving static bodies\n");
+    {
+        lys3d::RigidBodyWorld world(settings);
+        uint32_t ground = addGround(&world);
+        uint32_t crate = addCrate(&world, lys3d::Point3Df(0.0f, 0.5f, 0.0f));
+        run(&world, 2.0f);
+        assert(!world.awake(crate));
+
+        // Moving the floor out from under a sleeping crate wakes it
+        world.position(ground, lys3d::Point3Df(0.0f, -100.0f, 0.0f));
+        assert(world.awake(crate) && !world.awake(ground));
+        run(&world, 0.5f);
+        assert(world.position(crate).y() < -0.5f);
+
+        // And so does moving one into it
+        world.position(ground, lys3d::Point3Df(0.0f, -0.5f, 0.0f));
+        uint32_t rest = addCrate(&world, lys3d::Point3Df(10.0f, 0.5f, 0.0f));
+        run(&world, 2.0f);
+        assert(!world.awake(rest));
+        lys3d::RigidBodyDesc wall;
+        wall.halfExtents = lys3d::Point3Df(0.5f, 2.0f, 2.0f);
+        wall.position = lys3d::Point3Df(20.0f, 2.0f, 0.0f);
+        wall.mass = 0.0f;
+        uint32_t pusher = world.add(wall);
+        world.step(kStep);
+        assert(!world.awake(rest));
+        world.position(pusher, lys3d::Point3Df(10.9f, 2.0f, 0.0f));
+        world.step(kStep);
+        assert(world.awake(rest));
+    }
+
+    printf("- RigidBodyWorld: Stacking\n");
+    {
+        lys3d::RigidBodyWorld world(settings);
+        uint32_t ground = addGround(&world);
+        lys3d::Vector<uint32_t> stack;
+        for (int i = 0; i < 8; ++i)
+            stack.push_back(addCrate(&world, lys3d::Point3Df(0.0f, 0.5f + i * 1.01f, 0.0f)));
+        lys3d::Vector<uint32_t> other;
+        for (int i = 0; i < 3; ++i)
+            other.push_back(addCrate(&world, lys3d::Point3Df(5.0f, 0.5f + i * 1.01f, 0.0f)));
+        run(&world, 0.5f);
+        // Two stacks resting on the ground are separate islands
+        assert(world.stats().islands == 2);
+        assert(world.stats().manifolds == 8 + 3 && world.stats().contacts == 4 * 11);
+        assert(world.stats().colors >= 4);
+        run(&world, 4.0f);
+        for (uint32_t i = 0; i < stack.size(); ++i) {
+            lys3d::Point3Df p = world.position(stack[i]);
+            assert(fabsf(p.x()) < 0.02f && fabsf(p.z()) < 0.02f);
+            assert(near(p.y(), 0.5f + i, 0.05f));
+            assert(!world.awake(stack[i]));
+        }
+
+        // Taking the ground away wakes everything resting on it
+        world.remove(ground);
+        assert(world.awake(stack[0]) && world.awake(stack[7]) && world.awake(other[2]));
+        run(&world, 0.5f);
+        assert(world.position(stack[0]).y() < -0.5f);
+        assert(world.stats().bodies == 11);
+        // Its id is handed out again
+        assert(addGround(&world) == ground);
+    }
+
+    printf("- RigidBodyWorld: Bouncing and friction\n");
+    {
+        lys3d::RigidBodyWorld world(settings);
+        addGround(&world);
+        lys3d::RigidBodyDesc ball;
+        ball.shape = lys3d::BodyShape::kSphere;
+        ball.halfExtents = lys3d::Point3Df(0.5f, 0.0f, 0.0f);
+        ball.position = lys3d::Point3Df(0.0f, 5.5f, 0.0f);
+        ball.restitution = 1.0f;
+        uint32_t bouncy = world.add(ball);
+        float highest = 0.0f;
+        bool falling = true;
+        for (int i = 0; i < 180; ++i) {
+            world.step(kStep);
+            if (falling)
+                falling = world.velocity(bouncy).y() <= 0.0f;
+            else
+                highest = std::max(highest, world.position(bouncy).y());
+        }
+        assert(!falling && highest > 5.0f && highest < 6.0f);
+
+        // A sliding crate stops after v^2 / (2 mu g)
+        uint32_t slider = addCrate(&world, lys3d::Point3Df(10.0f, 0.5f, 0.0f));
+        world.velocity(slider, lys3d::Point3Df(5.0f, 0.0f, 0.0f));
+        run(&world, 2.0f);
+        float distance = world.position(slider).x() - 10.0f;
+        assert(near(distance, 25.0f / (2.0f * 0.6f * 9.81f), 0.25f));
+        assert(fabsf(world.velocity(slider).x()) < 0.05f);
+    }
+
+    printf("- RigidBodyWorld: Momentum\n");
+    {
+        lys3d::RigidBodySettings space = settings;
+        space.gravity = lys3d::Point3Df();
+        lys3d::RigidBodyWorld world(space);
+        lys3d::RigidBodyDesc ball;
+        ball.shape = lys3d::BodyShape::kSphere;
+        ball.halfExtents = lys3d::Point3Df(0.5f, 0.0f, 0.0f);
+        ball.restitution = 1.0f;
+        ball.position = lys3d::Point3Df(-2.0f, 0.0f, 0.0f);
+        ball.velocity = lys3d::Point3Df(3.0f, 0.0f, 0.0f);
+        uint32_t a = world.add(ball);
+        ball.position = lys3d::Point3Df(2.0f, 0.1f, 0.0f);
+        ball.velocity = lys3d::Point3Df(-1.0f, 0.0f, 0.0f);
+        ball.mass = 2.0f;
+        uint32_t b = world.add(ball);
+        run(&world, 2.0f);
+        lys3d::Point3Df momentum = world.velocity(a) + world.velocity(b) * 2.0f;
+        assert(near(momentum.x(), 1.0f, 1e-3f) && near(momentum.y(), 0.0f, 1e-3f));
+        // Elastic: the approach speed comes back as the separation speed
+        assert(world.velocity(b).x() - world.velocity(a).x() > 3.6f);
+
+        // An impulse off center spins a body
+        world.applyImpulse(a, lys3d::Point3Df(0.0f, 1.0f, 0.0f), world.position(a) + lys3d::Point3Df(0.5f, 0.0f, 0.0f));
+        assert(world.angularVelocity(a).z() > 0.0f);
+    }
+
+    printf("- RigidBodyWorld: Worker threads\n");
+    {
+        lys3d::RigidBodySettings threaded = settings;
+        threaded.workers = 3;
+        lys3d::RigidBodyWorld serial(settings), parallel(threaded);
+        lys3d::RigidBodyWorld *worlds[] = {&serial, &parallel};
+        for (lys3d::RigidBodyWorld *world : worlds) {
+            seed = 9;
+            addGround(world);
+            for (int i = 0; i < 400; ++i) {
+                lys3d::RigidBodyDesc debris;
+                debris.shape = i % 3 ? lys3d::BodyShape::kBox : lys3d::BodyShape::kSphere;
+                debris.halfExtents = lys3d::Point3Df(uniform(0.1f, 0.4f), uniform(0.1f, 0.4f), uniform(0.1f, 0.4f));
+                debris.position = lys3d::Point3Df(uniform(-3.0f, 3.0f), uniform(1.0f, 6.0f), uniform(-3.0f, 3.0f));
+                debris.velocity = lys3d::Point3Df(uniform(-4.0f, 4.0f), uniform(0.0f, 4.0f), uniform(-4.0f, 4.0f));
+                debris.angularVelocity = lys3d::Point3Df(uniform(-5.0f, 5.0f), 0.0f, uniform(-5.0f, 5.0f));
+                world->add(debris);
+            }
+            run(world, 2.0f);
+        }
+        assert(parallel.stats().manifolds > 100 && parallel.stats().islands > 1);
+        for (uint32_t i = 1; i <= 400; ++i) {
+            assert(serial.position(i) == parallel.position(i));
+            assert(serial.velocity(i) == parallel.velocity(i));
+            // Nothing fell through the ground or flew off
+            assert(parallel.position(i).y() > 0.0f && parallel.position(i).length() < 60.0f);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+/***************************************************
+* Test - Cached shadow-map tile atlas              *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "ShadowAtlas.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "types.h"
+
+static void printStats(const lys3d::ShadowAtlas &atlas) {
+    const lys3d::ShadowAtlasStats &stats = atlas.stats();
+    printf("cached %u, refreshed %u, deferred %u, unallocated %u, texels %llu\n",
+           stats.cachedTiles, stats.refreshedTiles, stats.deferredTiles,
+           stats.unallocatedLights, static_cast<unsigned long long>(stats.allocatedTexels));
+}
+
+int main(void) {
+    // Planning works without a GL context; only create()/bindTile() need one.
+    lys3d::ShadowAtlas atlas(1024, 64);
+    atlas.budget(2);
+    assert(!atlas.isCreated());
+
+    lys3d::ShadowLight light;
+    light.range = 10.0f;
+    for (uint32_t i = 0; i < 4; ++i) {
+        light.position = lys3d::Point3Df(i * 100.0f, 0.0f, 0.0f);
+        light.importance = 1.0f - i * 0.25f;
+        atlas.light(i, light);
+    }
+
+    // New tiles are allocated immediately, but only refreshed within budget
+    printf("- ShadowAtlas: First frame\n");
+    const lys3d::Vector<lys3d::ShadowTile> &updates = atlas.plan();
+    printStats(atlas);
+    assert(updates.size() == 2);
+    assert(updates[0].lightId == 0 && updates[0].size == 512);
+    assert(atlas.stats().deferredTiles == 2);
+    assert(atlas.stats().unallocatedLights == 0);
+    lys3d::ShadowTile tile;
+    assert(atlas.tile(0, &tile) && tile.size == 512);
+    assert(!atlas.tile(3, &tile));
+
+    printf("- ShadowAtlas: Second frame catches up\n");
+    atlas.plan();
+    printStats(atlas);
+    assert(atlas.stats().refreshedTiles == 2 && atlas.stats().cachedTiles == 2);
+
+    printf("- ShadowAtlas: Static frame is fully cached\n");
+    atlas.plan();
+    printStats(atlas);
+    assert(atlas.stats().refreshedTiles == 0 && atlas.stats().cachedTiles == 4);
+
+    // A caster moving near light 1 only invalidates light 1
+    printf("- ShadowAtlas: Caster moves inside one light's range\n");
+    atlas.caster(7, lys3d::Box3Df(lys3d::Point3Df(95, -1, -1), lys3d::Point3Df(97, 1, 1)));
+    atlas.plan();
+    printStats(atlas);
+    assert(atlas.stats().refreshedTiles == 1 && updates[0].lightId == 1);
+    atlas.plan();
+    assert(atlas.stats().refreshedTiles == 0);
+
+    // Moving a light invalidates its tile
+    printf("- ShadowAtlas: Light moves\n");
+    light.position = lys3d::Point3Df(300.0f, 5.0f, 0.0f);
+    light.importance = 0.25f;
+    atlas.light(3, light);
+    atlas.plan();
+    assert(atlas.stats().refreshedTiles == 1 && updates[0].lightId == 3);
+
+    // Importance changes resize tiles (with hysteresis when shrinking)
+    printf("- ShadowAtlas: Importance changes\n");
+    light.importance = 0.2f;
+    atlas.light(3, light);
+    atlas.plan();
+    assert(atlas.stats().refreshedTiles == 0);
+    light.importance = 0.05f;
+    atlas.light(3, light);
+    atlas.plan();
+    assert(atlas.stats().refreshedTiles == 1);
+    assert(atlas.tile(3, &tile) && tile.size == 64);
+
+    // Removing everything returns all space to the allocator
+    printf("- ShadowAtlas: Removing lights\n");
+    for (uint32_t i = 0; i < 4; ++i)
+        atlas.removeLight(i);
+    atlas.removeCaster(7);
+    atlas.plan();
+    printStats(atlas);
+    assert(atlas.stats().allocatedTexels == 0);
+
+    // Full atlas: lights fall back to smaller tiles, then to none at all
+    printf("- ShadowAtlas: Oversubscribed atlas\n");
+    light.importance = 1.0f;
+    for (uint32_t i = 0; i < 6; ++i)
+        atlas.light(i, light);
+    atlas.plan();
+    printStats(atlas);
+    assert(atlas.stats().unallocatedLights == 0);
+    assert(atlas.stats().allocatedTexels <= 1024u * 1024u);
+    for (uint32_t i = 6; i < 300; ++i)
+        atlas.light(i, light);
+    atlas.plan();
+    printStats(atlas);
+    assert(atlas.stats().unallocatedLights > 0);
+    assert(atlas.stats().allocatedTexels == 1024u * 1024u);
+
+    // UV transform
+    float uv[4];
+    tile.origin = lys3d::Point2Di32(512, 256);
+    tile.size = 256;
+    atlas.uvTransform(tile, uv);
+    assert(uv[0] == 0.25f && uv[1] == 0.25f && uv[2] == 0.5f && uv[3] == 0.25f);
+
+    return 0;
+}
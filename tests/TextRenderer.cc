@@ -0,0 +1,346 @@
+/***************************************************
+* Test - TrueType fonts & batched SDF text         *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "TextRenderer.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+#include "Font.h"
+
+using lys3d::Vector;
+
+// Glyphs of the test font: 0 .notdef, 1 a square ('A'), 2 a round shape of
+// off-curve points only ('O'), 3 the square moved right ('B'), 4 a space,
+// then kExtraGlyphs more squares for U+4E00 onwards
+static const uint32_t kExtraGlyphs = 40;
+static const uint32_t kGlyphCount = 5 + kExtraGlyphs;
+
+static void put16(Vector<uint8_t> *out, uint32_t value) {
+    out->push_back(static_cast<uint8_t>(value >> 8));
+    out->push_back(static_cast<uint8_t>(value));
+}
+
+static void put32(Vector<uint8_t> *out, uint32_t value) {
+    put16(out, value >> 16);
+    put16(out, value & 0xFFFF);
+}
+
+static void simpleGlyph(Vector<uint8_t> *out, const int16_t (*points)[2], uint32_t count, bool on_curve) {
+    put16(out, 1);
+    for (int i = 0; i < 4; ++i)
+        put16(out, 0);
+    put16(out, count - 1);
+    put16(out, 0);
+    for (uint32_t i = 0; i < count; ++i)
+        out->push_back(on_curve ? 1 : 0);
+    for (int axis = 0; axis < 2; ++axis) {
+        int16_t last = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            put16(out, static_cast<uint16_t>(points[i][axis] - last));
+            last = points[i][axis];
+        }
+    }
+}
+
+static void compositeGlyph(Vector<uint8_t> *out, uint32_t component, int16_t dx) {
+    put16(out, 0xFFFF);
+    for (int i = 0; i < 4; ++i)
+        put16(out, 0);
+    put16(out, 0x0001 | 0x0002);
+    put16(out, component);
+    put16(out, static_cast<uint16_t>(dx));
+    put16(out, 0);
+}
+
+// A minimal TrueType font, with a format 12 or format 4 character map
+static Vector<uint8_t> buildFont(bool format12) {
+    static const int16_t kSquare[4][2] = {{100, 0}, {100, 700}, {600, 700}, {600, 0}};
+    Vector<Vector<uint8_t> > glyphs(kGlyphCount);
+    simpleGlyph(&glyphs[1], kSquare, 4, true);
+    simpleGlyph(&glyphs[2], kSquare, 4, false);
+    compositeGlyph(&glyphs[3], 1, 200);
+    for (uint32_t i = 5; i < kGlyphCount; ++i)
+        compositeGlyph(&glyphs[i], 1, 0);
+
+    Vector<uint8_t> glyf, loca, hmtx;
+    for (uint32_t i = 0; i < kGlyphCount; ++i) {
+        put32(&loca, static_cast<uint32_t>(glyf.size()));
+        glyf.insert(glyf.end(), glyphs[i].begin(), glyphs[i].end());
+        while (glyf.size() % 4)
+            glyf.push_back(0);
+        const uint32_t advances[5] = {500, 700, 700, 900, 250};
+        put16(&hmtx, i < 5 ? advances[i] : 700);
+        put16(&hmtx, 0);
+    }
+    put32(&loca, static_cast<uint32_t>(glyf.size()));
+
+    Vector<uint8_t> head(54, 0), hhea(36, 0), maxp;
+    head[18] = 1000 >> 8;
+    head[19] = 1000 & 0xFF;
+    head[51] = 1;
+    hhea[4] = 800 >> 8;
+    hhea[5] = 800 & 0xFF;
+    hhea[6] = 0xFF;
+    hhea[7] = 0x38;  // -200
+    hhea[35] = kGlyphCount;
+    put32(&maxp, 0x00005000);
+    put16(&maxp, kGlyphCount);
+
+    // ' ' 'A'-'B' 'O' and the extra range
+    const uint32_t ranges[5][3] = {{0x20, 0x20, 4}, {0x41, 0x41, 1}, {0x42, 0x42, 3}, {0x4F, 0x4F, 2},
+                                   {0x4E00, 0x4E00 + kExtraGlyphs - 1, 5}};
+    Vector<uint8_t> cmap;
+    put16(&cmap, 0);
+    put16(&cmap, 1);
+    put16(&cmap, 3);
+    put16(&cmap, format12 ? 10 : 1);
+    put32(&cmap, 12);
+    if (format12) {
+        put16(&cmap, 12);
+        put16(&cmap, 0);
+        put32(&cmap, 16 + 5 * 12);
+        put32(&cmap, 0);
+        put32(&cmap, 5);
+        for (const uint32_t *range : ranges) {
+            put32(&cmap, range[0]);
+            put32(&cmap, range[1]);
+            put32(&cmap, range[2]);
+        }
+    } else {
+        const uint32_t segments = 6;
+        put16(&cmap, 4);
+        put16(&cmap, 16 + segments * 8);
+        put16(&cmap, 0);
+        put16(&cmap, segments * 2);
+        put16(&cmap, 0);
+        put16(&cmap, 0);
+        put16(&cmap, 0);
+        for (const uint32_t *range : ranges)
+            put16(&cmap, range[1]);
+        put16(&cmap, 0xFFFF);
+        put16(&cmap, 0);
+        for (const uint32_t *range : ranges)
+            put16(&cmap, range[0]);
+        put16(&cmap, 0xFFFF);
+        for (const uint32_t *range : ranges)
+            put16(&cmap, (range[2] - range[0]) & 0xFFFF);
+        put16(&cmap, 1);
+        for (uint32_t i = 0; i < segments; ++i)
+            put16(&cmap, 0);
+    }
+
+    // 'A' 'B' kerned by -100
+    Vector<uint8_t> kern;
+    put16(&kern, 0);
+    put16(&kern, 1);
+    put16(&kern, 0);
+    put16(&kern, 14 + 6);
+    put16(&kern, 0x0001);
+    put16(&kern, 1);
+    put16(&kern, 6);
+    put16(&kern, 0);
+    put16(&kern, 0);
+    put16(&kern, 1);
+    put16(&kern, 3);
+    put16(&kern, static_cast<uint16_t>(-100));
+
+    struct Table {
+        const char *tag;
+        const Vector<uint8_t> *data;
+    } tables[] = {{"cmap", &cmap}, {"glyf", &glyf}, {"head", &head}, {"hhea", &hhea},
+                  {"hmtx", &hmtx}, {"kern", &kern}, {"loca", &loca}, {"maxp", &maxp}};
+    const uint32_t count = sizeof(tables) / sizeof(tables[0]);
+    Vector<uint8_t> file;
+    put32(&file, 0x00010000);
+    put16(&file, count);
+    put16(&file, 0);
+    put16(&file, 0);
+    put16(&file, 0);
+    uint32_t offset = 12 + count * 16;
+    for (const Table &table : tables) {
+        file.insert(file.end(), table.tag, table.tag + 4);
+        put32(&file, 0);
+        put32(&file, offset);
+        put32(&file, static_cast<uint32_t>(table.data->size()));
+        offset += static_cast<uint32_t>((table.data->size() + 3) & ~3u);
+    }
+    for (const Table &table : tables) {
+        file.insert(file.end(), table.data->begin(), table.data->end());
+        while (file.size() % 4)
+            file.push_back(0);
+    }
+    return file;
+}
+
+static lys3d::String utf8(uint32_t codepoint) {
+    char bytes[4] = {static_cast<char>(0xE0 | codepoint >> 12), static_cast<char>(0x80 | (codepoint >> 6 & 0x3F)),
+                     static_cast<char>(0x80 | (codepoint & 0x3F)), 0};
+    return lys3d::String(bytes);
+}
+
+static bool approx(float a, float b) {
+    return fabsf(a - b) < 1.0e-3f;
+}
+
+static void testFont() {
+    lys3d::Font font;
+    assert(!font.isLoaded());
+    assert(!font.loadFromMemory("garbage", 7));
+    Vector<uint8_t> file = buildFont(true);
+    assert(!font.loadFromMemory(file.data(), file.size() / 2));
+    assert(!font.isLoaded());
+    assert(font.loadFromMemory(file.data(), file.size()));
+    assert(font.isLoaded());
+    assert(font.glyphCount() == kGlyphCount);
+    assert(approx(font.ascent(), 0.8f) && approx(font.descent(), -0.2f) && approx(font.lineHeight(), 1.0f));
+
+    lys3d::Font bmp;
+    Vector<uint8_t> bmp_file = buildFont(false);
+    assert(bmp.loadFromMemory(bmp_file.data(), bmp_file.size()));
+    for (const lys3d::Font *f : {&font, &bmp}) {
+        assert(f->glyphIndex('A') == 1 && f->glyphIndex('B') == 3 && f->glyphIndex('O') == 2);
+        assert(f->glyphIndex(' ') == 4);
+        assert(f->glyphIndex('C') == 0 && f->glyphIndex(0x1F600) == 0);
+        assert(f->glyphIndex(0x4E00) == 5 && f->glyphIndex(0x4E00 + kExtraGlyphs - 1) == kGlyphCount - 1);
+        assert(f->glyphIndex(0x4E00 + kExtraGlyphs) == 0);
+    }
+    assert(approx(font.advance(1), 0.7f) && approx(font.advance(4), 0.25f) && font.advance(9999) == 0.0f);
+    assert(approx(font.kerning(1, 3), -0.1f) && font.kerning(3, 1) == 0.0f);
+
+    // The square is 10-60 x 0-70 pixels at 100 per em, padded by 5
+    Vector<uint8_t> square, moved;
+    lys3d::GlyphBitmap box, moved_box;
+    assert(font.renderSDF(1, 100.0f, 4.0f, &square, &box));
+    assert(box.width == 60 && box.height == 80 && box.left == 5 && box.top == 75);
+    assert(square.size() == box.width * box.height);
+    assert(square[40 * box.width + 30] == 255);
+    assert(square[0] == 0);
+    // Half a pixel either side of the left edge (x = 10)
+    uint32_t row = 40 * box.width;
+    assert(square[row + 5] > 128 && square[row + 5] < 150);
+    assert(square[row + 4] < 128 && square[row + 4] > 105);
+    assert(square[row + 5] + square[row + 4] == 255);
+
+    // The composite is the same square, 20 pixels right
+    assert(font.renderSDF(3, 100.0f, 4.0f, &moved, &moved_box));
+    assert(moved_box.width == box.width && moved_box.height == box.height && moved_box.left == box.left + 20);
+    assert(moved == square);
+
+    // All off-curve points: the shape passes through the midpoints
+    // between them and stays clear of the corners
+    Vector<uint8_t> round;
+    lys3d::GlyphBitmap round_box;
+    assert(font.renderSDF(2, 100.0f, 4.0f, &round, &round_box));
+    assert(round_box.width == box.width && round_box.height == box.height);
+    assert(round[40 * round_box.width + 30] == 255);
+    uint32_t corner = (75 - 2) * round_box.width + (12 - 5);
+    assert(round[corner] == 0);
+    uint32_t side = (75 - 35) * round_box.width + (10 - 5);
+    assert(round[side] > 120 && round[side] < 150);
+
+    Vector<uint8_t> empty;
+    lys3d::GlyphBitmap empty_box;
+    assert(font.renderSDF(4, 100.0f, 4.0f, &empty, &empty_box));
+    assert(empty.empty() && empty_box.width == 0 && empty_box.height == 0);
+    assert(!font.renderSDF(kGlyphCount, 100.0f, 4.0f, &empty, &empty_box));
+}
+
+static void testLayout() {
+    Vector<uint8_t> file = buildFont(true);
+    lys3d::Font font;
+    assert(font.loadFromMemory(file.data(), file.size()));
+    lys3d::TextRenderer text;
+    uint32_t id = text.addFont(&font);
+    assert(id == 0);
+
+    // A 0.7 - 0.1 kerning, B 0.9, space 0.25, A 0.7
+    text.begin(lys3d::Dimension2Di32(800, 600));
+    lys3d::Dimension2Df size = text.text(id, "AB A", 10.0f, 20.0f, 10.0f, 0xFFFFFFFF);
+    assert(approx(size.width(), 24.5f) && approx(size.height(), 10.0f));
+    assert(text.stats().glyphs == 3);
+    assert(text.stats().generated == 3 && text.stats().cached == 3 && text.stats().evicted == 0);
+    assert(text.stats().drawCalls == 0);
+    size = text.measure(id, "AB A", 10.0f);
+    assert(approx(size.width(), 24.5f) && approx(size.height(), 10.0f));
+
+    size = text.measure(id, "A\nAB", 10.0f);
+    assert(approx(size.width(), 15.0f) && approx(size.height(), 20.0f));
+    // Invalid bytes show as the missing glyph (0.5 em); U+4E00 is a square
+    size = text.measure(id, "\xFF\xC0\xAF", 10.0f);
+    assert(approx(size.width(), 15.0f));
+    // Bytes that never lead a sequence don't swallow the ones after them
+    size = text.measure(id, "\xF8\x80\x80", 10.0f);
+    assert(approx(size.width(), 15.0f));
+    size = text.measure(id, "\xFF\x80\x80", 10.0f);
+    assert(approx(size.width(), 15.0f));
+    size = text.measure(id, utf8(0x4E00).c_str(), 10.0f);
+    assert(approx(size.width(), 7.0f));
+    assert(text.measure(1, "A", 10.0f).width() == 0.0f);
+
+    // Cached glyphs aren't rendered again
+    text.begin(lys3d::Dimension2Di32(800, 600));
+    text.text(id, "BAAB", 0.0f, 0.0f, 48.0f, 0xFF0000FF);
+    assert(text.stats().glyphs == 4 && text.stats().generated == 0);
+}
+
+static void testEviction() {
+    Vector<uint8_t> file = buildFont(true);
+    lys3d::Font font;
+    assert(font.loadFromMemory(file.data(), file.size()));
+
+    // 22 pixel cells, 5 x 5 of them
+    lys3d::TextSettings settings;
+    settings.atlasSize = 128;
+    settings.glyphSize = 16.0f;
+    settings.spread = 2.0f;
+    lys3d::TextRenderer text(settings);
+    uint32_t id = text.addFont(&font);
+    text.begin(lys3d::Dimension2Di32(800, 600));
+    assert(text.stats().capacity == 25 && text.stats().cached == 0);
+
+    lys3d::String first, second;
+    for (uint32_t i = 0; i < 20; ++i) {
+        first += utf8(0x4E00 + i);
+        second += utf8(0x4E00 + 20 + i);
+    }
+    text.text(id, first.c_str(), 0.0f, 0.0f, 16.0f, 0xFFFFFFFF);
+    assert(text.stats().generated == 20 && text.stats().cached == 20);
+
+    // The next batch pushes out the 15 least recently used
+    text.begin(lys3d::Dimension2Di32(800, 600));
+    text.text(id, utf8(0x4E00 + 19).c_str(), 0.0f, 0.0f, 16.0f, 0xFFFFFFFF);
+    text.text(id, second.c_str(), 0.0f, 0.0f, 16.0f, 0xFFFFFFFF);
+    assert(text.stats().generated == 20 && text.stats().evicted == 15);
+    assert(text.stats().cached == 25 && text.stats().glyphs == 21);
+
+    // The first string is down to its last five, the one reused last the
+    // most recent of them
+    text.begin(lys3d::Dimension2Di32(800, 600));
+    text.text(id, second.c_str(), 0.0f, 0.0f, 16.0f, 0xFFFFFFFF);
+    assert(text.stats().generated == 0);
+    text.text(id, utf8(0x4E00).c_str(), 0.0f, 0.0f, 16.0f, 0xFFFFFFFF);
+    assert(text.stats().generated == 1 && text.stats().evicted == 1);
+    text.text(id, utf8(0x4E00 + 19).c_str(), 0.0f, 0.0f, 16.0f, 0xFFFFFFFF);
+    assert(text.stats().generated == 1);
+    text.text(id, utf8(0x4E00 + 15).c_str(), 0.0f, 0.0f, 16.0f, 0xFFFFFFFF);
+    assert(text.stats().generated == 2 && text.stats().evicted == 2);
+}
+
+int main(void) {
+    testFont();
+    testLayout();
+    testEviction();
+    puts("TextRenderer tests passed");
+    return 0;
+}
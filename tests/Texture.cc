@@ -0,0 +1,140 @@
+/***************************************************
+* Test - KTX parsing & ETC1 decoding               *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "Texture.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+
+static void pushU32(lys3d::Vector<uint8_t> *out, uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        out->push_back(static_cast<uint8_t>(value >> (i * 8)));
+}
+
+static void pushBlock(lys3d::Vector<uint8_t> *out, uint32_t hi, uint32_t lo) {
+    for (int i = 3; i >= 0; --i)
+        out->push_back(static_cast<uint8_t>(hi >> (i * 8)));
+    for (int i = 3; i >= 0; --i)
+        out->push_back(static_cast<uint8_t>(lo >> (i * 8)));
+}
+
+static bool pixelIs(const uint8_t *rgb, uint32_t width, uint32_t x, uint32_t y, int r, int g, int b) {
+    const uint8_t *p = rgb + (y * width + x) * 3;
+    return p[0] == r && p[1] == g && p[2] == b;
+}
+
+int main(void) {
+    // Differential block: base (16, 8, 31) with delta (+3, 0, -1), tables 0 and 7
+    uint32_t hi = (16u << 27) | (3u << 24) | (8u << 19) | (31u << 11) | (7u << 8) | (0u << 5) | (7u << 2) | 0x2;
+    uint32_t lo = (1u << (13 + 16)) | (1u << 13) | (1u << 8) | (1u << (7 + 16));
+
+    printf("- Texture: ETC1 decoding\n");
+    lys3d::Vector<uint8_t> block;
+    pushBlock(&block, hi, lo);
+    uint8_t rgb[4 * 4 * 3];
+    lys3d::decodeETC1(block.data(), 4, 4, rgb);
+    assert(pixelIs(rgb, 4, 0, 0, 134, 68, 255));  // +2 from (132, 66, 255)
+    assert(pixelIs(rgb, 4, 1, 3, 130, 64, 253));  // -2
+    assert(pixelIs(rgb, 4, 2, 0, 255, 249, 255)); // +183 from (156, 66, 247)
+    assert(pixelIs(rgb, 4, 3, 1, 0, 0, 64));      // -183
+
+    // Flipped, individual mode: top half (15, 0, 0), bottom half (0, 0, 15)
+    lys3d::Vector<uint8_t> flipped;
+    pushBlock(&flipped, (15u << 28) | (15u << 8) | 0x1, 0);
+    lys3d::decodeETC1(flipped.data(), 4, 4, rgb);
+    assert(pixelIs(rgb, 4, 3, 1, 255, 2, 2));
+    assert(pixelIs(rgb, 4, 0, 2, 2, 2, 255));
+
+    // Sizes that aren't a multiple of the block size
+    lys3d::Vector<uint8_t> blocks;
+    for (int i = 0; i < 4; ++i)
+        pushBlock(&blocks, hi, lo);
+    uint8_t small[6 * 6 * 3];
+    lys3d::decodeETC1(blocks.data(), 6, 6, small);
+    assert(pixelIs(small, 6, 4, 4, 134, 68, 255));
+    assert(pixelIs(small, 6, 5, 5, 134, 68, 255));
+
+    // An 8x8 ETC1 container with its full mip chain
+    printf("- Texture: KTX parsing\n");
+    lys3d::Vector<uint8_t> ktx = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+    uint32_t header[13] = {0x04030201, 0, 1, 0, 0x8D64, 0x1907, 8, 8, 0, 0, 1, 4, 8};
+    for (uint32_t value : header)
+        pushU32(&ktx, value);
+    pushU32(&ktx, 4);
+    pushU32(&ktx, 0xDEADBEEF); // Key/value data, skipped
+    const uint32_t level_blocks[4] = {4, 1, 1, 1};
+    for (uint32_t blocks_in_level : level_blocks) {
+        pushU32(&ktx, blocks_in_level * 8);
+        for (uint32_t i = 0; i < blocks_in_level; ++i)
+            pushBlock(&ktx, hi, lo);
+    }
+
+    lys3d::KtxImage image;
+    assert(lys3d::parseKTX(ktx.data(), ktx.size(), &image));
+    assert(image.glType == 0 && image.glInternalFormat == 0x8D64);
+    assert(image.width == 8 && image.height == 8);
+    assert(image.levels.size() == 4);
+    assert(image.levels[0].size == 32 && image.levels[0].width == 8);
+    assert(image.levels[3].size == 8 && image.levels[3].width == 1 && image.levels[3].height == 1);
+    // Zero-copy: levels point into the container
+    assert(image.levels[0].data == ktx.data() + 12 + 52 + 8 + 4);
+    assert(memcmp(image.levels[1].data, block.data(), 8) == 0);
+
+    // Big-endian files are fine for compressed data
+    lys3d::Vector<uint8_t> swapped(ktx.begin(), ktx.begin() + 12);
+    for (size_t i = 12; i < 12 + 52; i += 4) {
+        for (int k = 3; k >= 0; --k)
+            swapped.push_back(ktx[i + k]);
+    }
+    swapped.insert(swapped.end(), ktx.begin() + 64, ktx.begin() + 72);
+    size_t offset = 72;
+    for (uint32_t blocks_in_level : level_blocks) {
+        for (int k = 3; k >= 0; --k)
+            swapped.push_back(ktx[offset + k]);
+        swapped.insert(swapped.end(), ktx.begin() + offset + 4, ktx.begin() + offset + 4 + blocks_in_level * 8);
+        offset += 4 + blocks_in_level * 8;
+    }
+    assert(lys3d::parseKTX(swapped.data(), swapped.size(), &image));
+    assert(image.levels.size() == 4 && image.levels[0].size == 32);
+
+    // Broken files
+    printf("- Texture: Invalid KTX\n");
+    assert(!lys3d::parseKTX(ktx.data(), ktx.size() - 1, &image));
+    assert(!lys3d::parseKTX(ktx.data(), 40, &image));
+    lys3d::Vector<uint8_t> bad = ktx;
+    bad[1] = 'X';
+    assert(!lys3d::parseKTX(bad.data(), bad.size(), &image));
+    bad = ktx;
+    bad[12 + 4 * 10] = 6; // Cube maps aren't supported
+    assert(!lys3d::parseKTX(bad.data(), bad.size(), &image));
+
+    // A 3x2 RGB level has 4-byte aligned rows, so GL reads 12 + 9 bytes; one
+    // short of that is rejected before anything reaches GL
+    printf("- Texture: Short uncompressed level\n");
+    lys3d::Vector<uint8_t> rgb_ktx(ktx.begin(), ktx.begin() + 12);
+    uint32_t rgb_header[13] = {0x04030201, 0x1401, 1, 0x1907, 0x1907, 0x1907, 3, 2, 0, 0, 1, 1, 0};
+    for (uint32_t value : rgb_header)
+        pushU32(&rgb_ktx, value);
+    pushU32(&rgb_ktx, 20);
+    rgb_ktx.resize(rgb_ktx.size() + 20, 0x80);
+    assert(lys3d::parseKTX(rgb_ktx.data(), rgb_ktx.size(), &image));
+    assert(image.levels.size() == 1 && image.levels[0].size == 20);
+    lys3d::Texture texture;
+    assert(!texture.load(image));
+    assert(!texture.loadKTXFromMemory(rgb_ktx.data(), rgb_ktx.size()));
+    // Types GLES2 can't upload are rejected too
+    image.levels[0].size = 21;
+    image.glType = 0x1406;
+    assert(!texture.load(image));
+    return 0;
+}
@@ -0,0 +1,126 @@
+/***************************************************
+* Test - Texture streaming residency planning      *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "TextureStreamer.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <physfs.h>
+
+#include "types.h"
+
+static void pushU32(lys3d::Vector<uint8_t> *out, uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        out->push_back(static_cast<uint8_t>(value >> (i * 8)));
+}
+
+// An uncompressed RGBA8 KTX file with a full mip chain
+static bool writeKTX(const char *path, uint32_t size) {
+    lys3d::Vector<uint8_t> data;
+    const uint8_t identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+    data.insert(data.end(), identifier, identifier + 12);
+    uint32_t levels = 1;
+    for (uint32_t s = size; s > 1; s >>= 1)
+        ++levels;
+    const uint32_t header[13] = {0x04030201, 0x1401, 1, 0x1908, 0x1908, 0x1908, size, size, 0, 0, 1, levels, 0};
+    for (uint32_t value : header)
+        pushU32(&data, value);
+    for (uint32_t level = 0; level < levels; ++level) {
+        uint32_t s = size >> level;
+        pushU32(&data, s * s * 4);
+        data.resize(data.size() + s * s * 4, static_cast<uint8_t>(level));
+    }
+
+    PHYSFS_File *file = PHYSFS_openWrite(path);
+    if (file == nullptr)
+        return false;
+    bool ok = PHYSFS_writeBytes(file, data.data(), data.size()) == static_cast<PHYSFS_sint64>(data.size());
+    PHYSFS_close(file);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    bool ok = PHYSFS_init(argv[0]) && PHYSFS_setWriteDir(".") && PHYSFS_mount(".", nullptr, 1)
+        && writeKTX("stream_a.ktx", 256) && writeKTX("stream_b.ktx", 256);
+    assert(ok);
+    (void)ok;
+
+    // 256x256 RGBA8: 262144 + 65536 + 16384 + 5460 bytes for levels 0, 1, 2 and 3+
+    const uint64_t from_level[3] = {349524, 87380, 21844};
+    {
+        printf("- TextureStreamer: Adding\n");
+        lys3d::TextureStreamer streamer(1024 * 1024);
+        assert(streamer.add("missing.ktx") == 0);
+        uint32_t a = streamer.add("stream_a.ktx");
+        uint32_t b = streamer.add("stream_b.ktx");
+        assert(a != 0 && b != 0 && a != b);
+        assert(streamer.levelCount(a) == 9);
+        assert(streamer.targetLevel(a) == 2);    // 64x64 and below make up the tail
+        assert(streamer.residentLevel(a) == 9);  // Nothing uploaded yet
+        assert(streamer.texture(a) == 0);
+
+        printf("- TextureStreamer: Mip tails load first\n");
+        streamer.plan();
+        assert(streamer.stats().pendingRequests == 2);
+        streamer.finish();
+        streamer.plan();
+        assert(streamer.stats().pendingRequests == 2);  // Loaded, waiting for upload()
+
+        printf("- TextureStreamer: Coverage picks levels\n");
+        streamer.request(a, 256.0f);
+        streamer.request(b, 20.0f);
+        streamer.request(b, 100.0f);  // The largest use counts
+        streamer.plan();
+        assert(streamer.targetLevel(a) == 0);
+        assert(streamer.targetLevel(b) == 1);
+        assert(streamer.stats().budgetMisses == 0);
+
+        streamer.projection(lys3d::Dimension2Di32(512, 512), 1.5707964f);
+        streamer.request(b, lys3d::Point3Df(0.0f, 0.0f, 0.0f), lys3d::Point3Df(0.0f, 0.0f, -2.0f), 1.0f);
+        streamer.plan();
+        assert(streamer.targetLevel(b) == 0);  // 512 pixels across
+
+        printf("- TextureStreamer: Budget\n");
+        streamer.budget(from_level[0] + from_level[2]);
+        streamer.request(a, 256.0f);
+        streamer.request(b, 100.0f);
+        streamer.plan();
+        assert(streamer.targetLevel(a) == 0);  // Same age; b wants less so it gives way
+        assert(streamer.targetLevel(b) == 2);
+        assert(streamer.stats().budgetMisses == 1);
+
+        streamer.request(b, 100.0f);
+        streamer.plan();
+        assert(streamer.targetLevel(a) == 1);  // a wasn't drawn this frame
+        assert(streamer.targetLevel(b) == 1);
+        assert(streamer.stats().budgetMisses == 0);
+
+        streamer.budget(from_level[2]);  // Tails stay even over budget
+        streamer.request(a, 256.0f);
+        streamer.plan();
+        assert(streamer.targetLevel(a) == 2);
+        assert(streamer.targetLevel(b) == 2);
+        assert(streamer.stats().budgetMisses == 1);
+
+        printf("- TextureStreamer: Removing\n");
+        streamer.remove(a);
+        assert(streamer.levelCount(a) == 0);
+        assert(streamer.texture(a) == 0);
+        streamer.plan();
+        assert(streamer.targetLevel(b) == 2);
+    }
+
+    PHYSFS_delete("stream_a.ktx");
+    PHYSFS_delete("stream_b.ktx");
+    PHYSFS_deinit();
+    return 0;
+}
@@ -0,0 +1,117 @@
+/***************************************************
+* Test - Vertex formats & quantization             *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+#include "VertexLayout.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+
+// CPU versions of the GLES2 attribute conversions and kVertexDecodeGLSL
+static float snorm(int32_t code, int bits) {
+    return (2.0f * code + 1.0f) / ((1 << bits) - 1);
+}
+
+static void decodeNormal(float ox, float oy, float *n) {
+    n[0] = ox;
+    n[1] = oy;
+    n[2] = 1.0f - fabsf(ox) - fabsf(oy);
+    if (n[2] < 0.0f) {
+        n[0] = (1.0f - fabsf(oy)) * (ox >= 0.0f ? 1.0f : -1.0f);
+        n[1] = (1.0f - fabsf(ox)) * (oy >= 0.0f ? 1.0f : -1.0f);
+    }
+    float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    for (int k = 0; k < 3; ++k)
+        n[k] /= length;
+}
+
+int main(void) {
+    // Half floats
+    printf("- VertexLayout: Half-float conversion\n");
+    float values[7] = {0.0f, 1.0f, -2.5f, 0.333251953125f, 65504.0f, 6.103515625e-05f, 5.9604645e-08f};
+    for (float v : values)
+        assert(lys3d::halfToFloat(lys3d::floatToHalf(v)) == v);
+    assert(lys3d::floatToHalf(1.0f) == 0x3C00);
+    assert(lys3d::floatToHalf(1e6f) == 0x7C00);
+    assert(fabsf(lys3d::halfToFloat(lys3d::floatToHalf(0.1f)) - 0.1f) < 1e-4f);
+
+    // Layouts
+    printf("- VertexLayout: Layout sizes\n");
+    assert(lys3d::VertexLayout::full().stride() == sizeof(lys3d::MeshVertex));
+    lys3d::VertexLayout compressed = lys3d::VertexLayout::compressed(true);
+    assert(compressed.stride() == 16);
+    assert(compressed.attributes().size() == 3);
+    assert(compressed.attributes()[1].offset == 8 && compressed.attributes()[2].offset == 12);
+    lys3d::VertexLayout odd;
+    odd.add(0, 3, lys3d::VertexFormat::kUByteNorm).add(1, 1, lys3d::VertexFormat::kFloat);
+    assert(odd.attributes()[1].offset == 4 && odd.stride() == 8);
+
+    // Quantize a sphere and decode it again
+    lys3d::Vector<lys3d::MeshVertex> vertices;
+    for (int r = 0; r <= 32; ++r) {
+        for (int s = 0; s <= 64; ++s) {
+            float theta = 3.14159265f * r / 32, phi = 6.28318531f * s / 64;
+            lys3d::MeshVertex v;
+            v.normal[0] = sinf(theta) * cosf(phi);
+            v.normal[1] = cosf(theta);
+            v.normal[2] = sinf(theta) * sinf(phi);
+            for (int k = 0; k < 3; ++k)
+                v.position[k] = v.normal[k] * 50.0f + 100.0f;
+            v.uv[0] = s / 64.0f * 4.0f;
+            v.uv[1] = r / 32.0f;
+            vertices.push_back(v);
+        }
+    }
+
+    for (int half = 0; half < 2; ++half) {
+        printf("- VertexLayout: Quantizing with %s UVs\n", half ? "half-float" : "16-bit");
+        lys3d::VertexQuantizer quantizer;
+        quantizer.useHalfFloatUVs(half != 0);
+        lys3d::QuantizedVertices quantized;
+        quantizer.quantize(vertices, &quantized);
+        printf("Size: %u bytes -> %u bytes\n",
+               static_cast<unsigned>(vertices.size() * sizeof(lys3d::MeshVertex)),
+               static_cast<unsigned>(quantized.data.size()));
+        assert(quantized.data.size() * 2 <= vertices.size() * sizeof(lys3d::MeshVertex));
+
+        float max_pos = 0.0f, max_normal = 0.0f, max_uv = 0.0f;
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            const uint8_t *src = quantized.data.data() + i * quantized.layout.stride();
+            int16_t position[4];
+            int8_t oct[2];
+            uint16_t uv[2];
+            memcpy(position, src, sizeof(position));
+            memcpy(oct, src + 8, sizeof(oct));
+            memcpy(uv, src + 12, sizeof(uv));
+
+            float normal[3];
+            decodeNormal(snorm(oct[0], 8), snorm(oct[1], 8), normal);
+            for (int k = 0; k < 3; ++k) {
+                float p = snorm(position[k], 16) * quantized.positionScale[k] + quantized.positionBias[k];
+                max_pos = fmaxf(max_pos, fabsf(p - vertices[i].position[k]));
+                max_normal = fmaxf(max_normal, fabsf(normal[k] - vertices[i].normal[k]));
+            }
+            for (int k = 0; k < 2; ++k) {
+                float u = half ? lys3d::halfToFloat(uv[k]) : uv[k] / 65535.0f;
+                u = u * quantized.uvScale[k] + quantized.uvBias[k];
+                max_uv = fmaxf(max_uv, fabsf(u - vertices[i].uv[k]));
+            }
+        }
+        printf("Max error: position %g, normal %g, uv %g\n", max_pos, max_normal, max_uv);
+        assert(max_pos <= 100.0f / 65535.0f * 1.01f);
+        assert(max_normal < 0.02f);
+        assert(max_uv < 0.002f);
+    }
+
+    return 0;
+}
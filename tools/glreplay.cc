@@ -0,0 +1,129 @@
+/***************************************************
+* glreplay: GL call-stream replay benchmark        *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+// Usage: lys3d-glreplay <trace.lysgl> [passes]
+// Plays back a trace recorded with LYS3D_GL_CAPTURE (see GLCapture) in a
+// window of the captured size, without presenting, and reports what each
+// frame cost: the CPU time to issue its calls, which is mostly the
+// driver's, and the GPU time glFinish() waited for on top. Every pass
+// after the first deletes what the trace created and starts over, so the
+// passes show how much of the cost is warm-up.
+
+#include "GLTrace.h"
+#include "WindowGLES2.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include <SDL2/SDL.h>
+#include "types.h"
+
+namespace {
+struct FrameTime {
+    uint32_t frame;
+    float cpuMs;
+    float totalMs;
+};
+
+float percentile(lys3d::Vector<float> values, float fraction) {
+    if (values.empty())
+        return 0.0f;
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(fraction * (values.size() - 1) + 0.5f);
+    return values[index];
+}
+
+void report(const lys3d::Vector<FrameTime> &times, uint64_t calls, uint64_t draws, uint64_t uploaded) {
+    lys3d::Vector<float> cpu, total;
+    double cpu_sum = 0.0, total_sum = 0.0;
+    for (const FrameTime &time : times) {
+        cpu.push_back(time.cpuMs);
+        total.push_back(time.totalMs);
+        cpu_sum += time.cpuMs;
+        total_sum += time.totalMs;
+    }
+    double frames = static_cast<double>(times.size());
+    printf("  CPU (issuing calls):  mean %7.3f  median %7.3f  95%% %7.3f  max %7.3f ms\n", cpu_sum / frames,
+           percentile(cpu, 0.5f), percentile(cpu, 0.95f), percentile(cpu, 1.0f));
+    printf("  CPU + GPU (finished): mean %7.3f  median %7.3f  95%% %7.3f  max %7.3f ms\n", total_sum / frames,
+           percentile(total, 0.5f), percentile(total, 0.95f), percentile(total, 1.0f));
+    printf("  Per frame: %.0f calls, %.1f draw calls, %.1f KB uploaded\n", calls / frames, draws / frames,
+           uploaded / frames / 1024.0);
+}
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        printf("Usage: %s <trace.lysgl> [passes]\n", argv[0]);
+        return 1;
+    }
+    int passes = argc > 2 ? atoi(argv[2]) : 3;
+    if (passes < 1) {
+        printf("The pass count must be at least 1\n");
+        return 1;
+    }
+
+    lys3d::GLReplay replay;
+    if (!replay.load(argv[1])) {
+        printf("Could not load the trace %s\n", argv[1]);
+        return 1;
+    }
+    lys3d::Dimension2Di32 size = replay.framebufferSize();
+    printf("%s: %u frames at %dx%d\n", argv[1], replay.frameCount(), size.width(), size.height());
+    if (replay.frameCount() == 0)
+        return 0;
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        printf("SDL_Init failed: %s\n", SDL_GetError());
+        return 1;
+    }
+    lys3d::WindowGLES2 window;
+    window.title("lys3d-glreplay");
+    window.useFullscreen(false, false);
+    window.size(size);
+    if (!window.open()) {
+        printf("Could not open a GL window: %s\n", SDL_GetError());
+        SDL_Quit();
+        return 1;
+    }
+    window.useVSync(false);
+
+    lys3d::Vector<FrameTime> times;
+    for (int pass = 0; pass < passes; ++pass) {
+        if (pass > 0)
+            replay.rewind();
+        times.clear();
+        uint64_t calls = 0, draws = 0, uploaded = 0;
+        while (replay.replayFrame(true)) {
+            const lys3d::GLReplayStats &stats = replay.stats();
+            times.push_back({replay.frame() - 1, stats.cpuMs, stats.cpuMs + stats.finishMs});
+            calls += stats.calls;
+            draws += stats.drawCalls;
+            uploaded += stats.uploadedBytes;
+            // Keep the window responsive through long traces
+            SDL_PumpEvents();
+        }
+        printf("Pass %d:\n", pass + 1);
+        report(times, calls, draws, uploaded);
+    }
+
+    // Where the last pass spent its time
+    std::sort(times.begin(), times.end(), [](const FrameTime &a, const FrameTime &b) {
+        return a.totalMs > b.totalMs;
+    });
+    printf("Slowest frames of the last pass:\n");
+    for (size_t i = 0; i < times.size() && i < 5; ++i)
+        printf("  frame %6u: %7.3f ms CPU, %7.3f ms total\n", times[i].frame, times[i].cpuMs, times[i].totalMs);
+
+    window.close();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,169 @@
+/***************************************************
+* meshlod: Offline mesh LOD chain generator        *
+* Copyright (C) 2021 by Zach Caldwell              *
+****************************************************
+* This Source Code Form is subject to the terms of *
+* the Mozilla Public License, v. 2.0. If a copy of *
+* the MPL was not distributed with this file, You  *
+* can obtain one at http://mozilla.org/MPL/2.0/.   *
+***************************************************/
+
+// Usage: lys3d-meshlod <input.obj|input.lysm> <output.lysm> [max_lods]
+// Reads a Wavefront OBJ (positions, normals, UVs; polygons are fanned into
+// triangles) or an existing mesh asset, regenerates its LOD chain, optimizes
+// every level for the vertex cache, overdraw and vertex fetch, and writes the
+// result as a mesh asset.
+
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <tuple>
+
+#include "types.h"
+
+namespace {
+bool readFile(const char *path, lys3d::Vector<uint8_t> *data) {
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data->resize(length > 0 ? static_cast<size_t>(length) : 0);
+    size_t read = fread(data->data(), 1, data->size(), file);
+    fclose(file);
+    return read == data->size();
+}
+
+// Parse one "v/vt/vn" face corner; missing parts are left at 0.
+void parseCorner(const char *token, int *v, int *vt, int *vn) {
+    *v = *vt = *vn = 0;
+    *v = atoi(token);
+    const char *slash = strchr(token, '/');
+    if (slash == nullptr)
+        return;
+    if (slash[1] != '/')
+        *vt = atoi(slash + 1);
+    slash = strchr(slash + 1, '/');
+    if (slash != nullptr)
+        *vn = atoi(slash + 1);
+}
+
+bool loadObj(const lys3d::Vector<uint8_t> &data, lys3d::Mesh *mesh) {
+    lys3d::Vector<float> positions, normals, uvs;
+    std::map<std::tuple<int, int, int>, uint16_t> corners;
+    lys3d::String text(data.begin(), data.end());
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == lys3d::String::npos)
+            end = text.size();
+        lys3d::String line = text.substr(pos, end - pos);
+        pos = end + 1;
+
+        float a = 0, b = 0, c = 0;
+        if (sscanf(line.c_str(), "v %f %f %f", &a, &b, &c) == 3) {
+            positions.insert(positions.end(), {a, b, c});
+        } else if (sscanf(line.c_str(), "vn %f %f %f", &a, &b, &c) == 3) {
+            normals.insert(normals.end(), {a, b, c});
+        } else if (sscanf(line.c_str(), "vt %f %f", &a, &b) == 2) {
+            uvs.insert(uvs.end(), {a, b});
+        } else if (line.compare(0, 2, "f ") == 0) {
+            lys3d::Vector<uint16_t> face;
+            size_t start = line.find_first_not_of(" \t\r", 2);
+            while (start != lys3d::String::npos) {
+                size_t stop = line.find_first_of(" \t\r", start);
+                lys3d::String token = line.substr(start, stop - start);
+                start = line.find_first_not_of(" \t\r", stop);
+                int v, vt, vn;
+                parseCorner(token.c_str(), &v, &vt, &vn);
+                // Negative indices are relative to the end of the list
+                if (v < 0) v += static_cast<int>(positions.size() / 3) + 1;
+                if (vt < 0) vt += static_cast<int>(uvs.size() / 2) + 1;
+                if (vn < 0) vn += static_cast<int>(normals.size() / 3) + 1;
+                if (v <= 0 || static_cast<size_t>(v) * 3 > positions.size())
+                    return false;
+
+                std::tuple<int, int, int> key(v, vt, vn);
+                auto found = corners.find(key);
+                if (found == corners.end()) {
+                    if (mesh->vertices().size() >= 65536) {
+                        fprintf(stderr, "Too many vertices for 16-bit indices\n");
+                        return false;
+                    }
+                    lys3d::MeshVertex vertex;
+                    memset(&vertex, 0, sizeof(vertex));
+                    memcpy(vertex.position, &positions[(v - 1) * 3], sizeof(vertex.position));
+                    if (vn > 0 && static_cast<size_t>(vn) * 3 <= normals.size())
+                        memcpy(vertex.normal, &normals[(vn - 1) * 3], sizeof(vertex.normal));
+                    if (vt > 0 && static_cast<size_t>(vt) * 2 <= uvs.size())
+                        memcpy(vertex.uv, &uvs[(vt - 1) * 2], sizeof(vertex.uv));
+                    uint16_t index = static_cast<uint16_t>(mesh->vertices().size());
+                    mesh->vertices().push_back(vertex);
+                    found = corners.insert(std::make_pair(key, index)).first;
+                }
+                face.push_back(found->second);
+            }
+            for (size_t i = 2; i < face.size(); ++i)
+                mesh->indices().insert(mesh->indices().end(), {face[0], face[i - 1], face[i]});
+        }
+    }
+    mesh->resetLods();
+    return !mesh->indices().empty();
+}
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <input.obj|input.lysm> <output.lysm> [max_lods]\n", argv[0]);
+        return 1;
+    }
+
+    lys3d::Vector<uint8_t> data;
+    if (!readFile(argv[1], &data)) {
+        fprintf(stderr, "Could not read %s\n", argv[1]);
+        return 1;
+    }
+
+    lys3d::Mesh mesh;
+    if (!mesh.loadFromMemory(data.data(), data.size()) && !loadObj(data, &mesh)) {
+        fprintf(stderr, "%s is not a mesh asset or a usable OBJ file\n", argv[1]);
+        return 1;
+    }
+
+    lys3d::MeshSimplifier simplifier;
+    if (argc > 3)
+        simplifier.maxLods(static_cast<uint32_t>(atoi(argv[3])));
+    uint32_t levels = simplifier.generate(&mesh);
+
+    lys3d::MeshOptimizer optimizer;
+    lys3d::Vector<lys3d::VertexCacheStats> before;
+    for (const lys3d::MeshLod &lod : mesh.lods())
+        before.push_back(optimizer.analyze(mesh.indices().data() + lod.indexOffset, lod.indexCount,
+                                           mesh.vertices().size()));
+    optimizer.optimize(&mesh);
+
+    for (uint32_t i = 0; i < levels; ++i) {
+        const lys3d::MeshLod &lod = mesh.lods()[i];
+        lys3d::VertexCacheStats after = optimizer.analyze(mesh.indices().data() + lod.indexOffset,
+                                                          lod.indexCount, mesh.vertices().size());
+        printf("LOD %u: %u triangles, error %g, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", i,
+               mesh.triangleCount(i), lod.error, before[i].acmr, after.acmr, before[i].atvr, after.atvr);
+    }
+
+    mesh.saveToMemory(&data);
+    FILE *file = fopen(argv[2], "wb");
+    if (file == nullptr || fwrite(data.data(), 1, data.size(), file) != data.size()) {
+        fprintf(stderr, "Could not write %s\n", argv[2]);
+        if (file != nullptr)
+            fclose(file);
+        return 1;
+    }
+    fclose(file);
+    return 0;
+}